@@ -43,40 +43,38 @@ template <>
 struct GCPolicy<void*> : public IgnoreGCPolicy<void*> {};
 }
 
-bool GjsAtom::init(JSContext* cx, const char* str) {
-    JSString* s = JS_AtomizeAndPinString(cx, str);
-    if (!s)
-        return false;
-    m_jsid = JS::Heap<jsid>{JS::PropertyKey::fromPinnedString(s)};
-    return true;
-}
+static const char* const atom_names[GjsAtoms::N_ATOMS] = {
+#define ATOM_NAME(identifier, str) str,
+    FOR_EACH_ATOM(ATOM_NAME) FOR_EACH_SYMBOL_ATOM(ATOM_NAME)
+#undef ATOM_NAME
+};
 
-bool GjsSymbolAtom::init(JSContext* cx, const char* str) {
-    JS::RootedString descr(cx, JS_AtomizeAndPinString(cx, str));
-    if (!descr)
-        return false;
-    JS::Symbol* symbol = JS::NewSymbol(cx, descr);
-    if (!symbol)
-        return false;
-    m_jsid = JS::Heap<jsid>{SYMBOL_TO_JSID(symbol)};
-    return true;
-}
+#define COUNT_ATOM(identifier, str) +1
+static constexpr unsigned N_STRING_ATOMS = 0 FOR_EACH_ATOM(COUNT_ATOM);
+#undef COUNT_ATOM
 
 /* Requires a current realm. This can GC, so it needs to be done after the
  * tracing has been set up. */
 bool GjsAtoms::init_atoms(JSContext* cx) {
-#define INITIALIZE_ATOM(identifier, str) \
-    if (!identifier.init(cx, str))       \
-        return false;
-    FOR_EACH_ATOM(INITIALIZE_ATOM)
-    FOR_EACH_SYMBOL_ATOM(INITIALIZE_ATOM)
+    for (unsigned ix = 0; ix < N_ATOMS; ix++) {
+        JS::RootedString str(cx, JS_AtomizeAndPinString(cx, atom_names[ix]));
+        if (!str)
+            return false;
+
+        if (ix < N_STRING_ATOMS) {
+            m_ids[ix] = JS::PropertyKey::fromPinnedString(str);
+            continue;
+        }
+
+        JS::Symbol* symbol = JS::NewSymbol(cx, str);
+        if (!symbol)
+            return false;
+        m_ids[ix] = SYMBOL_TO_JSID(symbol);
+    }
     return true;
 }
 
 void GjsAtoms::trace(JSTracer* trc) {
-#define TRACE_ATOM(identifier, str) \
-    JS::TraceEdge<jsid>(trc, identifier.id(), "Atom " str);
-    FOR_EACH_ATOM(TRACE_ATOM)
-    FOR_EACH_SYMBOL_ATOM(TRACE_ATOM)
-#undef TRACE_ATOM
+    for (unsigned ix = 0; ix < N_ATOMS; ix++)
+        JS::TraceEdge<jsid>(trc, &m_ids[ix], atom_names[ix]);
 }
@@ -37,12 +37,15 @@ class JSTracer;
 
 // clang-format off
 #define FOR_EACH_ATOM(macro) \
+    macro(class_overrides, "_classOverrides") \
     macro(code, "code") \
     macro(column_number, "columnNumber") \
     macro(connect_after, "connect_after") \
     macro(constructor, "constructor") \
+    macro(debounce, "debounce") \
     macro(debuggee, "debuggee") \
     macro(detail, "detail") \
+    macro(done, "done") \
     macro(emit, "emit") \
     macro(file, "__file__") \
     macro(file_name, "fileName") \
@@ -51,6 +54,7 @@ class JSTracer;
     macro(gio, "Gio") \
     macro(glib, "GLib") \
     macro(gobject, "GObject") \
+    macro(group, "group") \
     macro(gtype, "$gtype") \
     macro(height, "height") \
     macro(imports, "imports") \
@@ -74,7 +78,9 @@ class JSTracer;
     macro(search_path, "searchPath") \
     macro(signal_id, "signalId") \
     macro(stack, "stack") \
+    macro(throttle, "throttle") \
     macro(to_string, "toString") \
+    macro(value, "value") \
     macro(value_of, "valueOf") \
     macro(version, "version") \
     macro(versions, "versions") \
@@ -92,42 +98,48 @@ class JSTracer;
     macro(signals_unblock, "__GObject__signals_unblock")
 // clang-format on
 
-struct GjsAtom {
-    GJS_JSAPI_RETURN_CONVENTION bool init(JSContext* cx, const char* str);
-
-    /* It's OK to return JS::HandleId here, to avoid an extra root, with the
-     * caveat that you should not use this value after the GjsContext has been
-     * destroyed.*/
-    [[nodiscard]] JS::HandleId operator()() const {
-        return JS::HandleId::fromMarkedLocation(&m_jsid.get());
-    }
-
-    [[nodiscard]] JS::Heap<jsid>* id() { return &m_jsid; }
-
- protected:
-    JS::Heap<jsid> m_jsid;
-};
-
-struct GjsSymbolAtom : GjsAtom {
-    GJS_JSAPI_RETURN_CONVENTION bool init(JSContext* cx, const char* str);
-};
-
+// All the atoms are stored in one array, traced and initialized in a loop, so
+// that they share cache lines and don't each need their own code. The accessor
+// for each one, e.g. atoms.name(), returns its jsid.
 class GjsAtoms {
  public:
+    enum Index : unsigned {
+#define DECLARE_ATOM_INDEX(identifier, str) identifier##_index,
+        FOR_EACH_ATOM(DECLARE_ATOM_INDEX)
+        // The symbol atoms come after all the string atoms
+        FOR_EACH_SYMBOL_ATOM(DECLARE_ATOM_INDEX)
+#undef DECLARE_ATOM_INDEX
+        N_ATOMS
+    };
+
     GjsAtoms(void) {}
     ~GjsAtoms(void) {}  // prevents giant destructor from being inlined
     GJS_JSAPI_RETURN_CONVENTION bool init_atoms(JSContext* cx);
 
     void trace(JSTracer* trc);
 
-#define DECLARE_ATOM_MEMBER(identifier, str) GjsAtom identifier;
-#define DECLARE_SYMBOL_ATOM_MEMBER(identifier, str) GjsSymbolAtom identifier;
-    FOR_EACH_ATOM(DECLARE_ATOM_MEMBER)
-    FOR_EACH_SYMBOL_ATOM(DECLARE_SYMBOL_ATOM_MEMBER)
-#undef DECLARE_ATOM_MEMBER
-#undef DECLARE_SYMBOL_ATOM_MEMBER
+    /* It's OK to return JS::HandleId here, to avoid an extra root, with the
+     * caveat that you should not use this value after the GjsContext has been
+     * destroyed.*/
+    [[nodiscard]] JS::HandleId get(Index ix) const {
+        return JS::HandleId::fromMarkedLocation(&m_ids[ix].get());
+    }
+
+#define DECLARE_ATOM_ACCESSOR(identifier, str)        \
+    [[nodiscard]] JS::HandleId identifier() const { \
+        return get(identifier##_index);               \
+    }
+    FOR_EACH_ATOM(DECLARE_ATOM_ACCESSOR)
+    FOR_EACH_SYMBOL_ATOM(DECLARE_ATOM_ACCESSOR)
+#undef DECLARE_ATOM_ACCESSOR
+
+ private:
+    JS::Heap<jsid> m_ids[N_ATOMS];
 };
 
+// For templates parametrized on an atom, e.g. &GjsAtoms::stack
+using GjsAtomGetter = JS::HandleId (GjsAtoms::*)() const;
+
 #ifndef GJS_USE_ATOM_FOREACH
 #    undef FOR_EACH_ATOM
 #    undef FOR_EACH_SYMBOL_ATOM
@@ -24,7 +24,12 @@
 #include <config.h>
 
 #include <stdint.h>
-#include <string.h>  // for strcmp, memchr, strlen
+#include <string.h>  // for strcmp, memchr, memcpy, strlen
+
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <utility>  // for move
 
 #include <girepository.h>
 #include <glib-object.h>
@@ -35,12 +40,15 @@
 #include <js/GCAPI.h>  // for AutoCheckCannotGC
 #include <js/PropertySpec.h>
 #include <js/RootingAPI.h>
+#include <js/StructuredClone.h>
 #include <js/TypeDecls.h>
 #include <js/Utility.h>   // for UniqueChars
 #include <jsapi.h>        // for JS_DefineFunctionById, JS_DefineFun...
-#include <jsfriendapi.h>  // for JS_NewUint8ArrayWithBuffer, GetUint...
+#include <jsfriendapi.h>  // for JS_NewUint8ArrayWithBuffer, GetUint...,
+                          // JS_GetArrayBufferViewBuffer
 
 #include "gi/boxed.h"
+#include "gi/wrapperutils.h"  // for GjsTypecheckNoThrow
 #include "cjs/atoms.h"
 #include "cjs/byteArray.h"
 #include "cjs/context-private.h"
@@ -48,33 +56,167 @@
 #include "cjs/jsapi-util-args.h"
 #include "cjs/jsapi-util.h"
 
-/* Callbacks to use with JS::NewExternalArrayBuffer() */
+// The GBytes whose memory backs external ArrayBuffers, by start address. A
+// Uint8Array viewing that memory can then be turned back into a GBytes that
+// shares it, instead of one with a copy. ArrayBuffers may be finalized on a
+// background thread, hence the lock.
+struct GBytesRegion {
+    const uint8_t* end;
+    GBytes* gbytes;
+};
+G_LOCK_DEFINE_STATIC(gbytes_buffers);
+static std::multimap<const uint8_t*, GBytesRegion> s_gbytes_buffers;
+
+// The regions above that aren't within another one. None of these is within
+// another, so ordered by start address they are also ordered by end address,
+// and the one starting closest before an address reaches furthest past it. A
+// range within any region is within one of these, so looking it up only takes
+// checking that one.
+static std::map<const uint8_t*, GBytesRegion> s_outermost_gbytes;
+
+// Returns the outermost region containing the @len bytes at @data, or the end
+[[nodiscard]] static auto find_outermost_region(const uint8_t* data,
+                                                size_t len) {
+    auto it = s_outermost_gbytes.upper_bound(data);
+    if (it == s_outermost_gbytes.begin())
+        return s_outermost_gbytes.end();
+    --it;
+    if (it->second.end <= data || size_t(it->second.end - data) < len)
+        return s_outermost_gbytes.end();
+    return it;
+}
 
-static void gfree_arraybuffer_contents(void* contents, void*) {
-    g_free(contents);
+// Records @region as outermost unless it is within another outermost region,
+// and then drops those within it
+static void add_outermost_region(const uint8_t* start,
+                                 const GBytesRegion& region) {
+    if (find_outermost_region(start, region.end - start) !=
+        s_outermost_gbytes.end())
+        return;
+
+    auto it = s_outermost_gbytes.lower_bound(start);
+    while (it != s_outermost_gbytes.end() && it->second.end <= region.end)
+        it = s_outermost_gbytes.erase(it);
+    s_outermost_gbytes.emplace(start, region);
 }
 
-static void bytes_unref_arraybuffer(void* contents [[maybe_unused]],
-                                    void* user_data) {
+/* Callbacks to use with JS::NewExternalArrayBuffer() */
+
+static void bytes_unref_arraybuffer(void* contents, void* user_data) {
     auto* gbytes = static_cast<GBytes*>(user_data);
+    auto* start = static_cast<const uint8_t*>(contents);
+
+    G_LOCK(gbytes_buffers);
+    auto range = s_gbytes_buffers.equal_range(start);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (it->second.gbytes == gbytes) {
+            const uint8_t* end = it->second.end;
+            s_gbytes_buffers.erase(it);
+
+            // The regions that were within this one may be outermost now
+            auto outermost = s_outermost_gbytes.find(start);
+            if (outermost != s_outermost_gbytes.end() &&
+                outermost->second.gbytes == gbytes) {
+                s_outermost_gbytes.erase(outermost);
+                for (auto inner = s_gbytes_buffers.lower_bound(start);
+                     inner != s_gbytes_buffers.end() && inner->first < end;
+                     ++inner)
+                    add_outermost_region(inner->first, inner->second);
+            }
+            break;
+        }
+    }
+    G_UNLOCK(gbytes_buffers);
+
     g_bytes_unref(gbytes);
 }
 
+// Returns a new reference to a GBytes sharing the @len bytes at @data, if they
+// lie within the memory of a GBytes backing an ArrayBuffer, or nullptr
+[[nodiscard]] static GBytes* lookup_shared_bytes(const uint8_t* data,
+                                                 size_t len) {
+    GBytes* retval = nullptr;
+
+    G_LOCK(gbytes_buffers);
+    auto it = find_outermost_region(data, len);
+    if (it != s_outermost_gbytes.end()) {
+        retval =
+            g_bytes_new_from_bytes(it->second.gbytes, data - it->first, len);
+    }
+    G_UNLOCK(gbytes_buffers);
+
+    return retval;
+}
+
+// Opening an iconv descriptor is expensive, so they are kept for each pair of
+// encodings. g_convert_with_iconv() resets a descriptor after each use, but a
+// descriptor can't be used from two threads at once, so the cache is per
+// thread.
+class IconvCache {
+    std::unordered_map<std::string, GIConv> m_converters;
+
+ public:
+    ~IconvCache() {
+        for (auto& entry : m_converters)
+            g_iconv_close(entry.second);
+    }
+
+    [[nodiscard]] GIConv get(const char* to_encoding,
+                             const char* from_encoding, GError** error) {
+        std::string key = std::string(to_encoding) + '\n' + from_encoding;
+        auto found = m_converters.find(key);
+        if (found != m_converters.end())
+            return found->second;
+
+        GIConv converter = g_iconv_open(to_encoding, from_encoding);
+        if (converter == reinterpret_cast<GIConv>(-1)) {
+            g_set_error(error, G_CONVERT_ERROR, G_CONVERT_ERROR_NO_CONVERSION,
+                        "Conversion from character set '%s' to '%s' is not "
+                        "supported",
+                        from_encoding, to_encoding);
+            return nullptr;
+        }
+        m_converters.emplace(std::move(key), converter);
+        return converter;
+    }
+};
+
+static thread_local IconvCache s_iconv_cache;
+
+// Like g_convert(), but with a cached iconv descriptor
+[[nodiscard]] static char* convert_cached(const char* str, size_t len,
+                                          const char* to_encoding,
+                                          const char* from_encoding,
+                                          size_t* bytes_written,
+                                          GError** error) {
+    GIConv converter = s_iconv_cache.get(to_encoding, from_encoding, error);
+    if (!converter)
+        return nullptr;
+    return g_convert_with_iconv(str, len, converter, /* bytes read */ nullptr,
+                                bytes_written, error);
+}
+
+// Typed arrays this small may keep their bytes inline in the GC thing, which
+// can move during a compacting GC; they are cheap to copy out first. Larger
+// ones can still have their bytes in the nursery, which move during a minor
+// GC, so for those the pointer is checked again afterwards.
+static constexpr size_t MAX_INLINE_BYTES = 128;
+
 GJS_JSAPI_RETURN_CONVENTION
 bool to_string_impl_slow(JSContext* cx, uint8_t* data, uint32_t len,
                          const char* encoding, JS::MutableHandleValue rval) {
     size_t bytes_written;
     GError* error = nullptr;
-    GjsAutoChar u16_str = g_convert(reinterpret_cast<char*>(data), len,
+    GjsAutoChar u16_str =
+        convert_cached(reinterpret_cast<char*>(data), len,
     // Make sure the bytes of the UTF-16 string are laid out in memory
     // such that we can simply reinterpret_cast<char16_t> them.
 #if G_BYTE_ORDER == G_LITTLE_ENDIAN
-                                    "UTF-16LE",
+                       "UTF-16LE",
 #else
-                                    "UTF-16BE",
+                       "UTF-16BE",
 #endif
-                                    encoding, nullptr, /* bytes read */
-                                    &bytes_written, &error);
+                       encoding, &bytes_written, &error);
     if (!u16_str)
         return gjs_throw_gerror_message(cx, error);  // frees GError
 
@@ -125,8 +267,18 @@ static bool to_string_impl(JSContext* context, JS::HandleObject byte_array,
         return true;
     }
 
-    if (!encoding_is_utf8)
+    // Creating the string can trigger a GC, which may move the bytes of a
+    // small array, so copy those out first
+    uint8_t inline_copy[MAX_INLINE_BYTES];
+    if (len <= MAX_INLINE_BYTES) {
+        memcpy(inline_copy, data, len);
+        data = inline_copy;
+    }
+
+    if (!encoding_is_utf8) {
+        // iconv doesn't allocate GC things, so the bytes can't move
         return to_string_impl_slow(context, data, len, encoding, rval);
+    }
 
     // optimization, avoids iconv overhead and runs libmozjs hardwired
     // utf8-to-utf16
@@ -142,6 +294,9 @@ static bool to_string_impl(JSContext* context, JS::HandleObject byte_array,
             return false;
     }
 
+    if (data == inline_copy)
+        return true;
+
     uint8_t* current_data;
     uint32_t current_len;
     bool ignore_val;
@@ -241,16 +396,24 @@ from_string_func(JSContext *context,
 {
     JS::CallArgs argv = JS::CallArgsFromVp (argc, vp);
     JS::UniqueChars encoding;
-    JS::UniqueChars utf8;
     bool encoding_is_utf8;
     JS::RootedObject obj(context), array_buffer(context);
 
-    if (!gjs_parse_call_args(context, "fromString", argv, "s|s",
-                             "string", &utf8,
-                             "encoding", &encoding))
+    // The string is only read once, in the conversion for its encoding, so it
+    // isn't converted with gjs_parse_call_args()
+    if (!argv.requireAtLeast(context, "fromString", 1))
         return false;
+    if (!argv[0].isString()) {
+        gjs_throw(context, "Argument to ByteArray.fromString() must be a string");
+        return false;
+    }
+    JS::RootedString str(context, argv[0].toString());
 
     if (argc > 1) {
+        encoding = gjs_string_to_utf8(context, argv[1]);
+        if (!encoding)
+            return false;
+
         /* maybe we should be smarter about utf8 synonyms here.
          * doesn't matter much though. encoding_is_utf8 is
          * just an optimization anyway.
@@ -264,11 +427,13 @@ from_string_func(JSContext *context,
         /* optimization? avoids iconv overhead and runs
          * libmozjs hardwired utf16-to-utf8.
          */
+        JS::UniqueChars utf8(JS_EncodeStringToUTF8(context, str));
+        if (!utf8)
+            return false;
         size_t len = strlen(utf8.get());
         array_buffer =
             JS::NewArrayBufferWithContents(context, len, utf8.release());
     } else {
-        JSString *str = argv[0].toString();  /* Rooted by argv */
         GError *error = NULL;
         char *encoded = NULL;
         gsize bytes_written;
@@ -285,31 +450,34 @@ from_string_func(JSContext *context,
                 if (chars == NULL)
                     return false;
 
-                encoded = g_convert((char *) chars, len,
-                                    encoding.get(),  // to_encoding
-                                    "LATIN1",  /* from_encoding */
-                                    NULL,  /* bytes read */
-                                    &bytes_written, &error);
+                encoded = convert_cached(reinterpret_cast<const char*>(chars),
+                                         len,
+                                         encoding.get(),  // to_encoding
+                                         "LATIN1",  // from_encoding
+                                         &bytes_written, &error);
             } else {
                 const char16_t *chars =
                     JS_GetTwoByteStringCharsAndLength(context, nogc, str, &len);
                 if (chars == NULL)
                     return false;
 
-                encoded = g_convert((char *) chars, len * 2,
-                                    encoding.get(),  // to_encoding
-                                    "UTF-16",  /* from_encoding */
-                                    NULL,  /* bytes read */
-                                    &bytes_written, &error);
+                encoded = convert_cached(reinterpret_cast<const char*>(chars),
+                                         len * 2,
+                                         encoding.get(),  // to_encoding
+                                         "UTF-16",  // from_encoding
+                                         &bytes_written, &error);
             }
         }
 
         if (!encoded)
             return gjs_throw_gerror_message(context, error);  // frees GError
 
+        // Hand the converted buffer over to the JS engine rather than keeping
+        // it external, so that the GC counts it towards the heap size
         array_buffer =
-            JS::NewExternalArrayBuffer(context, bytes_written, encoded,
-                                       gfree_arraybuffer_contents, nullptr);
+            JS::NewArrayBufferWithContents(context, bytes_written, encoded);
+        if (!array_buffer)
+            g_free(encoded);
     }
 
     if (!array_buffer)
@@ -346,30 +514,92 @@ from_gbytes_func(JSContext *context,
     if (!gbytes)
         return false;
 
+    JSObject* obj = gjs_byte_array_from_gbytes(context, gbytes);
+    if (!obj)
+        return false;
+
+    argv.rval().setObject(*obj);
+    return true;
+}
+
+/* allocatePinned() function implementation */
+GJS_JSAPI_RETURN_CONVENTION
+static bool allocate_pinned_func(JSContext* cx, unsigned argc, JS::Value* vp) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+    uint32_t len;
+
+    if (!gjs_parse_call_args(cx, "allocatePinned", args, "u", "length", &len))
+        return false;
+
+    // The memory belongs to a GBytes rather than to the JS engine, so it never
+    // moves and is shared, not copied, by toGBytes(). That makes it suitable
+    // for handing to I/O running on another thread.
+    void* data = g_try_malloc0(len);
+    if (len > 0 && !data) {
+        gjs_throw_custom(cx, JSProto_RangeError, nullptr,
+                         "Cannot allocate %u bytes", len);
+        return false;
+    }
+    GjsAutoBytes gbytes = g_bytes_new_take(data, len);
+
+    JSObject* obj = gjs_byte_array_from_gbytes(cx, gbytes);
+    if (!obj)
+        return false;
+
+    args.rval().setObject(*obj);
+    return true;
+}
+
+JSObject* gjs_array_buffer_from_gbytes(JSContext* cx, GBytes* gbytes) {
     size_t len;
     const void* data = g_bytes_get_data(gbytes, &len);
+    if (len == 0)
+        return JS::NewArrayBuffer(cx, 0);
+
     JS::RootedObject array_buffer(
-        context,
-        JS::NewExternalArrayBuffer(
-            context, len,
-            const_cast<void*>(data),  // the ArrayBuffer won't modify the data
-            bytes_unref_arraybuffer, gbytes));
+        cx, JS::NewExternalArrayBuffer(
+                cx, len,
+                // only allocatePinned() arrays are meant to be written to
+                const_cast<void*>(data),
+                bytes_unref_arraybuffer, gbytes));
     if (!array_buffer)
-        return false;
-    g_bytes_ref(gbytes);  // now owned by both ArrayBuffer and BoxedBase
+        return nullptr;
+    g_bytes_ref(gbytes);  // now owned by both ArrayBuffer and the caller
+
+    auto* start = static_cast<const uint8_t*>(data);
+    GBytesRegion region{start + len, gbytes};
+    G_LOCK(gbytes_buffers);
+    s_gbytes_buffers.emplace(start, region);
+    add_outermost_region(start, region);
+    G_UNLOCK(gbytes_buffers);
 
-    JS::RootedObject obj(
-        context, JS_NewUint8ArrayWithBuffer(context, array_buffer, 0, -1));
+    return array_buffer;
+}
+
+// A Uint8Array sharing the memory of @gbytes, without the toString() method
+// of ByteArrays, so that it can be created in any JS context
+GJS_JSAPI_RETURN_CONVENTION
+static JSObject* uint8array_sharing_gbytes(JSContext* cx, GBytes* gbytes) {
+    JS::RootedObject array_buffer(cx, gjs_array_buffer_from_gbytes(cx, gbytes));
+    if (!array_buffer)
+        return nullptr;
+    return JS_NewUint8ArrayWithBuffer(cx, array_buffer, 0, -1);
+}
+
+JSObject* gjs_byte_array_from_gbytes(JSContext* cx, GBytes* gbytes) {
+    if (g_bytes_get_size(gbytes) == 0)
+        return gjs_byte_array_from_data(cx, 0, nullptr);
+
+    JS::RootedObject obj(cx, uint8array_sharing_gbytes(cx, gbytes));
     if (!obj)
-        return false;
+        return nullptr;
 
-    const GjsAtoms& atoms = GjsContextPrivate::atoms(context);
-    if (!JS_DefineFunctionById(context, obj, atoms.to_string(),
+    const GjsAtoms& atoms = GjsContextPrivate::atoms(cx);
+    if (!JS_DefineFunctionById(cx, obj, atoms.to_string(),
                                instance_to_string_func, 1, 0))
-        return false;
+        return nullptr;
 
-    argv.rval().setObject(*obj);
-    return true;
+    return obj;
 }
 
 JSObject* gjs_byte_array_from_data(JSContext* cx, size_t nbytes, void* data) {
@@ -403,6 +633,12 @@ GBytes* gjs_byte_array_get_bytes(JSObject* obj) {
     uint8_t* data;
 
     js::GetUint8ArrayLengthAndData(obj, &len, &is_shared_memory, &data);
+
+    // Memory that came from a GBytes is shared again. Memory owned by the JS
+    // engine must be copied, since it may move during garbage collection.
+    GBytes* shared = len > 0 ? lookup_shared_bytes(data, len) : nullptr;
+    if (shared)
+        return shared;
     return g_bytes_new(data, len);
 }
 
@@ -410,9 +646,326 @@ GByteArray* gjs_byte_array_get_byte_array(JSObject* obj) {
     return g_bytes_unref_to_array(gjs_byte_array_get_bytes(obj));
 }
 
+// Structured clone hooks ////////////////////////////////////////////////////
+
+enum GjsCloneTag : uint32_t {
+    // A GLib.Bytes whose contents follow in the clone buffer
+    GJS_SCTAG_GBYTES_COPY = JS_SCTAG_USER_MIN,
+    // Transferred GLib.Bytes and Uint8Array; the transfer content is a GBytes
+    // reference
+    GJS_SCTAG_GBYTES_TRANSFER,
+    GJS_SCTAG_UINT8ARRAY_TRANSFER,
+};
+
+[[nodiscard]] static GBytes* gbytes_for_boxed(JSContext* cx,
+                                              JS::HandleObject obj) {
+    if (!BoxedBase::typecheck(cx, obj, nullptr, G_TYPE_BYTES,
+                              GjsTypecheckNoThrow()))
+        return nullptr;
+    return BoxedBase::to_c_ptr<GBytes>(cx, obj);
+}
+
+// @closure is the GjsContextPrivate reading the clone, or null for a context
+// without GI, which gets Uint8Arrays in place of GLib.Bytes
+GJS_JSAPI_RETURN_CONVENTION
+static JSObject* wrap_cloned_gbytes(JSContext* cx, GBytes* gbytes,
+                                    bool as_boxed, void* closure) {
+    if (!closure)
+        return uint8array_sharing_gbytes(cx, gbytes);
+    if (!as_boxed)
+        return gjs_byte_array_from_gbytes(cx, gbytes);
+
+    GjsAutoStructInfo info = g_irepository_find_by_gtype(nullptr, G_TYPE_BYTES);
+    if (!info) {
+        gjs_throw(cx, "GLib.Bytes is not introspectable");
+        return nullptr;
+    }
+    return BoxedInstance::new_for_c_struct(cx, info, gbytes);
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool write_clone(JSContext* cx, JSStructuredCloneWriter* writer,
+                        JS::HandleObject obj, bool*, void*) {
+    GBytes* gbytes = gbytes_for_boxed(cx, obj);
+    if (!gbytes) {
+        if (!JS_IsExceptionPending(cx))
+            gjs_throw_custom(cx, JSProto_TypeError, "DataCloneError",
+                             "The object could not be cloned");
+        return false;
+    }
+
+    size_t len;
+    const void* data = g_bytes_get_data(gbytes, &len);
+    if (len > UINT32_MAX) {
+        gjs_throw(cx, "GLib.Bytes too large to clone, transfer it instead");
+        return false;
+    }
+    return JS_WriteUint32Pair(writer, GJS_SCTAG_GBYTES_COPY, len) &&
+           JS_WriteBytes(writer, data, len);
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static JSObject* read_clone(JSContext* cx, JSStructuredCloneReader* reader,
+                            const JS::CloneDataPolicy&, uint32_t tag,
+                            uint32_t len, void* closure) {
+    if (tag != GJS_SCTAG_GBYTES_COPY) {
+        gjs_throw(cx, "Unknown tag %u in structured clone", tag);
+        return nullptr;
+    }
+
+    GjsAutoFree<uint8_t> data = g_new(uint8_t, len);
+    if (!JS_ReadBytes(reader, data, len))
+        return nullptr;
+
+    GjsAutoBytes gbytes =
+        g_bytes_new_take(data.release(), len);
+    return wrap_cloned_gbytes(cx, gbytes, true, closure);
+}
+
+static bool can_transfer(JSContext* cx, JS::HandleObject obj, bool*, void*) {
+    return JS_IsUint8Array(obj) || gbytes_for_boxed(cx, obj);
+}
+
+// The sender keeps a transferred GLib.Bytes, and the receiver gets it as a
+// writable Uint8Array, so the receiver copies it in read_transfer(): what is
+// saved is only the copy into the clone buffer. A Uint8Array is writable, so as
+// for a transferred ArrayBuffer, the sender's buffer is detached. Its memory is
+// copied once into a new GBytes, even if it came from a GBytes, since the
+// sender may still have that GBytes, or other Uint8Arrays over it.
+GJS_JSAPI_RETURN_CONVENTION
+static bool write_transfer(JSContext* cx, JS::HandleObject obj, void*,
+                           uint32_t* tag, JS::TransferableOwnership* ownership,
+                           void** content, uint64_t* extra_data) {
+    GBytes* gbytes;
+    if (JS_IsUint8Array(obj)) {
+        bool is_shared_memory;
+        JS::RootedObject buffer(
+            cx, JS_GetArrayBufferViewBuffer(cx, obj, &is_shared_memory));
+        if (!buffer)
+            return false;
+        if (is_shared_memory) {
+            gjs_throw_custom(cx, JSProto_TypeError, "DataCloneError",
+                             "A Uint8Array over shared memory cannot be "
+                             "transferred");
+            return false;
+        }
+
+        *tag = GJS_SCTAG_UINT8ARRAY_TRANSFER;
+        uint32_t len;
+        uint8_t* data;
+        js::GetUint8ArrayLengthAndData(obj, &len, &is_shared_memory, &data);
+        gbytes = g_bytes_new(data, len);
+        if (!JS::DetachArrayBuffer(cx, buffer)) {
+            g_bytes_unref(gbytes);
+            return false;
+        }
+    } else {
+        *tag = GJS_SCTAG_GBYTES_TRANSFER;
+        gbytes = gbytes_for_boxed(cx, obj);
+        if (!gbytes)
+            return false;
+        g_bytes_ref(gbytes);
+    }
+
+    *ownership = JS::SCTAG_TMO_CUSTOM;
+    *content = gbytes;
+    *extra_data = 0;
+    return true;
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool read_transfer(JSContext* cx, JSStructuredCloneReader*,
+                          uint32_t tag, void* content, uint64_t, void* closure,
+                          JS::MutableHandleObject obj_out) {
+    if (tag != GJS_SCTAG_GBYTES_TRANSFER &&
+        tag != GJS_SCTAG_UINT8ARRAY_TRANSFER) {
+        gjs_throw(cx, "Unknown transfer tag %u in structured clone", tag);
+        return false;
+    }
+
+    GjsAutoBytes gbytes =
+        static_cast<GBytes*>(content);
+    if (tag == GJS_SCTAG_GBYTES_TRANSFER) {
+        size_t len;
+        const void* data = g_bytes_get_data(gbytes, &len);
+        gbytes.reset(g_bytes_new(data, len));
+    }
+    obj_out.set(wrap_cloned_gbytes(
+        cx, gbytes, tag == GJS_SCTAG_GBYTES_TRANSFER, closure));
+    return !!obj_out;
+}
+
+// Called for transferred content that was never read
+static void free_transfer(uint32_t, JS::TransferableOwnership,
+                          void* content, uint64_t, void*) {
+    g_bytes_unref(static_cast<GBytes*>(content));
+}
+
+static const JSStructuredCloneCallbacks gjs_byte_array_clone_callbacks = {
+    read_clone,
+    write_clone,
+    nullptr,  // reportError
+    read_transfer,
+    write_transfer,
+    free_transfer,
+    can_transfer,
+    nullptr,  // sabCloned
+};
+
+const JSStructuredCloneCallbacks* gjs_byte_array_get_clone_callbacks() {
+    return &gjs_byte_array_clone_callbacks;
+}
+
+using GjsAutoUtf16 = GjsAutoPointer<gunichar2, void, g_free>;
+
+// Decodes UTF-8 JSON text into a buffer for the JSON parser. This never calls
+// into the JS engine, so it can read from a Uint8Array's memory directly.
+[[nodiscard]] static gunichar2* utf8_json_to_utf16(const uint8_t* data,
+                                                   size_t len, long* n_chars,
+                                                   GError** error) {
+    // g_utf8_to_utf16() returns null without an error for null data, as in an
+    // empty GBytes or a detached Uint8Array; the parser throws a SyntaxError
+    // on the empty text
+    if (len == 0 || !data) {
+        *n_chars = 0;
+        return g_new0(gunichar2, 1);
+    }
+
+    // g_utf8_to_utf16() stops at a nul byte, which is not valid JSON anyway
+    if (memchr(data, '\0', len)) {
+        g_set_error_literal(error, G_CONVERT_ERROR,
+                            G_CONVERT_ERROR_ILLEGAL_SEQUENCE,
+                            "JSON text contains a nul byte");
+        return nullptr;
+    }
+    return g_utf8_to_utf16(reinterpret_cast<const char*>(data), len, nullptr,
+                           n_chars, error);
+}
+
+// JSON.parseBytes(bytes): Like JSON.parse(ByteArray.toString(bytes)), for a
+// Uint8Array or GLib.Bytes of UTF-8 text, but decodes straight into a
+// temporary buffer for the parser instead of creating a string in the JS heap
+// that is only parsed once.
+GJS_JSAPI_RETURN_CONVENTION
+static bool parse_bytes_func(JSContext* cx, unsigned argc, JS::Value* vp) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+    JS::RootedObject bytes_obj(cx);
+    if (!gjs_parse_call_args(cx, "parseBytes", args, "o", "bytes", &bytes_obj))
+        return false;
+
+    GjsAutoUtf16 chars;
+    long n_chars = 0;
+    GError* error = nullptr;
+    if (JS_IsUint8Array(bytes_obj)) {
+        JS::AutoCheckCannotGC nogc;
+        bool is_shared_memory;
+        uint32_t len;
+        uint8_t* data;
+        js::GetUint8ArrayLengthAndData(bytes_obj, &len, &is_shared_memory,
+                                       &data);
+        chars = utf8_json_to_utf16(data, len, &n_chars, &error);
+    } else {
+        GBytes* gbytes = gbytes_for_boxed(cx, bytes_obj);
+        if (!gbytes) {
+            if (JS_IsExceptionPending(cx))
+                return false;
+            gjs_throw_custom(cx, JSProto_TypeError, nullptr,
+                             "Argument to JSON.parseBytes() must be a "
+                             "Uint8Array or GLib.Bytes");
+            return false;
+        }
+        size_t len;
+        auto* data = static_cast<const uint8_t*>(g_bytes_get_data(gbytes, &len));
+        chars = utf8_json_to_utf16(data, len, &n_chars, &error);
+    }
+
+    if (!chars)
+        return gjs_throw_gerror_message(cx, error);  // frees GError
+
+    if (n_chars > UINT32_MAX) {
+        JS_ReportOutOfMemory(cx);
+        return false;
+    }
+    return JS_ParseJSON(cx, reinterpret_cast<const char16_t*>(chars.get()),
+                        n_chars, args.rval());
+}
+
+// The JSON writer passes the whole text at once, as the engine builds it in a
+// buffer of its own. Leaves @data null if the text can't be encoded.
+static bool write_json_utf8(const char16_t* buf, uint32_t len, void* data) {
+    auto* utf8 = static_cast<GjsAutoChar*>(data);
+    *utf8 = g_utf16_to_utf8(reinterpret_cast<const gunichar2*>(buf), len,
+                            nullptr, nullptr, nullptr);
+    return true;
+}
+
+// JSON.stringifyToBytes(value, replacer, space): Like
+// ByteArray.fromString(JSON.stringify(value, replacer, space)), but encodes
+// the JSON text to UTF-8 without creating a string in the JS heap. Values that
+// JSON.stringify() would return undefined for give "null".
+GJS_JSAPI_RETURN_CONVENTION
+static bool stringify_to_bytes_func(JSContext* cx, unsigned argc,
+                                    JS::Value* vp) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+    if (!args.requireAtLeast(cx, "stringifyToBytes", 1))
+        return false;
+
+    JS::RootedValue value(cx, args[0]);
+    JS::RootedObject replacer(cx);
+    if (args.get(1).isObject())
+        replacer = &args[1].toObject();
+
+    GjsAutoChar utf8;
+    if (!JS_Stringify(cx, &value, replacer, args.get(2), write_json_utf8,
+                      &utf8))
+        return false;
+    if (!utf8) {
+        gjs_throw(cx, "Could not encode JSON text as UTF-8");
+        return false;
+    }
+
+    // The buffer is handed over to the JS engine, like in fromString()
+    size_t len = strlen(utf8);
+    JS::RootedObject array_buffer(
+        cx, JS::NewArrayBufferWithContents(cx, len, utf8.get()));
+    if (!array_buffer)
+        return false;
+    utf8.release();
+
+    JS::RootedObject obj(cx,
+                         JS_NewUint8ArrayWithBuffer(cx, array_buffer, 0, -1));
+    if (!obj)
+        return false;
+
+    const GjsAtoms& atoms = GjsContextPrivate::atoms(cx);
+    if (!JS_DefineFunctionById(cx, obj, atoms.to_string(),
+                               instance_to_string_func, 1, 0))
+        return false;
+
+    args.rval().setObject(*obj);
+    return true;
+}
+
+static JSFunctionSpec gjs_json_bytes_funcs[] = {
+    JS_FN("parseBytes", parse_bytes_func, 1, 0),
+    JS_FN("stringifyToBytes", stringify_to_bytes_func, 3, 0),
+    JS_FS_END};
+
+bool gjs_define_json_bytes_funcs(JSContext* cx, JS::HandleObject global) {
+    JS::RootedValue json(cx);
+    if (!JS_GetProperty(cx, global, "JSON", &json))
+        return false;
+    if (!json.isObject())
+        return true;
+
+    JS::RootedObject json_obj(cx, &json.toObject());
+    return JS_DefineFunctions(cx, json_obj, gjs_json_bytes_funcs);
+}
+
 static JSFunctionSpec gjs_byte_array_module_funcs[] = {
     JS_FN("fromString", from_string_func, 2, 0),
     JS_FN("fromGBytes", from_gbytes_func, 1, 0),
+    JS_FN("allocatePinned", allocate_pinned_func, 1, 0),
     JS_FN("toGBytes", to_gbytes_func, 1, 0),
     JS_FN("toString", to_string_func, 2, 0),
     JS_FS_END};
@@ -32,6 +32,8 @@
 
 #include <js/TypeDecls.h>
 
+struct JSStructuredCloneCallbacks;
+
 #include "cjs/macros.h"
 
 GJS_JSAPI_RETURN_CONVENTION
@@ -45,6 +47,36 @@ GJS_JSAPI_RETURN_CONVENTION
 JSObject *    gjs_byte_array_from_byte_array (JSContext  *context,
                                               GByteArray *array);
 
+// Ownership of the memory in conversions between Uint8Array and GBytes:
+// gjs_byte_array_from_gbytes() creates a Uint8Array that shares the memory of
+// the GBytes and keeps a reference to it. gjs_byte_array_get_bytes() on such
+// an array, or on any view into that memory, returns a GBytes that shares it
+// again and references the original. Round trips GBytes -> Uint8Array ->
+// GBytes therefore never copy. Any other Uint8Array's memory belongs to the JS
+// engine and is copied into the new GBytes.
+GJS_JSAPI_RETURN_CONVENTION
+JSObject* gjs_byte_array_from_gbytes(JSContext* cx, GBytes* bytes);
+
+// An ArrayBuffer sharing the memory of @bytes in the same way, for creating
+// other kinds of typed arrays on it
+GJS_JSAPI_RETURN_CONVENTION
+JSObject* gjs_array_buffer_from_gbytes(JSContext* cx, GBytes* bytes);
+
+// Structured clone hooks for passing bytes between JS contexts: GLib.Bytes can
+// be cloned, and GLib.Bytes and Uint8Arrays listed as transferables are passed
+// as GBytes references, so the receiver shares the memory of the sender.
+// Create the JSAutoStructuredCloneBuffer with these callbacks, so that unread
+// transfers are freed, and pass them again when reading, with the reading
+// context's GjsContextPrivate as closure, or null for a context without GI, in
+// which GLib.Bytes become Uint8Arrays.
+[[nodiscard]] const JSStructuredCloneCallbacks*
+gjs_byte_array_get_clone_callbacks();
+
+// Defines JSON.parseBytes() and JSON.stringifyToBytes(), which convert between
+// values and UTF-8 JSON text in a Uint8Array or GLib.Bytes
+GJS_JSAPI_RETURN_CONVENTION
+bool gjs_define_json_bytes_funcs(JSContext* cx, JS::HandleObject global);
+
 [[nodiscard]] GByteArray* gjs_byte_array_get_byte_array(JSObject* obj);
 [[nodiscard]] GBytes* gjs_byte_array_get_bytes(JSObject* obj);
 
@@ -0,0 +1,156 @@
+/* -*- mode: C++; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * SPDX-License-Identifier: MIT OR LGPL-2.0-or-later
+ */
+
+#include <config.h>
+
+#include <stddef.h>  // for size_t
+
+#include <glib.h>
+
+#include "cjs/cache-budget.h"
+#include "cjs/jsapi-util.h"
+#include "util/log.h"
+
+class GjsCacheBudget {
+ public:
+    GjsCacheEntry* m_first = nullptr;  // most recently used
+    GjsCacheEntry* m_last = nullptr;   // least recently used
+    size_t m_total = 0;
+    size_t m_limit = 0;
+    bool m_limit_set = false;
+    unsigned m_evict_id = 0;
+
+    size_t limit() {
+        if (!m_limit_set) {
+            const char* env = g_getenv("GJS_CACHE_BUDGET_KB");
+            if (env)
+                m_limit = g_ascii_strtoull(env, nullptr, 10) * 1024;
+            m_limit_set = true;
+        }
+        return m_limit;
+    }
+
+    void evict(GjsCacheEntry* entry) {
+        entry->m_evict(entry->m_owner);
+        entry->unlink();
+    }
+
+    void evict_over_budget() {
+        size_t limit = this->limit();
+        while (limit && m_total > limit && m_last)
+            evict(m_last);
+    }
+
+    // Called from the main loop with nothing else on the stack, unless a
+    // nested main loop is running. In that case the caches may be in use
+    // further down the stack, so wait for the next time one grows.
+    [[nodiscard]] static bool can_evict() { return g_main_depth() <= 1; }
+
+    static gboolean on_evict_idle(void*) {
+        GjsCacheBudget* self = get();
+        self->m_evict_id = 0;
+        if (!can_evict())
+            return G_SOURCE_REMOVE;
+
+        size_t before = self->m_total;
+        self->evict_over_budget();
+        gjs_debug(GJS_DEBUG_CONTEXT,
+                  "Emptied caches over budget, %zu -> %zu bytes", before,
+                  self->m_total);
+        return G_SOURCE_REMOVE;
+    }
+
+    void schedule_evict() {
+        if (m_evict_id)
+            return;
+        GjsAutoPointer<GSource, GSource, g_source_unref> source =
+            g_idle_source_new();
+        g_source_set_priority(source, G_PRIORITY_LOW);
+        g_source_set_callback(source, &GjsCacheBudget::on_evict_idle, nullptr,
+                              nullptr);
+        m_evict_id =
+            g_source_attach(source, g_main_context_get_thread_default());
+    }
+
+    static GjsCacheBudget* get() {
+        static thread_local GjsCacheBudget s_budget;
+        return &s_budget;
+    }
+};
+
+void GjsCacheEntry::link() {
+    GjsCacheBudget* budget = GjsCacheBudget::get();
+    m_prev = nullptr;
+    m_next = budget->m_first;
+    if (m_next)
+        m_next->m_prev = this;
+    else
+        budget->m_last = this;
+    budget->m_first = this;
+    m_linked = true;
+}
+
+void GjsCacheEntry::unlink() {
+    if (!m_linked)
+        return;
+
+    GjsCacheBudget* budget = GjsCacheBudget::get();
+    if (m_prev)
+        m_prev->m_next = m_next;
+    else
+        budget->m_first = m_next;
+    if (m_next)
+        m_next->m_prev = m_prev;
+    else
+        budget->m_last = m_prev;
+    m_prev = m_next = nullptr;
+    m_linked = false;
+    budget->m_total -= m_size;
+    m_size = 0;
+}
+
+void GjsCacheEntry::touch() {
+    GjsCacheBudget* budget = GjsCacheBudget::get();
+    if (budget->m_first == this || !m_linked)
+        return;
+    size_t size = m_size;
+    unlink();
+    link();
+    m_size = size;
+    budget->m_total += size;
+}
+
+void GjsCacheEntry::used(size_t size) {
+    GjsCacheBudget* budget = GjsCacheBudget::get();
+    if (m_linked && budget->m_first != this)
+        unlink();
+    if (!m_linked)
+        link();
+
+    budget->m_total = budget->m_total - m_size + size;
+    m_size = size;
+
+    size_t limit = budget->limit();
+    if (limit && budget->m_total > limit)
+        budget->schedule_evict();
+}
+
+size_t gjs_cache_budget_get_limit() { return GjsCacheBudget::get()->limit(); }
+
+void gjs_cache_budget_set_limit(size_t limit) {
+    GjsCacheBudget* budget = GjsCacheBudget::get();
+    budget->m_limit = limit;
+    budget->m_limit_set = true;
+}
+
+size_t gjs_cache_budget_get_total() { return GjsCacheBudget::get()->m_total; }
+
+void gjs_cache_budget_evict_all() {
+    GjsCacheBudget* budget = GjsCacheBudget::get();
+    if (!GjsCacheBudget::can_evict())
+        return;
+    while (budget->m_last)
+        budget->evict(budget->m_last);
+}
@@ -0,0 +1,71 @@
+/* -*- mode: C++; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * SPDX-License-Identifier: MIT OR LGPL-2.0-or-later
+ */
+
+#ifndef GJS_CACHE_BUDGET_H_
+#define GJS_CACHE_BUDGET_H_
+
+#include <config.h>
+
+#include <stddef.h>  // for size_t
+
+// cache-budget.h - Accounting for caches of introspection metadata that can be
+// rebuilt on demand, such as the field and property caches of prototypes.
+//
+// Each cache owns a GjsCacheEntry, reports its approximate size with used(),
+// and marks itself as recently used with touch(). If the total goes over the
+// budget set with GJS_CACHE_BUDGET_KB, the least recently used caches are
+// emptied, from an idle callback of the outermost main loop so that no
+// pointers into them can be held further up the stack. All of this happens
+// on the JS thread only; prototypes are finalized in the foreground.
+
+class GjsCacheEntry {
+ public:
+    // Must empty the cache; it is rebuilt as it's used again
+    using EvictFunc = void (*)(void* owner);
+
+ private:
+    friend class GjsCacheBudget;
+
+    EvictFunc m_evict;
+    void* m_owner;
+    GjsCacheEntry* m_prev = nullptr;  // more recently used
+    GjsCacheEntry* m_next = nullptr;  // less recently used
+    size_t m_size = 0;
+    bool m_linked = false;
+
+    void link();
+    void unlink();
+
+ public:
+    GjsCacheEntry(EvictFunc evict, void* owner)
+        : m_evict(evict), m_owner(owner) {}
+    ~GjsCacheEntry() { unlink(); }
+
+    GjsCacheEntry(const GjsCacheEntry&) = delete;
+    GjsCacheEntry& operator=(const GjsCacheEntry&) = delete;
+
+    // Records that the cache now takes about @size bytes, and was just used
+    void used(size_t size);
+
+    // Records that the cache was just used. Cheap enough for lookups, which
+    // mostly hit the cache used last.
+    void touch();
+
+    [[nodiscard]] size_t size() const { return m_size; }
+};
+
+// Budget in bytes, 0 for unlimited. Read from GJS_CACHE_BUDGET_KB the first
+// time it is needed, unless set before.
+[[nodiscard]] size_t gjs_cache_budget_get_limit();
+void gjs_cache_budget_set_limit(size_t limit);
+
+// Total size of all caches
+[[nodiscard]] size_t gjs_cache_budget_get_total();
+
+// Empties all caches right away, for when memory is low. Must be called from
+// the main loop, not from code that may be using the caches.
+void gjs_cache_budget_evict_all();
+
+#endif  // GJS_CACHE_BUDGET_H_
@@ -47,6 +47,8 @@ static char *command = NULL;
 static gboolean print_version = false;
 static gboolean print_js_version = false;
 static gboolean debugging = false;
+static gboolean exec_as_module = false;
+static char** breakpoints = nullptr;
 static bool enable_profiler = false;
 
 static gboolean parse_profile_arg(const char *, const char *, void *, GError **);
@@ -57,6 +59,7 @@ static GOptionEntry entries[] = {
     { "jsversion", 0, 0, G_OPTION_ARG_NONE, &print_js_version,
         "Print version of the JS engine and exit" },
     { "command", 'c', 0, G_OPTION_ARG_STRING, &command, "Program passed in as a string", "COMMAND" },
+    { "module", 'm', 0, G_OPTION_ARG_NONE, &exec_as_module, "Execute the file as an ES module" },
     { "coverage-prefix", 'C', 0, G_OPTION_ARG_STRING_ARRAY, &coverage_prefixes, "Add the prefix PREFIX to the list of files to generate coverage info for", "PREFIX" },
     { "coverage-output", 0, 0, G_OPTION_ARG_STRING, &coverage_output_path, "Write coverage output to a directory DIR. This option is mandatory when using --coverage-prefix", "DIR", },
     { "include-path", 'I', 0, G_OPTION_ARG_STRING_ARRAY, &include_path, "Add the directory DIR to the list of directories to search for js files.", "DIR" },
@@ -65,6 +68,9 @@ static GOptionEntry entries[] = {
         "Enable the profiler and write output to FILE (default: gjs-$PID.syscap)",
         "FILE" },
     { "debugger", 'd', 0, G_OPTION_ARG_NONE, &debugging, "Start in debug mode" },
+    { "break", 0, 0, G_OPTION_ARG_STRING_ARRAY, &breakpoints,
+        "Start in debug mode, only stopping at the breakpoint FILE:LINE and at debugger statements",
+        "FILE:LINE" },
     { NULL }
 };
 // clang-format on
@@ -179,7 +185,8 @@ check_script_args_for_stray_gjs_args(int           argc,
 
 int define_argv_and_eval_script(GjsContext* js_context, int argc,
                                 char* const* argv, const char* script,
-                                size_t len, const char* filename) {
+                                size_t len, const char* filename,
+                                bool is_module) {
     GError* error = nullptr;
 
     /* prepare command line arguments */
@@ -192,7 +199,11 @@ int define_argv_and_eval_script(GjsContext* js_context, int argc,
 
     /* evaluate the script */
     int code;
-    if (!gjs_context_eval(js_context, script, len, filename, &code, &error)) {
+    bool ok = is_module ? gjs_context_eval_module_file(js_context, filename,
+                                                       &code, &error)
+                        : gjs_context_eval(js_context, script, len, filename,
+                                           &code, &error);
+    if (!ok) {
         if (!g_error_matches(error, GJS_ERROR, GJS_ERROR_SYSTEM_EXIT))
             g_critical("%s", error->message);
         g_clear_error(&error);
@@ -259,6 +270,8 @@ main(int argc, char **argv)
     print_version = false;
     print_js_version = false;
     debugging = false;
+    exec_as_module = false;
+    breakpoints = nullptr;
     g_option_context_set_ignore_unknown_options(context, false);
     g_option_context_set_help_enabled(context, true);
     if (!g_option_context_parse_strv(context, &gjs_argv, &error)) {
@@ -370,12 +383,18 @@ main(int argc, char **argv)
     }
 
     /* If we're debugging, set up the debugger. It will break on the first
-     * frame. */
-    if (debugging)
+     * frame, unless it was only asked to stop at breakpoints. */
+    if (breakpoints) {
+        debugging = true;
+        gjs_context_setup_debugger_breakpoints(js_context, breakpoints);
+    } else if (debugging) {
         gjs_context_setup_debugger_console(js_context);
+    }
 
+    // --module only applies to a script file
+    bool is_module = exec_as_module && command == NULL && !interactive_mode;
     int code = define_argv_and_eval_script(js_context, script_argc, script_argv,
-                                           script, len, filename);
+                                           script, len, filename, is_module);
 
     g_strfreev(gjs_argv_addr);
 
@@ -386,6 +405,7 @@ main(int argc, char **argv)
     g_free(coverage_output_path);
     g_free(profile_output_path);
     g_strfreev(coverage_prefixes);
+    g_strfreev(breakpoints);
     if (coverage)
         g_object_unref(coverage);
     g_object_unref(js_context);
@@ -29,26 +29,35 @@
 #include <stdint.h>
 #include <sys/types.h>  // for ssize_t
 
+#include <string>
 #include <type_traits>  // for is_same
 #include <unordered_map>
+#include <unordered_set>
 
 #include <glib-object.h>
 #include <glib.h>
 
+#include <js/GCAPI.h>  // for JSGCInvocationKind
 #include <js/GCHashTable.h>
 #include <js/GCVector.h>
+#include <js/Id.h>
 #include <js/Promise.h>
 #include <js/RootingAPI.h>
 #include <js/TypeDecls.h>
 #include <js/ValueArray.h>
 #include <jsapi.h>        // for JS_GetContextPrivate
-#include <jsfriendapi.h>  // for ScriptEnvironmentPreparer
-#include <mozilla/HashTable.h>  // for DefaultHasher
+#include <jsfriendapi.h>  // for ScriptEnvironmentPreparer, JSID_IS_ATOM
+#include <mozilla/HashFunctions.h>  // for HashGeneric, HashNumber
+#include <mozilla/HashTable.h>      // for DefaultHasher
+#include <mozilla/Likely.h>         // for MOZ_LIKELY
 #include <mozilla/UniquePtr.h>
 
+#include "gi/call-stats.h"
 #include "cjs/context.h"
 #include "cjs/jsapi-util.h"
 #include "cjs/macros.h"
+#include "cjs/memory-monitor.h"
+#include "cjs/root-slots.h"
 #include "cjs/profiler.h"
 
 namespace js {
@@ -64,9 +73,49 @@ using ObjectInitList =
 using FundamentalTable =
     JS::GCHashMap<void*, JS::Heap<JSObject*>, js::DefaultHasher<void*>,
                   js::SystemAllocPolicy>;
+// Wrappers of reference-counted boxed types, by the pointer they hold a
+// reference on
+using BoxedTable =
+    JS::GCHashMap<void*, JS::Heap<JSObject*>, js::DefaultHasher<void*>,
+                  js::SystemAllocPolicy>;
+// Wrappers of cairo contexts marshalled from C, by the cairo_t they hold a
+// reference on
+using CairoContextTable =
+    JS::GCHashMap<void*, JS::Heap<JSObject*>, js::DefaultHasher<void*>,
+                  js::SystemAllocPolicy>;
+// Wrappers of GParamSpecs, by the GParamSpec they hold a reference on
+using ParamTable =
+    JS::GCHashMap<void*, JS::Heap<JSObject*>, js::DefaultHasher<void*>,
+                  js::SystemAllocPolicy>;
 using GTypeTable =
     JS::GCHashMap<GType, JS::Heap<JSObject*>, js::DefaultHasher<GType>,
                   js::SystemAllocPolicy>;
+// Prototypes of fundamental wrappers, by the GType they were looked up for,
+// which may be a type without introspection data
+using FundamentalPrototypeTable =
+    JS::GCHashMap<GType, JS::Heap<JSObject*>, js::DefaultHasher<GType>,
+                  js::SystemAllocPolicy>;
+// Prototypes of GError wrappers, by error domain
+using ErrorDomainTable =
+    JS::GCHashMap<GQuark, JS::Heap<JSObject*>, js::DefaultHasher<GQuark>,
+                  js::SystemAllocPolicy>;
+
+// See https://bugzilla.mozilla.org/show_bug.cgi?id=1614220
+struct IdHasher {
+    typedef jsid Lookup;
+    static mozilla::HashNumber hash(jsid id) {
+        if (MOZ_LIKELY(JSID_IS_ATOM(id)))
+            return js::DefaultHasher<JSAtom*>::hash(JSID_TO_ATOM(id));
+        if (JSID_IS_SYMBOL(id))
+            return js::DefaultHasher<JS::Symbol*>::hash(JSID_TO_SYMBOL(id));
+        return mozilla::HashGeneric(JSID_BITS(id));
+    }
+    static bool match(jsid id1, jsid id2) { return id1 == id2; }
+};
+
+// Names of atom ids, as interned C strings, for resolve hooks
+using IdNameTable = JS::GCHashMap<JS::Heap<jsid>, const char*, IdHasher,
+                                  js::SystemAllocPolicy>;
 
 struct Dummy {};
 using GTypeNotUint64 =
@@ -82,6 +131,8 @@ struct GCPolicy;
 
 template <>
 struct GCPolicy<void*> : public IgnoreGCPolicy<void*> {};
+template <>
+struct GCPolicy<const char*> : public IgnoreGCPolicy<const char*> {};
 // We need GCPolicy<GType> for GTypeTable. SpiderMonkey already defines
 // GCPolicy<uint64_t> which is equal to GType on some systems; for others we
 // need to define it. (macOS's uint64_t is unsigned long long, which is a
@@ -95,17 +146,27 @@ class GjsContextPrivate : public JS::JobQueue {
     JSContext* m_cx;
     JS::Heap<JSObject*> m_global;
     GThread* m_owner_thread;
+    GMainContext* m_owner_main_context;
+    // Context whose runtime this one was created as a child of, kept alive
+    // until this one is finalized, and then released on its own thread
+    GjsContext* m_parent_context;
 
     char* m_program_name;
 
     char** m_search_path;
 
     unsigned m_auto_gc_id;
+    unsigned m_gc_slice_id;
 
     GjsAtoms* m_atoms;
 
     JobQueueStorage m_job_queue;
     unsigned m_idle_drain_handler;
+    // Time slice for draining the job queue from the idle handler, or 0 to
+    // always drain it completely
+    int64_t m_job_queue_budget_usec;
+    // Default priority of the job queue source
+    int m_job_queue_priority;
 
     std::unordered_map<uint64_t, GjsAutoChar> m_unhandled_rejection_stacks;
 
@@ -126,13 +187,63 @@ class GjsContextPrivate : public JS::JobQueue {
 
     // Weak pointer mapping from fundamental native pointer to JSObject
     JS::WeakCache<FundamentalTable>* m_fundamental_table;
+    JS::WeakCache<BoxedTable>* m_boxed_table;
+    JS::WeakCache<CairoContextTable>* m_cairo_context_table;
+    JS::WeakCache<ParamTable>* m_param_table;
     JS::WeakCache<GTypeTable>* m_gtype_table;
+    JS::WeakCache<FundamentalPrototypeTable>* m_fundamental_prototype_table;
+    JS::WeakCache<ErrorDomainTable>* m_error_domain_table;
+    // Entries go away with their atoms; the names stay interned in GLib
+    JS::WeakCache<IdNameTable>* m_id_name_table;
 
     // List that holds JSObject GObject wrappers for JS-created classes, from
     // the time of their creation until their GObject instance init function is
     // called
     ObjectInitList m_object_init_list;
 
+    // Storage for the GC things rooted by GjsMaybeOwned
+    GjsRootSlots* m_root_slots;
+
+    GjsMemoryMonitor* m_memory_monitor;
+
+    // Introspection namespaces whose numeric C arrays are returned to JS as
+    // typed arrays instead of plain arrays
+    std::unordered_set<std::string> m_typed_array_namespaces;
+
+    // Introspection namespaces whose GHashTable return values with transfer
+    // none are wrapped in a GLibHashTableView instead of copied into an object
+    std::unordered_set<std::string> m_lazy_hash_table_namespaces;
+
+    // Introspection namespaces whose owned GList and GSList return values are
+    // wrapped in a GLibListIterator instead of copied into an array
+    std::unordered_set<std::string> m_list_iterator_namespaces;
+
+    // Introspection namespaces whose short ASCII string return values with
+    // transfer none are looked up in m_interned_strings
+    std::unordered_set<std::string> m_interned_string_namespaces;
+
+    // Direct-mapped cache of atoms, keyed on the address and contents of the C
+    // string that they were created from. Replaced entries are collected like
+    // any other string.
+    static constexpr size_t INTERNED_STRING_MAX_LENGTH = 32;
+    static constexpr size_t N_INTERNED_STRINGS = 256;
+    struct InternedString {
+        const char* ptr = nullptr;
+        JS::Heap<JSString*> atom;
+        uint8_t length = 0;
+        char chars[INTERNED_STRING_MAX_LENGTH];
+    };
+    InternedString m_interned_strings[N_INTERNED_STRINGS];
+
+    // Callsites, as formatted by warn_extra_args_once() in gi/function.cpp,
+    // that already got the "Too many arguments" warning
+    static constexpr size_t MAX_EXTRA_ARGS_CALLSITES = 1000;
+    std::unordered_set<std::string> m_extra_args_callsites;
+
+    // Scripts compiled with gjs_context_compile() that are still referenced;
+    // their JSScripts are traced from here, and detached on dispose
+    std::unordered_set<GjsScript*> m_scripts;
+
     uint8_t m_exit_code;
 
     /* flags */
@@ -143,19 +254,47 @@ class GjsContextPrivate : public JS::JobQueue {
     bool m_draining_job_queue : 1;
     bool m_should_profile : 1;
     bool m_should_listen_sigusr2 : 1;
+    bool m_debugger_attached : 1;
 
     int64_t m_sweep_begin_time;
 
+ public:
+    // Number and duration of garbage collections, which the profiler records
+    // as counters and System.gcStats() returns. Minor collections only collect
+    // the nursery. Major ones are timed per slice, since each slice is one
+    // pause of the JS thread.
+    struct GCStats {
+        uint64_t major_count = 0;
+        GjsCallStats major_slices;
+        GjsCallStats minor_collections;
+    };
+
+    // Called by m_memory_monitor; public so that tests can simulate it
+    static void on_memory_pressure(GjsMemoryPressure pressure, void* data);
+
+ private:
+    GCStats m_gc_stats;
+    int64_t m_gc_begin_time = 0;
+    int64_t m_minor_gc_begin_time = 0;
+
     void schedule_gc_internal(bool force_gc);
     static gboolean trigger_gc_if_needed(void* data);
+    void start_incremental_gc(JSGCInvocationKind kind, int64_t budget_ms);
+    static gboolean gc_slice_idle_handler(void* data);
 
     class SavedQueue;
     void start_draining_job_queue(void);
     void stop_draining_job_queue(void);
     static gboolean drain_job_queue_idle_handler(void* data);
+    void raise_job_queue_priority(int priority);
 
     void warn_about_unhandled_promise_rejections(void);
 
+    [[nodiscard]] bool start_auto_profile();
+    [[nodiscard]] bool finish_eval(bool ok, JS::HandleValue retval,
+                                   const char* filename, bool auto_profile,
+                                   int* exit_status_p, GError** error);
+
     class AutoResetExit {
         GjsContextPrivate* m_self;
 
@@ -188,28 +327,109 @@ class GjsContextPrivate : public JS::JobQueue {
     [[nodiscard]] JSContext* context() const { return m_cx; }
     [[nodiscard]] JSObject* global() const { return m_global.get(); }
     [[nodiscard]] GjsProfiler* profiler() const { return m_profiler; }
+    // Creates the profiler if the context was started without one, so that it
+    // can still be started later; returns null if another context has one
+    [[nodiscard]] GjsProfiler* ensure_profiler();
     [[nodiscard]] const GjsAtoms& atoms() const { return *m_atoms; }
     [[nodiscard]] bool destroying() const { return m_destroying; }
     [[nodiscard]] bool sweeping() const { return m_in_gc_sweep; }
+    [[nodiscard]] const GCStats& gc_stats() const { return m_gc_stats; }
     [[nodiscard]] const char* program_name() const { return m_program_name; }
     void set_program_name(char* value) { m_program_name = value; }
     void set_search_path(char** value) { m_search_path = value; }
+    void set_parent_context(GjsContext* value) { m_parent_context = value; }
+    [[nodiscard]] GjsContext* parent_context() const {
+        return m_parent_context;
+    }
     void set_should_profile(bool value) { m_should_profile = value; }
     void set_should_listen_sigusr2(bool value) {
         m_should_listen_sigusr2 = value;
     }
+    void set_debugger_attached() { m_debugger_attached = true; }
+    [[nodiscard]] bool debugger_attached() const { return m_debugger_attached; }
     [[nodiscard]] bool is_owner_thread() const {
         return m_owner_thread == g_thread_self();
     }
     [[nodiscard]] JS::WeakCache<FundamentalTable>& fundamental_table() {
         return *m_fundamental_table;
     }
+    [[nodiscard]] JS::WeakCache<BoxedTable>& boxed_table() {
+        return *m_boxed_table;
+    }
+    [[nodiscard]] JS::WeakCache<CairoContextTable>& cairo_context_table() {
+        return *m_cairo_context_table;
+    }
+    [[nodiscard]] JS::WeakCache<ParamTable>& param_table() {
+        return *m_param_table;
+    }
     [[nodiscard]] JS::WeakCache<GTypeTable>& gtype_table() {
         return *m_gtype_table;
     }
+    [[nodiscard]] JS::WeakCache<FundamentalPrototypeTable>&
+    fundamental_prototype_table() {
+        return *m_fundamental_prototype_table;
+    }
+    [[nodiscard]] JS::WeakCache<ErrorDomainTable>& error_domain_table() {
+        return *m_error_domain_table;
+    }
+    [[nodiscard]] JS::WeakCache<IdNameTable>& id_name_table() {
+        return *m_id_name_table;
+    }
     [[nodiscard]] ObjectInitList& object_init_list() {
         return m_object_init_list;
     }
+    template <typename T>
+    [[nodiscard]] GjsRootSlotTable<T>& root_slots() {
+        return m_root_slots->table<T>();
+    }
+    [[nodiscard]] bool typed_array_namespace(const char* ns) const {
+        return !m_typed_array_namespaces.empty() &&
+               m_typed_array_namespaces.count(ns) > 0;
+    }
+    void set_typed_array_namespace(const char* ns, bool enabled) {
+        if (enabled)
+            m_typed_array_namespaces.emplace(ns);
+        else
+            m_typed_array_namespaces.erase(ns);
+    }
+    [[nodiscard]] bool lazy_hash_table_namespace(const char* ns) const {
+        return !m_lazy_hash_table_namespaces.empty() &&
+               m_lazy_hash_table_namespaces.count(ns) > 0;
+    }
+    void set_lazy_hash_table_namespace(const char* ns, bool enabled) {
+        if (enabled)
+            m_lazy_hash_table_namespaces.emplace(ns);
+        else
+            m_lazy_hash_table_namespaces.erase(ns);
+    }
+    [[nodiscard]] bool list_iterator_namespace(const char* ns) const {
+        return !m_list_iterator_namespaces.empty() &&
+               m_list_iterator_namespaces.count(ns) > 0;
+    }
+    void set_list_iterator_namespace(const char* ns, bool enabled) {
+        if (enabled)
+            m_list_iterator_namespaces.emplace(ns);
+        else
+            m_list_iterator_namespaces.erase(ns);
+    }
+    [[nodiscard]] bool interned_string_namespace(const char* ns) const {
+        return !m_interned_string_namespaces.empty() &&
+               m_interned_string_namespaces.count(ns) > 0;
+    }
+    void set_interned_string_namespace(const char* ns, bool enabled) {
+        if (enabled)
+            m_interned_string_namespaces.emplace(ns);
+        else
+            m_interned_string_namespaces.erase(ns);
+    }
+    // Returns false if @callsite was already recorded. Forgets everything
+    // when full, so that a program that keeps generating code doesn't grow the
+    // set forever, at the cost of repeating some warnings.
+    [[nodiscard]] bool record_extra_args_callsite(std::string&& callsite) {
+        if (m_extra_args_callsites.size() >= MAX_EXTRA_ARGS_CALLSITES)
+            m_extra_args_callsites.clear();
+        return m_extra_args_callsites.insert(std::move(callsite)).second;
+    }
     [[nodiscard]] static const GjsAtoms& atoms(JSContext* cx) {
         return *(from_cx(cx)->m_atoms);
     }
@@ -217,17 +437,39 @@ class GjsContextPrivate : public JS::JobQueue {
     GJS_JSAPI_RETURN_CONVENTION
     bool eval(const char* script, ssize_t script_len, const char* filename,
               int* exit_status_p, GError** error);
+    [[nodiscard]] bool eval_module(const char* uri, int* exit_status_p,
+                                   GError** error);
     GJS_JSAPI_RETURN_CONVENTION
     bool eval_with_scope(JS::HandleObject scope_object, const char* script,
                          ssize_t script_len, const char* filename,
                          JS::MutableHandleValue retval);
     GJS_JSAPI_RETURN_CONVENTION
+    JSScript* compile(const char* script, ssize_t script_len,
+                      const char* filename);
+    GJS_JSAPI_RETURN_CONVENTION
+    bool execute_with_scope(JS::HandleObject scope_object,
+                            JS::HandleScript compiled,
+                            JS::MutableHandleValue retval);
+    [[nodiscard]] GjsScript* compile_script(const char* script,
+                                            ssize_t script_len,
+                                            const char* filename,
+                                            GError** error);
+    [[nodiscard]] bool run_script(GjsScript* script, int* exit_status_p,
+                                  GError** error);
+    void forget_script(GjsScript* script) { m_scripts.erase(script); }
+    GJS_JSAPI_RETURN_CONVENTION
     bool call_function(JS::HandleObject this_obj, JS::HandleValue func_val,
                        const JS::HandleValueArray& args,
                        JS::MutableHandleValue rval);
 
+    GJS_JSAPI_RETURN_CONVENTION
+    bool string_from_utf8_interned(const char* utf8_string,
+                                   JS::MutableHandleValue value_p);
+
     void schedule_gc(void) { schedule_gc_internal(true); }
     void schedule_gc_if_needed(void);
+    bool run_gc_slice(int64_t budget_ms);
+    void gc(GjsGCFlags flags, int64_t budget_ms);
 
     void exit(uint8_t exit_code);
     [[nodiscard]] bool should_exit(uint8_t* exit_code_p) const;
@@ -245,11 +487,15 @@ class GjsContextPrivate : public JS::JobQueue {
     js::UniquePtr<JS::JobQueue::SavedJobQueue> saveJobQueue(
         JSContext* cx) override;
 
-    GJS_JSAPI_RETURN_CONVENTION bool run_jobs_fallible(void);
+    GJS_JSAPI_RETURN_CONVENTION bool run_jobs_fallible(int64_t budget_usec = 0);
+    void set_job_queue_priority(int priority);
     void register_unhandled_promise_rejection(uint64_t id, GjsAutoChar&& stack);
     void unregister_unhandled_promise_rejection(uint64_t id);
 
     void set_sweeping(bool value);
+    void set_collecting(bool value);
+    void finish_collection();
+    void set_collecting_nursery(bool value);
 
     static void trace(JSTracer* trc, void* data);
 
@@ -26,7 +26,7 @@
 #include <signal.h>  // for sigaction, SIGUSR1, sa_handler
 #include <stdint.h>
 #include <stdio.h>      // for FILE, fclose, size_t
-#include <string.h>     // for memset
+#include <string.h>     // for memset, memcmp, memcpy
 
 #ifdef HAVE_UNISTD_H
 #    include <unistd.h>  // for getpid
@@ -35,10 +35,10 @@
 #endif
 
 #include <new>
-#include <string>       // for u16string
+#include <string>
 #include <type_traits>  // for remove_reference<>::type
 #include <unordered_map>
-#include <utility>  // for move
+#include <utility>  // for exchange, move
 #include <vector>
 
 #include <gio/gio.h>
@@ -61,7 +61,6 @@
 #include <js/Promise.h>             // for JobQueue::SavedJobQueue
 #include <js/PropertyDescriptor.h>  // for JSPROP_PERMANENT, JSPROP_RE...
 #include <js/RootingAPI.h>
-#include <js/SourceText.h>
 #include <js/TracingAPI.h>
 #include <js/TypeDecls.h>
 #include <js/UniquePtr.h>
@@ -70,24 +69,33 @@
 #include <js/ValueArray.h>
 #include <jsapi.h>        // for JS_IsExceptionPending, ...
 #include <jsfriendapi.h>  // for DumpHeap, IgnoreNurseryObjects
+#include <mozilla/HashFunctions.h>  // for HashGeneric
 #include <mozilla/UniquePtr.h>
 
+#include "gi/function.h"
+#include "gi/listiterator.h"
 #include "gi/object.h"
 #include "gi/private.h"
 #include "gi/repo.h"
 #include "cjs/atoms.h"
 #include "cjs/byteArray.h"
+#include "cjs/cache-budget.h"
 #include "cjs/context-private.h"
 #include "cjs/context.h"
 #include "cjs/engine.h"
 #include "cjs/error-types.h"
+#include "cjs/esm.h"
 #include "cjs/global.h"
+#include "cjs/heap-snapshot.h"
 #include "cjs/importer.h"
+#include "cjs/inspector.h"
 #include "cjs/jsapi-util.h"
 #include "cjs/mem.h"
 #include "cjs/native.h"
 #include "cjs/profiler-private.h"
 #include "cjs/profiler.h"
+#include "cjs/script-cache.h"
+#include "modules/format.h"
 #include "modules/modules.h"
 #include "util/log.h"
 
@@ -122,6 +130,22 @@ struct _GjsContextClass {
 
 G_DEFINE_TYPE_WITH_PRIVATE(GjsContext, gjs_context, G_TYPE_OBJECT);
 
+struct _GjsScript {
+    grefcount ref_count;
+    // Not owned; cleared when the context is disposed
+    GjsContextPrivate* gjs;
+    JS::Heap<JSScript*> script;
+    GjsAutoChar filename;
+
+    _GjsScript(GjsContextPrivate* gjs_, JSScript* script_,
+               const char* filename_)
+        : gjs(gjs_), script(script_), filename(g_strdup(filename_)) {
+        g_ref_count_init(&ref_count);
+    }
+};
+
+G_DEFINE_BOXED_TYPE(GjsScript, gjs_script, gjs_script_ref, gjs_script_unref);
+
 GjsContextPrivate* GjsContextPrivate::from_object(GObject* js_context) {
     g_return_val_if_fail(GJS_IS_CONTEXT(js_context), nullptr);
     return static_cast<GjsContextPrivate*>(
@@ -144,6 +168,7 @@ enum {
     PROP_PROGRAM_NAME,
     PROP_PROFILER_ENABLED,
     PROP_PROFILER_SIGUSR2,
+    PROP_PARENT_CONTEXT,
 };
 
 static GMutex contexts_lock;
@@ -151,6 +176,9 @@ static GList *all_contexts = NULL;
 
 static GjsAutoChar dump_heap_output;
 static unsigned dump_heap_idle_id = 0;
+static bool dump_heap_snapshot = false;
+static GjsHeapSnapshotFilter dump_heap_snapshot_filter =
+    GjsHeapSnapshotFilter::ALL;
 
 #ifdef G_OS_UNIX
 /* Currently heap dumping is only supported on UNIX platforms! */
@@ -172,7 +200,13 @@ gjs_context_dump_heaps(void)
 
     for (GList *l = all_contexts; l; l = g_list_next(l)) {
         auto* gjs = static_cast<GjsContextPrivate*>(l->data);
-        js::DumpHeap(gjs->context(), fp, js::IgnoreNurseryObjects);
+        if (!dump_heap_snapshot) {
+            js::DumpHeap(gjs->context(), fp, js::IgnoreNurseryObjects);
+        } else if (!gjs_write_heap_snapshot(gjs->context(), fp,
+                                            dump_heap_snapshot_filter)) {
+            g_warning("Failed to write heap snapshot to %s", filename.get());
+            break;
+        }
     }
 
     fclose(fp);
@@ -208,6 +242,14 @@ setup_dump_heap(void)
 
             dump_heap_output = g_strdup(heap_output);
 
+            const char* heap_format = g_getenv("GJS_DEBUG_HEAP_FORMAT");
+            if (g_strcmp0(heap_format, "snapshot") == 0) {
+                dump_heap_snapshot = true;
+            } else if (g_strcmp0(heap_format, "snapshot-wrappers") == 0) {
+                dump_heap_snapshot = true;
+                dump_heap_snapshot_filter = GjsHeapSnapshotFilter::GI_WRAPPERS;
+            }
+
             memset(&sa, 0, sizeof(sa));
             sa.sa_handler = dump_heap_signal_handler;
             sigaction(SIGUSR1, &sa, nullptr);
@@ -293,6 +335,27 @@ gjs_context_class_init(GjsContextClass *klass)
     g_object_class_install_property(object_class, PROP_PROFILER_SIGUSR2, pspec);
     g_param_spec_unref(pspec);
 
+    /**
+     * GjsContext:parent-context:
+     *
+     * Set this property to a context running on another thread, to create
+     * this context's JS runtime as a child of that context's runtime. The
+     * runtimes then share immutable data such as the engine's self-hosted
+     * code and permanent atoms, so that the new context starts faster and
+     * uses less memory.
+     *
+     * The new context keeps a reference to the parent context, which it drops
+     * from the parent's main context when it is finalized. The parent must
+     * still be disposed on its own thread after all of its children have been
+     * finalized.
+     */
+    pspec = g_param_spec_object("parent-context", "Parent context",
+                                "Context whose JS runtime to share data with",
+                                GJS_TYPE_CONTEXT,
+                                GParamFlags(G_PARAM_WRITABLE | G_PARAM_CONSTRUCT_ONLY));
+    g_object_class_install_property(object_class, PROP_PARENT_CONTEXT, pspec);
+    g_param_spec_unref(pspec);
+
     /* For GjsPrivate */
     {
 #ifdef G_OS_WIN32
@@ -320,6 +383,47 @@ void GjsContextPrivate::trace(JSTracer* trc, void* data) {
     gjs->m_atoms->trace(trc);
     gjs->m_job_queue.trace(trc);
     gjs->m_object_init_list.trace(trc);
+    gjs->m_root_slots->trace(trc);
+    for (InternedString& entry : gjs->m_interned_strings)
+        JS::TraceEdge(trc, &entry.atom, "GJS interned string");
+    for (GjsScript* script : gjs->m_scripts)
+        JS::TraceEdge(trc, &script->script, "GJS compiled script");
+}
+
+// Converts a string returned from C to a JS string like gjs_string_from_utf8(),
+// but if it is short and ASCII-only, reuses the atom that was created the last
+// time the same string was returned from the same address. Many functions
+// return the same static strings over and over (names, style classes, icon
+// names), and this avoids allocating a new JSString each time.
+bool GjsContextPrivate::string_from_utf8_interned(
+    const char* utf8_string, JS::MutableHandleValue value_p) {
+    size_t length = 0;
+    for (; utf8_string[length] != '\0'; length++) {
+        if (length == INTERNED_STRING_MAX_LENGTH ||
+            static_cast<unsigned char>(utf8_string[length]) >= 0x80)
+            return gjs_string_from_utf8(m_cx, utf8_string, value_p);
+    }
+
+    InternedString& entry =
+        m_interned_strings[mozilla::HashGeneric(utf8_string) %
+                           N_INTERNED_STRINGS];
+    if (entry.ptr == utf8_string && entry.length == length && entry.atom &&
+        memcmp(entry.chars, utf8_string, length) == 0) {
+        value_p.setString(entry.atom);
+        return true;
+    }
+
+    JSString* atom = JS_AtomizeStringN(m_cx, utf8_string, length);
+    if (!atom)
+        return false;
+
+    entry.ptr = utf8_string;
+    entry.length = length;
+    memcpy(entry.chars, utf8_string, length);
+    entry.atom = atom;
+
+    value_p.setString(atom);
+    return true;
 }
 
 void GjsContextPrivate::warn_about_unhandled_promise_rejections(void) {
@@ -342,6 +446,8 @@ gjs_context_dispose(GObject *object)
 
     GjsContextPrivate* gjs = GjsContextPrivate::from_object(object);
 
+    gjs_inspector_teardown(GJS_CONTEXT(object));
+
     /* Profiler must be stopped and freed before context is shut down */
     gjs->free_profiler();
 
@@ -361,6 +467,12 @@ gjs_context_dispose(GObject *object)
     gjs->dispose();
 }
 
+GjsProfiler* GjsContextPrivate::ensure_profiler() {
+    if (!m_profiler)
+        m_profiler = _gjs_profiler_new(m_public_context);
+    return m_profiler;
+}
+
 void GjsContextPrivate::free_profiler(void) {
     gjs_debug(GJS_DEBUG_CONTEXT, "Stopping profiler");
     if (m_profiler)
@@ -368,14 +480,39 @@ void GjsContextPrivate::free_profiler(void) {
 }
 
 void GjsContextPrivate::dispose(void) {
+    delete m_memory_monitor;
+    m_memory_monitor = nullptr;
+
     if (m_cx) {
         gjs_debug(GJS_DEBUG_CONTEXT,
                   "Checking unhandled promise rejections");
         warn_about_unhandled_promise_rejections();
 
+        gjs_debug(GJS_DEBUG_CONTEXT, "Cancelling unused prefetched scripts");
+        gjs_cancel_prefetched_scripts(m_cx);
+
+        gjs_debug(GJS_DEBUG_CONTEXT, "Abandoning dynamic module imports");
+        gjs_cancel_module_loads(m_cx);
+
+        gjs_debug(GJS_DEBUG_CONTEXT, "Waiting for calls in threads");
+        gjs_cancel_threaded_calls(m_cx);
+
         gjs_debug(GJS_DEBUG_CONTEXT, "Releasing cached JS wrappers");
         m_fundamental_table->clear();
+        m_boxed_table->clear();
+        m_cairo_context_table->clear();
+        m_param_table->clear();
         m_gtype_table->clear();
+        m_fundamental_prototype_table->clear();
+        m_error_domain_table->clear();
+        m_id_name_table->clear();
+
+        gjs_debug(GJS_DEBUG_CONTEXT, "Detaching compiled scripts");
+        for (GjsScript* script : m_scripts) {
+            script->script = nullptr;
+            script->gjs = nullptr;
+        }
+        m_scripts.clear();
 
         /* Do a full GC here before tearing down, since once we do
          * that we may not have the JS_GetPrivate() to access the
@@ -383,6 +520,7 @@ void GjsContextPrivate::dispose(void) {
          */
         gjs_debug(GJS_DEBUG_CONTEXT, "Final triggered GC");
         JS_GC(m_cx);
+        gjs_list_iterator_release_pending();
 
         gjs_debug(GJS_DEBUG_CONTEXT, "Destroying JS context");
         m_destroying = true;
@@ -399,6 +537,10 @@ void GjsContextPrivate::dispose(void) {
             g_source_remove(m_auto_gc_id);
             m_auto_gc_id = 0;
         }
+        if (m_gc_slice_id > 0) {
+            g_source_remove(m_gc_slice_id);
+            m_gc_slice_id = 0;
+        }
 
         gjs_debug(GJS_DEBUG_CONTEXT, "Ending trace on global object");
         JS_RemoveExtraGCRootsTracer(m_cx, &GjsContextPrivate::trace, this);
@@ -406,8 +548,15 @@ void GjsContextPrivate::dispose(void) {
 
         gjs_debug(GJS_DEBUG_CONTEXT, "Freeing allocated resources");
         delete m_fundamental_table;
+        delete m_boxed_table;
+        delete m_cairo_context_table;
+        delete m_param_table;
         delete m_gtype_table;
+        delete m_fundamental_prototype_table;
+        delete m_error_domain_table;
+        delete m_id_name_table;
         delete m_atoms;
+        delete m_root_slots;
 
         /* Tear down JS */
         JS_DestroyContext(m_cx);
@@ -421,6 +570,23 @@ void GjsContextPrivate::dispose(void) {
 GjsContextPrivate::~GjsContextPrivate(void) {
     g_clear_pointer(&m_search_path, g_strfreev);
     g_clear_pointer(&m_program_name, g_free);
+
+    // The parent is disposed on its own thread, so the reference that may be
+    // its last is dropped there too
+    if (m_parent_context) {
+        GjsContextPrivate* parent = from_object(m_parent_context);
+        GjsAutoPointer<GSource, GSource, g_source_unref> source =
+            g_idle_source_new();
+        g_source_set_callback(
+            source,
+            [](void* data) {
+                g_object_unref(data);
+                return G_SOURCE_REMOVE;
+            },
+            std::exchange(m_parent_context, nullptr), nullptr);
+        g_source_attach(source, parent->m_owner_main_context);
+    }
+    g_main_context_unref(m_owner_main_context);
 }
 
 static void
@@ -446,7 +612,15 @@ gjs_context_constructed(GObject *object)
     G_OBJECT_CLASS(gjs_context_parent_class)->constructed(object);
 
     GjsContextPrivate* gjs_location = GjsContextPrivate::from_object(object);
-    JSContext* cx = gjs_create_js_context(gjs_location);
+    JSRuntime* parent_runtime = nullptr;
+    if (gjs_location->parent_context()) {
+        GjsContextPrivate* parent =
+            GjsContextPrivate::from_object(gjs_location->parent_context());
+        g_assert(!parent->is_owner_thread() &&
+                 "A parent context must run on another thread");
+        parent_runtime = JS_GetRuntime(parent->context());
+    }
+    JSContext* cx = gjs_create_js_context(gjs_location, parent_runtime);
     if (!cx)
         g_error("Failed to create javascript context");
 
@@ -457,6 +631,10 @@ gjs_context_constructed(GObject *object)
     g_mutex_unlock(&contexts_lock);
 
     setup_dump_heap();
+    gjs_inspector_setup(js_context);
+
+    m_memory_monitor =
+        new GjsMemoryMonitor(&GjsContextPrivate::on_memory_pressure, this);
 
     g_object_weak_ref(object, &ObjectInstance::context_dispose_notify, nullptr);
 }
@@ -466,6 +644,12 @@ GjsContextPrivate::GjsContextPrivate(JSContext* cx, GjsContext* public_context)
       m_cx(cx),
       m_environment_preparer(cx) {
     m_owner_thread = g_thread_self();
+    m_owner_main_context = g_main_context_ref_thread_default();
+
+    const char* env_budget = g_getenv("GJS_JOB_QUEUE_BUDGET_MS");
+    if (env_budget)
+        m_job_queue_budget_usec =
+            g_ascii_strtoll(env_budget, nullptr, 10) * G_TIME_SPAN_MILLISECOND;
 
     const char *env_profiler = g_getenv("GJS_ENABLE_PROFILER");
     if (env_profiler || m_should_listen_sigusr2)
@@ -484,9 +668,17 @@ GjsContextPrivate::GjsContextPrivate(JSContext* cx, GjsContext* public_context)
 
     JSRuntime* rt = JS_GetRuntime(m_cx);
     m_fundamental_table = new JS::WeakCache<FundamentalTable>(rt);
+    m_boxed_table = new JS::WeakCache<BoxedTable>(rt);
+    m_cairo_context_table = new JS::WeakCache<CairoContextTable>(rt);
+    m_param_table = new JS::WeakCache<ParamTable>(rt);
     m_gtype_table = new JS::WeakCache<GTypeTable>(rt);
+    m_fundamental_prototype_table =
+        new JS::WeakCache<FundamentalPrototypeTable>(rt);
+    m_error_domain_table = new JS::WeakCache<ErrorDomainTable>(rt);
+    m_id_name_table = new JS::WeakCache<IdNameTable>(rt);
 
     m_atoms = new GjsAtoms();
+    m_root_slots = new GjsRootSlots();
 
     JS::RootedObject global(
         m_cx, gjs_create_global_object(cx, GjsGlobalType::DEFAULT));
@@ -568,6 +760,9 @@ gjs_context_set_property (GObject      *object,
     case PROP_PROFILER_SIGUSR2:
         gjs->set_should_listen_sigusr2(g_value_get_boolean(value));
         break;
+    case PROP_PARENT_CONTEXT:
+        gjs->set_parent_context(GJS_CONTEXT(g_value_dup_object(value)));
+        break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
         break;
@@ -589,21 +784,127 @@ gjs_context_new_with_search_path(char** search_path)
                          NULL);
 }
 
+// Budget for each slice of a GC that isn't driven by the embedder through
+// gjs_context_run_gc_slice(), small enough not to miss a frame
+static constexpr int64_t IDLE_GC_SLICE_BUDGET_MS = 5;
+
 gboolean GjsContextPrivate::trigger_gc_if_needed(void* data) {
     auto* gjs = static_cast<GjsContextPrivate*>(data);
     gjs->m_auto_gc_id = 0;
 
+    // Rather than blocking the main loop for a whole collection, run it in
+    // slices between main loop iterations. This only happens after the
+    // program has been idle for a while, so also compact the heap, which gives
+    // long-running programs back the memory of fragmented arenas.
     if (gjs->m_force_gc) {
         gjs_debug_lifecycle(GJS_DEBUG_CONTEXT, "Big Hammer hit");
-        JS_GC(gjs->m_cx);
+        gjs->start_incremental_gc(GC_SHRINK, IDLE_GC_SLICE_BUDGET_MS);
     } else {
-        gjs_gc_if_needed(gjs->m_cx);
+        JS_MaybeGC(gjs->m_cx);
     }
     gjs->m_force_gc = false;
 
     return G_SOURCE_REMOVE;
 }
 
+// Starts a full GC with a first slice of at most @budget_ms, unless one is
+// already in progress, and lets idle callbacks finish it
+void GjsContextPrivate::start_incremental_gc(JSGCInvocationKind kind,
+                                             int64_t budget_ms) {
+    if (!JS::IsIncrementalGCInProgress(m_cx)) {
+        JS::PrepareForFullGC(m_cx);
+        JS::StartIncrementalGC(m_cx, kind, JS::GCReason::API, budget_ms);
+    }
+
+    if (JS::IsIncrementalGCInProgress(m_cx) && !m_gc_slice_id)
+        m_gc_slice_id = g_idle_add_full(G_PRIORITY_LOW, gc_slice_idle_handler,
+                                        this, nullptr);
+}
+
+gboolean GjsContextPrivate::gc_slice_idle_handler(void* data) {
+    auto* gjs = static_cast<GjsContextPrivate*>(data);
+    if (gjs->run_gc_slice(IDLE_GC_SLICE_BUDGET_MS))
+        return G_SOURCE_CONTINUE;
+
+    gjs->m_gc_slice_id = 0;
+    return G_SOURCE_REMOVE;
+}
+
+/*
+ * GjsContextPrivate::run_gc_slice:
+ *
+ * Advances an incremental GC in progress by one slice of at most @budget_ms.
+ * Returns whether the GC is still in progress afterwards.
+ */
+bool GjsContextPrivate::run_gc_slice(int64_t budget_ms) {
+    if (!JS::IsIncrementalGCInProgress(m_cx))
+        return false;
+
+    JS::PrepareForIncrementalGC(m_cx);
+    JS::IncrementalGCSlice(m_cx, JS::GCReason::API, budget_ms);
+    return JS::IsIncrementalGCInProgress(m_cx);
+}
+
+/*
+ * GjsContextPrivate::gc:
+ *
+ * Runs the kind of GC that @flags asks for, as System.gc() and
+ * gjs_context_gc_with_flags() do. @budget_ms is the length of the first slice
+ * of an incremental GC, or 0 for the default.
+ */
+void GjsContextPrivate::gc(GjsGCFlags flags, int64_t budget_ms) {
+    if (flags & GJS_GC_FLAGS_MINOR) {
+        JS::MaybeRunNurseryCollection(JS_GetRuntime(m_cx), JS::GCReason::API);
+        return;
+    }
+
+    JSGCInvocationKind kind =
+        (flags & GJS_GC_FLAGS_SHRINK) ? GC_SHRINK : GC_NORMAL;
+    if (flags & GJS_GC_FLAGS_INCREMENTAL) {
+        start_incremental_gc(
+            kind, budget_ms > 0 ? budget_ms : IDLE_GC_SLICE_BUDGET_MS);
+        return;
+    }
+
+    JS::PrepareForFullGC(m_cx);
+    JS::NonIncrementalGC(m_cx, kind, JS::GCReason::API);
+}
+
+/*
+ * GjsContextPrivate::on_memory_pressure:
+ *
+ * Frees what can be freed when the system or the process's cgroup is low on
+ * memory: internal caches, and then unused JS memory, by compacting the heap.
+ * Under moderate pressure the GC runs in slices from the main loop as usual;
+ * under critical pressure it runs to completion right away.
+ */
+void GjsContextPrivate::on_memory_pressure(GjsMemoryPressure pressure,
+                                           void* data) {
+    auto* gjs = static_cast<GjsContextPrivate*>(data);
+    if (gjs->m_destroying)
+        return;
+
+    gjs_cache_budget_evict_all();
+    gjs_callback_trampoline_clear_pool();
+    gjs_importer_free_directory_cache();
+    gjs_format_clear_cache();
+
+    if (pressure == GjsMemoryPressure::MODERATE) {
+        gjs->start_incremental_gc(GC_SHRINK, IDLE_GC_SLICE_BUDGET_MS);
+        return;
+    }
+
+    // Scripts compiled ahead of time on the off chance that they are imported
+    // can be compiled again if they are
+    gjs_cancel_prefetched_scripts(gjs->m_cx);
+
+    JS::PrepareForFullGC(gjs->m_cx);
+    if (JS::IsIncrementalGCInProgress(gjs->m_cx))
+        JS::FinishIncrementalGC(gjs->m_cx, JS::GCReason::MEM_PRESSURE);
+    else
+        JS::NonIncrementalGC(gjs->m_cx, GC_SHRINK, JS::GCReason::MEM_PRESSURE);
+}
+
 void GjsContextPrivate::schedule_gc_internal(bool force_gc) {
     m_force_gc |= force_gc;
 
@@ -652,6 +953,30 @@ void GjsContextPrivate::set_sweeping(bool value) {
     m_in_gc_sweep = value;
 }
 
+void GjsContextPrivate::set_collecting(bool value) {
+    int64_t now = g_get_monotonic_time() * 1000L;
+
+    if (value) {
+        m_gc_begin_time = now;
+    } else if (m_gc_begin_time != 0) {
+        m_gc_stats.major_slices.add(now - m_gc_begin_time);
+        m_gc_begin_time = 0;
+    }
+}
+
+void GjsContextPrivate::finish_collection() { m_gc_stats.major_count++; }
+
+void GjsContextPrivate::set_collecting_nursery(bool value) {
+    int64_t now = g_get_monotonic_time() * 1000L;
+
+    if (value) {
+        m_minor_gc_begin_time = now;
+    } else if (m_minor_gc_begin_time != 0) {
+        m_gc_stats.minor_collections.add(now - m_minor_gc_begin_time);
+        m_minor_gc_begin_time = 0;
+    }
+}
+
 void GjsContextPrivate::exit(uint8_t exit_code) {
     g_assert(!m_should_exit);
     m_should_exit = true;
@@ -665,9 +990,46 @@ bool GjsContextPrivate::should_exit(uint8_t* exit_code_p) const {
 }
 
 void GjsContextPrivate::start_draining_job_queue(void) {
+    if (m_idle_drain_handler)
+        return;
+
+    GSource* source = g_idle_source_new();
+    g_source_set_priority(source, m_job_queue_priority);
+    g_source_set_name(source, "[gjs] promise job queue");
+    g_source_set_callback(source, drain_job_queue_idle_handler, this, nullptr);
+    m_idle_drain_handler = g_source_attach(source, nullptr);
+    g_source_unref(source);
+}
+
+/*
+ * GjsContextPrivate::raise_job_queue_priority:
+ *
+ * Makes the job queue source dispatch at @priority if that is more urgent
+ * than its current priority. The jobs still run in the order they were
+ * enqueued; only the position of the whole queue relative to the other main
+ * loop sources changes. The source goes back to the context's default
+ * priority once the queue has been drained.
+ */
+void GjsContextPrivate::raise_job_queue_priority(int priority) {
     if (!m_idle_drain_handler)
-        m_idle_drain_handler = g_idle_add_full(
-            G_PRIORITY_DEFAULT, drain_job_queue_idle_handler, this, nullptr);
+        return;
+
+    GSource* source = g_main_context_find_source_by_id(nullptr,
+                                                       m_idle_drain_handler);
+    if (source && priority < g_source_get_priority(source))
+        g_source_set_priority(source, priority);
+}
+
+void GjsContextPrivate::set_job_queue_priority(int priority) {
+    m_job_queue_priority = priority;
+
+    if (!m_idle_drain_handler)
+        return;
+
+    GSource* source = g_main_context_find_source_by_id(nullptr,
+                                                       m_idle_drain_handler);
+    if (source)
+        g_source_set_priority(source, priority);
 }
 
 void GjsContextPrivate::stop_draining_job_queue(void) {
@@ -680,11 +1042,30 @@ void GjsContextPrivate::stop_draining_job_queue(void) {
 
 gboolean GjsContextPrivate::drain_job_queue_idle_handler(void* data) {
     auto* gjs = static_cast<GjsContextPrivate*>(data);
-    gjs->runJobs(gjs->context());
     /* Uncatchable exceptions are swallowed here - no way to get a handle on
      * the main loop to exit it from this idle handler */
-    g_assert(gjs->empty() && gjs->m_idle_drain_handler == 0 &&
-             "GjsContextPrivate::runJobs() should have emptied queue");
+    if (!gjs->run_jobs_fallible(gjs->m_job_queue_budget_usec))
+        gjs_log_exception(gjs->context());
+
+    // Nothing runs while exiting, so the source would dispatch again right
+    // away; the jobs are left for start_draining_job_queue() if the exit is
+    // reset
+    if (gjs->m_should_exit) {
+        gjs->m_idle_drain_handler = 0;
+        return G_SOURCE_REMOVE;
+    }
+
+    // If the time budget ran out before the queue was drained, the source
+    // stays installed so that the remaining jobs run on the next iteration of
+    // the main loop, after other sources of the same priority have had a turn
+    if (gjs->m_idle_drain_handler != 0) {
+        g_assert(!gjs->empty() &&
+                 "GjsContextPrivate::run_jobs_fallible() yielded with no jobs");
+        return G_SOURCE_CONTINUE;
+    }
+
+    g_assert(gjs->empty() &&
+             "GjsContextPrivate::run_jobs_fallible() should have emptied queue");
     return G_SOURCE_REMOVE;
 }
 
@@ -712,6 +1093,14 @@ bool GjsContextPrivate::enqueuePromiseJob(
     }
 
     start_draining_job_queue();
+
+    // Continuations inherit the priority of the main loop source that resolved
+    // their promise, so that e.g. jobs queued from a high-priority input
+    // handler do not wait behind default-priority work.
+    GSource* origin = g_main_current_source();
+    if (origin && g_source_get_id(origin) != m_idle_drain_handler)
+        raise_job_queue_priority(g_source_get_priority(origin));
+
     return true;
 }
 
@@ -733,10 +1122,16 @@ void GjsContextPrivate::runJobs(JSContext* cx) {
  * Adapted from js::RunJobs() in SpiderMonkey's default job queue
  * implementation.
  *
+ * If @budget_usec is nonzero, stops once that much time has elapsed, after
+ * running at least one job. The executed jobs are removed from the front of
+ * the queue and the idle source is left installed, so that the rest are run
+ * in order the next time the main loop is idle. If @budget_usec is zero, the
+ * queue is drained completely, including any jobs enqueued while draining.
+ *
  * Returns: false if one of the jobs threw an uncatchable exception;
  * otherwise true.
  */
-bool GjsContextPrivate::run_jobs_fallible(void) {
+bool GjsContextPrivate::run_jobs_fallible(int64_t budget_usec) {
     bool retval = true;
 
     if (m_draining_job_queue || m_should_exit)
@@ -744,6 +1139,11 @@ bool GjsContextPrivate::run_jobs_fallible(void) {
 
     m_draining_job_queue = true;  // Ignore reentrant calls
 
+    int64_t start_time = g_get_monotonic_time();
+    int64_t deadline = budget_usec > 0 ? start_time + budget_usec : 0;
+    size_t n_run = 0;
+    bool yielded = false;
+
     JS::RootedObject job(m_cx);
     JS::HandleValueArray args(JS::HandleValueArray::empty());
     JS::RootedValue rval(m_cx);
@@ -765,7 +1165,15 @@ bool GjsContextPrivate::run_jobs_fallible(void) {
         if (!job)
             continue;
 
+        if (deadline != 0 && n_run > 0 && g_get_monotonic_time() >= deadline) {
+            // Out of time; drop the already-executed prefix and yield
+            m_job_queue.erase(m_job_queue.begin(), m_job_queue.begin() + ix);
+            yielded = true;
+            break;
+        }
+
         m_job_queue[ix] = nullptr;
+        n_run++;
         {
             JSAutoRealm ar(m_cx, job);
             if (!JS::Call(m_cx, JS::UndefinedHandleValue, job, args, &rval)) {
@@ -787,8 +1195,26 @@ bool GjsContextPrivate::run_jobs_fallible(void) {
         }
     }
 
-    m_job_queue.clear();
-    stop_draining_job_queue();
+    size_t n_remaining = 0;
+    if (yielded) {
+        n_remaining = m_job_queue.length();
+        m_draining_job_queue = false;
+    } else {
+        m_job_queue.clear();
+        stop_draining_job_queue();
+    }
+
+    int64_t elapsed = g_get_monotonic_time() - start_time;
+    gjs_debug(GJS_DEBUG_CONTEXT,
+              "Ran %zu promise jobs in %" G_GINT64_FORMAT " us, %zu remaining",
+              n_run, elapsed, n_remaining);
+    if (m_profiler && n_run > 0) {
+        GjsAutoChar message = g_strdup_printf("%zu jobs run, %zu remaining",
+                                              n_run, n_remaining);
+        _gjs_profiler_add_mark(m_profiler, start_time * 1000L, elapsed * 1000L,
+                               "GJS", "Drain job queue", message);
+    }
+
     return retval;
 }
 
@@ -847,15 +1273,12 @@ void GjsContextPrivate::unregister_unhandled_promise_rejection(uint64_t id) {
  * heuristically looks at JS runtime memory usage and
  * may initiate a garbage collection. 
  *
- * This function always unconditionally invokes JS_MaybeGC(), but
- * additionally looks at memory usage from the system malloc()
- * when available, and if the delta has grown since the last run
- * significantly, also initiates a full JavaScript garbage
- * collection.  The idea is that since GJS is a bridge between
- * JavaScript and system libraries, and JS objects act as proxies
- * for these system memory objects, GJS consumers need a way to
- * hint to the runtime that it may be a good idea to try a
- * collection.
+ * The memory that wrappers own on the C side, such as GObject instance
+ * structs and copies of boxed structs, is reported to the JS engine, so its
+ * heuristics also take that memory into account. The idea is that since GJS
+ * is a bridge between JavaScript and system libraries, and JS objects act as
+ * proxies for these system memory objects, GJS consumers need a way to hint to
+ * the runtime that it may be a good idea to try a collection.
  *
  * A good time to call this function is when your application
  * transitions to an idle state.
@@ -872,7 +1295,8 @@ gjs_context_maybe_gc (GjsContext  *context)
  * @context: a #GjsContext
  * 
  * Initiate a full GC; may or may not block until complete.  This
- * function just calls Spidermonkey JS_GC().
+ * function just calls Spidermonkey JS_GC(). To avoid a long pause, use
+ * gjs_context_gc_with_flags() instead.
  */ 
 void
 gjs_context_gc (GjsContext  *context)
@@ -881,6 +1305,87 @@ gjs_context_gc (GjsContext  *context)
     JS_GC(gjs->context());
 }
 
+/**
+ * gjs_context_gc_with_flags:
+ * @context: a #GjsContext
+ * @flags: the kind of collection
+ * @budget_ms: for %GJS_GC_FLAGS_INCREMENTAL, the time to spend right away, in
+ *   milliseconds, or 0 for the default of a few milliseconds
+ *
+ * Like gjs_context_gc(), but lets embedders that want to release memory at a
+ * given moment, such as after closing a big window, choose how long that may
+ * block the main loop. A minor collection is the cheapest; an incremental one
+ * does the same work as a full one, but only spends @budget_ms now and the
+ * rest in short slices from idle callbacks, or from
+ * gjs_context_run_gc_slice(). %GJS_GC_FLAGS_MINOR cannot be combined with the
+ * other flags.
+ */
+void gjs_context_gc_with_flags(GjsContext* context, GjsGCFlags flags,
+                               unsigned budget_ms) {
+    g_return_if_fail(GJS_IS_CONTEXT(context));
+    g_return_if_fail(!(flags & GJS_GC_FLAGS_MINOR) ||
+                     flags == GJS_GC_FLAGS_MINOR);
+
+    GjsContextPrivate* gjs = GjsContextPrivate::from_object(context);
+    gjs->gc(flags, budget_ms);
+}
+
+/**
+ * gjs_context_run_gc_slice:
+ * @context: a #GjsContext
+ * @budget_ms: maximum time to spend, in milliseconds
+ *
+ * GJS runs the full garbage collections that it schedules itself
+ * incrementally, in slices between main loop iterations. Embedders that know
+ * their frame timing, such as a compositor, can call this after each frame
+ * with the time left until the next one, to do that work when it cannot delay
+ * a frame.
+ *
+ * Returns: %TRUE if a garbage collection is still in progress afterwards
+ */
+bool gjs_context_run_gc_slice(GjsContext* context, unsigned budget_ms) {
+    GjsContextPrivate* gjs = GjsContextPrivate::from_object(context);
+    return gjs->run_gc_slice(budget_ms);
+}
+
+/**
+ * gjs_context_prefetch_modules:
+ * @context: a #GjsContext
+ * @paths: (array zero-terminated=1): paths or URIs of JS files
+ *
+ * Starts compiling the given files on helper threads, so that importing them
+ * later, through `imports` or gjs_context_eval_file(), doesn't have to parse
+ * and compile them on the main thread. This is useful for embedders that know
+ * which modules they are going to load, such as at startup.
+ *
+ * Files that can't be read are silently skipped; the error is reported when
+ * they are imported.
+ */
+void gjs_context_prefetch_modules(GjsContext* context,
+                                  const char* const* paths) {
+    g_return_if_fail(GJS_IS_CONTEXT(context));
+    g_return_if_fail(paths);
+
+    GjsContextPrivate* gjs = GjsContextPrivate::from_object(context);
+    JSAutoRealm ar(gjs->context(), gjs->global());
+    gjs_prefetch_scripts(gjs->context(), paths);
+}
+
+/**
+ * gjs_context_set_job_queue_priority:
+ * @context: a #GjsContext
+ * @priority: a main loop priority such as %G_PRIORITY_DEFAULT
+ *
+ * Sets the priority of the main loop source that runs promise continuations
+ * (the job queue). The default is %G_PRIORITY_DEFAULT. Jobs queued while
+ * another main loop source is being dispatched run at that source's priority
+ * instead if it is more urgent.
+ */
+void gjs_context_set_job_queue_priority(GjsContext* context, int priority) {
+    GjsContextPrivate* gjs = GjsContextPrivate::from_object(context);
+    gjs->set_job_queue_priority(priority);
+}
+
 /**
  * gjs_context_get_all:
  *
@@ -938,19 +1443,36 @@ bool GjsContextPrivate::eval(const char* script, ssize_t script_len,
                              GError** error) {
     AutoResetExit reset(this);
 
-    bool auto_profile = m_should_profile;
-    if (auto_profile &&
-        (_gjs_profiler_is_running(m_profiler) || m_should_listen_sigusr2))
-        auto_profile = false;
-
     JSAutoRealm ar(m_cx, m_global);
 
-    if (auto_profile)
-        gjs_profiler_start(m_profiler);
+    bool auto_profile = start_auto_profile();
 
     JS::RootedValue retval(m_cx);
     bool ok = eval_with_scope(nullptr, script, script_len, filename, &retval);
 
+    return finish_eval(ok, retval, filename, auto_profile, exit_status_p,
+                       error);
+}
+
+bool GjsContextPrivate::start_auto_profile() {
+    if (!m_should_profile || _gjs_profiler_is_running(m_profiler) ||
+        m_should_listen_sigusr2)
+        return false;
+
+    gjs_profiler_start(m_profiler);
+    return true;
+}
+
+/*
+ * GjsContextPrivate::finish_eval:
+ *
+ * Common ending of eval() and run_script(): drains the job queue and turns an
+ * exception or a return value from a toplevel script into the exit status and
+ * error of the public API.
+ */
+bool GjsContextPrivate::finish_eval(bool ok, JS::HandleValue retval,
+                                    const char* filename, bool auto_profile,
+                                    int* exit_status_p, GError** error) {
     /* The promise job queue should be drained even on error, to finish
      * outstanding async tasks before the context is torn down. Drain after
      * uncaught exceptions have been reported since draining runs callbacks. */
@@ -1011,17 +1533,177 @@ gjs_context_eval_file(GjsContext    *js_context,
                       int           *exit_status_p,
                       GError       **error)
 {
-    char *script;
+    GjsAutoUnref<GFile> file = g_file_new_for_commandline_arg(filename);
+
+    GjsAutoBytes script_bytes = gjs_load_script_file(file, error);
+    if (!script_bytes)
+        return false;
+
     size_t script_len;
+    auto* script =
+        static_cast<const char*>(g_bytes_get_data(script_bytes, &script_len));
+
+    return gjs_context_eval(js_context, script ? script : "", script_len,
+                            filename, exit_status_p, error);
+}
+
+/**
+ * gjs_context_eval_module_file:
+ * @js_context: a #GjsContext
+ * @filename: path or URI of an ES module
+ * @exit_status_p: return location for the exit status
+ * @error: return location for a #GError
+ *
+ * Evaluates @filename as an ES module, which may use import and export. The
+ * modules that it imports are read and compiled in parallel before any of them
+ * is evaluated; see esm.h. Modules have no completion value, so the exit status
+ * is 0 unless the module throws or calls System.exit().
+ *
+ * Returns: %true if the module was evaluated without errors
+ */
+bool gjs_context_eval_module_file(GjsContext* js_context, const char* filename,
+                                  int* exit_status_p, GError** error) {
+    g_return_val_if_fail(GJS_IS_CONTEXT(js_context), false);
+
+    GjsAutoUnref<GjsContext> js_context_ref(js_context, GjsAutoTakeOwnership());
+
     GjsAutoUnref<GFile> file = g_file_new_for_commandline_arg(filename);
+    GjsAutoChar uri = g_file_get_uri(file);
+
+    GjsContextPrivate* gjs = GjsContextPrivate::from_object(js_context);
+    return gjs->eval_module(uri, exit_status_p, error);
+}
+
+bool GjsContextPrivate::eval_module(const char* uri, int* exit_status_p,
+                                    GError** error) {
+    AutoResetExit reset(this);
+
+    JSAutoRealm ar(m_cx, m_global);
+
+    bool auto_profile = start_auto_profile();
+
+    bool ok = gjs_module_load_and_evaluate(m_cx, uri);
+
+    return finish_eval(ok, JS::UndefinedHandleValue, uri, auto_profile,
+                       exit_status_p, error);
+}
+
+/**
+ * gjs_context_compile:
+ * @js_context: a #GjsContext
+ * @script: JavaScript program encoded in UTF-8
+ * @script_len: length of @script, or -1 if @script is 0-terminated
+ * @filename: filename to use as the origin of @script
+ * @error: return location for a #GError
+ *
+ * Compiles @script once, so that it can be run any number of times with
+ * gjs_script_run() without parsing it again. This is cheaper than calling
+ * gjs_context_eval() repeatedly with the same source, for embedders that
+ * run the same snippet of code over and over.
+ *
+ * The compiled script is only valid in @js_context, and can no longer be run
+ * once @js_context has been disposed.
+ *
+ * Returns: (transfer full) (nullable): a #GjsScript, or %NULL if @script
+ *   could not be compiled
+ */
+GjsScript* gjs_context_compile(GjsContext* js_context, const char* script,
+                               gssize script_len, const char* filename,
+                               GError** error) {
+    g_return_val_if_fail(GJS_IS_CONTEXT(js_context), nullptr);
+
+    GjsContextPrivate* gjs = GjsContextPrivate::from_object(js_context);
+    return gjs->compile_script(script, script_len, filename, error);
+}
+
+GjsScript* GjsContextPrivate::compile_script(const char* script,
+                                             ssize_t script_len,
+                                             const char* filename,
+                                             GError** error) {
+    JSAutoRealm ar(m_cx, m_global);
+
+    JS::RootedScript compiled(m_cx, compile(script, script_len, filename));
+    if (!compiled) {
+        g_set_error(error, GJS_ERROR, GJS_ERROR_FAILED,
+                    "Script %s could not be compiled", filename);
+        gjs_log_exception_uncaught(m_cx);
+        return nullptr;
+    }
+
+    auto* retval = new GjsScript(this, compiled, filename);
+    m_scripts.insert(retval);
+    return retval;
+}
 
-    if (!g_file_load_contents(file, nullptr, &script, &script_len, nullptr,
-                              error))
+/**
+ * gjs_script_run:
+ * @script: a #GjsScript
+ * @exit_status_p: (out): return location for the exit status
+ * @error: return location for a #GError
+ *
+ * Runs a script compiled with gjs_context_compile(), in the same way as
+ * gjs_context_eval(): each run gets a new scope, so that nothing from one run
+ * leaks into the global scope or into the next run.
+ *
+ * Returns: %TRUE if the script ran without throwing an exception
+ */
+bool gjs_script_run(GjsScript* script, int* exit_status_p, GError** error) {
+    g_return_val_if_fail(script, false);
+
+    if (!script->gjs) {
+        g_set_error(error, GJS_ERROR, GJS_ERROR_FAILED,
+                    "Script %s was compiled in a context that is gone",
+                    script->filename.get());
         return false;
-    GjsAutoChar script_ref = script;
+    }
 
-    return gjs_context_eval(js_context, script, script_len, filename,
-                            exit_status_p, error);
+    GjsAutoUnref<GjsContext> js_context_ref(script->gjs->public_context(),
+                                            GjsAutoTakeOwnership());
+    return script->gjs->run_script(script, exit_status_p, error);
+}
+
+bool GjsContextPrivate::run_script(GjsScript* script, int* exit_status_p,
+                                   GError** error) {
+    AutoResetExit reset(this);
+
+    JSAutoRealm ar(m_cx, m_global);
+
+    bool auto_profile = start_auto_profile();
+
+    JS::RootedScript compiled(m_cx, script->script);
+    JS::RootedValue retval(m_cx);
+    bool ok = execute_with_scope(nullptr, compiled, &retval);
+
+    return finish_eval(ok, retval, script->filename, auto_profile,
+                       exit_status_p, error);
+}
+
+/**
+ * gjs_script_ref:
+ * @script: a #GjsScript
+ *
+ * Returns: (transfer full): @script
+ */
+GjsScript* gjs_script_ref(GjsScript* script) {
+    g_return_val_if_fail(script, nullptr);
+    g_ref_count_inc(&script->ref_count);
+    return script;
+}
+
+/**
+ * gjs_script_unref:
+ * @script: (transfer full): a #GjsScript
+ *
+ * Releases a reference to @script, and frees it if it was the last one.
+ */
+void gjs_script_unref(GjsScript* script) {
+    g_return_if_fail(script);
+    if (!g_ref_count_dec(&script->ref_count))
+        return;
+
+    if (script->gjs)
+        script->gjs->forget_script(script);
+    delete script;
 }
 
 /*
@@ -1048,17 +1730,48 @@ bool GjsContextPrivate::eval_with_scope(JS::HandleObject scope_object,
         return false;
     }
 
+    JS::RootedScript compiled(m_cx, compile(script, script_len, filename));
+    if (!compiled)
+        return false;
+
+    return execute_with_scope(scope_object, compiled, retval);
+}
+
+/*
+ * GjsContextPrivate::compile:
+ * @script: JavaScript program encoded in UTF-8
+ * @script_len: length of @script, or -1 if @script is 0-terminated
+ * @filename: filename to use as the origin of @script
+ *
+ * Compiles @script for execute_with_scope(), through the script cache.
+ */
+JSScript* GjsContextPrivate::compile(const char* script, ssize_t script_len,
+                                     const char* filename) {
+    JS::CompileOptions options(m_cx);
+    // Sources in GResources can be reloaded by the source hook when needed, so
+    // SpiderMonkey need not keep a copy
+    options.setFileAndLine(filename, 1)
+        .setSourceIsLazy(g_str_has_prefix(filename, "resource://"));
+
+    return gjs_compile_script(m_cx, options, script, script_len);
+}
+
+/*
+ * GjsContextPrivate::execute_with_scope:
+ * @scope_object: an object to use as the global scope, or nullptr
+ * @compiled: script from compile()
+ * @retval: location for the return value of @compiled
+ *
+ * Like eval_with_scope(), for a script that was already compiled. A compiled
+ * script can be executed any number of times.
+ */
+bool GjsContextPrivate::execute_with_scope(JS::HandleObject scope_object,
+                                           JS::HandleScript compiled,
+                                           JS::MutableHandleValue retval) {
     JS::RootedObject eval_obj(m_cx, scope_object);
     if (!eval_obj)
         eval_obj = JS_NewPlainObject(m_cx);
-
-    std::u16string utf16_string = gjs_utf8_script_to_utf16(script, script_len);
-    // COMPAT: This could use JS::SourceText<mozilla::Utf8Unit> directly,
-    // but that messes up code coverage. See bug
-    // https://bugzilla.mozilla.org/show_bug.cgi?id=1404784
-    JS::SourceText<char16_t> buf;
-    if (!buf.init(m_cx, utf16_string.c_str(), utf16_string.size(),
-                  JS::SourceOwnership::Borrowed))
+    if (!eval_obj)
         return false;
 
     JS::RootedObjectVector scope_chain(m_cx);
@@ -1067,17 +1780,14 @@ bool GjsContextPrivate::eval_with_scope(JS::HandleObject scope_object,
         return false;
     }
 
-    JS::CompileOptions options(m_cx);
-    options.setFileAndLine(filename, 1);
-
-    if (!JS::Evaluate(m_cx, scope_chain, options, buf, retval))
+    if (!JS_ExecuteScript(m_cx, scope_chain, compiled, retval))
         return false;
 
     schedule_gc_if_needed();
 
     if (JS_IsExceptionPending(m_cx)) {
         g_warning(
-            "JS::Evaluate() returned true but exception was pending; "
+            "JS_ExecuteScript() returned true but exception was pending; "
             "did somebody call gjs_throw() without returning false?");
         return false;
     }
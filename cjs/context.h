@@ -44,6 +44,7 @@ G_BEGIN_DECLS
 
 typedef struct _GjsContext      GjsContext;
 typedef struct _GjsContextClass GjsContextClass;
+typedef struct _GjsScript       GjsScript;
 
 #define GJS_TYPE_CONTEXT              (gjs_context_get_type ())
 #define GJS_CONTEXT(object)           (G_TYPE_CHECK_INSTANCE_CAST ((object), GJS_TYPE_CONTEXT, GjsContext))
@@ -52,7 +53,29 @@ typedef struct _GjsContextClass GjsContextClass;
 #define GJS_IS_CONTEXT_CLASS(klass)   (G_TYPE_CHECK_CLASS_TYPE ((klass), GJS_TYPE_CONTEXT))
 #define GJS_CONTEXT_GET_CLASS(obj)    (G_TYPE_INSTANCE_GET_CLASS ((obj), GJS_TYPE_CONTEXT, GjsContextClass))
 
+#define GJS_TYPE_SCRIPT               (gjs_script_get_type ())
+
+/**
+ * GjsGCFlags:
+ * @GJS_GC_FLAGS_NONE: a full, non-incremental collection
+ * @GJS_GC_FLAGS_MINOR: collect only the nursery, where new objects are
+ *   allocated, if it holds enough to be worth it
+ * @GJS_GC_FLAGS_INCREMENTAL: start a full collection that runs in slices
+ *   between main loop iterations
+ * @GJS_GC_FLAGS_SHRINK: also compact the heap and release unused memory to
+ *   the system
+ *
+ * Kinds of garbage collection for gjs_context_gc_with_flags().
+ */
+typedef enum {
+    GJS_GC_FLAGS_NONE = 0,
+    GJS_GC_FLAGS_MINOR = 1 << 0,
+    GJS_GC_FLAGS_INCREMENTAL = 1 << 1,
+    GJS_GC_FLAGS_SHRINK = 1 << 2,
+} GjsGCFlags;
+
 GJS_EXPORT GJS_USE GType gjs_context_get_type(void) G_GNUC_CONST;
+GJS_EXPORT GJS_USE GType gjs_script_get_type(void) G_GNUC_CONST;
 
 GJS_EXPORT GJS_USE GjsContext* gjs_context_new(void);
 GJS_EXPORT GJS_USE GjsContext* gjs_context_new_with_search_path(
@@ -65,6 +88,19 @@ GJS_EXPORT GJS_USE bool gjs_context_eval(GjsContext* js_context,
                                          const char* script, gssize script_len,
                                          const char* filename,
                                          int* exit_status_p, GError** error);
+GJS_EXPORT GJS_USE bool gjs_context_eval_module_file(GjsContext* js_context,
+                                                     const char* filename,
+                                                     int* exit_status_p,
+                                                     GError** error);
+GJS_EXPORT GJS_USE GjsScript* gjs_context_compile(GjsContext* js_context,
+                                                  const char* script,
+                                                  gssize script_len,
+                                                  const char* filename,
+                                                  GError** error);
+GJS_EXPORT GJS_USE bool gjs_script_run(GjsScript* script, int* exit_status_p,
+                                       GError** error);
+GJS_EXPORT GjsScript* gjs_script_ref(GjsScript* script);
+GJS_EXPORT void gjs_script_unref(GjsScript* script);
 GJS_EXPORT GJS_USE bool gjs_context_define_string_array(
     GjsContext* js_context, const char* array_name, gssize array_length,
     const char** array_values, GError** error);
@@ -87,6 +123,20 @@ void            gjs_context_maybe_gc              (GjsContext  *context);
 GJS_EXPORT
 void            gjs_context_gc                    (GjsContext  *context);
 
+GJS_EXPORT
+void gjs_context_gc_with_flags(GjsContext* context, GjsGCFlags flags,
+                               unsigned budget_ms);
+
+GJS_EXPORT
+bool gjs_context_run_gc_slice(GjsContext* context, unsigned budget_ms);
+
+GJS_EXPORT
+void gjs_context_prefetch_modules(GjsContext* context,
+                                  const char* const* paths);
+
+GJS_EXPORT
+void gjs_context_set_job_queue_priority(GjsContext* context, int priority);
+
 GJS_EXPORT GJS_USE GjsProfiler* gjs_context_get_profiler(GjsContext* self);
 
 GJS_EXPORT GJS_USE bool gjs_profiler_chain_signal(GjsContext* context,
@@ -100,6 +150,10 @@ GJS_EXPORT GJS_USE const char* gjs_get_js_version(void);
 GJS_EXPORT
 void gjs_context_setup_debugger_console(GjsContext* gjs);
 
+GJS_EXPORT
+void gjs_context_setup_debugger_breakpoints(GjsContext* gjs,
+                                            const char* const* breakpoints);
+
 G_END_DECLS
 
 #endif /* GJS_CONTEXT_H_ */
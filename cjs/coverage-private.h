@@ -0,0 +1,12 @@
+/* -*- mode: C++; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * SPDX-License-Identifier: MIT OR LGPL-2.0-or-later
+ */
+
+#ifndef GJS_COVERAGE_PRIVATE_H_
+#define GJS_COVERAGE_PRIVATE_H_
+
+// Whether gjs_coverage_enable() has been called in this process
+[[nodiscard]] bool gjs_coverage_is_enabled(void);
+
+#endif  // GJS_COVERAGE_PRIVATE_H_
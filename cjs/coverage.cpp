@@ -29,6 +29,7 @@
 #include <string.h>  // for strcmp, strlen
 
 #include <new>
+#include <utility>  // for move
 
 #include <gio/gio.h>
 #include <glib-object.h>
@@ -45,6 +46,7 @@
 #include "cjs/atoms.h"
 #include "cjs/context-private.h"
 #include "cjs/context.h"
+#include "cjs/coverage-private.h"
 #include "cjs/coverage.h"
 #include "cjs/global.h"
 #include "cjs/jsapi-util.h"
@@ -86,13 +88,6 @@ static GParamSpec *properties[PROP_N] = { NULL, };
     return path;
 }
 
-[[nodiscard]] static bool write_source_file_header(GOutputStream* stream,
-                                                   GFile* source_file,
-                                                   GError** error) {
-    GjsAutoChar path = get_file_identifier(source_file);
-    return g_output_stream_printf(stream, NULL, NULL, error, "SF:%s\n", path.get());
-}
-
 [[nodiscard]] static bool copy_source_file_to_coverage_output(
     GFile* source_file, GFile* destination_file, GError** error) {
     /* We need to recursively make the directory we
@@ -175,26 +170,67 @@ static GParamSpec *properties[PROP_N] = { NULL, };
     return stripped_uri;
 }
 
-[[nodiscard]] static bool filename_has_coverage_prefixes(GjsCoverage* self,
-                                                         const char* filename) {
-    auto priv = static_cast<GjsCoveragePrivate *>(gjs_coverage_get_instance_private(self));
-    GjsAutoChar workdir = g_get_current_dir();
+[[nodiscard]] static bool filename_has_coverage_prefixes(
+    const char* const* abs_prefixes, const char* workdir,
+    const char* filename) {
     GjsAutoChar abs_filename = g_canonicalize_filename(filename, workdir);
 
-    for (const char * const *prefix = priv->prefixes; *prefix; prefix++) {
-        GjsAutoChar abs_prefix = g_canonicalize_filename(*prefix, workdir);
-        if (g_str_has_prefix(abs_filename, abs_prefix))
+    for (const char* const* prefix = abs_prefixes; *prefix; prefix++) {
+        if (g_str_has_prefix(abs_filename, *prefix))
             return true;
     }
     return false;
 }
 
-static inline bool
-write_line(GOutputStream *out,
-           const char    *line,
-           GError       **error)
-{
-    return g_output_stream_printf(out, nullptr, nullptr, error, "%s\n", line);
+/* Source files are copied next to the report on a thread pool, since with
+ * thousands of covered files the copies dominate the time spent at exit. A
+ * copy is skipped if another process already put an up-to-date one there. */
+struct CopyJob {
+    GjsAutoUnref<GFile> source;
+    GjsAutoUnref<GFile> destination;
+};
+
+struct CopyState {
+    GMutex lock;
+    GError* error;
+};
+
+[[nodiscard]] static bool destination_is_up_to_date(GFile* source_file,
+                                                    GFile* destination_file) {
+    const char* attributes =
+        G_FILE_ATTRIBUTE_STANDARD_SIZE "," G_FILE_ATTRIBUTE_TIME_MODIFIED;
+    GjsAutoUnref<GFileInfo> source_info = g_file_query_info(
+        source_file, attributes, G_FILE_QUERY_INFO_NONE, nullptr, nullptr);
+    GjsAutoUnref<GFileInfo> destination_info = g_file_query_info(
+        destination_file, attributes, G_FILE_QUERY_INFO_NONE, nullptr, nullptr);
+    if (!source_info || !destination_info)
+        return false;
+
+    return g_file_info_get_size(source_info) ==
+               g_file_info_get_size(destination_info) &&
+           g_file_info_get_attribute_uint64(source_info,
+                                            G_FILE_ATTRIBUTE_TIME_MODIFIED) <=
+               g_file_info_get_attribute_uint64(destination_info,
+                                                G_FILE_ATTRIBUTE_TIME_MODIFIED);
+}
+
+static void copy_source_file_job(void* data, void* user_data) {
+    auto* job = static_cast<CopyJob*>(data);
+    auto* state = static_cast<CopyState*>(user_data);
+    GError* error = nullptr;
+
+    if (!destination_is_up_to_date(job->source, job->destination) &&
+        !copy_source_file_to_coverage_output(job->source, job->destination,
+                                             &error)) {
+        g_mutex_lock(&state->lock);
+        if (!state->error)
+            state->error = error;
+        else
+            g_error_free(error);
+        g_mutex_unlock(&state->lock);
+    }
+
+    delete job;
 }
 
 [[nodiscard]] static GjsAutoUnref<GFile> write_statistics_internal(
@@ -220,13 +256,24 @@ write_line(GOutputStream *out,
     size_t lcov_length;
     JS::UniqueChars lcov = js::GetCodeCoverageSummary(cx, &lcov_length);
 
-    GjsAutoUnref<GOutputStream> ostream =
-        G_OUTPUT_STREAM(g_file_append_to(output_file,
-                                         G_FILE_CREATE_NONE,
-                                         NULL,
-                                         error));
-    if (!ostream)
-        return nullptr;
+    GjsAutoChar workdir = g_get_current_dir();
+    size_t n_prefixes = g_strv_length(priv->prefixes);
+    GjsAutoStrv abs_prefixes = g_new0(char*, n_prefixes + 1);
+    for (size_t ix = 0; ix < n_prefixes; ix++)
+        abs_prefixes[ix] = g_canonicalize_filename(priv->prefixes[ix], workdir);
+
+    CopyState copy_state;
+    g_mutex_init(&copy_state.lock);
+    copy_state.error = nullptr;
+    GThreadPool* copy_pool = g_thread_pool_new(
+        copy_source_file_job, &copy_state, g_get_num_processors(), false,
+        nullptr);
+
+    /* The report is built in memory and appended with a single write, so that
+     * several processes sharing an output directory don't interleave their
+     * records. LCOV tools sum up the records of a file listed more than once,
+     * which merges the reports of all processes. */
+    GString* report = g_string_sized_new(lcov_length);
 
     GjsAutoStrv lcov_lines = g_strsplit(lcov.get(), "\n", -1);
     const char* test_name = NULL;
@@ -246,14 +293,15 @@ write_line(GOutputStream *out,
             continue;
         } else if (g_str_has_prefix(*iter, "SF:")) {
             const char *filename = *iter + 3;
-            if (!filename_has_coverage_prefixes(coverage, filename)) {
+            if (!filename_has_coverage_prefixes(abs_prefixes, workdir,
+                                                filename)) {
                 ignoring_file = true;
                 continue;
             }
 
             /* Now we can write the test name before writing the source file */
-            if (!write_line(ostream, test_name, error))
-                return nullptr;
+            if (test_name)
+                g_string_append_printf(report, "%s\n", test_name);
 
             /* The source file could be a resource, so we must use
              * g_file_new_for_commandline_arg() to disambiguate between URIs and
@@ -263,20 +311,42 @@ write_line(GOutputStream *out,
                 find_diverging_child_components(source_file, priv->output_dir);
             GjsAutoUnref<GFile> destination_file =
                 g_file_resolve_relative_path(priv->output_dir, diverged_paths);
-            if (!copy_source_file_to_coverage_output(source_file, destination_file, error))
-                return nullptr;
 
             /* Rewrite the source file path to be relative to the output
              * dir so that genhtml will find it */
-            if (!write_source_file_header(ostream, destination_file, error))
-                return nullptr;
+            GjsAutoChar path = get_file_identifier(destination_file);
+            g_string_append_printf(report, "SF:%s\n", path.get());
+
+            g_thread_pool_push(copy_pool,
+                               new CopyJob{std::move(source_file),
+                                           std::move(destination_file)},
+                               nullptr);
             continue;
         }
 
-        if (!write_line(ostream, *iter, error))
-            return nullptr;
+        g_string_append_printf(report, "%s\n", *iter);
     }
 
+    g_thread_pool_free(copy_pool, false, true);
+    g_mutex_clear(&copy_state.lock);
+    if (copy_state.error) {
+        g_string_free(report, true);
+        g_propagate_error(error, copy_state.error);
+        return nullptr;
+    }
+
+    GjsAutoUnref<GOutputStream> ostream =
+        G_OUTPUT_STREAM(g_file_append_to(output_file,
+                                         G_FILE_CREATE_NONE,
+                                         NULL,
+                                         error));
+    bool ok = ostream && g_output_stream_write_all(ostream, report->str,
+                                                   report->len, nullptr,
+                                                   nullptr, error);
+    g_string_free(report, true);
+    if (!ok)
+        return nullptr;
+
     return output_file;
 }
 
@@ -374,6 +444,13 @@ gjs_coverage_constructed(GObject *object)
     GjsCoveragePrivate *priv = (GjsCoveragePrivate *) gjs_coverage_get_instance_private(coverage);
     new (&priv->global) JS::Heap<JSObject*>();
 
+    /* js::EnableCodeCoverage() already makes every realm count hits, and the
+     * counters survive the Baseline JIT. Attaching a Debugger with
+     * collectCoverageInfo is only needed to compare against the old results,
+     * and it keeps the debuggee out of the JITs. */
+    if (!g_getenv("GJS_COVERAGE_DEBUGGER"))
+        return;
+
     if (!bootstrap_coverage(coverage)) {
         JSContext *context = static_cast<JSContext *>(gjs_context_get_native_context(priv->context));
         JSAutoRealm ar(context, gjs_get_import_global(context));
@@ -417,8 +494,10 @@ gjs_coverage_dispose(GObject *object)
     /* Decomission objects inside of the JSContext before
      * disposing of the context */
     auto cx = static_cast<JSContext *>(gjs_context_get_native_context(priv->context));
-    JS_RemoveExtraGCRootsTracer(cx, coverage_tracer, coverage);
-    priv->global = nullptr;
+    if (priv->global) {
+        JS_RemoveExtraGCRootsTracer(cx, coverage_tracer, coverage);
+        priv->global = nullptr;
+    }
 
     g_clear_object(&priv->context);
 
@@ -518,3 +597,5 @@ void gjs_coverage_enable() {
     js::EnableCodeCoverage();
     s_coverage_enabled = true;
 }
+
+bool gjs_coverage_is_enabled(void) { return s_coverage_enabled; }
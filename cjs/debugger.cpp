@@ -27,6 +27,9 @@
 #include <stdint.h>
 #include <stdio.h>  // for feof, fflush, fgets, stdin, stdout
 
+#include <string>
+#include <vector>
+
 #ifdef HAVE_READLINE_READLINE_H
 #    include <readline/history.h>
 #    include <readline/readline.h>
@@ -131,9 +134,15 @@ static JSFunctionSpec debugger_funcs[] = {
 };
 // clang-format on
 
-void gjs_context_setup_debugger_console(GjsContext* gjs) {
+// If @breakpoints is null, the debugger observes the whole program and stops
+// before the first frame; see gjs_context_setup_debugger_breakpoints()
+static void setup_debugger(GjsContext* gjs, const char* const* breakpoints) {
     auto cx = static_cast<JSContext*>(gjs_context_get_native_context(gjs));
 
+    // Scripts loaded from the bytecode cache are not announced to the
+    // debugger, so breakpoints could not be set in them
+    GjsContextPrivate::from_object(gjs)->set_debugger_attached();
+
     JS::RootedObject debuggee(cx, gjs_get_import_global(cx));
     JS::RootedObject debugger_global(
         cx, gjs_create_global_object(cx, GjsGlobalType::DEBUGGER));
@@ -146,6 +155,18 @@ void gjs_context_setup_debugger_console(GjsContext* gjs) {
         return;
     }
 
+    if (breakpoints) {
+        std::vector<std::string> locations;
+        for (const char* const* location = breakpoints; *location; location++)
+            locations.emplace_back(*location);
+        if (!gjs_define_string_array(cx, debugger_global,
+                                     "breakpointLocations", locations,
+                                     GJS_MODULE_PROP_FLAGS)) {
+            gjs_log_exception(cx);
+            return;
+        }
+    }
+
     const GjsAtoms& atoms = GjsContextPrivate::atoms(cx);
     JS::RootedValue v_wrapper(cx, JS::ObjectValue(*debuggee_wrapper));
     if (!JS_SetPropertyById(cx, debugger_global, atoms.debuggee(), v_wrapper) ||
@@ -155,3 +176,24 @@ void gjs_context_setup_debugger_console(GjsContext* gjs) {
                                       "debugger"))
         gjs_log_exception(cx);
 }
+
+void gjs_context_setup_debugger_console(GjsContext* gjs) {
+    setup_debugger(gjs, nullptr);
+}
+
+/**
+ * gjs_context_setup_debugger_breakpoints:
+ * @gjs: a #GjsContext
+ * @breakpoints: (array zero-terminated=1): locations of breakpoints, in the
+ *   form "FILE:LINE"
+ *
+ * Like gjs_context_setup_debugger_console(), but instead of observing the
+ * whole program, which keeps the JIT from running at full speed, the debugger
+ * only sets breakpoints at @breakpoints, in the scripts for FILE as they are
+ * loaded, and stops at them and at debugger statements.
+ */
+void gjs_context_setup_debugger_breakpoints(GjsContext* gjs,
+                                            const char* const* breakpoints) {
+    g_return_if_fail(breakpoints);
+    setup_debugger(gjs, breakpoints);
+}
@@ -24,19 +24,15 @@
 #include <config.h>
 
 #include <cstddef>        // for size_t
-#include <string>         // for string
+#include <string>
 #include <unordered_set>  // for unordered_set
 #include <utility>        // for hash, move
 
 #include <glib.h>  // for g_warning
 
-#include <js/CharacterEncoding.h>
-#include <js/Conversions.h>
-#include <js/RootingAPI.h>
 #include <js/TypeDecls.h>
 #include <js/Utility.h>  // for UniqueChars
-#include <js/Value.h>
-#include <jsapi.h>        // for MaxFrames, CaptureCurrentStack
+#include <jsapi.h>        // for AutoFilename, DescribeScriptedCaller
 #include <jsfriendapi.h>  // for FormatStackDump
 
 #include "cjs/deprecation.h"
@@ -72,15 +68,20 @@ const char* messages[] = {
     "Some code tried to set a deprecated GObject property.",
 };
 
+// Callsites are identified by the position of the scripted caller, rather
+// than by formatting its stack frame into a string, so that repeated
+// deprecated calls from the same place don't pay for string formatting. The
+// filename is copied, since the one from JS::DescribeScriptedCaller() is only
+// valid as long as its JS::AutoFilename.
 struct DeprecationEntry {
     GjsDeprecationMessageId id;
-    std::string loc;
-
-    DeprecationEntry(GjsDeprecationMessageId an_id, const char* a_loc)
-        : id(an_id), loc(a_loc) {}
+    std::string filename;
+    unsigned line;
+    unsigned column;
 
     bool operator==(const DeprecationEntry& other) const {
-        return id == other.id && loc == other.loc;
+        return id == other.id && line == other.line &&
+               column == other.column && filename == other.filename;
     }
 };
 
@@ -88,27 +89,22 @@ namespace std {
 template <>
 struct hash<DeprecationEntry> {
     size_t operator()(const DeprecationEntry& key) const {
-        return hash<int>()(key.id) ^ hash<std::string>()(key.loc);
+        return hash<int>()(key.id) ^ hash<std::string>()(key.filename) ^
+               hash<unsigned>()(key.line) ^ (hash<unsigned>()(key.column) << 1);
     }
 };
 };  // namespace std
 
 static std::unordered_set<DeprecationEntry> logged_messages;
 
-GJS_JSAPI_RETURN_CONVENTION
-static JS::UniqueChars get_callsite(JSContext* cx) {
-    JS::RootedObject stack_frame(cx);
-    if (!JS::CaptureCurrentStack(cx, &stack_frame,
-                                 JS::StackCapture(JS::MaxFrames(1))) ||
-        !stack_frame)
-        return nullptr;
-
-    JS::RootedValue v_frame(cx, JS::ObjectValue(*stack_frame));
-    JS::RootedString frame_string(cx, JS::ToString(cx, v_frame));
-    if (!frame_string)
-        return nullptr;
-
-    return JS_EncodeStringToUTF8(cx, frame_string);
+[[nodiscard]] static DeprecationEntry get_callsite(
+    JSContext* cx, GjsDeprecationMessageId id) {
+    JS::AutoFilename filename;
+    unsigned line = 0, column = 0;
+    if (!JS::DescribeScriptedCaller(cx, &filename, &line, &column) ||
+        !filename.get())
+        return {id, "", line, column};
+    return {id, filename.get(), line, column};
 }
 
 /* Note, this can only be called from the JS thread because it uses the full
@@ -116,12 +112,11 @@ static JS::UniqueChars get_callsite(JSContext* cx) {
  * stdout or stderr. Do not use this function during GC, for example. */
 void _gjs_warn_deprecated_once_per_callsite(JSContext* cx,
                                             const GjsDeprecationMessageId id) {
-    JS::UniqueChars callsite(get_callsite(cx));
-    DeprecationEntry entry(id, callsite.get());
-    if (!logged_messages.count(entry)) {
-        JS::UniqueChars stack_dump =
-            JS::FormatStackDump(cx, false, false, false);
-        g_warning("%s\n%s", messages[id], stack_dump.get());
-        logged_messages.insert(std::move(entry));
-    }
+    DeprecationEntry entry = get_callsite(cx, id);
+    if (logged_messages.count(entry))
+        return;
+
+    JS::UniqueChars stack_dump = JS::FormatStackDump(cx, false, false, false);
+    g_warning("%s\n%s", messages[id], stack_dump.get());
+    logged_messages.insert(std::move(entry));
 }
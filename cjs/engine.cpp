@@ -24,6 +24,7 @@
 #include <config.h>
 
 #include <stdint.h>
+#include <string.h>  // for strlen
 
 #ifdef _WIN32
 #    define WIN32_LEAN_AND_MEAN
@@ -35,6 +36,7 @@
 #include <gio/gio.h>
 #include <glib.h>
 
+#include <js/BuildId.h>  // for BuildIdCharVector, SetProcessBuildIdOp
 #include <js/ContextOptions.h>
 #include <js/GCAPI.h>           // for JS_SetGCParameter, JS_AddFin...
 #include <js/Initialization.h>  // for JS_Init, JS_ShutDown
@@ -46,9 +48,13 @@
 #include <jsapi.h>  // for InitSelfHostedCode, JS_Destr...
 #include <mozilla/UniquePtr.h>
 
+#include "gi/function.h"
+#include "gi/gjs_gi_trace.h"
+#include "gi/listiterator.h"
 #include "gi/object.h"
 #include "cjs/context-private.h"
 #include "cjs/engine.h"
+#include "cjs/esm.h"
 #include "cjs/jsapi-util.h"
 #include "util/log.h"
 
@@ -102,20 +108,53 @@ static void gjs_finalize_callback(JSFreeOp*, JSFinalizeStatus status,
         gjs->set_sweeping(false);
 }
 
-static void on_garbage_collect(JSContext*, JSGCStatus status, JS::GCReason,
-                               void*) {
+static void on_garbage_collect(JSContext* cx, JSGCStatus status,
+                               JS::GCReason reason [[maybe_unused]], void*) {
     /* We finalize any pending toggle refs before doing any garbage collection,
      * so that we can collect the JS wrapper objects, and in order to minimize
      * the chances of objects having a pending toggle up queued when they are
-     * garbage collected. */
+     * garbage collected. Wrappers whose switch to toggle refs was deferred
+     * must make it first, or they might be collected while still in use. */
     if (status == JSGC_BEGIN) {
         gjs_debug_lifecycle(GJS_DEBUG_CONTEXT, "Begin garbage collection");
+        TRACE(GJS_GC_BEGIN(JS::ExplainGCReason(reason)));
+        ObjectInstance::activate_pending_toggle_refs(cx);
         gjs_object_clear_toggles();
+        gjs_function_clear_async_closures();
+        gjs_list_iterator_release_pending();
     } else if (status == JSGC_END) {
         gjs_debug_lifecycle(GJS_DEBUG_CONTEXT, "End garbage collection");
+        TRACE(GJS_GC_END());
     }
 }
 
+// Only the slices of an incremental collection are counted towards its
+// duration, not the JS code that runs in between
+static void on_gc_slice(JSContext* cx, JS::GCProgress progress,
+                        const JS::GCDescription&) {
+    GjsContextPrivate* gjs = GjsContextPrivate::from_cx(cx);
+    switch (progress) {
+        case JS::GC_SLICE_BEGIN:
+            gjs->set_collecting(true);
+            break;
+        case JS::GC_SLICE_END:
+            gjs->set_collecting(false);
+            break;
+        case JS::GC_CYCLE_END:
+            gjs->finish_collection();
+            break;
+        default:
+            break;
+    }
+}
+
+static void on_nursery_collect(JSContext* cx, JS::GCNurseryProgress progress,
+                               JS::GCReason) {
+    GjsContextPrivate* gjs = GjsContextPrivate::from_cx(cx);
+    gjs->set_collecting_nursery(
+        progress == JS::GCNurseryProgress::GC_NURSERY_COLLECTION_START);
+}
+
 static void on_promise_unhandled_rejection(
     JSContext* cx, bool mutedErrors [[maybe_unused]], JS::HandleObject promise,
     JS::PromiseRejectionHandlingState state, void* data) {
@@ -146,6 +185,69 @@ bool gjs_load_internal_source(JSContext* cx, const char* filename, char** src,
     return true;
 }
 
+// Reports @original in the G_IO_ERROR domain, so that callers can check for
+// G_IO_ERROR_NOT_FOUND as with g_file_load_contents()
+static void propagate_not_found(GError** error, GError* original) {
+    g_set_error_literal(error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND,
+                        original->message);
+    g_error_free(original);
+}
+
+/*
+ * gjs_load_script_file:
+ * @file: a #GFile pointing to JS source code
+ * @error: return location for a #GError
+ *
+ * Loads the contents of @file without copying them where possible: files in
+ * GResources are returned from the resource data directly, and local files
+ * are mapped into memory. The returned bytes only need to stay alive until
+ * the script has been compiled, since SpiderMonkey keeps its own copy of the
+ * source, if any.
+ *
+ * Errors are in the G_IO_ERROR domain as with g_file_load_contents().
+ *
+ * Returns: (transfer full): the contents of @file, or %NULL on error
+ */
+GBytes* gjs_load_script_file(GFile* file, GError** error) {
+    if (g_file_has_uri_scheme(file, "resource")) {
+        GjsAutoChar uri = g_file_get_uri(file);
+        const char* path = uri.get() + 11;  // len("resource://")
+        GError* lookup_error = nullptr;
+        GBytes* bytes = g_resources_lookup_data(
+            path, G_RESOURCE_LOOKUP_FLAGS_NONE, &lookup_error);
+        if (!bytes) {
+            if (g_error_matches(lookup_error, G_RESOURCE_ERROR,
+                                G_RESOURCE_ERROR_NOT_FOUND))
+                propagate_not_found(error, lookup_error);
+            else
+                g_propagate_error(error, lookup_error);
+        }
+        return bytes;
+    }
+
+    GjsAutoChar path = g_file_get_path(file);
+    if (path) {
+        GError* map_error = nullptr;
+        GMappedFile* mapped = g_mapped_file_new(path, false, &map_error);
+        if (mapped) {
+            GBytes* bytes = g_mapped_file_get_bytes(mapped);
+            g_mapped_file_unref(mapped);
+            return bytes;
+        }
+
+        if (g_error_matches(map_error, G_FILE_ERROR, G_FILE_ERROR_NOENT)) {
+            propagate_not_found(error, map_error);
+            return nullptr;
+        }
+
+        // Directories and other files that can't be mapped are reported by
+        // the fallback below, with the error codes callers expect
+        g_error_free(map_error);
+    }
+
+    return g_file_load_bytes(file, nullptr, nullptr, error);
+}
+
 class GjsSourceHook : public js::SourceHook {
     bool load(JSContext* cx, const char* filename,
               char16_t** two_byte_source [[maybe_unused]], char** utf8_source,
@@ -201,9 +303,22 @@ public:
 static GjsInit gjs_is_inited;
 #endif
 
-JSContext* gjs_create_js_context(GjsContextPrivate* uninitialized_gjs) {
+// Identifies the bytecode produced by this build, so that SpiderMonkey can
+// reject cached bytecode (see script-cache.cpp) written by a different one
+static bool gjs_get_build_id(JS::BuildIdCharVector* build_id) {
+    const char* engine_version = JS_GetImplementationVersion();
+    return build_id->append(PACKAGE_STRING, strlen(PACKAGE_STRING)) &&
+           build_id->append(' ') &&
+           build_id->append(engine_version, strlen(engine_version));
+}
+
+JSContext* gjs_create_js_context(GjsContextPrivate* uninitialized_gjs,
+                                 JSRuntime* parent_runtime) {
     g_assert(gjs_is_inited);
-    JSContext *cx = JS_NewContext(32 * 1024 * 1024 /* max bytes */);
+    JS::SetProcessBuildIdOp(gjs_get_build_id);
+
+    JSContext* cx =
+        JS_NewContext(32 * 1024 * 1024 /* max bytes */, parent_runtime);
     if (!cx)
         return nullptr;
 
@@ -231,11 +346,18 @@ JSContext* gjs_create_js_context(GjsContextPrivate* uninitialized_gjs) {
 
     JS_AddFinalizeCallback(cx, gjs_finalize_callback, uninitialized_gjs);
     JS_SetGCCallback(cx, on_garbage_collect, uninitialized_gjs);
+    JS::SetGCSliceCallback(cx, on_gc_slice);
+    JS::SetGCNurseryCollectionCallback(cx, on_nursery_collect);
     JS::SetWarningReporter(cx, gjs_warning_reporter);
     JS::SetJobQueue(cx, dynamic_cast<JS::JobQueue*>(uninitialized_gjs));
     JS::SetPromiseRejectionTrackerCallback(cx, on_promise_unhandled_rejection,
                                            uninitialized_gjs);
 
+    JSRuntime* rt = JS_GetRuntime(cx);
+    JS::SetModuleResolveHook(rt, gjs_module_resolve);
+    JS::SetModuleMetadataHook(rt, gjs_populate_module_meta);
+    JS::SetModuleDynamicImportHook(rt, gjs_dynamic_module_resolve);
+
     // We use this to handle "lazy sources" that SpiderMonkey doesn't need to
     // keep in memory. Most sources should be kept in memory, but we can skip
     // doing that for the realm bootstrap code, as it is already in memory in
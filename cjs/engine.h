@@ -26,12 +26,21 @@
 
 #include <stddef.h>  // for size_t
 
+#include <gio/gio.h>
+
 class GjsContextPrivate;
 struct JSContext;
+struct JSRuntime;
 
-JSContext* gjs_create_js_context(GjsContextPrivate* uninitialized_gjs);
+// If @parent_runtime is given, the new context shares its immutable parts,
+// such as the self-hosted code and the permanent atoms, with that runtime,
+// which must outlive it
+JSContext* gjs_create_js_context(GjsContextPrivate* uninitialized_gjs,
+                                 JSRuntime* parent_runtime = nullptr);
 
 bool gjs_load_internal_source(JSContext* cx, const char* filename, char** src,
                               size_t* length);
 
+[[nodiscard]] GBytes* gjs_load_script_file(GFile* file, GError** error);
+
 #endif  // GJS_ENGINE_H_
@@ -0,0 +1,673 @@
+/* -*- mode: C++; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * SPDX-License-Identifier: MIT OR LGPL-2.0-or-later
+ */
+
+#include <config.h>
+
+#include <stdint.h>
+#include <string.h>  // for strchr, strcmp, strlen, strspn
+
+#include <algorithm>  // for copy_if, find, stable_partition
+#include <iterator>   // for back_inserter
+#include <memory>     // for unique_ptr
+#include <string>
+#include <unordered_set>
+#include <utility>  // for move
+#include <vector>
+
+#include <gio/gio.h>
+#include <glib.h>
+
+#include <js/Array.h>  // for GetArrayLength
+#include <js/CompileOptions.h>
+#include <js/OffThreadScriptCompilation.h>
+#include <js/PropertyDescriptor.h>  // for JSPROP_ENUMERATE
+#include <js/RootingAPI.h>
+#include <js/SourceText.h>
+#include <js/TypeDecls.h>
+#include <js/Utility.h>  // for UniqueChars
+#include <js/Value.h>
+#include <jsapi.h>  // for CompileModule, ModuleInstantiate, NewMapObject
+
+#include "cjs/context-private.h"
+#include "cjs/engine.h"
+#include "cjs/esm.h"
+#include "cjs/global.h"
+#include "cjs/jsapi-util.h"
+#include "util/log.h"
+
+// The registry maps the URI of each module to the module record, and lives in
+// a slot of the global object. The private value of each module record is its
+// URI, from which the specifiers that it imports are resolved.
+GJS_JSAPI_RETURN_CONVENTION
+static JSObject* module_registry(JSContext* cx) {
+    JS::RootedObject global(cx, gjs_get_import_global(cx));
+    JS::Value registry =
+        gjs_get_global_slot(global, GjsGlobalSlot::MODULE_REGISTRY);
+    if (registry.isObject())
+        return &registry.toObject();
+
+    JSObject* map = JS::NewMapObject(cx);
+    if (!map)
+        return nullptr;
+    gjs_set_global_slot(global, GjsGlobalSlot::MODULE_REGISTRY,
+                        JS::ObjectValue(*map));
+    return map;
+}
+
+// Sets @module_out to null if there is no module for @uri yet
+GJS_JSAPI_RETURN_CONVENTION
+static bool registry_lookup(JSContext* cx, const char* uri,
+                            JS::MutableHandleObject module_out) {
+    JS::RootedObject registry(cx, module_registry(cx));
+    JS::RootedValue key(cx), module(cx);
+    if (!registry || !gjs_string_from_utf8(cx, uri, &key) ||
+        !JS::MapGet(cx, registry, key, &module))
+        return false;
+
+    module_out.set(module.isObject() ? &module.toObject() : nullptr);
+    return true;
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool register_module(JSContext* cx, const char* uri,
+                            JS::HandleObject module) {
+    JS::RootedObject registry(cx, module_registry(cx));
+    JS::RootedValue key(cx);
+    JS::RootedValue module_value(cx, JS::ObjectValue(*module));
+    if (!registry || !gjs_string_from_utf8(cx, uri, &key))
+        return false;
+
+    JS::SetModulePrivate(module, key);
+    return JS::MapSet(cx, registry, key, module_value);
+}
+
+[[nodiscard]] static bool is_file_uri(const char* uri) {
+    return g_str_has_prefix(uri, "file://") ||
+           g_str_has_prefix(uri, "resource://");
+}
+
+// Returns the URI of the module that @specifier refers to, when it is imported
+// from the module at @base_uri, or from a script if @base_uri is null. Paths in
+// scripts are relative to the current directory.
+[[nodiscard]] static char* resolve_specifier(const char* specifier,
+                                             const char* base_uri) {
+    if (specifier[0] == '/' || (!base_uri && specifier[0] == '.')) {
+        GjsAutoUnref<GFile> file = g_file_new_for_commandline_arg(specifier);
+        return g_file_get_uri(file);
+    }
+
+    if (g_str_has_prefix(specifier, "./") ||
+        g_str_has_prefix(specifier, "../")) {
+        GjsAutoUnref<GFile> base = g_file_new_for_uri(base_uri);
+        GjsAutoUnref<GFile> dir = g_file_get_parent(base);
+        if (!dir)
+            return g_strdup(specifier);
+        GjsAutoUnref<GFile> file = g_file_resolve_relative_path(dir, specifier);
+        return g_file_get_uri(file);
+    }
+
+    // Normalize file URIs, so that each file is only loaded once
+    if (is_file_uri(specifier)) {
+        GjsAutoUnref<GFile> file = g_file_new_for_uri(specifier);
+        return g_file_get_uri(file);
+    }
+
+    // gi:// URIs and bare names of legacy modules are registry keys as they are
+    return g_strdup(specifier);
+}
+
+[[nodiscard]] static bool is_identifier(const char* name, size_t len) {
+    if (len == 0 || g_ascii_isdigit(name[0]))
+        return false;
+    for (size_t ix = 0; ix < len; ix++) {
+        if (!g_ascii_isalnum(name[ix]) && name[ix] != '_')
+            return false;
+    }
+    return true;
+}
+
+// Returns the source of the module that re-exports an introspected namespace
+// or a legacy module, or nullptr if @uri is not a valid name of one
+[[nodiscard]] static char* synthetic_module_source(const char* uri) {
+    if (!g_str_has_prefix(uri, "gi://")) {
+        if (!is_identifier(uri, strlen(uri)))
+            return nullptr;
+        return g_strdup_printf("export default imports.%s;\n", uri);
+    }
+
+    const char* ns = uri + strlen("gi://");
+    const char* query = strchr(ns, '?');
+    size_t ns_len = query ? query - ns : strlen(ns);
+    if (!is_identifier(ns, ns_len))
+        return nullptr;
+    GjsAutoChar ns_name = g_strndup(ns, ns_len);
+
+    if (!query)
+        return g_strdup_printf("export default imports.gi.%s;\n", ns_name.get());
+
+    if (!g_str_has_prefix(query, "?version="))
+        return nullptr;
+    const char* version = query + strlen("?version=");
+    if (!*version || version[strspn(version, "0123456789.")] != '\0')
+        return nullptr;
+
+    return g_strdup_printf(
+        "imports.gi.versions.%s = '%s';\nexport default imports.gi.%s;\n",
+        ns_name.get(), version, ns_name.get());
+}
+
+// Modules are always compiled from UTF-16, which CompileModule() requires, and
+// which is also what code coverage needs
+GJS_JSAPI_RETURN_CONVENTION
+static JSObject* compile_module(JSContext* cx, const char* uri,
+                                const char* source, size_t len) {
+    std::u16string utf16_source = gjs_utf8_script_to_utf16(source, len);
+    JS::SourceText<char16_t> buf;
+    if (!buf.init(cx, utf16_source.c_str(), utf16_source.size(),
+                  JS::SourceOwnership::Borrowed))
+        return nullptr;
+
+    JS::CompileOptions options(cx);
+    options.setFileAndLine(uri, 1);
+    return JS::CompileModule(cx, options, buf);
+}
+
+// Reads and compiles the module at @uri on the main thread, for modules that
+// were not fetched ahead of linking. This also reports the errors that were
+// ignored while fetching.
+GJS_JSAPI_RETURN_CONVENTION
+static JSObject* load_module_sync(JSContext* cx, const char* uri) {
+    JS::RootedObject module(cx);
+
+    if (is_file_uri(uri)) {
+        GjsAutoUnref<GFile> file = g_file_new_for_uri(uri);
+        GError* error = nullptr;
+        GjsAutoBytes bytes = gjs_load_script_file(file, &error);
+        if (!bytes) {
+            gjs_throw_custom(cx, JSProto_Error, "ImportError",
+                             "Unable to load module %s: %s", uri,
+                             error->message);
+            g_error_free(error);
+            return nullptr;
+        }
+
+        size_t len;
+        auto* source = static_cast<const char*>(g_bytes_get_data(bytes, &len));
+        module = compile_module(cx, uri, source ? source : "", len);
+    } else {
+        GjsAutoChar source = synthetic_module_source(uri);
+        if (!source) {
+            gjs_throw_custom(cx, JSProto_Error, "ImportError",
+                             "Unknown module '%s'", uri);
+            return nullptr;
+        }
+        module = compile_module(cx, uri, source, strlen(source));
+    }
+
+    if (!module || !register_module(cx, uri, module))
+        return nullptr;
+    return module;
+}
+
+// Gets the module for @uri from the registry, or loads it if it is not there
+GJS_JSAPI_RETURN_CONVENTION
+static JSObject* get_or_load_module(JSContext* cx, const char* uri) {
+    JS::RootedObject module(cx);
+    if (!registry_lookup(cx, uri, &module))
+        return nullptr;
+    if (module)
+        return module;
+    return load_module_sync(cx, uri);
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool link_and_evaluate(JSContext* cx, const char* uri) {
+    JS::RootedObject module(cx, get_or_load_module(cx, uri));
+    return module && JS::ModuleInstantiate(cx, module) &&
+           JS::ModuleEvaluate(cx, module);
+}
+
+// Fetches a module and everything that it imports, ahead of linking. Reads are
+// dispatched in @main_context, and each module is compiled as soon as it has
+// been read. The modules that a module imports are only known once it is
+// compiled, so the graph is discovered one level at a time. Modules that are
+// already in the registry are skipped along with their imports. Errors are
+// ignored here, and reported when linking loads the module again.
+class GjsModuleGraphLoad {
+    // A read in progress, which frees itself when it completes, even if the
+    // load was abandoned in the meantime
+    struct Fetch {
+        GjsModuleGraphLoad* load;
+        std::string uri;
+    };
+
+    // A compilation on a helper thread
+    struct OffThreadCompile {
+        GjsModuleGraphLoad* load;
+        std::string uri;
+        std::u16string source;  // must outlive the compilation
+        // Set by the helper thread when compilation is done
+        JS::OffThreadToken* token = nullptr;
+        bool finished = false;
+    };
+
+    static GMutex s_lock;
+    static GCond s_cond;
+
+    JSContext* m_cx;
+    GjsAutoUnref<GCancellable> m_cancellable;
+    // Dispatched in the main context when helper threads finish compiling
+    GSource* m_compiled_source;
+    std::unordered_set<std::string> m_seen;
+    std::vector<Fetch*> m_fetches;
+    std::vector<std::unique_ptr<OffThreadCompile>> m_compiles;
+    unsigned m_n_pending = 0;
+
+    static GSourceFuncs compiled_source_funcs;
+
+    static gboolean compiled_source_dispatch(GSource* source,
+                                             GSourceFunc callback,
+                                             void* data) {
+        g_source_set_ready_time(source, -1);
+        return callback(data);
+    }
+
+    void fetch(const char* uri) {
+        if (!m_seen.insert(uri).second)
+            return;
+
+        JS::RootedObject existing(m_cx);
+        if (!registry_lookup(m_cx, uri, &existing)) {
+            JS_ClearPendingException(m_cx);
+            return;
+        }
+        if (existing)
+            return;
+
+        if (!is_file_uri(uri)) {
+            // Nothing to read, and nothing imported
+            GjsAutoChar source = synthetic_module_source(uri);
+            if (source) {
+                JS::RootedObject module(
+                    m_cx, compile_module(m_cx, uri, source, strlen(source)));
+                compiled(uri, module);
+            }
+            return;
+        }
+
+        GjsAutoUnref<GFile> file = g_file_new_for_uri(uri);
+        if (g_file_has_uri_scheme(file, "resource")) {
+            // Already in memory
+            GjsAutoBytes bytes = gjs_load_script_file(file, nullptr);
+            if (bytes)
+                compile(uri, bytes);
+            return;
+        }
+
+        auto* fetch = new Fetch{this, uri};
+        m_fetches.push_back(fetch);
+        m_n_pending++;
+        g_file_load_bytes_async(file, m_cancellable,
+                                &GjsModuleGraphLoad::on_read, fetch);
+    }
+
+    static void on_read(GObject* file, GAsyncResult* result, void* data) {
+        std::unique_ptr<Fetch> fetch(static_cast<Fetch*>(data));
+        GError* error = nullptr;
+        GjsAutoBytes bytes =
+            g_file_load_bytes_finish(G_FILE(file), result, nullptr, &error);
+
+        GjsModuleGraphLoad* self = fetch->load;
+        if (!self) {
+            g_clear_error(&error);
+            return;
+        }
+
+        auto it =
+            std::find(self->m_fetches.begin(), self->m_fetches.end(), fetch.get());
+        self->m_fetches.erase(it);
+
+        if (bytes) {
+            self->compile(fetch->uri.c_str(), bytes);
+        } else {
+            gjs_debug(GJS_DEBUG_IMPORTER, "Could not read %s ahead of linking: %s",
+                      fetch->uri.c_str(), error->message);
+            g_error_free(error);
+        }
+
+        self->m_n_pending--;
+        self->check_done();
+    }
+
+    void compile(const char* uri, GBytes* bytes) {
+        JSAutoRealm ar(m_cx, GjsContextPrivate::from_cx(m_cx)->global());
+
+        size_t len;
+        auto* source = static_cast<const char*>(g_bytes_get_data(bytes, &len));
+
+        auto task = std::make_unique<OffThreadCompile>();
+        task->load = this;
+        task->uri = uri;
+        task->source = gjs_utf8_script_to_utf16(source ? source : "", len);
+
+        JS::SourceText<char16_t> buf;
+        if (!buf.init(m_cx, task->source.c_str(), task->source.size(),
+                      JS::SourceOwnership::Borrowed)) {
+            JS_ClearPendingException(m_cx);
+            return;
+        }
+
+        JS::CompileOptions options(m_cx);
+        options.setFileAndLine(uri, 1);
+
+        // Small modules are compiled faster in place
+        if (JS::CanCompileOffThread(m_cx, options, task->source.size())) {
+            if (JS::CompileOffThreadModule(
+                    m_cx, options, buf,
+                    &GjsModuleGraphLoad::on_compiled_off_thread, task.get())) {
+                gjs_debug(GJS_DEBUG_IMPORTER, "Compiling %s off thread", uri);
+                m_compiles.push_back(std::move(task));
+                m_n_pending++;
+                return;
+            }
+            JS_ClearPendingException(m_cx);
+        }
+
+        JS::RootedObject module(m_cx, JS::CompileModule(m_cx, options, buf));
+        compiled(uri, module);
+    }
+
+    // Called on a helper thread
+    static void on_compiled_off_thread(JS::OffThreadToken* token, void* data) {
+        auto* task = static_cast<OffThreadCompile*>(data);
+        g_mutex_lock(&s_lock);
+        task->token = token;
+        task->finished = true;
+        g_source_set_ready_time(task->load->m_compiled_source, 0);
+        g_cond_broadcast(&s_cond);
+        g_mutex_unlock(&s_lock);
+    }
+
+    static gboolean on_compiled(void* data) {
+        auto* self = static_cast<GjsModuleGraphLoad*>(data);
+        JSContext* cx = self->m_cx;
+
+        std::vector<std::unique_ptr<OffThreadCompile>> finished;
+        g_mutex_lock(&s_lock);
+        auto first_finished = std::stable_partition(
+            self->m_compiles.begin(), self->m_compiles.end(),
+            [](const auto& task) { return !task->finished; });
+        std::move(first_finished, self->m_compiles.end(),
+                  std::back_inserter(finished));
+        self->m_compiles.erase(first_finished, self->m_compiles.end());
+        g_mutex_unlock(&s_lock);
+
+        {
+            JSAutoRealm ar(cx, GjsContextPrivate::from_cx(cx)->global());
+            JS::RootedObject module(cx);
+            for (const auto& task : finished) {
+                module = JS::FinishOffThreadModule(cx, task->token);
+                self->compiled(task->uri.c_str(), module);
+                self->m_n_pending--;
+            }
+        }
+
+        self->check_done();
+        return G_SOURCE_CONTINUE;
+    }
+
+    void compiled(const char* uri, JS::HandleObject module) {
+        JS::RootedObject existing(m_cx);
+        // Another load may have registered the module in the meantime
+        if (!module || !registry_lookup(m_cx, uri, &existing) ||
+            (!existing && !register_module(m_cx, uri, module))) {
+            gjs_debug(GJS_DEBUG_IMPORTER,
+                      "Could not compile %s ahead of linking", uri);
+            JS_ClearPendingException(m_cx);
+            return;
+        }
+        if (!existing && !fetch_imports(uri, module))
+            JS_ClearPendingException(m_cx);
+    }
+
+    GJS_JSAPI_RETURN_CONVENTION
+    bool fetch_imports(const char* uri, JS::HandleObject module) {
+        JS::RootedObject requests(m_cx, JS::GetRequestedModules(m_cx, module));
+        uint32_t n_requests;
+        if (!requests || !JS::GetArrayLength(m_cx, requests, &n_requests))
+            return false;
+
+        JS::RootedValue request(m_cx);
+        JS::RootedString specifier(m_cx);
+        for (uint32_t ix = 0; ix < n_requests; ix++) {
+            if (!JS_GetElement(m_cx, requests, ix, &request))
+                return false;
+            specifier = JS::GetRequestedModuleSpecifier(m_cx, request);
+            if (!specifier)
+                return false;
+            JS::UniqueChars specifier_utf8 =
+                JS_EncodeStringToUTF8(m_cx, specifier);
+            if (!specifier_utf8)
+                return false;
+
+            GjsAutoChar import_uri =
+                resolve_specifier(specifier_utf8.get(), uri);
+            fetch(import_uri);
+        }
+        return true;
+    }
+
+    void check_done() {
+        if (m_n_pending == 0)
+            on_done();
+    }
+
+ protected:
+    // Called once the whole graph is fetched; may delete the load
+    virtual void on_done() {}
+
+ public:
+    GjsModuleGraphLoad(JSContext* cx, GMainContext* main_context)
+        : m_cx(cx), m_cancellable(g_cancellable_new()) {
+        m_compiled_source = g_source_new(&compiled_source_funcs, sizeof(GSource));
+        g_source_set_name(m_compiled_source, "GJS module compilation");
+        g_source_set_callback(m_compiled_source,
+                              &GjsModuleGraphLoad::on_compiled, this, nullptr);
+        g_source_attach(m_compiled_source, main_context);
+    }
+
+    virtual ~GjsModuleGraphLoad() {
+        g_cancellable_cancel(m_cancellable);
+        for (Fetch* fetch : m_fetches)
+            fetch->load = nullptr;
+
+        // Compilations on helper threads can't be interrupted
+        for (const auto& task : m_compiles) {
+            g_mutex_lock(&s_lock);
+            while (!task->finished)
+                g_cond_wait(&s_cond, &s_lock);
+            g_mutex_unlock(&s_lock);
+            JS::CancelOffThreadModule(m_cx, task->token);
+        }
+
+        g_source_destroy(m_compiled_source);
+        g_source_unref(m_compiled_source);
+    }
+
+    GjsModuleGraphLoad(const GjsModuleGraphLoad&) = delete;
+    GjsModuleGraphLoad& operator=(const GjsModuleGraphLoad&) = delete;
+
+    void start(const char* uri) {
+        {
+            JSAutoRealm ar(m_cx, GjsContextPrivate::from_cx(m_cx)->global());
+            fetch(uri);
+        }
+        check_done();
+    }
+
+    [[nodiscard]] bool pending() const { return m_n_pending > 0; }
+    [[nodiscard]] JSContext* context() const { return m_cx; }
+};
+
+GMutex GjsModuleGraphLoad::s_lock;
+GCond GjsModuleGraphLoad::s_cond;
+
+GSourceFuncs GjsModuleGraphLoad::compiled_source_funcs = {
+    nullptr,  // prepare; the ready time is set by the helper threads
+    nullptr,  // check
+    &GjsModuleGraphLoad::compiled_source_dispatch,
+    nullptr,  // finalize; the load owns the source
+};
+
+bool gjs_module_load_and_evaluate(JSContext* cx, const char* uri) {
+    // Fetching runs nothing but our own callbacks, so that no JS can run
+    // before the module graph does
+    GjsAutoPointer<GMainContext, GMainContext, g_main_context_unref>
+        main_context = g_main_context_new();
+    g_main_context_push_thread_default(main_context);
+    {
+        GjsModuleGraphLoad load(cx, main_context);
+        load.start(uri);
+        while (load.pending())
+            g_main_context_iteration(main_context, true);
+    }
+    g_main_context_pop_thread_default(main_context);
+
+    return link_and_evaluate(cx, uri);
+}
+
+JSObject* gjs_module_resolve(JSContext* cx,
+                             JS::HandleValue importing_module_priv,
+                             JS::HandleString specifier) {
+    JS::UniqueChars base_uri;
+    if (importing_module_priv.isString()) {
+        JS::RootedString base(cx, importing_module_priv.toString());
+        base_uri = JS_EncodeStringToUTF8(cx, base);
+        if (!base_uri)
+            return nullptr;
+    }
+
+    JS::UniqueChars specifier_utf8 = JS_EncodeStringToUTF8(cx, specifier);
+    if (!specifier_utf8)
+        return nullptr;
+
+    GjsAutoChar uri = resolve_specifier(specifier_utf8.get(), base_uri.get());
+    return get_or_load_module(cx, uri);
+}
+
+bool gjs_populate_module_meta(JSContext* cx, JS::HandleValue module_priv,
+                              JS::HandleObject meta) {
+    if (!module_priv.isString())
+        return true;
+    return JS_DefineProperty(cx, meta, "url", module_priv, JSPROP_ENUMERATE);
+}
+
+// A dynamic import(), which fetches the module graph in the background and
+// settles the import's promise once it is evaluated
+class GjsDynamicImport : public GjsModuleGraphLoad {
+    JS::PersistentRootedValue m_importing_module_priv;
+    JS::PersistentRootedString m_specifier;
+    JS::PersistentRootedObject m_promise;
+    GjsAutoChar m_uri;
+    GjsAutoPointer<GSource, GSource, g_source_unref> m_start_source;
+
+    // Loads that are in progress, to abandon them when the context goes away
+    static thread_local std::vector<GjsDynamicImport*> s_in_progress;
+
+    void on_done() override {
+        JSContext* cx = context();
+        JSAutoRealm ar(cx, GjsContextPrivate::from_cx(cx)->global());
+
+        // On failure, FinishDynamicModuleImport() rejects the promise with the
+        // pending exception; otherwise it resolves it with the module's
+        // namespace, which it gets from the resolve hook
+        if (link_and_evaluate(cx, m_uri) || JS_IsExceptionPending(cx)) {
+            if (!JS::FinishDynamicModuleImport(cx, m_importing_module_priv,
+                                               m_specifier, m_promise))
+                gjs_log_exception(cx);
+        }
+
+        delete this;
+    }
+
+ public:
+    GjsDynamicImport(JSContext* cx, JS::HandleValue importing_module_priv,
+                     JS::HandleString specifier, JS::HandleObject promise,
+                     char* uri)
+        : GjsModuleGraphLoad(cx, g_main_context_get_thread_default()),
+          m_importing_module_priv(cx, importing_module_priv),
+          m_specifier(cx, specifier),
+          m_promise(cx, promise),
+          m_uri(uri) {
+        s_in_progress.push_back(this);
+    }
+
+    ~GjsDynamicImport() override {
+        if (m_start_source)
+            g_source_destroy(m_start_source);
+        auto it =
+            std::find(s_in_progress.begin(), s_in_progress.end(), this);
+        s_in_progress.erase(it);
+    }
+
+    // The promise is settled from the main loop even if the whole graph is
+    // already loaded, as import() is always asynchronous
+    void start() {
+        m_start_source = g_idle_source_new();
+        g_source_set_callback(
+            m_start_source,
+            [](void* data) {
+                auto* self = static_cast<GjsDynamicImport*>(data);
+                g_source_destroy(self->m_start_source);
+                self->m_start_source = nullptr;
+                self->GjsModuleGraphLoad::start(self->m_uri);
+                return G_SOURCE_REMOVE;
+            },
+            this, nullptr);
+        g_source_attach(m_start_source, g_main_context_get_thread_default());
+    }
+
+    static void cancel_all(JSContext* cx) {
+        std::vector<GjsDynamicImport*> canceled;
+        std::copy_if(s_in_progress.begin(), s_in_progress.end(),
+                     std::back_inserter(canceled),
+                     [cx](GjsDynamicImport* load) {
+                         return load->context() == cx;
+                     });
+        for (GjsDynamicImport* load : canceled)
+            delete load;
+    }
+};
+
+thread_local std::vector<GjsDynamicImport*> GjsDynamicImport::s_in_progress;
+
+bool gjs_dynamic_module_resolve(JSContext* cx,
+                                JS::HandleValue importing_module_priv,
+                                JS::HandleString specifier,
+                                JS::HandleObject internal_promise) {
+    JS::UniqueChars base_uri;
+    if (importing_module_priv.isString()) {
+        JS::RootedString base(cx, importing_module_priv.toString());
+        base_uri = JS_EncodeStringToUTF8(cx, base);
+        if (!base_uri)
+            return false;
+    }
+
+    JS::UniqueChars specifier_utf8 = JS_EncodeStringToUTF8(cx, specifier);
+    if (!specifier_utf8)
+        return false;
+
+    char* uri = resolve_specifier(specifier_utf8.get(), base_uri.get());
+    gjs_debug(GJS_DEBUG_IMPORTER, "Dynamically importing %s", uri);
+
+    auto* load = new GjsDynamicImport(cx, importing_module_priv, specifier,
+                                      internal_promise, uri);
+    load->start();
+    return true;
+}
+
+void gjs_cancel_module_loads(JSContext* cx) {
+    GjsDynamicImport::cancel_all(cx);
+}
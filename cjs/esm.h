@@ -0,0 +1,53 @@
+/* -*- mode: C++; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * SPDX-License-Identifier: MIT OR LGPL-2.0-or-later
+ */
+
+#ifndef GJS_ESM_H_
+#define GJS_ESM_H_
+
+#include <config.h>
+
+#include <js/TypeDecls.h>
+
+#include "cjs/macros.h"
+
+// esm.h - Loader for ES modules, with import/export and dynamic import().
+//
+// Before a module is linked, the graph of modules that it imports is fetched
+// as a whole: each file is read asynchronously through GIO and compiled as
+// soon as it has been read, on a helper thread if it is large enough, while
+// the files that it imports are being read in turn. Independent modules are
+// thus read and compiled in parallel, and by the time the graph is linked on
+// the main thread, the resolve hook only has to look modules up in the
+// registry.
+//
+// Specifiers are paths relative to the importing module, absolute paths,
+// file:// and resource:// URIs, "gi://Namespace" or
+// "gi://Namespace?version=X" for an introspected namespace, and bare names of
+// modules found by the legacy importer, such as "system". The last two are
+// modules whose default export is the namespace or the legacy module.
+
+// Loads the module at @uri and everything that it imports, then links and
+// evaluates them. Runs a private main context until all the files are read.
+GJS_JSAPI_RETURN_CONVENTION
+bool gjs_module_load_and_evaluate(JSContext* cx, const char* uri);
+
+// Hooks for the SpiderMonkey runtime, see gjs_create_js_context()
+GJS_JSAPI_RETURN_CONVENTION
+JSObject* gjs_module_resolve(JSContext* cx,
+                             JS::HandleValue importing_module_priv,
+                             JS::HandleString specifier);
+GJS_JSAPI_RETURN_CONVENTION
+bool gjs_populate_module_meta(JSContext* cx, JS::HandleValue module_priv,
+                              JS::HandleObject meta);
+GJS_JSAPI_RETURN_CONVENTION
+bool gjs_dynamic_module_resolve(JSContext* cx,
+                                JS::HandleValue importing_module_priv,
+                                JS::HandleString specifier,
+                                JS::HandleObject internal_promise);
+
+// Abandons the loads for dynamic import() that are still in progress
+void gjs_cancel_module_loads(JSContext* cx);
+
+#endif  // GJS_ESM_H_
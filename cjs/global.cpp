@@ -40,21 +40,18 @@
 #include <js/Realm.h>  // for GetObjectRealmOrNull, SetRealmPrivate
 #include <js/RealmOptions.h>
 #include <js/RootingAPI.h>
-#include <js/SourceText.h>
 #include <js/TypeDecls.h>
 #include <js/Utility.h>  // for UniqueChars
 #include <jsapi.h>       // for AutoSaveExceptionState, ...
 
 #include "cjs/atoms.h"
+#include "cjs/byteArray.h"
 #include "cjs/context-private.h"
 #include "cjs/engine.h"
 #include "cjs/global.h"
 #include "cjs/jsapi-util.h"
 #include "cjs/native.h"
-
-namespace mozilla {
-union Utf8Unit;
-}
+#include "cjs/script-cache.h"
 
 class GjsBaseGlobal {
     static JSObject* base(JSContext* cx, const JSClass* clasp,
@@ -105,17 +102,16 @@ class GjsBaseGlobal {
         JS::CompileOptions options(cx);
         options.setFileAndLine(uri, 1).setSourceIsLazy(true);
 
-        char* script;
+        char* script_unowned;
         size_t script_len;
-        if (!gjs_load_internal_source(cx, uri, &script, &script_len))
-            return false;
-
-        JS::SourceText<mozilla::Utf8Unit> source;
-        if (!source.init(cx, script, script_len,
-                         JS::SourceOwnership::TakeOwnership))
+        if (!gjs_load_internal_source(cx, uri, &script_unowned, &script_len))
             return false;
+        GjsAutoChar script = script_unowned;
 
-        JS::RootedScript compiled_script(cx, JS::Compile(cx, options, source));
+        // Goes through the bytecode cache, if enabled, so that new contexts
+        // and processes don't need to compile the bootstrap code again
+        JS::RootedScript compiled_script(
+            cx, gjs_compile_global_script(cx, options, script, script_len));
         if (!compiled_script)
             return false;
 
@@ -190,7 +186,8 @@ class GjsGlobal : GjsBaseGlobal {
         if (!JS_DefinePropertyById(cx, global, atoms.window(), global,
                                    JSPROP_READONLY | JSPROP_PERMANENT) ||
             !JS_DefineFunctions(cx, global, GjsGlobal::static_funcs) ||
-            !JS_DefineProperties(cx, global, GjsGlobal::static_props))
+            !JS_DefineProperties(cx, global, GjsGlobal::static_props) ||
+            !gjs_define_json_bytes_funcs(cx, global))
             return false;
 
         JS::Realm* realm = JS::GetObjectRealmOrNull(global);
@@ -56,6 +56,8 @@ enum class GjsGlobalSlot : uint32_t {
     PROTOTYPE_function,
     PROTOTYPE_ns,
     PROTOTYPE_repo,
+    PROTOTYPE_hash_table_view,
+    PROTOTYPE_list_iterator,
     PROTOTYPE_cairo_context,
     PROTOTYPE_cairo_gradient,
     PROTOTYPE_cairo_image_surface,
@@ -70,6 +72,8 @@ enum class GjsGlobalSlot : uint32_t {
     PROTOTYPE_cairo_surface,
     PROTOTYPE_cairo_surface_pattern,
     PROTOTYPE_cairo_svg_surface,
+    // Map from URIs to ES module records, see esm.cpp
+    MODULE_REGISTRY,
     LAST,
 };
 
@@ -0,0 +1,299 @@
+/* -*- mode: C++; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * SPDX-License-Identifier: MIT OR LGPL-2.0-or-later
+ */
+
+#include <config.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>  // for strcmp
+
+#ifdef __GLIBC__
+#    include <malloc.h>  // for malloc_usable_size
+#endif
+
+#include <algorithm>  // for reverse
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <glib.h>
+
+#include <js/GCAPI.h>  // for AutoCheckCannotGC
+#include <js/TypeDecls.h>
+#include <js/UbiNode.h>
+#include <js/UbiNodeBreadthFirst.h>
+#include <js/Value.h>
+#include <mozilla/Maybe.h>
+
+#include "cjs/heap-snapshot.h"
+#include "cjs/jsapi-util.h"
+
+using JS::ubi::Node;
+
+static constexpr const char GJS_HEAP_SNAPSHOT_MAGIC[8] = {
+    'C', 'J', 'S', 'H', 'E', 'A', 'P', '1'};
+
+static size_t snapshot_malloc_size_of(const void* ptr) {
+#ifdef __GLIBC__
+    return malloc_usable_size(const_cast<void*>(ptr));
+#else
+    return 0;
+#endif
+}
+
+[[nodiscard]] static bool is_gi_wrapper(const Node& node) {
+    static const char* wrapper_classes[] = {
+        "GObject_Object", "GObject_Boxed",     "GObject_Union",
+        "GLib_Error",     "GObject_ParamSpec", "GFundamental_Object",
+    };
+
+    const char* class_name = node.jsObjectClassName();
+    if (!class_name)
+        return false;
+    for (const char* wrapper_class : wrapper_classes) {
+        if (strcmp(class_name, wrapper_class) == 0)
+            return true;
+    }
+    return false;
+}
+
+class HeapSnapshotWriter {
+    FILE* m_fp;
+    // Keys are never removed, so the pointers in m_strings stay valid
+    std::unordered_map<std::string, uint32_t> m_string_ids;
+    std::vector<const std::string*> m_strings;
+    std::vector<bool> m_string_written;
+    std::unordered_map<const char16_t*, uint32_t> m_type_name_ids;
+
+    template <typename T>
+    void write(T value) {
+        fwrite(&value, sizeof(value), 1, m_fp);
+    }
+
+    void write_string_ref(uint32_t id) {
+        if (id == 0 || m_string_written[id - 1])
+            return;
+        m_string_written[id - 1] = true;
+
+        const std::string* str = m_strings[id - 1];
+        write('S');
+        write(id);
+        write(uint32_t(str->size()));
+        fwrite(str->data(), 1, str->size(), m_fp);
+    }
+
+ public:
+    explicit HeapSnapshotWriter(FILE* fp) : m_fp(fp) {}
+
+    [[nodiscard]] uint32_t intern(const char* str) {
+        if (!str)
+            return 0;
+        auto result = m_string_ids.emplace(str, m_string_ids.size() + 1);
+        if (result.second) {
+            m_strings.push_back(&result.first->first);
+            m_string_written.push_back(false);
+        }
+        return result.first->second;
+    }
+
+    [[nodiscard]] const char* string(uint32_t id) const {
+        return id == 0 ? nullptr : m_strings[id - 1]->c_str();
+    }
+
+    [[nodiscard]] uint32_t intern(const char16_t* str) {
+        if (!str)
+            return 0;
+        GjsAutoChar utf8 = g_utf16_to_utf8(
+            reinterpret_cast<const gunichar2*>(str), -1, nullptr, nullptr,
+            nullptr);
+        return intern(utf8.get());
+    }
+
+    // Type names are static strings, so converting them once is enough
+    [[nodiscard]] uint32_t intern_type_name(const char16_t* type_name) {
+        auto it = m_type_name_ids.find(type_name);
+        if (it != m_type_name_ids.end())
+            return it->second;
+        uint32_t id = intern(type_name);
+        m_type_name_ids.emplace(type_name, id);
+        return id;
+    }
+
+    void write_header() { fwrite(GJS_HEAP_SNAPSHOT_MAGIC, 1, 8, m_fp); }
+
+    void write_node(const Node& node) {
+        uint32_t type = intern_type_name(node.typeName());
+        uint32_t klass = intern(node.jsObjectClassName());
+        write_string_ref(type);
+        write_string_ref(klass);
+        write('N');
+        write(uint64_t(node.identifier()));
+        write(type);
+        write(klass);
+        write(uint64_t(node.size(snapshot_malloc_size_of)));
+    }
+
+    void write_edge(const Node& from, const Node& to, uint32_t name) {
+        write_string_ref(name);
+        write('E');
+        write(uint64_t(from.identifier()));
+        write(uint64_t(to.identifier()));
+        write(name);
+    }
+
+    [[nodiscard]] bool finish() {
+        write('X');
+        return !ferror(m_fp);
+    }
+};
+
+// Writes every node and edge as soon as the traversal reaches it
+struct StreamingHandler {
+    using Traversal = JS::ubi::BreadthFirst<StreamingHandler>;
+    struct NodeData {};
+
+    HeapSnapshotWriter* writer;
+
+    bool operator()(Traversal&, Node origin, const JS::ubi::Edge& edge,
+                    NodeData*, bool first) {
+        if (first)
+            writer->write_node(edge.referent);
+        writer->write_edge(origin, edge.referent,
+                           writer->intern(edge.name.get()));
+        return true;
+    }
+};
+
+// Only remembers how each node was first reached; since the traversal is
+// breadth-first, following these back to the roots gives a shortest path
+struct RetentionHandler {
+    using Traversal = JS::ubi::BreadthFirst<RetentionHandler>;
+    struct NodeData {
+        Node parent;
+        uint32_t edge_name = 0;
+        bool written = false;
+    };
+
+    HeapSnapshotWriter* writer;
+    // If set, the traversal stops once it has reached all of these
+    std::unordered_set<Node::Id>* targets = nullptr;
+
+    bool operator()(Traversal& traversal, Node origin,
+                    const JS::ubi::Edge& edge, NodeData* referent_data,
+                    bool first) {
+        if (first) {
+            referent_data->parent = origin;
+            referent_data->edge_name = writer->intern(edge.name.get());
+
+            if (targets && targets->erase(edge.referent.identifier()) &&
+                targets->empty())
+                traversal.stop();
+        }
+        return true;
+    }
+};
+
+static void write_retention_paths(HeapSnapshotWriter* writer,
+                                  RetentionHandler::Traversal* traversal) {
+    auto& visited = traversal->visited;
+    for (auto iter = visited.iter(); !iter.done(); iter.next()) {
+        if (!is_gi_wrapper(iter.get().key()))
+            continue;
+
+        Node node = iter.get().key();
+        auto entry = visited.lookup(node);
+        while (entry && !entry->value().written) {
+            RetentionHandler::NodeData& data = entry->value();
+            data.written = true;
+            writer->write_node(node);
+            writer->write_edge(data.parent, node, data.edge_name);
+
+            node = data.parent;
+            entry = visited.lookup(node);
+        }
+    }
+}
+
+bool gjs_write_heap_snapshot(JSContext* cx, FILE* fp,
+                             GjsHeapSnapshotFilter filter) {
+    mozilla::Maybe<JS::AutoCheckCannotGC> nogc;
+    JS::ubi::RootList roots(cx, nogc, /* wantNames = */ true);
+    if (!roots.init())
+        return false;
+
+    HeapSnapshotWriter writer(fp);
+    Node root(&roots);
+
+    writer.write_header();
+    writer.write_node(root);
+
+    if (filter == GjsHeapSnapshotFilter::ALL) {
+        StreamingHandler handler{&writer};
+        StreamingHandler::Traversal traversal(cx, handler, nogc.ref());
+        traversal.wantNames = true;
+        if (!traversal.addStart(root) || !traversal.traverse())
+            return false;
+    } else {
+        RetentionHandler handler{&writer};
+        RetentionHandler::Traversal traversal(cx, handler, nogc.ref());
+        traversal.wantNames = true;
+        if (!traversal.addStart(root) || !traversal.traverse())
+            return false;
+        write_retention_paths(&writer, &traversal);
+    }
+
+    return writer.finish();
+}
+
+static std::string describe_node(const Node& node) {
+    if (node.is<JSObject>())
+        return gjs_debug_value(JS::ObjectValue(*node.as<JSObject>()));
+
+    GjsAutoChar type_name = g_utf16_to_utf8(
+        reinterpret_cast<const gunichar2*>(node.typeName()), -1, nullptr,
+        nullptr, nullptr);
+    return type_name.get();
+}
+
+bool gjs_find_retaining_paths(JSContext* cx,
+                              const std::vector<JSObject*>& targets,
+                              std::vector<GjsRetainingPath>* paths) {
+    mozilla::Maybe<JS::AutoCheckCannotGC> nogc;
+    JS::ubi::RootList roots(cx, nogc, /* wantNames = */ true);
+    if (!roots.init())
+        return false;
+
+    // Only used for interning edge names
+    HeapSnapshotWriter names(nullptr);
+    std::unordered_set<Node::Id> remaining;
+    for (JSObject* target : targets)
+        remaining.insert(Node(target).identifier());
+
+    RetentionHandler handler{&names, &remaining};
+    RetentionHandler::Traversal traversal(cx, handler, nogc.ref());
+    traversal.wantNames = true;
+    if (!traversal.addStart(Node(&roots)) || !traversal.traverse())
+        return false;
+
+    paths->clear();
+    paths->reserve(targets.size());
+    for (JSObject* target : targets) {
+        GjsRetainingPath& path = paths->emplace_back();
+        Node node(target);
+        auto entry = traversal.visited.lookup(node);
+        while (entry) {
+            const RetentionHandler::NodeData& data = entry->value();
+            const char* name = names.string(data.edge_name);
+            path.push_back(
+                {node.identifier(), describe_node(node), name ? name : ""});
+            node = data.parent;
+            entry = traversal.visited.lookup(node);
+        }
+        std::reverse(path.begin(), path.end());
+    }
+
+    return true;
+}
@@ -0,0 +1,59 @@
+/* -*- mode: C++; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * SPDX-License-Identifier: MIT OR LGPL-2.0-or-later
+ */
+
+#ifndef GJS_HEAP_SNAPSHOT_H_
+#define GJS_HEAP_SNAPSHOT_H_
+
+#include <config.h>
+
+#include <stdint.h>
+#include <stdio.h>  // for FILE
+
+#include <string>
+#include <vector>
+
+#include <js/TypeDecls.h>
+
+// A heap snapshot is a much smaller and faster alternative to js::DumpHeap().
+// It is written while walking the heap breadth-first from the GC roots, as a
+// stream of records in host byte order, after the 8-byte magic "CJSHEAP1":
+//
+//   'S' u32 id, u32 length, UTF-8 bytes   string table entry, written before
+//                                          the first record that uses it
+//   'N' u64 node, u32 type, u32 class, u64 size
+//                                          node; class is 0 for non-objects
+//   'E' u64 from, u64 to, u32 name         edge; name is 0 if unknown
+//   'X'                                    end of the snapshot
+//
+// Node IDs are arbitrary 64-bit numbers; the first node written is the root
+// list. Sizes are the shallow size of GC cells and the memory they own.
+enum class GjsHeapSnapshotFilter {
+    ALL,
+    // Only GI wrapper objects, plus the nodes and edges of the shortest path
+    // that keeps each of them alive
+    GI_WRAPPERS,
+};
+
+[[nodiscard]] bool gjs_write_heap_snapshot(JSContext* cx, FILE* fp,
+                                           GjsHeapSnapshotFilter filter);
+
+// One step of the shortest chain of references from the GC roots to a cell:
+// the cell, and the name of the reference to it from the previous step, or
+// from the root list for the first step
+struct GjsRetainingEdge {
+    uint64_t address;
+    std::string description;
+    std::string name;  // empty if the engine has no name for it
+};
+using GjsRetainingPath = std::vector<GjsRetainingEdge>;
+
+// Fills @paths with the path to each of @targets, in the same order; a path is
+// empty if its target is not reachable. Nothing is collected meanwhile, so the
+// addresses can be compared against other pointers taken before the call.
+[[nodiscard]] bool gjs_find_retaining_paths(
+    JSContext* cx, const std::vector<JSObject*>& targets,
+    std::vector<GjsRetainingPath>* paths);
+
+#endif  // GJS_HEAP_SNAPSHOT_H_
@@ -23,19 +23,23 @@
 
 #include <config.h>
 
-#include <string.h>  // for size_t, strcmp, strlen
+#include <string.h>  // for size_t, strcmp, strlen, strstr
+#include <sys/types.h>  // for dev_t, ino_t
 
 #ifdef _WIN32
 #    define WIN32_LEAN_AND_MEAN
 #    include <windows.h>
 #endif
 
+#include <memory>  // for unique_ptr
 #include <string>
+#include <unordered_map>
 #include <vector>   // for vector
 
 #include <gio/gio.h>
 #include <glib-object.h>
 #include <glib.h>
+#include <glib/gstdio.h>  // for GStatBuf, g_stat
 
 #include <js/Array.h>
 #include <js/CallArgs.h>
@@ -56,12 +60,14 @@
 
 #include "cjs/atoms.h"
 #include "cjs/context-private.h"
+#include "cjs/engine.h"
 #include "cjs/importer.h"
 #include "cjs/jsapi-class.h"
 #include "cjs/jsapi-util.h"
 #include "cjs/mem-private.h"
 #include "cjs/module.h"
 #include "cjs/native.h"
+#include "cjs/profiler-private.h"
 #include "util/log.h"
 
 #define MODULE_INIT_FILENAME "__init__.js"
@@ -70,6 +76,147 @@ typedef struct {
     bool is_root;
 } Importer;
 
+// Identity and modification time of a search path directory. Adding,
+// removing, or renaming an entry changes the modification time, and the
+// identity tells whether a relative path now means another directory.
+struct DirectoryStamp {
+    dev_t device = 0;
+    ino_t inode = 0;
+    int64_t mtime_usec = -1;  // -1 if the directory doesn't exist
+
+    [[nodiscard]] bool operator==(const DirectoryStamp& other) const {
+        return device == other.device && inode == other.inode &&
+               mtime_usec == other.mtime_usec;
+    }
+    [[nodiscard]] bool operator!=(const DirectoryStamp& other) const {
+        return !(*this == other);
+    }
+};
+
+// Snapshot of the entries of a search path directory, so that resolving an
+// import does not have to stat each candidate file in each directory. Each
+// lookup checks the directory's stamp with one stat() instead, and lists the
+// directory again if it changed, or after gjs_importer_clear_directory_cache().
+struct DirectoryListing {
+    std::unordered_map<std::string, GFileType> entries;
+    DirectoryStamp stamp;
+    bool stale : 1;
+
+    [[nodiscard]] bool contains(const char* name) const {
+        return entries.find(name) != entries.end();
+    }
+    [[nodiscard]] GFileType type(const char* name) const {
+        auto it = entries.find(name);
+        return it == entries.end() ? G_FILE_TYPE_UNKNOWN : it->second;
+    }
+};
+
+// Keyed by search path element. Each JS thread has its own, which it frees
+// when memory is low.
+static thread_local std::unordered_map<std::string,
+                                       std::unique_ptr<DirectoryListing>>
+    s_directory_listings;
+
+// A modification time can stay the same over several changes in a row, as
+// timestamps have a limited resolution, so a listing made this soon after a
+// change is not trusted
+static constexpr int64_t RECENT_CHANGE_USEC = G_USEC_PER_SEC;
+
+// Returns false for directories that can't be checked that way: resources
+// can't change, and directories that aren't local paths are listed again at
+// each lookup
+[[nodiscard]] static bool stat_directory(const char* dirname,
+                                         DirectoryStamp* stamp) {
+    if (strstr(dirname, "://"))
+        return false;
+
+    GStatBuf buf;
+    if (g_stat(dirname, &buf) != 0) {
+        *stamp = DirectoryStamp();
+        return true;
+    }
+    stamp->device = buf.st_dev;
+    stamp->inode = buf.st_ino;
+#ifdef _WIN32
+    stamp->mtime_usec = int64_t{buf.st_mtime} * G_USEC_PER_SEC;
+#else
+    stamp->mtime_usec = int64_t{buf.st_mtim.tv_sec} * G_USEC_PER_SEC +
+                        buf.st_mtim.tv_nsec / 1000;
+#endif
+    return true;
+}
+
+static void fill_directory_listing(DirectoryListing* listing,
+                                   const char* dirname) {
+    listing->entries.clear();
+    listing->stale = false;
+
+    /* new_for_commandline_arg handles resource:/// paths */
+    GjsAutoUnref<GFile> dir = g_file_new_for_commandline_arg(dirname);
+
+    GjsAutoUnref<GFileEnumerator> direnum =
+        g_file_enumerate_children(dir, "standard::name,standard::type",
+                                  G_FILE_QUERY_INFO_NONE, nullptr, nullptr);
+    if (!direnum)
+        return;  // nonexistent directories just have no entries
+
+    while (true) {
+        GFileInfo* info;
+        if (!g_file_enumerator_iterate(direnum, &info, nullptr, nullptr,
+                                       nullptr) ||
+            !info)
+            break;
+
+        listing->entries.emplace(g_file_info_get_name(info),
+                                 g_file_info_get_file_type(info));
+    }
+}
+
+[[nodiscard]] static const DirectoryListing& directory_listing(
+    const char* dirname) {
+    std::unique_ptr<DirectoryListing>& listing = s_directory_listings[dirname];
+    bool is_new = !listing;
+    if (is_new)
+        listing = std::make_unique<DirectoryListing>();
+
+    // Stat before listing, so that a change in between shows up as a new
+    // stamp at the next lookup instead of being missed
+    DirectoryStamp stamp;
+    if (!stat_directory(dirname, &stamp)) {
+        if (is_new || !g_str_has_prefix(dirname, "resource://"))
+            fill_directory_listing(listing.get(), dirname);
+        return *listing;
+    }
+
+    if (is_new || listing->stale || stamp != listing->stamp) {
+        fill_directory_listing(listing.get(), dirname);
+        listing->stamp = stamp;
+        listing->stale =
+            g_get_real_time() - stamp.mtime_usec < RECENT_CHANGE_USEC;
+    }
+    return *listing;
+}
+
+/*
+ * gjs_importer_clear_directory_cache:
+ *
+ * Forgets the cached listings of search path directories, so that they are
+ * listed again at the next lookup even if their modification time looks the
+ * same, as it can on file systems with a coarse timestamp resolution.
+ */
+void gjs_importer_clear_directory_cache(void) {
+    for (auto& it : s_directory_listings)
+        it.second->stale = true;
+}
+
+/*
+ * gjs_importer_free_directory_cache:
+ *
+ * Frees the cached listings of search path directories, for example when
+ * memory is low. They are listed again when next needed.
+ */
+void gjs_importer_free_directory_cache(void) { s_directory_listings.clear(); }
+
 extern const JSClass gjs_importer_class;
 
 GJS_DEFINE_PRIV_FROM_JS(Importer, gjs_importer_class)
@@ -311,15 +458,13 @@ import_module_init(JSContext       *context,
                    GFile           *file,
                    JS::HandleObject module_obj)
 {
-    gsize script_len = 0;
     GError *error = NULL;
 
     GjsContextPrivate* gjs = GjsContextPrivate::from_cx(context);
     JS::RootedValue ignored(context);
 
-    char* script_unowned;
-    if (!(g_file_load_contents(file, nullptr, &script_unowned, &script_len,
-                               nullptr, &error))) {
+    GjsAutoBytes script_bytes = gjs_load_script_file(file, &error);
+    if (!script_bytes) {
         if (!g_error_matches(error, G_IO_ERROR, G_IO_ERROR_IS_DIRECTORY) &&
             !g_error_matches(error, G_IO_ERROR, G_IO_ERROR_NOT_DIRECTORY) &&
             !g_error_matches(error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND))
@@ -330,8 +475,11 @@ import_module_init(JSContext       *context,
         return false;
     }
 
-    GjsAutoChar script = script_unowned;
-    g_assert(script);
+    size_t script_len;
+    auto* script =
+        static_cast<const char*>(g_bytes_get_data(script_bytes, &script_len));
+    if (!script)
+        script = "";
 
     GjsAutoChar full_path = g_file_get_parse_name(file);
 
@@ -473,7 +621,7 @@ static bool do_import(JSContext* context, JS::HandleObject obj, Importer* priv,
     JS::RootedObject search_path(context);
     guint32 search_path_len;
     guint32 i;
-    bool exists, is_array;
+    bool is_array;
     const GjsAtoms& atoms = GjsContextPrivate::atoms(context);
 
     if (!gjs_object_require_property(context, obj, "importer",
@@ -492,25 +640,27 @@ static bool do_import(JSContext* context, JS::HandleObject obj, Importer* priv,
         return false;
     }
 
-    JS::UniqueChars name;
-    if (!gjs_get_string_id(context, id, &name))
+    const char* name;
+    if (!gjs_get_interned_string_id(context, id, &name))
         return false;
     if (!name) {
         gjs_throw(context, "Importing invalid module name");
         return false;
     }
 
+    GjsProfilerScope profiler_scope(context, "Import", name);
+
     /* First try importing an internal module like gi */
-    if (priv->is_root && gjs_is_registered_native_module(name.get())) {
-        if (!gjs_import_native_module(context, obj, name.get()))
+    if (priv->is_root && gjs_is_registered_native_module(name)) {
+        if (!gjs_import_native_module(context, obj, name))
             return false;
 
         gjs_debug(GJS_DEBUG_IMPORTER, "successfully imported module '%s'",
-                  name.get());
+                  name);
         return true;
     }
 
-    GjsAutoChar filename = g_strdup_printf("%s.js", name.get());
+    GjsAutoChar filename = g_strdup_printf("%s.js", name);
     std::vector<std::string> directories;
     JS::RootedValue elem(context);
     JS::RootedString str(context);
@@ -541,9 +691,12 @@ static bool do_import(JSContext* context, JS::HandleObject obj, Importer* priv,
         if (dirname[0] == '\0')
             continue;
 
+        const DirectoryListing& listing = directory_listing(dirname.get());
+
         /* Try importing __init__.js and loading the symbol from it */
         bool found = false;
-        if (!import_symbol_from_init_js(context, obj, dirname.get(), name.get(),
+        if (listing.contains(MODULE_INIT_FILENAME) &&
+            !import_symbol_from_init_js(context, obj, dirname.get(), name,
                                         &found))
             return false;
         if (found)
@@ -551,13 +704,12 @@ static bool do_import(JSContext* context, JS::HandleObject obj, Importer* priv,
 
         /* Second try importing a directory (a sub-importer) */
         GjsAutoChar full_path =
-            g_build_filename(dirname.get(), name.get(), nullptr);
-        GjsAutoUnref<GFile> gfile = g_file_new_for_commandline_arg(full_path);
+            g_build_filename(dirname.get(), name, nullptr);
 
-        if (g_file_query_file_type(gfile, (GFileQueryInfoFlags) 0, NULL) == G_FILE_TYPE_DIRECTORY) {
+        if (listing.type(name) == G_FILE_TYPE_DIRECTORY) {
             gjs_debug(GJS_DEBUG_IMPORTER,
                       "Adding directory '%s' to child importer '%s'",
-                      full_path.get(), name.get());
+                      full_path.get(), name);
             directories.push_back(full_path.get());
         }
 
@@ -571,19 +723,18 @@ static bool do_import(JSContext* context, JS::HandleObject obj, Importer* priv,
             continue;
 
         /* Third, if it's not a directory, try importing a file */
-        full_path = g_build_filename(dirname.get(), filename.get(), nullptr);
-        gfile = g_file_new_for_commandline_arg(full_path);
-        exists = g_file_query_exists(gfile, NULL);
-
-        if (!exists) {
+        if (!listing.contains(filename)) {
             gjs_debug(GJS_DEBUG_IMPORTER, "JS import '%s' not found in %s",
-                      name.get(), dirname.get());
+                      name, dirname.get());
             continue;
         }
 
-        if (import_file_on_module(context, obj, id, name.get(), gfile)) {
+        full_path = g_build_filename(dirname.get(), filename.get(), nullptr);
+        GjsAutoUnref<GFile> gfile = g_file_new_for_commandline_arg(full_path);
+
+        if (import_file_on_module(context, obj, id, name, gfile)) {
             gjs_debug(GJS_DEBUG_IMPORTER, "successfully imported module '%s'",
-                      name.get());
+                      name);
             return true;
         }
 
@@ -595,11 +746,11 @@ static bool do_import(JSContext* context, JS::HandleObject obj, Importer* priv,
     }
 
     if (!directories.empty()) {
-        if (!import_directory(context, obj, name.get(), directories))
+        if (!import_directory(context, obj, name, directories))
             return false;
 
         gjs_debug(GJS_DEBUG_IMPORTER, "successfully imported directory '%s'",
-                  name.get());
+                  name);
         return true;
     }
 
@@ -607,7 +758,7 @@ static bool do_import(JSContext* context, JS::HandleObject obj, Importer* priv,
      * end of the path. Be sure an exception is set. */
     g_assert(!JS_IsExceptionPending(context));
     gjs_throw_custom(context, JSProto_Error, "ImportError",
-                     "No JS module '%s' found in search path", name.get());
+                     "No JS module '%s' found in search path", name);
     return false;
 }
 
@@ -650,8 +801,6 @@ static bool importer_new_enumerate(JSContext* context, JS::HandleObject object,
     JS::RootedValue elem(context);
     JS::RootedString str(context);
     for (i = 0; i < search_path_len; ++i) {
-        char *init_path;
-
         elem.setUndefined();
         if (!JS_GetElement(context, search_path, i, &elem)) {
             /* this means there was an exception, while elem.isUndefined()
@@ -673,39 +822,27 @@ static bool importer_new_enumerate(JSContext* context, JS::HandleObject object,
         if (!dirname)
             return false;
 
-        init_path =
-            g_build_filename(dirname.get(), MODULE_INIT_FILENAME, nullptr);
+        const DirectoryListing& listing = directory_listing(dirname.get());
 
-        if (!load_module_elements(context, object, properties, init_path))
-            return false;
-
-        g_free(init_path);
-
-        /* new_for_commandline_arg handles resource:/// paths */
-        GjsAutoUnref<GFile> dir = g_file_new_for_commandline_arg(dirname.get());
-        GjsAutoUnref<GFileEnumerator> direnum =
-            g_file_enumerate_children(dir, "standard::name,standard::type",
-                                      G_FILE_QUERY_INFO_NONE, NULL, NULL);
-
-        while (true) {
-            GFileInfo *info;
-            GFile *file;
-            if (!g_file_enumerator_iterate(direnum, &info, &file, NULL, NULL))
-                break;
-            if (info == NULL || file == NULL)
-                break;
+        if (listing.contains(MODULE_INIT_FILENAME)) {
+            GjsAutoChar init_path =
+                g_build_filename(dirname.get(), MODULE_INIT_FILENAME, nullptr);
+            if (!load_module_elements(context, object, properties, init_path))
+                return false;
+        }
 
-            GjsAutoChar filename = g_file_get_basename(file);
+        for (const auto& entry : listing.entries) {
+            const char* filename = entry.first.c_str();
 
             /* skip hidden files and directories (.svn, .git, ...) */
-            if (filename.get()[0] == '.')
+            if (filename[0] == '.')
                 continue;
 
             /* skip module init file */
             if (strcmp(filename, MODULE_INIT_FILENAME) == 0)
                 continue;
 
-            if (g_file_info_get_file_type(info) == G_FILE_TYPE_DIRECTORY) {
+            if (entry.second == G_FILE_TYPE_DIRECTORY) {
                 jsid id = gjs_intern_string_to_id(context, filename);
                 if (id == JSID_VOID)
                     return false;
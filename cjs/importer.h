@@ -37,6 +37,9 @@ GJS_JSAPI_RETURN_CONVENTION
 JSObject* gjs_create_root_importer(JSContext* cx,
                                    const std::vector<std::string>& search_path);
 
+void gjs_importer_clear_directory_cache(void);
+void gjs_importer_free_directory_cache(void);
+
 GJS_JSAPI_RETURN_CONVENTION
 bool gjs_import_native_module(JSContext       *cx,
                               JS::HandleObject importer,
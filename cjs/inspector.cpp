@@ -0,0 +1,438 @@
+/* -*- mode: C++; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * SPDX-License-Identifier: MIT OR LGPL-2.0-or-later
+ */
+
+#include <config.h>
+
+#include <glib.h>
+
+#ifdef G_OS_UNIX
+#    include <errno.h>
+#    include <stdio.h>   // for fopen, fclose
+#    include <string.h>  // for strerror, strlen, strncpy
+#    include <sys/socket.h>  // for AF_UNIX, connect, socket
+#    include <sys/stat.h>    // for S_ISSOCK, umask
+#    include <sys/un.h>      // for sockaddr_un
+#    include <unistd.h>      // for close
+
+#    include <string>
+
+#    include <gio/gio.h>
+#    include <glib-object.h>
+#    include <glib/gstdio.h>  // for g_lstat, g_unlink
+
+#    include <js/CompilationAndEvaluation.h>
+#    include <js/CompileOptions.h>
+#    include <js/Conversions.h>  // for ToString
+#    include <js/JSON.h>         // for JS_Stringify
+#    include <js/RootingAPI.h>
+#    include <js/SourceText.h>
+#    include <js/TypeDecls.h>
+#    include <js/Utility.h>  // for UniqueChars
+#    include <js/Value.h>
+#    include <js/ValueArray.h>
+#    include <jsapi.h>  // for JS_CallFunctionName, JS_EncodeStringToUTF8
+
+#    include "cjs/context-private.h"
+#    include "cjs/heap-snapshot.h"
+#    include "cjs/jsapi-util.h"
+#    include "cjs/native.h"
+#    include "cjs/profiler-private.h"
+#    include "cjs/profiler.h"
+#endif
+
+#include "cjs/inspector.h"
+
+#ifdef G_OS_UNIX
+
+namespace mozilla {
+union Utf8Unit;
+}
+
+/* The protocol is line-based: each command is one line of UTF-8 text, a
+ * command name optionally followed by a space and an argument, and each reply
+ * is one line of JSON, either {"ok":true,"result":...} or
+ * {"ok":false,"error":"..."}. Commands are handled in the main loop of the
+ * inspected context, one at a time, between other events. */
+
+struct GjsInspector {
+    GjsContext* context;  // not owned; the inspector goes away with it
+    GSocketService* service;
+    // Cancelled on teardown, so that clients stop reading commands
+    GCancellable* cancellable;
+    GjsAutoChar path;
+};
+
+static GjsInspector* inspector = nullptr;
+
+struct GjsInspectorClient {
+    GSocketConnection* connection;
+    GDataInputStream* input;
+    GCancellable* cancellable;
+    GjsAutoChar reply;  // kept alive while it is being written
+};
+
+// Commands that only call a function of the System module, and reply with its
+// return value
+static const struct {
+    const char* command;
+    const char* function;
+} system_commands[] = {
+    {"memory", "memoryCounters"},     {"gc-stats", "gcStats"},
+    {"call-stats", "callStats"},      {"marshal-stats", "marshalStats"},
+    {"wrappers", "wrapperReport"},    {"gc", "gc"},
+};
+
+static void append_json_string(GString* out, const char* str) {
+    g_string_append_c(out, '"');
+    for (const char* p = str; *p; p++) {
+        unsigned char c = *p;
+        switch (c) {
+            case '"':
+                g_string_append(out, "\\\"");
+                break;
+            case '\\':
+                g_string_append(out, "\\\\");
+                break;
+            case '\n':
+                g_string_append(out, "\\n");
+                break;
+            case '\r':
+                g_string_append(out, "\\r");
+                break;
+            case '\t':
+                g_string_append(out, "\\t");
+                break;
+            default:
+                if (c < 0x20)
+                    g_string_append_printf(out, "\\u%04x", c);
+                else
+                    g_string_append_c(out, c);
+        }
+    }
+    g_string_append_c(out, '"');
+}
+
+static bool append_utf16(const char16_t* buf, uint32_t len, void* data) {
+    static_cast<std::u16string*>(data)->append(buf, len);
+    return true;
+}
+
+// Values that JSON can't represent, such as undefined or functions, are
+// converted to strings instead
+GJS_JSAPI_RETURN_CONVENTION
+static bool append_json_value(JSContext* cx, GString* out,
+                              JS::HandleValue value) {
+    std::u16string json;
+    JS::RootedValue v_json(cx, value);
+    if (!JS_Stringify(cx, &v_json, nullptr, JS::UndefinedHandleValue,
+                      append_utf16, &json))
+        return false;
+
+    if (json.empty()) {
+        JS::RootedString str(cx, JS::ToString(cx, value));
+        if (!str)
+            return false;
+        v_json.setString(str);
+        if (!JS_Stringify(cx, &v_json, nullptr, JS::UndefinedHandleValue,
+                          append_utf16, &json))
+            return false;
+    }
+
+    GjsAutoChar utf8 =
+        g_utf16_to_utf8(reinterpret_cast<const gunichar2*>(json.data()),
+                        json.size(), nullptr, nullptr, nullptr);
+    if (!utf8) {
+        gjs_throw(cx, "Reply is not valid UTF-16");
+        return false;
+    }
+    g_string_append(out, utf8);
+    return true;
+}
+
+[[nodiscard]] static char* reply_error(const char* message) {
+    GString* out = g_string_new("{\"ok\":false,\"error\":");
+    append_json_string(out, message);
+    g_string_append_c(out, '}');
+    return g_string_free(out, false);
+}
+
+[[nodiscard]] static char* reply_exception(JSContext* cx) {
+    JS::RootedValue exc(cx);
+    if (!JS_GetPendingException(cx, &exc))
+        return reply_error("Uncatchable exception");
+    JS_ClearPendingException(cx);
+
+    JS::RootedString str(cx, JS::ToString(cx, exc));
+    JS::UniqueChars message;
+    if (str)
+        message = JS_EncodeStringToUTF8(cx, str);
+    if (!message) {
+        JS_ClearPendingException(cx);
+        return reply_error("(Unable to convert exception)");
+    }
+    return reply_error(message.get());
+}
+
+[[nodiscard]] static char* reply_value(JSContext* cx, JS::HandleValue value) {
+    GString* out = g_string_new("{\"ok\":true,\"result\":");
+    if (!append_json_value(cx, out, value)) {
+        g_string_free(out, true);
+        return reply_exception(cx);
+    }
+    g_string_append_c(out, '}');
+    return g_string_free(out, false);
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool inspector_eval(JSContext* cx, const char* source,
+                           JS::MutableHandleValue rval) {
+    JS::SourceText<mozilla::Utf8Unit> buf;
+    if (!buf.init(cx, source, strlen(source), JS::SourceOwnership::Borrowed))
+        return false;
+
+    JS::CompileOptions options(cx);
+    options.setFileAndLine("<inspector>", 1);
+    return JS::Evaluate(cx, options, buf, rval);
+}
+
+[[nodiscard]] static char* inspector_write_snapshot(
+    JSContext* cx, const char* path, GjsHeapSnapshotFilter filter) {
+    if (!path)
+        return reply_error("Missing file name");
+
+    FILE* fp = fopen(path, "w");
+    if (!fp) {
+        GjsAutoChar message = g_strdup_printf(
+            "Cannot write heap snapshot to %s: %s", path, strerror(errno));
+        return reply_error(message);
+    }
+    bool ok = gjs_write_heap_snapshot(cx, fp, filter);
+    fclose(fp);
+    if (!ok)
+        return reply_error("Failed to write heap snapshot");
+
+    JS::RootedValue v_path(cx);
+    if (!gjs_string_from_utf8(cx, path, &v_path))
+        return reply_exception(cx);
+    return reply_value(cx, v_path);
+}
+
+[[nodiscard]] static char* inspector_profiler(GjsContextPrivate* gjs,
+                                              const char* action) {
+    GjsProfiler* profiler = gjs->ensure_profiler();
+    if (!profiler)
+        return reply_error("Another context is being profiled");
+
+    if (g_strcmp0(action, "start") == 0)
+        gjs_profiler_start(profiler);
+    else if (g_strcmp0(action, "stop") == 0)
+        gjs_profiler_stop(profiler);
+    else if (action)
+        return reply_error("Expected 'start' or 'stop'");
+
+    JS::RootedValue running(gjs->context(),
+                            JS::BooleanValue(_gjs_profiler_is_running(profiler)));
+    return reply_value(gjs->context(), running);
+}
+
+[[nodiscard]] static char* inspector_handle_command(GjsContextPrivate* gjs,
+                                                    char* line) {
+    if (gjs->destroying() || gjs->sweeping())
+        return reply_error("The context is not available");
+
+    char* arg = strchr(line, ' ');
+    if (arg)
+        *arg++ = '\0';
+
+    JSContext* cx = gjs->context();
+    JS::RootedObject global(cx, gjs->global());
+    JSAutoRealm ar(cx, global);
+
+    if (strcmp(line, "eval") == 0) {
+        JS::RootedValue rval(cx);
+        if (!inspector_eval(cx, arg ? arg : "", &rval))
+            return reply_exception(cx);
+        return reply_value(cx, rval);
+    }
+
+    if (strcmp(line, "profiler") == 0)
+        return inspector_profiler(gjs, arg);
+
+    if (strcmp(line, "heap-snapshot") == 0)
+        return inspector_write_snapshot(cx, arg, GjsHeapSnapshotFilter::ALL);
+    if (strcmp(line, "wrapper-snapshot") == 0)
+        return inspector_write_snapshot(cx, arg,
+                                        GjsHeapSnapshotFilter::GI_WRAPPERS);
+
+    for (const auto& entry : system_commands) {
+        if (strcmp(line, entry.command) != 0)
+            continue;
+
+        JS::RootedObject system(cx);
+        JS::RootedValue rval(cx);
+        if (!gjs_load_native_module(cx, "system", &system) ||
+            !JS_CallFunctionName(cx, system, entry.function,
+                                 JS::HandleValueArray::empty(), &rval))
+            return reply_exception(cx);
+        return reply_value(cx, rval);
+    }
+
+    GjsAutoChar message = g_strdup_printf("Unknown command '%s'", line);
+    return reply_error(message);
+}
+
+static void gjs_inspector_client_free(GjsInspectorClient* client) {
+    g_io_stream_close(G_IO_STREAM(client->connection), nullptr, nullptr);
+    g_object_unref(client->input);
+    g_object_unref(client->connection);
+    g_object_unref(client->cancellable);
+    delete client;
+}
+
+static void gjs_inspector_client_read(GjsInspectorClient* client);
+
+static void on_reply_written(GObject* stream, GAsyncResult* result,
+                             void* data) {
+    auto* client = static_cast<GjsInspectorClient*>(data);
+
+    if (!g_output_stream_write_all_finish(G_OUTPUT_STREAM(stream), result,
+                                          nullptr, nullptr)) {
+        gjs_inspector_client_free(client);
+        return;
+    }
+    gjs_inspector_client_read(client);
+}
+
+static void on_line_read(GObject* stream, GAsyncResult* result, void* data) {
+    auto* client = static_cast<GjsInspectorClient*>(data);
+
+    GjsAutoChar line = g_data_input_stream_read_line_finish_utf8(
+        G_DATA_INPUT_STREAM(stream), result, nullptr, nullptr);
+    // End of input, an error, or invalid UTF-8
+    if (!line || g_cancellable_is_cancelled(client->cancellable)) {
+        gjs_inspector_client_free(client);
+        return;
+    }
+
+    GjsContextPrivate* gjs = GjsContextPrivate::from_object(inspector->context);
+    GjsAutoChar reply = inspector_handle_command(gjs, line);
+    client->reply = g_strconcat(reply.get(), "\n", nullptr);
+
+    GOutputStream* output =
+        g_io_stream_get_output_stream(G_IO_STREAM(client->connection));
+    g_output_stream_write_all_async(output, client->reply.get(),
+                                    strlen(client->reply), G_PRIORITY_DEFAULT,
+                                    client->cancellable, on_reply_written,
+                                    client);
+}
+
+static void gjs_inspector_client_read(GjsInspectorClient* client) {
+    g_data_input_stream_read_line_async(client->input, G_PRIORITY_DEFAULT,
+                                        client->cancellable, on_line_read,
+                                        client);
+}
+
+static gboolean on_incoming(GSocketService*, GSocketConnection* connection,
+                            GObject*, void*) {
+    auto* client = new GjsInspectorClient();
+    client->connection = G_SOCKET_CONNECTION(g_object_ref(connection));
+    client->input = g_data_input_stream_new(
+        g_io_stream_get_input_stream(G_IO_STREAM(connection)));
+    g_data_input_stream_set_newline_type(client->input,
+                                         G_DATA_STREAM_NEWLINE_TYPE_ANY);
+    client->cancellable = G_CANCELLABLE(g_object_ref(inspector->cancellable));
+
+    gjs_inspector_client_read(client);
+    return true;
+}
+
+// Removes a socket left behind by a process that didn't exit cleanly, but
+// nothing else that might be at @addr, nor a socket that a process is still
+// listening on
+static void remove_stale_socket(const struct sockaddr_un& addr) {
+    GStatBuf buf;
+    if (g_lstat(addr.sun_path, &buf) != 0 || !S_ISSOCK(buf.st_mode))
+        return;
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+        return;
+    bool stale = connect(fd, reinterpret_cast<const struct sockaddr*>(&addr),
+                         sizeof addr) != 0 &&
+                 errno == ECONNREFUSED;
+    close(fd);
+
+    if (stale)
+        g_unlink(addr.sun_path);
+}
+
+void gjs_inspector_setup(GjsContext* context) {
+    const char* path = g_getenv("GJS_INSPECT_SOCKET");
+    if (!path || !*path || inspector)
+        return;
+
+    struct sockaddr_un addr = {};
+    if (strlen(path) >= sizeof addr.sun_path) {
+        g_warning("GJS_INSPECT_SOCKET: path %s is too long", path);
+        return;
+    }
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path, sizeof addr.sun_path - 1);
+
+    remove_stale_socket(addr);
+
+    GjsAutoUnref<GSocketAddress> address =
+        g_socket_address_new_from_native(&addr, sizeof addr);
+    GSocketService* service = g_socket_service_new();
+    GError* error = nullptr;
+    // Anyone who can connect can run code in the process, so the socket is
+    // created with owner-only permissions, instead of being restricted after
+    // it already accepts connections
+    mode_t old_umask = umask(0177);
+    bool listening = g_socket_listener_add_address(
+        G_SOCKET_LISTENER(service), address, G_SOCKET_TYPE_STREAM,
+        G_SOCKET_PROTOCOL_DEFAULT, nullptr, nullptr, &error);
+    umask(old_umask);
+    if (!listening) {
+        g_warning("GJS_INSPECT_SOCKET: cannot listen on %s: %s", path,
+                  error->message);
+        g_error_free(error);
+        g_object_unref(service);
+        return;
+    }
+
+    inspector = new GjsInspector();
+    inspector->context = context;
+    inspector->service = service;
+    inspector->cancellable = g_cancellable_new();
+    inspector->path = g_strdup(path);
+
+    g_signal_connect(service, "incoming", G_CALLBACK(on_incoming), nullptr);
+    g_socket_service_start(service);
+}
+
+void gjs_inspector_teardown(GjsContext* context) {
+    if (!inspector || inspector->context != context)
+        return;
+
+    g_cancellable_cancel(inspector->cancellable);
+    g_object_unref(inspector->cancellable);
+    g_socket_service_stop(inspector->service);
+    g_socket_listener_close(G_SOCKET_LISTENER(inspector->service));
+    g_object_unref(inspector->service);
+    g_unlink(inspector->path);
+
+    delete inspector;
+    inspector = nullptr;
+}
+
+#else   // !G_OS_UNIX
+void gjs_inspector_setup(GjsContext*) {
+    if (g_getenv("GJS_INSPECT_SOCKET"))
+        g_warning("GJS_INSPECT_SOCKET is only supported on Unix");
+}
+
+void gjs_inspector_teardown(GjsContext*) {}
+#endif  // !G_OS_UNIX
@@ -0,0 +1,25 @@
+/* -*- mode: C++; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * SPDX-License-Identifier: MIT OR LGPL-2.0-or-later
+ */
+
+#ifndef GJS_INSPECTOR_H_
+#define GJS_INSPECTOR_H_
+
+#include <config.h>
+
+#include "cjs/context.h"
+
+// inspector.h - Opt-in endpoint for inspecting a running process.
+//
+// If GJS_INSPECT_SOCKET is set to a path, the first context created listens on
+// a Unix socket at that path, from its main loop, for commands such as
+// evaluating an expression or starting the profiler. See doc/Environment.md
+// for the protocol.
+
+void gjs_inspector_setup(GjsContext* context);
+
+// Stops listening and removes the socket, if @context is the one inspected
+void gjs_inspector_teardown(GjsContext* context);
+
+#endif  // GJS_INSPECTOR_H_
@@ -44,6 +44,9 @@ bool gjs_init_class_dynamic(
     JSFunctionSpec* fs, JSPropertySpec* static_ps, JSFunctionSpec* static_fs,
     JS::MutableHandleObject prototype, JS::MutableHandleObject constructor);
 
+void gjs_dynamic_class_set_gtype(JSObject* constructor, GType gtype);
+[[nodiscard]] GType gjs_dynamic_class_get_gtype(JSObject* constructor);
+
 [[nodiscard]] bool gjs_typecheck_instance(JSContext* cx, JS::HandleObject obj,
                                           const JSClass* static_clasp,
                                           bool throw_error);
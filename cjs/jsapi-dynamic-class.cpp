@@ -54,6 +54,11 @@ enum {
     DYNAMIC_PROPERTY_PRIVATE_SLOT,
 };
 
+/* Reserved slots of constructors of dynamic classes */
+enum {
+    DYNAMIC_CLASS_GTYPE_SLOT,
+};
+
 bool gjs_init_class_dynamic(JSContext* context, JS::HandleObject in_object,
                             JS::HandleObject parent_proto, const char* ns_name,
                             const char* class_name, const JSClass* clasp,
@@ -97,9 +102,9 @@ bool gjs_init_class_dynamic(JSContext* context, JS::HandleObject in_object,
 
     GjsAutoChar full_function_name =
         g_strdup_printf("%s_%s", ns_name, class_name);
-    JSFunction* constructor_fun =
-        JS_NewFunction(context, constructor_native, nargs, JSFUN_CONSTRUCTOR,
-                       full_function_name);
+    JSFunction* constructor_fun = js::NewFunctionWithReserved(
+        context, constructor_native, nargs, JSFUN_CONSTRUCTOR,
+        full_function_name);
     if (!constructor_fun)
         return false;
 
@@ -119,6 +124,34 @@ bool gjs_init_class_dynamic(JSContext* context, JS::HandleObject in_object,
                              GJS_MODULE_PROP_FLAGS);
 }
 
+/**
+ * gjs_dynamic_class_set_gtype:
+ * @constructor: constructor of a class defined with gjs_init_class_dynamic()
+ * @gtype: the GType that the class wraps
+ *
+ * Stores @gtype in a reserved slot of @constructor, from where
+ * gjs_dynamic_class_get_gtype() reads it without any property lookup.
+ */
+void gjs_dynamic_class_set_gtype(JSObject* constructor, GType gtype) {
+    js::SetFunctionNativeReserved(constructor, DYNAMIC_CLASS_GTYPE_SLOT,
+                                  JS::PrivateValue(GSIZE_TO_POINTER(gtype)));
+}
+
+/**
+ * gjs_dynamic_class_get_gtype:
+ * @constructor: constructor of a class defined with gjs_init_class_dynamic()
+ *
+ * Returns: the GType stored with gjs_dynamic_class_set_gtype(), or
+ * %G_TYPE_INVALID if none was.
+ */
+GType gjs_dynamic_class_get_gtype(JSObject* constructor) {
+    const JS::Value& slot =
+        js::GetFunctionNativeReserved(constructor, DYNAMIC_CLASS_GTYPE_SLOT);
+    if (slot.isUndefined())
+        return G_TYPE_INVALID;
+    return GPOINTER_TO_SIZE(slot.toPrivate());
+}
+
 [[nodiscard]] static const char* format_dynamic_class_name(const char* name) {
     if (g_str_has_prefix(name, "_private_"))
         return name + strlen("_private_");
@@ -230,7 +230,7 @@ GJS_JSAPI_RETURN_CONVENTION static bool parse_call_args_helper(
 
     g_return_val_if_fail(param_name, false);
 
-    if (*fchar != '\0') {
+    if (*fchar != '\0' && *fchar != '|') {
         nullable = check_nullable(fchar, fmt_required);
         fmt_required++;
     } else {
@@ -278,6 +278,43 @@ GJS_JSAPI_RETURN_CONVENTION static bool parse_call_args_helper(
     return retval;
 }
 
+// Summary of a format string. Format strings are almost always literals, so in
+// an inlined call this is computed at compile time.
+struct GjsParseCallArgsFormat {
+    const char* required;  // after any '!'
+    const char* optional;  // after the '|', or null
+    unsigned n_required;
+    unsigned n_total;
+    bool ignore_trailing_args;
+};
+
+[[nodiscard]] GJS_ALWAYS_INLINE static constexpr inline GjsParseCallArgsFormat
+parse_call_args_format(const char* format) {
+    GjsParseCallArgsFormat retval{format, nullptr, 0, 0, false};
+
+    if (*format == '!') {
+        retval.ignore_trailing_args = true;
+        retval.required = ++format;
+    }
+
+    for (const char* fmt_iter = format; *fmt_iter; fmt_iter++) {
+        switch (*fmt_iter) {
+        case '|':
+            retval.n_required = retval.n_total;
+            retval.optional = fmt_iter + 1;
+            continue;
+        case '?':
+            continue;
+        default:
+            retval.n_total++;
+        }
+    }
+
+    if (!retval.optional)
+        retval.n_required = retval.n_total;
+    return retval;
+}
+
 /* Empty-args version of the template */
 GJS_JSAPI_RETURN_CONVENTION [[maybe_unused]] static bool gjs_parse_call_args(
     JSContext* cx, const char* function_name, const JS::CallArgs& args,
@@ -342,37 +379,15 @@ template <typename... Args>
 GJS_JSAPI_RETURN_CONVENTION static bool gjs_parse_call_args(
     JSContext* cx, const char* function_name, const JS::CallArgs& args,
     const char* format, Args... params) {
-    const char *fmt_iter, *fmt_required, *fmt_optional;
-    unsigned n_required = 0, n_total = 0;
-    bool optional_args = false, ignore_trailing_args = false;
-
-    if (*format == '!') {
-        ignore_trailing_args = true;
-        format++;
-    }
-
-    for (fmt_iter = format; *fmt_iter; fmt_iter++) {
-        switch (*fmt_iter) {
-        case '|':
-            n_required = n_total;
-            optional_args = true;
-            continue;
-        case '?':
-            continue;
-        default:
-            n_total++;
-        }
-    }
-
-    if (!optional_args)
-        n_required = n_total;
+    GjsParseCallArgsFormat fmt = parse_call_args_format(format);
+    unsigned n_required = fmt.n_required, n_total = fmt.n_total;
 
     g_assert(((void) "Wrong number of parameters passed to gjs_parse_call_args()",
               sizeof...(Args) / 2 == n_total));
 
     if (!args.requireAtLeast(cx, function_name, n_required))
         return false;
-    if (!ignore_trailing_args && args.length() > n_total) {
+    if (!fmt.ignore_trailing_args && args.length() > n_total) {
         if (n_required == n_total) {
             gjs_throw(cx, "Error invoking %s: Expected %d arguments, got %d",
                       function_name, n_required, args.length());
@@ -385,9 +400,10 @@ GJS_JSAPI_RETURN_CONVENTION static bool gjs_parse_call_args(
         return false;
     }
 
-    GjsAutoStrv parts = g_strsplit(format, "|", 2);
-    fmt_required = parts.get()[0];
-    fmt_optional = parts.get()[1];  // may be null
+    // The helpers stop reading fmt_required at the '|', so the format string
+    // doesn't need to be split
+    const char* fmt_required = fmt.required;
+    const char* fmt_optional = fmt.optional;
 
     return parse_call_args_helper(cx, function_name, args, fmt_required,
                                   fmt_optional, 0, params...);
@@ -37,6 +37,8 @@
 #include <glib-object.h>
 #include <glib.h>
 
+#include <js/HeapAPI.h>  // for RuntimeHeapIsCollecting
+#include <js/RootingAPI.h>
 #include <js/TracingAPI.h>
 #include <js/TypeDecls.h>
 
@@ -66,7 +68,9 @@
  *
  * If the thing is rooted, it will be unrooted either when the GjsMaybeOwned is
  * destroyed, or when the JSContext is destroyed. In the latter case, you can
- * get an optional notification by passing a callback to root().
+ * get an optional notification by passing a callback to root(). Rooted things
+ * are kept in a slot of the context's GjsRootSlots table (see root-slots.h),
+ * so rooting and unrooting don't allocate.
  *
  * To switch between one of the three modes, you must first call reset(). This
  * drops all references to any GC thing and leaves the GjsMaybeOwned in the
@@ -125,7 +129,7 @@ class GjsMaybeOwned {
      * from one to the other, be careful to call the constructor and destructor
      * of JS::Heap, since they use post barriers. */
     JS::Heap<T> m_heap;
-    std::unique_ptr<JS::PersistentRooted<T>> m_root;
+    JS::Heap<T>* m_root = nullptr;  // slot in GjsRootSlotTable<T>
 
     struct Notifier {
         Notifier(GjsMaybeOwned<T> *parent, DestroyNotify func, void *data)
@@ -177,7 +181,8 @@ class GjsMaybeOwned {
         debug("teardown_rooting()");
         g_assert(m_root);
 
-        m_root.reset();
+        GjsRootSlotTable<T>::release(m_root);
+        m_root = nullptr;
         m_notify.reset();
 
         new (&m_heap) JS::Heap<T>();
@@ -190,6 +195,8 @@ class GjsMaybeOwned {
 
     ~GjsMaybeOwned() {
         debug("destroyed");
+        if (m_root)
+            GjsRootSlotTable<T>::release(m_root);
     }
 
     /* To access the GC thing, call get(). In many cases you can just use the
@@ -197,7 +204,13 @@ class GjsMaybeOwned {
      * cast operator. But if you want to call methods on the GC thing, for
      * example if it's a JS::Value, you have to use get(). */
     [[nodiscard]] const T get() const {
-        return m_root ? m_root->get() : m_heap.get();
+        if (!m_root)
+            return m_heap.get();
+        // The slot is a JS::Heap traced from its chunk's holder, so it needs
+        // the read barrier, which can't be used while collecting
+        if (JS::RuntimeHeapIsCollecting())
+            return m_root->unbarrieredGet();
+        return m_root->get();
     }
     operator const T() const { return get(); }
 
@@ -205,14 +218,14 @@ class GjsMaybeOwned {
     template <typename U = T>
     [[nodiscard]] const void* debug_addr(
         std::enable_if_t<std::is_pointer_v<U>>* = nullptr) const {
-        return m_root ? m_root->get() : m_heap.unbarrieredGet();
+        return m_root ? m_root->unbarrieredGet() : m_heap.unbarrieredGet();
     }
 
     bool
     operator==(const T& other) const
     {
         if (m_root)
-            return m_root->get() == other;
+            return m_root->unbarrieredGet() == other;
         return m_heap == other;
     }
     inline bool operator!=(const T& other) const { return !(*this == other); }
@@ -223,7 +236,7 @@ class GjsMaybeOwned {
     operator==(std::nullptr_t) const
     {
         if (m_root)
-            return m_root->get() == nullptr;
+            return m_root->unbarrieredGet() == nullptr;
         return m_heap.unbarrieredGet() == nullptr;
     }
     inline bool operator!=(std::nullptr_t) const { return !(*this == nullptr); }
@@ -236,7 +249,10 @@ class GjsMaybeOwned {
      * JSContext can be destroyed while the Handle is live. */
     [[nodiscard]] JS::Handle<T> handle() {
         g_assert(m_root);
-        return *m_root;
+        // Reads through the handle bypass the read barrier, so apply it once
+        // here; the slot keeps the same thing for as long as it is rooted
+        (void)get();
+        return JS::Handle<T>::fromMarkedLocation(m_root->address());
     }
 
     /* Roots the GC thing. You must not use this if you're already using the
@@ -250,8 +266,10 @@ class GjsMaybeOwned {
         debug("root()");
         g_assert(!m_root);
         g_assert(m_heap.get() == JS::SafelyInitialized<T>());
+        JS::Rooted<T> rooted(cx, thing);
         m_heap.~Heap();
-        m_root = std::make_unique<JS::PersistentRooted<T>>(cx, thing);
+        m_root =
+            GjsContextPrivate::from_cx(cx)->root_slots<T>().acquire(cx, rooted);
 
         if (notify)
             m_notify = std::make_unique<Notifier>(this, notify, data);
@@ -308,15 +326,15 @@ class GjsMaybeOwned {
 
         /* Prevent the thing from being garbage collected while it is in neither
          * m_heap nor m_root */
-        JS::Rooted<T> thing(cx, *m_root);
+        JS::Rooted<T> thing(cx, get());
 
         reset();
         m_heap = thing;
         g_assert(!m_root);
     }
 
-    /* Tracing makes no sense in the rooted case, because JS::PersistentRooted
-     * already takes care of that. */
+    /* Tracing makes no sense in the rooted case, because the context's root
+     * slots are already traced. */
     void
     trace(JSTracer   *tracer,
           const char *name)
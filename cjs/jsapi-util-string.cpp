@@ -24,29 +24,33 @@
 #include <config.h>
 
 #include <stdint.h>
-#include <string.h>     // for size_t, strlen
+#include <string.h>     // for memcpy, size_t, strlen
 #include <sys/types.h>  // for ssize_t
 
-#include <algorithm>  // for copy
+#include <algorithm>  // for all_of, copy, max
 #include <iomanip>    // for operator<<, setfill, setw
 #include <sstream>    // for operator<<, basic_ostream, ostring...
 #include <string>     // for allocator, char_traits
+#include <utility>    // for move
 
 #include <glib.h>
 
 #include <js/CharacterEncoding.h>
 #include <js/Class.h>
 #include <js/ComparisonOperators.h>
-#include <js/GCAPI.h>  // for AutoCheckCannotGC
+#include <js/GCAPI.h>        // for AutoCheckCannotGC
+#include <js/GCHashTable.h>  // for WeakCache
 #include <js/Id.h>     // for JSID_IS_STRING...
 #include <js/RootingAPI.h>
 #include <js/Symbol.h>
 #include <js/TypeDecls.h>
-#include <js/Utility.h>  // for UniqueChars
+#include <js/Utility.h>  // for UniqueChars, UniqueLatin1Chars, ...
 #include <js/Value.h>
 #include <jsapi.h>        // for JSID_TO_FLAT_STRING, JS_GetTwoByte...
 #include <jsfriendapi.h>  // for FlatStringToLinearString, GetLatin...
+#include <mozilla/Span.h>
 
+#include "cjs/context-private.h"
 #include "cjs/jsapi-util.h"
 #include "cjs/macros.h"
 
@@ -94,17 +98,73 @@ JS::UniqueChars gjs_string_to_utf8(JSContext* cx, const JS::Value value) {
     return JS_EncodeStringToUTF8(cx, str);
 }
 
+bool GjsStringBufferBase::init(JSContext* cx, JSString* str) {
+    reset();
+
+    // Flattens a rope once, rather than walking it twice below
+    JSLinearString* linear = JS_EnsureLinearString(cx, str);
+    if (!linear)
+        return false;
+
+    JS::AutoCheckCannotGC nogc;
+    size_t length = js::GetLinearStringLength(linear);
+    const JS::Latin1Char* latin1 =
+        js::LinearStringHasLatin1Chars(linear)
+            ? js::GetLatin1LinearStringChars(nogc, linear)
+            : nullptr;
+
+    // ASCII has the same bytes in Latin-1 and UTF-8, so it can be copied
+    // without measuring the encoded length first
+    bool is_ascii = latin1 && std::all_of(latin1, latin1 + length,
+                                          [](JS::Latin1Char c) {
+                                              return c < 0x80;
+                                          });
+    size_t utf8_length =
+        is_ascii ? length : JS::GetDeflatedUTF8StringLength(linear);
+
+    char* dest = m_storage;
+    if (utf8_length >= m_capacity) {
+        m_heap.reset(js_pod_malloc<char>(utf8_length + 1));
+        if (!m_heap) {
+            JS_ReportOutOfMemory(cx);
+            return false;
+        }
+        dest = m_heap.get();
+    }
+
+    if (is_ascii)
+        memcpy(dest, latin1, length);
+    else
+        JS::DeflateStringToUTF8Buffer(linear,
+                                      mozilla::Span<char>(dest, utf8_length));
+    dest[utf8_length] = '\0';
+
+    m_chars = dest;
+    m_length = utf8_length;
+    return true;
+}
+
+// Checks a 64-bit word at a time, which the compiler can vectorize further
+size_t gjs_ascii_prefix_length(const uint8_t* data, size_t len) {
+    size_t ix = 0;
+    for (; ix + sizeof(uint64_t) <= len; ix += sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, data + ix, sizeof(word));
+        if (word & UINT64_C(0x8080808080808080))
+            break;
+    }
+    while (ix < len && data[ix] < 0x80)
+        ix++;
+    return ix;
+}
+
 bool
 gjs_string_from_utf8(JSContext             *context,
                      const char            *utf8_string,
                      JS::MutableHandleValue value_p)
 {
-    JS::ConstUTF8CharsZ chars(utf8_string, strlen(utf8_string));
-    JS::RootedString str(context, JS_NewStringCopyUTF8Z(context, chars));
-    if (str)
-        value_p.setString(str);
-
-    return str != nullptr;
+    return gjs_string_from_utf8_n(context, utf8_string, strlen(utf8_string),
+                                  value_p);
 }
 
 bool
@@ -113,8 +173,14 @@ gjs_string_from_utf8_n(JSContext             *cx,
                        size_t                 len,
                        JS::MutableHandleValue out)
 {
-    JS::UTF8Chars chars(utf8_chars, len);
-    JS::RootedString str(cx, JS_NewStringCopyUTF8N(cx, chars));
+    JSString* str;
+    // ASCII is valid Latin-1, so the bytes can be copied as they are into a
+    // Latin-1 string, without decoding
+    if (gjs_ascii_prefix_length(reinterpret_cast<const uint8_t*>(utf8_chars),
+                                len) == len)
+        str = JS_NewStringCopyN(cx, utf8_chars, len);
+    else
+        str = JS_NewStringCopyUTF8N(cx, JS::UTF8Chars(utf8_chars, len));
     if (str)
         out.setString(str);
 
@@ -130,6 +196,21 @@ gjs_string_to_filename(JSContext      *context,
 
     /* gjs_string_to_filename verifies that filename_val is a string */
 
+    // The usual case: the encoded string is already valid UTF-8, so there is
+    // nothing for g_filename_from_utf8() to convert
+    if (g_get_filename_charsets(nullptr)) {
+        if (!filename_val.isString()) {
+            gjs_throw(context, "Value is not a string, cannot convert to UTF-8");
+            return false;
+        }
+
+        GjsStringBuffer<> utf8;
+        if (!utf8.init(context, filename_val.toString()))
+            return false;
+        *filename_string = utf8.dup();
+        return true;
+    }
+
     JS::UniqueChars tmp = gjs_string_to_utf8(context, filename_val);
     if (!tmp)
         return false;
@@ -228,6 +309,47 @@ gjs_string_get_char16_data(JSContext       *context,
     return true;
 }
 
+[[nodiscard]] static inline bool is_surrogate(char16_t c) {
+    return (c & 0xf800) == 0xd800;
+}
+
+/* Converts @len UTF-16 code units to UCS-4 in one pass. Runs of code units
+ * that are not surrogates are widened with a plain copy, which the compiler
+ * vectorizes; only surrogate pairs are decoded one at a time. Returns false
+ * if there is an unpaired surrogate, leaving @ucs4_p untouched. */
+[[nodiscard]] static bool utf16_to_ucs4(const char16_t* utf16, size_t len,
+                                        gunichar** ucs4_p, size_t* len_p) {
+    GjsAutoFree<gunichar> ucs4 = g_new(gunichar, len + 1);
+    gunichar* out = ucs4;
+    size_t ix = 0;
+
+    while (ix < len) {
+        size_t run_end = ix;
+        while (run_end < len && utf16[run_end] != 0 &&
+               !is_surrogate(utf16[run_end]))
+            run_end++;
+        out = std::copy(utf16 + ix, utf16 + run_end, out);
+        ix = run_end;
+        // Like g_utf16_to_ucs4(), stop at an embedded 0
+        if (ix == len || utf16[ix] == 0)
+            break;
+
+        char16_t high = utf16[ix];
+        if (high > 0xdbff || ix + 1 == len || utf16[ix + 1] < 0xdc00 ||
+            utf16[ix + 1] > 0xdfff)
+            return false;
+        *out++ = 0x10000 + ((gunichar(high) - 0xd800) << 10) +
+                 (utf16[ix + 1] - 0xdc00);
+        ix += 2;
+    }
+
+    *out = 0;
+    if (len_p)
+        *len_p = out - ucs4;
+    *ucs4_p = ucs4.release();
+    return true;
+}
+
 /**
  * gjs_string_to_ucs4:
  * @cx: a #JSContext
@@ -247,7 +369,6 @@ gjs_string_to_ucs4(JSContext       *cx,
         return true;
 
     size_t len;
-    GError *error = NULL;
 
     if (JS_StringHasLatin1Chars(str))
         return from_latin1(cx, str, ucs4_string_p, len_p);
@@ -264,18 +385,11 @@ gjs_string_to_ucs4(JSContext       *cx,
         return false;
     }
 
-    if (ucs4_string_p != NULL) {
-        long length;
-        *ucs4_string_p = g_utf16_to_ucs4(reinterpret_cast<const gunichar2 *>(utf16),
-                                         len, NULL, &length, &error);
-        if (*ucs4_string_p == NULL) {
-            gjs_throw(cx, "Failed to convert UTF-16 string to UCS-4: %s",
-                      error->message);
-            g_clear_error(&error);
-            return false;
-        }
-        if (len_p != NULL)
-            *len_p = (size_t) length;
+    if (!utf16_to_ucs4(utf16, len, ucs4_string_p, len_p)) {
+        gjs_throw(cx,
+                  "Failed to convert UTF-16 string to UCS-4: Invalid sequence "
+                  "in conversion input");
+        return false;
     }
 
     return true;
@@ -302,30 +416,55 @@ gjs_string_from_ucs4(JSContext             *cx,
         return true;
     }
 
-    long u16_string_length;
-    GError *error = NULL;
-
-    gunichar2* u16_string = g_ucs4_to_utf16(ucs4_string, n_chars, nullptr,
-                                            &u16_string_length, &error);
-    if (!u16_string) {
-        gjs_throw(cx, "Failed to convert UCS-4 string to UTF-16: %s",
-                  error->message);
-        g_error_free(error);
-        return false;
+    // Like g_ucs4_to_utf16(), stop at an embedded 0 even if @n_chars is given
+    size_t len = 0;
+    size_t u16_len = 0;
+    gunichar max_char = 0;
+    for (; (n_chars < 0 || len < size_t(n_chars)) && ucs4_string[len]; len++) {
+        gunichar c = ucs4_string[len];
+        if (c > 0x10ffff || (c >= 0xd800 && c < 0xe000)) {
+            gjs_throw(cx,
+                      "Failed to convert UCS-4 string to UTF-16: Invalid "
+                      "character in input");
+            return false;
+        }
+        max_char = std::max(max_char, c);
+        u16_len += c > 0xffff ? 2 : 1;
     }
 
-    // Sadly, must copy, because js::UniquePtr forces that chars passed to
-    // JS_NewUCString() must have been allocated by the JS engine.
-    JS::RootedString str(
-        cx, JS_NewUCStringCopyN(cx, reinterpret_cast<char16_t*>(u16_string),
-                                u16_string_length));
-
-    g_free(u16_string);
+    JS::RootedString str(cx);
+    if (max_char <= 0xff) {
+        // Latin-1 has the same code points, and is the more compact string
+        JS::UniqueLatin1Chars chars(js_pod_malloc<JS::Latin1Char>(len + 1));
+        if (!chars) {
+            JS_ReportOutOfMemory(cx);
+            return false;
+        }
+        std::copy(ucs4_string, ucs4_string + len, chars.get());
+        chars[len] = 0;
+        str = JS_NewLatin1String(cx, std::move(chars), len);
+    } else {
+        JS::UniqueTwoByteChars chars(js_pod_malloc<char16_t>(u16_len + 1));
+        if (!chars) {
+            JS_ReportOutOfMemory(cx);
+            return false;
+        }
+        char16_t* out = chars.get();
+        for (size_t ix = 0; ix < len; ix++) {
+            gunichar c = ucs4_string[ix];
+            if (c > 0xffff) {
+                *out++ = 0xd800 + ((c - 0x10000) >> 10);
+                *out++ = 0xdc00 + ((c - 0x10000) & 0x3ff);
+            } else {
+                *out++ = c;
+            }
+        }
+        *out = 0;
+        str = JS_NewUCString(cx, std::move(chars), u16_len);
+    }
 
-    if (!str) {
-        gjs_throw(cx, "Failed to convert UCS-4 string to UTF-16");
+    if (!str)
         return false;
-    }
 
     value_p.setString(str);
     return true;
@@ -335,23 +474,89 @@ gjs_string_from_ucs4(JSContext             *cx,
  * gjs_get_string_id:
  * @cx: a #JSContext
  * @id: a jsid that is an object hash key (could be an int or string)
- * @name_p place to store ASCII string version of key
+ * @name_p place to store UTF-8 string version of key
  *
- * If the id is not a string ID, return true and set *name_p to nullptr.
- * Otherwise, return true and fill in *name_p with ASCII name of id.
+ * If the id is not a string ID, return true and leave *name_p empty.
+ * Otherwise, return true and fill in *name_p with the UTF-8 name of id.
  *
  * Returns: false on error, otherwise true
  **/
-bool gjs_get_string_id(JSContext* cx, jsid id, JS::UniqueChars* name_p) {
+bool gjs_get_string_id(JSContext* cx, jsid id, GjsStringBufferBase* name_p) {
     if (!JSID_IS_STRING(id)) {
         name_p->reset();
         return true;
     }
 
     JSLinearString* lstr = JSID_TO_LINEAR_STRING(id);
-    JS::RootedString s(cx, JS_FORGET_STRING_LINEARNESS(lstr));
-    *name_p = JS_EncodeStringToUTF8(cx, s);
-    return !!*name_p;
+    return name_p->init(cx, JS_FORGET_STRING_LINEARNESS(lstr));
+}
+
+/**
+ * gjs_get_interned_string_id:
+ * @cx: a #JSContext
+ * @id: a jsid that is an object hash key (could be an int or string)
+ * @name_p: place to store the interned UTF-8 name of the key
+ *
+ * Like gjs_get_string_id(), but stores a string interned with
+ * g_intern_string(), which is valid forever. The name is cached per context,
+ * so looking up the same id again doesn't encode it again. Intended for resolve
+ * hooks, which see the same few names over and over.
+ *
+ * Returns: false on error, otherwise true
+ */
+bool gjs_get_interned_string_id(JSContext* cx, jsid id, const char** name_p) {
+    if (!JSID_IS_STRING(id)) {
+        *name_p = nullptr;
+        return true;
+    }
+
+    JS::WeakCache<IdNameTable>& table =
+        GjsContextPrivate::from_cx(cx)->id_name_table();
+    if (auto p = table.lookup(id)) {
+        *name_p = p->value();
+        return true;
+    }
+
+    GjsStringBuffer<> name;
+    if (!gjs_get_string_id(cx, id, &name))
+        return false;
+
+    *name_p = g_intern_string(name.get());
+    if (!table.putNew(id, *name_p)) {
+        JS_ReportOutOfMemory(cx);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * gjs_preatomize_name:
+ * @cx: a #JSContext
+ * @name: a property name that is not an array index
+ *
+ * Atomizes and pins @name, and records it in the same cache as
+ * gjs_get_interned_string_id(), so that resolve hooks looking up @name later
+ * find it by its jsid without encoding the string. Since the atom is pinned,
+ * the entry is never swept; only use this for names that are looked up often.
+ *
+ * Returns: false on error, otherwise true
+ */
+bool gjs_preatomize_name(JSContext* cx, const char* name) {
+    JSString* atom = JS_AtomizeAndPinString(cx, name);
+    if (!atom)
+        return false;
+
+    JS::WeakCache<IdNameTable>& table =
+        GjsContextPrivate::from_cx(cx)->id_name_table();
+    jsid id = JS::PropertyKey::fromPinnedString(atom);
+    auto p = table.lookupForAdd(id);
+    if (p)
+        return true;
+    if (!table.add(p, id, g_intern_string(name))) {
+        JS_ReportOutOfMemory(cx);
+        return false;
+    }
+    return true;
 }
 
 /**
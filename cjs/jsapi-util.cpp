@@ -24,7 +24,6 @@
 
 #include <config.h>
 
-#include <stdio.h>   // for sscanf
 #include <string.h>  // for strlen
 
 #ifdef _WIN32
@@ -44,7 +43,7 @@
 #include <js/Class.h>
 #include <js/Conversions.h>
 #include <js/ErrorReport.h>
-#include <js/GCAPI.h>     // for JS_MaybeGC, NonIncrementalGC, GCRe...
+#include <js/GCAPI.h>     // for JS_MaybeGC
 #include <js/GCVector.h>  // for RootedVector
 #include <js/RootingAPI.h>
 #include <js/TypeDecls.h>
@@ -539,84 +538,6 @@ bool gjs_log_exception_uncaught(JSContext* cx) {
     return true;
 }
 
-#ifdef __linux__
-static void
-_linux_get_self_process_size (gulong *vm_size,
-                              gulong *rss_size)
-{
-    char *iter;
-    gsize len;
-    int i;
-
-    *vm_size = *rss_size = 0;
-
-    char* contents_unowned;
-    if (!g_file_get_contents("/proc/self/stat", &contents_unowned, &len,
-                             nullptr))
-        return;
-
-    GjsAutoChar contents = contents_unowned;
-    iter = contents;
-    /* See "man proc" for where this 22 comes from */
-    for (i = 0; i < 22; i++) {
-        iter = strchr (iter, ' ');
-        if (!iter)
-            return;
-        iter++;
-    }
-    sscanf (iter, " %lu", vm_size);
-    iter = strchr (iter, ' ');
-    if (iter)
-        sscanf (iter, " %lu", rss_size);
-}
-
-static gulong linux_rss_trigger;
-static int64_t last_gc_check_time;
-#endif
-
-void
-gjs_gc_if_needed (JSContext *context)
-{
-#ifdef __linux__
-    {
-        /* We initiate a GC if VM or RSS has grown by this much */
-        gulong vmsize;
-        gulong rss_size;
-        gint64 now;
-
-        /* We rate limit GCs to at most one per 5 frames.
-           One frame is 16666 microseconds (1000000/60)*/
-        now = g_get_monotonic_time();
-        if (now - last_gc_check_time < 5 * 16666)
-            return;
-
-        last_gc_check_time = now;
-
-        _linux_get_self_process_size (&vmsize, &rss_size);
-
-        /* linux_rss_trigger is initialized to 0, so currently
-         * we always do a full GC early.
-         *
-         * Here we see if the RSS has grown by 25% since
-         * our last look; if so, initiate a full GC.  In
-         * theory using RSS is bad if we get swapped out,
-         * since we may be overzealous in GC, but on the
-         * other hand, if swapping is going on, better
-         * to GC.
-         */
-        if (rss_size > linux_rss_trigger) {
-            linux_rss_trigger = (gulong) MIN(G_MAXULONG, rss_size * 1.25);
-            JS::NonIncrementalGC(context, GC_SHRINK, JS::GCReason::API);
-        } else if (rss_size < (0.75 * linux_rss_trigger)) {
-            /* If we've shrunk by 75%, lower the trigger */
-            linux_rss_trigger = (rss_size * 1.25);
-        }
-    }
-#else  // !__linux__
-    (void)context;
-#endif
-}
-
 /**
  * gjs_maybe_gc:
  *
@@ -626,7 +547,6 @@ void
 gjs_maybe_gc (JSContext *context)
 {
     JS_MaybeGC(context);
-    gjs_gc_if_needed(context);
 }
 
 /**
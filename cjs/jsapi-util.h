@@ -93,6 +93,8 @@ using GjsAutoChar =
 
 using GjsAutoStrv = GjsAutoPointer<char*, char*, g_strfreev>;
 
+using GjsAutoBytes = GjsAutoPointer<GBytes, GBytes, g_bytes_unref, g_bytes_ref>;
+
 template <typename T>
 using GjsAutoUnref = GjsAutoPointer<T, void, g_object_unref, g_object_ref>;
 
@@ -196,6 +198,51 @@ template <>
 struct GCPolicy<GjsAutoParam> : public IgnoreGCPolicy<GjsAutoParam> {};
 }  // namespace JS
 
+// Holds the UTF-8 encoding of a JS string. Strings whose encoding fits in the
+// inline storage of GjsStringBuffer<N> are converted without allocating; longer
+// ones are kept on the heap. Not copyable, since get() may point into itself.
+class GjsStringBufferBase {
+    char* m_storage;
+    size_t m_capacity;
+    JS::UniqueChars m_heap;
+    const char* m_chars = nullptr;
+    size_t m_length = 0;
+
+ protected:
+    GjsStringBufferBase(char* storage, size_t capacity)
+        : m_storage(storage), m_capacity(capacity) {}
+
+ public:
+    GjsStringBufferBase(const GjsStringBufferBase&) = delete;
+    GjsStringBufferBase& operator=(const GjsStringBufferBase&) = delete;
+
+    // Replaces the contents with the UTF-8 encoding of @str
+    GJS_JSAPI_RETURN_CONVENTION
+    bool init(JSContext* cx, JSString* str);
+
+    [[nodiscard]] const char* get() const { return m_chars; }
+    [[nodiscard]] size_t length() const { return m_length; }
+    explicit operator bool() const { return m_chars != nullptr; }
+
+    // Leaves the buffer empty, as for an id that is not a string
+    void reset() {
+        m_heap.reset();
+        m_chars = nullptr;
+        m_length = 0;
+    }
+
+    // Returns a copy that the caller owns and frees with g_free()
+    [[nodiscard]] char* dup() const { return g_strndup(m_chars, m_length); }
+};
+
+template <size_t N = 256>
+class GjsStringBuffer : public GjsStringBufferBase {
+    char m_inline[N];
+
+ public:
+    GjsStringBuffer() : GjsStringBufferBase(m_inline, N) {}
+};
+
 /* Flags that should be set on properties exported from native code modules.
  * Basically set these on API, but do NOT set them on data.
  *
@@ -262,6 +309,9 @@ bool gjs_log_exception_full(JSContext* cx, JS::HandleValue exc,
 
 void gjs_warning_reporter(JSContext*, JSErrorReport* report);
 
+// Returns the length of the run of ASCII bytes at the start of @data
+[[nodiscard]] size_t gjs_ascii_prefix_length(const uint8_t* data, size_t len);
+
 GJS_JSAPI_RETURN_CONVENTION
 JS::UniqueChars gjs_string_to_utf8(JSContext* cx, const JS::Value string_val);
 GJS_JSAPI_RETURN_CONVENTION
@@ -303,7 +353,11 @@ bool gjs_string_from_ucs4(JSContext             *cx,
                           JS::MutableHandleValue value_p);
 
 GJS_JSAPI_RETURN_CONVENTION
-bool gjs_get_string_id(JSContext* cx, jsid id, JS::UniqueChars* name_p);
+bool gjs_get_string_id(JSContext* cx, jsid id, GjsStringBufferBase* name_p);
+GJS_JSAPI_RETURN_CONVENTION
+bool gjs_get_interned_string_id(JSContext* cx, jsid id, const char** name_p);
+GJS_JSAPI_RETURN_CONVENTION
+bool gjs_preatomize_name(JSContext* cx, const char* name);
 GJS_JSAPI_RETURN_CONVENTION
 jsid        gjs_intern_string_to_id          (JSContext       *context,
                                               const char      *string);
@@ -316,7 +370,6 @@ bool        gjs_unichar_from_string          (JSContext       *context,
 /* Functions intended for more "internal" use */
 
 void gjs_maybe_gc (JSContext *context);
-void gjs_gc_if_needed(JSContext *cx);
 
 [[nodiscard]] std::u16string gjs_utf8_script_to_utf16(const char* script,
                                                       ssize_t len);
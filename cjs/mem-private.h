@@ -29,6 +29,8 @@
 typedef struct {
     volatile int value;
     const char* name;
+    // Memory owned by the counted objects, where it is known
+    volatile gssize bytes;
 } GjsMemCounter;
 
 // clang-format off
@@ -58,6 +60,14 @@ typedef struct {
 GJS_DECLARE_COUNTER(everything)
 GJS_FOR_EACH_COUNTER(GJS_DECLARE_COUNTER)
 
+#define GJS_COUNT_COUNTER(name) +1
+static constexpr unsigned GJS_N_COUNTERS =
+    0 GJS_FOR_EACH_COUNTER(GJS_COUNT_COUNTER);
+#undef GJS_COUNT_COUNTER
+
+// All the counters except everything, in the order of GJS_FOR_EACH_COUNTER
+extern GjsMemCounter* gjs_counters[GJS_N_COUNTERS];
+
 #define GJS_INC_COUNTER(name)                               \
     do {                                                    \
         g_atomic_int_add(&gjs_counter_everything.value, 1); \
@@ -72,4 +82,14 @@ GJS_FOR_EACH_COUNTER(GJS_DECLARE_COUNTER)
 
 #define GJS_GET_COUNTER(name) g_atomic_int_get(&gjs_counter_##name.value)
 
+#define GJS_INC_COUNTER_BYTES(name, size)                            \
+    do {                                                             \
+        gssize delta_ = static_cast<gssize>(size);                   \
+        g_atomic_pointer_add(&gjs_counter_everything.bytes, delta_); \
+        g_atomic_pointer_add(&gjs_counter_##name.bytes, delta_);     \
+    } while (0)
+
+#define GJS_DEC_COUNTER_BYTES(name, size) \
+    GJS_INC_COUNTER_BYTES(name, -static_cast<gssize>(size))
+
 #endif  // GJS_MEM_PRIVATE_H_
@@ -29,7 +29,7 @@
 
 #define GJS_DEFINE_COUNTER(name)             \
     GjsMemCounter gjs_counter_ ## name = { \
-        0, #name                                \
+        0, #name, 0                             \
     };
 
 
@@ -38,7 +38,8 @@ GJS_FOR_EACH_COUNTER(GJS_DEFINE_COUNTER)
 
 #define GJS_LIST_COUNTER(name) &gjs_counter_##name,
 
-static GjsMemCounter* counters[] = {GJS_FOR_EACH_COUNTER(GJS_LIST_COUNTER)};
+GjsMemCounter* gjs_counters[GJS_N_COUNTERS] = {
+    GJS_FOR_EACH_COUNTER(GJS_LIST_COUNTER)};
 
 void
 gjs_memory_report(const char *where,
@@ -52,11 +53,11 @@ gjs_memory_report(const char *where,
               "Memory report: %s",
               where);
 
-    n_counters = G_N_ELEMENTS(counters);
+    n_counters = GJS_N_COUNTERS;
 
     total_objects = 0;
     for (i = 0; i < n_counters; ++i) {
-        total_objects += counters[i]->value;
+        total_objects += gjs_counters[i]->value;
     }
 
     if (total_objects != GJS_GET_COUNTER(everything)) {
@@ -70,11 +71,48 @@ gjs_memory_report(const char *where,
 
     if (GJS_GET_COUNTER(everything) != 0) {
         for (i = 0; i < n_counters; ++i) {
-            gjs_debug(GJS_DEBUG_MEMORY, "    %24s = %d", counters[i]->name,
-                      counters[i]->value);
+            gjs_debug(GJS_DEBUG_MEMORY, "    %24s = %d",
+                      gjs_counters[i]->name, gjs_counters[i]->value);
         }
 
         if (die_if_leaks)
             g_error("%s: JavaScript objects were leaked.", where);
     }
 }
+
+/**
+ * gjs_memory_get_counters:
+ * @n_counters: (out): return location for the number of counters
+ *
+ * Takes a snapshot of the counters of live objects that GJS keeps, such as
+ * boxed instances or introspected functions. The first counter, named
+ * "everything", is the sum of all the others.
+ *
+ * Besides the number of objects, each counter has the number of bytes owned by
+ * them, where that is known: for example, the memory of boxed structs that GJS
+ * allocated itself, or the argument caches of functions. Memory that isn't
+ * known is not counted, so this is a lower bound.
+ *
+ * The counters are updated from any thread, so they are not guaranteed to add
+ * up exactly.
+ *
+ * Returns: (array length=n_counters) (transfer full): an array of counters,
+ *   free with g_free()
+ */
+GjsMemoryCounter* gjs_memory_get_counters(size_t* n_counters) {
+    g_return_val_if_fail(n_counters, nullptr);
+
+    *n_counters = GJS_N_COUNTERS + 1;
+    auto* retval = g_new(GjsMemoryCounter, *n_counters);
+
+    retval[0] = {gjs_counter_everything.name,
+                 g_atomic_int_get(&gjs_counter_everything.value),
+                 gssize(g_atomic_pointer_get(&gjs_counter_everything.bytes))};
+    for (unsigned ix = 0; ix < GJS_N_COUNTERS; ix++) {
+        GjsMemCounter* counter = gjs_counters[ix];
+        retval[ix + 1] = {counter->name, g_atomic_int_get(&counter->value),
+                          gssize(g_atomic_pointer_get(&counter->bytes))};
+    }
+
+    return retval;
+}
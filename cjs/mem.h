@@ -36,10 +36,19 @@
 
 G_BEGIN_DECLS
 
+typedef struct {
+    const char* name;
+    int count;
+    gssize bytes;
+} GjsMemoryCounter;
+
 GJS_EXPORT
 void gjs_memory_report(const char *where,
                        bool        die_if_leaks);
 
+GJS_EXPORT
+GjsMemoryCounter* gjs_memory_get_counters(size_t* n_counters);
+
 G_END_DECLS
 
 #endif  // GJS_MEM_H_
@@ -0,0 +1,180 @@
+/* -*- mode: C++; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * SPDX-License-Identifier: MIT OR LGPL-2.0-or-later
+ */
+
+#include <config.h>
+
+#include <stdint.h>
+#include <string.h>  // for strchr, strcmp, strlen
+
+#include <initializer_list>
+
+#include <gio/gio.h>
+#include <glib-object.h>
+#include <glib.h>
+
+#include "cjs/jsapi-util.h"
+#include "cjs/memory-monitor.h"
+#include "util/log.h"
+
+#if GLIB_CHECK_VERSION(2, 64, 0)
+static void on_low_memory_warning(GMemoryMonitor*,
+                                  GMemoryMonitorWarningLevel level,
+                                  void* data) {
+    auto* self = static_cast<GjsMemoryMonitor*>(data);
+    self->notify(level >= G_MEMORY_MONITOR_WARNING_LEVEL_CRITICAL
+                     ? GjsMemoryPressure::CRITICAL
+                     : GjsMemoryPressure::MODERATE);
+}
+#endif
+
+GjsMemoryMonitor::GjsMemoryMonitor(Callback callback, void* data)
+    : m_callback(callback), m_data(data) {
+    // Signals are emitted in the thread-default main context of whoever
+    // connects to them, which must be the context's thread
+    GjsAutoPointer<GSource, GSource, g_source_unref> source =
+        g_idle_source_new();
+    g_source_set_priority(source, G_PRIORITY_LOW);
+    g_source_set_callback(source, &GjsMemoryMonitor::on_setup, this, nullptr);
+    m_setup_id = g_source_attach(source, g_main_context_get_thread_default());
+}
+
+GjsMemoryMonitor::~GjsMemoryMonitor() {
+    if (m_setup_id) {
+        GSource* source = g_main_context_find_source_by_id(
+            g_main_context_get_thread_default(), m_setup_id);
+        if (source)
+            g_source_destroy(source);
+    }
+
+#if GLIB_CHECK_VERSION(2, 64, 0)
+    if (m_monitor)
+        g_signal_handlers_disconnect_by_data(m_monitor, this);
+#endif
+
+    if (m_events_monitor) {
+        g_signal_handlers_disconnect_by_data(m_events_monitor, this);
+        g_file_monitor_cancel(m_events_monitor);
+    }
+}
+
+gboolean GjsMemoryMonitor::on_setup(void* data) {
+    auto* self = static_cast<GjsMemoryMonitor*>(data);
+    self->m_setup_id = 0;
+
+#if GLIB_CHECK_VERSION(2, 64, 0)
+    self->m_monitor = g_memory_monitor_dup_default();
+    if (self->m_monitor)
+        g_signal_connect(self->m_monitor, "low-memory-warning",
+                         G_CALLBACK(on_low_memory_warning), self);
+#endif
+
+    self->watch_cgroup();
+    return G_SOURCE_REMOVE;
+}
+
+void GjsMemoryMonitor::notify(GjsMemoryPressure pressure) {
+    gjs_debug(GJS_DEBUG_CONTEXT, "Memory pressure: %s",
+              pressure == GjsMemoryPressure::CRITICAL ? "critical"
+                                                      : "moderate");
+    m_callback(pressure, m_data);
+}
+
+// Returns the cgroup v2 directory of the process, if it has a memory limit
+[[nodiscard]] static char* limited_cgroup_dir() {
+#ifdef __linux__
+    char* contents;
+    if (!g_file_get_contents("/proc/self/cgroup", &contents, nullptr, nullptr))
+        return nullptr;
+    GjsAutoChar cgroups = contents;
+
+    // In cgroup v2, the process's line is "0::/path/of/cgroup"
+    GjsAutoChar dir;
+    GjsAutoStrv lines = g_strsplit(cgroups, "\n", -1);
+    for (char** line = lines; *line; line++) {
+        if (g_str_has_prefix(*line, "0::/")) {
+            dir = g_build_filename("/sys/fs/cgroup", *line + strlen("0::/"),
+                                   nullptr);
+            break;
+        }
+    }
+    if (!dir)
+        return nullptr;
+
+    for (const char* limit : {"memory.high", "memory.max"}) {
+        GjsAutoChar path = g_build_filename(dir, limit, nullptr);
+        if (!g_file_get_contents(path, &contents, nullptr, nullptr))
+            continue;
+        GjsAutoChar value = g_strstrip(contents);
+        if (strcmp(value, "max") != 0)
+            return dir.release();
+    }
+#endif
+    return nullptr;
+}
+
+void GjsMemoryMonitor::watch_cgroup() {
+    GjsAutoChar dir = limited_cgroup_dir();
+    if (!dir)
+        return;
+
+    m_events_path = g_build_filename(dir, "memory.events", nullptr);
+    if (!read_cgroup_events(&m_n_high, &m_n_max))
+        return;
+
+    // The kernel notifies changes to memory.events like changes to a file
+    GjsAutoUnref<GFile> file = g_file_new_for_path(m_events_path);
+    m_events_monitor =
+        g_file_monitor_file(file, G_FILE_MONITOR_NONE, nullptr, nullptr);
+    if (!m_events_monitor)
+        return;
+
+    g_file_monitor_set_rate_limit(m_events_monitor, 100);
+    g_signal_connect(m_events_monitor, "changed",
+                     G_CALLBACK(&GjsMemoryMonitor::on_cgroup_events_changed),
+                     this);
+    gjs_debug(GJS_DEBUG_CONTEXT, "Watching %s for memory pressure",
+              m_events_path.get());
+}
+
+// memory.events has lines of "key count", where "high" counts the times the
+// cgroup went over memory.high, and "max" the times it hit memory.max
+bool GjsMemoryMonitor::read_cgroup_events(uint64_t* n_high, uint64_t* n_max) {
+    char* contents;
+    if (!g_file_get_contents(m_events_path, &contents, nullptr, nullptr))
+        return false;
+    GjsAutoChar events = contents;
+
+    *n_high = *n_max = 0;
+    GjsAutoStrv lines = g_strsplit(events, "\n", -1);
+    for (char** line = lines; *line; line++) {
+        const char* count = strchr(*line, ' ');
+        if (!count)
+            continue;
+        if (g_str_has_prefix(*line, "high "))
+            *n_high = g_ascii_strtoull(count + 1, nullptr, 10);
+        else if (g_str_has_prefix(*line, "max "))
+            *n_max = g_ascii_strtoull(count + 1, nullptr, 10);
+    }
+    return true;
+}
+
+void GjsMemoryMonitor::on_cgroup_events_changed(GFileMonitor*, GFile*, GFile*,
+                                                GFileMonitorEvent,
+                                                void* data) {
+    auto* self = static_cast<GjsMemoryMonitor*>(data);
+    uint64_t n_high, n_max;
+    if (!self->read_cgroup_events(&n_high, &n_max))
+        return;
+
+    bool went_high = n_high > self->m_n_high;
+    bool hit_max = n_max > self->m_n_max;
+    self->m_n_high = n_high;
+    self->m_n_max = n_max;
+
+    if (hit_max)
+        self->notify(GjsMemoryPressure::CRITICAL);
+    else if (went_high)
+        self->notify(GjsMemoryPressure::MODERATE);
+}
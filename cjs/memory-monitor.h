@@ -0,0 +1,71 @@
+/* -*- mode: C++; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * SPDX-License-Identifier: MIT OR LGPL-2.0-or-later
+ */
+
+#ifndef GJS_MEMORY_MONITOR_H_
+#define GJS_MEMORY_MONITOR_H_
+
+#include <config.h>
+
+#include <stdint.h>
+
+#include <gio/gio.h>
+#include <glib.h>
+
+#include "cjs/jsapi-util.h"
+
+// memory-monitor.h - Notices when the system, or the cgroup that the process
+// runs in, is low on memory.
+//
+// Listens to GMemoryMonitor's low-memory-warning signal, with GLib 2.64 or
+// later, and on Linux also watches the memory.events file of the process's
+// cgroup if the cgroup has a memory limit. A cgroup can reach its limit long
+// before the system as a whole is low on memory, which GMemoryMonitor would not
+// report.
+
+enum class GjsMemoryPressure : uint8_t {
+    // Memory is being reclaimed, or the cgroup went over memory.high
+    MODERATE,
+    // Processes are about to be killed, or the cgroup reached memory.max
+    CRITICAL,
+};
+
+class GjsMemoryMonitor {
+ public:
+    using Callback = void (*)(GjsMemoryPressure pressure, void* data);
+
+ private:
+    Callback m_callback;
+    void* m_data;
+    unsigned m_setup_id;
+
+#if GLIB_CHECK_VERSION(2, 64, 0)
+    GjsAutoUnref<GMemoryMonitor> m_monitor;
+#endif
+
+    // cgroup v2 memory.events, and the counts last read from it
+    GjsAutoChar m_events_path;
+    GjsAutoUnref<GFileMonitor> m_events_monitor;
+    uint64_t m_n_high = 0;
+    uint64_t m_n_max = 0;
+
+    static gboolean on_setup(void* data);
+    void watch_cgroup();
+    [[nodiscard]] bool read_cgroup_events(uint64_t* n_high, uint64_t* n_max);
+    static void on_cgroup_events_changed(GFileMonitor*, GFile*, GFile*,
+                                         GFileMonitorEvent, void* data);
+
+ public:
+    // Starts watching from the main loop, so that programs that never run it
+    // don't pay for connecting to the monitors
+    GjsMemoryMonitor(Callback callback, void* data);
+    ~GjsMemoryMonitor();
+
+    GjsMemoryMonitor(const GjsMemoryMonitor&) = delete;
+    GjsMemoryMonitor& operator=(const GjsMemoryMonitor&) = delete;
+
+    void notify(GjsMemoryPressure pressure);
+};
+
+#endif  // GJS_MEMORY_MONITOR_H_
@@ -26,8 +26,6 @@
 #include <stddef.h>     // for size_t
 #include <sys/types.h>  // for ssize_t
 
-#include <string>  // for u16string
-
 #include <gio/gio.h>
 #include <glib.h>
 
@@ -37,14 +35,16 @@
 #include <js/GCVector.h>  // for RootedVector
 #include <js/PropertyDescriptor.h>
 #include <js/RootingAPI.h>
-#include <js/SourceText.h>
 #include <js/TypeDecls.h>
-#include <jsapi.h>  // for JS_DefinePropertyById, ...
+#include <jsapi.h>  // for JS_DefinePropertyById, JS_ExecuteScript, ...
 
 #include "cjs/context-private.h"
+#include "cjs/engine.h"
 #include "cjs/jsapi-util.h"
 #include "cjs/mem-private.h"
 #include "cjs/module.h"
+#include "cjs/profiler-private.h"
+#include "cjs/script-cache.h"
 #include "util/log.h"
 
 class GjsScriptModule {
@@ -96,14 +96,17 @@ class GjsScriptModule {
     bool evaluate_import(JSContext* cx, JS::HandleObject module,
                          const char* script, ssize_t script_len,
                          const char* filename) {
-        std::u16string utf16_string =
-            gjs_utf8_script_to_utf16(script, script_len);
-        // COMPAT: This could use JS::SourceText<mozilla::Utf8Unit> directly,
-        // but that messes up code coverage. See bug
-        // https://bugzilla.mozilla.org/show_bug.cgi?id=1404784
-        JS::SourceText<char16_t> buf;
-        if (!buf.init(cx, utf16_string.c_str(), utf16_string.size(),
-                      JS::SourceOwnership::Borrowed))
+        GjsProfilerScope profiler_scope(cx, "Evaluate module", filename);
+
+        JS::CompileOptions options(cx);
+        // Sources in GResources can be reloaded by the source hook when
+        // needed, so SpiderMonkey need not keep a copy
+        options.setFileAndLine(filename, 1)
+            .setSourceIsLazy(g_str_has_prefix(filename, "resource://"));
+
+        JS::RootedScript compiled(
+            cx, gjs_compile_script(cx, options, script, script_len));
+        if (!compiled)
             return false;
 
         JS::RootedObjectVector scope_chain(cx);
@@ -112,11 +115,8 @@ class GjsScriptModule {
             return false;
         }
 
-        JS::CompileOptions options(cx);
-        options.setFileAndLine(filename, 1);
-
         JS::RootedValue ignored_retval(cx);
-        if (!JS::Evaluate(cx, scope_chain, options, buf, &ignored_retval))
+        if (!JS_ExecuteScript(cx, scope_chain, compiled, &ignored_retval))
             return false;
 
         GjsContextPrivate* gjs = GjsContextPrivate::from_cx(cx);
@@ -135,18 +135,17 @@ class GjsScriptModule {
                 GFile           *file)
     {
         GError *error = nullptr;
-        char *unowned_script;
-        size_t script_len = 0;
-
-        if (!(g_file_load_contents(file, nullptr, &unowned_script, &script_len,
-                                   nullptr, &error)))
+        GjsAutoBytes script_bytes = gjs_load_script_file(file, &error);
+        if (!script_bytes)
             return gjs_throw_gerror_message(cx, error);
 
-        GjsAutoChar script = unowned_script;  /* steals ownership */
-        g_assert(script);
+        size_t script_len;
+        auto* script = static_cast<const char*>(
+            g_bytes_get_data(script_bytes, &script_len));
 
         GjsAutoChar full_path = g_file_get_parse_name(file);
-        return evaluate_import(cx, module, script, script_len, full_path);
+        return evaluate_import(cx, module, script ? script : "", script_len,
+                               full_path);
     }
 
     /* JSClass operations */
@@ -26,6 +26,8 @@
 
 #include <stdint.h>
 
+#include <js/TypeDecls.h>
+
 #include "cjs/context.h"
 #include "cjs/macros.h"
 #include "cjs/profiler.h"
@@ -41,4 +43,22 @@ void _gjs_profiler_add_mark(GjsProfiler* self, int64_t time, int64_t duration,
 
 void _gjs_profiler_setup_signals(GjsProfiler *self, GjsContext *context);
 
+// Marks a phase of startup, such as an import or a class definition, for the
+// lifetime of the object: as a mark in the "GJS" group of the sysprof capture
+// if the profiler is running, and with the startup__phase__begin/end probes.
+// @detail (a module or class name) must outlive the object.
+class GjsProfilerScope {
+    GjsProfiler* m_profiler;  // only set if recording a mark
+    const char* m_phase;
+    const char* m_detail;
+    int64_t m_start_time;
+
+ public:
+    GjsProfilerScope(JSContext* cx, const char* phase, const char* detail);
+    ~GjsProfilerScope();
+
+    GjsProfilerScope(const GjsProfilerScope&) = delete;
+    GjsProfilerScope& operator=(const GjsProfilerScope&) = delete;
+};
+
 #endif  // GJS_PROFILER_PRIVATE_H_
@@ -33,6 +33,7 @@
 #ifdef ENABLE_PROFILER
 #    include <alloca.h>
 #    include <errno.h>
+#    include <pthread.h>  // for pthread_getattr_np, pthread_attr_getstack
 #    include <stddef.h>  // for size_t
 #    include <stdint.h>
 #    include <stdio.h>      // for sscanf
@@ -41,6 +42,7 @@
 #    include <sys/types.h>  // for timer_t
 #    include <syscall.h>    // for __NR_gettid
 #    include <time.h>       // for itimerspec, timer_delete, ...
+#    include <ucontext.h>   // for ucontext_t
 #    ifdef HAVE_UNISTD_H
 #        include <unistd.h>  // for getpid, syscall
 #    endif
@@ -50,13 +52,20 @@
 #    include <sysprof-capture.h>
 #endif
 
+#include <js/GCAPI.h>           // for JS_GetGCParameter, JSGC_BYTES
 #include <js/ProfilingStack.h>  // for EnableContextProfilingStack, ...
 
+#include "gi/toggle.h"
+#include "cjs/context-private.h"
 #include "cjs/context.h"
 #include "cjs/jsapi-util.h"
+#include "cjs/mem-private.h"
+#include "cjs/profiler-private.h"
 #include "cjs/profiler.h"
+#include "gi/gjs_gi_trace.h"
 
 #define FLUSH_DELAY_SECONDS 3
+#define DEFAULT_COUNTER_INTERVAL_MSEC 100
 
 /*
  * This is mostly non-exciting code wrapping the builtin Profiler in
@@ -86,7 +95,8 @@
  * deadlocks are very likely. Most of GjsProfilerCapture is signal-safe.
  */
 
-#define SAMPLES_PER_SEC G_GUINT64_CONSTANT(1000)
+#define DEFAULT_SAMPLES_PER_SEC 1000
+#define MAX_NATIVE_FRAMES 128
 #define NSEC_PER_SEC G_GUINT64_CONSTANT(1000000000)
 
 G_DEFINE_POINTER_TYPE(GjsProfiler, gjs_profiler)
@@ -105,6 +115,12 @@ struct _GjsProfiler {
     /* Buffers and writes our sampled stacks */
     SysprofCaptureWriter* capture;
     GSource* periodic_flush;
+
+    /* How often counters are sampled, or 0 not to record them, and when the
+     * capture was last flushed */
+    unsigned counter_interval_msec;
+    unsigned counter_base;
+    int64_t last_flush_time;
 #endif  /* ENABLE_PROFILER */
 
     /* The filename to write to */
@@ -113,6 +129,10 @@ struct _GjsProfiler {
     /* An FD to capture to */
     int fd;
 
+    /* How many samples to take each second of wall-clock time, or of CPU time
+     * spent on the JS thread if cpu_time_clock is set */
+    unsigned sample_rate;
+
 #ifdef ENABLE_PROFILER
     /* Our POSIX timer to wakeup SIGPROF */
     timer_t timer;
@@ -120,12 +140,20 @@ struct _GjsProfiler {
     /* Cached copy of our pid */
     GPid pid;
 
+    /* Upper bound of the JS thread's stack, so that native frames can be
+     * walked in the SIGPROF handler without reading outside of it */
+    uintptr_t stack_top;
+
     /* GLib signal handler ID for SIGUSR2 */
     unsigned sigusr2_id;
 #endif  /* ENABLE_PROFILER */
 
     /* If we are currently sampling */
     unsigned running : 1;
+
+    /* If the sampling timer counts CPU time of the JS thread rather than
+     * wall-clock time, so that the main loop waiting doesn't get sampled */
+    unsigned cpu_time_clock : 1;
 };
 
 static GjsContext *profiling_context;
@@ -229,6 +257,21 @@ _gjs_profiler_new(GjsContext *context)
     self->pid = getpid();
 #endif
     self->fd = -1;
+    self->sample_rate = DEFAULT_SAMPLES_PER_SEC;
+
+    /* GJS_ENABLE_PROFILER may carry comma-separated options after the value
+     * that enables it, e.g. "1,rate=100,cpu" */
+    const char* env_profiler = g_getenv("GJS_ENABLE_PROFILER");
+    GjsAutoStrv options = g_strsplit(env_profiler ? env_profiler : "", ",", -1);
+    for (char** option = options; *option; option++) {
+        if (g_str_has_prefix(*option, "rate=")) {
+            guint64 rate = g_ascii_strtoull(*option + 5, nullptr, 10);
+            if (rate > 0 && rate <= NSEC_PER_SEC)
+                self->sample_rate = rate;
+        } else if (g_strcmp0(*option, "cpu") == 0) {
+            self->cpu_time_clock = true;
+        }
+    }
 
     profiling_context = context;
 
@@ -287,8 +330,78 @@ _gjs_profiler_is_running(GjsProfiler *self)
 
 #ifdef ENABLE_PROFILER
 
+/* A native frame found by walking the frame pointer chain. @frame is the
+ * address of the frame on the stack, used to interleave it with the
+ * ProfilingStack entries, whose stack addresses come from the same stack. */
+struct NativeFrame {
+    uintptr_t pc;
+    uintptr_t frame;
+};
+
+/*
+ * walk_native_stack:
+ *
+ * Walks the frame pointer chain of the interrupted code, starting from the
+ * registers saved in @ucontext, and stores the frames in @frames from the
+ * innermost outwards. Only memory between the interrupted stack pointer and
+ * @stack_top is read, and the walk stops as soon as the chain doesn't look
+ * like a chain of frames, so this is safe in a signal handler even for code
+ * compiled without frame pointers; such code just contributes fewer frames.
+ *
+ * Returns: the number of frames stored.
+ */
+static size_t walk_native_stack(const void* ucontext, uintptr_t stack_top,
+                                NativeFrame* frames, size_t max_frames) {
+    if (!ucontext || stack_top == 0 || max_frames == 0)
+        return 0;
+
+    const mcontext_t& mcontext =
+        static_cast<const ucontext_t*>(ucontext)->uc_mcontext;
+    uintptr_t pc, sp, fp;
+#    if defined(__x86_64__)
+    pc = mcontext.gregs[REG_RIP];
+    sp = mcontext.gregs[REG_RSP];
+    fp = mcontext.gregs[REG_RBP];
+#    elif defined(__i386__)
+    pc = mcontext.gregs[REG_EIP];
+    sp = mcontext.gregs[REG_ESP];
+    fp = mcontext.gregs[REG_EBP];
+#    elif defined(__aarch64__)
+    pc = mcontext.pc;
+    sp = mcontext.sp;
+    fp = mcontext.regs[29];
+#    else
+    (void)mcontext;
+    return 0;
+#    endif
+
+    size_t n_frames = 0;
+    frames[n_frames++] = {pc, sp};
+
+    // Each frame starts with the caller's frame pointer, followed by the
+    // return address
+    while (n_frames < max_frames) {
+        if (fp < sp || fp % sizeof(uintptr_t) != 0 ||
+            fp > stack_top - 2 * sizeof(uintptr_t))
+            break;
+
+        auto* frame = reinterpret_cast<const uintptr_t*>(fp);
+        uintptr_t return_address = frame[1];
+        if (return_address == 0)
+            break;
+
+        frames[n_frames++] = {return_address, fp};
+
+        // The stack grows down, so callers' frames are at higher addresses
+        sp = fp + 2 * sizeof(uintptr_t);
+        fp = frame[0];
+    }
+
+    return n_frames;
+}
+
 static void gjs_profiler_sigprof(int signum [[maybe_unused]], siginfo_t* info,
-                                 void*) {
+                                 void* ucontext) {
     GjsProfiler *self = gjs_context_get_profiler(profiling_context);
 
     g_assert(((void) "SIGPROF handler called with invalid signal info", info));
@@ -312,19 +425,49 @@ static void gjs_profiler_sigprof(int signum [[maybe_unused]], siginfo_t* info,
 
     int64_t now = g_get_monotonic_time() * 1000L;
 
+    NativeFrame native_frames[MAX_NATIVE_FRAMES];
+    size_t n_native = walk_native_stack(ucontext, self->stack_top,
+                                        native_frames, MAX_NATIVE_FRAMES);
+
     /* NOTE: cppcheck warns that alloca() is not recommended since it can
      * easily overflow the stack; however, dynamic allocation is not an option
      * here since we are in a signal handler.
      */
-    SysprofCaptureAddress* addrs =
+    /* The JS frames don't have a stack address of their own; they run inside
+     * the native frame of the label frame that was pushed before them. */
+    uintptr_t* frame_addresses =
         // cppcheck-suppress allocaCalled
-        static_cast<SysprofCaptureAddress*>(alloca(sizeof *addrs * depth));
-
+        static_cast<uintptr_t*>(alloca(sizeof *frame_addresses * depth));
+    uintptr_t last_address = 0;
     for (uint32_t ix = 0; ix < depth; ix++) {
         js::ProfilingStackFrame& entry = self->stack.frames[ix];
+        if (!entry.isJsFrame())
+            last_address = uintptr_t(entry.stackAddress());
+        frame_addresses[ix] = last_address;
+    }
+
+    SysprofCaptureAddress* addrs =
+        // cppcheck-suppress allocaCalled
+        static_cast<SysprofCaptureAddress*>(
+            alloca(sizeof *addrs * (depth + n_native)));
+    size_t n_addrs = 0;
+    size_t native_ix = 0;
+
+    /* The sample goes from the innermost frame outwards. Native frames are
+     * interleaved with the ProfilingStack entries by their position on the
+     * stack, so that time spent in C code called from JS is attributed to
+     * the C functions, under the JS function that called them. */
+    for (uint32_t flipped = 0; flipped < depth; flipped++) {
+        uint32_t ix = depth - 1 - flipped;
+        js::ProfilingStackFrame& entry = self->stack.frames[ix];
+
+        while (native_ix < n_native &&
+               native_frames[native_ix].frame < frame_addresses[ix])
+            addrs[n_addrs++] =
+                SysprofCaptureAddress(native_frames[native_ix++].pc);
+
         const char *label = entry.label();
         const char *dynamic_string = entry.dynamicString();
-        uint32_t flipped = depth - 1 - ix;
         size_t label_length = strlen(label);
 
         /*
@@ -374,14 +517,110 @@ static void gjs_profiler_sigprof(int signum [[maybe_unused]], siginfo_t* info,
          * everything will show up as [stack] when building callgraphs.
          */
         if (final_string[0] != '\0')
-            addrs[flipped] =
+            addrs[n_addrs++] =
                 sysprof_capture_writer_add_jitmap(self->capture, final_string);
         else
-            addrs[flipped] = SysprofCaptureAddress(entry.stackAddress());
+            addrs[n_addrs++] = SysprofCaptureAddress(entry.stackAddress());
     }
 
+    while (native_ix < n_native)
+        addrs[n_addrs++] = SysprofCaptureAddress(native_frames[native_ix++].pc);
+
     if (!sysprof_capture_writer_add_sample(self->capture, now, -1, self->pid,
-                                           -1, addrs, depth))
+                                           -1, addrs, n_addrs))
+        gjs_profiler_stop(self);
+}
+
+/* Counters sampled periodically while the profiler is running. They are
+ * followed by one counter for each of GJS_FOR_EACH_COUNTER and one for all of
+ * them together. */
+enum GjsProfilerCounter {
+    COUNTER_HEAP_BYTES,
+    COUNTER_NURSERY_BYTES,
+    COUNTER_MAJOR_GCS,
+    COUNTER_MINOR_GCS,
+    COUNTER_MAJOR_GC_TIME,
+    COUNTER_MINOR_GC_TIME,
+    COUNTER_TOGGLE_QUEUE,
+    N_FIXED_COUNTERS,
+};
+
+static const struct {
+    const char* name;
+    const char* description;
+} fixed_counters[N_FIXED_COUNTERS] = {
+    {"Heap bytes", "Bytes allocated by the JS garbage collector"},
+    {"Nursery bytes", "Size of the JS garbage collector's nursery"},
+    {"Major GCs", "Number of full garbage collections"},
+    {"Minor GCs", "Number of nursery collections"},
+    {"Major GC time", "Total time spent in full collections (ns)"},
+    {"Minor GC time", "Total time spent in nursery collections (ns)"},
+    {"Toggle queue", "Toggle notifications waiting to be processed"},
+};
+
+static constexpr unsigned N_COUNTERS = N_FIXED_COUNTERS + GJS_N_COUNTERS + 1;
+
+[[nodiscard]] static bool gjs_profiler_define_counters(GjsProfiler* self) {
+    SysprofCaptureCounter counters[N_COUNTERS] = {};
+
+    self->counter_base =
+        sysprof_capture_writer_request_counter(self->capture, N_COUNTERS);
+
+    for (unsigned ix = 0; ix < N_COUNTERS; ix++) {
+        SysprofCaptureCounter& counter = counters[ix];
+        counter.id = self->counter_base + ix;
+        counter.type = SYSPROF_CAPTURE_COUNTER_INT64;
+
+        if (ix < N_FIXED_COUNTERS) {
+            g_strlcpy(counter.category, "GJS", sizeof counter.category);
+            g_strlcpy(counter.name, fixed_counters[ix].name,
+                      sizeof counter.name);
+            g_strlcpy(counter.description, fixed_counters[ix].description,
+                      sizeof counter.description);
+            continue;
+        }
+
+        const GjsMemCounter* mem_counter =
+            ix < N_COUNTERS - 1 ? gjs_counters[ix - N_FIXED_COUNTERS]
+                                : &gjs_counter_everything;
+        g_strlcpy(counter.category, "GJS Objects", sizeof counter.category);
+        g_strlcpy(counter.name, mem_counter->name, sizeof counter.name);
+        g_strlcpy(counter.description, "Number of live wrapper objects",
+                  sizeof counter.description);
+    }
+
+    int64_t now = g_get_monotonic_time() * 1000L;
+    return sysprof_capture_writer_define_counters(self->capture, now, -1,
+                                                  self->pid, counters,
+                                                  N_COUNTERS);
+}
+
+static void gjs_profiler_sample_counters(GjsProfiler* self) {
+    const GjsContextPrivate::GCStats& gc_stats =
+        GjsContextPrivate::from_cx(self->cx)->gc_stats();
+
+    unsigned ids[N_COUNTERS];
+    SysprofCaptureCounterValue values[N_COUNTERS];
+
+    values[COUNTER_HEAP_BYTES].v64 = JS_GetGCParameter(self->cx, JSGC_BYTES);
+    values[COUNTER_NURSERY_BYTES].v64 =
+        JS_GetGCParameter(self->cx, JSGC_NURSERY_BYTES);
+    values[COUNTER_MAJOR_GCS].v64 = gc_stats.major_count;
+    values[COUNTER_MINOR_GCS].v64 = gc_stats.minor_collections.calls;
+    values[COUNTER_MAJOR_GC_TIME].v64 = gc_stats.major_slices.total_ns;
+    values[COUNTER_MINOR_GC_TIME].v64 = gc_stats.minor_collections.total_ns;
+    values[COUNTER_TOGGLE_QUEUE].v64 = ToggleQueue::get_default().size();
+    for (unsigned ix = 0; ix < GJS_N_COUNTERS; ix++)
+        values[N_FIXED_COUNTERS + ix].v64 =
+            g_atomic_int_get(&gjs_counters[ix]->value);
+    values[N_COUNTERS - 1].v64 = GJS_GET_COUNTER(everything);
+
+    for (unsigned ix = 0; ix < N_COUNTERS; ix++)
+        ids[ix] = self->counter_base + ix;
+
+    int64_t now = g_get_monotonic_time() * 1000L;
+    if (!sysprof_capture_writer_set_counters(self->capture, now, -1, self->pid,
+                                             ids, values, N_COUNTERS))
         gjs_profiler_stop(self);
 }
 
@@ -391,7 +630,20 @@ static gboolean profiler_auto_flush_cb(void* user_data) {
     if (!self->running)
         return G_SOURCE_REMOVE;
 
+    // When counters are recorded, this runs at the counter interval, and
+    // flushes only every FLUSH_DELAY_SECONDS
+    if (self->counter_interval_msec > 0) {
+        gjs_profiler_sample_counters(self);
+        if (!self->running)
+            return G_SOURCE_REMOVE;
+    }
+
+    int64_t now = g_get_monotonic_time();
+    if (now - self->last_flush_time < FLUSH_DELAY_SECONDS * G_USEC_PER_SEC)
+        return G_SOURCE_CONTINUE;
+
     sysprof_capture_writer_flush(self->capture);
+    self->last_flush_time = now;
 
     return G_SOURCE_CONTINUE;
 }
@@ -446,9 +698,22 @@ gjs_profiler_start(GjsProfiler *self)
     }
 
     /* Automatically flush to be resilient against SIGINT, etc */
+    self->counter_interval_msec = DEFAULT_COUNTER_INTERVAL_MSEC;
+    if (const char* interval = g_getenv("GJS_PROFILER_COUNTER_INTERVAL_MS"))
+        self->counter_interval_msec = g_ascii_strtoull(interval, nullptr, 10);
+
+    if (self->counter_interval_msec > 0 &&
+        !gjs_profiler_define_counters(self)) {
+        g_warning("Failed to define profiler counters");
+        self->counter_interval_msec = 0;
+    }
+
     if (!self->periodic_flush) {
+        self->last_flush_time = g_get_monotonic_time();
         self->periodic_flush =
-            g_timeout_source_new_seconds(FLUSH_DELAY_SECONDS);
+            self->counter_interval_msec > 0
+                ? g_timeout_source_new(self->counter_interval_msec)
+                : g_timeout_source_new_seconds(FLUSH_DELAY_SECONDS);
         g_source_set_name(self->periodic_flush,
                           "[sysprof-capture-writer-flush]");
         g_source_set_priority(self->periodic_flush, G_PRIORITY_LOW + 100);
@@ -466,6 +731,17 @@ gjs_profiler_start(GjsProfiler *self)
         return;
     }
 
+    /* The SIGPROF handler may only walk native frames within the stack of
+     * this thread, which is the one that will be interrupted */
+    pthread_attr_t attr;
+    if (pthread_getattr_np(pthread_self(), &attr) == 0) {
+        void* stack_base;
+        size_t stack_size;
+        if (pthread_attr_getstack(&attr, &stack_base, &stack_size) == 0)
+            self->stack_top = uintptr_t(stack_base) + stack_size;
+        pthread_attr_destroy(&attr);
+    }
+
     /* Setup our signal handler for SIGPROF delivery */
     sa.sa_flags = SA_RESTART | SA_SIGINFO;
     sa.sa_sigaction = gjs_profiler_sigprof;
@@ -492,7 +768,9 @@ gjs_profiler_start(GjsProfiler *self)
     sev.sigev_signo = SIGPROF;
     sev._sigev_un._tid = syscall(__NR_gettid);
 
-    if (timer_create(CLOCK_MONOTONIC, &sev, &self->timer) == -1) {
+    clockid_t clock =
+        self->cpu_time_clock ? CLOCK_THREAD_CPUTIME_ID : CLOCK_MONOTONIC;
+    if (timer_create(clock, &sev, &self->timer) == -1) {
         g_warning("Failed to create profiler timer: %s", g_strerror(errno));
         g_clear_pointer(&self->capture, sysprof_capture_writer_unref);
         g_clear_pointer(&self->periodic_flush, g_source_destroy);
@@ -500,10 +778,10 @@ gjs_profiler_start(GjsProfiler *self)
     }
 
     /* Calculate sampling interval */
-    its.it_interval.tv_sec = 0;
-    its.it_interval.tv_nsec = NSEC_PER_SEC / SAMPLES_PER_SEC;
-    its.it_value.tv_sec = 0;
-    its.it_value.tv_nsec = NSEC_PER_SEC / SAMPLES_PER_SEC;
+    guint64 interval_nsec = NSEC_PER_SEC / self->sample_rate;
+    its.it_interval.tv_sec = interval_nsec / NSEC_PER_SEC;
+    its.it_interval.tv_nsec = interval_nsec % NSEC_PER_SEC;
+    its.it_value = its.it_interval;
 
     /* Now start this timer */
     if (timer_settime(self->timer, 0, &its, &old_its) != 0) {
@@ -691,6 +969,39 @@ gjs_profiler_set_filename(GjsProfiler *self,
     self->filename = g_strdup(filename);
 }
 
+/**
+ * gjs_profiler_set_sample_rate:
+ * @self: A #GjsProfiler
+ * @samples_per_sec: how many stack samples to take each second
+ *
+ * Set how often the JS stack is sampled while @self is running. By default,
+ * this is 1000 times per second; lower rates have less overhead, for leaving
+ * the profiler on for a long time.
+ */
+void gjs_profiler_set_sample_rate(GjsProfiler* self, unsigned samples_per_sec) {
+    g_return_if_fail(self);
+    g_return_if_fail(!self->running);
+    g_return_if_fail(samples_per_sec > 0 && samples_per_sec <= NSEC_PER_SEC);
+
+    self->sample_rate = samples_per_sec;
+}
+
+/**
+ * gjs_profiler_set_cpu_time_clock:
+ * @self: A #GjsProfiler
+ * @enabled: whether to sample according to CPU time
+ *
+ * If @enabled is %TRUE, the sample rate of @self counts CPU time spent on the
+ * JS thread instead of wall-clock time, so that no samples are taken while the
+ * thread is idle, for example waiting in the main loop.
+ */
+void gjs_profiler_set_cpu_time_clock(GjsProfiler* self, gboolean enabled) {
+    g_return_if_fail(self);
+    g_return_if_fail(!self->running);
+
+    self->cpu_time_clock = !!enabled;
+}
+
 void _gjs_profiler_add_mark(GjsProfiler* self, gint64 time_nsec,
                             gint64 duration_nsec, const char* group,
                             const char* name, const char* message) {
@@ -711,6 +1022,31 @@ void _gjs_profiler_add_mark(GjsProfiler* self, gint64 time_nsec,
 #endif
 }
 
+GjsProfilerScope::GjsProfilerScope(JSContext* cx, const char* phase,
+                                   const char* detail)
+    : m_profiler(nullptr), m_phase(phase), m_detail(detail), m_start_time(0) {
+    TRACE(GJS_STARTUP_PHASE_BEGIN(const_cast<char*>(phase),
+                                  const_cast<char*>(detail)));
+
+    GjsProfiler* profiler = GjsContextPrivate::from_cx(cx)->profiler();
+    if (profiler && _gjs_profiler_is_running(profiler)) {
+        m_profiler = profiler;
+        m_start_time = g_get_monotonic_time();
+    }
+}
+
+GjsProfilerScope::~GjsProfilerScope() {
+    TRACE(GJS_STARTUP_PHASE_END(const_cast<char*>(m_phase),
+                                const_cast<char*>(m_detail)));
+
+    if (!m_profiler)
+        return;
+
+    int64_t elapsed = g_get_monotonic_time() - m_start_time;
+    _gjs_profiler_add_mark(m_profiler, m_start_time * 1000L, elapsed * 1000L,
+                           "GJS", m_phase, m_detail);
+}
+
 void gjs_profiler_set_fd(GjsProfiler* self, int fd) {
     g_return_if_fail(self);
     g_return_if_fail(!self->filename);
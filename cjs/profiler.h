@@ -48,6 +48,12 @@ void gjs_profiler_set_filename(GjsProfiler *self,
 GJS_EXPORT
 void gjs_profiler_set_fd(GjsProfiler* self, int fd);
 
+GJS_EXPORT
+void gjs_profiler_set_sample_rate(GjsProfiler* self, unsigned samples_per_sec);
+
+GJS_EXPORT
+void gjs_profiler_set_cpu_time_clock(GjsProfiler* self, gboolean enabled);
+
 GJS_EXPORT
 void gjs_profiler_start(GjsProfiler *self);
 
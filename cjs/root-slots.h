@@ -0,0 +1,284 @@
+/* -*- mode: C++; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * SPDX-License-Identifier: MIT OR LGPL-2.0-or-later
+ */
+
+#ifndef GJS_ROOT_SLOTS_H_
+#define GJS_ROOT_SLOTS_H_
+
+#include <config.h>
+
+#include <stddef.h>  // for size_t
+#include <stdint.h>
+
+#include <tuple>
+#include <type_traits>  // for is_same_v
+#include <unordered_map>
+#include <vector>
+
+#include <glib.h>  // for g_assert
+
+#include <js/Class.h>
+#include <js/HeapAPI.h>  // for GetGCThingZone
+#include <js/RootingAPI.h>
+#include <js/TracingAPI.h>
+#include <js/TypeDecls.h>
+#include <js/Value.h>
+#include <js/Wrapper.h>  // for IsCrossCompartmentWrapper
+#include <jsapi.h>  // for JS_NewObject, JS_GetPrivate, JSAutoRealm
+
+/* root-slots.h - Storage for the GC things rooted by GjsMaybeOwned.
+ *
+ * Instead of allocating a JS::PersistentRooted, which is linked into the
+ * runtime's root list, each time a GjsMaybeOwned is rooted, the rooted thing
+ * is stored in a slot of a per-context table.
+ *
+ * Slots are allocated in fixed-size chunks, so that their addresses are stable
+ * and can be handed out as JS::Handles. Released slots go onto a free list and
+ * are reused, so rooting and unrooting are O(1) and only allocate when all
+ * existing chunks are full.
+ *
+ * Each chunk belongs to one zone, and is owned by a holder object in that zone
+ * whose trace hook traces the chunk's slots. Only the holders are traced by the
+ * context's extra roots tracer, which is not incremental; the slots themselves
+ * are marked incrementally along with the rest of the heap, one chunk at a
+ * time, and minor GCs only visit the slots written since the last one. Things
+ * that can't be put in a chunk of their own zone, such as strings from another
+ * zone, go in chunks without a holder, which are traced as roots.
+ *
+ * Since the slots are traced from the heap, they are JS::Heaps, and reading
+ * them has to go through the read barrier of JS::Heap::get() during
+ * incremental GC, so that a thing taken out of a slot that was already traced
+ * is marked.
+ */
+
+template <typename T>
+class GjsRootSlotTable {
+    static constexpr size_t CHUNK_SIZE = 128;
+
+    struct Chunk;
+
+    struct Slot {
+        // Must be the first member, so that a JS::Heap<T>* handed out by
+        // acquire() can be converted back into a Slot* in release()
+        JS::Heap<T> thing;
+        Chunk* chunk;
+        Slot* next_free;  // only while on the free list
+    };
+
+    struct Chunk {
+        // nullptr if the table was destroyed while slots were still in use;
+        // the chunk is then freed when the last one is released
+        GjsRootSlotTable* owner;
+        JS::Zone* zone;  // nullptr if the chunk has no holder
+        JS::Heap<JSObject*> holder;
+        uint32_t n_used;
+        Slot slots[CHUNK_SIZE];
+    };
+
+    std::vector<Chunk*> m_chunks;
+    // Keyed by the zone of the chunks, or nullptr for those traced as roots
+    std::unordered_map<JS::Zone*, Slot*> m_free_lists;
+
+    static void trace_holder(JSTracer* trc, JSObject* holder) {
+        auto* chunk = static_cast<Chunk*>(JS_GetPrivate(holder));
+        if (!chunk || chunk->n_used == 0)
+            return;
+        for (Slot& slot : chunk->slots)
+            JS::TraceEdge(trc, &slot.thing, "GjsMaybeOwned root");
+    }
+
+    static constexpr JSClassOps holder_class_ops = {
+        nullptr,  // addProperty
+        nullptr,  // deleteProperty
+        nullptr,  // enumerate
+        nullptr,  // newEnumerate
+        nullptr,  // resolve
+        nullptr,  // mayResolve
+        nullptr,  // finalize
+        nullptr,  // call
+        nullptr,  // hasInstance
+        nullptr,  // construct
+        &GjsRootSlotTable::trace_holder,
+    };
+
+    static constexpr JSClass holder_class = {
+        "GjsRootSlotChunk",
+        JSCLASS_HAS_PRIVATE,
+        &GjsRootSlotTable::holder_class_ops,
+    };
+
+    [[nodiscard]] static JSObject* as_object(JSObject* obj) { return obj; }
+    [[nodiscard]] static JSObject* as_object(JSFunction* func) {
+        return JS_GetFunctionObject(func);
+    }
+    [[nodiscard]] static JSObject* as_object(const JS::Value& value) {
+        return value.isObject() ? &value.toObject() : nullptr;
+    }
+
+    // Returns an object in whose realm the holder of a chunk for @thing can be
+    // created: the current global if @thing is in the current zone, otherwise
+    // @thing itself if it is an object that has a realm. Returns nullptr if
+    // @thing can only go in a chunk traced as roots.
+    [[nodiscard]] static JSObject* holder_realm_for(JSContext* cx,
+                                                    JS::Handle<T> thing) {
+        JSObject* global = JS::CurrentGlobalOrNull(cx);
+        JS::Zone* current_zone =
+            global ? JS::GetGCThingZone(JS::GCCellPtr(global)) : nullptr;
+
+        if (JSObject* obj = as_object(thing.get())) {
+            if (JS::GetGCThingZone(JS::GCCellPtr(obj)) == current_zone)
+                return global;
+            return js::IsCrossCompartmentWrapper(obj) ? nullptr : obj;
+        }
+
+        // Only JS::Values can hold things that are not objects
+        if constexpr (std::is_same_v<T, JS::Value>) {
+            if (thing.isGCThing() &&
+                JS::GetGCThingZone(JS::GCCellPtr(thing.get())) != current_zone)
+                return nullptr;
+        }
+        return global;
+    }
+
+    // Adds a chunk for things in the zone of @realm_obj, or a chunk traced as
+    // roots if @realm_obj is nullptr or the holder can't be created, and
+    // returns the zone it was added for.
+    JS::Zone* add_chunk(JSContext* cx, JS::HandleObject realm_obj) {
+        auto* chunk = new Chunk;
+        chunk->owner = this;
+        chunk->zone = nullptr;
+        chunk->n_used = 0;
+
+        if (realm_obj) {
+            JSAutoRealm ar(cx, realm_obj);
+            JSObject* holder = JS_NewObject(cx, &holder_class);
+            if (holder) {
+                JS_SetPrivate(holder, chunk);
+                chunk->holder = holder;
+                chunk->zone = JS::GetGCThingZone(JS::GCCellPtr(realm_obj));
+            } else {
+                // Rooting can't fail, so fall back to a chunk traced as roots
+                JS_ClearPendingException(cx);
+            }
+        }
+
+        Slot*& free_list = m_free_lists[chunk->zone];
+        for (size_t ix = CHUNK_SIZE; ix-- > 0;) {
+            Slot* slot = &chunk->slots[ix];
+            slot->chunk = chunk;
+            slot->next_free = free_list;
+            free_list = slot;
+        }
+        m_chunks.push_back(chunk);
+        return chunk->zone;
+    }
+
+ public:
+    GjsRootSlotTable() = default;
+    GjsRootSlotTable(const GjsRootSlotTable&) = delete;
+    GjsRootSlotTable& operator=(const GjsRootSlotTable&) = delete;
+
+    // Any GjsMaybeOwned still rooted when the context goes away is left
+    // holding a slot with a cleared value, the same as a JS::PersistentRooted
+    // is reset when its runtime is destroyed
+    ~GjsRootSlotTable() {
+        for (Chunk* chunk : m_chunks) {
+            if (JSObject* holder = chunk->holder.unbarrieredGet())
+                JS_SetPrivate(holder, nullptr);
+            chunk->holder = nullptr;
+
+            if (chunk->n_used == 0) {
+                delete chunk;
+                continue;
+            }
+            chunk->owner = nullptr;
+            for (Slot& slot : chunk->slots)
+                slot.thing = JS::SafelyInitialized<T>();
+        }
+    }
+
+    // Returns the location of a slot holding @thing, which stays valid until
+    // it is passed to release()
+    [[nodiscard]] JS::Heap<T>* acquire(JSContext* cx, JS::Handle<T> thing) {
+        JS::RootedObject realm_obj(cx, holder_realm_for(cx, thing));
+        JS::Zone* zone =
+            realm_obj ? JS::GetGCThingZone(JS::GCCellPtr(realm_obj)) : nullptr;
+
+        auto it = m_free_lists.find(zone);
+        if (it == m_free_lists.end() || !it->second) {
+            zone = add_chunk(cx, realm_obj);
+            it = m_free_lists.find(zone);
+        }
+
+        Slot* slot = it->second;
+        it->second = slot->next_free;
+        slot->next_free = nullptr;
+        slot->chunk->n_used++;
+
+        slot->thing = thing;
+        return &slot->thing;
+    }
+
+    static void release(JS::Heap<T>* location) {
+        auto* slot = reinterpret_cast<Slot*>(location);
+        Chunk* chunk = slot->chunk;
+        g_assert(chunk->n_used > 0);
+        chunk->n_used--;
+
+        // Overwriting a JS::Heap has no pre-barrier, so if the chunk was
+        // already traced in the current incremental GC, mark the old thing as
+        // the read barrier would, in case it was read through a JS::Handle
+        if (!JS::RuntimeHeapIsCollecting())
+            (void)slot->thing.get();
+        slot->thing = JS::SafelyInitialized<T>();
+
+        GjsRootSlotTable* self = chunk->owner;
+        if (!self) {
+            if (chunk->n_used == 0)
+                delete chunk;
+            return;
+        }
+
+        Slot*& free_list = self->m_free_lists[chunk->zone];
+        slot->next_free = free_list;
+        free_list = slot;
+    }
+
+    // Free slots hold null or undefined, so chunks can be traced without
+    // checking which slots are in use
+    void trace(JSTracer* trc) {
+        for (Chunk* chunk : m_chunks) {
+            if (chunk->holder.unbarrieredGet()) {
+                JS::TraceEdge(trc, &chunk->holder, "GjsMaybeOwned root chunk");
+                continue;
+            }
+            if (chunk->n_used == 0)
+                continue;
+            for (Slot& slot : chunk->slots)
+                JS::TraceEdge(trc, &slot.thing, "GjsMaybeOwned root");
+        }
+    }
+};
+
+// One table for each type of GC thing that GjsMaybeOwned is used with. Add
+// more types as necessary.
+class GjsRootSlots {
+    std::tuple<GjsRootSlotTable<JSObject*>, GjsRootSlotTable<JSFunction*>,
+               GjsRootSlotTable<JS::Value>>
+        m_tables;
+
+ public:
+    template <typename T>
+    [[nodiscard]] GjsRootSlotTable<T>& table() {
+        return std::get<GjsRootSlotTable<T>>(m_tables);
+    }
+
+    void trace(JSTracer* trc) {
+        table<JSObject*>().trace(trc);
+        table<JSFunction*>().trace(trc);
+        table<JS::Value>().trace(trc);
+    }
+};
+
+#endif  // GJS_ROOT_SLOTS_H_
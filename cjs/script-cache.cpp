@@ -0,0 +1,383 @@
+/* -*- mode: C++; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * SPDX-License-Identifier: MIT OR LGPL-2.0-or-later
+ */
+
+#include <config.h>
+
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>  // for memcmp, memcpy, strlen
+#include <sys/types.h>  // for ssize_t
+
+#include <memory>  // for unique_ptr
+#include <string>
+#include <unordered_map>
+#include <utility>  // for move
+#include <vector>
+
+#include <gio/gio.h>
+#include <glib.h>
+
+#include <js/CompilationAndEvaluation.h>
+#include <js/CompileOptions.h>
+#include <js/OffThreadScriptCompilation.h>
+#include <js/RootingAPI.h>
+#include <js/SourceText.h>
+#include <js/Transcoding.h>
+#include <js/TypeDecls.h>
+#include <jsapi.h>  // for JS_ClearPendingException
+#include <mozilla/Range.h>
+#include <mozilla/Utf8.h>  // for Utf8Unit
+
+#include "cjs/context-private.h"
+#include "cjs/coverage-private.h"
+#include "cjs/engine.h"
+#include "cjs/jsapi-util.h"
+#include "cjs/script-cache.h"
+#include "util/log.h"
+
+// Every cache file starts with this header, followed by the XDR-encoded
+// script. SpiderMonkey checks its own build ID (see gjs_create_js_context())
+// when decoding; the digest guards against the source having changed since.
+// The size is a multiple of 16 so that the XDR data stays as aligned as the
+// buffer it is read into.
+struct ScriptCacheHeader {
+    char magic[8];
+    uint64_t source_len;
+    char source_digest[64];  // SHA-256 in hex, not 0-terminated
+};
+static_assert(sizeof(ScriptCacheHeader) % 16 == 0,
+              "cache header must keep the bytecode aligned");
+
+static constexpr char SCRIPT_CACHE_MAGIC[8] = {'G', 'J', 'S', 'X',
+                                               'D', 'R', '\0', '\1'};
+
+// A script being compiled on a helper thread by gjs_prefetch_scripts()
+struct PrefetchedScript {
+    JSContext* cx;
+    GjsAutoBytes source;  // must outlive the compilation
+    // Set by the helper thread when compilation is done
+    JS::OffThreadToken* token;
+    bool finished;
+};
+
+static GMutex s_prefetch_lock;
+static GCond s_prefetch_cond;
+// Keyed by file name as passed to the compile options; main thread only
+static std::unordered_map<std::string, std::unique_ptr<PrefetchedScript>>
+    s_prefetched_scripts;
+
+static void on_prefetch_finished(JS::OffThreadToken* token, void* data) {
+    auto* prefetched = static_cast<PrefetchedScript*>(data);
+    g_mutex_lock(&s_prefetch_lock);
+    prefetched->token = token;
+    prefetched->finished = true;
+    g_cond_broadcast(&s_prefetch_cond);
+    g_mutex_unlock(&s_prefetch_lock);
+}
+
+[[nodiscard]] static JS::OffThreadToken* wait_for_prefetch(
+    PrefetchedScript* prefetched) {
+    g_mutex_lock(&s_prefetch_lock);
+    while (!prefetched->finished)
+        g_cond_wait(&s_prefetch_cond, &s_prefetch_lock);
+    g_mutex_unlock(&s_prefetch_lock);
+    return prefetched->token;
+}
+
+[[nodiscard]] static const char* script_cache_dir() {
+    static const char* dir = [] {
+        const char* env = g_getenv("GJS_SCRIPT_CACHE_DIR");
+        return (env && *env) ? g_strdup(env) : nullptr;
+    }();
+    return dir;
+}
+
+// Each file gets a single cache entry, so that editing a file replaces its
+// entry instead of accumulating stale ones
+[[nodiscard]] static char* script_cache_path(const char* dir,
+                                             const char* filename,
+                                             bool global) {
+    GjsAutoChar key =
+        g_compute_checksum_for_string(G_CHECKSUM_SHA256, filename, -1);
+    GjsAutoChar basename =
+        g_strconcat(key, global ? ".global.jsbc" : ".jsbc", nullptr);
+    return g_build_filename(dir, basename.get(), nullptr);
+}
+
+static void fill_header(ScriptCacheHeader* header, const char* script,
+                        size_t script_len) {
+    memcpy(header->magic, SCRIPT_CACHE_MAGIC, sizeof(header->magic));
+    header->source_len = script_len;
+    GjsAutoChar digest = g_compute_checksum_for_data(
+        G_CHECKSUM_SHA256, reinterpret_cast<const uint8_t*>(script),
+        script_len);
+    memcpy(header->source_digest, digest, sizeof(header->source_digest));
+}
+
+[[nodiscard]] static JSScript* lookup_cached_script(
+    JSContext* cx, const JS::ReadOnlyCompileOptions& options, const char* path,
+    const ScriptCacheHeader& expected) {
+    char* contents_unowned;
+    size_t len;
+    if (!g_file_get_contents(path, &contents_unowned, &len, nullptr))
+        return nullptr;
+    GjsAutoChar contents = contents_unowned;
+
+    if (len <= sizeof(ScriptCacheHeader) ||
+        memcmp(contents, &expected, sizeof(ScriptCacheHeader)) != 0) {
+        gjs_debug(GJS_DEBUG_IMPORTER, "Stale bytecode cache entry for %s",
+                  options.filename());
+        return nullptr;
+    }
+
+    auto* data = reinterpret_cast<uint8_t*>(contents.get());
+    JS::TranscodeRange range(data + sizeof(ScriptCacheHeader),
+                             len - sizeof(ScriptCacheHeader));
+    JS::RootedScript decoded(cx);
+    if (JS::DecodeScript(cx, options, range, &decoded) !=
+        JS::TranscodeResult_Ok) {
+        // Fall back to compiling from source
+        JS_ClearPendingException(cx);
+        gjs_debug(GJS_DEBUG_IMPORTER, "Could not decode cached bytecode for %s",
+                  options.filename());
+        return nullptr;
+    }
+
+    gjs_debug(GJS_DEBUG_IMPORTER, "Using cached bytecode for %s",
+              options.filename());
+    return decoded;
+}
+
+static void save_cached_script(JSContext* cx, JS::HandleScript script,
+                               const char* dir, const char* path,
+                               const ScriptCacheHeader& header) {
+    JS::TranscodeBuffer buffer;
+    if (JS::EncodeScript(cx, buffer, script) != JS::TranscodeResult_Ok) {
+        JS_ClearPendingException(cx);
+        return;
+    }
+
+    std::vector<char> contents(sizeof(ScriptCacheHeader) + buffer.length());
+    memcpy(contents.data(), &header, sizeof(ScriptCacheHeader));
+    memcpy(contents.data() + sizeof(ScriptCacheHeader), buffer.begin(),
+           buffer.length());
+
+    // g_file_set_contents() writes to a temporary file and renames it, so
+    // concurrent processes never see a partially written entry
+    GError* error = nullptr;
+    if (g_mkdir_with_parents(dir, 0700) != 0 ||
+        !g_file_set_contents(path, contents.data(), contents.size(), &error)) {
+        gjs_debug(GJS_DEBUG_IMPORTER, "Could not save bytecode for %s: %s",
+                  path, error ? error->message : g_strerror(errno));
+        g_clear_error(&error);
+    }
+}
+
+static void cancel_prefetched_script(JSContext* cx, const char* filename) {
+    auto it = s_prefetched_scripts.find(filename);
+    if (it == s_prefetched_scripts.end() || it->second->cx != cx)
+        return;
+
+    JS::CancelOffThreadScript(cx, wait_for_prefetch(it->second.get()));
+    s_prefetched_scripts.erase(it);
+}
+
+// Returns the prefetched script for @filename if there is one and it was
+// compiled from the same source, or nullptr otherwise
+[[nodiscard]] static JSScript* take_prefetched_script(JSContext* cx,
+                                                      const char* filename,
+                                                      const char* script,
+                                                      size_t script_len) {
+    auto it = s_prefetched_scripts.find(filename);
+    if (it == s_prefetched_scripts.end() || it->second->cx != cx)
+        return nullptr;
+
+    std::unique_ptr<PrefetchedScript> prefetched = std::move(it->second);
+    s_prefetched_scripts.erase(it);
+    JS::OffThreadToken* token = wait_for_prefetch(prefetched.get());
+
+    size_t prefetched_len;
+    const void* prefetched_source =
+        g_bytes_get_data(prefetched->source, &prefetched_len);
+    if (prefetched_len != script_len ||
+        (script_len > 0 &&
+         memcmp(prefetched_source, script, script_len) != 0)) {
+        // The file changed in the meantime
+        JS::CancelOffThreadScript(cx, token);
+        return nullptr;
+    }
+
+    JSScript* compiled = JS::FinishOffThreadScript(cx, token);
+    if (!compiled) {
+        // Compile again on the main thread, to report any error normally
+        JS_ClearPendingException(cx);
+        return nullptr;
+    }
+
+    gjs_debug(GJS_DEBUG_IMPORTER, "Using prefetched script for %s", filename);
+    return compiled;
+}
+
+// Scripts run with a scope chain are compiled differently from scripts run
+// directly in the global scope, and their bytecode can't be exchanged
+enum class ScriptScope { Global, NonSyntactic };
+
+template <typename Unit>
+GJS_JSAPI_RETURN_CONVENTION
+static JSScript* compile_source_text(JSContext* cx,
+                                     const JS::ReadOnlyCompileOptions& options,
+                                     JS::SourceText<Unit>* buf,
+                                     ScriptScope scope) {
+    if (scope == ScriptScope::Global)
+        return JS::Compile(cx, options, *buf);
+    return JS::CompileForNonSyntacticScope(cx, options, *buf);
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static JSScript* compile_source(JSContext* cx,
+                                const JS::ReadOnlyCompileOptions& options,
+                                const char* script, size_t script_len,
+                                ScriptScope scope) {
+    // COMPAT: Compiling from UTF-8 messes up code coverage, so transcode to
+    // UTF-16 first in that case. See bug
+    // https://bugzilla.mozilla.org/show_bug.cgi?id=1404784
+    if (gjs_coverage_is_enabled()) {
+        std::u16string utf16_string =
+            gjs_utf8_script_to_utf16(script, script_len);
+        JS::SourceText<char16_t> buf;
+        if (!buf.init(cx, utf16_string.c_str(), utf16_string.size(),
+                      JS::SourceOwnership::Borrowed))
+            return nullptr;
+
+        return compile_source_text(cx, options, &buf, scope);
+    }
+
+    JS::SourceText<mozilla::Utf8Unit> buf;
+    if (!buf.init(cx, script, script_len, JS::SourceOwnership::Borrowed))
+        return nullptr;
+
+    return compile_source_text(cx, options, &buf, scope);
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static JSScript* compile_script(JSContext* cx,
+                                const JS::ReadOnlyCompileOptions& options,
+                                const char* script, ssize_t script_len,
+                                ScriptScope scope) {
+    size_t len = script_len < 0 ? strlen(script) : script_len;
+
+    // Keep coverage runs on the plain compile path, so that their results do
+    // not depend on the state of the cache, and debugging sessions too, since
+    // the debugger is not told about decoded or prefetched scripts
+    bool debugging = GjsContextPrivate::from_cx(cx)->debugger_attached();
+    const char* dir = gjs_coverage_is_enabled() || debugging
+                          ? nullptr
+                          : script_cache_dir();
+    const char* filename = options.filename();
+    // Prefetching only compiles scripts for the importer's scope chains
+    bool prefetchable =
+        scope == ScriptScope::NonSyntactic && filename && !debugging;
+
+    // Pseudo-filenames such as "<command line>" don't identify a source
+    GjsAutoChar path;
+    ScriptCacheHeader header{};
+    if (dir && filename && filename[0] != '<') {
+        path = script_cache_path(dir, filename, scope == ScriptScope::Global);
+        fill_header(&header, script, len);
+
+        JSScript* cached = lookup_cached_script(cx, options, path, header);
+        if (cached) {
+            if (prefetchable)
+                cancel_prefetched_script(cx, filename);
+            return cached;
+        }
+    }
+
+    JS::RootedScript compiled(cx);
+    if (prefetchable)
+        compiled = take_prefetched_script(cx, filename, script, len);
+    if (!compiled)
+        compiled = compile_source(cx, options, script, len, scope);
+    if (!compiled)
+        return nullptr;
+
+    if (path)
+        save_cached_script(cx, compiled, dir, path, header);
+
+    return compiled;
+}
+
+JSScript* gjs_compile_script(JSContext* cx,
+                             const JS::ReadOnlyCompileOptions& options,
+                             const char* script, ssize_t script_len) {
+    return compile_script(cx, options, script, script_len,
+                          ScriptScope::NonSyntactic);
+}
+
+JSScript* gjs_compile_global_script(JSContext* cx,
+                                    const JS::ReadOnlyCompileOptions& options,
+                                    const char* script, ssize_t script_len) {
+    return compile_script(cx, options, script, script_len,
+                          ScriptScope::Global);
+}
+
+void gjs_prefetch_scripts(JSContext* cx, const char* const* paths) {
+    // Compiling from UTF-8 is not compatible with code coverage, see above
+    if (gjs_coverage_is_enabled())
+        return;
+
+    for (const char* const* path = paths; *path; path++) {
+        GjsAutoUnref<GFile> file = g_file_new_for_commandline_arg(*path);
+        // Same name that the importer will compile the file with
+        GjsAutoChar filename = g_file_get_parse_name(file);
+        if (s_prefetched_scripts.count(filename.get()))
+            continue;
+
+        GjsAutoBytes source = gjs_load_script_file(file, nullptr);
+        if (!source)
+            continue;
+
+        size_t len;
+        auto* script = static_cast<const char*>(g_bytes_get_data(source, &len));
+
+        JS::CompileOptions options(cx);
+        options.setFileAndLine(filename, 1)
+            .setSourceIsLazy(g_str_has_prefix(filename, "resource://"))
+            .setNonSyntacticScope(true);
+        if (!script || !JS::CanCompileOffThread(cx, options, len))
+            continue;  // small scripts are compiled faster in place
+
+        JS::SourceText<mozilla::Utf8Unit> buf;
+        if (!buf.init(cx, script, len, JS::SourceOwnership::Borrowed)) {
+            JS_ClearPendingException(cx);
+            continue;
+        }
+
+        auto prefetched = std::make_unique<PrefetchedScript>();
+        prefetched->cx = cx;
+        prefetched->source = std::move(source);
+        if (!JS::CompileOffThread(cx, options, buf, on_prefetch_finished,
+                                  prefetched.get())) {
+            JS_ClearPendingException(cx);
+            continue;
+        }
+
+        gjs_debug(GJS_DEBUG_IMPORTER, "Prefetching %s", filename.get());
+        s_prefetched_scripts.emplace(filename.get(), std::move(prefetched));
+    }
+}
+
+void gjs_cancel_prefetched_scripts(JSContext* cx) {
+    for (auto it = s_prefetched_scripts.begin();
+         it != s_prefetched_scripts.end();) {
+        if (it->second->cx != cx) {
+            ++it;
+            continue;
+        }
+
+        JS::CancelOffThreadScript(cx, wait_for_prefetch(it->second.get()));
+        it = s_prefetched_scripts.erase(it);
+    }
+}
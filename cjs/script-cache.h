@@ -0,0 +1,43 @@
+/* -*- mode: C++; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * SPDX-License-Identifier: MIT OR LGPL-2.0-or-later
+ */
+
+#ifndef GJS_SCRIPT_CACHE_H_
+#define GJS_SCRIPT_CACHE_H_
+
+#include <config.h>
+
+#include <sys/types.h>  // for ssize_t
+
+#include <js/CompileOptions.h>
+#include <js/TypeDecls.h>
+
+#include "cjs/macros.h"
+
+// Compiles @script, UTF-8 source of @script_len bytes (or 0-terminated if
+// @script_len is -1), for execution with JS_ExecuteScript() and a non-empty
+// scope chain. If GJS_SCRIPT_CACHE_DIR is set, the bytecode is first looked up
+// in that directory and, if missing or stale, saved there for next time.
+GJS_JSAPI_RETURN_CONVENTION
+JSScript* gjs_compile_script(JSContext* cx,
+                             const JS::ReadOnlyCompileOptions& options,
+                             const char* script, ssize_t script_len);
+
+// Like gjs_compile_script(), but for execution directly in the global scope,
+// as with JS::Compile()
+GJS_JSAPI_RETURN_CONVENTION
+JSScript* gjs_compile_global_script(JSContext* cx,
+                                    const JS::ReadOnlyCompileOptions& options,
+                                    const char* script, ssize_t script_len);
+
+// Starts compiling the files at @paths, given as paths or URIs, on helper
+// threads. A later gjs_compile_script() call for one of those files then only
+// needs to wait for its result. Files that can't be read are skipped, so that
+// the error is reported when the file is imported.
+void gjs_prefetch_scripts(JSContext* cx, const char* const* paths);
+
+// Discards the results of prefetches that were never used
+void gjs_cancel_prefetched_scripts(JSContext* cx);
+
+#endif  // GJS_SCRIPT_CACHE_H_
@@ -0,0 +1,192 @@
+/* -*- mode: C++; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * SPDX-License-Identifier: MIT OR LGPL-2.0-or-later
+ */
+
+#ifndef GJS_SLAB_ALLOCATOR_H_
+#define GJS_SLAB_ALLOCATOR_H_
+
+#include <config.h>
+
+#include <stddef.h>  // for size_t
+#include <stdint.h>  // for uintptr_t
+#include <stdlib.h>  // for posix_memalign, free
+#include <string.h>  // for memset
+
+#include <glib.h>
+
+#ifdef G_OS_WIN32
+#    include <malloc.h>  // for _aligned_malloc, _aligned_free
+#endif
+
+/* slab-allocator.h - Fixed-size allocator for the private structs of wrapper
+ * objects, which are created and finalized in large numbers.
+ *
+ * Structs are carved out of slabs of SLAB_SIZE bytes, aligned to their size,
+ * so the slab that a struct belongs to is found by masking its address. Each
+ * slab has its own free list, and allocation prefers the slab that was freed
+ * into most recently, so wrappers created together stay close together in
+ * memory. A slab is returned to the system when its last struct is freed,
+ * unless it is the only one with room left, so that creating and destroying a
+ * single wrapper in a loop doesn't allocate each time.
+ *
+ * There is one allocator per type and thread; it must only be used for structs
+ * that are freed on the thread that allocated them, i.e. by
+ * JSCLASS_FOREGROUND_FINALIZE classes.
+ */
+
+template <typename T>
+class GjsSlabAllocator {
+    static constexpr size_t SLAB_SIZE = 16384;
+
+    union Cell {
+        Cell* next_free;
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+
+    struct Slab {
+        // Links in the list of slabs that have free cells
+        Slab* prev;
+        Slab* next;
+        Cell* free_list;
+        uint32_t n_used;
+        // Cells past this index have never been handed out
+        uint32_t n_bumped;
+        bool in_partial_list;
+    };
+
+    static constexpr size_t cells_offset() {
+        return (sizeof(Slab) + alignof(Cell) - 1) / alignof(Cell) *
+               alignof(Cell);
+    }
+    static constexpr size_t N_CELLS =
+        (SLAB_SIZE - cells_offset()) / sizeof(Cell);
+    static_assert(N_CELLS >= 8, "Struct too large for the slab allocator");
+    static_assert(alignof(Cell) <= SLAB_SIZE);
+
+    Slab* m_partial = nullptr;
+    size_t m_n_slabs = 0;
+
+    static Cell* cells(Slab* slab) {
+        return reinterpret_cast<Cell*>(reinterpret_cast<uint8_t*>(slab) +
+                                       cells_offset());
+    }
+
+    static Slab* slab_for(void* ptr) {
+        return reinterpret_cast<Slab*>(reinterpret_cast<uintptr_t>(ptr) &
+                                       ~uintptr_t{SLAB_SIZE - 1});
+    }
+
+    void push_partial(Slab* slab) {
+        slab->prev = nullptr;
+        slab->next = m_partial;
+        if (m_partial)
+            m_partial->prev = slab;
+        m_partial = slab;
+        slab->in_partial_list = true;
+    }
+
+    void remove_partial(Slab* slab) {
+        if (slab->prev)
+            slab->prev->next = slab->next;
+        else
+            m_partial = slab->next;
+        if (slab->next)
+            slab->next->prev = slab->prev;
+        slab->prev = slab->next = nullptr;
+        slab->in_partial_list = false;
+    }
+
+    Slab* new_slab() {
+        void* mem;
+#ifdef G_OS_WIN32
+        mem = _aligned_malloc(SLAB_SIZE, SLAB_SIZE);
+        if (!mem)
+            g_error("Out of memory allocating a slab");
+#else
+        if (posix_memalign(&mem, SLAB_SIZE, SLAB_SIZE) != 0)
+            g_error("Out of memory allocating a slab");
+#endif
+        auto* slab = static_cast<Slab*>(mem);
+        slab->free_list = nullptr;
+        slab->n_used = 0;
+        slab->n_bumped = 0;
+        push_partial(slab);
+        m_n_slabs++;
+        return slab;
+    }
+
+    void free_slab(Slab* slab) {
+        if (slab->in_partial_list)
+            remove_partial(slab);
+        m_n_slabs--;
+#ifdef G_OS_WIN32
+        _aligned_free(slab);
+#else
+        ::free(slab);
+#endif
+    }
+
+ public:
+    GjsSlabAllocator() = default;
+    GjsSlabAllocator(const GjsSlabAllocator&) = delete;
+    GjsSlabAllocator& operator=(const GjsSlabAllocator&) = delete;
+
+    // Slabs that still have structs in use are leaked rather than freed from
+    // under wrappers that could still be finalized later
+    ~GjsSlabAllocator() {
+        for (Slab* slab = m_partial; slab;) {
+            Slab* next = slab->next;
+            if (slab->n_used == 0)
+                free_slab(slab);
+            slab = next;
+        }
+    }
+
+    // Returns zeroed memory for one T, which the caller constructs in place
+    [[nodiscard]] void* alloc() {
+        Slab* slab = m_partial ? m_partial : new_slab();
+
+        Cell* cell;
+        if (slab->free_list) {
+            cell = slab->free_list;
+            slab->free_list = cell->next_free;
+        } else {
+            cell = &cells(slab)[slab->n_bumped++];
+        }
+
+        if (++slab->n_used == N_CELLS)
+            remove_partial(slab);
+
+        memset(cell, 0, sizeof(Cell));
+        return cell;
+    }
+
+    // Frees memory from alloc(), after the caller has destroyed the T in it
+    void free(void* ptr) {
+        Slab* slab = slab_for(ptr);
+        auto* cell = static_cast<Cell*>(ptr);
+        cell->next_free = slab->free_list;
+        slab->free_list = cell;
+
+        if (--slab->n_used == 0 &&
+            (m_partial != slab || slab->next || !slab->in_partial_list)) {
+            free_slab(slab);
+            return;
+        }
+
+        // Allocate from the slab freed into most recently
+        if (slab->in_partial_list)
+            remove_partial(slab);
+        push_partial(slab);
+    }
+
+    [[nodiscard]] size_t n_slabs() const { return m_n_slabs; }
+
+    static GjsSlabAllocator& get() {
+        static thread_local GjsSlabAllocator s_allocator;
+        return s_allocator;
+    }
+};
+
+#endif  // GJS_SLAB_ALLOCATOR_H_
@@ -48,11 +48,9 @@ class Service {
         if (this.ReadWriteProperty !== value) {
             this._readWriteProperty = value;
 
-            // Emitting property changes over DBus
-            this.dbus.emit_property_changed(
-                'ReadWriteProperty',
-                new GLib.Variant('b', value)
-            );
+            // Emitting property changes over DBus; the new value is read
+            // back from this object when the change is sent
+            this.dbus.queue_property_changed('ReadWriteProperty');
         }
     }
 
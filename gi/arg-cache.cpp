@@ -27,6 +27,8 @@
 #include <stdint.h>
 #include <string.h>
 
+#include <string>
+
 #include <ffi.h>
 #include <girepository.h>
 #include <glib.h>
@@ -44,16 +46,21 @@
 #include "gi/arg-inl.h"
 #include "gi/arg.h"
 #include "gi/boxed.h"
+#include "gi/closure.h"
 #include "gi/foreign.h"
 #include "gi/function.h"
 #include "gi/fundamental.h"
 #include "gi/gerror.h"
 #include "gi/gtype.h"
+#include "gi/hashtable.h"
+#include "gi/listiterator.h"
 #include "gi/object.h"
 #include "gi/param.h"
 #include "gi/union.h"
 #include "gi/value.h"
+#include "cjs/atoms.h"
 #include "cjs/byteArray.h"
+#include "cjs/context-private.h"
 #include "cjs/jsapi-util.h"
 
 enum ExpectedType {
@@ -253,6 +260,34 @@ static bool gjs_marshal_explicit_array_in_in(JSContext* cx,
     return true;
 }
 
+// Zero-terminated arrays of strings that the callee doesn't keep are packed
+// into one allocation, as they can hold thousands of short strings
+GJS_JSAPI_RETURN_CONVENTION
+static bool gjs_marshal_strv_in_in(JSContext* cx, GjsArgumentCache* self,
+                                   GjsFunctionCallState*, GIArgument* arg,
+                                   JS::HandleValue value) {
+    if (value.isNull())
+        return self->handle_nullable(cx, arg);
+
+    if (!value.isObject())
+        return report_typeof_mismatch(cx, self->arg_name, value,
+                                      ExpectedType::OBJECT);
+
+    JS::RootedObject array(cx, &value.toObject());
+    const GjsAtoms& atoms = GjsContextPrivate::atoms(cx);
+    uint32_t length;
+    if (!gjs_object_require_converted_property(cx, array, nullptr,
+                                               atoms.length(), &length))
+        return false;
+
+    char** strv;
+    if (!gjs_array_to_packed_strv(cx, array, length, &strv))
+        return false;
+
+    gjs_arg_set(arg, strv);
+    return true;
+}
+
 GJS_JSAPI_RETURN_CONVENTION
 static bool gjs_marshal_explicit_array_inout_in(JSContext* cx,
                                                 GjsArgumentCache* self,
@@ -347,6 +382,73 @@ static bool gjs_marshal_callback_in(JSContext* cx, GjsArgumentCache* self,
     return true;
 }
 
+// GLib.SourceFunc with a GDestroyNotify, e.g. GLib.idle_add() and
+// GLib.timeout_add(): the JS function is wrapped in a GjsClosure that is passed
+// as the user data to a native GSourceFunc, so no trampoline is needed.
+GJS_JSAPI_RETURN_CONVENTION
+static bool gjs_marshal_source_func_in(JSContext* cx, GjsArgumentCache* self,
+                                       GjsFunctionCallState* state,
+                                       GIArgument* arg, JS::HandleValue value) {
+    uint8_t destroy_pos = self->contents.callback.destroy_pos;
+    uint8_t closure_pos = self->contents.callback.closure_pos;
+
+    if (value.isNull() && self->nullable) {
+        gjs_arg_unset<void*>(arg);
+        gjs_arg_unset<void*>(&state->in_cvalues[closure_pos]);
+        gjs_arg_unset<void*>(&state->in_cvalues[destroy_pos]);
+        return true;
+    }
+
+    if (JS_TypeOfValue(cx, value) != JSTYPE_FUNCTION) {
+        gjs_throw(cx, "Expected function for callback argument %s, got %s",
+                  self->arg_name, JS::InformalValueTypeName(value));
+        return false;
+    }
+
+    JS::RootedFunction func(cx, JS_GetObjectFunction(&value.toObject()));
+    bool is_object_method = !!state->instance_object;
+    GClosure* closure =
+        gjs_closure_new(cx, func, "SourceFunc", !is_object_method);
+    if (is_object_method) {
+        auto* priv = ObjectInstance::for_js(cx, state->instance_object);
+        if (!priv) {
+            g_closure_unref(closure);
+            gjs_throw(cx, "Signal connected to wrong type of object");
+            return false;
+        }
+
+        priv->associate_closure(cx, closure);
+    }
+
+    // The reference is owned by the source and dropped in the destroy notify
+    gjs_arg_set(arg, gjs_closure_source_func);
+    gjs_arg_set(&state->in_cvalues[closure_pos], closure);
+    gjs_arg_set(&state->in_cvalues[destroy_pos],
+                gjs_closure_source_destroy_notify);
+    return true;
+}
+
+// Gio.AsyncReadyCallback of an async function with a known _finish function:
+// if no callback is given, a Promise is returned from the call. The result is
+// handed to it by a native GAsyncReadyCallback, so no trampoline is needed.
+GJS_JSAPI_RETURN_CONVENTION
+static bool gjs_marshal_async_ready_in(JSContext* cx, GjsArgumentCache* self,
+                                       GjsFunctionCallState* state,
+                                       GIArgument* arg, JS::HandleValue value) {
+    if (!value.isUndefined())
+        return gjs_marshal_callback_in(cx, self, state, arg, value);
+
+    void* data;
+    state->promise =
+        gjs_async_promise_new(cx, self->contents.callback.finish_info, &data);
+    if (!state->promise)
+        return false;
+
+    gjs_arg_set(arg, gjs_async_promise_callback);
+    gjs_arg_set(&state->in_cvalues[self->contents.callback.closure_pos], data);
+    return true;
+}
+
 GJS_JSAPI_RETURN_CONVENTION
 static bool gjs_marshal_generic_out_in(JSContext*, GjsArgumentCache* self,
                                        GjsFunctionCallState* state,
@@ -511,10 +613,10 @@ static bool gjs_marshal_string_in_in(JSContext* cx, GjsArgumentCache* self,
         return true;
     }
 
-    JS::UniqueChars str = gjs_string_to_utf8(cx, value);
-    if (!str)
+    GjsStringBuffer<> str;
+    if (!str.init(cx, value.toString()))
         return false;
-    gjs_arg_set(arg, g_strdup(str.get()));
+    gjs_arg_set(arg, str.dup());
     return true;
 }
 
@@ -576,11 +678,19 @@ GJS_JSAPI_RETURN_CONVENTION
 static bool gjs_marshal_foreign_in_in(JSContext* cx, GjsArgumentCache* self,
                                       GjsFunctionCallState*, GIArgument* arg,
                                       JS::HandleValue value) {
-    GIStructInfo* foreign_info = g_type_info_get_interface(&self->type_info);
-    self->contents.tmp_foreign_info = foreign_info;
-    return gjs_struct_foreign_convert_to_g_argument(
-        cx, value, foreign_info, self->arg_name, GJS_ARGUMENT_ARGUMENT,
-        self->transfer, self->nullable, arg);
+    // Resolve the converters on first use rather than at build time, since
+    // that may import the module implementing them, and cache them so
+    // that no lookup by name happens on subsequent calls
+    if (G_UNLIKELY(!self->contents.foreign.funcs)) {
+        self->contents.foreign.funcs =
+            gjs_struct_foreign_lookup(cx, self->contents.foreign.info);
+        if (!self->contents.foreign.funcs)
+            return false;
+    }
+
+    return self->contents.foreign.funcs->to_func(
+        cx, value, self->arg_name, GJS_ARGUMENT_ARGUMENT, self->transfer,
+        self->nullable, arg);
 }
 
 GJS_JSAPI_RETURN_CONVENTION
@@ -679,6 +789,17 @@ static bool gjs_marshal_gbytes_in_in(JSContext* cx, GjsArgumentCache* self,
         return true;
     }
 
+    // GBytes returned from C stay opaque GLib.Bytes wrappers, so code that
+    // only passes them on, such as a read_bytes() / write_bytes() copy loop,
+    // hands the same GBytes back in. Take the reference directly in that case
+    // instead of going through the generic typecheck and g_boxed_copy().
+    BoxedBase* priv = BoxedBase::for_js(cx, object);
+    if (priv && !priv->is_prototype() && priv->gtype() == G_TYPE_BYTES) {
+        auto* bytes = static_cast<GBytes*>(priv->to_instance()->ptr());
+        gjs_arg_set(arg, g_bytes_ref(bytes));
+        return true;
+    }
+
     // The bytearray path is taking an extra ref irrespective of transfer
     // ownership, so we need to do the same here.
     return BoxedBase::transfer_to_gi_argument(
@@ -963,6 +1084,36 @@ static bool gjs_marshal_callback_release(JSContext*, GjsArgumentCache*,
     return true;
 }
 
+GJS_JSAPI_RETURN_CONVENTION
+static bool gjs_marshal_async_ready_release(JSContext* cx,
+                                            GjsArgumentCache* self,
+                                            GjsFunctionCallState* state,
+                                            GIArgument* in_arg,
+                                            GIArgument* out_arg) {
+    if (!state->promise)
+        return gjs_marshal_callback_release(cx, self, state, in_arg, out_arg);
+
+    // If the call failed, the callback will never be called to free this
+    if (!state->call_completed) {
+        uint8_t closure_pos = self->contents.callback.closure_pos;
+        gjs_async_promise_free(
+            gjs_arg_get<void*>(&state->in_cvalues[closure_pos]));
+    }
+    gjs_arg_unset<void*>(in_arg);
+    return true;
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool gjs_marshal_strv_in_release(JSContext*, GjsArgumentCache*,
+                                        GjsFunctionCallState*,
+                                        GIArgument* in_arg,
+                                        GIArgument* out_arg
+                                        [[maybe_unused]]) {
+    // Packed by gjs_array_to_packed_strv()
+    g_free(gjs_arg_get<void*>(in_arg));
+    return true;
+}
+
 GJS_JSAPI_RETURN_CONVENTION
 static bool gjs_marshal_string_in_release(JSContext*, GjsArgumentCache*,
                                           GjsFunctionCallState*,
@@ -977,17 +1128,14 @@ GJS_JSAPI_RETURN_CONVENTION
 static bool gjs_marshal_foreign_in_release(
     JSContext* cx, GjsArgumentCache* self, GjsFunctionCallState* state,
     GIArgument* in_arg, GIArgument* out_arg [[maybe_unused]]) {
-    bool ok = true;
-
     GITransfer transfer =
         state->call_completed ? self->transfer : GI_TRANSFER_NOTHING;
 
-    if (transfer == GI_TRANSFER_NOTHING)
-        ok = gjs_struct_foreign_release_g_argument(
-            cx, self->transfer, self->contents.tmp_foreign_info, in_arg);
+    GjsForeignInfo* funcs = self->contents.foreign.funcs;
+    if (transfer == GI_TRANSFER_NOTHING && funcs && funcs->release_func)
+        return funcs->release_func(cx, self->transfer, in_arg);
 
-    g_base_info_unref(self->contents.tmp_foreign_info);
-    return ok;
+    return true;
 }
 
 GJS_JSAPI_RETURN_CONVENTION
@@ -1006,11 +1154,66 @@ static bool gjs_marshal_boxed_in_release(JSContext*, GjsArgumentCache* self,
     return true;
 }
 
+GJS_JSAPI_RETURN_CONVENTION
+static bool gjs_marshal_string_return_out(JSContext* cx, GjsArgumentCache* self,
+                                          GjsFunctionCallState*,
+                                          GIArgument* arg,
+                                          JS::MutableHandleValue value) {
+    const char* str = gjs_arg_get<char*>(arg);
+    if (!str) {
+        value.setNull();
+        return true;
+    }
+
+    GjsContextPrivate* gjs = GjsContextPrivate::from_cx(cx);
+    if (gjs->interned_string_namespace(
+            g_base_info_get_namespace(&self->type_info)))
+        return gjs->string_from_utf8_interned(str, value);
+    return gjs_string_from_utf8(cx, str, value);
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool gjs_marshal_hash_return_out(JSContext* cx, GjsArgumentCache* self,
+                                        GjsFunctionCallState*, GIArgument* arg,
+                                        JS::MutableHandleValue value) {
+    if (GjsContextPrivate::from_cx(cx)->lazy_hash_table_namespace(
+            g_base_info_get_namespace(&self->type_info)))
+        return gjs_hash_table_view_new(cx, value, &self->type_info,
+                                       gjs_arg_get<GHashTable*>(arg));
+    return gjs_value_from_g_argument(cx, value, &self->type_info, arg, true);
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool gjs_marshal_list_return_out(JSContext* cx, GjsArgumentCache* self,
+                                        GjsFunctionCallState*, GIArgument* arg,
+                                        JS::MutableHandleValue value) {
+    if (!GjsContextPrivate::from_cx(cx)->list_iterator_namespace(
+            g_base_info_get_namespace(&self->type_info)))
+        return gjs_value_from_g_argument(cx, value, &self->type_info, arg, true);
+
+    if (!gjs_list_iterator_new(cx, value, &self->type_info, self->transfer,
+                               gjs_arg_get<void*>(arg)))
+        return false;
+
+    // The iterator owns the list now, so there is nothing left to release
+    gjs_arg_unset<void*>(arg);
+    return true;
+}
+
 static void gjs_arg_cache_interface_free(GjsArgumentCache* self) {
     g_clear_pointer(&self->contents.object.info, g_base_info_unref);
 }
 
+static void gjs_arg_cache_foreign_free(GjsArgumentCache* self) {
+    g_clear_pointer(&self->contents.foreign.info, g_base_info_unref);
+}
+
+static void gjs_arg_cache_async_ready_free(GjsArgumentCache* self) {
+    g_clear_pointer(&self->contents.callback.finish_info, g_base_info_unref);
+}
+
 static const GjsArgumentMarshallers skip_all_marshallers = {
+    "skip_all",  // kind
     gjs_marshal_skipped_in,  // in
     gjs_marshal_skipped_out,  // out
     gjs_marshal_skipped_release,  // release
@@ -1018,30 +1221,59 @@ static const GjsArgumentMarshallers skip_all_marshallers = {
 
 // .in is ignored for the return value
 static const GjsArgumentMarshallers return_value_marshallers = {
+    "return_value",  // kind
     nullptr,  // no in
     gjs_marshal_generic_out_out,  // out
     gjs_marshal_generic_out_release,  // release
 };
 
+// .in is ignored for the return value
+static const GjsArgumentMarshallers return_string_marshallers = {
+    "return_string",  // kind
+    nullptr,  // no in
+    gjs_marshal_string_return_out,  // out
+    gjs_marshal_generic_out_release,  // release
+};
+
+// .in is ignored for the return value
+static const GjsArgumentMarshallers return_hash_marshallers = {
+    "return_hash",  // kind
+    nullptr,  // no in
+    gjs_marshal_hash_return_out,  // out
+    gjs_marshal_generic_out_release,  // release
+};
+
+// .in is ignored for the return value
+static const GjsArgumentMarshallers return_list_marshallers = {
+    "return_list",  // kind
+    nullptr,  // no in
+    gjs_marshal_list_return_out,  // out
+    gjs_marshal_generic_out_release,  // release
+};
+
 static const GjsArgumentMarshallers return_array_marshallers = {
+    "return_array",  // kind
     gjs_marshal_generic_out_in,  // in
     gjs_marshal_explicit_array_out_out,  // out
     gjs_marshal_explicit_array_out_release,  // release
 };
 
 static const GjsArgumentMarshallers array_length_out_marshallers = {
+    "array_length_out",  // kind
     gjs_marshal_generic_out_in,  // in
     gjs_marshal_skipped_out,  // out
     gjs_marshal_skipped_release,  // release
 };
 
 static const GjsArgumentMarshallers fallback_in_marshallers = {
+    "fallback_in",  // kind
     gjs_marshal_generic_in_in,  // in
     gjs_marshal_skipped_out,  // out
     gjs_marshal_generic_in_release,  // release
 };
 
 static const GjsArgumentMarshallers fallback_interface_in_marshallers = {
+    "fallback_interface_in",  // kind
     gjs_marshal_generic_in_in,  // in
     gjs_marshal_skipped_out,  // out
     gjs_marshal_generic_in_release,  // release
@@ -1049,48 +1281,58 @@ static const GjsArgumentMarshallers fallback_interface_in_marshallers = {
 };
 
 static const GjsArgumentMarshallers fallback_inout_marshallers = {
+    "fallback_inout",  // kind
     gjs_marshal_generic_inout_in,  // in
     gjs_marshal_generic_out_out,  // out
     gjs_marshal_generic_inout_release,  // release
 };
 
 static const GjsArgumentMarshallers fallback_out_marshallers = {
+    "fallback_out",  // kind
     gjs_marshal_generic_out_in,  // in
     gjs_marshal_generic_out_out,  // out
     gjs_marshal_generic_out_release,  // release
 };
 
 static const GjsArgumentMarshallers invalid_in_marshallers = {
+    "invalid_in",  // kind
     nullptr,  // no in, will cause the function invocation code to throw
     gjs_marshal_skipped_out,  // out
     gjs_marshal_skipped_release,  // release
 };
 
 static const GjsArgumentMarshallers enum_in_marshallers = {
+    "enum_in",  // kind
     gjs_marshal_enum_in_in,  // in
     gjs_marshal_skipped_out,  // out
     gjs_marshal_skipped_release,  // release
 };
 
 static const GjsArgumentMarshallers flags_in_marshallers = {
+    "flags_in",  // kind
     gjs_marshal_flags_in_in,  // in
     gjs_marshal_skipped_out,  // out
     gjs_marshal_skipped_release,  // release
 };
 
 static const GjsArgumentMarshallers foreign_struct_in_marshallers = {
+    "foreign_struct_in",  // kind
     gjs_marshal_foreign_in_in,  // in
     gjs_marshal_skipped_out,  // out
     gjs_marshal_foreign_in_release,  // release
+    gjs_arg_cache_foreign_free,  // free
 };
 
 static const GjsArgumentMarshallers foreign_struct_instance_in_marshallers = {
+    "foreign_struct_instance_in",  // kind
     gjs_marshal_foreign_in_in,  // in
     gjs_marshal_skipped_out,  // out
     gjs_marshal_skipped_release,  // release
+    gjs_arg_cache_foreign_free,  // free
 };
 
 static const GjsArgumentMarshallers gvalue_in_marshallers = {
+    "gvalue_in",  // kind
     gjs_marshal_gvalue_in_in,  // in
     gjs_marshal_skipped_out,  // out
     gjs_marshal_skipped_release,  // release
@@ -1098,6 +1340,7 @@ static const GjsArgumentMarshallers gvalue_in_marshallers = {
 };
 
 static const GjsArgumentMarshallers gvalue_in_transfer_none_marshallers = {
+    "gvalue_in_transfer_none",  // kind
     gjs_marshal_gvalue_in_in,  // in
     gjs_marshal_skipped_out,  // out
     gjs_marshal_boxed_in_release,  // release
@@ -1105,6 +1348,7 @@ static const GjsArgumentMarshallers gvalue_in_transfer_none_marshallers = {
 };
 
 static const GjsArgumentMarshallers gclosure_in_marshallers = {
+    "gclosure_in",  // kind
     gjs_marshal_gclosure_in_in,  // in
     gjs_marshal_skipped_out,  // out
     gjs_marshal_skipped_release,  // release
@@ -1112,6 +1356,7 @@ static const GjsArgumentMarshallers gclosure_in_marshallers = {
 };
 
 static const GjsArgumentMarshallers gclosure_in_transfer_none_marshallers = {
+    "gclosure_in_transfer_none",  // kind
     gjs_marshal_gclosure_in_in,  // in
     gjs_marshal_skipped_out,  // out
     gjs_marshal_boxed_in_release,  // release
@@ -1119,6 +1364,7 @@ static const GjsArgumentMarshallers gclosure_in_transfer_none_marshallers = {
 };
 
 static const GjsArgumentMarshallers gbytes_in_marshallers = {
+    "gbytes_in",  // kind
     gjs_marshal_gbytes_in_in,  // in
     gjs_marshal_skipped_out,  // out
     gjs_marshal_skipped_release,  // release
@@ -1126,6 +1372,7 @@ static const GjsArgumentMarshallers gbytes_in_marshallers = {
 };
 
 static const GjsArgumentMarshallers gbytes_in_transfer_none_marshallers = {
+    "gbytes_in_transfer_none",  // kind
     gjs_marshal_gbytes_in_in,  // in
     gjs_marshal_skipped_out,  // out
     gjs_marshal_boxed_in_release,  // release
@@ -1133,6 +1380,7 @@ static const GjsArgumentMarshallers gbytes_in_transfer_none_marshallers = {
 };
 
 static const GjsArgumentMarshallers object_in_marshallers = {
+    "object_in",  // kind
     gjs_marshal_object_in_in,  // in
     gjs_marshal_skipped_out,  // out
     // This is a smart marshaller, no release needed
@@ -1141,6 +1389,7 @@ static const GjsArgumentMarshallers object_in_marshallers = {
 };
 
 static const GjsArgumentMarshallers interface_in_marshallers = {
+    "interface_in",  // kind
     gjs_marshal_interface_in_in,  // in
     gjs_marshal_skipped_out,  // out
     // This is a smart marshaller, no release needed
@@ -1149,6 +1398,7 @@ static const GjsArgumentMarshallers interface_in_marshallers = {
 };
 
 static const GjsArgumentMarshallers fundamental_in_marshallers = {
+    "fundamental_in",  // kind
     gjs_marshal_fundamental_in_in,  // in
     gjs_marshal_skipped_out,        // out
     // This is a smart marshaller, no release needed
@@ -1157,6 +1407,7 @@ static const GjsArgumentMarshallers fundamental_in_marshallers = {
 };
 
 static const GjsArgumentMarshallers union_in_marshallers = {
+    "union_in",  // kind
     gjs_marshal_union_in_in,  // in
     gjs_marshal_skipped_out,  // out
     // This is a smart marshaller, no release needed
@@ -1165,6 +1416,7 @@ static const GjsArgumentMarshallers union_in_marshallers = {
 };
 
 static const GjsArgumentMarshallers boxed_in_marshallers = {
+    "boxed_in",  // kind
     gjs_marshal_boxed_in_in,  // in
     gjs_marshal_skipped_out,  // out
     // This is a smart marshaller, no release needed
@@ -1173,48 +1425,56 @@ static const GjsArgumentMarshallers boxed_in_marshallers = {
 };
 
 static const GjsArgumentMarshallers null_in_marshallers = {
+    "null_in",  // kind
     gjs_marshal_null_in_in,  // in
     gjs_marshal_skipped_out,  // out
     gjs_marshal_skipped_release,  // release
 };
 
 static const GjsArgumentMarshallers boolean_in_marshallers = {
+    "boolean_in",  // kind
     gjs_marshal_boolean_in_in,  // in
     gjs_marshal_skipped_out,  // out
     gjs_marshal_skipped_release,  // release
 };
 
 static const GjsArgumentMarshallers integer_in_marshallers = {
+    "integer_in",  // kind
     gjs_marshal_integer_in_in,  // in
     gjs_marshal_skipped_out,  // out
     gjs_marshal_skipped_release,  // release
 };
 
 static const GjsArgumentMarshallers number_in_marshallers = {
+    "number_in",  // kind
     gjs_marshal_number_in_in,  // in
     gjs_marshal_skipped_out,  // out
     gjs_marshal_skipped_release,  // release
 };
 
 static const GjsArgumentMarshallers unichar_in_marshallers = {
+    "unichar_in",  // kind
     gjs_marshal_unichar_in_in,  // in
     gjs_marshal_skipped_out,  // out
     gjs_marshal_skipped_release,  // release
 };
 
 static const GjsArgumentMarshallers gtype_in_marshallers = {
+    "gtype_in",  // kind
     gjs_marshal_gtype_in_in,  // in
     gjs_marshal_skipped_out,  // out
     gjs_marshal_skipped_release,  // release
 };
 
 static const GjsArgumentMarshallers string_in_marshallers = {
+    "string_in",  // kind
     gjs_marshal_string_in_in,  // in
     gjs_marshal_skipped_out,  // out
     gjs_marshal_skipped_release,  // release
 };
 
 static const GjsArgumentMarshallers string_in_transfer_none_marshallers = {
+    "string_in_transfer_none",  // kind
     gjs_marshal_string_in_in,  // in
     gjs_marshal_skipped_out,  // out
     gjs_marshal_string_in_release,  // release
@@ -1222,42 +1482,71 @@ static const GjsArgumentMarshallers string_in_transfer_none_marshallers = {
 
 // .out is ignored for the instance parameter
 static const GjsArgumentMarshallers gtype_struct_instance_in_marshallers = {
+    "gtype_struct_instance_in",  // kind
     gjs_marshal_gtype_struct_instance_in,  // in
     nullptr,  // no out
     gjs_marshal_skipped_release,  // release
 };
 
 static const GjsArgumentMarshallers param_instance_in_marshallers = {
+    "param_instance_in",  // kind
     gjs_marshal_param_instance_in,  // in
     nullptr,  // no out
     gjs_marshal_skipped_release,  // release
 };
 
 static const GjsArgumentMarshallers callback_in_marshallers = {
+    "callback_in",  // kind
     gjs_marshal_callback_in,  // in
     gjs_marshal_skipped_out,  // out
     gjs_marshal_callback_release,  // release
 };
 
+static const GjsArgumentMarshallers async_ready_in_marshallers = {
+    "async_ready_in",  // kind
+    gjs_marshal_async_ready_in,  // in
+    gjs_marshal_skipped_out,  // out
+    gjs_marshal_async_ready_release,  // release
+    gjs_arg_cache_async_ready_free,  // free
+};
+
+static const GjsArgumentMarshallers source_func_in_marshallers = {
+    "source_func_in",  // kind
+    gjs_marshal_source_func_in,  // in
+    gjs_marshal_skipped_out,  // out
+    gjs_marshal_skipped_release,  // release
+};
+
+static const GjsArgumentMarshallers strv_in_transfer_none_marshallers = {
+    "strv_in_transfer_none",  // kind
+    gjs_marshal_strv_in_in,  // in
+    gjs_marshal_skipped_out,  // out
+    gjs_marshal_strv_in_release,  // release
+};
+
 static const GjsArgumentMarshallers c_array_in_marshallers = {
+    "c_array_in",  // kind
     gjs_marshal_explicit_array_in_in,  // in
     gjs_marshal_skipped_out,  // out
     gjs_marshal_explicit_array_in_release,  // release
 };
 
 static const GjsArgumentMarshallers c_array_inout_marshallers = {
+    "c_array_inout",  // kind
     gjs_marshal_explicit_array_inout_in,  // in
     gjs_marshal_explicit_array_out_out,  // out
     gjs_marshal_explicit_array_inout_release,  // release
 };
 
 static const GjsArgumentMarshallers c_array_out_marshallers = {
+    "c_array_out",  // kind
     gjs_marshal_generic_out_in,  // in
     gjs_marshal_explicit_array_out_out,  // out
     gjs_marshal_explicit_array_out_release,  // release
 };
 
 static const GjsArgumentMarshallers caller_allocates_out_marshallers = {
+    "caller_allocates_out",  // kind
     gjs_marshal_caller_allocates_in,  // in
     gjs_marshal_generic_out_out,  // out
     gjs_marshal_caller_allocates_release,  // release
@@ -1313,7 +1602,18 @@ bool gjs_arg_cache_build_return(JSContext*, GjsArgumentCache* self,
     // marshal_in is ignored for the return value, but skip_in is not (it is
     // used in the failure release path)
     self->skip_in = true;
-    self->marshallers = &return_value_marshallers;
+    GITypeTag return_tag = g_type_info_get_tag(&self->type_info);
+    if (return_tag == GI_TYPE_TAG_UTF8 && self->transfer == GI_TRANSFER_NOTHING)
+        self->marshallers = &return_string_marshallers;
+    else if (return_tag == GI_TYPE_TAG_GHASH &&
+             self->transfer == GI_TRANSFER_NOTHING)
+        self->marshallers = &return_hash_marshallers;
+    else if ((return_tag == GI_TYPE_TAG_GLIST ||
+              return_tag == GI_TYPE_TAG_GSLIST) &&
+             self->transfer != GI_TRANSFER_NOTHING)
+        self->marshallers = &return_list_marshallers;
+    else
+        self->marshallers = &return_value_marshallers;
 
     return true;
 }
@@ -1391,6 +1691,9 @@ static bool gjs_arg_cache_build_interface_in_arg(JSContext* cx,
 
         case GI_INFO_TYPE_STRUCT:
             if (g_struct_info_is_foreign(interface_info)) {
+                self->contents.foreign.info = g_base_info_ref(interface_info);
+                self->contents.foreign.funcs = nullptr;
+
                 if (is_instance_param)
                     self->marshallers = &foreign_struct_instance_in_marshallers;
                 else
@@ -1587,6 +1890,21 @@ static bool gjs_arg_cache_build_normal_in_arg(JSContext* cx,
         }
 
         case GI_TYPE_TAG_ARRAY:
+            if (self->transfer == GI_TRANSFER_NOTHING &&
+                g_type_info_get_array_type(&self->type_info) ==
+                    GI_ARRAY_TYPE_C &&
+                g_type_info_is_zero_terminated(&self->type_info)) {
+                GjsAutoTypeInfo element_type =
+                    g_type_info_get_param_type(&self->type_info, 0);
+                if (g_type_info_get_tag(element_type) == GI_TYPE_TAG_UTF8) {
+                    self->marshallers = &strv_in_transfer_none_marshallers;
+                    break;
+                }
+            }
+            // FIXME: Falling back to the generic marshaller
+            self->marshallers = &fallback_in_marshallers;
+            break;
+
         case GI_TYPE_TAG_GLIST:
         case GI_TYPE_TAG_GSLIST:
         case GI_TYPE_TAG_GHASH:
@@ -1599,6 +1917,66 @@ static bool gjs_arg_cache_build_normal_in_arg(JSContext* cx,
     return true;
 }
 
+// Looks up the _finish function paired with the async function @callable by
+// the usual naming convention, if its callback at @callback_pos is the last JS
+// argument and it has no return value or out arguments to return instead of a
+// Promise.
+[[nodiscard]] static GIFunctionInfo* find_async_finish_info(
+    GICallableInfo* callable, int callback_pos, int closure_pos) {
+    if (g_base_info_get_type(callable) != GI_INFO_TYPE_FUNCTION)
+        return nullptr;
+
+    GITypeInfo return_type;
+    g_callable_info_load_return_type(callable, &return_type);
+    if (g_type_info_get_tag(&return_type) != GI_TYPE_TAG_VOID)
+        return nullptr;
+
+    int n_args = g_callable_info_get_n_args(callable);
+    for (int ix = 0; ix < n_args; ix++) {
+        GIArgInfo arg;
+        g_callable_info_load_arg(callable, ix, &arg);
+        if (g_arg_info_get_direction(&arg) != GI_DIRECTION_IN ||
+            (ix > callback_pos && ix != closure_pos))
+            return nullptr;
+    }
+
+    std::string name(g_base_info_get_name(callable));
+    if (g_str_has_suffix(name.c_str(), "_async"))
+        name.resize(name.size() - strlen("_async"));
+    name += "_finish";
+
+    GIBaseInfo* container = g_base_info_get_container(callable);  // !owned
+    if (!container) {
+        GIBaseInfo* info = g_irepository_find_by_name(
+            nullptr, g_base_info_get_namespace(callable), name.c_str());
+        if (info && g_base_info_get_type(info) != GI_INFO_TYPE_FUNCTION)
+            g_clear_pointer(&info, g_base_info_unref);
+        return info;
+    }
+
+    // Methods on boxed types have no source object to finish the call on
+    switch (g_base_info_get_type(container)) {
+        case GI_INFO_TYPE_OBJECT:
+            return g_object_info_find_method(container, name.c_str());
+        case GI_INFO_TYPE_INTERFACE:
+            return g_interface_info_find_method(container, name.c_str());
+        default:
+            return nullptr;
+    }
+}
+
+bool gjs_arg_cache_is_async_ready(const GjsArgumentCache* self) {
+    return self->marshallers == &async_ready_in_marshallers;
+}
+
+bool gjs_arg_cache_needs_out(const GjsArgumentCache* self) {
+    return self->marshallers->out != gjs_marshal_skipped_out;
+}
+
+bool gjs_arg_cache_needs_release(const GjsArgumentCache* self) {
+    return self->marshallers->release != gjs_marshal_skipped_release;
+}
+
 bool gjs_arg_cache_build_instance(JSContext* cx, GjsArgumentCache* self,
                                   GICallableInfo* callable) {
     GIBaseInfo* interface_info = g_base_info_get_container(callable);  // !owned
@@ -1732,6 +2110,23 @@ bool gjs_arg_cache_build_arg(JSContext* cx, GjsArgumentCache* self,
                 self->contents.callback.scope = g_arg_info_get_scope(arg);
                 self->set_callback_destroy_pos(destroy_pos);
                 self->set_callback_closure_pos(closure_pos);
+
+                if (destroy_pos >= 0 &&
+                    self->contents.callback.scope == GI_SCOPE_TYPE_NOTIFIED &&
+                    strcmp(interface_info.name(), "SourceFunc") == 0 &&
+                    strcmp(interface_info.ns(), "GLib") == 0)
+                    self->marshallers = &source_func_in_marshallers;
+
+                if (closure_pos >= 0 && destroy_pos < 0 &&
+                    self->contents.callback.scope == GI_SCOPE_TYPE_ASYNC &&
+                    strcmp(interface_info.name(), "AsyncReadyCallback") == 0 &&
+                    strcmp(interface_info.ns(), "Gio") == 0) {
+                    self->contents.callback.finish_info =
+                        find_async_finish_info(callable, gi_index,
+                                               closure_pos);
+                    if (self->contents.callback.finish_info)
+                        self->marshallers = &async_ready_in_marshallers;
+                }
             }
 
             return true;
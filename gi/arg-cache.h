@@ -36,12 +36,15 @@
 #include <js/RootingAPI.h>
 #include <js/TypeDecls.h>
 
+#include "gi/foreign.h"
 #include "cjs/macros.h"
 
 struct GjsFunctionCallState;
 struct GjsArgumentCache;
 
 struct GjsArgumentMarshallers {
+    // Identifies the marshallers in the statistics from GJS_MARSHAL_STATS
+    const char* kind;
     bool (*in)(JSContext* cx, GjsArgumentCache* cache,
                GjsFunctionCallState* state, GIArgument* in_argument,
                JS::HandleValue value);
@@ -77,6 +80,9 @@ struct GjsArgumentCache {
             uint8_t closure_pos;
             uint8_t destroy_pos;
             GIScopeType scope : 2;
+            // Only for a Gio.AsyncReadyCallback that can be omitted in order
+            // to get a Promise; see gjs_arg_cache_is_async_ready()
+            GIFunctionInfo* finish_info;
         } callback;
 
         struct {
@@ -90,7 +96,10 @@ struct GjsArgumentCache {
         } object;
 
         // foreign structures
-        GIStructInfo* tmp_foreign_info;
+        struct {
+            GIStructInfo* info;
+            GjsForeignInfo* funcs;  // resolved on first use
+        } foreign;
 
         // enum / flags
         struct {
@@ -189,4 +198,14 @@ GJS_JSAPI_RETURN_CONVENTION
 bool gjs_arg_cache_build_instance(JSContext* cx, GjsArgumentCache* self,
                                   GICallableInfo* callable);
 
+// Whether @self is the trailing Gio.AsyncReadyCallback of an async function
+// with a known _finish function. If it is left out of the call, the function
+// returns a Promise for the result of the _finish function instead.
+[[nodiscard]] bool gjs_arg_cache_is_async_ready(const GjsArgumentCache* self);
+
+// Whether the out or release marshaller of @self does anything, so that calls
+// can leave out the ones that don't
+[[nodiscard]] bool gjs_arg_cache_needs_out(const GjsArgumentCache* self);
+[[nodiscard]] bool gjs_arg_cache_needs_release(const GjsArgumentCache* self);
+
 #endif  // GI_ARG_CACHE_H_
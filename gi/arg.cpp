@@ -26,9 +26,13 @@
 
 #include <string.h>  // for strcmp, strlen, memcpy
 
+#include <algorithm>  // for binary_search, sort
 #include <limits>  // for numeric_limits
 #include <string>
 #include <type_traits>
+#include <unordered_map>
+#include <utility>  // for move
+#include <vector>
 
 #include <girepository.h>
 #include <glib-object.h>
@@ -37,6 +41,7 @@
 #include <js/Array.h>
 #include <js/CharacterEncoding.h>
 #include <js/Conversions.h>
+#include <js/GCAPI.h>  // for AutoCheckCannotGC
 #include <js/GCVector.h>            // for RootedVector, MutableWrappedPtrOp...
 #include <js/PropertyDescriptor.h>  // for JSPROP_ENUMERATE
 #include <js/RootingAPI.h>
@@ -46,6 +51,7 @@
 #include <js/ValueArray.h>
 #include <jsapi.h>        // for JS_ReportOutOfMemory, JS_GetElement
 #include <jsfriendapi.h>  // for JS_IsUint8Array, JS_GetObjectFunc...
+#include <mozilla/Span.h>
 
 #include "gi/arg-inl.h"
 #include "gi/arg.h"
@@ -66,35 +72,124 @@
 #include "cjs/jsapi-util.h"
 #include "util/log.h"
 
-bool _gjs_flags_value_is_valid(JSContext* context, GType gtype, int64_t value) {
-    GFlagsValue *v;
-    guint32 tmpval;
+// Enum and flags values are checked on every conversion that doesn't go
+// through the argument cache, so the set of valid values for each type is
+// computed once and kept for the lifetime of the process. Only used from the
+// main thread.
+namespace {
+class EnumValidationTable {
+    // Ranges up to this size are stored as a bitset indexed by value - min;
+    // sparser enums fall back to a sorted list of values.
+    static constexpr int64_t MAX_DENSE_RANGE = 1024;
+
+    int64_t m_min = 0;
+    int64_t m_max = -1;
+    std::vector<bool> m_dense;
+    std::vector<int64_t> m_sparse;
+
+ public:
+    explicit EnumValidationTable(std::vector<int64_t>&& values) {
+        if (values.empty())
+            return;
+
+        std::sort(values.begin(), values.end());
+        m_min = values.front();
+        m_max = values.back();
+
+        if (m_max - m_min < MAX_DENSE_RANGE) {
+            m_dense.resize(m_max - m_min + 1);
+            for (int64_t value : values)
+                m_dense[value - m_min] = true;
+        } else {
+            m_sparse = std::move(values);
+        }
+    }
+
+    [[nodiscard]] bool contains(int64_t value) const {
+        if (value < m_min || value > m_max)
+            return false;
+        if (!m_dense.empty())
+            return m_dense[value - m_min];
+        return std::binary_search(m_sparse.begin(), m_sparse.end(), value);
+    }
+};
+}  // namespace
+
+// Tables built from GIEnumInfo are keyed on the info's name, which points into
+// the typelib and so identifies the same enum however the info was obtained;
+// looking up the GType of an info would go through the typelib's symbol table,
+// and enums without a GType have none. They are kept apart from the ones built
+// from GEnumClass, because the former have unsigned values above G_MAXINT32
+// where the latter store them as negative ints.
+static std::unordered_map<const char*, EnumValidationTable> enum_info_tables;
+static std::unordered_map<GType, EnumValidationTable> enum_class_tables;
+static std::unordered_map<GType, unsigned> flags_masks;
+
+[[nodiscard]] static const EnumValidationTable& enum_info_validation_table(
+    GIEnumInfo* enum_info) {
+    const char* key = g_base_info_get_name(enum_info);
+    auto it = enum_info_tables.find(key);
+    if (it != enum_info_tables.end())
+        return it->second;
+
+    int n_values = g_enum_info_get_n_values(enum_info);
+    std::vector<int64_t> values;
+    values.reserve(n_values);
+    for (int i = 0; i < n_values; ++i) {
+        GjsAutoValueInfo value_info = g_enum_info_get_value(enum_info, i);
+        values.push_back(g_value_info_get_value(value_info));
+    }
+    return enum_info_tables.emplace(key, std::move(values)).first->second;
+}
+
+bool _gjs_enum_gtype_value_is_valid(JSContext* cx, GType gtype,
+                                    int64_t value) {
+    auto it = enum_class_tables.find(gtype);
+    if (it == enum_class_tables.end()) {
+        GjsAutoTypeClass<GEnumClass> enum_class(gtype);
+        std::vector<int64_t> values;
+        values.reserve(enum_class->n_values);
+        for (unsigned i = 0; i < enum_class->n_values; ++i)
+            values.push_back(enum_class->values[i].value);
+        it = enum_class_tables.emplace(gtype, std::move(values)).first;
+    }
 
+    /* See _gjs_enum_to_int() */
+    if (!it->second.contains(static_cast<int>(value))) {
+        gjs_throw(cx,
+                  "%" G_GINT64_MODIFIER
+                  "d is not a valid value for enumeration %s",
+                  value, g_type_name(gtype));
+        return false;
+    }
+
+    return true;
+}
+
+bool _gjs_flags_value_is_valid(JSContext* context, GType gtype, int64_t value) {
     /* FIXME: Do proper value check for flags with GType's */
     if (gtype == G_TYPE_NONE)
         return true;
 
-    GjsAutoTypeClass<GTypeClass> klass(gtype);
+    auto it = flags_masks.find(gtype);
+    if (it == flags_masks.end()) {
+        GjsAutoTypeClass<GFlagsClass> klass(gtype);
+        it = flags_masks.emplace(gtype, klass->mask).first;
+    }
 
     /* check all bits are defined for flags.. not necessarily desired */
-    tmpval = (guint32)value;
+    guint32 tmpval = (guint32)value;
     if (tmpval != value) { /* Not a guint32 */
         gjs_throw(context,
                   "0x%" G_GINT64_MODIFIER "x is not a valid value for flags %s",
-                  value, g_type_name(G_TYPE_FROM_CLASS(klass)));
+                  value, g_type_name(gtype));
         return false;
     }
 
-    while (tmpval) {
-        v = g_flags_get_first_value(klass.as<GFlagsClass>(), tmpval);
-        if (!v) {
-            gjs_throw(context,
-                      "0x%x is not a valid value for flags %s",
-                      (guint32)value, g_type_name(G_TYPE_FROM_CLASS(klass)));
-            return false;
-        }
-
-        tmpval &= ~v->value;
+    if ((tmpval & it->second) != tmpval) {
+        gjs_throw(context, "0x%x is not a valid value for flags %s", tmpval,
+                  g_type_name(gtype));
+        return false;
     }
 
     return true;
@@ -103,33 +198,14 @@ bool _gjs_flags_value_is_valid(JSContext* context, GType gtype, int64_t value) {
 GJS_JSAPI_RETURN_CONVENTION
 static bool _gjs_enum_value_is_valid(JSContext* context, GIEnumInfo* enum_info,
                                      int64_t value) {
-    bool found;
-    int n_values;
-    int i;
-
-    n_values = g_enum_info_get_n_values(enum_info);
-    found = false;
-
-    for (i = 0; i < n_values; ++i) {
-        GIValueInfo *value_info;
-
-        value_info = g_enum_info_get_value(enum_info, i);
-        int64_t enum_value = g_value_info_get_value(value_info);
-        g_base_info_unref((GIBaseInfo *)value_info);
-
-        if (enum_value == value) {
-            found = true;
-            break;
-        }
-    }
-
-    if (!found) {
+    if (!enum_info_validation_table(enum_info).contains(value)) {
         gjs_throw(context,
                   "%" G_GINT64_MODIFIER "d is not a valid value for enumeration %s",
                   value, g_base_info_get_name((GIBaseInfo *)enum_info));
+        return false;
     }
 
-    return found;
+    return true;
 }
 
 [[nodiscard]] static bool _gjs_enum_uses_signed_type(GIEnumInfo* enum_info) {
@@ -535,7 +611,8 @@ value_to_ghashtable_key(JSContext      *cx,
     bool out_of_range = false;
     bool unsupported = false;
 
-    g_return_val_if_fail(value.isString() || value.isInt32(), false);
+    g_return_val_if_fail(
+        value.isString() || value.isNumber() || value.isBoolean(), false);
 
     gjs_debug_marshal(GJS_DEBUG_GFUNCTION,
                       "Converting JS::Value to GHashTable key %s",
@@ -620,8 +697,8 @@ value_to_ghashtable_key(JSContext      *cx,
     case GI_TYPE_TAG_INT64:
     case GI_TYPE_TAG_UINT64:
     /* FIXME: The above four could be supported, but are currently not. The ones
-     * below cannot be key types in a regular JS object; we would need to allow
-     * marshalling Map objects into GHashTables to support those. */
+     * below cannot be key types in a regular JS object, and Map keys of those
+     * types are not converted either. */
     case GI_TYPE_TAG_VOID:
     case GI_TYPE_TAG_GTYPE:
     case GI_TYPE_TAG_ERROR:
@@ -663,6 +740,110 @@ template <typename T>
     return heap_val;
 }
 
+// Converts one key-value pair and inserts it into @hash
+GJS_JSAPI_RETURN_CONVENTION
+static bool g_hash_insert_js_pair(JSContext* cx, JS::HandleValue key_js,
+                                  JS::HandleValue val_js,
+                                  GITypeInfo* key_param_info,
+                                  GITypeInfo* val_param_info,
+                                  GITransfer transfer, GHashTable* hash) {
+    gpointer key_ptr, val_ptr;
+    GIArgument val_arg = { 0 };
+
+    // Type check key type.
+    if (!value_to_ghashtable_key(cx, key_js, key_param_info, &key_ptr) ||
+        // Type check and convert value to a C type
+        !gjs_value_to_g_argument(cx, val_js, val_param_info, nullptr,
+                                 GJS_ARGUMENT_HASH_ELEMENT, transfer,
+                                 true /* allow null */, &val_arg))
+        return false;
+
+    GITypeTag val_type = g_type_info_get_tag(val_param_info);
+    /* Use heap-allocated values for types that don't fit in a pointer */
+    if (val_type == GI_TYPE_TAG_INT64) {
+        val_ptr = heap_value_new_from_arg<int64_t>(&val_arg);
+    } else if (val_type == GI_TYPE_TAG_UINT64) {
+        val_ptr = heap_value_new_from_arg<uint64_t>(&val_arg);
+    } else if (val_type == GI_TYPE_TAG_FLOAT) {
+        val_ptr = heap_value_new_from_arg<float>(&val_arg);
+    } else if (val_type == GI_TYPE_TAG_DOUBLE) {
+        val_ptr = heap_value_new_from_arg<double>(&val_arg);
+    } else {
+        // Other types are simply stuffed inside the pointer
+        val_ptr =
+            _g_type_info_hash_pointer_from_argument(val_param_info, &val_arg);
+    }
+
+#if __GNUC__ >= 8  // clang-format off
+_Pragma("GCC diagnostic push")
+_Pragma("GCC diagnostic ignored \"-Wmaybe-uninitialized\"")
+#endif
+    // The compiler isn't smart enough to figure out that key_ptr will
+    // always be initialized if value_to_ghashtable_key() returns true.
+    g_hash_table_insert(hash, key_ptr, val_ptr);
+#if __GNUC__ >= 8
+_Pragma("GCC diagnostic pop")
+#endif  // clang-format on
+
+    return true;
+}
+
+namespace {
+struct MapToGHashData {
+    GITypeInfo* key_param_info;
+    GITypeInfo* val_param_info;
+    GITransfer transfer;
+    GHashTable* hash;
+};
+}  // namespace
+
+// Callback for JS::MapForEach(), called with (value, key, map); the
+// conversion parameters are in the function's reserved slot
+GJS_JSAPI_RETURN_CONVENTION
+static bool map_entry_to_g_hash(JSContext* cx, unsigned argc, JS::Value* vp) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+    auto* data = static_cast<MapToGHashData*>(
+        js::GetFunctionNativeReserved(&args.callee(), 0).toPrivate());
+
+    // Keys of Maps can be anything, not just strings and integers
+    JS::HandleValue key_js = args.get(1);
+    if (!key_js.isString() && !key_js.isNumber() && !key_js.isBoolean()) {
+        gjs_throw(cx,
+                  "Map keys must be strings, numbers, or booleans to be "
+                  "converted to a hash table");
+        return false;
+    }
+
+    args.rval().setUndefined();
+    return g_hash_insert_js_pair(cx, key_js, args.get(0), data->key_param_info,
+                                 data->val_param_info, data->transfer,
+                                 data->hash);
+}
+
+// Maps are iterated natively, and their keys are converted as they are, not
+// stringified like property keys of plain objects
+GJS_JSAPI_RETURN_CONVENTION
+static bool gjs_map_to_g_hash(JSContext* cx, JS::HandleObject map,
+                              GITypeInfo* key_param_info,
+                              GITypeInfo* val_param_info, GITransfer transfer,
+                              GHashTable* hash) {
+    MapToGHashData data{key_param_info, val_param_info, transfer, hash};
+
+    JSFunction* func = js::NewFunctionWithReserved(
+        cx, &map_entry_to_g_hash, 2, 0, "map_entry_to_g_hash");
+    if (!func)
+        return false;
+    JS::RootedObject func_obj(cx, JS_GetFunctionObject(func));
+    js::SetFunctionNativeReserved(func_obj, 0, JS::PrivateValue(&data));
+
+    JS::RootedValue callback(cx, JS::ObjectValue(*func_obj));
+    bool ok = JS::MapForEach(cx, map, callback, JS::UndefinedHandleValue);
+
+    // The callback can't outlive the data on the stack
+    js::SetFunctionNativeReserved(func_obj, 0, JS::UndefinedValue());
+    return ok;
+}
+
 GJS_JSAPI_RETURN_CONVENTION
 static bool
 gjs_object_to_g_hash(JSContext   *context,
@@ -692,57 +873,35 @@ gjs_object_to_g_hash(JSContext   *context,
         transfer = GI_TRANSFER_NOTHING;
     }
 
+    GjsAutoPointer<GHashTable, GHashTable, g_hash_table_destroy> result =
+        create_hash_table_for_key_type(key_param_info);
+
+    bool is_map;
+    if (!JS::IsMapObject(context, props, &is_map))
+        return false;
+    if (is_map) {
+        if (!gjs_map_to_g_hash(context, props, key_param_info, val_param_info,
+                               transfer, result))
+            return false;
+
+        *hash_p = result.release();
+        return true;
+    }
+
     JS::Rooted<JS::IdVector> ids(context, context);
     if (!JS_Enumerate(context, props, &ids))
         return false;
 
-    GjsAutoPointer<GHashTable, GHashTable, g_hash_table_destroy> result =
-        create_hash_table_for_key_type(key_param_info);
-
     JS::RootedValue key_js(context), val_js(context);
     JS::RootedId cur_id(context);
     for (id_ix = 0, id_len = ids.length(); id_ix < id_len; ++id_ix) {
         cur_id = ids[id_ix];
-        gpointer key_ptr, val_ptr;
-        GIArgument val_arg = { 0 };
 
         if (!JS_IdToValue(context, cur_id, &key_js) ||
-            // Type check key type.
-            !value_to_ghashtable_key(context, key_js, key_param_info,
-                                     &key_ptr) ||
             !JS_GetPropertyById(context, props, cur_id, &val_js) ||
-            // Type check and convert value to a C type
-            !gjs_value_to_g_argument(context, val_js, val_param_info, nullptr,
-                                     GJS_ARGUMENT_HASH_ELEMENT, transfer,
-                                     true /* allow null */, &val_arg))
+            !g_hash_insert_js_pair(context, key_js, val_js, key_param_info,
+                                   val_param_info, transfer, result))
             return false;
-
-        GITypeTag val_type = g_type_info_get_tag(val_param_info);
-        /* Use heap-allocated values for types that don't fit in a pointer */
-        if (val_type == GI_TYPE_TAG_INT64) {
-            val_ptr = heap_value_new_from_arg<int64_t>(&val_arg);
-        } else if (val_type == GI_TYPE_TAG_UINT64) {
-            val_ptr = heap_value_new_from_arg<uint64_t>(&val_arg);
-        } else if (val_type == GI_TYPE_TAG_FLOAT) {
-            val_ptr = heap_value_new_from_arg<float>(&val_arg);
-        } else if (val_type == GI_TYPE_TAG_DOUBLE) {
-            val_ptr = heap_value_new_from_arg<double>(&val_arg);
-        } else {
-            // Other types are simply stuffed inside the pointer
-            val_ptr = _g_type_info_hash_pointer_from_argument(val_param_info,
-                                                              &val_arg);
-        }
-
-#if __GNUC__ >= 8  // clang-format off
-_Pragma("GCC diagnostic push")
-_Pragma("GCC diagnostic ignored \"-Wmaybe-uninitialized\"")
-#endif
-        // The compiler isn't smart enough to figure out that key_ptr will
-        // always be initialized if value_to_ghashtable_key() returns true.
-        g_hash_table_insert(result, key_ptr, val_ptr);
-#if __GNUC__ >= 8
-_Pragma("GCC diagnostic pop")
-#endif  // clang-format on
     }
 
     *hash_p = result.release();
@@ -763,12 +922,15 @@ gjs_array_from_strv(JSContext             *context,
      * would need to always check for both an empty array and null if that was
      * the case.
      */
-    for (i = 0; strv != NULL && strv[i] != NULL; i++) {
-        if (!elems.growBy(1)) {
-            JS_ReportOutOfMemory(context);
-            return false;
-        }
+    guint length = strv ? g_strv_length(const_cast<char**>(strv)) : 0;
+    if (!elems.resize(length)) {
+        JS_ReportOutOfMemory(context);
+        return false;
+    }
 
+    // ASCII strings, such as most style classes and identifiers, are copied
+    // into Latin-1 strings without decoding
+    for (i = 0; i < length; i++) {
         if (!gjs_string_from_utf8(context, strv[i], elems[i]))
             return false;
     }
@@ -818,6 +980,53 @@ gjs_array_to_strv(JSContext   *context,
     return true;
 }
 
+bool gjs_array_to_packed_strv(JSContext* cx, JS::HandleObject array,
+                              uint32_t length, char*** strv_out) {
+    JS::RootedVector<JSString*> strings(cx);
+    if (!strings.reserve(length)) {
+        JS_ReportOutOfMemory(cx);
+        return false;
+    }
+
+    // First pass: measure the strings, to allocate only once
+    size_t strings_size = 0;
+    JS::RootedValue elem(cx);
+    for (uint32_t ix = 0; ix < length; ix++) {
+        if (!JS_GetElement(cx, array, ix, &elem)) {
+            gjs_throw(cx, "Missing array element %u", ix);
+            return false;
+        }
+        if (!elem.isString()) {
+            gjs_throw(cx, "Value is not a string, cannot convert to UTF-8");
+            return false;
+        }
+
+        JSLinearString* linear = JS_EnsureLinearString(cx, elem.toString());
+        if (!linear)
+            return false;
+        strings_size += JS::GetDeflatedUTF8StringLength(linear) + 1;
+        strings.infallibleAppend(JS_FORGET_STRING_LINEARNESS(linear));
+    }
+
+    // Second pass: encode the strings right after the pointers
+    size_t pointers_size = (length + 1) * sizeof(char*);
+    auto** strv = static_cast<char**>(g_malloc(pointers_size + strings_size));
+    char* dest = reinterpret_cast<char*>(strv) + pointers_size;
+    char* end = dest + strings_size;
+    for (uint32_t ix = 0; ix < length; ix++) {
+        size_t written = JS::DeflateStringToUTF8Buffer(
+            JS_ASSERT_STRING_IS_LINEAR(strings[ix]),
+            mozilla::Span<char>(dest, end - dest - 1));
+        dest[written] = '\0';
+        strv[ix] = dest;
+        dest += written + 1;
+    }
+    strv[length] = nullptr;
+
+    *strv_out = strv;
+    return true;
+}
+
 GJS_JSAPI_RETURN_CONVENTION
 static bool
 gjs_string_to_intarray(JSContext       *context,
@@ -888,68 +1097,116 @@ gjs_array_to_gboolean_array(JSContext      *cx,
     return true;
 }
 
-GJS_JSAPI_RETURN_CONVENTION
-static bool
-gjs_array_to_intarray(JSContext   *context,
-                      JS::Value    array_value,
-                      unsigned int length,
-                      void       **arr_p,
-                      unsigned     intsize,
-                      bool         is_signed)
-{
-    /* nasty union types in an attempt to unify the various int types */
-    union { uint64_t u; int64_t i; } intval;
-    void *result;
-    unsigned i;
-    JS::RootedObject array(context, array_value.toObjectOrNull());
-    JS::RootedValue elem(context);
-
-    /* add one so we're always zero terminated */
-    result = g_malloc0((length+1) * intsize);
-
-    for (i = 0; i < length; ++i) {
-        bool success;
+// Converts the elements of a JS array into a C array of numbers. The element
+// type is fixed at compile time, so that the store is a plain typed assignment.
+// Elements that are already int32 or double JS values, as in a packed array of
+// numbers, are stored directly instead of going through JS::ToInt64() or
+// JS::ToNumber().
+template <typename T>
+GJS_JSAPI_RETURN_CONVENTION static bool fill_carray_from_js_array(
+    JSContext* cx, JS::HandleObject array, unsigned length, T* result,
+    const char* invalid_element_message) {
+    JS::RootedValue elem(cx);
 
-        elem = JS::UndefinedValue();
-        if (!JS_GetElement(context, array, i, &elem)) {
-            g_free(result);
-            gjs_throw(context,
-                      "Missing array element %u",
-                      i);
+    for (unsigned i = 0; i < length; ++i) {
+        if (!JS_GetElement(cx, array, i, &elem)) {
+            gjs_throw(cx, "Missing array element %u", i);
             return false;
         }
 
-        /* do whatever sign extension is appropriate */
-        success = (is_signed) ?
-            JS::ToInt64(context, elem, &(intval.i)) :
-            JS::ToUint64(context, elem, &(intval.u));
+        if constexpr (std::is_floating_point_v<T>) {
+            double val;
+            if (elem.isNumber()) {
+                val = elem.toNumber();
+            } else if (!JS::ToNumber(cx, elem, &val)) {
+                gjs_throw(cx, "%s", invalid_element_message);
+                return false;
+            }
+            /* Note that this is truncating assignment. */
+            result[i] = val;
+        } else {
+            /* Note that these are truncating assignments. */
+            if (elem.isInt32()) {
+                result[i] = static_cast<T>(elem.toInt32());
+                continue;
+            }
 
-        if (!success) {
-            g_free(result);
-            gjs_throw(context,
-                      "Invalid element in int array");
-            return false;
-        }
-        /* Note that this is truncating assignment. */
-        switch (intsize) {
-        case 1:
-            ((guint8*)result)[i] = (gint8) intval.u; break;
-        case 2:
-            ((guint16*)result)[i] = (gint16) intval.u; break;
-        case 4:
-            ((guint32*)result)[i] = (gint32) intval.u; break;
-        case 8:
-            ((uint64_t *)result)[i] = (int64_t) intval.u; break;
-        default:
-            g_assert_not_reached();
+            /* do whatever sign extension is appropriate */
+            if constexpr (std::is_signed_v<T>) {
+                int64_t val;
+                if (!JS::ToInt64(cx, elem, &val)) {
+                    gjs_throw(cx, "%s", invalid_element_message);
+                    return false;
+                }
+                result[i] = static_cast<T>(val);
+            } else {
+                uint64_t val;
+                if (!JS::ToUint64(cx, elem, &val)) {
+                    gjs_throw(cx, "%s", invalid_element_message);
+                    return false;
+                }
+                result[i] = static_cast<T>(val);
+            }
         }
     }
 
-    *arr_p = result;
+    return true;
+}
+
+template <typename T>
+GJS_JSAPI_RETURN_CONVENTION static bool js_array_to_numeric_carray(
+    JSContext* cx, JS::Value array_value, unsigned length, void** arr_p,
+    const char* invalid_element_message) {
+    JS::RootedObject array(cx, array_value.toObjectOrNull());
+
+    /* add one so we're always zero terminated */
+    GjsAutoPointer<T, void, g_free> result = g_new0(T, length + 1);
 
+    if (!fill_carray_from_js_array<T>(cx, array, length, result,
+                                      invalid_element_message))
+        return false;
+
+    *arr_p = result.release();
     return true;
 }
 
+GJS_JSAPI_RETURN_CONVENTION
+static bool
+gjs_array_to_intarray(JSContext   *context,
+                      JS::Value    array_value,
+                      unsigned int length,
+                      void       **arr_p,
+                      unsigned     intsize,
+                      bool         is_signed)
+{
+    static const char* invalid = "Invalid element in int array";
+
+    switch (intsize) {
+    case 1:
+        return is_signed ? js_array_to_numeric_carray<int8_t>(
+                               context, array_value, length, arr_p, invalid)
+                         : js_array_to_numeric_carray<uint8_t>(
+                               context, array_value, length, arr_p, invalid);
+    case 2:
+        return is_signed ? js_array_to_numeric_carray<int16_t>(
+                               context, array_value, length, arr_p, invalid)
+                         : js_array_to_numeric_carray<uint16_t>(
+                               context, array_value, length, arr_p, invalid);
+    case 4:
+        return is_signed ? js_array_to_numeric_carray<int32_t>(
+                               context, array_value, length, arr_p, invalid)
+                         : js_array_to_numeric_carray<uint32_t>(
+                               context, array_value, length, arr_p, invalid);
+    case 8:
+        return is_signed ? js_array_to_numeric_carray<int64_t>(
+                               context, array_value, length, arr_p, invalid)
+                         : js_array_to_numeric_carray<uint64_t>(
+                               context, array_value, length, arr_p, invalid);
+    default:
+        g_assert_not_reached();
+    }
+}
+
 GJS_JSAPI_RETURN_CONVENTION
 static bool
 gjs_gtypearray_to_array(JSContext   *context,
@@ -1001,50 +1258,13 @@ gjs_array_to_floatarray(JSContext   *context,
                         void       **arr_p,
                         bool         is_double)
 {
-    unsigned int i;
-    void *result;
-    JS::RootedObject array(context, array_value.toObjectOrNull());
-    JS::RootedValue elem(context);
-
-    /* add one so we're always zero terminated */
-    result = g_malloc0((length+1) * (is_double ? sizeof(double) : sizeof(float)));
-
-    for (i = 0; i < length; ++i) {
-        double val;
-        bool success;
-
-        elem = JS::UndefinedValue();
-        if (!JS_GetElement(context, array, i, &elem)) {
-            g_free(result);
-            gjs_throw(context,
-                      "Missing array element %u",
-                      i);
-            return false;
-        }
-
-        /* do whatever sign extension is appropriate */
-        success = JS::ToNumber(context, elem, &val);
-
-        if (!success) {
-            g_free(result);
-            gjs_throw(context,
-                      "Invalid element in array");
-            return false;
-        }
+    static const char* invalid = "Invalid element in array";
 
-        /* Note that this is truncating assignment. */
-        if (is_double) {
-            double *darray = (double*)result;
-            darray[i] = val;
-        } else {
-            float *farray = (float*)result;
-            farray[i] = val;
-        }
-    }
-
-    *arr_p = result;
-
-    return true;
+    if (is_double)
+        return js_array_to_numeric_carray<double>(context, array_value, length,
+                                                  arr_p, invalid);
+    return js_array_to_numeric_carray<float>(context, array_value, length,
+                                             arr_p, invalid);
 }
 
 GJS_JSAPI_RETURN_CONVENTION
@@ -1261,6 +1481,160 @@ gjs_array_from_flat_gvalue_array(JSContext             *context,
     return result;
 }
 
+// Returns the byte size of a C array element of type @element_type if a typed
+// array of type @scalar_type has exactly the same memory layout, or 0 if not.
+[[nodiscard]] static size_t typed_array_element_size(GITypeTag element_type,
+                                                     js::Scalar::Type scalar) {
+    switch (element_type) {
+        case GI_TYPE_TAG_INT8:
+            return scalar == js::Scalar::Int8 ? 1 : 0;
+        case GI_TYPE_TAG_UINT8:
+            return (scalar == js::Scalar::Uint8 ||
+                    scalar == js::Scalar::Uint8Clamped)
+                       ? 1
+                       : 0;
+        case GI_TYPE_TAG_INT16:
+            return scalar == js::Scalar::Int16 ? 2 : 0;
+        case GI_TYPE_TAG_UINT16:
+            return scalar == js::Scalar::Uint16 ? 2 : 0;
+        case GI_TYPE_TAG_INT32:
+            return scalar == js::Scalar::Int32 ? 4 : 0;
+        case GI_TYPE_TAG_UINT32:
+        case GI_TYPE_TAG_UNICHAR:
+            return scalar == js::Scalar::Uint32 ? 4 : 0;
+        case GI_TYPE_TAG_FLOAT:
+            return scalar == js::Scalar::Float32 ? sizeof(float) : 0;
+        case GI_TYPE_TAG_DOUBLE:
+            return scalar == js::Scalar::Float64 ? sizeof(double) : 0;
+        default:
+            return 0;
+    }
+}
+
+// Copies the contents of a typed array into a new C array in one go, if its
+// element type matches the C array's exactly. Returns false in *handled if the
+// caller must convert the elements one by one instead.
+static void typed_array_to_carray(JSObject* obj, GITypeTag element_type,
+                                  size_t length, void** arr_p, bool* handled) {
+    *handled = false;
+
+    if (!JS_IsTypedArrayObject(obj) || JS_GetTypedArrayLength(obj) != length)
+        return;
+
+    size_t element_size =
+        typed_array_element_size(element_type, JS_GetArrayBufferViewType(obj));
+    if (element_size == 0)
+        return;
+
+    /* add one so we're always zero terminated */
+    void* result = g_malloc0((length + 1) * element_size);
+    if (length > 0) {
+        JS::AutoCheckCannotGC nogc;
+        bool is_shared;
+        void* data = JS_GetArrayBufferViewData(obj, &is_shared, nogc);
+        memcpy(result, data, length * element_size);
+    }
+
+    *arr_p = result;
+    *handled = true;
+}
+
+// If @param_info is a struct made up only of fields of one numeric type with
+// no padding, such as graphene_point_t, returns that type and sets
+// @n_fields_out, so that arrays of the struct can be exchanged with typed
+// arrays in bulk. Returns GI_TYPE_TAG_VOID otherwise.
+[[nodiscard]] static GITypeTag flat_struct_element_type(GITypeInfo* param_info,
+                                                        unsigned* n_fields_out) {
+    if (g_type_info_is_pointer(param_info) ||
+        g_type_info_get_tag(param_info) != GI_TYPE_TAG_INTERFACE)
+        return GI_TYPE_TAG_VOID;
+
+    GjsAutoBaseInfo interface_info = g_type_info_get_interface(param_info);
+    if (interface_info.type() != GI_INFO_TYPE_STRUCT)
+        return GI_TYPE_TAG_VOID;
+
+    int n_fields = g_struct_info_get_n_fields(interface_info);
+    GITypeTag element_type = GI_TYPE_TAG_VOID;
+    size_t element_size = 0;
+    for (int ix = 0; ix < n_fields; ix++) {
+        GjsAutoFieldInfo field = g_struct_info_get_field(interface_info, ix);
+        GjsAutoTypeInfo field_type = g_field_info_get_type(field);
+        if (g_type_info_is_pointer(field_type) ||
+            g_field_info_get_size(field) != 0)
+            return GI_TYPE_TAG_VOID;
+
+        GITypeTag tag = g_type_info_get_tag(field_type);
+        if (ix == 0) {
+            element_type = tag;
+            switch (tag) {
+                case GI_TYPE_TAG_INT8:
+                case GI_TYPE_TAG_UINT8:
+                    element_size = 1;
+                    break;
+                case GI_TYPE_TAG_INT16:
+                case GI_TYPE_TAG_UINT16:
+                    element_size = 2;
+                    break;
+                case GI_TYPE_TAG_INT32:
+                case GI_TYPE_TAG_UINT32:
+                case GI_TYPE_TAG_FLOAT:
+                    element_size = 4;
+                    break;
+                case GI_TYPE_TAG_DOUBLE:
+                    element_size = 8;
+                    break;
+                default:
+                    return GI_TYPE_TAG_VOID;
+            }
+        } else if (tag != element_type) {
+            return GI_TYPE_TAG_VOID;
+        }
+
+        if (size_t(g_field_info_get_offset(field)) != ix * element_size)
+            return GI_TYPE_TAG_VOID;
+    }
+
+    if (n_fields == 0 ||
+        g_struct_info_get_size(interface_info) != n_fields * element_size)
+        return GI_TYPE_TAG_VOID;
+
+    *n_fields_out = n_fields;
+    return element_type;
+}
+
+// Copies a typed array into a new C array of flat structs in one go, if the
+// structs consist of fields of the typed array's element type, e.g. a
+// Float32Array with the x and y coordinates of points one after the other.
+// Returns false if the caller must convert the value some other way.
+[[nodiscard]] static bool typed_array_to_flat_struct_array(
+    JSObject* obj, GITypeInfo* param_info, void** contents, size_t* length_p) {
+    unsigned n_fields;
+    GITypeTag element_type = flat_struct_element_type(param_info, &n_fields);
+    if (element_type == GI_TYPE_TAG_VOID)
+        return false;
+
+    size_t element_size =
+        typed_array_element_size(element_type, JS_GetArrayBufferViewType(obj));
+    uint32_t n_elements = JS_GetTypedArrayLength(obj);
+    if (element_size == 0 || n_elements % n_fields != 0)
+        return false;
+
+    size_t length = n_elements / n_fields;
+    size_t struct_size = n_fields * element_size;
+    /* add one so we're always zero terminated */
+    void* result = g_malloc0((length + 1) * struct_size);
+    if (length > 0) {
+        JS::AutoCheckCannotGC nogc;
+        bool is_shared;
+        void* data = JS_GetArrayBufferViewData(obj, &is_shared, nogc);
+        memcpy(result, data, length * struct_size);
+    }
+
+    *contents = result;
+    *length_p = length;
+    return true;
+}
+
 GJS_JSAPI_RETURN_CONVENTION
 static bool gjs_array_to_array(JSContext* context, JS::HandleValue array_value,
                                size_t length, GITransfer transfer,
@@ -1269,6 +1643,14 @@ static bool gjs_array_to_array(JSContext* context, JS::HandleValue array_value,
 
     GITypeTag element_type = _g_type_info_get_storage_type(param_info);
 
+    if (array_value.isObject()) {
+        bool handled;
+        typed_array_to_carray(&array_value.toObject(), element_type, length,
+                              arr_p, &handled);
+        if (handled)
+            return true;
+    }
+
     /* Special case for GValue "flat arrays" */
     if (is_gvalue_flat_array(param_info, element_type))
         return gjs_array_to_flat_gvalue_array(context, array_value, length, arr_p);
@@ -1503,6 +1885,10 @@ bool gjs_array_to_explicit_array(JSContext* context, JS::HandleValue value,
                                            element_type == GI_TYPE_TAG_UINT8)) {
             GBytes* bytes = gjs_byte_array_get_bytes(array_obj);
             *contents = g_bytes_unref_to_data(bytes, length_p);
+        } else if (JS_IsTypedArrayObject(array_obj) &&
+                   typed_array_to_flat_struct_array(array_obj, param_info,
+                                                    contents, length_p)) {
+            // Copied in bulk; nothing else to do
         } else if (JS_HasPropertyById(context, array_obj, atoms.length(),
                                       &found_length) &&
                    found_length) {
@@ -2379,6 +2765,14 @@ gjs_array_from_g_list (JSContext             *context,
     return true;
 }
 
+bool gjs_value_from_g_list_element(JSContext* cx,
+                                   JS::MutableHandleValue value_p,
+                                   GITypeInfo* param_info, void* data) {
+    GArgument arg;
+    _g_type_info_argument_from_hash_pointer(param_info, data, &arg);
+    return gjs_value_from_g_argument(cx, value_p, param_info, &arg, true);
+}
+
 template <typename T, GITypeTag TAG = GI_TYPE_TAG_VOID>
 GJS_JSAPI_RETURN_CONVENTION static bool fill_vector_from_carray(
     JSContext* cx, JS::RootedValueVector& elems,  // NOLINT(runtime/references)
@@ -2393,6 +2787,58 @@ GJS_JSAPI_RETURN_CONVENTION static bool fill_vector_from_carray(
     return true;
 }
 
+// Creates a typed array holding a copy of a numeric C array, for namespaces
+// that opted in with imports._gi.set_typed_array_returns(). Returns false in
+// *handled if @element_type has no corresponding typed array type.
+GJS_JSAPI_RETURN_CONVENTION
+static bool typed_array_from_carray(JSContext* cx,
+                                    JS::MutableHandleValue value_p,
+                                    GITypeTag element_type, size_t length,
+                                    void* array, bool* handled) {
+    JS::RootedObject obj(cx);
+    *handled = true;
+
+    switch (element_type) {
+        case GI_TYPE_TAG_INT8:
+            obj = JS_NewInt8Array(cx, length);
+            break;
+        case GI_TYPE_TAG_INT16:
+            obj = JS_NewInt16Array(cx, length);
+            break;
+        case GI_TYPE_TAG_UINT16:
+            obj = JS_NewUint16Array(cx, length);
+            break;
+        case GI_TYPE_TAG_INT32:
+            obj = JS_NewInt32Array(cx, length);
+            break;
+        case GI_TYPE_TAG_UINT32:
+            obj = JS_NewUint32Array(cx, length);
+            break;
+        case GI_TYPE_TAG_FLOAT:
+            obj = JS_NewFloat32Array(cx, length);
+            break;
+        case GI_TYPE_TAG_DOUBLE:
+            obj = JS_NewFloat64Array(cx, length);
+            break;
+        default:
+            *handled = false;
+            return true;
+    }
+
+    if (!obj)
+        return false;
+
+    if (length > 0) {
+        JS::AutoCheckCannotGC nogc;
+        bool is_shared;
+        void* data = JS_GetArrayBufferViewData(obj, &is_shared, nogc);
+        memcpy(data, array, JS_GetArrayBufferViewByteLength(obj));
+    }
+
+    value_p.setObject(*obj);
+    return true;
+}
+
 GJS_JSAPI_RETURN_CONVENTION
 static bool
 gjs_array_from_carray_internal (JSContext             *context,
@@ -2433,6 +2879,28 @@ gjs_array_from_carray_internal (JSContext             *context,
         return true;
     }
 
+    if (GjsContextPrivate::from_cx(context)->typed_array_namespace(
+            g_base_info_get_namespace(param_info))) {
+        // Flat structs of one numeric type come back as one typed array with
+        // all their fields, rather than as one boxed wrapper per struct
+        unsigned n_fields;
+        GITypeTag flat_type = flat_struct_element_type(param_info, &n_fields);
+        bool handled;
+        if (flat_type != GI_TYPE_TAG_VOID) {
+            if (!typed_array_from_carray(context, value_p, flat_type,
+                                         size_t(length) * n_fields, array,
+                                         &handled))
+                return false;
+            if (handled)
+                return true;
+        }
+        if (!typed_array_from_carray(context, value_p, element_type, length,
+                                     array, &handled))
+            return false;
+        if (handled)
+            return true;
+    }
+
     JS::RootedValueVector elems(context);
     if (!elems.resize(length)) {
         JS_ReportOutOfMemory(context);
@@ -2770,8 +3238,7 @@ gjs_array_from_zero_terminated_c_array (JSContext             *context,
     return true;
 }
 
-GJS_JSAPI_RETURN_CONVENTION
-static bool
+bool
 gjs_object_from_g_hash (JSContext             *context,
                         JS::MutableHandleValue value_p,
                         GITypeInfo            *key_param_info,
@@ -2830,6 +3297,73 @@ gjs_object_from_g_hash (JSContext             *context,
     return true;
 }
 
+bool gjs_value_from_g_hash_lookup(JSContext* cx, JS::MutableHandleValue value_p,
+                                  GITypeInfo* key_param_info,
+                                  GITypeInfo* val_param_info, GHashTable* hash,
+                                  JS::HandleValue key, bool* found) {
+    // Same as the keys of the object from gjs_object_from_g_hash(), which are
+    // always strings
+    JS::RootedValue key_js(cx, key);
+    if (!key_js.isString() && !key_js.isInt32()) {
+        JS::RootedString str(cx, JS::ToString(cx, key_js));
+        if (!str)
+            return false;
+        key_js.setString(str);
+    }
+
+    void* key_pointer;
+    if (!value_to_ghashtable_key(cx, key_js, key_param_info, &key_pointer))
+        return false;
+
+    void* val_pointer;
+    *found = g_hash_table_lookup_extended(hash, key_pointer, nullptr,
+                                          &val_pointer);
+
+    GITypeTag key_tag = g_type_info_get_tag(key_param_info);
+    if (key_tag == GI_TYPE_TAG_UTF8 || key_tag == GI_TYPE_TAG_FILENAME)
+        g_free(key_pointer);
+
+    if (!*found) {
+        value_p.setUndefined();
+        return true;
+    }
+
+    GArgument valarg;
+    _g_type_info_argument_from_hash_pointer(val_param_info, val_pointer,
+                                            &valarg);
+    return gjs_value_from_g_argument(cx, value_p, val_param_info, &valarg,
+                                     true);
+}
+
+bool gjs_array_from_g_hash_keys(JSContext* cx, JS::MutableHandleValue value_p,
+                                GITypeInfo* key_param_info, GHashTable* hash) {
+    JS::RootedValueVector keys(cx);
+    if (!keys.reserve(g_hash_table_size(hash))) {
+        JS_ReportOutOfMemory(cx);
+        return false;
+    }
+
+    GHashTableIter iter;
+    void* key_pointer;
+    JS::RootedValue keyjs(cx);
+    GArgument keyarg;
+    g_hash_table_iter_init(&iter, hash);
+    while (g_hash_table_iter_next(&iter, &key_pointer, nullptr)) {
+        _g_type_info_argument_from_hash_pointer(key_param_info, key_pointer,
+                                                &keyarg);
+        if (!gjs_value_from_g_argument(cx, &keyjs, key_param_info, &keyarg,
+                                       true))
+            return false;
+        keys.infallibleAppend(keyjs);
+    }
+
+    JSObject* array = JS::NewArrayObject(cx, keys);
+    if (!array)
+        return false;
+    value_p.setObject(*array);
+    return true;
+}
+
 bool
 gjs_value_from_g_argument (JSContext             *context,
                            JS::MutableHandleValue value_p,
@@ -110,9 +110,35 @@ bool gjs_g_argument_release_in_arg (JSContext  *context,
 
 GJS_JSAPI_RETURN_CONVENTION
 bool _gjs_flags_value_is_valid(JSContext* cx, GType gtype, int64_t value);
+GJS_JSAPI_RETURN_CONVENTION
+bool _gjs_enum_gtype_value_is_valid(JSContext* cx, GType gtype, int64_t value);
 
 [[nodiscard]] int64_t _gjs_enum_from_int(GIEnumInfo* enum_info, int int_value);
 
+// Converts the data pointer of a GList or GSList node whose elements are
+// described by @param_info
+GJS_JSAPI_RETURN_CONVENTION
+bool gjs_value_from_g_list_element(JSContext* cx,
+                                   JS::MutableHandleValue value_p,
+                                   GITypeInfo* param_info, void* data);
+
+GJS_JSAPI_RETURN_CONVENTION
+bool gjs_object_from_g_hash(JSContext* cx, JS::MutableHandleValue value_p,
+                            GITypeInfo* key_param_info,
+                            GITypeInfo* val_param_info, GHashTable* hash);
+
+// Converts @key to a key of @hash, and the value stored under it (if any) to
+// @value_p, using the table's own hash and equality functions
+GJS_JSAPI_RETURN_CONVENTION
+bool gjs_value_from_g_hash_lookup(JSContext* cx, JS::MutableHandleValue value_p,
+                                  GITypeInfo* key_param_info,
+                                  GITypeInfo* val_param_info, GHashTable* hash,
+                                  JS::HandleValue key, bool* found);
+
+GJS_JSAPI_RETURN_CONVENTION
+bool gjs_array_from_g_hash_keys(JSContext* cx, JS::MutableHandleValue value_p,
+                                GITypeInfo* key_param_info, GHashTable* hash);
+
 GJS_JSAPI_RETURN_CONVENTION
 bool gjs_array_from_strv(JSContext             *context,
                          JS::MutableHandleValue value_p,
@@ -124,4 +150,10 @@ bool gjs_array_to_strv (JSContext   *context,
                         unsigned int length,
                         void       **arr_p);
 
+// Like gjs_array_to_strv(), but the pointers and the strings are in one block,
+// which must be freed with g_free() and not g_strfreev()
+GJS_JSAPI_RETURN_CONVENTION
+bool gjs_array_to_packed_strv(JSContext* cx, JS::HandleObject array,
+                              uint32_t length, char*** strv_out);
+
 #endif  // GI_ARG_H_
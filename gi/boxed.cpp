@@ -24,7 +24,7 @@
 #include <config.h>
 
 #include <stdint.h>
-#include <string.h>  // for memcpy, size_t, strcmp
+#include <string.h>  // for memcpy, memset, size_t, strcmp
 
 #include <string>       // for string
 #include <type_traits>  // for remove_reference
@@ -37,6 +37,7 @@
 #include <js/Class.h>
 #include <js/GCHashTable.h>  // for GCHashMap
 #include <js/GCVector.h>     // for MutableWrappedPtrOperations
+#include <js/MemoryFunctions.h>  // for AddAssociatedMemory, RemoveAssoci...
 #include <js/TracingAPI.h>
 #include <js/TypeDecls.h>
 #include <js/Value.h>
@@ -60,7 +61,8 @@
 BoxedInstance::BoxedInstance(JSContext* cx, JS::HandleObject obj)
     : GIWrapperInstance(cx, obj),
       m_allocated_directly(false),
-      m_owning_ptr(false) {
+      m_owning_ptr(false),
+      m_reported_memory(false) {
     m_ptr = nullptr;
     GJS_INC_COUNTER(boxed_instance);
 }
@@ -70,8 +72,8 @@ BoxedInstance::BoxedInstance(JSContext* cx, JS::HandleObject obj)
 // See GIWrapperBase::resolve().
 bool BoxedPrototype::resolve_impl(JSContext* cx, JS::HandleObject obj,
                                   JS::HandleId id, bool* resolved) {
-    JS::UniqueChars prop_name;
-    if (!gjs_get_string_id(cx, id, &prop_name))
+    const char* prop_name;
+    if (!gjs_get_interned_string_id(cx, id, &prop_name))
         return false;
     if (!prop_name) {
         *resolved = false;
@@ -80,7 +82,7 @@ bool BoxedPrototype::resolve_impl(JSContext* cx, JS::HandleObject obj,
 
     // Look for methods and other class properties
     GjsAutoFunctionInfo method_info =
-        g_struct_info_find_method(info(), prop_name.get());
+        g_struct_info_find_method(info(), prop_name);
     if (!method_info) {
         *resolved = false;
         return true;
@@ -105,10 +107,27 @@ bool BoxedPrototype::resolve_impl(JSContext* cx, JS::HandleObject obj,
     return true;
 }
 
-// See GIWrapperBase::new_enumerate().
+// See GIWrapperBase::new_enumerate(). The methods are listed once and then
+// copied from m_enumerated_ids.
 bool BoxedPrototype::new_enumerate_impl(JSContext* cx, JS::HandleObject,
                                         JS::MutableHandleIdVector properties,
                                         bool only_enumerable [[maybe_unused]]) {
+    if (m_enumerated_ids.valid()) {
+        m_cache_entry.touch();
+        return m_enumerated_ids.append_to(cx, properties);
+    }
+
+    size_t start = properties.length();
+    if (!enumerate_uncached(cx, properties) ||
+        !m_enumerated_ids.store(cx, properties, start))
+        return false;
+
+    m_cache_entry.used(cache_size());
+    return true;
+}
+
+bool BoxedPrototype::enumerate_uncached(JSContext* cx,
+                                        JS::MutableHandleIdVector properties) {
     int n_methods = g_struct_info_get_n_methods(info());
     for (int i = 0; i < n_methods; i++) {
         GjsAutoFunctionInfo meth_info = g_struct_info_get_method(info(), i);
@@ -155,12 +174,18 @@ BoxedBase* BoxedBase::get_copy_source(JSContext* context,
  * Allocate a boxed object of the correct size, set all the bytes to 0, and set
  * m_ptr to point to it. This is used when constructing a boxed object that can
  * be allocated directly (i.e., does not need to be created by a constructor
- * function.)
+ * function.) Small structs are stored in the instance itself.
  */
 void BoxedInstance::allocate_directly(void) {
     g_assert(get_prototype()->can_allocate_directly());
 
-    own_ptr(g_slice_alloc0(g_struct_info_get_size(info())));
+    size_t size = g_struct_info_get_size(info());
+    if (size <= INLINE_STORAGE_SIZE) {
+        memset(m_inline_storage, 0, size);
+        own_ptr(m_inline_storage);
+    } else {
+        own_ptr(g_slice_alloc0(size));
+    }
     m_allocated_directly = true;
 
     debug_lifecycle("Boxed pointer directly allocated");
@@ -204,9 +229,35 @@ BoxedPrototype::FieldMap* BoxedPrototype::create_field_map(
  * would be to create it when the prototype is created, in BoxedPrototype::init.
  */
 bool BoxedPrototype::ensure_field_map(JSContext* cx) {
+    if (m_field_map) {
+        m_cache_entry.touch();
+        return true;
+    }
+
+    m_field_map = create_field_map(cx, info());
     if (!m_field_map)
-        m_field_map = create_field_map(cx, info());
-    return !!m_field_map;
+        return false;
+
+    m_cache_entry.used(cache_size());
+    return true;
+}
+
+size_t BoxedPrototype::cache_size() const {
+    size_t size = m_enumerated_ids.size();
+    // The field infos are allocated along with the entries
+    if (m_field_map)
+        size += m_field_map->capacity() * sizeof(FieldMap::Entry) +
+                m_field_map->count() * sizeof(GIBaseInfo);
+    return size;
+}
+
+// The field map and the enumerated ids can be rebuilt from the introspection
+// info, so they are dropped when the caches are over budget.
+void BoxedPrototype::evict_caches(void* data) {
+    auto* priv = static_cast<BoxedPrototype*>(data);
+    delete priv->m_field_map;
+    priv->m_field_map = nullptr;
+    priv->m_enumerated_ids.clear();
 }
 
 /*
@@ -336,9 +387,11 @@ bool BoxedInstance::constructor_impl(JSContext* context, JS::HandleObject obj,
 
         if (g_type_is_a(gtype(), G_TYPE_BOXED)) {
             copy_boxed(source_priv->to_instance());
+            report_owned_memory(obj);
             return true;
         } else if (get_prototype()->can_allocate_directly()) {
             copy_memory(source_priv->to_instance());
+            report_owned_memory(obj);
             return true;
         }
     }
@@ -420,6 +473,8 @@ bool BoxedInstance::constructor_impl(JSContext* context, JS::HandleObject obj,
         return false;
     }
 
+    report_owned_memory(obj);
+
     /* If we reach this code, we need to init from a map of fields */
 
     if (args.length() == 0)
@@ -435,10 +490,50 @@ bool BoxedInstance::constructor_impl(JSContext* context, JS::HandleObject obj,
     return init_from_props(context, args[0]);
 }
 
+/*
+ * BoxedInstance::owned_memory_size:
+ *
+ * Size of the C memory that this instance owns, as far as we know it, or 0 if
+ * it owns none.
+ */
+size_t BoxedInstance::owned_memory_size() const {
+    if (!m_owning_ptr || !info())
+        return 0;
+    return g_struct_info_get_size(info());
+}
+
+/*
+ * BoxedInstance::report_owned_memory:
+ *
+ * Tells the JS engine how much C memory the wrapper @obj keeps alive, so that
+ * its GC heuristics take it into account. Call this once the pointer has been
+ * set up; finalize_impl() takes it back.
+ */
+void BoxedInstance::report_owned_memory(JSObject* obj) {
+    size_t size = owned_memory_size();
+    if (m_reported_memory || size == 0)
+        return;
+
+    JS::AddAssociatedMemory(obj, size, MemoryUse::BoxedStruct);
+    GJS_INC_COUNTER_BYTES(boxed_instance, size);
+    m_reported_memory = true;
+}
+
+void BoxedInstance::finalize_impl(JSFreeOp* fop, JSObject* obj) {
+    if (m_reported_memory) {
+        size_t size = owned_memory_size();
+        JS::RemoveAssociatedMemory(obj, size, MemoryUse::BoxedStruct);
+        GJS_DEC_COUNTER_BYTES(boxed_instance, size);
+    }
+
+    GIWrapperInstance::finalize_impl(fop, obj);
+}
+
 BoxedInstance::~BoxedInstance() {
     if (m_owning_ptr) {
         if (m_allocated_directly) {
-            g_slice_free1(g_struct_info_get_size(info()), m_ptr);
+            if (m_ptr != m_inline_storage)
+                g_slice_free1(g_struct_info_get_size(info()), m_ptr);
         } else {
             if (g_type_is_a(gtype(), G_TYPE_BOXED))
                 g_boxed_free(gtype(), m_ptr);
@@ -546,6 +641,12 @@ bool BoxedBase::field_getter(JSContext* context, unsigned argc, JS::Value* vp) {
 
     uint32_t field_ix = gjs_dynamic_property_private_slot(&args.callee())
         .toPrivateUint32();
+    const BoxedDirectField* direct_field =
+        priv->get_prototype()->direct_field(field_ix);
+    if (direct_field && direct_field->readable)
+        return priv->to_instance()->direct_field_getter(context, *direct_field,
+                                                        args.rval());
+
     GjsAutoFieldInfo field_info = priv->get_field_info(context, field_ix);
     if (!field_info)
         return false;
@@ -554,6 +655,32 @@ bool BoxedBase::field_getter(JSContext* context, unsigned argc, JS::Value* vp) {
                                                   args.rval());
 }
 
+// Fast path of BoxedBase::field_getter() for fields of basic types. The value
+// is copied into the start of the GIArgument, which is where the union member
+// of that size is, just like g_field_info_get_field() would do.
+bool BoxedInstance::direct_field_getter(JSContext* cx,
+                                        const BoxedDirectField& field,
+                                        JS::MutableHandleValue rval) const {
+    GIArgument arg;
+    memcpy(&arg, raw_ptr() + field.offset, field.size);
+    return gjs_value_from_g_argument(cx, rval, field.type_info, &arg, true);
+}
+
+// Fast path of BoxedBase::field_setter() for fields of basic types, which need
+// no releasing after conversion.
+bool BoxedInstance::direct_field_setter(JSContext* cx,
+                                        const BoxedDirectField& field,
+                                        JS::HandleValue value) {
+    GIArgument arg;
+    if (!gjs_value_to_g_argument(cx, value, field.type_info, field.name,
+                                 GJS_ARGUMENT_FIELD, GI_TRANSFER_NOTHING, true,
+                                 &arg))
+        return false;
+
+    memcpy(raw_ptr() + field.offset, &arg, field.size);
+    return true;
+}
+
 // See BoxedBase::field_getter().
 bool BoxedInstance::field_getter_impl(JSContext* cx, JSObject* obj,
                                       GIFieldInfo* field_info,
@@ -694,6 +821,16 @@ bool BoxedBase::field_setter(JSContext* cx, unsigned argc, JS::Value* vp) {
 
     uint32_t field_ix = gjs_dynamic_property_private_slot(&args.callee())
         .toPrivateUint32();
+    const BoxedDirectField* direct_field =
+        priv->get_prototype()->direct_field(field_ix);
+    if (direct_field && direct_field->writable) {
+        if (!priv->to_instance()->direct_field_setter(cx, *direct_field,
+                                                      args[0]))
+            return false;
+        args.rval().setUndefined();
+        return true;
+    }
+
     GjsAutoFieldInfo field_info = priv->get_field_info(cx, field_ix);
     if (!field_info)
         return false;
@@ -705,6 +842,52 @@ bool BoxedBase::field_setter(JSContext* cx, unsigned argc, JS::Value* vp) {
     return true;
 }
 
+// Size of the storage of a field with a basic type, or 0 if the field isn't
+// stored as a plain number
+[[nodiscard]] static uint8_t direct_field_size(GITypeInfo* type_info) {
+    if (g_type_info_is_pointer(type_info))
+        return 0;
+
+    switch (g_type_info_get_tag(type_info)) {
+        case GI_TYPE_TAG_BOOLEAN:
+            return sizeof(gboolean);
+        case GI_TYPE_TAG_INT8:
+        case GI_TYPE_TAG_UINT8:
+            return 1;
+        case GI_TYPE_TAG_INT16:
+        case GI_TYPE_TAG_UINT16:
+            return 2;
+        case GI_TYPE_TAG_INT32:
+        case GI_TYPE_TAG_UINT32:
+        case GI_TYPE_TAG_UNICHAR:
+        case GI_TYPE_TAG_FLOAT:
+            return 4;
+        case GI_TYPE_TAG_INT64:
+        case GI_TYPE_TAG_UINT64:
+        case GI_TYPE_TAG_DOUBLE:
+            return 8;
+        case GI_TYPE_TAG_GTYPE:
+            return sizeof(GType);
+        default:
+            return 0;
+    }
+}
+
+BoxedDirectField BoxedDirectField::describe(GIFieldInfo* field) {
+    GjsAutoTypeInfo type_info = g_field_info_get_type(field);
+    GIFieldInfoFlags flags = g_field_info_get_flags(field);
+
+    // Bitfields are left to g_field_info_get_field()
+    uint8_t size = g_field_info_get_size(field) == 0
+                       ? direct_field_size(type_info)
+                       : 0;
+
+    return {std::move(type_info), g_base_info_get_name(field),
+            unsigned(g_field_info_get_offset(field)), size,
+            (flags & GI_FIELD_IS_READABLE) != 0,
+            (flags & GI_FIELD_IS_WRITABLE) != 0};
+}
+
 /*
  * BoxedPrototype::define_boxed_class_fields:
  *
@@ -731,8 +914,11 @@ bool BoxedPrototype::define_boxed_class_fields(JSContext* cx,
      * as well if doing it ahead of time caused to much start-up
      * memory overhead.
      */
+    m_direct_fields.clear();
+    m_direct_fields.reserve(n_fields);
     for (i = 0; i < n_fields; i++) {
         GjsAutoFieldInfo field = g_struct_info_get_field(info(), i);
+        m_direct_fields.push_back(BoxedDirectField::describe(field));
         JS::RootedValue private_id(cx, JS::PrivateUint32Value(i));
         if (!gjs_define_property_dynamic(cx, proto, field.name(), "boxed_field",
                                          &BoxedBase::field_getter,
@@ -750,6 +936,7 @@ void BoxedPrototype::trace_impl(JSTracer* trc) {
                         "Boxed::default_constructor_name");
     if (m_field_map)
         m_field_map->trace(trc);
+    m_enumerated_ids.trace(trc);
 }
 
 // clang-format off
@@ -901,6 +1088,7 @@ BoxedPrototype::BoxedPrototype(GIStructInfo* info, GType gtype)
       m_default_constructor(-1),
       m_default_constructor_name(JSID_VOID),
       m_field_map(nullptr),
+      m_cache_entry(&BoxedPrototype::evict_caches, this),
       m_can_allocate_directly(struct_is_simple(info)) {
     GJS_INC_COUNTER(boxed_prototype);
 }
@@ -1002,6 +1190,18 @@ JSObject* BoxedInstance::new_for_c_struct_impl(JSContext* cx,
     if (gboxed == NULL)
         return NULL;
 
+    // Copying a reference-counted boxed only takes a reference, so a wrapper
+    // made from the same pointer earlier, if still alive, holds the same
+    // thing and can be returned again instead of a new one
+    GjsContextPrivate* gjs = GjsContextPrivate::from_cx(cx);
+    if (auto p = gjs->boxed_table().lookup(gboxed)) {
+        JS::RootedObject cached(cx, p->value());
+        BoxedBase* cached_priv = BoxedBase::for_js(cx, cached);
+        if (cached_priv && cached_priv->gtype() ==
+                               g_registered_type_info_get_g_type(info))
+            return cached;
+    }
+
     gjs_debug_marshal(GJS_DEBUG_GBOXED,
                       "Wrapping struct %s %p with JSObject",
                       g_base_info_get_name((GIBaseInfo *)info), gboxed);
@@ -1016,6 +1216,13 @@ JSObject* BoxedInstance::new_for_c_struct_impl(JSContext* cx,
 
     if (!priv->init_from_c_struct(cx, gboxed, std::forward<Args>(args)...))
         return nullptr;
+    priv->report_owned_memory(obj);
+
+    if (priv->m_owning_ptr && priv->ptr() == gboxed &&
+        !gjs->boxed_table().put(gboxed, obj)) {
+        JS_ReportOutOfMemory(cx);
+        return nullptr;
+    }
 
     if (priv->gtype() == G_TYPE_ERROR && !gjs_define_error_properties(cx, obj))
         return nullptr;
@@ -26,8 +26,11 @@
 
 #include <config.h>
 
+#include <stddef.h>  // for max_align_t
 #include <stdint.h>
 
+#include <vector>
+
 #include <girepository.h>
 #include <glib-object.h>
 #include <glib.h>
@@ -39,6 +42,7 @@
 #include <mozilla/HashTable.h>  // for DefaultHasher
 
 #include "gi/wrapperutils.h"
+#include "cjs/cache-budget.h"
 #include "cjs/jsapi-util.h"
 #include "cjs/macros.h"
 #include "util/log.h"
@@ -93,6 +97,21 @@ class BoxedBase
                                              JS::Value value) const;
 };
 
+// A field of a number or boolean type, described once when the class is
+// defined, so that its getter and setter can access the struct memory directly
+// instead of looking the field up in the typelib each time. Also used for the
+// fields of unions.
+struct BoxedDirectField {
+    GjsAutoTypeInfo type_info;
+    const char* name;
+    unsigned offset;
+    uint8_t size;  // 0 if the field can't be accessed directly
+    bool readable : 1;
+    bool writable : 1;
+
+    [[nodiscard]] static BoxedDirectField describe(GIFieldInfo* field);
+};
+
 class BoxedPrototype : public GIWrapperPrototype<BoxedBase, BoxedPrototype,
                                                  BoxedInstance, GIStructInfo> {
     friend class GIWrapperPrototype<BoxedBase, BoxedPrototype, BoxedInstance,
@@ -107,6 +126,11 @@ class BoxedPrototype : public GIWrapperPrototype<BoxedBase, BoxedPrototype,
     int m_default_constructor;  // -1 if none
     JS::Heap<jsid> m_default_constructor_name;
     FieldMap* m_field_map;
+    GjsEnumeratedIds m_enumerated_ids;
+    // The field map and enumerated ids are rebuilt as they are used, so they
+    // are emptied if they go over the cache budget
+    GjsCacheEntry m_cache_entry;
+    std::vector<BoxedDirectField> m_direct_fields;
     bool m_can_allocate_directly : 1;
 
     explicit BoxedPrototype(GIStructInfo* info, GType gtype);
@@ -122,6 +146,11 @@ class BoxedPrototype : public GIWrapperPrototype<BoxedBase, BoxedPrototype,
     [[nodiscard]] bool can_allocate_directly() const {
         return m_can_allocate_directly;
     }
+    [[nodiscard]] const BoxedDirectField* direct_field(uint32_t ix) const {
+        if (ix >= m_direct_fields.size() || m_direct_fields[ix].size == 0)
+            return nullptr;
+        return &m_direct_fields[ix];
+    }
     [[nodiscard]] bool has_zero_args_constructor() const {
         return m_zero_args_constructor >= 0;
     }
@@ -148,6 +177,9 @@ class BoxedPrototype : public GIWrapperPrototype<BoxedBase, BoxedPrototype,
     bool new_enumerate_impl(JSContext* cx, JS::HandleObject obj,
                             JS::MutableHandleIdVector properties,
                             bool only_enumerable);
+    GJS_JSAPI_RETURN_CONVENTION
+    bool enumerate_uncached(JSContext* cx,
+                            JS::MutableHandleIdVector properties);
     void trace_impl(JSTracer* trc);
 
     // Helper methods
@@ -156,6 +188,8 @@ class BoxedPrototype : public GIWrapperPrototype<BoxedBase, BoxedPrototype,
     static FieldMap* create_field_map(JSContext* cx, GIStructInfo* struct_info);
     GJS_JSAPI_RETURN_CONVENTION
     bool ensure_field_map(JSContext* cx);
+    [[nodiscard]] size_t cache_size() const;
+    static void evict_caches(void* data);
     GJS_JSAPI_RETURN_CONVENTION
     bool define_boxed_class_fields(JSContext* cx, JS::HandleObject proto);
 
@@ -173,9 +207,18 @@ class BoxedInstance
     friend class GIWrapperBase<BoxedBase, BoxedPrototype, BoxedInstance>;
     friend class BoxedBase;  // for field_getter, etc.
 
+    static constexpr bool use_slab_allocator = true;
+
     bool m_allocated_directly : 1;
     bool m_owning_ptr : 1;  // if set, the JS wrapper owns the C memory referred
                             // to by m_ptr.
+    bool m_reported_memory : 1;  // if set, the size of the owned memory has
+                                 // been reported to the JS engine
+
+    // Directly allocated structs up to this size, such as colors, points and
+    // rectangles, are kept here instead of in a separate allocation
+    static constexpr size_t INLINE_STORAGE_SIZE = 32;
+    alignas(max_align_t) uint8_t m_inline_storage[INLINE_STORAGE_SIZE];
 
     explicit BoxedInstance(JSContext* cx, JS::HandleObject obj);
     ~BoxedInstance(void);
@@ -193,6 +236,9 @@ class BoxedInstance
         m_owning_ptr = false;
     }
 
+    [[nodiscard]] size_t owned_memory_size() const;
+    void report_owned_memory(JSObject* obj);
+
     // Methods for different ways to allocate the GBoxed pointer
 
     void allocate_directly(void);
@@ -227,6 +273,12 @@ class BoxedInstance
     GJS_JSAPI_RETURN_CONVENTION
     bool field_setter_impl(JSContext* cx, GIFieldInfo* info,
                            JS::HandleValue value);
+    GJS_JSAPI_RETURN_CONVENTION
+    bool direct_field_getter(JSContext* cx, const BoxedDirectField& field,
+                             JS::MutableHandleValue rval) const;
+    GJS_JSAPI_RETURN_CONVENTION
+    bool direct_field_setter(JSContext* cx, const BoxedDirectField& field,
+                             JS::HandleValue value);
 
     // JS constructor
 
@@ -234,6 +286,10 @@ class BoxedInstance
     bool constructor_impl(JSContext* cx, JS::HandleObject obj,
                           const JS::CallArgs& args);
 
+    // JSClass operations
+
+    void finalize_impl(JSFreeOp* fop, JSObject* obj);
+
     // Public API for initializing BoxedInstance JS object from C struct
 
  public:
@@ -0,0 +1,162 @@
+/* -*- mode: C++; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * SPDX-License-Identifier: MIT OR LGPL-2.0-or-later
+ */
+
+#include <config.h>
+
+#include <stddef.h>  // for size_t
+#include <stdint.h>
+
+#include <algorithm>  // for sort
+#include <array>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <glib.h>
+
+#include <js/Array.h>  // for NewArrayObject
+#include <js/PropertyDescriptor.h>  // for JSPROP_ENUMERATE
+#include <js/RootingAPI.h>
+#include <js/TypeDecls.h>
+#include <js/Value.h>
+#include <jsapi.h>  // for JS_NewPlainObject, JS_DefineProperty
+
+#include "gi/call-stats.h"
+#include "cjs/jsapi-util.h"
+
+// Nodes of an unordered_map don't move when it grows, so the pointers handed
+// out by gjs_call_stats_lookup() stay valid
+static thread_local std::unordered_map<std::string, GjsCallStats> s_call_stats;
+
+using MarshalPhaseStats = std::array<GjsCallStats, 4>;
+static thread_local std::unordered_map<std::string_view, MarshalPhaseStats>
+    s_marshal_stats;
+
+static const char* const phase_names[] = {"in", "out", "release", "call"};
+
+bool gjs_call_stats_enabled() {
+    static const bool enabled = g_getenv("GJS_CALL_STATS");
+    return enabled;
+}
+
+bool gjs_marshal_stats_enabled() {
+    static const bool enabled = g_getenv("GJS_MARSHAL_STATS");
+    return enabled;
+}
+
+GjsCallStats* gjs_call_stats_lookup(const char* name) {
+    if (!gjs_call_stats_enabled())
+        return nullptr;
+    return &s_call_stats[name];
+}
+
+GjsCallStats* gjs_marshal_stats_lookup(const char* kind,
+                                       GjsMarshalPhase phase) {
+    if (!gjs_marshal_stats_enabled())
+        return nullptr;
+    return &s_marshal_stats[kind][size_t(phase)];
+}
+
+struct StatsEntry {
+    const char* name;
+    const char* phase;
+    const GjsCallStats* stats;
+};
+
+// The entries that took the most time go first
+static void sort_entries(std::vector<StatsEntry>* sorted) {
+    std::sort(sorted->begin(), sorted->end(),
+              [](const StatsEntry& a, const StatsEntry& b) {
+                  return a.stats->total_ns > b.stats->total_ns;
+              });
+}
+
+bool gjs_call_stats_define_properties(JSContext* cx, const GjsCallStats& stats,
+                                      JS::HandleObject obj) {
+    JS::RootedValue value(cx);
+    value.setNumber(static_cast<double>(stats.calls));
+    if (!JS_DefineProperty(cx, obj, "calls", value, JSPROP_ENUMERATE))
+        return false;
+
+    value.setNumber(static_cast<double>(stats.total_ns));
+    if (!JS_DefineProperty(cx, obj, "time", value, JSPROP_ENUMERATE))
+        return false;
+
+    JS::RootedObject histogram(cx,
+                               JS::NewArrayObject(cx, GjsCallStats::N_BUCKETS));
+    if (!histogram)
+        return false;
+    for (unsigned bucket = 0; bucket < GjsCallStats::N_BUCKETS; bucket++) {
+        value.setNumber(static_cast<double>(stats.histogram[bucket]));
+        if (!JS_DefineElement(cx, histogram, bucket, value, JSPROP_ENUMERATE))
+            return false;
+    }
+
+    return JS_DefineProperty(cx, obj, "histogram", histogram,
+                             JSPROP_ENUMERATE);
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool entries_to_js(JSContext* cx, const std::vector<StatsEntry>& entries,
+                          const char* name_prop, JS::MutableHandleValue rval) {
+    JS::RootedObject array(cx, JS::NewArrayObject(cx, entries.size()));
+    if (!array)
+        return false;
+
+    JS::RootedObject item(cx);
+    JS::RootedValue value(cx);
+    for (size_t ix = 0; ix < entries.size(); ix++) {
+        const StatsEntry& entry = entries[ix];
+        item = JS_NewPlainObject(cx);
+        if (!item || !gjs_string_from_utf8(cx, entry.name, &value) ||
+            !JS_DefineProperty(cx, item, name_prop, value, JSPROP_ENUMERATE))
+            return false;
+
+        if (entry.phase &&
+            (!gjs_string_from_utf8(cx, entry.phase, &value) ||
+             !JS_DefineProperty(cx, item, "phase", value, JSPROP_ENUMERATE)))
+            return false;
+
+        if (!gjs_call_stats_define_properties(cx, *entry.stats, item) ||
+            !JS_DefineElement(cx, array, ix, item, JSPROP_ENUMERATE))
+            return false;
+    }
+
+    rval.setObject(*array);
+    return true;
+}
+
+bool gjs_call_stats_to_js(JSContext* cx, JS::MutableHandleValue rval) {
+    std::vector<StatsEntry> sorted;
+    sorted.reserve(s_call_stats.size());
+    for (const auto& entry : s_call_stats) {
+        if (entry.second.calls > 0)
+            sorted.push_back({entry.first.c_str(), nullptr, &entry.second});
+    }
+    sort_entries(&sorted);
+    return entries_to_js(cx, sorted, "name", rval);
+}
+
+bool gjs_marshal_stats_to_js(JSContext* cx, JS::MutableHandleValue rval) {
+    std::vector<StatsEntry> sorted;
+    for (const auto& entry : s_marshal_stats) {
+        // The keys are views of string literals, so they are 0-terminated
+        for (size_t phase = 0; phase < entry.second.size(); phase++) {
+            if (entry.second[phase].calls > 0)
+                sorted.push_back({entry.first.data(), phase_names[phase],
+                                  &entry.second[phase]});
+        }
+    }
+    sort_entries(&sorted);
+    return entries_to_js(cx, sorted, "kind", rval);
+}
+
+void gjs_call_stats_reset() {
+    // The entries can't be removed, because functions point to them
+    for (auto& entry : s_call_stats)
+        entry.second = {};
+    s_marshal_stats.clear();
+}
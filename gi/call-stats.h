@@ -0,0 +1,106 @@
+/* -*- mode: C++; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * SPDX-License-Identifier: MIT OR LGPL-2.0-or-later
+ */
+
+#ifndef GI_CALL_STATS_H_
+#define GI_CALL_STATS_H_
+
+#include <config.h>
+
+#include <stdint.h>
+
+#include <chrono>
+
+#include <glib.h>  // for g_bit_storage
+
+#include <js/TypeDecls.h>
+
+#include "cjs/macros.h"
+
+// Call counts and cumulative time of one introspected function or signal
+// handler, or of one phase of a kind of argument marshallers. Only collected if
+// GJS_CALL_STATS or GJS_MARSHAL_STATS is set in the environment, since then
+// every call reads the clock twice. The counters belong to the JS thread, so
+// they are plain integers without any locking.
+struct GjsCallStats {
+    // Bucket 0 counts calls that took less than 256 ns, and each following
+    // bucket covers twice as long a range as the previous one. The last bucket
+    // counts everything from 2^22 ns (about 4 ms) up.
+    static constexpr unsigned N_BUCKETS = 16;
+
+    uint64_t calls = 0;
+    uint64_t total_ns = 0;
+    uint64_t histogram[N_BUCKETS] = {};
+
+    void add(uint64_t ns) {
+        calls++;
+        total_ns += ns;
+        unsigned bits = g_bit_storage(ns);
+        unsigned bucket = bits > 8 ? bits - 8 : 0;
+        histogram[bucket < N_BUCKETS ? bucket : N_BUCKETS - 1]++;
+    }
+};
+
+[[nodiscard]] bool gjs_call_stats_enabled();
+
+// Returns the counters for @name, which stay at the same address until the
+// thread exits, or nullptr if call statistics are not being collected. Meant
+// to be called once, when the function is set up, not on every call.
+[[nodiscard]] GjsCallStats* gjs_call_stats_lookup(const char* name);
+
+// Counts one call, timed from construction to destruction, if @stats is not
+// null.
+class GjsAutoCallTimer {
+    using Clock = std::chrono::steady_clock;
+
+    GjsCallStats* m_stats;
+    Clock::time_point m_start;
+
+ public:
+    explicit GjsAutoCallTimer(GjsCallStats* stats) : m_stats(stats) {
+        if (m_stats)
+            m_start = Clock::now();
+    }
+
+    ~GjsAutoCallTimer() {
+        if (!m_stats)
+            return;
+        auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            Clock::now() - m_start);
+        m_stats->add(elapsed.count());
+    }
+
+    GjsAutoCallTimer(const GjsAutoCallTimer&) = delete;
+    GjsAutoCallTimer& operator=(const GjsAutoCallTimer&) = delete;
+};
+
+// The phases of an introspected function call whose time is collected for
+// each kind of argument marshallers, if GJS_MARSHAL_STATS is set. CALL is the
+// C function itself, for comparison.
+enum class GjsMarshalPhase : uint8_t { IN, OUT, RELEASE, CALL };
+
+[[nodiscard]] bool gjs_marshal_stats_enabled();
+
+// Unlike gjs_call_stats_lookup(), cheap enough to call on every call; @kind
+// must be a string that lives forever, such as GjsArgumentMarshallers::kind.
+[[nodiscard]] GjsCallStats* gjs_marshal_stats_lookup(const char* kind,
+                                                     GjsMarshalPhase phase);
+
+// Defines the calls, time (in nanoseconds) and histogram properties of @obj
+GJS_JSAPI_RETURN_CONVENTION
+bool gjs_call_stats_define_properties(JSContext* cx, const GjsCallStats& stats,
+                                      JS::HandleObject obj);
+
+// Returns an array of {name, calls, time, histogram} objects, time in
+// nanoseconds, with the functions that took the most time first
+GJS_JSAPI_RETURN_CONVENTION
+bool gjs_call_stats_to_js(JSContext* cx, JS::MutableHandleValue rval);
+
+// Likewise, with {kind, phase, calls, time, histogram} objects
+GJS_JSAPI_RETURN_CONVENTION
+bool gjs_marshal_stats_to_js(JSContext* cx, JS::MutableHandleValue rval);
+
+void gjs_call_stats_reset();
+
+#endif  // GI_CALL_STATS_H_
@@ -23,10 +23,14 @@
 
 #include <config.h>
 
+#include <stdint.h>
+#include <stdlib.h>  // for exit
+
 #include <glib.h>
 
 #include <new>
 
+#include <js/Conversions.h>
 #include <js/RootingAPI.h>
 #include <js/TypeDecls.h>
 #include <js/ValueArray.h>
@@ -34,6 +38,7 @@
 
 #include "gi/closure.h"
 #include "cjs/context-private.h"
+#include "cjs/context.h"
 #include "cjs/jsapi-util-root.h"
 #include "cjs/jsapi-util.h"
 #include "cjs/mem-private.h"
@@ -241,6 +246,45 @@ gjs_closure_invoke(GClosure                   *closure,
     return true;
 }
 
+gboolean gjs_closure_source_func(void* data) {
+    auto* closure = static_cast<GClosure*>(data);
+
+    if (G_UNLIKELY(!gjs_closure_is_valid(closure))) {
+        g_critical(
+            "Attempting to run a JS source callback during shutdown. Because "
+            "it would crash the application, it has been blocked.");
+        return G_SOURCE_REMOVE;
+    }
+
+    JSContext* cx = gjs_closure_get_context(closure);
+    GjsContextPrivate* gjs = GjsContextPrivate::from_cx(cx);
+    if (G_UNLIKELY(gjs->sweeping() || !gjs->is_owner_thread())) {
+        g_critical(
+            "Attempting to run a JS source callback during garbage collection "
+            "or on a different thread. Because it would crash the application, "
+            "it has been blocked.");
+        gjs_dumpstack();
+        return G_SOURCE_REMOVE;
+    }
+
+    JS::RootedValue rval(cx);
+    if (!gjs_closure_invoke(closure, nullptr, JS::HandleValueArray::empty(),
+                            &rval, false)) {
+        // Same as a callback trampoline: an uncatchable exception means we
+        // have to exit here, otherwise remove the source
+        uint8_t code;
+        if (!JS_IsExceptionPending(cx) && gjs->should_exit(&code))
+            exit(code);
+        return G_SOURCE_REMOVE;
+    }
+
+    return JS::ToBoolean(rval);
+}
+
+void gjs_closure_source_destroy_notify(void* data) {
+    g_closure_unref(static_cast<GClosure*>(data));
+}
+
 bool
 gjs_closure_is_valid(GClosure *closure)
 {
@@ -52,4 +52,10 @@ class HandleValueArray;
 void       gjs_closure_trace         (GClosure     *closure,
                                       JSTracer     *tracer);
 
+// GSourceFunc and matching GDestroyNotify that call a GjsClosure passed as the
+// user data directly, for GLib.SourceFunc callbacks that don't need a
+// callback trampoline
+gboolean gjs_closure_source_func(void* data);
+void gjs_closure_source_destroy_notify(void* data);
+
 #endif  // GI_CLOSURE_H_
@@ -27,56 +27,37 @@
 #include <glib-object.h>
 #include <glib.h>
 
+#include <vector>
+
+#include <js/GCVector.h>  // for MutableWrappedPtrOperations
+#include <js/Id.h>  // for INTERNED_STRING_TO_JSID
+#include <js/PropertyDescriptor.h>  // for JSPROP_READONLY
 #include <js/RootingAPI.h>
 #include <js/TypeDecls.h>
-#include <jsapi.h>  // for JS_DefineProperty, JS_NewPlainObject
+#include <jsapi.h>  // for JS_DefinePropertyById, JS_AtomizeAndPinString
 
 #include "gi/enumeration.h"
 #include "gi/wrapperutils.h"
 #include "cjs/jsapi-util.h"
 #include "util/log.h"
 
-GJS_JSAPI_RETURN_CONVENTION
-static bool
-gjs_define_enum_value(JSContext       *context,
-                      JS::HandleObject in_object,
-                      GIValueInfo     *info)
-{
-    const char *value_name;
-    char *fixed_name;
-    gsize i;
-    gint64 value_val;
-
-    value_name = g_base_info_get_name( (GIBaseInfo*) info);
-    value_val = g_value_info_get_value(info);
-
-    /* g-i converts enum members such as GDK_GRAVITY_SOUTH_WEST to
-     * Gdk.GravityType.south-west (where 'south-west' is value_name)
-     * Convert back to all SOUTH_WEST.
-     */
-    fixed_name = g_ascii_strup(value_name, -1);
-    for (i = 0; fixed_name[i]; ++i) {
-        char c = fixed_name[i];
-        if (!(('A' <= c && c <= 'Z') ||
-              ('0' <= c && c <= '9')))
-            fixed_name[i] = '_';
-    }
-
-    gjs_debug(GJS_DEBUG_GENUM,
-              "Defining enum value %s (fixed from %s) %" G_GINT64_MODIFIER "d",
-              fixed_name, value_name, value_val);
+/* Enum and flags values never change once defined, so they are read-only and
+ * permanent. Non-writable, non-configurable data properties let the JIT treat
+ * e.g. Clutter.AnimationMode.EASE_OUT_QUAD as a constant in hot code. */
+#define GJS_ENUM_VALUE_PROP_FLAGS (GJS_MODULE_PROP_FLAGS | JSPROP_READONLY)
 
-    if (!JS_DefineProperty(context, in_object,
-                           fixed_name, (double) value_val,
-                           GJS_MODULE_PROP_FLAGS)) {
-        gjs_throw(context, "Unable to define enumeration value %s %" G_GINT64_FORMAT " (no memory most likely)",
-                  fixed_name, value_val);
-        g_free(fixed_name);
-        return false;
+/* g-i converts enum members such as GDK_GRAVITY_SOUTH_WEST to
+ * Gdk.GravityType.south-west (where 'south-west' is value_name)
+ * Convert back to all SOUTH_WEST.
+ */
+[[nodiscard]] static GjsAutoChar gjs_fix_enum_value_name(
+    const char* value_name) {
+    GjsAutoChar fixed_name = g_ascii_strup(value_name, -1);
+    for (char* c = fixed_name.get(); *c; ++c) {
+        if (!(('A' <= *c && *c <= 'Z') || ('0' <= *c && *c <= '9')))
+            *c = '_';
     }
-    g_free(fixed_name);
-
-    return true;
+    return fixed_name;
 }
 
 bool
@@ -86,19 +67,46 @@ gjs_define_enum_values(JSContext       *context,
 {
     int i, n_values;
 
-    /* Fill in enum values first, so we don't define the enum itself until we're
-     * sure we can finish successfully.
+    /* Atomize all the value names before defining anything, so that the
+     * properties are added back to back in a single pass with no allocation
+     * of intermediate strings in between; and so we don't define any values
+     * unless we're sure we can finish successfully.
      */
     n_values = g_enum_info_get_n_values(info);
+    JS::Rooted<JS::IdVector> ids(context, context);
+    if (!ids.reserve(n_values)) {
+        JS_ReportOutOfMemory(context);
+        return false;
+    }
+    std::vector<double> values;
+    values.reserve(n_values);
+
     for (i = 0; i < n_values; ++i) {
-        GIValueInfo *value_info = g_enum_info_get_value(info, i);
-        bool failed;
+        GjsAutoValueInfo value_info = g_enum_info_get_value(info, i);
+        gint64 value_val = g_value_info_get_value(value_info);
+        GjsAutoChar fixed_name = gjs_fix_enum_value_name(value_info.name());
 
-        failed = !gjs_define_enum_value(context, in_object, value_info);
+        gjs_debug(GJS_DEBUG_GENUM,
+                  "Defining enum value %s (fixed from %s) %" G_GINT64_MODIFIER
+                  "d",
+                  fixed_name.get(), value_info.name(), value_val);
 
-        g_base_info_unref( (GIBaseInfo*) value_info);
+        JSString* atom = JS_AtomizeAndPinString(context, fixed_name);
+        if (!atom)
+            return false;
+        ids.infallibleAppend(INTERNED_STRING_TO_JSID(context, atom));
+        values.push_back(static_cast<double>(value_val));
+    }
 
-        if (failed) {
+    JS::RootedId id(context);
+    for (i = 0; i < n_values; ++i) {
+        id = ids[i];
+        if (!JS_DefinePropertyById(context, in_object, id, values[i],
+                                   GJS_ENUM_VALUE_PROP_FLAGS)) {
+            gjs_throw(context,
+                      "Unable to define enumeration value %s %f (no memory "
+                      "most likely)",
+                      gjs_debug_id(ids[i]).c_str(), values[i]);
             return false;
         }
     }
@@ -60,6 +60,10 @@ typedef struct {
 void gjs_struct_foreign_register(const char* gi_namespace,
                                  const char* type_name, GjsForeignInfo* info);
 
+GJS_JSAPI_RETURN_CONVENTION
+GjsForeignInfo* gjs_struct_foreign_lookup(JSContext* cx,
+                                          GIStructInfo* interface_info);
+
 GJS_JSAPI_RETURN_CONVENTION
 bool  gjs_struct_foreign_convert_to_g_argument   (JSContext      *context,
                                                   JS::Value       value,
@@ -27,8 +27,13 @@
 #include <stdlib.h>  // for exit
 #include <string.h>  // for strcmp, memset, size_t
 
+#include <algorithm>  // for find
+#include <functional>  // for hash
 #include <new>
 #include <string>
+#include <unordered_map>
+#include <utility>  // for move
+#include <vector>
 
 #include <ffi.h>
 #include <girepository.h>
@@ -39,9 +44,11 @@
 #include <js/Array.h>
 #include <js/CallArgs.h>
 #include <js/Class.h>
+#include <js/Conversions.h>
 #include <js/GCVector.h>
 #include <js/PropertyDescriptor.h>  // for JSPROP_PERMANENT
 #include <js/PropertySpec.h>
+#include <js/Promise.h>
 #include <js/Realm.h>  // for GetRealmFunctionPrototype
 #include <js/RootingAPI.h>
 #include <js/TypeDecls.h>
@@ -52,14 +59,17 @@
 #include "gi/arg-cache.h"
 #include "gi/arg-inl.h"
 #include "gi/arg.h"
+#include "gi/call-stats.h"
 #include "gi/closure.h"
 #include "gi/function.h"
 #include "gi/gerror.h"
+#include "gi/gjs_gi_trace.h"
 #include "gi/object.h"
 #include "gi/utils-inl.h"
 #include "cjs/context-private.h"
 #include "cjs/context.h"
 #include "cjs/jsapi-class.h"
+#include "cjs/jsapi-util-root.h"
 #include "cjs/jsapi-util.h"
 #include "cjs/mem-private.h"
 #include "util/log.h"
@@ -69,26 +79,147 @@
  */
 #define GJS_ARG_INDEX_INVALID G_MAXUINT8
 
+// Call shapes that can be invoked without going through the argument cache
+// marshallers; see classify_function_shape().
+enum class GjsFunctionShape : uint8_t {
+    GENERIC = 0,
+    // GObject instance parameter, no arguments or a single boolean, int32, or
+    // double in-argument, void or scalar return value, and no GError
+    SCALAR_METHOD,
+};
+
+// Argument caches depend only on the GICallableInfo, so Function objects
+// created for the same introspected function or vfunc (for example an interface
+// method, which is defined on each implementing class's prototype) share one
+// immutable, refcounted copy. See acquire_shared_argument_cache().
+struct SharedArgumentCache {
+    std::string key;
+    GICallableInfo* info;
+    // offset inside the allocated space, as in Function::arguments
+    GjsArgumentCache* arguments;
+    unsigned refcount;
+    uint8_t js_in_argc;
+    uint8_t js_out_argc;
+};
+
+// Number of receiver types remembered by each method; see
+// instance_from_type_cache()
+static constexpr unsigned INSTANCE_TYPE_CACHE_SIZE = 4;
+
 typedef struct {
     GICallableInfo* info;
 
+    // Only used to build the argument cache and invoker, which is deferred
+    // until the function is first used; see ensure_function_initialized()
+    GType gtype;
+
     GjsArgumentCache* arguments;
+    SharedArgumentCache* shared_arguments;
 
     uint8_t js_in_argc;
     guint8 js_out_argc;
     GIFunctionInvoker invoker;
+
+    // Preallocated call frame, sized once in init_cached_function_data(), so
+    // that a non-reentrant call doesn't have to size its argument arrays on
+    // the stack. cvalues holds the in, out, and inout-original GIArgument
+    // arrays back to back; ffi_arg_pointers holds the ffi_call() arguments.
+    GIArgument* frame_cvalues;
+    void** frame_ffi_arg_pointers;
+    // GI argument positions, in order, of the arguments that have to go
+    // through the out pass (any with a JS out value, or an out marshaller that
+    // does something) and the release pass. Both include -1 for the return
+    // value and -2 for the instance parameter if needed.
+    int16_t* out_positions;
+    int16_t* release_positions;
+    uint8_t n_out_positions;
+    uint8_t n_release_positions;
+    bool frame_in_use : 1;
+    bool initialized : 1;
+    // Set for methods on GObjects or interfaces whose instance parameter is
+    // transfer-none, which can use instance_types
+    bool has_instance_type_cache : 1;
+
+    GjsFunctionShape shape;
+    GITypeTag fast_in_tag : 5;  // GI_TYPE_TAG_VOID if no in-argument
+    GITypeTag fast_return_tag : 5;
+
+    // GTypes of GObject receivers that already passed the instance typecheck,
+    // most recently added first; G_TYPE_INVALID for unused entries
+    GType instance_types[INSTANCE_TYPE_CACHE_SIZE];
+
+    // Only set if GJS_CALL_STATS is set; see gi/call-stats.h
+    GjsCallStats* call_stats;
 } Function;
 
 extern struct JSClass gjs_function_class;
 
 /* Because we can't free the mmap'd data for a callback
  * while it's in use, this list keeps track of ones that
- * will be freed the next time we invoke a C function.
+ * will be freed from an idle handler, or at the start of the next garbage
+ * collection, whichever comes first.
  */
-static GSList *completed_trampolines = NULL;  /* GjsCallbackTrampoline */
+static std::vector<GjsCallbackTrampoline*> completed_trampolines;
+static unsigned completed_trampolines_idle_id = 0;
 
 GJS_DEFINE_PRIV_FROM_JS(Function, gjs_function_class)
 
+// Namespace, container, name, and info type together identify one callable
+// blob in the loaded typelibs, even if it is looked up through different
+// GICallableInfo instances.
+[[nodiscard]] static std::string callable_info_cache_key(
+    GICallableInfo* info) {
+    GIBaseInfo* container = g_base_info_get_container(info);
+    std::string key(g_base_info_get_namespace(info));
+    key += '.';
+    if (container)
+        key += g_base_info_get_name(container);
+    key += '.';
+    key += g_base_info_get_name(info);
+    key += ':';
+    key += std::to_string(g_base_info_get_type(info));
+    return key;
+}
+
+// Trampolines for (scope call) and (scope async) callbacks are released as
+// soon as the callback is done with, so instead of freeing the ffi_closure and
+// cif, a few of them are kept for each callback type and handed out again with
+// a new JS function. The pool is per thread, since each JS thread releases its
+// own trampolines and frees its pool when memory is low.
+static constexpr size_t MAX_POOLED_TRAMPOLINES_PER_TYPE = 4;
+static thread_local std::unordered_map<std::string,
+                                       std::vector<GjsCallbackTrampoline*>>
+    trampoline_pool;
+
+[[nodiscard]] static bool trampoline_is_poolable(
+    const GjsCallbackTrampoline* trampoline) {
+    return trampoline->closure && !trampoline->is_vfunc &&
+           (trampoline->scope == GI_SCOPE_TYPE_CALL ||
+            trampoline->scope == GI_SCOPE_TYPE_ASYNC);
+}
+
+static void gjs_callback_trampoline_free(GjsCallbackTrampoline* trampoline) {
+    g_clear_pointer(&trampoline->js_function, g_closure_unref);
+    if (trampoline->info && trampoline->closure)
+        g_callable_info_free_closure(trampoline->info, trampoline->closure);
+    g_clear_pointer(&trampoline->info, g_base_info_unref);
+    g_free(trampoline->args);
+    g_slice_free(GjsCallbackTrampoline, trampoline);
+}
+
+// Returns a pooled trampoline with the given callable info, which already has
+// its ffi_closure and param types set up but no JS function, or null
+[[nodiscard]] static GjsCallbackTrampoline* take_pooled_trampoline(
+    const std::string& key) {
+    auto it = trampoline_pool.find(key);
+    if (it == trampoline_pool.end() || it->second.empty())
+        return nullptr;
+
+    GjsCallbackTrampoline* trampoline = it->second.back();
+    it->second.pop_back();
+    return trampoline;
+}
+
 void
 gjs_callback_trampoline_ref(GjsCallbackTrampoline *trampoline)
 {
@@ -101,14 +232,30 @@ gjs_callback_trampoline_unref(GjsCallbackTrampoline *trampoline)
     /* Not MT-safe, like all the rest of GJS */
 
     trampoline->ref_count--;
-    if (trampoline->ref_count == 0) {
-        g_clear_pointer(&trampoline->js_function, g_closure_unref);
-        if (trampoline->info && trampoline->closure)
-            g_callable_info_free_closure(trampoline->info, trampoline->closure);
-        g_clear_pointer(&trampoline->info, g_base_info_unref);
-        g_free (trampoline->param_types);
-        g_slice_free(GjsCallbackTrampoline, trampoline);
+    if (trampoline->ref_count > 0)
+        return;
+
+    if (trampoline_is_poolable(trampoline)) {
+        std::vector<GjsCallbackTrampoline*>& pooled =
+            trampoline_pool[callable_info_cache_key(trampoline->info)];
+        if (pooled.size() < MAX_POOLED_TRAMPOLINES_PER_TYPE) {
+            g_clear_pointer(&trampoline->js_function, g_closure_unref);
+            pooled.push_back(trampoline);
+            return;
+        }
     }
+
+    gjs_callback_trampoline_free(trampoline);
+}
+
+// Frees the trampolines kept for reuse by the calling thread, for example when
+// memory is low
+void gjs_callback_trampoline_clear_pool(void) {
+    for (auto& it : trampoline_pool) {
+        for (GjsCallbackTrampoline* trampoline : it.second)
+            gjs_callback_trampoline_free(trampoline);
+    }
+    trampoline_pool.clear();
 }
 
 template <typename T, GITypeTag TAG = GI_TYPE_TAG_VOID>
@@ -228,6 +375,81 @@ warn_about_illegal_js_callback(const GjsCallbackTrampoline *trampoline,
     return;
 }
 
+void gjs_function_clear_async_closures(void) {
+    // Swap the list out first, since releasing a trampoline may drop the
+    // last reference to JS objects whose teardown completes more callbacks
+    std::vector<GjsCallbackTrampoline*> trampolines;
+    trampolines.swap(completed_trampolines);
+    for (GjsCallbackTrampoline* trampoline : trampolines)
+        gjs_callback_trampoline_unref(trampoline);
+}
+
+static gboolean complete_async_calls_idle_handler(void*) {
+    completed_trampolines_idle_id = 0;
+    gjs_function_clear_async_closures();
+    return G_SOURCE_REMOVE;
+}
+
+// Called from the trampoline's own ffi_closure callback, so it can't be freed
+// yet; defer it until we are back in the main loop.
+static void queue_completed_trampoline(GjsCallbackTrampoline* trampoline) {
+    completed_trampolines.push_back(trampoline);
+
+    if (!completed_trampolines_idle_id) {
+        completed_trampolines_idle_id = g_idle_add_full(
+            G_PRIORITY_LOW, complete_async_calls_idle_handler, nullptr,
+            nullptr);
+    }
+}
+
+// Conversions of scalar callback arguments, which are common enough in
+// signal-like callbacks and vfuncs to skip the generic marshaller for. These
+// must give the same results as gjs_value_from_g_argument().
+template <typename T>
+static void callback_arg_to_int32(JS::MutableHandleValue value,
+                                  GIArgument* arg) {
+    value.setInt32(gjs_arg_get<T>(arg));
+}
+
+template <typename T>
+static void callback_arg_to_number(JS::MutableHandleValue value,
+                                   GIArgument* arg) {
+    value.setNumber(gjs_arg_get<T>(arg));
+}
+
+static void callback_arg_to_boolean(JS::MutableHandleValue value,
+                                    GIArgument* arg) {
+    value.setBoolean(gjs_arg_get<bool>(arg));
+}
+
+[[nodiscard]] static auto callback_arg_from_c_func(GITypeTag tag)
+    -> void (*)(JS::MutableHandleValue, GIArgument*) {
+    switch (tag) {
+        case GI_TYPE_TAG_BOOLEAN:
+            return callback_arg_to_boolean;
+        case GI_TYPE_TAG_INT8:
+            return callback_arg_to_int32<int8_t>;
+        case GI_TYPE_TAG_UINT8:
+            return callback_arg_to_int32<uint8_t>;
+        case GI_TYPE_TAG_INT16:
+            return callback_arg_to_int32<int16_t>;
+        case GI_TYPE_TAG_UINT16:
+            return callback_arg_to_int32<uint16_t>;
+        case GI_TYPE_TAG_INT32:
+            return callback_arg_to_int32<int32_t>;
+        case GI_TYPE_TAG_UINT32:
+            return callback_arg_to_number<uint32_t>;
+        case GI_TYPE_TAG_FLOAT:
+            return callback_arg_to_number<float>;
+        case GI_TYPE_TAG_DOUBLE:
+            return callback_arg_to_number<double>;
+        default:
+            // 64-bit integers may warn about lost precision, and everything
+            // else needs the type info
+            return nullptr;
+    }
+}
+
 /* This is our main entry point for ffi_closure callbacks.
  * ffi_prep_closure is doing pure magic and replaces the original
  * function call with this one which gives us the ffi arguments,
@@ -240,7 +462,6 @@ static void gjs_callback_closure(ffi_cif* cif [[maybe_unused]], void* result,
     JSContext *context;
     GjsCallbackTrampoline *trampoline;
     int i, n_args, n_jsargs, n_outargs, c_args_offset = 0;
-    GITypeInfo ret_type;
     bool success = false;
     auto args = reinterpret_cast<GIArgument **>(ffi_args);
 
@@ -278,10 +499,8 @@ static void gjs_callback_closure(ffi_cif* cif [[maybe_unused]], void* result,
     JSAutoRealm ar(context, JS_GetFunctionObject(gjs_closure_get_callable(
                                 trampoline->js_function)));
 
-    bool can_throw_gerror = g_callable_info_can_throw_gerror(trampoline->info);
-    n_args = g_callable_info_get_n_args(trampoline->info);
-
-    g_assert(n_args >= 0);
+    bool can_throw_gerror = trampoline->can_throw_gerror;
+    n_args = trampoline->n_args;
 
     JS::RootedObject this_object(context);
     if (trampoline->is_vfunc) {
@@ -299,7 +518,7 @@ static void gjs_callback_closure(ffi_cif* cif [[maybe_unused]], void* result,
         c_args_offset = 1;
     }
 
-    n_outargs = 0;
+    n_outargs = trampoline->n_outargs;
     JS::RootedValueVector jsargs(context);
 
     if (!jsargs.reserve(n_args))
@@ -307,52 +526,34 @@ static void gjs_callback_closure(ffi_cif* cif [[maybe_unused]], void* result,
 
     JS::RootedValue rval(context);
 
-    g_callable_info_load_return_type(trampoline->info, &ret_type);
-    bool ret_type_is_void = g_type_info_get_tag (&ret_type) == GI_TYPE_TAG_VOID;
+    GITypeInfo* ret_type = &trampoline->ret_type;
+    bool ret_type_is_void = trampoline->ret_type_is_void;
 
     for (i = 0, n_jsargs = 0; i < n_args; i++) {
-        GIArgInfo arg_info;
-        GITypeInfo type_info;
-        GjsParamType param_type;
-
-        g_callable_info_load_arg(trampoline->info, i, &arg_info);
-        g_arg_info_load_type(&arg_info, &type_info);
-
-        /* Skip void * arguments */
-        if (g_type_info_get_tag(&type_info) == GI_TYPE_TAG_VOID)
-            continue;
+        GjsCallbackArg* arg_cache = &trampoline->args[i];
 
-        if (g_arg_info_get_direction(&arg_info) == GI_DIRECTION_OUT) {
-            n_outargs++;
+        if (arg_cache->is_void || arg_cache->direction == GI_DIRECTION_OUT)
             continue;
-        }
-
-        if (g_arg_info_get_direction(&arg_info) == GI_DIRECTION_INOUT)
-            n_outargs++;
 
-        param_type = trampoline->param_types[i];
-
-        switch (param_type) {
+        switch (arg_cache->param_type) {
             case PARAM_SKIPPED:
                 continue;
             case PARAM_ARRAY: {
-                gint array_length_pos = g_type_info_get_array_length(&type_info);
-                GIArgInfo array_length_arg;
-                GITypeInfo arg_type_info;
+                GjsCallbackArg* length_cache =
+                    &trampoline->args[arg_cache->array_length_pos];
                 JS::RootedValue length(context);
 
-                g_callable_info_load_arg(trampoline->info, array_length_pos, &array_length_arg);
-                g_arg_info_load_type(&array_length_arg, &arg_type_info);
-                if (!gjs_value_from_g_argument(context, &length, &arg_type_info,
-                                               args[array_length_pos + c_args_offset],
-                                               true))
+                if (!gjs_value_from_g_argument(
+                        context, &length, &length_cache->type_info,
+                        args[arg_cache->array_length_pos + c_args_offset],
+                        true))
                     goto out;
 
                 if (!jsargs.growBy(1))
                     g_error("Unable to grow vector");
 
                 if (!gjs_value_from_explicit_array(context, jsargs[n_jsargs++],
-                                                   &type_info,
+                                                   &arg_cache->type_info,
                                                    args[i + c_args_offset],
                                                    length.toInt32()))
                     goto out;
@@ -363,11 +564,17 @@ static void gjs_callback_closure(ffi_cif* cif [[maybe_unused]], void* result,
                     g_error("Unable to grow vector");
 
                 GIArgument* arg = args[i + c_args_offset];
-                if (g_arg_info_get_direction(&arg_info) == GI_DIRECTION_INOUT)
+                if (arg_cache->direction == GI_DIRECTION_INOUT)
                     arg = *reinterpret_cast<GIArgument**>(arg);
 
+                if (arg_cache->from_c) {
+                    arg_cache->from_c(jsargs[n_jsargs++], arg);
+                    break;
+                }
+
                 if (!gjs_value_from_g_argument(context, jsargs[n_jsargs++],
-                                               &type_info, arg, false))
+                                               &arg_cache->type_info, arg,
+                                               false))
                     goto out;
                 break;
             }
@@ -389,14 +596,13 @@ static void gjs_callback_closure(ffi_cif* cif [[maybe_unused]], void* result,
         /* void return value, no out args, nothing to do */
     } else if (n_outargs == 0) {
         GIArgument argument;
-        GITransfer transfer;
+        GITransfer transfer = trampoline->caller_owns;
 
-        transfer = g_callable_info_get_caller_owns (trampoline->info);
         /* non-void return value, no out args. Should
          * be a single return value. */
         if (!gjs_value_to_g_argument(context,
                                      rval,
-                                     &ret_type,
+                                     ret_type,
                                      "callback",
                                      GJS_ARGUMENT_RETURN_VALUE,
                                      transfer,
@@ -404,19 +610,18 @@ static void gjs_callback_closure(ffi_cif* cif [[maybe_unused]], void* result,
                                      &argument))
             goto out;
 
-        set_return_ffi_arg_from_giargument(&ret_type,
+        set_return_ffi_arg_from_giargument(ret_type,
                                            result,
                                            &argument);
     } else if (n_outargs == 1 && ret_type_is_void) {
         /* void return value, one out args. Should
          * be a single return value. */
         for (i = 0; i < n_args; i++) {
-            GIArgInfo arg_info;
-            g_callable_info_load_arg(trampoline->info, i, &arg_info);
-            if (g_arg_info_get_direction(&arg_info) == GI_DIRECTION_IN)
+            GjsCallbackArg* arg_cache = &trampoline->args[i];
+            if (arg_cache->direction == GI_DIRECTION_IN)
                 continue;
 
-            if (!gjs_value_to_arg(context, rval, &arg_info,
+            if (!gjs_value_to_arg(context, rval, &arg_cache->arg_info,
                                   *reinterpret_cast<GIArgument **>(args[i + c_args_offset])))
                 goto out;
 
@@ -446,17 +651,17 @@ static void gjs_callback_closure(ffi_cif* cif [[maybe_unused]], void* result,
 
         if (!ret_type_is_void) {
             GIArgument argument;
-            GITransfer transfer = g_callable_info_get_caller_owns(trampoline->info);
+            GITransfer transfer = trampoline->caller_owns;
 
             if (!JS_GetElement(context, out_array, elem_idx, &elem))
                 goto out;
 
-            if (!gjs_value_to_g_argument(context, elem, &ret_type, "callback",
+            if (!gjs_value_to_g_argument(context, elem, ret_type, "callback",
                                          GJS_ARGUMENT_RETURN_VALUE, transfer,
                                          true, &argument))
                 goto out;
 
-            set_return_ffi_arg_from_giargument(&ret_type,
+            set_return_ffi_arg_from_giargument(ret_type,
                                                result,
                                                &argument);
 
@@ -464,15 +669,14 @@ static void gjs_callback_closure(ffi_cif* cif [[maybe_unused]], void* result,
         }
 
         for (i = 0; i < n_args; i++) {
-            GIArgInfo arg_info;
-            g_callable_info_load_arg(trampoline->info, i, &arg_info);
-            if (g_arg_info_get_direction(&arg_info) == GI_DIRECTION_IN)
+            GjsCallbackArg* arg_cache = &trampoline->args[i];
+            if (arg_cache->direction == GI_DIRECTION_IN)
                 continue;
 
             if (!JS_GetElement(context, out_array, elem_idx, &elem))
                 goto out;
 
-            if (!gjs_value_to_arg(context, elem, &arg_info,
+            if (!gjs_value_to_arg(context, elem, &arg_cache->arg_info,
                                   *(GIArgument **)args[i + c_args_offset]))
                 goto out;
 
@@ -504,9 +708,8 @@ out:
         /* Fill in the result with some hopefully neutral value */
         if (!ret_type_is_void) {
             GIArgument argument = {};
-            g_callable_info_load_return_type(trampoline->info, &ret_type);
-            gjs_gi_argument_init_default(&ret_type, &argument);
-            set_return_ffi_arg_from_giargument(&ret_type, result, &argument);
+            gjs_gi_argument_init_default(ret_type, &argument);
+            set_return_ffi_arg_from_giargument(ret_type, result, &argument);
         }
 
         /* If the callback has a GError** argument and invoking the closure
@@ -529,9 +732,8 @@ out:
         gjs_log_exception_uncaught(context);
     }
 
-    if (trampoline->scope == GI_SCOPE_TYPE_ASYNC) {
-        completed_trampolines = g_slist_prepend(completed_trampolines, trampoline);
-    }
+    if (trampoline->scope == GI_SCOPE_TYPE_ASYNC)
+        queue_completed_trampoline(trampoline);
 
     gjs_callback_trampoline_unref(trampoline);
     gjs->schedule_gc_if_needed();
@@ -546,6 +748,26 @@ GjsCallbackTrampoline* gjs_callback_trampoline_new(
 
     g_assert(function);
 
+    // The rule is:
+    // - notify callbacks in GObject methods are traced from the scope object
+    // - async and call callbacks, and other notify callbacks, are rooted
+    // - vfuncs are traced from the GObject prototype
+    bool should_root = scope != GI_SCOPE_TYPE_NOTIFIED || !has_scope_object;
+
+    if (!is_vfunc &&
+        (scope == GI_SCOPE_TYPE_CALL || scope == GI_SCOPE_TYPE_ASYNC)) {
+        trampoline =
+            take_pooled_trampoline(callable_info_cache_key(callable_info));
+        if (trampoline) {
+            trampoline->ref_count = 1;
+            trampoline->scope = scope;
+            trampoline->js_function =
+                gjs_closure_new(context, function,
+                                g_base_info_get_name(callable_info), should_root);
+            return trampoline;
+        }
+    }
+
     trampoline = g_slice_new(GjsCallbackTrampoline);
     new (trampoline) GjsCallbackTrampoline();
     trampoline->ref_count = 1;
@@ -554,24 +776,46 @@ GjsCallbackTrampoline* gjs_callback_trampoline_new(
 
     /* Analyze param types and directions, similarly to init_cached_function_data */
     n_args = g_callable_info_get_n_args(trampoline->info);
-    trampoline->param_types = g_new0(GjsParamType, n_args);
+    g_assert(n_args >= 0);
+    trampoline->n_args = n_args;
+    trampoline->args = g_new0(GjsCallbackArg, n_args);
+    trampoline->n_outargs = 0;
+
+    g_callable_info_load_return_type(trampoline->info, &trampoline->ret_type);
+    trampoline->ret_type_is_void =
+        g_type_info_get_tag(&trampoline->ret_type) == GI_TYPE_TAG_VOID;
+    trampoline->can_throw_gerror =
+        g_callable_info_can_throw_gerror(trampoline->info);
+    trampoline->caller_owns = g_callable_info_get_caller_owns(trampoline->info);
+
+    // Load everything first, since an array's length argument may come after
+    // the array
+    for (i = 0; i < n_args; i++) {
+        GjsCallbackArg* arg_cache = &trampoline->args[i];
+
+        g_callable_info_load_arg(trampoline->info, i, &arg_cache->arg_info);
+        g_arg_info_load_type(&arg_cache->arg_info, &arg_cache->type_info);
+        arg_cache->direction = g_arg_info_get_direction(&arg_cache->arg_info);
+        arg_cache->param_type = PARAM_NORMAL;
+        arg_cache->array_length_pos = -1;
+
+        /* Skip void * arguments */
+        arg_cache->is_void =
+            g_type_info_get_tag(&arg_cache->type_info) == GI_TYPE_TAG_VOID;
+        if (!arg_cache->is_void && arg_cache->direction != GI_DIRECTION_IN)
+            trampoline->n_outargs++;
+    }
 
     for (i = 0; i < n_args; i++) {
-        GIDirection direction;
-        GIArgInfo arg_info;
-        GITypeInfo type_info;
+        GjsCallbackArg* arg_cache = &trampoline->args[i];
         GITypeTag type_tag;
 
-        if (trampoline->param_types[i] == PARAM_SKIPPED)
+        if (arg_cache->param_type == PARAM_SKIPPED)
             continue;
 
-        g_callable_info_load_arg(trampoline->info, i, &arg_info);
-        g_arg_info_load_type(&arg_info, &type_info);
+        type_tag = g_type_info_get_tag(&arg_cache->type_info);
 
-        direction = g_arg_info_get_direction(&arg_info);
-        type_tag = g_type_info_get_tag(&type_info);
-
-        if (direction != GI_DIRECTION_IN) {
+        if (arg_cache->direction != GI_DIRECTION_IN) {
             /* INOUT and OUT arguments are handled differently. */
             continue;
         }
@@ -580,7 +824,7 @@ GjsCallbackTrampoline* gjs_callback_trampoline_new(
             GIBaseInfo* interface_info;
             GIInfoType interface_type;
 
-            interface_info = g_type_info_get_interface(&type_info);
+            interface_info = g_type_info_get_interface(&arg_cache->type_info);
             interface_type = g_base_info_get_type(interface_info);
             if (interface_type == GI_INFO_TYPE_CALLBACK) {
                 gjs_throw(context,
@@ -594,14 +838,16 @@ GjsCallbackTrampoline* gjs_callback_trampoline_new(
             }
             g_base_info_unref(interface_info);
         } else if (type_tag == GI_TYPE_TAG_ARRAY) {
-            if (g_type_info_get_array_type(&type_info) == GI_ARRAY_TYPE_C) {
-                int array_length_pos = g_type_info_get_array_length(&type_info);
+            if (g_type_info_get_array_type(&arg_cache->type_info) ==
+                GI_ARRAY_TYPE_C) {
+                int array_length_pos =
+                    g_type_info_get_array_length(&arg_cache->type_info);
 
                 if (array_length_pos >= 0 && array_length_pos < n_args) {
-                    GIArgInfo length_arg_info;
+                    GjsCallbackArg* length_cache =
+                        &trampoline->args[array_length_pos];
 
-                    g_callable_info_load_arg(trampoline->info, array_length_pos, &length_arg_info);
-                    if (g_arg_info_get_direction(&length_arg_info) != direction) {
+                    if (length_cache->direction != arg_cache->direction) {
                         gjs_throw(context,
                                   "%s %s has an array with different-direction "
                                   "length argument. This is not supported",
@@ -611,21 +857,20 @@ GjsCallbackTrampoline* gjs_callback_trampoline_new(
                         return NULL;
                     }
 
-                    trampoline->param_types[array_length_pos] = PARAM_SKIPPED;
-                    trampoline->param_types[i] = PARAM_ARRAY;
+                    length_cache->param_type = PARAM_SKIPPED;
+                    length_cache->from_c = nullptr;
+                    arg_cache->param_type = PARAM_ARRAY;
+                    arg_cache->array_length_pos = array_length_pos;
                 }
             }
+        } else if (!g_type_info_is_pointer(&arg_cache->type_info)) {
+            arg_cache->from_c = callback_arg_from_c_func(type_tag);
         }
     }
 
     trampoline->closure = g_callable_info_prepare_closure(callable_info, &trampoline->cif,
                                                           gjs_callback_closure, trampoline);
 
-    // The rule is:
-    // - notify callbacks in GObject methods are traced from the scope object
-    // - async and call callbacks, and other notify callbacks, are rooted
-    // - vfuncs are traced from the GObject prototype
-    bool should_root = scope != GI_SCOPE_TYPE_NOTIFIED || !has_scope_object;
     trampoline->js_function = gjs_closure_new(
         context, function, g_base_info_get_name(callable_info), should_root);
 
@@ -647,17 +892,142 @@ GjsCallbackTrampoline* gjs_callback_trampoline_new(
                            g_base_info_get_name(function->info));
 }
 
-static void
-complete_async_calls(void)
-{
-    if (completed_trampolines) {
-        for (GSList *iter = completed_trampolines; iter; iter = iter->next) {
-            auto trampoline = static_cast<GjsCallbackTrampoline *>(iter->data);
-            gjs_callback_trampoline_unref(trampoline);
+// Whether the last JS argument is an async callback that can be left out in
+// order to get a Promise instead
+[[nodiscard]] static bool can_return_promise(Function* function) {
+    int n_args = g_callable_info_get_n_args(function->info);
+    for (int ix = n_args - 1; ix >= 0; ix--) {
+        const GjsArgumentCache* cache = &function->arguments[ix];
+        if (!cache->skip_in)
+            return gjs_arg_cache_is_async_ready(cache);
+    }
+    return false;
+}
+
+// Overrides that forward ...args may pass extra arguments on every call, so
+// only the first call from each place gets the "Too many arguments" warning,
+// and the function name is only formatted then. Callsites are recorded per
+// context, by the position of the scripted caller and the function's name.
+GJS_JSAPI_RETURN_CONVENTION
+static bool warn_extra_args_once(JSContext* cx, Function* function,
+                                 unsigned argc) {
+    std::string callsite;
+    {
+        JS::AutoFilename filename;
+        unsigned line = 0, column = 0;
+        if (JS::DescribeScriptedCaller(cx, &filename, &line, &column) &&
+            filename.get())
+            callsite = filename.get();
+        callsite += ':' + std::to_string(line) + ':' + std::to_string(column);
+    }
+    callsite += ':';
+    callsite += g_base_info_get_namespace(function->info);
+    if (GIBaseInfo* container = g_base_info_get_container(function->info)) {
+        callsite += '.';
+        callsite += g_base_info_get_name(container);
+    }
+    callsite += '.';
+    callsite += g_base_info_get_name(function->info);
+
+    GjsContextPrivate* gjs = GjsContextPrivate::from_cx(cx);
+    if (!gjs->record_extra_args_callsite(std::move(callsite)))
+        return true;
+
+    GjsAutoChar name = format_function_name(function);
+    return JS::WarnUTF8(cx, "Too many arguments to %s: expected %u, got %u",
+                        name.get(), function->js_in_argc, argc);
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool check_js_argc(JSContext* cx, Function* function,
+                          const JS::CallArgs& args) {
+    if (G_LIKELY(args.length() == function->js_in_argc))
+        return true;
+
+    if (args.length() > function->js_in_argc) {
+        if (!warn_extra_args_once(cx, function, args.length()))
+            return false;
+    } else if (args.length() < function->js_in_argc &&
+               (args.length() + 1u < function->js_in_argc ||
+                !can_return_promise(function))) {
+        GjsAutoChar name = format_function_name(function);
+
+        args.reportMoreArgsNeeded(cx, name, function->js_in_argc,
+                                  args.length());
+        return false;
+    }
+
+    return true;
+}
+
+// Claims the preallocated call frame of a Function for the duration of a call.
+// If the frame is already claimed further up the stack (for example, a JS
+// callback re-entering the same C function) then reused() returns false, and
+// the caller must fall back to allocating its own frame.
+class GjsCallFrameGuard {
+    Function* m_function;
+
+ public:
+    explicit GjsCallFrameGuard(Function* function)
+        : m_function(function->frame_cvalues && !function->frame_in_use
+                         ? function
+                         : nullptr) {
+        if (m_function)
+            m_function->frame_in_use = true;
+    }
+    ~GjsCallFrameGuard() {
+        if (m_function)
+            m_function->frame_in_use = false;
+    }
+
+    GjsCallFrameGuard(const GjsCallFrameGuard&) = delete;
+    GjsCallFrameGuard& operator=(const GjsCallFrameGuard&) = delete;
+
+    [[nodiscard]] bool reused() const { return !!m_function; }
+};
+
+// Converts the instance parameter of a method without going through the
+// typecheck and its g_type_is_a() walk, if the wrapper is a GObject instance of
+// a type that passed the typecheck on an earlier call of @function. Returns
+// false if the cache doesn't apply, and then @gtype_out is the type to add with
+// remember_instance_type() once the argument cache marshaller has accepted the
+// object, or G_TYPE_INVALID.
+[[nodiscard]] static bool instance_from_type_cache(JSContext* cx,
+                                                   Function* function,
+                                                   JS::HandleObject obj,
+                                                   GIArgument* arg,
+                                                   GType* gtype_out) {
+    *gtype_out = G_TYPE_INVALID;
+    if (!function->has_instance_type_cache)
+        return false;
+
+    ObjectBase* priv = ObjectBase::for_js(cx, obj);
+    if (!priv || priv->is_prototype())
+        return false;
+
+    GType gtype = priv->gtype();
+    for (GType cached : function->instance_types) {
+        if (cached == gtype) {
+            GObject* ptr;
+            if (!ObjectBase::to_c_ptr(cx, obj, &ptr))
+                return false;
+            gjs_arg_set(arg, ptr);
+            return true;
         }
-        g_slist_free(completed_trampolines);
-        completed_trampolines = nullptr;
     }
+
+    *gtype_out = gtype;
+    return false;
+}
+
+static void remember_instance_type(Function* function, GType gtype) {
+    if (gtype == G_TYPE_INVALID)
+        return;
+
+    // Polymorphic call sites keep the most recent types
+    memmove(&function->instance_types[1], &function->instance_types[0],
+            (INSTANCE_TYPE_CACHE_SIZE - 1) * sizeof(GType));
+    function->instance_types[0] = gtype;
 }
 
 static void* get_return_ffi_pointer_from_giargument(
@@ -705,6 +1075,35 @@ static void* get_return_ffi_pointer_from_giargument(
     }
 }
 
+// Wrappers for the argument cache marshallers that time them if
+// GJS_MARSHAL_STATS is set; see gi/call-stats.h
+GJS_JSAPI_RETURN_CONVENTION
+static inline bool marshal_in(JSContext* cx, GjsArgumentCache* cache,
+                              GjsFunctionCallState* state, GIArgument* arg,
+                              JS::HandleValue value) {
+    GjsAutoCallTimer timer(gjs_marshal_stats_lookup(cache->marshallers->kind,
+                                                    GjsMarshalPhase::IN));
+    return cache->marshallers->in(cx, cache, state, arg, value);
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static inline bool marshal_out(JSContext* cx, GjsArgumentCache* cache,
+                               GjsFunctionCallState* state, GIArgument* arg,
+                               JS::MutableHandleValue value) {
+    GjsAutoCallTimer timer(gjs_marshal_stats_lookup(cache->marshallers->kind,
+                                                    GjsMarshalPhase::OUT));
+    return cache->marshallers->out(cx, cache, state, arg, value);
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static inline bool marshal_release(JSContext* cx, GjsArgumentCache* cache,
+                                   GjsFunctionCallState* state,
+                                   GIArgument* in_arg, GIArgument* out_arg) {
+    GjsAutoCallTimer timer(gjs_marshal_stats_lookup(cache->marshallers->kind,
+                                                    GjsMarshalPhase::RELEASE));
+    return cache->marshallers->release(cx, cache, state, in_arg, out_arg);
+}
+
 // This function can be called in two different ways. You can either use it to
 // create JavaScript objects by calling it without @r_value, or you can decide
 // to keep the return values in #GArgument format by providing a @r_value
@@ -728,12 +1127,10 @@ static bool gjs_invoke_c_function(JSContext* context, Function* function,
 
     bool is_method;
     JS::RootedValueVector return_values(context);
-
-    /* Because we can't free a closure while we're in it, we defer
-     * freeing until the next time a C function is invoked.  What
-     * we should really do instead is queue it for a GC thread.
-     */
-    complete_async_calls();
+    if (!r_value && !return_values.reserve(function->js_out_argc)) {
+        JS_ReportOutOfMemory(context);
+        return false;
+    }
 
     is_method = g_callable_info_is_method(function->info);
     can_throw_gerror = g_callable_info_can_throw_gerror(function->info);
@@ -752,20 +1149,8 @@ static bool gjs_invoke_c_function(JSContext* context, Function* function,
     // of arguments we expect the JS function to take (which does not include
     // PARAM_SKIPPED args).
     // args.length() is the number of arguments that were actually passed.
-    if (args.length() > function->js_in_argc) {
-        GjsAutoChar name = format_function_name(function);
-
-        if (!JS::WarnUTF8(context,
-                          "Too many arguments to %s: expected %u, got %u",
-                          name.get(), function->js_in_argc, args.length()))
-            return false;
-    } else if (args.length() < function->js_in_argc) {
-        GjsAutoChar name = format_function_name(function);
-
-        args.reportMoreArgsNeeded(context, name, function->js_in_argc,
-                                  args.length());
+    if (!check_js_argc(context, function, args))
         return false;
-    }
 
     // These arrays hold argument pointers.
     // - state.in_cvalues: C values which are passed on input (in or inout)
@@ -791,17 +1176,23 @@ static bool gjs_invoke_c_function(JSContext* context, Function* function,
     // Use gi_arg_pos to index inside the GIArgument array. Use ffi_arg_pos to
     // index inside ffi_arg_pointers.
     GjsFunctionCallState state(context);
-    if (is_method) {
-        state.in_cvalues = g_newa(GIArgument, gi_argc + 2) + 2;
-        state.out_cvalues = g_newa(GIArgument, gi_argc + 2) + 2;
-        state.inout_original_cvalues = g_newa(GIArgument, gi_argc + 2) + 2;
+    size_t offset = is_method ? 2 : 1;
+    size_t frame_size = gi_argc + offset;
+    GIArgument* cvalues;
+    void** ffi_arg_pointers;
+
+    GjsCallFrameGuard frame_guard(function);
+    if (G_LIKELY(frame_guard.reused())) {
+        cvalues = function->frame_cvalues;
+        ffi_arg_pointers = function->frame_ffi_arg_pointers;
     } else {
-        state.in_cvalues = g_newa(GIArgument, gi_argc + 1) + 1;
-        state.out_cvalues = g_newa(GIArgument, gi_argc + 1) + 1;
-        state.inout_original_cvalues = g_newa(GIArgument, gi_argc + 1) + 1;
+        cvalues = g_newa(GIArgument, 3 * frame_size);
+        ffi_arg_pointers = g_newa(void*, ffi_argc);
     }
 
-    void** ffi_arg_pointers = g_newa(void*, ffi_argc);
+    state.in_cvalues = cvalues + offset;
+    state.out_cvalues = cvalues + frame_size + offset;
+    state.inout_original_cvalues = cvalues + 2 * frame_size + offset;
 
     failed = false;
     unsigned ffi_arg_pos = 0;  // index into ffi_arg_pointers
@@ -814,11 +1205,14 @@ static bool gjs_invoke_c_function(JSContext* context, Function* function,
     if (is_method) {
         GjsArgumentCache* cache = &function->arguments[-2];
         GIArgument* in_value = &state.in_cvalues[-2];
-        JS::RootedValue in_js_value(context, JS::ObjectValue(*obj));
-
-        if (!cache->marshallers->in(context, cache, &state, in_value,
-                                    in_js_value))
-            return false;
+        GType receiver_type;
+        if (!instance_from_type_cache(context, function, obj, in_value,
+                                      &receiver_type)) {
+            JS::RootedValue in_js_value(context, JS::ObjectValue(*obj));
+            if (!marshal_in(context, cache, &state, in_value, in_js_value))
+                return false;
+            remember_instance_type(function, receiver_type);
+        }
 
         ffi_arg_pointers[ffi_arg_pos] = in_value;
         ++ffi_arg_pos;
@@ -859,8 +1253,7 @@ static bool gjs_invoke_c_function(JSContext* context, Function* function,
         if (js_arg_pos < args.length())
             js_in_arg = args[js_arg_pos];
 
-        if (!cache->marshallers->in(context, cache, &state, in_value,
-                                    js_in_arg)) {
+        if (!marshal_in(context, cache, &state, in_value, js_in_arg)) {
             failed = true;
             break;
         }
@@ -895,8 +1288,13 @@ static bool gjs_invoke_c_function(JSContext* context, Function* function,
 
     return_value_p = get_return_ffi_pointer_from_giargument(
         &function->arguments[-1], &return_value);
-    ffi_call(&(function->invoker.cif), FFI_FN(function->invoker.native_address),
-             return_value_p, ffi_arg_pointers);
+    {
+        GjsAutoCallTimer timer(
+            gjs_marshal_stats_lookup("c_function", GjsMarshalPhase::CALL));
+        ffi_call(&(function->invoker.cif),
+                 FFI_FN(function->invoker.native_address), return_value_p,
+                 ffi_arg_pointers);
+    }
 
     /* Return value and out arguments are valid only if invocation doesn't
      * return error. In arguments need to be released always.
@@ -919,7 +1317,8 @@ static bool gjs_invoke_c_function(JSContext* context, Function* function,
     // Process out arguments and return values. This loop is skipped if we fail
     // the type conversion above, or if did_throw_gerror is true.
     js_arg_pos = 0;
-    for (gi_arg_pos = -1; gi_arg_pos < gi_argc; gi_arg_pos++) {
+    for (unsigned ix = 0; ix < function->n_out_positions; ix++) {
+        gi_arg_pos = function->out_positions[ix];
         GjsArgumentCache* cache = &function->arguments[gi_arg_pos];
         GIArgument* out_value = &state.out_cvalues[gi_arg_pos];
 
@@ -929,8 +1328,8 @@ static bool gjs_invoke_c_function(JSContext* context, Function* function,
 
         JS::RootedValue js_out_arg(context);
         if (!r_value) {
-            if (!cache->marshallers->out(context, cache, &state, out_value,
-                                         &js_out_arg)) {
+            if (!marshal_out(context, cache, &state, out_value,
+                             &js_out_arg)) {
                 failed = true;
                 break;
             }
@@ -958,39 +1357,37 @@ release:
     if (!failed && !did_throw_gerror)
         state.call_completed = true;
 
-    // In this loop we use ffi_arg_pos just to ensure we don't release stuff
-    // we haven't allocated yet, if we failed in type conversion above.
-    // If we start from -1 (the return value), we need to process 1 more than
-    // processed_c_args.
-    // If we start from -2 (the instance parameter), we need to process 2 more
-    ffi_arg_pos = is_method ? 1 : 0;
-    unsigned ffi_arg_max = processed_c_args + (is_method ? 2 : 1);
+    // Save the return GIArgument if it was requested, instead of releasing it
+    if (r_value && !failed)
+        *r_value = state.out_cvalues[-1];
+
+    // Only the arguments that need it are released. If we failed in type
+    // conversion above, stop at the ones that weren't converted yet;
+    // processed_c_args counts the instance parameter, if any.
+    int gi_arg_max =
+        static_cast<int>(processed_c_args) - (is_method ? 1 : 0);
     postinvoke_release_failed = false;
-    for (gi_arg_pos = is_method ? -2 : -1;
-         gi_arg_pos < gi_argc && ffi_arg_pos < ffi_arg_max;
-         gi_arg_pos++, ffi_arg_pos++) {
+    for (unsigned ix = 0; ix < function->n_release_positions; ix++) {
+        gi_arg_pos = function->release_positions[ix];
+        if (gi_arg_pos >= gi_arg_max)
+            break;
+
         GjsArgumentCache* cache = &function->arguments[gi_arg_pos];
         GIArgument* in_value = &state.in_cvalues[gi_arg_pos];
         GIArgument* out_value = &state.out_cvalues[gi_arg_pos];
 
-        gjs_debug_marshal(
-            GJS_DEBUG_GFUNCTION,
-            "Releasing argument '%s', %d/%d GI args, %u/%u C args",
-            cache->arg_name, gi_arg_pos, gi_argc, ffi_arg_pos,
-            processed_c_args);
+        gjs_debug_marshal(GJS_DEBUG_GFUNCTION,
+                          "Releasing argument '%s', %d/%d GI args",
+                          cache->arg_name, gi_arg_pos, gi_argc);
 
         // Only process in or inout arguments if we failed, the rest is garbage
         if (failed && cache->skip_in)
             continue;
 
-        // Save the return GIArgument if it was requested
-        if (r_value && gi_arg_pos == -1) {
-            *r_value = *out_value;
+        if (r_value && gi_arg_pos == -1)
             continue;
-        }
 
-        if (!cache->marshallers->release(context, cache, &state, in_value,
-                                         out_value)) {
+        if (!marshal_release(context, cache, &state, in_value, out_value)) {
             postinvoke_release_failed = true;
             // continue with the release even if we fail, to avoid leaks
         }
@@ -999,8 +1396,6 @@ release:
     if (postinvoke_release_failed)
         failed = true;
 
-    g_assert(ffi_arg_pos == processed_c_args + (is_method ? 2 : 1));
-
     if (!r_value && function->js_out_argc > 0 &&
         (!failed && !did_throw_gerror)) {
         // If we have one return value or out arg, return that item on its
@@ -1018,6 +1413,9 @@ release:
         }
     }
 
+    if (!r_value && state.promise && !failed && !did_throw_gerror)
+        args.rval().setObject(*state.promise);
+
     if (!failed && did_throw_gerror) {
         return gjs_throw_gerror(context, local_error);
     } else if (failed) {
@@ -1027,6 +1425,120 @@ release:
     }
 }
 
+// Specialized version of gjs_invoke_c_function() for functions classified as
+// GjsFunctionShape::SCALAR_METHOD. The conversions are done inline, without
+// going through the argument cache marshallers, and there is nothing to
+// release afterwards.
+GJS_JSAPI_RETURN_CONVENTION
+static bool gjs_invoke_c_function_fast(JSContext* cx, Function* function,
+                                       const JS::CallArgs& args) {
+    if (!check_js_argc(cx, function, args))
+        return false;
+
+    JS::RootedObject obj(cx);
+    if (!args.computeThis(cx, &obj))
+        return false;
+
+    GjsArgumentCache* instance_cache = &function->arguments[-2];
+    GIArgument instance_arg;
+    GType receiver_type;
+    if (!instance_from_type_cache(cx, function, obj, &instance_arg,
+                                  &receiver_type)) {
+        if (!ObjectBase::transfer_to_gi_argument(
+                cx, obj, &instance_arg, GI_DIRECTION_IN,
+                instance_cache->transfer,
+                instance_cache->contents.object.gtype))
+            return false;
+        remember_instance_type(function, receiver_type);
+    }
+
+    GIArgument in_arg;
+    void* ffi_arg_pointers[] = {&instance_arg, &in_arg};
+
+    switch (function->fast_in_tag) {
+        case GI_TYPE_TAG_VOID:
+            break;
+        case GI_TYPE_TAG_BOOLEAN:
+            gjs_arg_set(&in_arg, JS::ToBoolean(args[0]));
+            break;
+        case GI_TYPE_TAG_INT32: {
+            int32_t number;
+            if (!JS::ToInt32(cx, args[0], &number))
+                return false;
+            gjs_arg_set(&in_arg, number);
+            break;
+        }
+        case GI_TYPE_TAG_DOUBLE: {
+            double number;
+            if (!JS::ToNumber(cx, args[0], &number))
+                return false;
+            gjs_arg_set(&in_arg, number);
+            break;
+        }
+        default:
+            g_assert_not_reached();
+    }
+
+    GjsArgumentCache* return_cache = &function->arguments[-1];
+    GIFFIReturnValue return_value;
+    void* return_value_p =
+        get_return_ffi_pointer_from_giargument(return_cache, &return_value);
+    ffi_call(&function->invoker.cif, FFI_FN(function->invoker.native_address),
+             return_value_p, ffi_arg_pointers);
+
+    if (function->fast_return_tag == GI_TYPE_TAG_VOID) {
+        args.rval().setUndefined();
+        return true;
+    }
+
+    GIArgument retval;
+    gi_type_info_extract_ffi_return_value(&return_cache->type_info,
+                                          &return_value, &retval);
+
+    switch (function->fast_return_tag) {
+        case GI_TYPE_TAG_BOOLEAN:
+            args.rval().setBoolean(gjs_arg_get<bool>(&retval));
+            break;
+        case GI_TYPE_TAG_INT8:
+            args.rval().setInt32(gjs_arg_get<int8_t>(&retval));
+            break;
+        case GI_TYPE_TAG_UINT8:
+            args.rval().setInt32(gjs_arg_get<uint8_t>(&retval));
+            break;
+        case GI_TYPE_TAG_INT16:
+            args.rval().setInt32(gjs_arg_get<int16_t>(&retval));
+            break;
+        case GI_TYPE_TAG_UINT16:
+            args.rval().setInt32(gjs_arg_get<uint16_t>(&retval));
+            break;
+        case GI_TYPE_TAG_INT32:
+            args.rval().setInt32(gjs_arg_get<int32_t>(&retval));
+            break;
+        case GI_TYPE_TAG_UINT32:
+            args.rval().setNumber(gjs_arg_get<uint32_t>(&retval));
+            break;
+        case GI_TYPE_TAG_INT64:
+            args.rval().setNumber(gjs_arg_get_maybe_rounded<int64_t>(&retval));
+            break;
+        case GI_TYPE_TAG_UINT64:
+            args.rval().setNumber(gjs_arg_get_maybe_rounded<uint64_t>(&retval));
+            break;
+        case GI_TYPE_TAG_FLOAT:
+            args.rval().setNumber(gjs_arg_get<float>(&retval));
+            break;
+        case GI_TYPE_TAG_DOUBLE:
+            args.rval().setNumber(gjs_arg_get<double>(&retval));
+            break;
+        default:
+            g_assert_not_reached();
+    }
+
+    return true;
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool ensure_function_initialized(JSContext* cx, Function* function);
+
 GJS_JSAPI_RETURN_CONVENTION
 static bool
 function_call(JSContext *context,
@@ -1045,48 +1557,155 @@ function_call(JSContext *context,
     if (priv == NULL)
         return true; /* we are the prototype, or have the wrong class */
 
-    return gjs_invoke_c_function(context, priv, js_argv);
-}
+    if (!ensure_function_initialized(context, priv))
+        return false;
 
-GJS_NATIVE_CONSTRUCTOR_DEFINE_ABSTRACT(function)
+    GjsAutoCallTimer timer(priv->call_stats);
+
+    // The names are only looked up while a tracer is attached
+    const char* ns [[maybe_unused]] = nullptr;
+    const char* container [[maybe_unused]] = nullptr;
+    const char* name [[maybe_unused]] = nullptr;
+    if (TRACE_ENABLED(GJS_GI_CALL_ENTRY) || TRACE_ENABLED(GJS_GI_CALL_RETURN)) {
+        GIBaseInfo* container_info = g_base_info_get_container(priv->info);
+        ns = g_base_info_get_namespace(priv->info);
+        container = container_info ? g_base_info_get_name(container_info) : "";
+        name = g_base_info_get_name(priv->info);
+    }
+    TRACE(GJS_GI_CALL_ENTRY(ns, container, name));
 
-/* Does not actually free storage for structure, just
- * reverses init_cached_function_data
- */
-static void
-uninit_cached_function_data (Function *function)
-{
-    if (function->arguments) {
-        g_assert(function->info &&
-                 "Don't know how to free cache without GI info");
+    bool ok = priv->shape == GjsFunctionShape::SCALAR_METHOD
+                  ? gjs_invoke_c_function_fast(context, priv, js_argv)
+                  : gjs_invoke_c_function(context, priv, js_argv);
 
-        // Careful! function->arguments is offset by one or two elements inside
-        // the allocated space, so we have to free index -1 or -2.
-        int start_index = g_callable_info_is_method(function->info) ? -2 : -1;
-        int gi_argc = MIN(g_callable_info_get_n_args(function->info),
-                          function->js_in_argc + function->js_out_argc);
+    TRACE(GJS_GI_CALL_RETURN(ns, container, name, ok));
+    return ok;
+}
 
-        for (int i = 0; i < gi_argc; i++) {
-            int ix = start_index + i;
+GJS_NATIVE_CONSTRUCTOR_DEFINE_ABSTRACT(function)
 
-            if (!function->arguments[ix].marshallers)
-                break;
+static void free_argument_cache(GICallableInfo* info,
+                                GjsArgumentCache* arguments) {
+    // Careful! arguments is offset by one or two elements inside the allocated
+    // space, so we have to free index -1 or -2.
+    int start_index = g_callable_info_is_method(info) ? -2 : -1;
+    int gi_argc = g_callable_info_get_n_args(info);
 
-            if (function->arguments[ix].marshallers->free)
-                function->arguments[ix].marshallers->free(
-                    &function->arguments[ix]);
-        }
+    for (int ix = start_index; ix < gi_argc; ix++) {
+        if (!arguments[ix].marshallers)
+            break;
 
-        g_free(&function->arguments[start_index]);
-        function->arguments = nullptr;
+        if (arguments[ix].marshallers->free)
+            arguments[ix].marshallers->free(&arguments[ix]);
     }
 
-    g_clear_pointer(&function->info, g_base_info_unref);
-    g_function_invoker_destroy(&function->invoker);
+    g_free(&arguments[start_index]);
+    size_t n_entries = g_callable_info_get_n_args(info) - start_index;
+    GJS_DEC_COUNTER_BYTES(function, sizeof(GjsArgumentCache) * n_entries);
 }
 
-static void function_finalize(JSFreeOp*, JSObject* obj) {
-    Function *priv;
+// Keyed on callable_info_cache_key(). Function objects are finalized in
+// the background, so access to the table is locked.
+//
+// The table only lives as long as the process. An argument cache is mostly
+// pointers: to marshaller tables, to GIBaseInfos, and to GITypeInfos embedded
+// in the entries themselves, which are only valid in this address space, so
+// there is no useful form of it to share between processes. The typelibs that
+// it is built from are already mmap'd and shared.
+static std::unordered_map<std::string, SharedArgumentCache*>
+    shared_argument_caches;
+G_LOCK_DEFINE_STATIC(shared_argument_caches);
+
+// Points @function at an existing argument cache for @key, if there is one.
+[[nodiscard]] static bool acquire_shared_argument_cache(Function* function,
+                                                        const std::string& key) {
+    G_LOCK(shared_argument_caches);
+    auto it = shared_argument_caches.find(key);
+    if (it == shared_argument_caches.end()) {
+        G_UNLOCK(shared_argument_caches);
+        return false;
+    }
+
+    SharedArgumentCache* shared = it->second;
+    shared->refcount++;
+    G_UNLOCK(shared_argument_caches);
+
+    function->shared_arguments = shared;
+    function->arguments = shared->arguments;
+    function->js_in_argc = shared->js_in_argc;
+    function->js_out_argc = shared->js_out_argc;
+    return true;
+}
+
+// Hands over ownership of @function's fully built argument cache to the shared
+// table, so that later Function objects for the same callable can reuse it.
+static void publish_shared_argument_cache(Function* function,
+                                          std::string&& key) {
+    auto* shared = new SharedArgumentCache{
+        std::move(key),          g_base_info_ref(function->info),
+        function->arguments,     1,
+        function->js_in_argc,    function->js_out_argc};
+    G_LOCK(shared_argument_caches);
+    shared_argument_caches.emplace(shared->key, shared);
+    G_UNLOCK(shared_argument_caches);
+    function->shared_arguments = shared;
+}
+
+static void release_shared_argument_cache(SharedArgumentCache* shared) {
+    G_LOCK(shared_argument_caches);
+    if (--shared->refcount > 0) {
+        G_UNLOCK(shared_argument_caches);
+        return;
+    }
+
+    shared_argument_caches.erase(shared->key);
+    G_UNLOCK(shared_argument_caches);
+
+    free_argument_cache(shared->info, shared->arguments);
+    g_base_info_unref(shared->info);
+    delete shared;
+}
+
+// Reverses init_cached_function_data(), except for the info and GType that it
+// was initialized from
+static void clear_cached_function_data(Function* function) {
+    if (function->shared_arguments) {
+        release_shared_argument_cache(function->shared_arguments);
+        function->shared_arguments = nullptr;
+        function->arguments = nullptr;
+    } else if (function->arguments) {
+        g_assert(function->info &&
+                 "Don't know how to free cache without GI info");
+
+        free_argument_cache(function->info, function->arguments);
+        function->arguments = nullptr;
+    }
+
+    g_clear_pointer(&function->frame_cvalues, g_free);
+    g_clear_pointer(&function->frame_ffi_arg_pointers, g_free);
+    g_clear_pointer(&function->out_positions, g_free);
+    g_clear_pointer(&function->release_positions, g_free);
+    function->n_out_positions = function->n_release_positions = 0;
+    function->has_instance_type_cache = false;
+    memset(function->instance_types, 0, sizeof(function->instance_types));
+
+    g_function_invoker_destroy(&function->invoker);
+    memset(&function->invoker, 0, sizeof(function->invoker));
+    function->initialized = false;
+}
+
+/* Does not actually free storage for structure, just
+ * reverses init_cached_function_data
+ */
+static void
+uninit_cached_function_data (Function *function)
+{
+    clear_cached_function_data(function);
+    g_clear_pointer(&function->info, g_base_info_unref);
+}
+
+static void function_finalize(JSFreeOp*, JSObject* obj) {
+    Function *priv;
 
     priv = (Function *) JS_GetPrivate(obj);
     gjs_debug_lifecycle(GJS_DEBUG_GFUNCTION,
@@ -1107,6 +1726,8 @@ get_num_arguments (JSContext *context,
                    JS::Value *vp)
 {
     GJS_GET_PRIV(context, argc, vp, rec, to, Function, priv);
+    if (!ensure_function_initialized(context, priv))
+        return false;
     rec.rval().setInt32(priv->js_in_argc);
     return true;
 }
@@ -1130,6 +1751,9 @@ function_to_string (JSContext *context,
         return true;
     }
 
+    if (!ensure_function_initialized(context, priv))
+        return false;
+
     n_args = g_callable_info_get_n_args(priv->info);
     n_jsargs = 0;
     arg_names_str = g_string_new("");
@@ -1196,13 +1820,122 @@ static JSFunctionSpec gjs_function_proto_funcs[] = {
 
 static JSFunctionSpec *gjs_function_static_funcs = nullptr;
 
+[[nodiscard]] static bool is_fast_path_return_tag(GITypeTag tag) {
+    switch (tag) {
+        case GI_TYPE_TAG_VOID:
+        case GI_TYPE_TAG_BOOLEAN:
+        case GI_TYPE_TAG_INT8:
+        case GI_TYPE_TAG_UINT8:
+        case GI_TYPE_TAG_INT16:
+        case GI_TYPE_TAG_UINT16:
+        case GI_TYPE_TAG_INT32:
+        case GI_TYPE_TAG_UINT32:
+        case GI_TYPE_TAG_INT64:
+        case GI_TYPE_TAG_UINT64:
+        case GI_TYPE_TAG_FLOAT:
+        case GI_TYPE_TAG_DOUBLE:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Detects the simple call shapes, such as getters like get_width() or
+// is_visible() and setters like set_visible(), that make up most calls from
+// shell code, so that they can skip the generic argument cache loop.
+static void classify_function_shape(Function* function) {
+    GICallableInfo* info = function->info;
+
+    function->shape = GjsFunctionShape::GENERIC;
+
+    if (!g_callable_info_is_method(info) ||
+        g_callable_info_can_throw_gerror(info))
+        return;
+
+    // Only GObject instances, whose marshaller needs no release pass
+    GIBaseInfo* container = g_base_info_get_container(info);  // !owned
+    if (g_base_info_get_type(container) != GI_INFO_TYPE_OBJECT)
+        return;
+    GType gtype = function->arguments[-2].contents.object.gtype;
+    if (!g_type_is_a(gtype, G_TYPE_OBJECT))
+        return;
+
+    GITypeTag return_tag =
+        g_type_info_get_tag(&function->arguments[-1].type_info);
+    if (!is_fast_path_return_tag(return_tag))
+        return;
+    // A skipped return value comes out as undefined from the generic path
+    if (return_tag != GI_TYPE_TAG_VOID && function->arguments[-1].skip_out)
+        return;
+
+    GITypeTag in_tag = GI_TYPE_TAG_VOID;
+    int n_args = g_callable_info_get_n_args(info);
+    if (n_args > 1)
+        return;
+    if (n_args == 1) {
+        GjsArgumentCache* arg = &function->arguments[0];
+        if (arg->skip_in || !arg->skip_out)
+            return;
+
+        in_tag = g_type_info_get_tag(&arg->type_info);
+        if (in_tag != GI_TYPE_TAG_BOOLEAN && in_tag != GI_TYPE_TAG_INT32 &&
+            in_tag != GI_TYPE_TAG_DOUBLE)
+            return;
+    }
+
+    function->fast_in_tag = in_tag;
+    function->fast_return_tag = return_tag;
+    function->shape = GjsFunctionShape::SCALAR_METHOD;
+}
+
+// Per-Function state that is not shared with other Function objects for the
+// same callable, since the call frame is in use during a call.
+static void init_call_frame(Function* function, unsigned n_cache_entries) {
+    // The call frame holds the in, out, and inout-original argument arrays,
+    // each with room for the return value and instance parameter in front.
+    function->frame_cvalues = g_new(GIArgument, 3 * n_cache_entries);
+    function->frame_ffi_arg_pointers =
+        g_new(void*, MAX(function->invoker.cif.nargs, 1));
+    function->frame_in_use = false;
+
+    bool is_method = g_callable_info_is_method(function->info);
+    if (is_method) {
+        const GjsArgumentCache* instance = &function->arguments[-2];
+        GType gtype = instance->contents.object.gtype;
+        function->has_instance_type_cache =
+            instance->transfer == GI_TRANSFER_NOTHING &&
+            (g_type_is_a(gtype, G_TYPE_OBJECT) ||
+             g_type_is_a(gtype, G_TYPE_INTERFACE));
+    }
+    memset(function->instance_types, 0, sizeof(function->instance_types));
+
+    // Most arguments are scalars or transfer-none objects, which need neither
+    // pass; calls skip those entirely
+    int first = is_method ? -2 : -1;
+    int end = static_cast<int>(n_cache_entries) + first;
+    function->out_positions = g_new(int16_t, n_cache_entries);
+    function->release_positions = g_new(int16_t, n_cache_entries);
+    function->n_out_positions = function->n_release_positions = 0;
+    for (int gi_arg_pos = first; gi_arg_pos < end; gi_arg_pos++) {
+        const GjsArgumentCache* cache = &function->arguments[gi_arg_pos];
+        // The instance parameter never has an out value
+        if (gi_arg_pos != -2 &&
+            (!cache->skip_out || gjs_arg_cache_needs_out(cache)))
+            function->out_positions[function->n_out_positions++] = gi_arg_pos;
+        if (gjs_arg_cache_needs_release(cache))
+            function->release_positions[function->n_release_positions++] =
+                gi_arg_pos;
+    }
+
+    classify_function_shape(function);
+}
+
+// Builds the argument cache and invoker for function->info and
+// function->gtype.
 GJS_JSAPI_RETURN_CONVENTION
-static bool
-init_cached_function_data (JSContext      *context,
-                           Function       *function,
-                           GType           gtype,
-                           GICallableInfo *info)
-{
+static bool init_cached_function_data(JSContext* context, Function* function) {
+    GICallableInfo* info = function->info;
+    GType gtype = function->gtype;
     guint8 i, n_args;
     GError *error = NULL;
     GIInfoType info_type;
@@ -1238,16 +1971,23 @@ init_cached_function_data (JSContext      *context,
 
     bool is_method = g_callable_info_is_method(info);
     n_args = g_callable_info_get_n_args((GICallableInfo*) info);
+    size_t offset = is_method ? 2 : 1;
+
+    std::string shared_key = callable_info_cache_key(info);
+    if (acquire_shared_argument_cache(function, shared_key)) {
+        init_call_frame(function, n_args + offset);
+        return true;
+    }
 
     // arguments is one or two inside an array of n_args + 2, so
     // arguments[-1] is the return value (which can be skipped if void)
     // arguments[-2] is the instance parameter
-    size_t offset = is_method ? 2 : 1;
     GjsArgumentCache* arguments =
         g_new0(GjsArgumentCache, n_args + offset) + offset;
+    GJS_INC_COUNTER_BYTES(function,
+                          sizeof(GjsArgumentCache) * (n_args + offset));
 
     function->arguments = arguments;
-    function->info = g_base_info_ref(info);
     function->js_in_argc = 0;
     function->js_out_argc = 0;
 
@@ -1293,6 +2033,40 @@ init_cached_function_data (JSContext      *context,
         }
     }
 
+    publish_shared_argument_cache(function, std::move(shared_key));
+    init_call_frame(function, n_args + offset);
+
+    return true;
+}
+
+// Functions are resolved in bulk, e.g. by enumerating a prototype, or by
+// override code that wraps them, and many of them are never called. So the
+// argument cache and invoker are only built the first time the function is
+// called or introspected.
+static bool ensure_function_initialized(JSContext* cx, Function* function) {
+    if (function->initialized)
+        return true;
+
+    if (!init_cached_function_data(cx, function)) {
+        clear_cached_function_data(function);
+        return false;
+    }
+
+    function->initialized = true;
+
+    if (gjs_call_stats_enabled()) {
+        // Named as in JS, e.g. Gtk.Widget.show or Gtk.Widget.vfunc_draw
+        GICallableInfo* info = function->info;
+        GIBaseInfo* container = g_base_info_get_container(info);
+        std::string name(g_base_info_get_namespace(info));
+        if (container)
+            name.append(".").append(g_base_info_get_name(container));
+        name += '.';
+        if (g_base_info_get_type(info) == GI_INFO_TYPE_VFUNC)
+            name += "vfunc_";
+        name += g_base_info_get_name(info);
+        function->call_stats = gjs_call_stats_lookup(name.c_str());
+    }
     return true;
 }
 
@@ -1333,8 +2107,14 @@ function_new(JSContext      *context,
                         "function constructor, obj %p priv %p", function.get(),
                         priv);
 
-    if (!init_cached_function_data(context, priv, gtype, (GICallableInfo *)info))
-      return NULL;
+    priv->info = g_base_info_ref(info);
+    priv->gtype = gtype;
+
+    // Virtual functions are looked up by address for a particular GType, and
+    // a missing implementation should still be reported here
+    if (g_base_info_get_type(info) == GI_INFO_TYPE_VFUNC &&
+        !ensure_function_initialized(context, priv))
+        return NULL;
 
     return function;
 }
@@ -1385,10 +2165,617 @@ bool gjs_invoke_constructor_from_c(JSContext* context, GIFunctionInfo* info,
     Function function;
 
     memset(&function, 0, sizeof(Function));
-    if (!init_cached_function_data(context, &function, 0, info))
+    function.info = g_base_info_ref(info);
+    if (!ensure_function_initialized(context, &function)) {
+        uninit_cached_function_data(&function);
         return false;
+    }
 
     bool result = gjs_invoke_c_function(context, &function, args, obj, rvalue);
     uninit_cached_function_data(&function);
     return result;
 }
+
+// State for a Promise returned from an async function called without its
+// callback. Only the Promise is rooted; like the callback of Gio._promisify(),
+// the _finish method is called on the source object of the result.
+struct GjsAsyncPromise {
+    JSContext* cx;
+    GIFunctionInfo* finish_info;
+    GjsMaybeOwned<JSObject*> promise;
+
+    GjsAsyncPromise(JSContext* context, GIFunctionInfo* info)
+        : cx(context), finish_info(g_base_info_ref(info)) {}
+    ~GjsAsyncPromise() {
+        promise.reset();
+        g_base_info_unref(finish_info);
+    }
+};
+
+static void async_promise_context_destroyed(JS::HandleObject, void* data) {
+    static_cast<GjsAsyncPromise*>(data)->promise.reset();
+}
+
+JSObject* gjs_async_promise_new(JSContext* cx, GIFunctionInfo* finish_info,
+                                void** data_out) {
+    JS::RootedObject promise(cx, JS::NewPromiseObject(cx, nullptr));
+    if (!promise)
+        return nullptr;
+
+    auto* data = new GjsAsyncPromise(cx, finish_info);
+    data->promise.root(cx, promise, async_promise_context_destroyed, data);
+    *data_out = data;
+    return promise;
+}
+
+void gjs_async_promise_free(void* data) {
+    delete static_cast<GjsAsyncPromise*>(data);
+}
+
+// Calls the _finish function with @result, without creating a JS function
+// object for it, and unpacks the return value in the same way as the callback
+// of Gio._promisify().
+GJS_JSAPI_RETURN_CONVENTION
+static bool async_promise_finish(JSContext* cx, GIFunctionInfo* finish_info,
+                                 GObject* source, GAsyncResult* result,
+                                 JS::MutableHandleValue value) {
+    JS::RootedValue this_value(cx);
+    if (g_callable_info_is_method(finish_info)) {
+        if (!source) {
+            gjs_throw(cx, "No source object to call %s.%s() on",
+                      g_base_info_get_namespace(finish_info),
+                      g_base_info_get_name(finish_info));
+            return false;
+        }
+        JSObject* source_obj = ObjectInstance::wrapper_from_gobject(cx, source);
+        if (!source_obj)
+            return false;
+        this_value.setObject(*source_obj);
+    }
+
+    JSObject* result_obj =
+        ObjectInstance::wrapper_from_gobject(cx, G_OBJECT(result));
+    if (!result_obj)
+        return false;
+
+    // Callee, this, and the result argument, laid out as in a JSNative call
+    JS::RootedValueVector vp(cx);
+    if (!vp.append(JS::UndefinedValue()) || !vp.append(this_value) ||
+        !vp.append(JS::ObjectValue(*result_obj))) {
+        JS_ReportOutOfMemory(cx);
+        return false;
+    }
+
+    Function function;
+    memset(&function, 0, sizeof(Function));
+    function.info = g_base_info_ref(finish_info);
+    if (!ensure_function_initialized(cx, &function)) {
+        uninit_cached_function_data(&function);
+        return false;
+    }
+
+    JS::CallArgs args = JS::CallArgsFromVp(1, vp.begin());
+    bool ok = gjs_invoke_c_function(cx, &function, args);
+    uninit_cached_function_data(&function);
+    if (!ok)
+        return false;
+    value.set(args.rval());
+
+    // A leading true only reports that the out arguments were filled in
+    bool is_array;
+    if (!JS::IsArrayObject(cx, value, &is_array))
+        return false;
+    if (!is_array)
+        return true;
+
+    JS::RootedObject array(cx, &value.toObject());
+    uint32_t length;
+    if (!JS::GetArrayLength(cx, array, &length))
+        return false;
+    if (length < 2)
+        return true;
+
+    JS::RootedValue elem(cx);
+    if (!JS_GetElement(cx, array, 0, &elem))
+        return false;
+    if (!elem.isTrue())
+        return true;
+
+    JS::RootedValueVector rest(cx);
+    if (!rest.reserve(length - 1)) {
+        JS_ReportOutOfMemory(cx);
+        return false;
+    }
+    for (uint32_t ix = 1; ix < length; ix++) {
+        if (!JS_GetElement(cx, array, ix, &elem))
+            return false;
+        rest.infallibleAppend(elem);
+    }
+
+    JSObject* stripped = JS::NewArrayObject(cx, rest);
+    if (!stripped)
+        return false;
+    value.setObject(*stripped);
+    return true;
+}
+
+void gjs_async_promise_callback(GObject* source, GAsyncResult* result,
+                                void* data) {
+    auto* self = static_cast<GjsAsyncPromise*>(data);
+
+    // The context is gone and there is nothing left to settle
+    if (G_UNLIKELY(!self->promise)) {
+        gjs_async_promise_free(self);
+        return;
+    }
+
+    JSContext* cx = self->cx;
+    GjsContextPrivate* gjs = GjsContextPrivate::from_cx(cx);
+    if (G_UNLIKELY(gjs->sweeping() || !gjs->is_owner_thread())) {
+        // The state is leaked, since unrooting isn't safe here either
+        g_critical(
+            "Attempting to finish an async call during garbage collection or "
+            "on a different thread. Because it would crash the application, "
+            "it has been blocked.");
+        gjs_dumpstack();
+        return;
+    }
+
+    JS::RootedObject promise(cx, self->promise);
+    JSAutoRealm ar(cx, promise);
+
+    JS::RootedValue value(cx);
+    bool ok;
+    if (async_promise_finish(cx, self->finish_info, source, result, &value)) {
+        ok = JS::ResolvePromise(cx, promise, value);
+    } else if (JS_GetPendingException(cx, &value)) {
+        JS_ClearPendingException(cx);
+        ok = JS::RejectPromise(cx, promise, value);
+    } else {
+        // Uncatchable exception, e.g. from System.exit(); same as a callback
+        // trampoline, exit here
+        gjs_async_promise_free(self);
+        uint8_t code;
+        if (gjs->should_exit(&code))
+            exit(code);
+        return;
+    }
+
+    if (!ok)
+        gjs_log_exception(cx);
+
+    gjs_async_promise_free(self);
+    gjs->schedule_gc_if_needed();
+}
+
+// A call whose ffi_call() runs on a thread pool; see
+// gjs_function_call_in_thread(). The arguments are marshalled in and released
+// on the main thread, as in gjs_invoke_c_function().
+struct GjsThreadedCall {
+    JSContext* cx;
+    GMainContext* main_context;
+    // [promise, callee, this, ...args], so that the function object and any
+    // wrappers whose memory is passed to C stay alive during the call
+    GjsMaybeOwned<JSObject*> values;
+
+    Function* function;
+    // A copy of function->invoker, which is all the thread uses, so that the
+    // call doesn't depend on the function object staying alive
+    GIFunctionInvoker invoker;
+    // Set on the thread when the C function has returned, and read once the
+    // thread pool has been waited for in gjs_cancel_threaded_calls()
+    GSource* complete_source;
+
+    bool is_method;
+    int gi_argc;
+    GIArgument* cvalues;
+    void** ffi_arg_pointers;
+    size_t offset;
+    size_t frame_size;
+
+    GIFFIReturnValue return_value;
+    void* return_value_p;
+    GError* local_error;
+    GError** errorp;
+
+    GjsThreadedCall(JSContext* context, Function* func)
+        : cx(context),
+          main_context(g_main_context_ref_thread_default()),
+          function(func),
+          complete_source(nullptr),
+          is_method(g_callable_info_is_method(func->info)),
+          gi_argc(g_callable_info_get_n_args(func->info)),
+          offset(is_method ? 2 : 1),
+          frame_size(gi_argc + offset),
+          return_value_p(nullptr),
+          local_error(nullptr),
+          errorp(&local_error) {
+        memset(&invoker, 0, sizeof(invoker));
+        cvalues = g_new0(GIArgument, 3 * frame_size);
+        ffi_arg_pointers = g_new0(void*, function->invoker.cif.nargs);
+    }
+
+    ~GjsThreadedCall() {
+        if (complete_source) {
+            g_source_destroy(complete_source);
+            g_source_unref(complete_source);
+        }
+        g_function_invoker_destroy(&invoker);
+        values.reset();
+        g_free(cvalues);
+        g_free(ffi_arg_pointers);
+        g_clear_error(&local_error);
+        g_main_context_unref(main_context);
+    }
+
+    void init_state(GjsFunctionCallState* state) {
+        state->in_cvalues = cvalues + offset;
+        state->out_cvalues = cvalues + frame_size + offset;
+        state->inout_original_cvalues = cvalues + 2 * frame_size + offset;
+    }
+
+    // Releases the first @n_processed arguments, counting the instance and
+    // return value; if the call didn't complete, only in and inout arguments
+    GJS_JSAPI_RETURN_CONVENTION
+    bool release(GjsFunctionCallState* state, int n_processed) {
+        bool ok = true;
+        int first = is_method ? -2 : -1;
+        for (int gi_arg_pos = first;
+             gi_arg_pos < gi_argc && gi_arg_pos - first < n_processed;
+             gi_arg_pos++) {
+            GjsArgumentCache* cache = &function->arguments[gi_arg_pos];
+            if (!state->call_completed && cache->skip_in)
+                continue;
+            if (!marshal_release(cx, cache, state,
+                                 &state->in_cvalues[gi_arg_pos],
+                                 &state->out_cvalues[gi_arg_pos]))
+                ok = false;  // continue with the release, to avoid leaks
+        }
+        return ok;
+    }
+};
+
+// Each JS thread has its own pool, so that a context can wait for its own
+// calls when it is destroyed; see gjs_cancel_threaded_calls()
+thread_local GThreadPool* s_threaded_call_pool = nullptr;
+thread_local std::vector<GjsThreadedCall*> s_threaded_calls;
+
+static void threaded_call_context_destroyed(JS::HandleObject, void* data) {
+    static_cast<GjsThreadedCall*>(data)->values.reset();
+}
+
+// Marshals the out arguments, releases the arguments, and settles the Promise
+GJS_JSAPI_RETURN_CONVENTION
+static bool threaded_call_finish(GjsThreadedCall* call,
+                                 JS::HandleObject promise) {
+    JSContext* cx = call->cx;
+    Function* function = call->function;
+    GjsFunctionCallState state(cx);
+    call->init_state(&state);
+    int n_processed = call->gi_argc + (call->is_method ? 2 : 1);
+
+    // The out arguments are not valid; the caller rejects the Promise with
+    // the pending GError
+    if (call->local_error) {
+        GError* error = std::exchange(call->local_error, nullptr);
+        if (!call->release(&state, n_processed)) {
+            g_error_free(error);
+            return false;
+        }
+        return gjs_throw_gerror(cx, error);
+    }
+
+    if (!function->arguments[-1].skip_out) {
+        gi_type_info_extract_ffi_return_value(
+            &function->arguments[-1].type_info, &call->return_value,
+            &state.out_cvalues[-1]);
+    }
+
+    bool failed = false;
+    JS::RootedValueVector return_values(cx);
+    for (int gi_arg_pos = -1; gi_arg_pos < call->gi_argc; gi_arg_pos++) {
+        GjsArgumentCache* cache = &function->arguments[gi_arg_pos];
+        JS::RootedValue js_out_arg(cx);
+        if (!marshal_out(cx, cache, &state, &state.out_cvalues[gi_arg_pos],
+                         &js_out_arg)) {
+            failed = true;
+            break;
+        }
+        if (!cache->skip_out && !return_values.append(js_out_arg)) {
+            JS_ReportOutOfMemory(cx);
+            failed = true;
+            break;
+        }
+    }
+
+    state.call_completed = true;
+    if (!call->release(&state, n_processed) || failed)
+        return false;
+
+    JS::RootedValue result(cx);
+    if (return_values.length() == 1) {
+        result.set(return_values[0]);
+    } else if (return_values.length() > 1) {
+        JSObject* array = JS::NewArrayObject(cx, return_values);
+        if (!array)
+            return false;
+        result.setObject(*array);
+    }
+    return JS::ResolvePromise(cx, promise, result);
+}
+
+static gboolean threaded_call_complete(void* data) {
+    auto* call = static_cast<GjsThreadedCall*>(data);
+    s_threaded_calls.erase(std::find(s_threaded_calls.begin(),
+                                     s_threaded_calls.end(), call));
+
+    // The context is gone; the C values are leaked, since releasing them
+    // would need it
+    if (G_UNLIKELY(!call->values)) {
+        delete call;
+        return G_SOURCE_REMOVE;
+    }
+
+    JSContext* cx = call->cx;
+    JS::RootedObject values(cx, call->values);
+    JSAutoRealm ar(cx, values);
+
+    JS::RootedValue promise_value(cx);
+    if (!JS_GetElement(cx, values, 0, &promise_value)) {
+        gjs_log_exception(cx);
+        delete call;
+        return G_SOURCE_REMOVE;
+    }
+    JS::RootedObject promise(cx, &promise_value.toObject());
+
+    if (!threaded_call_finish(call, promise)) {
+        JS::RootedValue error(cx);
+        if (JS_GetPendingException(cx, &error)) {
+            JS_ClearPendingException(cx);
+            if (!JS::RejectPromise(cx, promise, error))
+                gjs_log_exception(cx);
+        }
+    }
+
+    delete call;
+    GjsContextPrivate::from_cx(cx)->schedule_gc_if_needed();
+    return G_SOURCE_REMOVE;
+}
+
+static void threaded_call_run(void* data, void*) {
+    auto* call = static_cast<GjsThreadedCall*>(data);
+
+    ffi_call(&call->invoker.cif, FFI_FN(call->invoker.native_address),
+             call->return_value_p, call->ffi_arg_pointers);
+
+    // The call keeps a reference, to remove the source if it is cancelled
+    GSource* source = g_idle_source_new();
+    g_source_set_callback(source, threaded_call_complete, call, nullptr);
+    call->complete_source = source;
+    g_source_attach(source, call->main_context);
+}
+
+// GObjects of classes defined in JS would call into JS from the thread, in
+// their vfuncs and property accessors
+GJS_JSAPI_RETURN_CONVENTION
+static bool check_object_in_thread(JSContext* cx, Function* function,
+                                   const char* arg_name, GIArgument* arg) {
+    auto* gobj = static_cast<GObject*>(gjs_arg_get<void*>(arg));
+    if (!gobj || !G_IS_OBJECT(gobj))
+        return true;
+
+    for (GType type = G_OBJECT_TYPE(gobj); type; type = g_type_parent(type)) {
+        if (g_type_get_qdata(type, ObjectBase::custom_type_quark())) {
+            GjsAutoChar name = format_function_name(function);
+            gjs_throw(cx,
+                      "Argument '%s' of %s is an instance of %s, which is "
+                      "implemented in JS and cannot be used in a thread",
+                      arg_name, name.get(), g_type_name(G_OBJECT_TYPE(gobj)));
+            return false;
+        }
+    }
+    return true;
+}
+
+[[nodiscard]] static bool is_object_argument(GjsArgumentCache* cache) {
+    if (g_type_info_get_tag(&cache->type_info) != GI_TYPE_TAG_INTERFACE)
+        return false;
+
+    GjsAutoBaseInfo interface_info =
+        g_type_info_get_interface(&cache->type_info);
+    GIInfoType info_type = g_base_info_get_type(interface_info);
+    return info_type == GI_INFO_TYPE_OBJECT ||
+           info_type == GI_INFO_TYPE_INTERFACE;
+}
+
+// Refuses what can't be used from another thread: callbacks would call into
+// JS, and the async Promise machinery needs the main thread
+GJS_JSAPI_RETURN_CONVENTION
+static bool check_callable_in_thread(JSContext* cx, Function* function) {
+    int gi_argc = g_callable_info_get_n_args(function->info);
+    for (int gi_arg_pos = 0; gi_arg_pos < gi_argc; gi_arg_pos++) {
+        GjsArgumentCache* cache = &function->arguments[gi_arg_pos];
+        if (g_type_info_get_tag(&cache->type_info) != GI_TYPE_TAG_INTERFACE)
+            continue;
+
+        GjsAutoBaseInfo interface_info =
+            g_type_info_get_interface(&cache->type_info);
+        if (g_base_info_get_type(interface_info) == GI_INFO_TYPE_CALLBACK) {
+            GjsAutoChar name = format_function_name(function);
+            gjs_throw(cx,
+                      "Function %s takes a callback and cannot be called in "
+                      "a thread",
+                      name.get());
+            return false;
+        }
+    }
+    return true;
+}
+
+JSObject* gjs_function_call_in_thread(JSContext* cx,
+                                      JS::HandleObject function_obj,
+                                      const JS::HandleValueArray& args) {
+    Function* function = priv_from_js(cx, function_obj);
+    if (!function) {
+        gjs_throw(cx, "Only introspected functions can be called in a thread");
+        return nullptr;
+    }
+    if (!ensure_function_initialized(cx, function) ||
+        !check_callable_in_thread(cx, function))
+        return nullptr;
+    if (g_callable_info_get_n_args(function->info) >
+        GjsArgumentCache::MAX_ARGS) {
+        GjsAutoChar name = format_function_name(function);
+        gjs_throw(cx, "Function %s has too many arguments", name.get());
+        return nullptr;
+    }
+
+    bool is_method = g_callable_info_is_method(function->info);
+    if (is_method && args.length() == 0) {
+        GjsAutoChar name = format_function_name(function);
+        gjs_throw(cx, "Method %s needs an instance as first argument",
+                  name.get());
+        return nullptr;
+    }
+
+    JS::RootedObject promise(cx, JS::NewPromiseObject(cx, nullptr));
+    if (!promise)
+        return nullptr;
+
+    // Laid out as in a JSNative call, behind the Promise
+    JS::RootedValueVector vp(cx);
+    size_t first_arg = is_method ? 1 : 0;
+    if (!vp.append(JS::ObjectValue(*promise)) ||
+        !vp.append(JS::ObjectValue(*function_obj)) ||
+        !vp.append(is_method ? args[0] : JS::UndefinedValue())) {
+        JS_ReportOutOfMemory(cx);
+        return nullptr;
+    }
+    for (size_t ix = first_arg; ix < args.length(); ix++) {
+        if (!vp.append(args[ix])) {
+            JS_ReportOutOfMemory(cx);
+            return nullptr;
+        }
+    }
+    JS::RootedObject values(cx, JS::NewArrayObject(cx, vp));
+    if (!values)
+        return nullptr;
+
+    JS::CallArgs call_args = JS::CallArgsFromVp(
+        args.length() - first_arg, vp.begin() + 1);
+    if (!check_js_argc(cx, function, call_args))
+        return nullptr;
+
+    auto* call = new GjsThreadedCall(cx, function);
+    GError* error = nullptr;
+    if (!g_function_invoker_new_for_address(function->invoker.native_address,
+                                            function->info, &call->invoker,
+                                            &error)) {
+        delete call;
+        gjs_throw_gerror(cx, error);
+        return nullptr;
+    }
+
+    GjsFunctionCallState state(cx);
+    call->init_state(&state);
+
+    unsigned ffi_arg_pos = 0;
+    int n_processed = 1;  // the return value is always released
+    bool failed = false;
+    if (is_method) {
+        JS::RootedValue instance(cx, call_args.thisv());
+        if (!marshal_in(cx, &function->arguments[-2], &state,
+                        &state.in_cvalues[-2], instance)) {
+            delete call;
+            return nullptr;
+        }
+        call->ffi_arg_pointers[ffi_arg_pos++] = &state.in_cvalues[-2];
+        n_processed++;
+
+        GIBaseInfo* container = g_base_info_get_container(function->info);
+        GIInfoType container_type = g_base_info_get_type(container);
+        if ((container_type == GI_INFO_TYPE_OBJECT ||
+             container_type == GI_INFO_TYPE_INTERFACE) &&
+            !check_object_in_thread(cx, function, "this",
+                                    &state.in_cvalues[-2]))
+            failed = true;
+    }
+
+    unsigned js_arg_pos = 0;
+    for (int gi_arg_pos = 0; !failed && gi_arg_pos < call->gi_argc;
+         gi_arg_pos++, ffi_arg_pos++) {
+        GjsArgumentCache* cache = &function->arguments[gi_arg_pos];
+        GIArgument* in_value = &state.in_cvalues[gi_arg_pos];
+        call->ffi_arg_pointers[ffi_arg_pos] = in_value;
+
+        if (!cache->marshallers->in) {
+            gjs_throw(cx,
+                      "Error invoking %s.%s: impossible to determine what "
+                      "to pass to the '%s' argument.",
+                      g_base_info_get_namespace(function->info),
+                      g_base_info_get_name(function->info), cache->arg_name);
+            failed = true;
+            break;
+        }
+
+        JS::RootedValue js_in_arg(cx);
+        if (js_arg_pos < call_args.length())
+            js_in_arg = call_args[js_arg_pos];
+        if (!marshal_in(cx, cache, &state, in_value, js_in_arg)) {
+            failed = true;
+            break;
+        }
+        if (!cache->skip_in)
+            js_arg_pos++;
+        n_processed++;
+
+        if (!cache->skip_in && is_object_argument(cache) &&
+            !check_object_in_thread(cx, function, cache->arg_name, in_value))
+            failed = true;
+    }
+
+    if (failed) {
+        // The exception from marshalling is the one to report
+        bool released [[maybe_unused]] = call->release(&state, n_processed);
+        delete call;
+        return nullptr;
+    }
+
+    if (g_callable_info_can_throw_gerror(function->info))
+        call->ffi_arg_pointers[ffi_arg_pos++] = &call->errorp;
+    g_assert(ffi_arg_pos == function->invoker.cif.nargs);
+
+    call->return_value_p = get_return_ffi_pointer_from_giargument(
+        &function->arguments[-1], &call->return_value);
+    call->values.root(cx, values, threaded_call_context_destroyed, call);
+
+    if (!s_threaded_call_pool) {
+        s_threaded_call_pool =
+            g_thread_pool_new(threaded_call_run, nullptr,
+                              g_get_num_processors(), false, nullptr);
+    }
+    s_threaded_calls.push_back(call);
+    g_thread_pool_push(s_threaded_call_pool, call, nullptr);
+    return promise;
+}
+
+void gjs_cancel_threaded_calls(JSContext* cx) {
+    if (!s_threaded_call_pool)
+        return;
+
+    // Drops the calls that haven't started, and waits for the running ones,
+    // which can't be interrupted
+    g_thread_pool_free(std::exchange(s_threaded_call_pool, nullptr),
+                       /* immediate = */ true, /* wait = */ true);
+
+    // The in arguments are released; the out values of calls that completed
+    // are leaked, since there is nothing left to hand them to
+    for (GjsThreadedCall* call : std::exchange(s_threaded_calls, {})) {
+        JSAutoRealm ar(cx, call->values);
+        GjsFunctionCallState state(cx);
+        call->init_state(&state);
+        if (!call->release(&state, call->frame_size))
+            gjs_log_exception(cx);
+        delete call;
+    }
+}
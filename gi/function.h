@@ -27,11 +27,13 @@
 #include <config.h>
 
 #include <ffi.h>
+#include <gio/gio.h>
 #include <girepository.h>
 #include <glib-object.h>
 
 #include <js/RootingAPI.h>
 #include <js/TypeDecls.h>
+#include <js/ValueArray.h>
 
 #include "cjs/macros.h"
 
@@ -47,6 +49,20 @@ typedef enum {
     PARAM_UNKNOWN,
 } GjsParamType;
 
+// One argument of a callback or vfunc, worked out when the trampoline is
+// created so that invoking it doesn't load anything from the typelib
+struct GjsCallbackArg {
+    GIArgInfo arg_info;
+    GITypeInfo type_info;
+    GIDirection direction;
+    GjsParamType param_type;
+    int array_length_pos;  // for PARAM_ARRAY
+    bool is_void;          // e.g. user data; not passed to JS
+    // Set for scalar in-arguments, which are converted directly instead of
+    // through gjs_value_from_g_argument()
+    void (*from_c)(JS::MutableHandleValue value, GIArgument* arg);
+};
+
 struct GjsCallbackTrampoline {
     int ref_count;
     GICallableInfo *info;
@@ -57,7 +73,14 @@ struct GjsCallbackTrampoline {
     ffi_closure *closure;
     GIScopeType scope;
     bool is_vfunc;
-    GjsParamType *param_types;
+
+    int n_args;
+    GjsCallbackArg* args;
+    int n_outargs;
+    GITypeInfo ret_type;
+    bool ret_type_is_void;
+    bool can_throw_gerror;
+    GITransfer caller_owns;
 };
 
 GJS_JSAPI_RETURN_CONVENTION
@@ -67,6 +90,9 @@ GjsCallbackTrampoline* gjs_callback_trampoline_new(
 
 void gjs_callback_trampoline_unref(GjsCallbackTrampoline *trampoline);
 void gjs_callback_trampoline_ref(GjsCallbackTrampoline *trampoline);
+void gjs_callback_trampoline_clear_pool(void);
+
+void gjs_function_clear_async_closures(void);
 
 // Stack allocation only!
 struct GjsFunctionCallState {
@@ -74,12 +100,27 @@ struct GjsFunctionCallState {
     GIArgument* out_cvalues;
     GIArgument* inout_original_cvalues;
     JS::RootedObject instance_object;
+    // Set if the async callback was left out; returned instead of the
+    // function's (void) return value
+    JS::RootedObject promise;
     bool call_completed;
 
     explicit GjsFunctionCallState(JSContext* cx)
-        : instance_object(cx), call_completed(false) {}
+        : instance_object(cx), promise(cx), call_completed(false) {}
 };
 
+// Creates a Promise for an async function called without its callback. Pass
+// gjs_async_promise_callback as the GAsyncReadyCallback with *@data_out as
+// its user data, and the Promise is settled with the result of @finish_info.
+// If the call fails and the callback will never be called, then free
+// *@data_out with gjs_async_promise_free().
+GJS_JSAPI_RETURN_CONVENTION
+JSObject* gjs_async_promise_new(JSContext* cx, GIFunctionInfo* finish_info,
+                                void** data_out);
+void gjs_async_promise_callback(GObject* source, GAsyncResult* result,
+                                void* data);
+void gjs_async_promise_free(void* data);
+
 GJS_JSAPI_RETURN_CONVENTION
 JSObject *gjs_define_function(JSContext       *context,
                               JS::HandleObject in_object,
@@ -92,4 +133,22 @@ bool gjs_invoke_constructor_from_c(JSContext* cx, GIFunctionInfo* info,
                                    const JS::CallArgs& args,
                                    GIArgument* rvalue);
 
+// Calls the introspected function @function with @args, running the C
+// function on a thread pool, and returns a Promise that is settled on the main
+// loop with the return value and out arguments, as they would be returned from
+// a normal call. For a method, the instance is the first of @args. The
+// arguments are marshalled and released on the calling thread, so they must
+// only be plain data, boxed types, or GObjects that are safe to use from
+// another thread. Functions that take callbacks, and GObjects whose class is
+// implemented in JS, are refused.
+GJS_JSAPI_RETURN_CONVENTION
+JSObject* gjs_function_call_in_thread(JSContext* cx,
+                                      JS::HandleObject function,
+                                      const JS::HandleValueArray& args);
+
+// Drops the calls from gjs_function_call_in_thread() that haven't started yet,
+// waits for the running ones, and releases their arguments; their Promises are
+// never settled. Called when the context is destroyed.
+void gjs_cancel_threaded_calls(JSContext* cx);
+
 #endif  // GI_FUNCTION_H_
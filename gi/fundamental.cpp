@@ -143,8 +143,8 @@ bool FundamentalPrototype::resolve_interface(JSContext* cx,
 // See GIWrapperBase::resolve().
 bool FundamentalPrototype::resolve_impl(JSContext* cx, JS::HandleObject obj,
                                         JS::HandleId id, bool* resolved) {
-    JS::UniqueChars prop_name;
-    if (!gjs_get_string_id(cx, id, &prop_name))
+    const char* prop_name;
+    if (!gjs_get_interned_string_id(cx, id, &prop_name))
         return false;
     if (!prop_name) {
         *resolved = false;
@@ -153,7 +153,7 @@ bool FundamentalPrototype::resolve_impl(JSContext* cx, JS::HandleObject obj,
 
     /* We are the prototype, so look for methods and other class properties */
     GjsAutoFunctionInfo method_info =
-        g_object_info_find_method(info(), prop_name.get());
+        g_object_info_find_method(info(), prop_name);
 
     if (method_info) {
 #if GJS_VERBOSE_ENABLE_GI_USAGE
@@ -183,7 +183,7 @@ bool FundamentalPrototype::resolve_impl(JSContext* cx, JS::HandleObject obj,
         *resolved = false;
     }
 
-    return resolve_interface(cx, obj, resolved, prop_name.get());
+    return resolve_interface(cx, obj, resolved, prop_name);
 }
 
 /*
@@ -335,16 +335,34 @@ static JSObject*
 gjs_lookup_fundamental_prototype_from_gtype(JSContext *context,
                                             GType      gtype)
 {
+    // This is done every time a fundamental instance without a wrapper, such
+    // as a GstMiniObject, is marshalled, so remember the prototype (and with
+    // it the ref, unref, and GValue functions) for each GType
+    GjsContextPrivate* gjs = GjsContextPrivate::from_cx(context);
+    if (auto p = gjs->fundamental_prototype_table().lookup(gtype))
+        return p->value();
+
     GjsAutoObjectInfo info;
+    GType lookup_gtype = gtype;
 
     /* A given gtype might not have any definition in the introspection
      * data. If that's the case, try to look for a definition of any of the
      * parent type. */
-    while (gtype != G_TYPE_INVALID &&
-           !(info = g_irepository_find_by_gtype(nullptr, gtype)))
-        gtype = g_type_parent(gtype);
+    while (lookup_gtype != G_TYPE_INVALID &&
+           !(info = g_irepository_find_by_gtype(nullptr, lookup_gtype)))
+        lookup_gtype = g_type_parent(lookup_gtype);
+
+    JS::RootedObject proto(
+        context, gjs_lookup_fundamental_prototype(context, info, lookup_gtype));
+    if (!proto)
+        return nullptr;
+
+    if (!gjs->fundamental_prototype_table().put(gtype, proto)) {
+        JS_ReportOutOfMemory(context);
+        return nullptr;
+    }
 
-    return gjs_lookup_fundamental_prototype(context, info, gtype);
+    return proto;
 }
 
 // Overrides GIWrapperPrototype::get_parent_proto().
@@ -136,6 +136,54 @@ bool ErrorBase::get_code(JSContext* cx, unsigned argc, JS::Value* vp) {
     return true;
 }
 
+/*
+ * ErrorBase::get_stack_property:
+ *
+ * JSNative property getter for `stack`, `fileName`, `lineNumber`, and
+ * `columnNumber`. Builds these properties from the saved stack, the first time
+ * one of them is read.
+ */
+template <GjsAtomGetter atom>
+bool ErrorBase::get_stack_property(JSContext* cx, unsigned argc,
+                                   JS::Value* vp) {
+    GJS_GET_WRAPPER_PRIV(cx, argc, vp, args, obj, ErrorBase, priv);
+    if (priv->is_prototype()) {
+        args.rval().setUndefined();
+        return true;
+    }
+    if (!define_saved_frame_properties(cx, obj))
+        return false;
+
+    // Without a saved stack, there is nothing to shadow this getter with
+    const GjsAtoms& atoms = GjsContextPrivate::atoms(cx);
+    bool found;
+    if (!JS_HasOwnPropertyById(cx, obj, (atoms.*atom)(), &found))
+        return false;
+    if (!found) {
+        args.rval().setUndefined();
+        return true;
+    }
+    return JS_GetPropertyById(cx, obj, (atoms.*atom)(), args.rval());
+}
+
+// JSNative property setter for the same properties as get_stack_property().
+template <GjsAtomGetter atom>
+bool ErrorBase::set_stack_property(JSContext* cx, unsigned argc,
+                                   JS::Value* vp) {
+    GJS_GET_WRAPPER_PRIV(cx, argc, vp, args, obj, ErrorBase, priv);
+    if (!priv->check_is_instance(cx, "set a field") ||
+        !define_saved_frame_properties(cx, obj))
+        return false;
+
+    const GjsAtoms& atoms = GjsContextPrivate::atoms(cx);
+    if (!JS_DefinePropertyById(cx, obj, (atoms.*atom)(), args[0],
+                               JSPROP_ENUMERATE))
+        return false;
+
+    args.rval().setUndefined();
+    return true;
+}
+
 // JSNative implementation of `toString()`.
 bool ErrorBase::to_string(JSContext* context, unsigned argc, JS::Value* vp) {
     GJS_GET_THIS(context, argc, vp, rec, self);
@@ -209,7 +257,8 @@ const struct JSClassOps ErrorBase::class_ops = {
 
 const struct JSClass ErrorBase::klass = {
     "GLib_Error",
-    JSCLASS_HAS_PRIVATE | JSCLASS_BACKGROUND_FINALIZE,
+    JSCLASS_HAS_PRIVATE | JSCLASS_BACKGROUND_FINALIZE |
+        JSCLASS_HAS_RESERVED_SLOTS(1),
     &ErrorBase::class_ops
 };
 
@@ -219,6 +268,20 @@ JSPropertySpec ErrorBase::proto_properties[] = {
     JS_PSG("domain", &ErrorBase::get_domain, GJS_MODULE_PROP_FLAGS),
     JS_PSG("code", &ErrorBase::get_code, GJS_MODULE_PROP_FLAGS),
     JS_PSG("message", &ErrorBase::get_message, GJS_MODULE_PROP_FLAGS),
+    JS_PSGS("stack", &ErrorBase::get_stack_property<&GjsAtoms::stack>,
+            &ErrorBase::set_stack_property<&GjsAtoms::stack>,
+            GJS_MODULE_PROP_FLAGS),
+    JS_PSGS("fileName", &ErrorBase::get_stack_property<&GjsAtoms::file_name>,
+            &ErrorBase::set_stack_property<&GjsAtoms::file_name>,
+            GJS_MODULE_PROP_FLAGS),
+    JS_PSGS("lineNumber",
+            &ErrorBase::get_stack_property<&GjsAtoms::line_number>,
+            &ErrorBase::set_stack_property<&GjsAtoms::line_number>,
+            GJS_MODULE_PROP_FLAGS),
+    JS_PSGS("columnNumber",
+            &ErrorBase::get_stack_property<&GjsAtoms::column_number>,
+            &ErrorBase::set_stack_property<&GjsAtoms::column_number>,
+            GJS_MODULE_PROP_FLAGS),
     JS_PS_END
 };
 
@@ -285,18 +348,17 @@ bool ErrorPrototype::define_class(JSContext* context,
     return info;
 }
 
-/* define properties that JS Error() expose, such as
-   fileName, lineNumber and stack
-*/
+// Defines the properties that JS Error() exposes, such as fileName, lineNumber
+// and stack, from the stack in @frame
 GJS_JSAPI_RETURN_CONVENTION
-bool gjs_define_error_properties(JSContext* cx, JS::HandleObject obj) {
-    JS::RootedObject frame(cx);
+static bool define_error_properties_from_frame(JSContext* cx,
+                                               JS::HandleObject obj,
+                                               JS::HandleObject frame) {
     JS::RootedString stack(cx);
     JS::RootedString source(cx);
     uint32_t line, column;
 
-    if (!JS::CaptureCurrentStack(cx, &frame) ||
-        !JS::BuildStackString(cx, nullptr, frame, &stack))
+    if (!JS::BuildStackString(cx, nullptr, frame, &stack))
         return false;
 
     auto ok = JS::SavedFrameResult::Ok;
@@ -318,6 +380,44 @@ bool gjs_define_error_properties(JSContext* cx, JS::HandleObject obj) {
                                  JSPROP_ENUMERATE);
 }
 
+/*
+ * ErrorBase::define_saved_frame_properties:
+ *
+ * Defines the properties built from the stack that an ErrorInstance saved when
+ * it was created, unless that was already done. They become plain properties
+ * of the instance, shadowing the accessors on the prototype.
+ */
+bool ErrorBase::define_saved_frame_properties(JSContext* cx,
+                                              JS::HandleObject obj) {
+    JS::Value slot = JS_GetReservedSlot(obj, SAVED_FRAME_SLOT);
+    if (!slot.isObject())
+        return true;
+
+    JS::RootedObject frame(cx, &slot.toObject());
+    JS_SetReservedSlot(obj, SAVED_FRAME_SLOT, JS::UndefinedValue());
+    return define_error_properties_from_frame(cx, obj, frame);
+}
+
+/* define properties that JS Error() expose, such as
+   fileName, lineNumber and stack
+*/
+GJS_JSAPI_RETURN_CONVENTION
+bool gjs_define_error_properties(JSContext* cx, JS::HandleObject obj) {
+    JS::RootedObject frame(cx);
+    if (!JS::CaptureCurrentStack(cx, &frame))
+        return false;
+
+    // GError wrappers only build the strings when they are first used, which
+    // for errors that are caught and handled is often never
+    if (frame && ErrorBase::for_js(cx, obj)) {
+        JS_SetReservedSlot(obj, ErrorBase::SAVED_FRAME_SLOT,
+                           JS::ObjectValue(*frame));
+        return true;
+    }
+
+    return define_error_properties_from_frame(cx, obj, frame);
+}
+
 [[nodiscard]] static JSProtoKey proto_key_from_error_enum(int val) {
     switch (val) {
     case GJS_JS_ERROR_EVAL_ERROR:
@@ -366,27 +466,45 @@ JSObject* ErrorInstance::object_for_c_ptr(JSContext* context, GError* gerror) {
     if (gerror->domain == GJS_JS_ERROR)
         return gjs_error_from_js_gerror(context, gerror);
 
-    info = find_error_domain_info(gerror->domain);
+    // Looking up the prototype through the typelib and the namespace objects
+    // is slow compared to creating the error, so remember it per domain
+    GjsContextPrivate* gjs = GjsContextPrivate::from_cx(context);
+    JS::RootedObject proto(context);
+    if (auto p = gjs->error_domain_table().lookup(gerror->domain)) {
+        proto = p->value();
+    } else {
+        info = find_error_domain_info(gerror->domain);
+
+        if (!info) {
+            /* We don't have error domain metadata */
+            /* Marshal the error as a plain GError */
+            GIBaseInfo *glib_boxed;
+            JSObject *retval;
 
-    if (!info) {
-        /* We don't have error domain metadata */
-        /* Marshal the error as a plain GError */
-        GIBaseInfo *glib_boxed;
-        JSObject *retval;
+            glib_boxed = g_irepository_find_by_name(nullptr, "GLib", "Error");
+            retval =
+                BoxedInstance::new_for_c_struct(context, glib_boxed, gerror);
 
-        glib_boxed = g_irepository_find_by_name(nullptr, "GLib", "Error");
-        retval = BoxedInstance::new_for_c_struct(context, glib_boxed, gerror);
+            g_base_info_unref(glib_boxed);
+            return retval;
+        }
 
-        g_base_info_unref(glib_boxed);
-        return retval;
+        proto = gjs_lookup_generic_prototype(context, info);
+        g_base_info_unref(info);
+        if (!proto)
+            return nullptr;
+
+        if (!gjs->error_domain_table().put(gerror->domain, proto)) {
+            JS_ReportOutOfMemory(context);
+            return nullptr;
+        }
     }
 
-    gjs_debug_marshal(GJS_DEBUG_GBOXED,
-                      "Wrapping struct %s with JSObject",
-                      g_base_info_get_name((GIBaseInfo *)info));
+    gjs_debug_marshal(GJS_DEBUG_GBOXED, "Wrapping struct %s with JSObject",
+                      ErrorPrototype::for_js(context, proto)->name());
 
-    JS::RootedObject obj(context,
-                         gjs_new_object_with_generic_prototype(context, info));
+    JS::RootedObject obj(context, JS_NewObjectWithGivenProto(
+                                      context, JS_GetClass(proto), proto));
     if (!obj)
         return nullptr;
 
@@ -34,6 +34,7 @@
 #include <js/TypeDecls.h>
 
 #include "gi/wrapperutils.h"
+#include "cjs/atoms.h"
 #include "cjs/macros.h"
 #include "util/log.h"
 
@@ -88,6 +89,14 @@ class ErrorBase
     static bool get_message(JSContext* cx, unsigned argc, JS::Value* vp);
     GJS_JSAPI_RETURN_CONVENTION
     static bool get_code(JSContext* cx, unsigned argc, JS::Value* vp);
+    template <GjsAtomGetter atom>
+    GJS_JSAPI_RETURN_CONVENTION static bool get_stack_property(JSContext* cx,
+                                                               unsigned argc,
+                                                               JS::Value* vp);
+    template <GjsAtomGetter atom>
+    GJS_JSAPI_RETURN_CONVENTION static bool set_stack_property(JSContext* cx,
+                                                               unsigned argc,
+                                                               JS::Value* vp);
 
     // JS methods
 
@@ -100,6 +109,14 @@ class ErrorBase
 
     // Helper methods
 
+    // Reserved slot of instances holding the stack captured when they were
+    // created, until the properties built from it are first used
+    static constexpr unsigned SAVED_FRAME_SLOT = 0;
+
+    GJS_JSAPI_RETURN_CONVENTION
+    static bool define_saved_frame_properties(JSContext* cx,
+                                              JS::HandleObject obj);
+
     GJS_JSAPI_RETURN_CONVENTION
     static GError* to_c_ptr(JSContext* cx, JS::HandleObject obj);
 
@@ -34,10 +34,15 @@
 #include "gjs_gi_probes.h"
 #define TRACE(probe) probe
 
+/* True while a tracer is attached to the probe; use it to skip computing
+ * arguments that are not free, e.g. TRACE_ENABLED(GJS_GC_BEGIN) */
+#define TRACE_ENABLED(probe) (probe##_ENABLED())
+
 #else
 
 /* Wrap the probe to allow it to be removed when no systemtap available */
 #define TRACE(probe)
+#define TRACE_ENABLED(probe) false
 
 #endif
 
@@ -41,6 +41,7 @@
 #include <mozilla/HashTable.h>
 
 #include "gi/gtype.h"
+#include "gi/repo.h"
 #include "cjs/atoms.h"
 #include "cjs/context-private.h"
 #include "cjs/jsapi-class.h"
@@ -159,6 +160,9 @@ static bool _gjs_gtype_get_actual_gtype(JSContext* context,
         return true;
     }
 
+    if (gjs_wrapper_get_gtype(context, object, gtype_out))
+        return true;
+
     JS::RootedValue gtype_val(context);
 
     /* OK, we don't have a GType wrapper object -- grab the "$gtype"
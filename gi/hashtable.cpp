@@ -0,0 +1,158 @@
+/* -*- mode: C++; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * SPDX-License-Identifier: MIT OR LGPL-2.0-or-later
+ */
+
+#include <config.h>
+
+#include <girepository.h>
+#include <glib.h>
+
+#include <js/CallArgs.h>
+#include <js/Class.h>
+#include <js/PropertyDescriptor.h>  // for JSPROP_PERMANENT
+#include <js/PropertySpec.h>
+#include <js/RootingAPI.h>
+#include <js/TypeDecls.h>
+#include <jsapi.h>  // for JS_NewObjectWithGivenProto, JS_SetPrivate
+
+#include "gi/arg.h"
+#include "gi/hashtable.h"
+#include "cjs/jsapi-class.h"
+#include "cjs/jsapi-util.h"
+#include "cjs/macros.h"
+
+struct HashTableView {
+    GHashTable* hash;
+    GjsAutoTypeInfo key_info;
+    GjsAutoTypeInfo val_info;
+};
+
+[[nodiscard]] [[maybe_unused]] static JSObject* gjs_hash_table_view_get_proto(
+    JSContext*);
+GJS_JSAPI_RETURN_CONVENTION
+static bool gjs_hash_table_view_define_proto(JSContext*, JS::HandleObject,
+                                             JS::MutableHandleObject);
+
+GJS_DEFINE_PROTO_ABSTRACT("GLibHashTableView", hash_table_view,
+                          JSCLASS_FOREGROUND_FINALIZE);
+
+GJS_DEFINE_PRIV_FROM_JS(HashTableView, gjs_hash_table_view_class);
+
+static void gjs_hash_table_view_finalize(JSFreeOp*, JSObject* obj) {
+    auto* priv = static_cast<HashTableView*>(JS_GetPrivate(obj));
+    if (!priv)
+        return;  // prototype
+
+    g_hash_table_unref(priv->hash);
+    delete priv;
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool require_priv(JSContext* cx, HashTableView* priv) {
+    if (priv)
+        return true;
+    gjs_throw(cx, "GLibHashTableView prototype has no hash table");
+    return false;
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool get_func(JSContext* cx, unsigned argc, JS::Value* vp) {
+    GJS_GET_PRIV(cx, argc, vp, args, obj, HashTableView, priv);
+    if (!require_priv(cx, priv))
+        return false;
+
+    bool found;
+    return gjs_value_from_g_hash_lookup(cx, args.rval(), priv->key_info,
+                                        priv->val_info, priv->hash,
+                                        args.get(0), &found);
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool has_func(JSContext* cx, unsigned argc, JS::Value* vp) {
+    GJS_GET_PRIV(cx, argc, vp, args, obj, HashTableView, priv);
+    if (!require_priv(cx, priv))
+        return false;
+
+    // The found value is converted and thrown away; it is usually cheap
+    // compared to converting the whole table
+    bool found;
+    JS::RootedValue unused(cx);
+    if (!gjs_value_from_g_hash_lookup(cx, &unused, priv->key_info,
+                                      priv->val_info, priv->hash, args.get(0),
+                                      &found))
+        return false;
+
+    args.rval().setBoolean(found);
+    return true;
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool keys_func(JSContext* cx, unsigned argc, JS::Value* vp) {
+    GJS_GET_PRIV(cx, argc, vp, args, obj, HashTableView, priv);
+    if (!require_priv(cx, priv))
+        return false;
+
+    return gjs_array_from_g_hash_keys(cx, args.rval(), priv->key_info,
+                                      priv->hash);
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool to_object_func(JSContext* cx, unsigned argc, JS::Value* vp) {
+    GJS_GET_PRIV(cx, argc, vp, args, obj, HashTableView, priv);
+    if (!require_priv(cx, priv))
+        return false;
+
+    return gjs_object_from_g_hash(cx, args.rval(), priv->key_info,
+                                  priv->val_info, priv->hash);
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool get_size_func(JSContext* cx, unsigned argc, JS::Value* vp) {
+    GJS_GET_PRIV(cx, argc, vp, args, obj, HashTableView, priv);
+    if (!require_priv(cx, priv))
+        return false;
+
+    args.rval().setNumber(g_hash_table_size(priv->hash));
+    return true;
+}
+
+JSPropertySpec gjs_hash_table_view_proto_props[] = {
+    JS_PSG("size", get_size_func, JSPROP_PERMANENT),
+    JS_STRING_SYM_PS(toStringTag, "GLibHashTableView", JSPROP_READONLY),
+    JS_PS_END,
+};
+
+JSFunctionSpec gjs_hash_table_view_proto_funcs[] = {
+    JS_FN("get", get_func, 1, 0),
+    JS_FN("has", has_func, 1, 0),
+    JS_FN("keys", keys_func, 0, 0),
+    JS_FN("toObject", to_object_func, 0, 0),
+    JS_FS_END};
+
+JSFunctionSpec gjs_hash_table_view_static_funcs[] = {JS_FS_END};
+
+bool gjs_hash_table_view_new(JSContext* cx, JS::MutableHandleValue value_p,
+                             GITypeInfo* type_info, GHashTable* hash) {
+    if (!hash) {
+        value_p.setNull();
+        return true;
+    }
+
+    JS::RootedObject proto(cx);
+    if (!gjs_hash_table_view_define_proto(cx, nullptr, &proto))
+        return false;
+
+    JS::RootedObject view(cx, JS_NewObjectWithGivenProto(
+                                  cx, &gjs_hash_table_view_class, proto));
+    if (!view)
+        return false;
+
+    auto* priv = new HashTableView{g_hash_table_ref(hash),
+                                   g_type_info_get_param_type(type_info, 0),
+                                   g_type_info_get_param_type(type_info, 1)};
+    JS_SetPrivate(view, priv);
+
+    value_p.setObject(*view);
+    return true;
+}
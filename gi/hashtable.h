@@ -0,0 +1,26 @@
+/* -*- mode: C++; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * SPDX-License-Identifier: MIT OR LGPL-2.0-or-later
+ */
+
+#ifndef GI_HASHTABLE_H_
+#define GI_HASHTABLE_H_
+
+#include <config.h>
+
+#include <girepository.h>
+#include <glib.h>
+
+#include <js/TypeDecls.h>
+
+#include "cjs/macros.h"
+
+// Wraps @hash, whose keys and values are described by the GHashTable
+// @type_info, in a JS object that converts entries only when they are asked
+// for. The object keeps a reference to the table, so this is only suitable for
+// tables that the caller doesn't own (transfer none.)
+GJS_JSAPI_RETURN_CONVENTION
+bool gjs_hash_table_view_new(JSContext* cx, JS::MutableHandleValue value_p,
+                             GITypeInfo* type_info, GHashTable* hash);
+
+#endif  // GI_HASHTABLE_H_
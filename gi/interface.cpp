@@ -60,8 +60,8 @@ bool InterfacePrototype::resolve_impl(JSContext* context, JS::HandleObject obj,
         return true;
     }
 
-    JS::UniqueChars prop_name;
-    if (!gjs_get_string_id(context, id, &prop_name))
+    const char* prop_name;
+    if (!gjs_get_interned_string_id(context, id, &prop_name))
         return false;
     if (!prop_name) {
         *resolved = false;
@@ -69,7 +69,7 @@ bool InterfacePrototype::resolve_impl(JSContext* context, JS::HandleObject obj,
     }
 
     GjsAutoFunctionInfo method_info =
-        g_interface_info_find_method(m_info, prop_name.get());
+        g_interface_info_find_method(m_info, prop_name);
 
     if (method_info) {
         if (g_function_info_get_flags (method_info) & GI_FUNCTION_IS_METHOD) {
@@ -0,0 +1,241 @@
+/* -*- mode: C++; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * SPDX-License-Identifier: MIT OR LGPL-2.0-or-later
+ */
+
+#include <config.h>
+
+#include <vector>
+
+#include <girepository.h>
+#include <glib.h>
+
+#include <js/CallArgs.h>
+#include <js/Class.h>
+#include <js/PropertyDescriptor.h>  // for JSPROP_PERMANENT
+#include <js/PropertySpec.h>
+#include <js/RootingAPI.h>
+#include <js/TypeDecls.h>
+#include <jsapi.h>  // for JS_NewPlainObject, JS_ClearPendingException
+
+#include "gi/arg-inl.h"
+#include "gi/arg.h"
+#include "gi/listiterator.h"
+#include "cjs/atoms.h"
+#include "cjs/context-private.h"
+#include "cjs/jsapi-class.h"
+#include "cjs/jsapi-util.h"
+#include "cjs/macros.h"
+
+struct ListIterator {
+    // Only used to release the list from the finalizer
+    JSContext* cx;
+    GjsAutoTypeInfo param_info;
+    GITransfer transfer;
+    bool is_slist;
+
+    void* list;  // owned according to transfer, null once released
+    void* current;
+};
+
+[[nodiscard]] [[maybe_unused]] static JSObject* gjs_list_iterator_get_proto(
+    JSContext*);
+GJS_JSAPI_RETURN_CONVENTION
+static bool gjs_list_iterator_define_proto(JSContext*, JS::HandleObject,
+                                           JS::MutableHandleObject);
+
+GJS_DEFINE_PROTO_ABSTRACT("GLibListIterator", list_iterator,
+                          JSCLASS_FOREGROUND_FINALIZE);
+
+GJS_DEFINE_PRIV_FROM_JS(ListIterator, gjs_list_iterator_class);
+
+template <typename ListT>
+GJS_JSAPI_RETURN_CONVENTION static bool release_elements(JSContext* cx,
+                                                         ListIterator* priv,
+                                                         ListT* list) {
+    bool failed = false;
+    for (; list; list = list->next) {
+        GIArgument elem;
+        gjs_arg_set(&elem, list->data);
+        if (!gjs_g_argument_release(cx, priv->transfer, priv->param_info,
+                                    &elem))
+            failed = true;
+    }
+    return !failed;
+}
+
+// Frees the list and, with transfer full, all of its elements; converting an
+// element copies it, so this includes the ones that were already returned.
+// This is the same as releasing the list GIArgument, but we can't keep a
+// reference to the list's own type info, as it belongs to the argument cache.
+GJS_JSAPI_RETURN_CONVENTION
+static bool release_list(JSContext* cx, ListIterator* priv) {
+    priv->current = nullptr;
+    if (!priv->list)
+        return true;
+
+    bool ok = true;
+    if (priv->is_slist) {
+        auto* slist = static_cast<GSList*>(priv->list);
+        if (priv->transfer != GI_TRANSFER_CONTAINER)
+            ok = release_elements(cx, priv, slist);
+        g_slist_free(slist);
+    } else {
+        auto* list = static_cast<GList*>(priv->list);
+        if (priv->transfer != GI_TRANSFER_CONTAINER)
+            ok = release_elements(cx, priv, list);
+        g_list_free(list);
+    }
+    priv->list = nullptr;
+
+    return ok;
+}
+
+// Releasing the elements of a list can drop the last reference to GObjects,
+// which must not happen while the GC is sweeping, so the lists of collected
+// iterators are released from the main loop, or before the next GC
+static thread_local std::vector<ListIterator*> s_pending_releases;
+static thread_local unsigned s_release_idle_id = 0;
+
+void gjs_list_iterator_release_pending() {
+    if (s_release_idle_id) {
+        g_source_remove(s_release_idle_id);
+        s_release_idle_id = 0;
+    }
+
+    // Swap the list out first, since releasing may finalize more iterators
+    std::vector<ListIterator*> pending;
+    pending.swap(s_pending_releases);
+    for (ListIterator* priv : pending) {
+        if (!release_list(priv->cx, priv))
+            JS_ClearPendingException(priv->cx);
+        delete priv;
+    }
+}
+
+static gboolean release_pending_idle_handler(void*) {
+    s_release_idle_id = 0;
+    gjs_list_iterator_release_pending();
+    return G_SOURCE_REMOVE;
+}
+
+static void gjs_list_iterator_finalize(JSFreeOp*, JSObject* obj) {
+    auto* priv = static_cast<ListIterator*>(JS_GetPrivate(obj));
+    if (!priv)
+        return;  // prototype
+
+    if (!priv->list) {
+        delete priv;
+        return;
+    }
+
+    s_pending_releases.push_back(priv);
+    if (!s_release_idle_id) {
+        GjsAutoPointer<GSource, GSource, g_source_unref> source =
+            g_idle_source_new();
+        g_source_set_priority(source, G_PRIORITY_LOW);
+        g_source_set_callback(source, release_pending_idle_handler, nullptr,
+                              nullptr);
+        s_release_idle_id =
+            g_source_attach(source, g_main_context_get_thread_default());
+    }
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool iterator_result(JSContext* cx, JS::HandleValue value, bool done,
+                            JS::MutableHandleValue rval) {
+    const GjsAtoms& atoms = GjsContextPrivate::atoms(cx);
+    JS::RootedObject result(cx, JS_NewPlainObject(cx));
+    if (!result ||
+        !JS_DefinePropertyById(cx, result, atoms.value(), value,
+                               JSPROP_ENUMERATE) ||
+        !JS_DefinePropertyById(cx, result, atoms.done(),
+                               done ? JS::TrueHandleValue : JS::FalseHandleValue,
+                               JSPROP_ENUMERATE))
+        return false;
+
+    rval.setObject(*result);
+    return true;
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool next_func(JSContext* cx, unsigned argc, JS::Value* vp) {
+    GJS_GET_PRIV(cx, argc, vp, args, obj, ListIterator, priv);
+    if (!priv || !priv->current) {
+        if (priv && !release_list(cx, priv))
+            return false;
+        return iterator_result(cx, JS::UndefinedHandleValue, true, args.rval());
+    }
+
+    void* data;
+    if (priv->is_slist) {
+        auto* node = static_cast<GSList*>(priv->current);
+        data = node->data;
+        priv->current = node->next;
+    } else {
+        auto* node = static_cast<GList*>(priv->current);
+        data = node->data;
+        priv->current = node->next;
+    }
+
+    JS::RootedValue value(cx);
+    if (!gjs_value_from_g_list_element(cx, &value, priv->param_info, data))
+        return false;
+    return iterator_result(cx, value, false, args.rval());
+}
+
+// Called by for...of when the loop is exited early
+GJS_JSAPI_RETURN_CONVENTION
+static bool return_func(JSContext* cx, unsigned argc, JS::Value* vp) {
+    GJS_GET_PRIV(cx, argc, vp, args, obj, ListIterator, priv);
+    if (priv && !release_list(cx, priv))
+        return false;
+    return iterator_result(cx, args.get(0), true, args.rval());
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool iterator_func(JSContext*, unsigned argc, JS::Value* vp) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+    args.rval().set(args.thisv());
+    return true;
+}
+
+JSPropertySpec gjs_list_iterator_proto_props[] = {
+    JS_STRING_SYM_PS(toStringTag, "GLibListIterator", JSPROP_READONLY),
+    JS_PS_END,
+};
+
+JSFunctionSpec gjs_list_iterator_proto_funcs[] = {
+    JS_FN("next", next_func, 0, 0),
+    JS_FN("return", return_func, 1, 0),
+    JS_SYM_FN(iterator, iterator_func, 0, 0),
+    JS_FS_END};
+
+JSFunctionSpec gjs_list_iterator_static_funcs[] = {JS_FS_END};
+
+bool gjs_list_iterator_new(JSContext* cx, JS::MutableHandleValue value_p,
+                           GITypeInfo* type_info, GITransfer transfer,
+                           void* list) {
+    g_assert(transfer != GI_TRANSFER_NOTHING);
+
+    JS::RootedObject proto(cx);
+    if (!gjs_list_iterator_define_proto(cx, nullptr, &proto))
+        return false;
+
+    JS::RootedObject iter(cx, JS_NewObjectWithGivenProto(
+                                  cx, &gjs_list_iterator_class, proto));
+    if (!iter)
+        return false;
+
+    auto* priv = new ListIterator{
+        cx,
+        g_type_info_get_param_type(type_info, 0),
+        transfer,
+        g_type_info_get_tag(type_info) == GI_TYPE_TAG_GSLIST,
+        list,
+        list};
+    JS_SetPrivate(iter, priv);
+
+    value_p.setObject(*iter);
+    return true;
+}
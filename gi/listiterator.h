@@ -0,0 +1,32 @@
+/* -*- mode: C++; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * SPDX-License-Identifier: MIT OR LGPL-2.0-or-later
+ */
+
+#ifndef GI_LISTITERATOR_H_
+#define GI_LISTITERATOR_H_
+
+#include <config.h>
+
+#include <girepository.h>
+
+#include <js/TypeDecls.h>
+
+#include "cjs/macros.h"
+
+// Wraps @list, a GList or GSList described by @type_info, in a JS iterator that
+// converts elements one at a time. The iterator takes over the caller's
+// ownership of the list according to @transfer, which must not be
+// GI_TRANSFER_NOTHING, and releases it once iteration finishes, is stopped
+// with return(), or the iterator is collected.
+GJS_JSAPI_RETURN_CONVENTION
+bool gjs_list_iterator_new(JSContext* cx, JS::MutableHandleValue value_p,
+                           GITypeInfo* type_info, GITransfer transfer,
+                           void* list);
+
+// Releases the lists of iterators that were collected, which is otherwise done
+// from an idle callback. Called before each GC and when the context is
+// destroyed.
+void gjs_list_iterator_release_pending();
+
+#endif  // GI_LISTITERATOR_H_
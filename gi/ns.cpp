@@ -23,17 +23,24 @@
 
 #include <config.h>
 
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
 #include <girepository.h>
 #include <glib.h>
 
 #include <js/CallArgs.h>
 #include <js/Class.h>
+#include <js/GCVector.h>  // for RootedVector
 #include <js/Id.h>  // for JSID_IS_STRING
 #include <js/PropertySpec.h>
 #include <js/RootingAPI.h>
 #include <js/TypeDecls.h>
 #include <js/Utility.h>  // for UniqueChars
-#include <jsapi.h>       // for JS_GetPrivate, JS_NewObjectWithGivenProto
+#include <js/Value.h>       // for ObjectValue
+#include <js/ValueArray.h>  // for HandleValueArray
+#include <jsapi.h>  // for JS_GetPrivate, JS_NewObjectWithGivenProto, ...
 
 #include "gi/ns.h"
 #include "gi/repo.h"
@@ -43,16 +50,72 @@
 #include "cjs/jsapi-util.h"
 #include "cjs/macros.h"
 #include "cjs/mem-private.h"
+#include "cjs/profiler-private.h"
 #include "util/log.h"
 
-typedef struct {
+struct Ns {
     char *gi_namespace;
-} Ns;
+
+    // Names of the infos in the namespace, in typelib order, and their
+    // indices by name; built on first use. The names point into the typelib,
+    // which is never unloaded.
+    std::vector<const char*> info_names;
+    std::unordered_map<std::string_view, int> info_index;
+    bool info_index_built;
+
+    Ns() : gi_namespace(nullptr), info_index_built(false) {}
+
+    void build_info_index() {
+        if (info_index_built)
+            return;
+
+        int n = g_irepository_get_n_infos(nullptr, gi_namespace);
+        info_names.reserve(n);
+        info_index.reserve(n);
+        for (int k = 0; k < n; k++) {
+            GjsAutoBaseInfo info =
+                g_irepository_get_info(nullptr, gi_namespace, k);
+            info_names.push_back(info.name());
+            info_index.emplace(info.name(), k);
+        }
+        info_index_built = true;
+    }
+};
 
 extern struct JSClass gjs_ns_class;
 
+// Reserved slot holding the object passed to gjs_ns_set_class_hooks()
+static constexpr unsigned NS_SLOT_CLASS_HOOKS = 0;
+
 GJS_DEFINE_PRIV_FROM_JS(Ns, gjs_ns_class)
 
+// Runs the override hook registered for @id, if any, after @id has been
+// defined on the namespace object @ns. Each hook runs only once.
+GJS_JSAPI_RETURN_CONVENTION
+static bool run_class_hook(JSContext* cx, JS::HandleObject ns,
+                           JS::HandleId id) {
+    JS::Value hooks_val = JS_GetReservedSlot(ns, NS_SLOT_CLASS_HOOKS);
+    if (!hooks_val.isObject())
+        return true;
+
+    JS::RootedObject hooks(cx, &hooks_val.toObject());
+    bool has_hook;
+    if (!JS_HasOwnPropertyById(cx, hooks, id, &has_hook))
+        return false;
+    if (!has_hook)
+        return true;
+
+    JS::RootedValue hook(cx);
+    if (!JS_GetPropertyById(cx, hooks, id, &hook) ||
+        !JS_DeletePropertyById(cx, hooks, id))
+        return false;
+
+    JS::RootedValue defined_value(cx), ignored(cx);
+    return JS_GetPropertyById(cx, ns, id, &defined_value) &&
+           JS_CallFunctionValue(cx, ns, hook,
+                                JS::HandleValueArray(defined_value), &ignored);
+}
+
 /* The *resolved out parameter, on success, should be false to indicate that id
  * was not resolved; and true if id was resolved. */
 GJS_JSAPI_RETURN_CONVENTION
@@ -87,25 +150,30 @@ ns_resolve(JSContext       *context,
         return true;
     }
 
-    JS::UniqueChars name;
-    if (!gjs_get_string_id(context, id, &name))
+    const char* name;
+    if (!gjs_get_interned_string_id(context, id, &name))
         return false;
     if (!name) {
         *resolved = false;
         return true;  /* not resolved, but no error */
     }
 
-    GjsAutoBaseInfo info =
-        g_irepository_find_by_name(nullptr, priv->gi_namespace, name.get());
-    if (!info) {
+    priv->build_info_index();
+    auto found = priv->info_index.find(name);
+    if (found == priv->info_index.end()) {
         *resolved = false; /* No property defined, but no error either */
         return true;
     }
 
+    GjsAutoBaseInfo info =
+        g_irepository_get_info(nullptr, priv->gi_namespace, found->second);
+
     gjs_debug(GJS_DEBUG_GNAMESPACE,
               "Found info type %s for '%s' in namespace '%s'",
               gjs_info_type_name(info.type()), info.name(), info.ns());
 
+    GjsProfilerScope profiler_scope(context, "Resolve", info.name());
+
     if (!gjs_define_info(context, obj, info, &defined)) {
         gjs_debug(GJS_DEBUG_GNAMESPACE, "Failed to define info '%s'",
                   info.name());
@@ -114,7 +182,7 @@ ns_resolve(JSContext       *context,
 
     /* we defined the property in this object? */
     *resolved = defined;
-    return true;
+    return !defined || run_class_hook(context, obj, id);
 }
 
 GJS_JSAPI_RETURN_CONVENTION
@@ -127,17 +195,13 @@ static bool ns_new_enumerate(JSContext* cx, JS::HandleObject obj,
         return true;
     }
 
-    int n = g_irepository_get_n_infos(nullptr, priv->gi_namespace);
-    if (!properties.reserve(properties.length() + n)) {
+    priv->build_info_index();
+    if (!properties.reserve(properties.length() + priv->info_names.size())) {
         JS_ReportOutOfMemory(cx);
         return false;
     }
 
-    for (int k = 0; k < n; k++) {
-        GjsAutoBaseInfo info =
-            g_irepository_get_info(nullptr, priv->gi_namespace, k);
-        const char* name = info.name();
-
+    for (const char* name : priv->info_names) {
         jsid id = gjs_intern_string_to_id(cx, name);
         if (id == JSID_VOID)
             return false;
@@ -176,7 +240,7 @@ static void ns_finalize(JSFreeOp*, JSObject* obj) {
         g_free(priv->gi_namespace);
 
     GJS_DEC_COUNTER(ns);
-    g_slice_free(Ns, priv);
+    delete priv;
 }
 
 /* The bizarre thing about this vtable is that it applies to both
@@ -195,7 +259,8 @@ static const struct JSClassOps gjs_ns_class_ops = {
 
 struct JSClass gjs_ns_class = {
     "GIRepositoryNamespace",
-    JSCLASS_HAS_PRIVATE | JSCLASS_FOREGROUND_FINALIZE,
+    JSCLASS_HAS_PRIVATE | JSCLASS_HAS_RESERVED_SLOTS(1) |
+        JSCLASS_FOREGROUND_FINALIZE,
     &gjs_ns_class_ops
 };
 
@@ -227,7 +292,7 @@ ns_new(JSContext    *context,
     if (!ns)
         return nullptr;
 
-    priv = g_slice_new0(Ns);
+    priv = new Ns();
 
     GJS_INC_COUNTER(ns);
 
@@ -248,3 +313,23 @@ gjs_create_ns(JSContext    *context,
 {
     return ns_new(context, ns_name);
 }
+
+bool gjs_ns_set_class_hooks(JSContext* cx, JS::HandleObject ns,
+                            JS::HandleObject hooks) {
+    g_assert(JS_GetClass(ns) == &gjs_ns_class);
+    JS_SetReservedSlot(ns, NS_SLOT_CLASS_HOOKS, JS::ObjectValue(*hooks));
+
+    // Names that were already resolved, for example by the top level of the
+    // override module, will not go through the resolve hook again
+    JS::Rooted<JS::IdVector> ids(cx, cx);
+    if (!JS_Enumerate(cx, hooks, &ids))
+        return false;
+
+    for (size_t ix = 0; ix < ids.length(); ix++) {
+        bool defined;
+        if (!JS_AlreadyHasOwnPropertyById(cx, ns, ids[ix], &defined) ||
+            (defined && !run_class_hook(cx, ns, ids[ix])))
+            return false;
+    }
+    return true;
+}
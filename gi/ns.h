@@ -24,13 +24,22 @@
 #ifndef GI_NS_H_
 #define GI_NS_H_
 
-#include "cjs/macros.h"
+#include <config.h>
+
+#include <js/TypeDecls.h>
 
-class JSObject;
-struct JSContext;
+#include "cjs/macros.h"
 
 GJS_JSAPI_RETURN_CONVENTION
 JSObject* gjs_create_ns(JSContext    *context,
                         const char   *ns_name);
 
+// Registers @hooks, an object mapping names in the namespace @ns to functions.
+// Each function is called once, with the namespace as this and the defined
+// value as argument, right after that name is first resolved on @ns; or right
+// away, for names that are already resolved.
+GJS_JSAPI_RETURN_CONVENTION
+bool gjs_ns_set_class_hooks(JSContext* cx, JS::HandleObject ns,
+                            JS::HandleObject hooks);
+
 #endif  // GI_NS_H_
@@ -27,11 +27,13 @@
 #include <stdint.h>
 #include <string.h>  // for memset, strcmp
 
-#include <algorithm>  // for find
+#include <algorithm>  // for find, sort
 #include <functional>  // for mem_fn
 #include <string>
 #include <tuple>        // for tie
 #include <type_traits>  // for remove_reference<>::type
+#include <unordered_map>
+#include <unordered_set>
 #include <utility>      // for move
 #include <vector>
 
@@ -43,6 +45,7 @@
 #include <js/CallArgs.h>
 #include <js/CharacterEncoding.h>
 #include <js/Class.h>
+#include <js/Conversions.h>  // for ToUint32
 #include <js/GCAPI.h>               // for JS_AddWeakPointerCompartmentCallback
 #include <js/GCVector.h>            // for MutableWrappedPtrOperations
 #include <js/MemoryFunctions.h>     // for AddAssociatedMemory, RemoveAssoci...
@@ -70,10 +73,12 @@
 #include "cjs/context-private.h"
 #include "cjs/context.h"
 #include "cjs/deprecation.h"
+#include "cjs/heap-snapshot.h"
 #include "cjs/jsapi-class.h"
 #include "cjs/jsapi-util-args.h"
 #include "cjs/jsapi-util-root.h"
 #include "cjs/mem-private.h"
+#include "cjs/profiler-private.h"
 #include "util/log.h"
 
 class JSTracer;
@@ -94,7 +99,8 @@ static_assert(sizeof(ObjectInstance) <= 88,
 #endif  // x86-64 clang
 
 bool ObjectInstance::s_weak_pointer_callback = false;
-ObjectInstance *ObjectInstance::wrapped_gobject_list = nullptr;
+std::unordered_set<ObjectInstance*> ObjectInstance::s_pending_toggle_refs;
+std::vector<ObjectInstance*> ObjectInstance::s_wrapped_gobjects;
 
 // clang-format off
 G_DEFINE_QUARK(gjs::custom-type, ObjectBase::custom_type)
@@ -123,61 +129,21 @@ void ObjectBase::type_query_dynamic_safe(GTypeQuery* query) {
     g_type_query(type, query);
 }
 
-void
-GjsListLink::prepend(ObjectInstance *this_instance,
-                     ObjectInstance *head)
-{
-    GjsListLink *elem = head->get_link();
-
-    g_assert(this_instance->get_link() == this);
-
-    if (elem->m_prev) {
-        GjsListLink *prev = elem->m_prev->get_link();
-        prev->m_next = this_instance;
-        this->m_prev = elem->m_prev;
-    }
-
-    elem->m_prev = this_instance;
-    this->m_next = head;
-}
-
-void
-GjsListLink::unlink(void)
-{
-    if (m_prev)
-        m_prev->get_link()->m_next = m_next;
-    if (m_next)
-        m_next->get_link()->m_prev = m_prev;
-
-    m_prev = m_next = nullptr;
-}
-
-size_t
-GjsListLink::size(void) const
-{
-    const GjsListLink *elem = this;
-    size_t count = 0;
-
-    do {
-        count++;
-        if (!elem->m_next)
-            break;
-        elem = elem->m_next->get_link();
-    } while (elem);
-
-    return count;
-}
-
 void ObjectInstance::link(void) {
-    if (wrapped_gobject_list)
-        m_instance_link.prepend(this, wrapped_gobject_list);
-    wrapped_gobject_list = this;
+    g_assert(!m_instance_slot);
+    s_wrapped_gobjects.push_back(this);
+    m_instance_slot = static_cast<uint32_t>(s_wrapped_gobjects.size());
 }
 
 void ObjectInstance::unlink(void) {
-    if (wrapped_gobject_list == this)
-        wrapped_gobject_list = m_instance_link.next();
-    m_instance_link.unlink();
+    if (!m_instance_slot)
+        return;
+
+    ObjectInstance* last = s_wrapped_gobjects.back();
+    s_wrapped_gobjects[m_instance_slot - 1] = last;
+    last->m_instance_slot = m_instance_slot;
+    s_wrapped_gobjects.pop_back();
+    m_instance_slot = 0;
 }
 
 const void* ObjectBase::jsobj_addr(void) const {
@@ -263,12 +229,40 @@ ObjectInstance::unset_object_qdata(void)
     g_object_set_qdata(m_ptr, gjs_object_priv_quark(), nullptr);
 }
 
-GParamSpec* ObjectPrototype::find_param_spec_from_id(JSContext* cx,
-                                                     JS::HandleString key) {
+[[nodiscard]] static GjsPropertyMarshal property_marshal_for_gtype(
+    GType gtype) {
+    switch (gtype) {
+        case G_TYPE_BOOLEAN:
+            return GjsPropertyMarshal::BOOLEAN;
+        case G_TYPE_INT:
+            return GjsPropertyMarshal::INT;
+        case G_TYPE_UINT:
+            return GjsPropertyMarshal::UINT;
+        case G_TYPE_DOUBLE:
+            return GjsPropertyMarshal::DOUBLE;
+        case G_TYPE_FLOAT:
+            return GjsPropertyMarshal::FLOAT;
+        case G_TYPE_STRING:
+            return GjsPropertyMarshal::STRING;
+        default:
+            if (g_type_is_a(gtype, G_TYPE_OBJECT) ||
+                g_type_is_a(gtype, G_TYPE_INTERFACE))
+                return GjsPropertyMarshal::OBJECT;
+            return GjsPropertyMarshal::GENERIC;
+    }
+}
+
+// The GParamSpec is cached per prototype rather than on the accessor function,
+// because the accessor may be defined on a parent or interface prototype while
+// a subclass overrides the property with its own GParamSpec.
+const GjsCachedProperty* ObjectPrototype::find_property_from_id(
+    JSContext* cx, JS::HandleString key) {
     /* First check for the ID in the cache */
     auto entry = m_property_cache.lookupForAdd(key);
-    if (entry)
-        return entry->value();
+    if (entry) {
+        m_cache_entry.touch();
+        return &entry->value();
+    }
 
     JS::UniqueChars js_prop_name(JS_EncodeStringToUTF8(cx, key));
     if (!js_prop_name)
@@ -284,11 +278,15 @@ GParamSpec* ObjectPrototype::find_param_spec_from_id(JSContext* cx,
         return nullptr;
     }
 
-    if (!m_property_cache.add(entry, key, std::move(param_spec))) {
+    GjsPropertyMarshal marshal =
+        property_marshal_for_gtype(G_PARAM_SPEC_VALUE_TYPE(pspec));
+    if (!m_property_cache.add(entry, key,
+                              GjsCachedProperty{std::move(param_spec), marshal})) {
         JS_ReportOutOfMemory(cx);
         return nullptr;
     }
-    return pspec; /* owned by property cache */
+    caches_grew();
+    return &entry->value(); /* owned by property cache */
 }
 
 /* A hook on adding a property to an object. This is called during a set
@@ -319,7 +317,7 @@ bool ObjectInstance::add_property_impl(JSContext* cx, JS::HandleObject obj,
     if (is_custom_js_class() || m_gobj_disposed)
         return true;
 
-    ensure_uses_toggle_ref(cx);
+    ensure_uses_toggle_ref_before_gc(cx);
     return true;
 }
 
@@ -339,6 +337,118 @@ bool ObjectBase::prop_getter(JSContext* cx, unsigned argc, JS::Value* vp) {
     return priv->to_instance()->prop_getter_impl(cx, name, args.rval());
 }
 
+// Equivalent of g_object_get_property() for a GParamSpec that is already
+// known, skipping the property name lookup. GLib does the same thing
+// internally once it has found the GParamSpec. This is only valid if @pspec was
+// looked up on the object's own class, otherwise a subclass might override the
+// property. Returns false if the caller must go through g_object_get_property()
+// instead.
+[[nodiscard]] static bool get_property_direct(GObject* gobj, GParamSpec* pspec,
+                                              GValue* value) {
+    // Leave write-only properties, overridden properties that redirect to
+    // another GParamSpec, and GLib's deprecation warnings to GLib
+    if (!(pspec->flags & G_PARAM_READABLE) ||
+        (pspec->flags & G_PARAM_DEPRECATED) ||
+        g_param_spec_get_redirect_target(pspec) ||
+        !g_type_is_a(G_OBJECT_TYPE(gobj), pspec->owner_type))
+        return false;
+
+    auto* klass =
+        static_cast<GObjectClass*>(g_type_class_peek(pspec->owner_type));
+    if (!klass || !klass->get_property)
+        return false;
+
+    klass->get_property(gobj, pspec->param_id, value, pspec);
+    return true;
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool property_value_to_js(JSContext* cx, GjsPropertyMarshal marshal,
+                                 const GValue* gvalue,
+                                 JS::MutableHandleValue rval) {
+    switch (marshal) {
+        case GjsPropertyMarshal::BOOLEAN:
+            rval.setBoolean(g_value_get_boolean(gvalue));
+            return true;
+        case GjsPropertyMarshal::INT:
+            rval.setInt32(g_value_get_int(gvalue));
+            return true;
+        case GjsPropertyMarshal::UINT:
+            rval.setNumber(g_value_get_uint(gvalue));
+            return true;
+        case GjsPropertyMarshal::DOUBLE:
+            rval.setNumber(g_value_get_double(gvalue));
+            return true;
+        case GjsPropertyMarshal::FLOAT:
+            rval.setNumber(static_cast<double>(g_value_get_float(gvalue)));
+            return true;
+        case GjsPropertyMarshal::STRING: {
+            const char* str = g_value_get_string(gvalue);
+            if (!str) {
+                rval.setNull();
+                return true;
+            }
+            return gjs_string_from_utf8(cx, str, rval);
+        }
+        case GjsPropertyMarshal::OBJECT: {
+            auto* gobj = static_cast<GObject*>(g_value_get_object(gvalue));
+            if (!gobj) {
+                rval.setNull();
+                return true;
+            }
+            JSObject* obj = ObjectInstance::wrapper_from_gobject(cx, gobj);
+            if (!obj)
+                return false;
+            rval.setObject(*obj);
+            return true;
+        }
+        case GjsPropertyMarshal::GENERIC:
+        default:
+            return gjs_value_from_g_value(cx, rval, gvalue);
+    }
+}
+
+// Fills @gvalue from @value if it already is a JS value of the exact kind the
+// property wants, so that no conversion or error reporting is needed.
+// Otherwise returns false, and the caller must use gjs_value_to_g_value().
+[[nodiscard]] static bool property_value_from_js_exact(
+    GjsPropertyMarshal marshal, JS::HandleValue value, GValue* gvalue) {
+    switch (marshal) {
+        case GjsPropertyMarshal::BOOLEAN:
+            if (!value.isBoolean())
+                return false;
+            g_value_set_boolean(gvalue, value.toBoolean());
+            return true;
+        case GjsPropertyMarshal::INT:
+            if (!value.isInt32())
+                return false;
+            g_value_set_int(gvalue, value.toInt32());
+            return true;
+        case GjsPropertyMarshal::UINT:
+            if (!value.isInt32() || value.toInt32() < 0)
+                return false;
+            g_value_set_uint(gvalue, value.toInt32());
+            return true;
+        case GjsPropertyMarshal::DOUBLE:
+            if (!value.isNumber())
+                return false;
+            g_value_set_double(gvalue, value.toNumber());
+            return true;
+        case GjsPropertyMarshal::FLOAT:
+            if (!value.isNumber())
+                return false;
+            g_value_set_float(gvalue, value.toNumber());
+            return true;
+        case GjsPropertyMarshal::STRING:
+            if (!value.isNull())
+                return false;
+            g_value_set_string(gvalue, nullptr);
+            return true;
+        default:
+            return false;
+    }
+}
+
 bool ObjectInstance::prop_getter_impl(JSContext* cx, JS::HandleString name,
                                       JS::MutableHandleValue rval) {
     if (!check_gobject_disposed("get any property from"))
@@ -347,10 +457,11 @@ bool ObjectInstance::prop_getter_impl(JSContext* cx, JS::HandleString name,
     GValue gvalue = { 0, };
 
     ObjectPrototype* proto_priv = get_prototype();
-    GParamSpec *param = proto_priv->find_param_spec_from_id(cx, name);
+    const GjsCachedProperty* prop = proto_priv->find_property_from_id(cx, name);
 
     /* This is guaranteed because we resolved the property before */
-    g_assert(param);
+    g_assert(prop);
+    GParamSpec* param = prop->param;
 
     /* Do not fetch JS overridden properties from GObject, to avoid
      * infinite recursion. */
@@ -366,8 +477,10 @@ bool ObjectInstance::prop_getter_impl(JSContext* cx, JS::HandleString name,
                      param->name);
 
     g_value_init(&gvalue, G_PARAM_SPEC_VALUE_TYPE(param));
-    g_object_get_property(m_ptr, param->name, &gvalue);
-    if (!gjs_value_from_g_value(cx, rval, &gvalue)) {
+    if (G_OBJECT_TYPE(m_ptr) != proto_priv->gtype() ||
+        !get_property_direct(m_ptr, param, &gvalue))
+        g_object_get_property(m_ptr, param->name, &gvalue);
+    if (!property_value_to_js(cx, prop->marshal, &gvalue, rval)) {
         g_value_unset(&gvalue);
         return false;
     }
@@ -418,6 +531,8 @@ bool ObjectInstance::field_getter_impl(JSContext* cx, JS::HandleString name,
 
     ObjectPrototype* proto_priv = get_prototype();
     GIFieldInfo* field = proto_priv->lookup_cached_field_info(cx, name);
+    if (!field)
+        return false;
     GITypeTag tag;
     GIArgument arg = { 0 };
 
@@ -476,9 +591,10 @@ bool ObjectInstance::prop_setter_impl(JSContext* cx, JS::HandleString name,
         return true;
 
     ObjectPrototype* proto_priv = get_prototype();
-    GParamSpec *param_spec = proto_priv->find_param_spec_from_id(cx, name);
-    if (!param_spec)
+    const GjsCachedProperty* prop = proto_priv->find_property_from_id(cx, name);
+    if (!prop)
         return false;
+    GParamSpec* param_spec = prop->param;
 
     /* Do not set JS overridden properties through GObject, to avoid
      * infinite recursion (unless constructing) */
@@ -497,7 +613,8 @@ bool ObjectInstance::prop_setter_impl(JSContext* cx, JS::HandleString name,
 
     GValue gvalue = G_VALUE_INIT;
     g_value_init(&gvalue, G_PARAM_SPEC_VALUE_TYPE(param_spec));
-    if (!gjs_value_to_g_value(cx, value, &gvalue)) {
+    if (!property_value_from_js_exact(prop->marshal, value, &gvalue) &&
+        !gjs_value_to_g_value(cx, value, &gvalue)) {
         g_value_unset(&gvalue);
         return false;
     }
@@ -537,6 +654,8 @@ bool ObjectInstance::field_setter_not_impl(JSContext* cx,
 
     ObjectPrototype* proto_priv = get_prototype();
     GIFieldInfo* field = proto_priv->lookup_cached_field_info(cx, name);
+    if (!field)
+        return false;
 
     /* As far as I know, GI never exposes GObject instance struct fields as
      * writable, so no need to implement this for the time being */
@@ -655,13 +774,53 @@ bool ObjectPrototype::lazy_define_gobject_property(JSContext* cx,
     return true;
 }
 
+/*
+ * ObjectPrototype::ensure_interface_index:
+ *
+ * Collects the introspectable interfaces of the GType, and indexes their
+ * methods by name, so that resolve_no_info() doesn't have to look up the info
+ * of every interface and scan its methods each time. Types without GI info,
+ * such as GLocalFile, get all of their methods resolved this way.
+ *
+ * If two interfaces have a method with the same name, the first one wins, as
+ * it did when scanning. The interfaces of a type don't change once it has a
+ * prototype, so this is only ever built once.
+ */
+void ObjectPrototype::ensure_interface_index(void) {
+    if (m_interface_index_built)
+        return;
+    m_interface_index_built = true;
+
+    guint n_interfaces;
+    GjsAutoFree<GType> interfaces = g_type_interfaces(m_gtype, &n_interfaces);
+
+    for (guint i = 0; i < n_interfaces; i++) {
+        GjsAutoInterfaceInfo iface_info =
+            g_irepository_find_by_gtype(nullptr, interfaces[i]);
+        if (!iface_info)
+            continue;
+
+        int n_methods = g_interface_info_get_n_methods(iface_info);
+        for (int ix = 0; ix < n_methods; ix++) {
+            GjsAutoFunctionInfo method_info =
+                g_interface_info_get_method(iface_info, ix);
+            if (!(g_function_info_get_flags(method_info) &
+                  GI_FUNCTION_IS_METHOD))
+                continue;
+
+            // The name points into the typelib, and lives as long as the key
+            std::string_view method_name = method_info.name();
+            m_interface_methods.emplace(method_name, std::move(method_info));
+        }
+
+        m_interface_infos.push_back(std::move(iface_info));
+    }
+}
+
 bool ObjectPrototype::resolve_no_info(JSContext* cx, JS::HandleObject obj,
                                       JS::HandleId id, bool* resolved,
                                       const char* name,
                                       ResolveWhat resolve_props) {
-    guint n_interfaces;
-    guint i;
-
     GjsAutoChar canonical_name;
     if (resolve_props == ConsiderMethodsAndProperties) {
         // Optimization: GObject property names must start with a letter
@@ -671,8 +830,6 @@ bool ObjectPrototype::resolve_no_info(JSContext* cx, JS::HandleObject obj,
         }
     }
 
-    GjsAutoFree<GType> interfaces = g_type_interfaces(m_gtype, &n_interfaces);
-
     /* Fallback to GType system for non custom GObjects with no GI information
      */
     if (canonical_name && G_TYPE_IS_CLASSED(m_gtype) && !is_custom_js_class()) {
@@ -681,7 +838,10 @@ bool ObjectPrototype::resolve_no_info(JSContext* cx, JS::HandleObject obj,
         if (g_object_class_find_property(oclass, canonical_name))
             return lazy_define_gobject_property(cx, obj, id, resolved, name);
 
-        for (i = 0; i < n_interfaces; i++) {
+        guint n_interfaces;
+        GjsAutoFree<GType> interfaces =
+            g_type_interfaces(m_gtype, &n_interfaces);
+        for (guint i = 0; i < n_interfaces; i++) {
             if (!G_TYPE_IS_CLASSED(interfaces[i]))
                 continue;
 
@@ -692,31 +852,25 @@ bool ObjectPrototype::resolve_no_info(JSContext* cx, JS::HandleObject obj,
         }
     }
 
-    for (i = 0; i < n_interfaces; i++) {
-        GjsAutoInterfaceInfo iface_info =
-            g_irepository_find_by_gtype(nullptr, interfaces[i]);
-        if (!iface_info)
-            continue;
-
-        GjsAutoFunctionInfo method_info =
-            g_interface_info_find_method(iface_info, name);
-        if (method_info) {
-            if (g_function_info_get_flags (method_info) & GI_FUNCTION_IS_METHOD) {
-                if (!gjs_define_function(cx, obj, m_gtype, method_info))
-                    return false;
+    ensure_interface_index();
 
-                *resolved = true;
-                return true;
-            }
-        }
+    auto method = m_interface_methods.find(name);
+    if (method != m_interface_methods.end()) {
+        if (!gjs_define_function(cx, obj, m_gtype, method->second))
+            return false;
 
-        if (!canonical_name)
-            continue;
+        *resolved = true;
+        return true;
+    }
 
+    if (canonical_name) {
         /* If the name refers to a GObject property, lazily define the property
          * in JS as we do below in the real resolve hook. We ignore fields here
          * because I don't think interfaces can have fields */
-        if (is_ginterface_property_name(iface_info, canonical_name)) {
+        for (const GjsAutoInterfaceInfo& iface_info : m_interface_infos) {
+            if (!is_ginterface_property_name(iface_info, canonical_name))
+                continue;
+
             GjsAutoTypeClass<GObjectClass> oclass(m_gtype);
             // unowned
             GParamSpec* pspec = g_object_class_find_property(
@@ -772,29 +926,61 @@ bool ObjectBase::id_is_never_lazy(jsid name, const GjsAtoms& atoms) {
 bool ObjectPrototype::resolve_impl(JSContext* context, JS::HandleObject obj,
                                    JS::HandleId id, bool* resolved) {
     if (m_unresolvable_cache.has(id)) {
+        m_cache_entry.touch();
         *resolved = false;
         return true;
     }
 
-    JS::UniqueChars prop_name;
-    if (!gjs_get_string_id(context, id, &prop_name))
+    const char* prop_name;
+    if (!gjs_get_interned_string_id(context, id, &prop_name))
         return false;
+
+    // Symbols and integers are never resolved, but also go into the cache, so
+    // that may_resolve() knows about them
     if (!prop_name) {
         *resolved = false;
-        return true;  // not resolved, but no error
-    }
-
-    if (!uncached_resolve(context, obj, id, prop_name.get(), resolved))
+    } else if (!uncached_resolve(context, obj, id, prop_name, resolved)) {
         return false;
+    }
 
-    if (!*resolved && !m_unresolvable_cache.putNew(id)) {
-        JS_ReportOutOfMemory(context);
-        return false;
+    if (!*resolved) {
+        if (!m_unresolvable_cache.putNew(id)) {
+            JS_ReportOutOfMemory(context);
+            return false;
+        }
+        caches_grew();
     }
 
     return true;
 }
 
+/*
+ * ObjectBase::may_resolve:
+ *
+ * Tells the JS engine where resolve() can't define anything: on instances,
+ * which never resolve, and on prototypes for the ids already in their negative
+ * lookup cache. The engine can then look past those objects without calling
+ * the hook, and its inline caches can remember property misses on GObjects,
+ * such as duck-typing checks and signal name probing, instead of calling the
+ * resolve hook of every prototype on the chain each time.
+ *
+ * The cache needs no invalidation: the introspection data of a prototype,
+ * and the interfaces of its GType, don't change after the prototype is
+ * created.
+ */
+bool ObjectBase::may_resolve(const JSAtomState&, jsid id,
+                             JSObject* maybe_obj) {
+    if (!maybe_obj)
+        return true;
+
+    ObjectBase* priv = ObjectBase::for_js_nocheck(maybe_obj);
+    if (!priv)
+        return true;
+    if (!priv->is_prototype())
+        return false;
+    return !priv->to_prototype()->is_unresolvable(id);
+}
+
 bool ObjectPrototype::uncached_resolve(JSContext* context, JS::HandleObject obj,
                                        JS::HandleId id, const char* name,
                                        bool* resolved) {
@@ -864,10 +1050,13 @@ bool ObjectPrototype::uncached_resolve(JSContext* context, JS::HandleObject obj,
             flags |= JSPROP_READONLY;
 
         JS::RootedString key(context, JSID_TO_STRING(id));
-        if (!m_field_cache.putNew(key, field_info.release())) {
+        // put() rather than putNew(): a field of the same name on a parent
+        // may already have been memoized here by lookup_cached_field_info()
+        if (!m_field_cache.put(key, field_info.release())) {
             JS_ReportOutOfMemory(context);
             return false;
         }
+        caches_grew();
 
         JS::RootedValue private_id(context, JS::StringValue(key));
         if (!gjs_define_property_dynamic(
@@ -922,10 +1111,28 @@ bool ObjectPrototype::uncached_resolve(JSContext* context, JS::HandleObject obj,
     return true;
 }
 
+// The lazy properties of a prototype only depend on its GType and info, so they
+// are listed once and then copied from m_enumerated_ids.
 bool ObjectPrototype::new_enumerate_impl(JSContext* cx, JS::HandleObject,
                                          JS::MutableHandleIdVector properties,
                                          bool only_enumerable
                                          [[maybe_unused]]) {
+    if (m_enumerated_ids.valid()) {
+        m_cache_entry.touch();
+        return m_enumerated_ids.append_to(cx, properties);
+    }
+
+    size_t start = properties.length();
+    if (!enumerate_uncached(cx, properties) ||
+        !m_enumerated_ids.store(cx, properties, start))
+        return false;
+
+    caches_grew();
+    return true;
+}
+
+bool ObjectPrototype::enumerate_uncached(JSContext* cx,
+                                         JS::MutableHandleIdVector properties) {
     unsigned n_interfaces;
     GType* interfaces = g_type_interfaces(gtype(), &n_interfaces);
 
@@ -1019,7 +1226,7 @@ bool ObjectPrototype::new_enumerate_impl(JSContext* cx, JS::HandleObject,
  * a hash) */
 bool ObjectPrototype::props_to_g_parameters(JSContext* context,
                                             JS::HandleObject props,
-                                            std::vector<const char*>* names,
+                                            GParamNameVector* names,
                                             AutoGValueVector* values) {
     size_t ix, length;
     JS::RootedId prop_id(context);
@@ -1065,8 +1272,12 @@ bool ObjectPrototype::props_to_g_parameters(JSContext* context,
             return false;
         }
 
-        names->push_back(param_spec->name);  /* owned by GParamSpec in cache */
-        values->push_back(gvalue);
+        /* name is owned by GParamSpec in cache */
+        if (!names->append(param_spec->name) || !values->append(gvalue)) {
+            g_value_unset(&gvalue);
+            JS_ReportOutOfMemory(context);
+            return false;
+        }
     }
 
     return true;
@@ -1086,13 +1297,14 @@ ObjectInstance::gobj_dispose_notify(void)
     m_gobj_disposed = true;
 }
 
+// Iterates from the back, so that @action may unlink the instance it is given:
+// that only moves an instance that has already been visited.
 void ObjectInstance::iterate_wrapped_gobjects(
     const ObjectInstance::Action& action) {
-    ObjectInstance *link = ObjectInstance::wrapped_gobject_list;
-    while (link) {
-        ObjectInstance *next = link->next();
-        action(link);
-        link = next;
+    for (size_t ix = s_wrapped_gobjects.size(); ix > 0; ix--) {
+        if (ix > s_wrapped_gobjects.size())
+            continue;
+        action(s_wrapped_gobjects[ix - 1]);
     }
 }
 
@@ -1140,6 +1352,7 @@ void
 ObjectInstance::toggle_down(void)
 {
     debug_lifecycle("Toggle notify DOWN");
+    TRACE(GJS_OBJECT_TOGGLE_DOWN(this, m_ptr, ns(), name()));
 
     /* Change to weak ref so the wrapper-wrappee pair can be
      * collected by the GC
@@ -1181,6 +1394,7 @@ ObjectInstance::toggle_up(void)
         return;
 
     debug_lifecycle("Toggle notify UP");
+    TRACE(GJS_OBJECT_TOGGLE_UP(this, m_ptr, ns(), name()));
 
     /* Change to strong ref so the wrappee keeps the wrapper alive
      * in case the wrapper has data in it that the app cares about
@@ -1213,7 +1427,7 @@ toggle_handler(GObject               *gobj,
 static void wrapped_gobj_toggle_notify(void*, GObject* gobj,
                                        gboolean is_last_ref) {
     bool is_main_thread;
-    bool toggle_up_queued, toggle_down_queued;
+    bool toggle_up_queued = false, toggle_down_queued = false;
 
     GjsContextPrivate* gjs = GjsContextPrivate::from_current_context();
     if (gjs->destroying()) {
@@ -1253,8 +1467,13 @@ static void wrapped_gobj_toggle_notify(void*, GObject* gobj,
      */
     is_main_thread = gjs->is_owner_thread();
 
+    // Only the main thread may look at what is queued; other threads just add
+    // to the queue
     auto& toggle_queue = ToggleQueue::get_default();
-    std::tie(toggle_down_queued, toggle_up_queued) = toggle_queue.is_queued(gobj);
+    if (is_main_thread) {
+        std::tie(toggle_down_queued, toggle_up_queued) =
+            toggle_queue.is_queued(gobj);
+    }
 
     if (is_last_ref) {
         /* We've transitions from 2 -> 1 references,
@@ -1294,6 +1513,7 @@ static void wrapped_gobj_toggle_notify(void*, GObject* gobj,
 void
 ObjectInstance::release_native_object(void)
 {
+    cancel_pending_toggle_ref();
     discard_wrapper();
     if (m_uses_toggle_ref)
         g_object_remove_toggle_ref(m_ptr, wrapped_gobj_toggle_notify, nullptr);
@@ -1336,6 +1556,250 @@ void ObjectInstance::prepare_shutdown(void) {
         std::mem_fn(&ObjectInstance::release_native_object));
 }
 
+[[nodiscard]] static const char* signal_on_type_for_closure(GObject* gobj,
+                                                            GType type,
+                                                            GClosure* closure) {
+    auto mask = GSignalMatchType(G_SIGNAL_MATCH_ID | G_SIGNAL_MATCH_CLOSURE);
+    unsigned n_ids;
+    GjsAutoFree<unsigned> ids = g_signal_list_ids(type, &n_ids);
+    for (unsigned ix = 0; ix < n_ids; ix++) {
+        if (g_signal_handler_find(gobj, mask, ids[ix], 0, closure, nullptr,
+                                  nullptr))
+            return g_signal_name(ids[ix]);
+    }
+    return nullptr;
+}
+
+// Name of the signal of @gobj that @closure is connected to, or null if it is
+// not a signal handler, e.g. a scope-notify callback
+[[nodiscard]] static const char* signal_for_closure(GObject* gobj,
+                                                    GClosure* closure) {
+    for (GType type = G_OBJECT_TYPE(gobj); type; type = g_type_parent(type)) {
+        if (const char* name = signal_on_type_for_closure(gobj, type, closure))
+            return name;
+
+        unsigned n_interfaces;
+        GjsAutoFree<GType> interfaces = g_type_interfaces(type, &n_interfaces);
+        for (unsigned ix = 0; ix < n_interfaces; ix++) {
+            if (const char* name =
+                    signal_on_type_for_closure(gobj, interfaces[ix], closure))
+                return name;
+        }
+    }
+    return nullptr;
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool define_string_property(JSContext* cx, JS::HandleObject obj,
+                                   const char* name, const char* value) {
+    JS::RootedValue v_value(cx);
+    if (value) {
+        if (!gjs_string_from_utf8(cx, value, &v_value))
+            return false;
+    } else {
+        v_value.setNull();
+    }
+    return JS_DefineProperty(cx, obj, name, v_value, JSPROP_ENUMERATE);
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool define_number_property(JSContext* cx, JS::HandleObject obj,
+                                   const char* name, double value) {
+    JS::RootedValue v_value(cx, JS::NumberValue(value));
+    return JS_DefineProperty(cx, obj, name, v_value, JSPROP_ENUMERATE);
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool define_boolean_property(JSContext* cx, JS::HandleObject obj,
+                                    const char* name, bool value) {
+    JS::RootedValue v_value(cx, JS::BooleanValue(value));
+    return JS_DefineProperty(cx, obj, name, v_value, JSPROP_ENUMERATE);
+}
+
+/*
+ * ObjectInstance::retention_report:
+ *
+ * Without @type_name, counts the wrapped GObjects of each GType, and how many
+ * of them use toggle refs, have a rooted wrapper (that is, the GObject is kept
+ * alive from C and keeps the wrapper alive in turn) or have closures.
+ *
+ * With @type_name, reports each wrapped GObject of that type or a subtype, with
+ * the shortest chain of JS references that keeps its wrapper alive and the
+ * signal handlers and other closures of other objects along that chain.
+ */
+bool ObjectInstance::retention_report(JSContext* cx, const char* type_name,
+                                      JS::MutableHandleValue rval) {
+    if (!type_name) {
+        struct TypeCount {
+            GType gtype;
+            size_t count, toggle_refs, rooted, closures;
+        };
+        std::vector<TypeCount> counts;
+        std::unordered_map<GType, size_t> index;
+        iterate_wrapped_gobjects([&counts, &index](ObjectInstance* instance) {
+            auto it = index.emplace(instance->gtype(), counts.size()).first;
+            if (it->second == counts.size())
+                counts.push_back({instance->gtype(), 0, 0, 0, 0});
+            TypeCount& count = counts[it->second];
+            count.count++;
+            if (instance->m_uses_toggle_ref)
+                count.toggle_refs++;
+            if (instance->wrapper_is_rooted())
+                count.rooted++;
+            count.closures += instance->m_closures.size();
+        });
+        std::sort(counts.begin(), counts.end(),
+                  [](const TypeCount& a, const TypeCount& b) {
+                      return a.count > b.count;
+                  });
+
+        JS::RootedObject array(cx, JS::NewArrayObject(cx, counts.size()));
+        if (!array)
+            return false;
+        JS::RootedObject item(cx);
+        for (size_t ix = 0; ix < counts.size(); ix++) {
+            const TypeCount& count = counts[ix];
+            item = JS_NewPlainObject(cx);
+            if (!item ||
+                !define_string_property(cx, item, "type",
+                                        g_type_name(count.gtype)) ||
+                !define_number_property(cx, item, "count", count.count) ||
+                !define_number_property(cx, item, "toggleRefs",
+                                        count.toggle_refs) ||
+                !define_number_property(cx, item, "rooted", count.rooted) ||
+                !define_number_property(cx, item, "closures", count.closures) ||
+                !JS_DefineElement(cx, array, ix, item, JSPROP_ENUMERATE))
+                return false;
+        }
+        rval.setObject(*array);
+        return true;
+    }
+
+    GType gtype = g_type_from_name(type_name);
+    if (gtype == G_TYPE_INVALID) {
+        gjs_throw(cx, "No GType named %s", type_name);
+        return false;
+    }
+
+    // Everything is copied out before creating any JS objects, since a GC
+    // could finalize the instances
+    struct ClosureOwner {
+        std::string object;
+        const char* signal;
+        std::string function;
+    };
+    struct InstanceReport {
+        std::string address;
+        const char* type;
+        unsigned refcount;
+        bool toggle_ref, rooted;
+        GjsRetainingPath path;
+        std::vector<const ClosureOwner*> closures;
+    };
+
+    std::unordered_map<uint64_t, ClosureOwner> closure_owners;
+    std::vector<InstanceReport> reports;
+    std::vector<JSObject*> targets;
+    iterate_wrapped_gobjects([gtype, &closure_owners, &reports,
+                              &targets](ObjectInstance* instance) {
+        GjsAutoChar object = g_strdup_printf("%s %p", instance->type_name(),
+                                             instance->ptr());
+        for (GClosure* closure : instance->m_closures) {
+            if (!gjs_closure_is_valid(closure))
+                continue;
+            JSObject* callable =
+                JS_GetFunctionObject(gjs_closure_get_callable(closure));
+            const char* signal =
+                instance->ptr() ? signal_for_closure(instance->ptr(), closure)
+                                : nullptr;
+            closure_owners[reinterpret_cast<uintptr_t>(callable)] = {
+                object.get(), signal,
+                gjs_debug_value(JS::ObjectValue(*callable))};
+        }
+
+        if (!g_type_is_a(instance->gtype(), gtype) || !instance->wrapper())
+            return;
+        GjsAutoChar address = g_strdup_printf("%p", instance->ptr());
+        reports.push_back({address.get(), instance->type_name(),
+                           instance->ptr() ? instance->ptr()->ref_count : 0,
+                           instance->m_uses_toggle_ref,
+                           instance->wrapper_is_rooted(), {}, {}});
+        targets.push_back(instance->wrapper());
+    });
+
+    std::vector<GjsRetainingPath> paths;
+    if (!gjs_find_retaining_paths(cx, targets, &paths)) {
+        JS_ReportOutOfMemory(cx);
+        return false;
+    }
+    for (size_t ix = 0; ix < reports.size(); ix++) {
+        reports[ix].path = std::move(paths[ix]);
+        for (const GjsRetainingEdge& edge : reports[ix].path) {
+            auto owner = closure_owners.find(edge.address);
+            if (owner != closure_owners.end())
+                reports[ix].closures.push_back(&owner->second);
+        }
+    }
+
+    JS::RootedObject array(cx, JS::NewArrayObject(cx, reports.size()));
+    if (!array)
+        return false;
+    JS::RootedObject item(cx), list(cx), step(cx);
+    for (size_t ix = 0; ix < reports.size(); ix++) {
+        const InstanceReport& report = reports[ix];
+        item = JS_NewPlainObject(cx);
+        if (!item ||
+            !define_string_property(cx, item, "address",
+                                    report.address.c_str()) ||
+            !define_string_property(cx, item, "type", report.type) ||
+            !define_number_property(cx, item, "refcount", report.refcount) ||
+            !define_boolean_property(cx, item, "toggleRef",
+                                     report.toggle_ref) ||
+            !define_boolean_property(cx, item, "rooted", report.rooted))
+            return false;
+
+        list = JS::NewArrayObject(cx, report.path.size());
+        if (!list)
+            return false;
+        for (size_t step_ix = 0; step_ix < report.path.size(); step_ix++) {
+            const GjsRetainingEdge& edge = report.path[step_ix];
+            step = JS_NewPlainObject(cx);
+            if (!step ||
+                !define_string_property(cx, step, "object",
+                                        edge.description.c_str()) ||
+                !define_string_property(
+                    cx, step, "edge",
+                    edge.name.empty() ? nullptr : edge.name.c_str()) ||
+                !JS_DefineElement(cx, list, step_ix, step, JSPROP_ENUMERATE))
+                return false;
+        }
+        if (!JS_DefineProperty(cx, item, "path", list, JSPROP_ENUMERATE))
+            return false;
+
+        list = JS::NewArrayObject(cx, report.closures.size());
+        if (!list)
+            return false;
+        for (size_t owner_ix = 0; owner_ix < report.closures.size();
+             owner_ix++) {
+            const ClosureOwner* owner = report.closures[owner_ix];
+            step = JS_NewPlainObject(cx);
+            if (!step ||
+                !define_string_property(cx, step, "object",
+                                        owner->object.c_str()) ||
+                !define_string_property(cx, step, "signal", owner->signal) ||
+                !define_string_property(cx, step, "function",
+                                        owner->function.c_str()) ||
+                !JS_DefineElement(cx, list, owner_ix, step, JSPROP_ENUMERATE))
+                return false;
+        }
+        if (!JS_DefineProperty(cx, item, "closures", list, JSPROP_ENUMERATE) ||
+            !JS_DefineElement(cx, array, ix, item, JSPROP_ENUMERATE))
+            return false;
+    }
+    rval.setObject(*array);
+    return true;
+}
+
 ObjectInstance::ObjectInstance(JSContext* cx, JS::HandleObject object)
     : GIWrapperInstance(cx, object) {
     GTypeQuery query;
@@ -1348,7 +1812,8 @@ ObjectInstance::ObjectInstance(JSContext* cx, JS::HandleObject object)
 }
 
 ObjectPrototype::ObjectPrototype(GIObjectInfo* info, GType gtype)
-    : GIWrapperPrototype(info, gtype) {
+    : GIWrapperPrototype(info, gtype),
+      m_cache_entry(&ObjectPrototype::evict_caches, this) {
     g_type_class_ref(gtype);
 
     GJS_INC_COUNTER(object_prototype);
@@ -1409,6 +1874,7 @@ ObjectInstance::associate_js_gobject(JSContext       *context,
     g_assert(!wrapper_is_rooted());
 
     m_uses_toggle_ref = false;
+    m_toggle_ref_pending = false;
     m_ptr = gobj;
     set_object_qdata();
     m_wrapper = object;
@@ -1425,6 +1891,7 @@ ObjectInstance::ensure_uses_toggle_ref(JSContext *cx)
     if (m_uses_toggle_ref)
         return;
 
+    cancel_pending_toggle_ref();
     debug_lifecycle("Switching object instance to toggle ref");
 
     g_assert(!wrapper_is_rooted());
@@ -1450,23 +1917,93 @@ ObjectInstance::ensure_uses_toggle_ref(JSContext *cx)
     g_object_unref(m_ptr);
 }
 
-static void invalidate_closure_list(std::forward_list<GClosure*>* closures) {
+/*
+ * ObjectInstance::ensure_uses_toggle_ref_before_gc:
+ *
+ * Like ensure_uses_toggle_ref(), but for state that only matters if the GC
+ * would otherwise collect the wrapper while the GObject is still alive. Until
+ * then the wrapper's own strong ref keeps it alive, so the switch is put off
+ * until the next GC begins. Many wrappers with expandos or signal connections
+ * belong to short-lived objects that are released before then, and never need
+ * to pay for the toggle ref, the GC root, and the toggle notifications.
+ */
+void ObjectInstance::ensure_uses_toggle_ref_before_gc(JSContext* cx) {
+    if (m_uses_toggle_ref || m_toggle_ref_pending)
+        return;
+
+    // An incremental GC might already have passed over this wrapper without
+    // marking it, so it can't wait for the next one
+    if (JS::IsIncrementalGCInProgress(cx)) {
+        ensure_uses_toggle_ref(cx);
+        return;
+    }
+
+    debug_lifecycle("Deferring switch to toggle ref until next GC");
+    m_toggle_ref_pending = true;
+    s_pending_toggle_refs.insert(this);
+}
+
+void ObjectInstance::cancel_pending_toggle_ref(void) {
+    if (!m_toggle_ref_pending)
+        return;
+
+    m_toggle_ref_pending = false;
+    s_pending_toggle_refs.erase(this);
+}
+
+/*
+ * ObjectInstance::activate_pending_toggle_refs:
+ *
+ * Called when a GC begins, to switch every wrapper whose toggle ref was put
+ * off by ensure_uses_toggle_ref_before_gc() over to toggle refs, before the GC
+ * gets a chance to collect it.
+ */
+void ObjectInstance::activate_pending_toggle_refs(JSContext* cx) {
+    if (s_pending_toggle_refs.empty())
+        return;
+
+    gjs_debug_lifecycle(GJS_DEBUG_GOBJECT,
+                        "Switching %zu deferred object(s) to toggle refs",
+                        s_pending_toggle_refs.size());
+
+    // Switching may cause toggle notifications, which must not see the set
+    std::unordered_set<ObjectInstance*> pending;
+    pending.swap(s_pending_toggle_refs);
+    for (ObjectInstance* priv : pending) {
+        priv->m_toggle_ref_pending = false;
+        if (priv->m_ptr && !priv->m_gobj_disposed && priv->has_wrapper())
+            priv->ensure_uses_toggle_ref(cx);
+    }
+}
+
+// Order doesn't matter in these lists, so fill the hole with the last item
+static void remove_closure(std::vector<GClosure*>* closures,
+                           GClosure* closure) {
+    auto it = std::find(closures->begin(), closures->end(), closure);
+    if (it == closures->end())
+        return;
+    *it = closures->back();
+    closures->pop_back();
+}
+
+static void invalidate_closure_list(std::vector<GClosure*>* closures) {
     g_assert(closures);
-    // Can't loop directly through the items, since invalidating an item's
-    // closure might have the effect of removing the item from the list in the
-    // invalidate notifier
-    while (!closures->empty()) {
-        // This will also free the closure data, through the closure
-        // invalidation mechanism, but adding a temporary reference to
-        // ensure that the closure is still valid when calling invalidation
-        // notify callbacks
-        using GjsAutoGClosure =
-            GjsAutoPointer<GClosure, GClosure, g_closure_unref, g_closure_ref>;
-        GjsAutoGClosure closure(closures->front(), GjsAutoTakeOwnership());
+    // Take the whole list first. Each item's invalidate notifier removes it
+    // from @closures, which would otherwise mean a search of the remaining
+    // list for every closure invalidated.
+    std::vector<GClosure*> invalidating;
+    invalidating.swap(*closures);
+
+    // Invalidating will also free the closure data, but hold a reference to
+    // every closure until they have all been invalidated, so that each is
+    // still valid when its invalidation notify callbacks run. Dropping them
+    // afterwards in one sweep is what may actually free them.
+    for (GClosure* closure : invalidating)
+        g_closure_ref(closure);
+    for (GClosure* closure : invalidating)
         g_closure_invalidate(closure);
-        /* Erase element if not already erased */
-        closures->remove(closure);
-    }
+    for (GClosure* closure : invalidating)
+        g_closure_unref(closure);
 }
 
 // Note: m_wrapper (the JS object) may already be null when this is called, if
@@ -1513,7 +2050,7 @@ ObjectInstance::init_impl(JSContext              *context,
                       name(), args.length()))
         return false;
 
-    std::vector<const char *> names;
+    GParamNameVector names;
     AutoGValueVector values;
 
     if (args.length() > 0 && !args[0].isUndefined()) {
@@ -1546,9 +2083,9 @@ ObjectInstance::init_impl(JSContext              *context,
         }
     }
 
-    g_assert(names.size() == values.size());
-    GObject* gobj = g_object_new_with_properties(gtype(), values.size(),
-                                                 names.data(), values.data());
+    g_assert(names.length() == values.length());
+    GObject* gobj = g_object_new_with_properties(gtype(), values.length(),
+                                                 names.begin(), values.begin());
 
     ObjectInstance *other_priv = ObjectInstance::for_gobject(gobj);
     if (other_priv && other_priv->m_wrapper != object.get()) {
@@ -1625,10 +2162,34 @@ void ObjectInstance::trace_impl(JSTracer* tracer) {
         gjs_closure_trace(closure, tracer);
 }
 
+size_t ObjectPrototype::cache_size() const {
+    // Field infos are allocated along with the entries
+    return m_property_cache.capacity() * sizeof(PropertyCache::Entry) +
+           m_field_cache.capacity() * sizeof(FieldCache::Entry) +
+           m_field_cache.count() * sizeof(GIBaseInfo) +
+           m_signal_cache.capacity() * sizeof(SignalCache::Entry) +
+           m_unresolvable_cache.capacity() * sizeof(jsid) +
+           m_enumerated_ids.size();
+}
+
+// All of these caches are filled in again as they are used. Properties and
+// fields that resolve_impl() already defined on the prototype stay defined, and
+// look up their info again the next time they are accessed.
+void ObjectPrototype::evict_caches(void* data) {
+    auto* priv = static_cast<ObjectPrototype*>(data);
+    priv->m_property_cache.clearAndCompact();
+    priv->m_field_cache.clearAndCompact();
+    priv->m_signal_cache.clearAndCompact();
+    priv->m_unresolvable_cache.clearAndCompact();
+    priv->m_enumerated_ids.clear();
+}
+
 void ObjectPrototype::trace_impl(JSTracer* tracer) {
     m_property_cache.trace(tracer);
     m_field_cache.trace(tracer);
+    m_signal_cache.trace(tracer);
     m_unresolvable_cache.trace(tracer);
+    m_enumerated_ids.trace(tracer);
     for (GClosure* closure : m_vfuncs)
         gjs_closure_trace(closure, tracer);
 }
@@ -1644,6 +2205,8 @@ void ObjectInstance::finalize_impl(JSFreeOp* fop, JSObject* obj) {
 }
 
 ObjectInstance::~ObjectInstance() {
+    cancel_pending_toggle_ref();
+
     TRACE(GJS_OBJECT_WRAPPER_FINALIZE(this, m_ptr, ns(), name()));
 
     invalidate_closure_list(&m_closures);
@@ -1774,14 +2337,46 @@ gjs_lookup_object_prototype(JSContext *context,
 }
 
 // Retrieves a GIFieldInfo for a field named @key. This is for use in
-// field_getter_impl() and field_setter_not_impl(), where the field info *must*
-// have been cached previously in resolve_impl() on this ObjectPrototype or one
-// of its parent ObjectPrototypes. This will fail an assertion if there is no
-// cached field info.
+// field_getter_impl() and field_setter_not_impl(), where the field *must* have
+// been resolved previously in resolve_impl() on this ObjectPrototype or one of
+// its parent ObjectPrototypes. The cache may have been emptied since, in which
+// case the field is looked up again in the introspection info. This will fail
+// an assertion if no prototype has the field.
+//
+// Field getters are pure reads, and are hit on every access from JS. A field
+// found on a parent prototype is therefore also memoized in this prototype's
+// cache, so that subsequent reads through a subclass don't have to walk the
+// prototype chain (and look up the parent prototype object by its info) again.
 //
-// The caller does not own the return value, and it can never be null.
+// The caller does not own the return value, which is null only if an exception
+// is pending.
 GIFieldInfo* ObjectPrototype::lookup_cached_field_info(JSContext* cx,
                                                        JS::HandleString key) {
+    gjs_debug_jsprop(GJS_DEBUG_GOBJECT,
+                     "Looking up cached field info for '%s' in '%s' prototype",
+                     gjs_debug_string(key).c_str(), g_type_name(m_gtype));
+    if (auto entry = m_field_cache.lookup(key)) {
+        m_cache_entry.touch();
+        return entry->value().get();
+    }
+
+    if (info()) {
+        JS::UniqueChars name(JS_EncodeStringToUTF8(cx, key));
+        if (!name)
+            return nullptr;
+        GjsAutoFieldInfo own_field = lookup_field_info(m_info, name.get());
+        if (own_field) {
+            GIFieldInfo* field = own_field;
+            if (!m_field_cache.putNew(key, std::move(own_field))) {
+                JS_ReportOutOfMemory(cx);
+                return nullptr;
+            }
+            caches_grew();
+            return field;
+        }
+    }
+
+    ObjectPrototype* parent;
     if (!info()) {
         // Custom JS classes can't have fields, and fields on internal classes
         // are not available. We must be looking up a field on a
@@ -1789,46 +2384,45 @@ GIFieldInfo* ObjectPrototype::lookup_cached_field_info(JSContext* cx,
         GType parent_gtype = g_type_parent(m_gtype);
         g_assert(parent_gtype != G_TYPE_INVALID &&
                  "Custom JS class must have parent");
-        ObjectPrototype* parent_proto =
-            ObjectPrototype::for_gtype(parent_gtype);
-        g_assert(parent_proto &&
+        parent = ObjectPrototype::for_gtype(parent_gtype);
+        g_assert(parent &&
                  "Custom JS class's parent must have been accessed in JS");
-        return parent_proto->lookup_cached_field_info(cx, key);
+    } else {
+        // We must be looking up a field defined on a parent. Look up the
+        // prototype object via its GIObjectInfo.
+        GjsAutoObjectInfo parent_info = g_object_info_get_parent(m_info);
+        JS::RootedObject parent_proto(cx, gjs_lookup_object_prototype_from_info(
+                                              cx, parent_info, G_TYPE_INVALID));
+        parent = ObjectPrototype::for_js(cx, parent_proto);
     }
 
-    gjs_debug_jsprop(GJS_DEBUG_GOBJECT,
-                     "Looking up cached field info for '%s' in '%s' prototype",
-                     gjs_debug_string(key).c_str(), g_type_name(m_gtype));
-    auto entry = m_field_cache.lookupForAdd(key);
-    if (entry)
-        return entry->value().get();
-
-    // We must be looking up a field defined on a parent. Look up the prototype
-    // object via its GIObjectInfo.
-    GjsAutoObjectInfo parent_info = g_object_info_get_parent(m_info);
-    JS::RootedObject parent_proto(cx, gjs_lookup_object_prototype_from_info(
-                                          cx, parent_info, G_TYPE_INVALID));
-    ObjectPrototype* parent = ObjectPrototype::for_js(cx, parent_proto);
-    return parent->lookup_cached_field_info(cx, key);
+    GIFieldInfo* field = parent->lookup_cached_field_info(cx, key);
+    if (!field)
+        return nullptr;
+    // Failing to memoize is not an error, the next lookup just walks the chain
+    // again
+    if (m_field_cache.putNew(key, GjsAutoFieldInfo(g_base_info_ref(field))))
+        caches_grew();
+    return field;
 }
 
 void ObjectInstance::associate_closure(JSContext* cx, GClosure* closure) {
     if (!is_prototype())
-        to_instance()->ensure_uses_toggle_ref(cx);
+        to_instance()->ensure_uses_toggle_ref_before_gc(cx);
 
     /* This is a weak reference, and will be cleared when the closure is
      * invalidated */
     auto already_has = std::find(m_closures.begin(), m_closures.end(), closure);
     g_assert(already_has == m_closures.end() &&
              "This closure was already associated with this object");
-    m_closures.push_front(closure);
+    m_closures.push_back(closure);
     g_closure_add_invalidate_notifier(
         closure, this, &ObjectInstance::closure_invalidated_notify);
 }
 
 void ObjectInstance::closure_invalidated_notify(void* data, GClosure* closure) {
     auto* priv = static_cast<ObjectInstance*>(data);
-    priv->m_closures.remove(closure);
+    remove_closure(&priv->m_closures, closure);
 }
 
 bool ObjectBase::connect(JSContext* cx, unsigned argc, JS::Value* vp) {
@@ -1847,6 +2441,87 @@ bool ObjectBase::connect_after(JSContext* cx, unsigned argc, JS::Value* vp) {
     return priv->to_instance()->connect_impl(cx, args, true);
 }
 
+// Reads the options of connect(): a handler group, and one of throttle or
+// debounce with an interval in milliseconds
+GJS_JSAPI_RETURN_CONVENTION
+static bool connect_options_from_object(JSContext* cx,
+                                        JS::HandleObject options,
+                                        uint32_t* group_out,
+                                        GjsSignalRateLimit* rate_limit_out,
+                                        uint32_t* interval_ms_out) {
+    const GjsAtoms& atoms = GjsContextPrivate::atoms(cx);
+    JS::RootedValue value(cx);
+
+    if (!JS_GetPropertyById(cx, options, atoms.group(), &value))
+        return false;
+    if (!value.isUndefined() && !JS::ToUint32(cx, value, group_out))
+        return false;
+
+    const struct {
+        JS::HandleId id;
+        const char* name;
+        GjsSignalRateLimit rate_limit;
+    } kinds[] = {
+        {atoms.throttle(), "throttle", GjsSignalRateLimit::THROTTLE},
+        {atoms.debounce(), "debounce", GjsSignalRateLimit::DEBOUNCE},
+    };
+    for (const auto& kind : kinds) {
+        if (!JS_GetPropertyById(cx, options, kind.id, &value))
+            return false;
+        if (value.isUndefined())
+            continue;
+
+        if (*rate_limit_out != GjsSignalRateLimit::NONE) {
+            gjs_throw(cx, "Can't both throttle and debounce a signal handler");
+            return false;
+        }
+
+        uint32_t interval_ms;
+        if (!JS::ToUint32(cx, value, &interval_ms))
+            return false;
+        if (interval_ms == 0) {
+            gjs_throw(cx, "'%s' option must be a positive number of ms",
+                      kind.name);
+            return false;
+        }
+        *rate_limit_out = kind.rate_limit;
+        *interval_ms_out = interval_ms;
+    }
+
+    return true;
+}
+
+// A throttled or debounced handler runs after the emission has returned, from
+// copies of its parameters, so the signal can't have a return value, or
+// parameters that are bare pointers which may be gone by then
+GJS_JSAPI_RETURN_CONVENTION
+static bool check_signal_can_be_rate_limited(JSContext* cx,
+                                             unsigned signal_id) {
+    GSignalQuery query;
+    g_signal_query(signal_id, &query);
+
+    if ((query.return_type & ~G_SIGNAL_TYPE_STATIC_SCOPE) != G_TYPE_NONE) {
+        gjs_throw(cx,
+                  "Handlers of signal '%s' can't be throttled or debounced, "
+                  "because it has a return value",
+                  query.signal_name);
+        return false;
+    }
+
+    for (unsigned i = 0; i < query.n_params; i++) {
+        GType type = query.param_types[i] & ~G_SIGNAL_TYPE_STATIC_SCOPE;
+        if (G_TYPE_FUNDAMENTAL(type) == G_TYPE_POINTER) {
+            gjs_throw(cx,
+                      "Handlers of signal '%s' can't be throttled or "
+                      "debounced, because it has a pointer parameter",
+                      query.signal_name);
+            return false;
+        }
+    }
+
+    return true;
+}
+
 bool
 ObjectInstance::connect_impl(JSContext          *context,
                              const JS::CallArgs& args,
@@ -1862,12 +2537,27 @@ ObjectInstance::connect_impl(JSContext          *context,
     if (!check_gobject_disposed("connect to any signal on"))
         return true;
 
+    const char* func_name = after ? "connect_after" : "connect";
     JS::UniqueChars signal_name;
     JS::RootedObject callback(context);
-    if (!gjs_parse_call_args(context, after ? "connect_after" : "connect", args, "so",
-                             "signal name", &signal_name,
-                             "callback", &callback))
+    JS::RootedObject options(context);
+    uint32_t group = 0;
+    GjsSignalRateLimit rate_limit = GjsSignalRateLimit::NONE;
+    uint32_t interval_ms = 0;
+    // The last argument is either a handler group or an object of options
+    if (args.get(2).isObject()) {
+        if (!gjs_parse_call_args(context, func_name, args, "so|o",
+                                 "signal name", &signal_name, "callback",
+                                 &callback, "options", &options) ||
+            !connect_options_from_object(context, options, &group, &rate_limit,
+                                         &interval_ms))
+            return false;
+    } else if (!gjs_parse_call_args(context, func_name, args, "so|u",
+                                    "signal name", &signal_name,
+                                    "callback", &callback,
+                                    "group", &group)) {
         return false;
+    }
 
     if (!JS::IsCallable(callback)) {
         gjs_throw(context, "second arg must be a callback");
@@ -1881,10 +2571,20 @@ ObjectInstance::connect_impl(JSContext          *context,
         return false;
     }
 
-    closure = gjs_closure_new_for_signal(
-        context, JS_GetObjectFunction(callback), "signal callback", signal_id);
+    if (rate_limit != GjsSignalRateLimit::NONE &&
+        !check_signal_can_be_rate_limited(context, signal_id))
+        return false;
+
+    closure = gjs_closure_new_for_signal(context,
+                                         JS_GetObjectFunction(callback),
+                                         "signal callback", signal_id,
+                                         rate_limit, interval_ms);
     if (closure == NULL)
         return false;
+    // A handler's group is kept as its closure's data, which our closures
+    // don't otherwise use, so that GLib can match a whole group in one call
+    // with G_SIGNAL_MATCH_DATA
+    closure->data = GUINT_TO_POINTER(group);
     associate_closure(context, closure);
 
     id = g_signal_connect_closure_by_id(m_ptr, signal_id, signal_detail,
@@ -1895,6 +2595,44 @@ ObjectInstance::connect_impl(JSContext          *context,
     return true;
 }
 
+bool ObjectBase::set_properties(JSContext* cx, unsigned argc, JS::Value* vp) {
+    GJS_GET_WRAPPER_PRIV(cx, argc, vp, args, obj, ObjectBase, priv);
+    if (!priv->check_is_instance(cx, "set properties"))
+        return false;
+
+    return priv->to_instance()->set_properties_impl(cx, args);
+}
+
+// Sets all the GObject properties in a JS object in one g_object_setv() call,
+// so that the "notify" signals are emitted only after all of them have been
+// set. (g_object_setv() freezes notifications while it sets the properties.)
+// Unlike assigning the properties one by one, any property that is not a
+// writable GObject property is an error.
+bool ObjectInstance::set_properties_impl(JSContext* cx,
+                                         const JS::CallArgs& args) {
+    args.rval().setUndefined();
+
+    if (!check_gobject_disposed("set any property on"))
+        return true;
+
+    JS::RootedObject props(cx);
+    if (!gjs_parse_call_args(cx, "set_properties", args, "o", "properties",
+                             &props))
+        return false;
+
+    GParamNameVector names;
+    AutoGValueVector values;
+    if (!get_prototype()->props_to_g_parameters(cx, props, &names, &values))
+        return false;
+
+    g_assert(names.length() == values.length());
+    if (names.empty())
+        return true;
+
+    g_object_setv(m_ptr, names.length(), names.begin(), values.begin());
+    return true;
+}
+
 bool ObjectBase::emit(JSContext* cx, unsigned argc, JS::Value* vp) {
     GJS_GET_WRAPPER_PRIV(cx, argc, vp, args, obj, ObjectBase, priv);
     if (!priv->check_is_instance(cx, "emit signal"))
@@ -1903,13 +2641,46 @@ bool ObjectBase::emit(JSContext* cx, unsigned argc, JS::Value* vp) {
     return priv->to_instance()->emit_impl(cx, args);
 }
 
+// Signal names passed to emit() are usually string literals, so they are
+// cached by atom; parsing the detailed name and querying the signal would
+// otherwise happen on every emission.
+const GjsCachedSignal* ObjectPrototype::lookup_cached_signal(
+    JSContext* cx, JS::HandleString name) {
+    JS::RootedId id(cx);
+    if (!JS_StringToId(cx, name, &id))
+        return nullptr;
+
+    if (auto entry = m_signal_cache.lookup(id)) {
+        m_cache_entry.touch();
+        return &entry->value();
+    }
+
+    JS::UniqueChars signal_name(JS_EncodeStringToUTF8(cx, name));
+    if (!signal_name)
+        return nullptr;
+
+    GjsCachedSignal signal;
+    unsigned signal_id;
+    if (!g_signal_parse_name(signal_name.get(), m_gtype, &signal_id,
+                             &signal.detail, false)) {
+        gjs_throw(cx, "No signal '%s' on object '%s'", signal_name.get(),
+                  g_type_name(m_gtype));
+        return nullptr;
+    }
+    g_signal_query(signal_id, &signal.query);
+
+    if (!m_signal_cache.putNew(id, signal)) {
+        JS_ReportOutOfMemory(cx);
+        return nullptr;
+    }
+    caches_grew();
+    return &m_signal_cache.lookup(id)->value();
+}
+
 bool
 ObjectInstance::emit_impl(JSContext          *context,
                           const JS::CallArgs& argv)
 {
-    guint signal_id;
-    GQuark signal_detail;
-    GSignalQuery signal_query;
     GValue *instance_and_args;
     GValue rvalue = G_VALUE_INIT;
     unsigned int i;
@@ -1921,23 +2692,31 @@ ObjectInstance::emit_impl(JSContext          *context,
     if (!check_gobject_disposed("emit any signal on"))
         return true;
 
-    JS::UniqueChars signal_name;
-    if (!gjs_parse_call_args(context, "emit", argv, "!s",
-                             "signal name", &signal_name))
-        return false;
+    if (argv.length() == 0 || !argv[0].isString()) {
+        // Let the argument parser throw its usual exception
+        JS::UniqueChars unused;
+        if (!gjs_parse_call_args(context, "emit", argv, "!s", "signal name",
+                                 &unused))
+            return false;
+    }
 
-    if (!g_signal_parse_name(signal_name.get(), gtype(), &signal_id,
-                             &signal_detail, false)) {
-        gjs_throw(context, "No signal '%s' on object '%s'",
-                  signal_name.get(), type_name());
+    JS::RootedString signal_name(context, argv[0].toString());
+    const GjsCachedSignal* cached_signal =
+        get_prototype()->lookup_cached_signal(context, signal_name);
+    if (!cached_signal)
         return false;
-    }
 
-    g_signal_query(signal_id, &signal_query);
+    // Copied, since converting the arguments may run JS code that adds to the
+    // cache
+    const GjsCachedSignal signal = *cached_signal;
+    const GSignalQuery& signal_query = signal.query;
 
     if ((argv.length() - 1) != signal_query.n_params) {
+        JS::UniqueChars name(JS_EncodeStringToUTF8(context, signal_name));
+        if (!name)
+            return false;
         gjs_throw(context, "Signal '%s' on %s requires %d args got %d",
-                  signal_name.get(), type_name(), signal_query.n_params,
+                  name.get(), type_name(), signal_query.n_params,
                   argv.length() - 1);
         return false;
     }
@@ -1968,8 +2747,8 @@ ObjectInstance::emit_impl(JSContext          *context,
     }
 
     if (!failed) {
-        g_signal_emitv(instance_and_args, signal_id, signal_detail,
-                       &rvalue);
+        g_signal_emitv(instance_and_args, signal_query.signal_id,
+                       signal.detail, &rvalue);
     }
 
     if (signal_query.return_type != G_TYPE_NONE) {
@@ -1990,9 +2769,10 @@ ObjectInstance::emit_impl(JSContext          *context,
 
 bool ObjectInstance::signal_match_arguments_from_object(
     JSContext* cx, JS::HandleObject match_obj, GSignalMatchType* mask_out,
-    unsigned* signal_id_out, GQuark* detail_out,
+    unsigned* signal_id_out, GQuark* detail_out, uint32_t* group_out,
     JS::MutableHandleFunction func_out) {
-    g_assert(mask_out && signal_id_out && detail_out && "forgot out parameter");
+    g_assert(mask_out && signal_id_out && detail_out && group_out &&
+             "forgot out parameter");
 
     int mask = 0;
     const GjsAtoms& atoms = GjsContextPrivate::atoms(cx);
@@ -2052,8 +2832,29 @@ bool ObjectInstance::signal_match_arguments_from_object(
         func = JS_GetObjectFunction(&value.toObject());
     }
 
-    if (!has_id && !has_detail && !has_func) {
-        gjs_throw(cx, "Must specify at least one of signalId, detail, or func");
+    bool has_group;
+    uint32_t group = 0;
+    if (!JS_HasOwnPropertyById(cx, match_obj, atoms.group(), &has_group))
+        return false;
+    if (has_group) {
+        mask |= G_SIGNAL_MATCH_DATA;
+
+        JS::RootedValue value(cx);
+        if (!JS_GetPropertyById(cx, match_obj, atoms.group(), &value) ||
+            !JS::ToUint32(cx, value, &group))
+            return false;
+
+        // Group 0 is every handler connected without a group
+        if (group == 0) {
+            gjs_throw(cx, "'group' property must be a nonzero number");
+            return false;
+        }
+    }
+
+    if (!has_id && !has_detail && !has_func && !has_group) {
+        gjs_throw(cx,
+                  "Must specify at least one of signalId, detail, func, or "
+                  "group");
         return false;
     }
 
@@ -2064,6 +2865,8 @@ bool ObjectInstance::signal_match_arguments_from_object(
         *detail_out = detail;
     if (has_func)
         func_out.set(func);
+    if (has_group)
+        *group_out = group;
     return true;
 }
 
@@ -2090,20 +2893,22 @@ bool ObjectInstance::signal_find_impl(JSContext* cx, const JS::CallArgs& args) {
     GSignalMatchType mask;
     unsigned signal_id;
     GQuark detail;
+    uint32_t group = 0;
     JS::RootedFunction func(cx);
     if (!signal_match_arguments_from_object(cx, match, &mask, &signal_id,
-                                            &detail, &func))
+                                            &detail, &group, &func))
         return false;
 
     uint64_t handler = 0;
     if (!func) {
         handler = g_signal_handler_find(m_ptr, mask, signal_id, detail, nullptr,
-                                        nullptr, nullptr);
+                                        nullptr, GUINT_TO_POINTER(group));
     } else {
         for (GClosure* candidate : m_closures) {
             if (gjs_closure_get_callable(candidate) == func) {
                 handler = g_signal_handler_find(m_ptr, mask, signal_id, detail,
-                                                candidate, nullptr, nullptr);
+                                                candidate, nullptr,
+                                                GUINT_TO_POINTER(group));
                 if (handler != 0)
                     break;
             }
@@ -2164,15 +2969,18 @@ bool ObjectInstance::signals_action_impl(JSContext* cx,
     GSignalMatchType mask;
     unsigned signal_id;
     GQuark detail;
+    uint32_t group = 0;
     JS::RootedFunction func(cx);
     if (!signal_match_arguments_from_object(cx, match, &mask, &signal_id,
-                                            &detail, &func)) {
+                                            &detail, &group, &func)) {
         return false;
     }
     unsigned n_matched = 0;
     if (!func) {
+        // Without a function this is a single walk of the instance's handlers
+        // in GLib, which is how a whole group is blocked or disconnected
         n_matched = MatchFunc(m_ptr, mask, signal_id, detail, nullptr, nullptr,
-                              nullptr);
+                              GUINT_TO_POINTER(group));
     } else {
         std::vector<GClosure*> candidates;
         for (GClosure* candidate : m_closures) {
@@ -2181,7 +2989,7 @@ bool ObjectInstance::signals_action_impl(JSContext* cx,
         }
         for (GClosure* candidate : candidates) {
             n_matched += MatchFunc(m_ptr, mask, signal_id, detail, candidate,
-                                   nullptr, nullptr);
+                                   nullptr, GUINT_TO_POINTER(group));
         }
     }
 
@@ -2239,7 +3047,7 @@ const struct JSClassOps ObjectBase::class_ops = {
     nullptr,  // enumerate
     &ObjectBase::new_enumerate,
     &ObjectBase::resolve,
-    nullptr,  // mayResolve
+    &ObjectBase::may_resolve,
     &ObjectBase::finalize,
     NULL,
     NULL,
@@ -2258,14 +3066,55 @@ JSFunctionSpec ObjectBase::proto_methods[] = {
     JS_FN("connect", &ObjectBase::connect, 0, 0),
     JS_FN("connect_after", &ObjectBase::connect_after, 0, 0),
     JS_FN("emit", &ObjectBase::emit, 0, 0),
+    JS_FN("set_properties", &ObjectBase::set_properties, 1, 0),
     JS_FS_END
 };
 
 JSPropertySpec ObjectBase::proto_properties[] = {
     JS_STRING_SYM_PS(toStringTag, "GObject_Object", JSPROP_READONLY),
     JS_PS_END};
+
+JSFunctionSpec ObjectBase::static_methods[] = {
+    JS_SYM_FN(hasInstance, &ObjectBase::has_instance, 1, 0),
+    JS_FS_END
+};
 // clang-format on
 
+/*
+ * ObjectBase::has_instance:
+ *
+ * JSNative implementation of `[Symbol.hasInstance]()` on the constructors of
+ * introspected GObject classes. A GObject wrapper is checked by its GType, with
+ * g_type_is_a(), instead of walking its prototype chain, since looking up
+ * properties on GI prototypes may go through their resolve hooks. Anything
+ * else, including instanceof on JS subclasses, whose constructors inherit this
+ * method, gets the ordinary prototype chain check.
+ */
+bool ObjectBase::has_instance(JSContext* cx, unsigned argc, JS::Value* vp) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+    if (!args.thisv().isObject()) {
+        args.rval().setBoolean(false);
+        return true;
+    }
+
+    JS::RootedObject constructor(cx, &args.thisv().toObject());
+    if (ObjectBase::is_constructor(constructor) && args.get(0).isObject()) {
+        JS::RootedObject obj(cx, &args[0].toObject());
+        ObjectBase* priv = ObjectBase::for_js(cx, obj);
+        GType gtype = gjs_dynamic_class_get_gtype(constructor);
+        if (priv && !priv->is_prototype() && gtype != G_TYPE_INVALID) {
+            args.rval().setBoolean(g_type_is_a(priv->gtype(), gtype));
+            return true;
+        }
+    }
+
+    bool retval;
+    if (!JS::OrdinaryHasInstance(cx, constructor, args.get(0), &retval))
+        return false;
+    args.rval().setBoolean(retval);
+    return true;
+}
+
 // Override of GIWrapperPrototype::get_parent_proto()
 bool ObjectPrototype::get_parent_proto(JSContext* cx,
                                        JS::MutableHandleObject proto) const {
@@ -2296,6 +3145,9 @@ bool ObjectPrototype::define_class(JSContext* context,
                                    GIObjectInfo* info, GType gtype,
                                    JS::MutableHandleObject constructor,
                                    JS::MutableHandleObject prototype) {
+    GjsProfilerScope profiler_scope(context, "Define class",
+                                    g_type_name(gtype));
+
     if (!ObjectPrototype::create_class(context, in_object, info, gtype,
                                        constructor, prototype))
         return false;
@@ -2476,30 +3328,81 @@ bool ObjectInstance::typecheck_impl(JSContext* cx, GIBaseInfo* expected_info,
     return GIWrapperInstance::typecheck_impl(cx, expected_info, expected_type);
 }
 
-GJS_JSAPI_RETURN_CONVENTION
-static bool find_vfunc_info(JSContext* context, GType implementor_gtype,
-                            GIBaseInfo* vfunc_info, const char* vfunc_name,
-                            void** implementor_vtable_ret,
-                            GjsAutoFieldInfo* field_info_ret) {
-    GType ancestor_gtype;
-    int length, i;
-    GIBaseInfo *ancestor_info;
+// What is known about a vfunc name on an introspected class or interface.
+// This only depends on the introspection data, which never changes, so it is
+// looked up once and shared by every class deriving from that type; finding it
+// otherwise means walking the parent and interface infos for every vfunc of
+// every class that is registered.
+struct VFuncLookup {
+    GjsAutoVFuncInfo info;   // null if there is no such vfunc
+    int field_offset = -1;   // offset in the class or interface struct, or -1
+                             // if there is no callback field with the name
+};
+
+using VFuncKey = std::pair<GType, std::string>;
+
+struct VFuncKeyHash {
+    size_t operator()(const VFuncKey& key) const {
+        return std::hash<GType>()(key.first) ^
+               std::hash<std::string>()(key.second);
+    }
+};
+
+static std::unordered_map<VFuncKey, VFuncLookup, VFuncKeyHash> vfunc_lookups;
+
+static int find_vfunc_field_offset(GIVFuncInfo* vfunc_info,
+                                   const char* vfunc_name) {
+    GIBaseInfo* ancestor_info = g_base_info_get_container(vfunc_info);
     GjsAutoStructInfo struct_info;
-    bool is_interface;
+    if (g_base_info_get_type(ancestor_info) == GI_INFO_TYPE_INTERFACE)
+        struct_info = g_interface_info_get_iface_struct(ancestor_info);
+    else
+        struct_info = g_object_info_get_class_struct(ancestor_info);
 
-    field_info_ret->reset();
-    *implementor_vtable_ret = NULL;
+    int length = g_struct_info_get_n_fields(struct_info);
+    for (int i = 0; i < length; i++) {
+        GjsAutoFieldInfo field_info = g_struct_info_get_field(struct_info, i);
+        if (strcmp(field_info.name(), vfunc_name) != 0)
+            continue;
+
+        GjsAutoTypeInfo type_info = g_field_info_get_type(field_info);
+        /* We may have a field with the same name, but it's not a callback.
+         * There's no hope of being another field with a correct name. */
+        if (g_type_info_get_tag(type_info) != GI_TYPE_TAG_INTERFACE)
+            return -1;
+        return g_field_info_get_offset(field_info);
+    }
+    return -1;
+}
 
-    ancestor_info = g_base_info_get_container(vfunc_info);
-    ancestor_gtype = g_registered_type_info_get_g_type((GIRegisteredTypeInfo*)ancestor_info);
+[[nodiscard]] static const VFuncLookup& lookup_vfunc(GType gtype,
+                                                     GIBaseInfo* info,
+                                                     const char* name) {
+    auto result = vfunc_lookups.emplace(VFuncKey(gtype, name), VFuncLookup());
+    VFuncLookup& lookup = result.first->second;
+    if (!result.second)
+        return lookup;
 
-    is_interface = g_base_info_get_type(ancestor_info) == GI_INFO_TYPE_INTERFACE;
+    if (GI_IS_INTERFACE_INFO(info))
+        lookup.info = g_interface_info_find_vfunc(info, name);
+    else
+        lookup.info = find_vfunc_on_parents(info, name, nullptr);
+    if (lookup.info)
+        lookup.field_offset = find_vfunc_field_offset(lookup.info, name);
+    return lookup;
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool find_vfunc_vtable(JSContext* context, GType implementor_gtype,
+                              GIBaseInfo* vfunc_info,
+                              void** implementor_vtable_ret) {
+    GIBaseInfo* ancestor_info = g_base_info_get_container(vfunc_info);
+    GType ancestor_gtype = g_registered_type_info_get_g_type(ancestor_info);
 
     GjsAutoTypeClass<GTypeClass> implementor_class(implementor_gtype);
-    if (is_interface) {
-        GTypeInstance *implementor_iface_class;
-        implementor_iface_class = (GTypeInstance*) g_type_interface_peek(implementor_class,
-                                                        ancestor_gtype);
+    if (g_base_info_get_type(ancestor_info) == GI_INFO_TYPE_INTERFACE) {
+        void* implementor_iface_class =
+            g_type_interface_peek(implementor_class, ancestor_gtype);
         if (implementor_iface_class == NULL) {
             gjs_throw (context, "Couldn't find GType of implementor of interface %s.",
                        g_type_name(ancestor_gtype));
@@ -2507,30 +3410,9 @@ static bool find_vfunc_info(JSContext* context, GType implementor_gtype,
         }
 
         *implementor_vtable_ret = implementor_iface_class;
-
-        struct_info = g_interface_info_get_iface_struct((GIInterfaceInfo*)ancestor_info);
     } else {
-        struct_info = g_object_info_get_class_struct((GIObjectInfo*)ancestor_info);
         *implementor_vtable_ret = implementor_class;
     }
-
-    length = g_struct_info_get_n_fields(struct_info);
-    for (i = 0; i < length; i++) {
-        GjsAutoFieldInfo field_info = g_struct_info_get_field(struct_info, i);
-        if (strcmp(field_info.name(), vfunc_name) != 0)
-            continue;
-
-        GjsAutoTypeInfo type_info = g_field_info_get_type(field_info);
-        if (g_type_info_get_tag(type_info) != GI_TYPE_TAG_INTERFACE) {
-            /* We have a field with the same name, but it's not a callback.
-             * There's no hope of being another field with a correct name,
-             * so just abort early. */
-            return true;
-        } else {
-            *field_info_ret = std::move(field_info);
-            return true;
-        }
-    }
     return true;
 }
 
@@ -2551,7 +3433,11 @@ bool ObjectPrototype::hook_up_vfunc_impl(JSContext* cx,
         return false;
 
     args.rval().setUndefined();
+    return hook_up_vfunc_by_name(cx, name.get(), function);
+}
 
+bool ObjectPrototype::hook_up_vfunc_by_name(JSContext* cx, const char* name,
+                                            JS::HandleObject function) {
     /* find the first class that actually has repository information */
     GIObjectInfo *info = m_info;
     GType info_gtype = m_gtype;
@@ -2565,9 +3451,11 @@ bool ObjectPrototype::hook_up_vfunc_impl(JSContext* cx,
      * This is awful, so abort now. */
     g_assert(info != NULL);
 
-    GjsAutoVFuncInfo vfunc = find_vfunc_on_parents(info, name.get(), nullptr);
+    const VFuncLookup* lookup = &lookup_vfunc(info_gtype, info, name);
+    if (info != m_info)
+        g_base_info_unref(info);
 
-    if (!vfunc) {
+    if (!lookup->info) {
         guint i, n_interfaces;
         GType *interface_list;
 
@@ -2580,9 +3468,9 @@ bool ObjectPrototype::hook_up_vfunc_impl(JSContext* cx,
             /* The interface doesn't have to exist -- it could be private
              * or dynamic. */
             if (interface) {
-                vfunc = g_interface_info_find_vfunc(interface, name.get());
+                lookup = &lookup_vfunc(interface_list[i], interface, name);
 
-                if (vfunc)
+                if (lookup->info)
                     break;
             }
         }
@@ -2590,25 +3478,21 @@ bool ObjectPrototype::hook_up_vfunc_impl(JSContext* cx,
         g_free(interface_list);
     }
 
-    if (!vfunc) {
+    if (!lookup->info) {
         gjs_throw(cx, "Could not find definition of virtual function %s",
-                  name.get());
+                  name);
         return false;
     }
 
     void *implementor_vtable;
-    GjsAutoFieldInfo field_info;
-    if (!find_vfunc_info(cx, m_gtype, vfunc, name.get(), &implementor_vtable,
-                         &field_info))
+    if (!find_vfunc_vtable(cx, m_gtype, lookup->info, &implementor_vtable))
         return false;
 
-    if (field_info) {
-        gint offset;
+    if (lookup->field_offset >= 0) {
         gpointer method_ptr;
         GjsCallbackTrampoline *trampoline;
 
-        offset = g_field_info_get_offset(field_info);
-        method_ptr = G_STRUCT_MEMBER_P(implementor_vtable, offset);
+        method_ptr = G_STRUCT_MEMBER_P(implementor_vtable, lookup->field_offset);
 
         if (!js::IsFunctionObject(function)) {
             gjs_throw(cx, "Tried to deal with a vfunc that wasn't a function");
@@ -2616,7 +3500,7 @@ bool ObjectPrototype::hook_up_vfunc_impl(JSContext* cx,
         }
         JS::RootedFunction func(cx, JS_GetObjectFunction(function));
         trampoline = gjs_callback_trampoline_new(
-            cx, func, vfunc, GI_SCOPE_TYPE_NOTIFIED, true, true);
+            cx, func, lookup->info, GI_SCOPE_TYPE_NOTIFIED, true, true);
         if (!trampoline)
             return false;
 
@@ -2625,7 +3509,7 @@ bool ObjectPrototype::hook_up_vfunc_impl(JSContext* cx,
         g_assert(std::find(m_vfuncs.begin(), m_vfuncs.end(),
                            trampoline->js_function) == m_vfuncs.end() &&
                  "This vfunc was already associated with this class");
-        m_vfuncs.push_front(trampoline->js_function);
+        m_vfuncs.push_back(trampoline->js_function);
         g_closure_add_invalidate_notifier(
             trampoline->js_function, this,
             &ObjectPrototype::vfunc_invalidated_notify);
@@ -2643,7 +3527,7 @@ bool ObjectPrototype::hook_up_vfunc_impl(JSContext* cx,
 
 void ObjectPrototype::vfunc_invalidated_notify(void* data, GClosure* closure) {
     auto* priv = static_cast<ObjectPrototype*>(data);
-    priv->m_vfuncs.remove(closure);
+    remove_closure(&priv->m_vfuncs, closure);
 }
 
 bool
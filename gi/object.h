@@ -27,9 +27,12 @@
 #include <config.h>
 
 #include <stddef.h>  // for size_t
+#include <stdint.h>  // for uint8_t
 
-#include <forward_list>
 #include <functional>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include <girepository.h>
@@ -37,16 +40,16 @@
 #include <glib.h>
 
 #include <js/GCHashTable.h>  // for GCHashMap
+#include <js/GCPolicyAPI.h>  // for IgnoreGCPolicy
 #include <js/Id.h>
 #include <js/PropertySpec.h>
 #include <js/RootingAPI.h>
 #include <js/TypeDecls.h>
-#include <jsfriendapi.h>            // for JSID_IS_ATOM, JSID_TO_ATOM
-#include <mozilla/HashFunctions.h>  // for HashGeneric, HashNumber
-#include <mozilla/HashTable.h>      // for DefaultHasher
-#include <mozilla/Likely.h>         // for MOZ_LIKELY
+
+#include <mozilla/Vector.h>
 
 #include "gi/wrapperutils.h"
+#include "cjs/cache-budget.h"
 #include "cjs/jsapi-util-root.h"
 #include "cjs/jsapi-util.h"
 #include "cjs/macros.h"
@@ -54,6 +57,7 @@
 
 class GjsAtoms;
 class JSTracer;
+struct JSAtomState;
 namespace JS {
 class CallArgs;
 }
@@ -63,23 +67,15 @@ class SystemAllocPolicy;
 class ObjectInstance;
 class ObjectPrototype;
 
-class GjsListLink {
- private:
-    ObjectInstance* m_prev;
-    ObjectInstance* m_next;
+// Names and values of the properties passed to a constructor or to
+// set_properties(), with room inline for the usual handful of properties so
+// that setting them doesn't allocate
+static constexpr size_t GJS_INLINE_PROPS = 8;
+using GParamNameVector = mozilla::Vector<const char*, GJS_INLINE_PROPS>;
 
- public:
-    [[nodiscard]] ObjectInstance* prev() const { return m_prev; }
-    [[nodiscard]] ObjectInstance* next() const { return m_next; }
-
-    void prepend(ObjectInstance* this_instance, ObjectInstance* head);
-    void unlink(void);
-    [[nodiscard]] size_t size() const;
-};
-
-struct AutoGValueVector : public std::vector<GValue> {
+struct AutoGValueVector : public mozilla::Vector<GValue, GJS_INLINE_PROPS> {
     ~AutoGValueVector() {
-        for (GValue value : *this)
+        for (GValue& value : *this)
             g_value_unset(&value);
     }
 };
@@ -114,6 +110,7 @@ class ObjectBase
     static const struct JSClass klass;
     static JSFunctionSpec proto_methods[];
     static JSPropertySpec proto_properties[];
+    static JSFunctionSpec static_methods[];
 
     static GObject* to_c_ptr(JSContext* cx, JS::HandleObject obj) = delete;
     GJS_JSAPI_RETURN_CONVENTION
@@ -158,6 +155,8 @@ class ObjectBase
 
     static bool add_property(JSContext* cx, JS::HandleObject obj,
                              JS::HandleId id, JS::HandleValue value);
+    [[nodiscard]] static bool may_resolve(const JSAtomState& names, jsid id,
+                                          JSObject* maybe_obj);
 
     /* JS property getters/setters */
 
@@ -180,6 +179,8 @@ class ObjectBase
     GJS_JSAPI_RETURN_CONVENTION
     static bool emit(JSContext* cx, unsigned argc, JS::Value* vp);
     GJS_JSAPI_RETURN_CONVENTION
+    static bool set_properties(JSContext* cx, unsigned argc, JS::Value* vp);
+    GJS_JSAPI_RETURN_CONVENTION
     static bool signal_find(JSContext* cx, unsigned argc, JS::Value* vp);
     template <SignalMatchFunc(*MATCH_FUNC)>
     GJS_JSAPI_RETURN_CONVENTION static bool signals_action(JSContext* cx,
@@ -192,6 +193,8 @@ class ObjectBase
     static bool init_gobject(JSContext* cx, unsigned argc, JS::Value* vp);
     GJS_JSAPI_RETURN_CONVENTION
     static bool hook_up_vfunc(JSContext* cx, unsigned argc, JS::Value* vp);
+    GJS_JSAPI_RETURN_CONVENTION
+    static bool has_instance(JSContext* cx, unsigned argc, JS::Value* vp);
 
     /* Quarks */
 
@@ -199,19 +202,44 @@ class ObjectBase
     [[nodiscard]] static GQuark custom_property_quark();
 };
 
-// See https://bugzilla.mozilla.org/show_bug.cgi?id=1614220
-struct IdHasher {
-    typedef jsid Lookup;
-    static mozilla::HashNumber hash(jsid id) {
-        if (MOZ_LIKELY(JSID_IS_ATOM(id)))
-            return js::DefaultHasher<JSAtom*>::hash(JSID_TO_ATOM(id));
-        if (JSID_IS_SYMBOL(id))
-            return js::DefaultHasher<JS::Symbol*>::hash(JSID_TO_SYMBOL(id));
-        return mozilla::HashGeneric(JSID_BITS(id));
-    }
-    static bool match(jsid id1, jsid id2) { return id1 == id2; }
+// How a GObject property's GValue is marshalled to and from JS. This is
+// decided once from the property's value type, when its GParamSpec is cached,
+// so that the property accessors can skip the generic GValue conversion for
+// the common scalar, string, and object cases.
+enum class GjsPropertyMarshal : uint8_t {
+    GENERIC = 0,
+    BOOLEAN,
+    INT,
+    UINT,
+    DOUBLE,
+    FLOAT,
+    STRING,
+    OBJECT,
+};
+
+struct GjsCachedProperty {
+    GjsAutoParam param;
+    GjsPropertyMarshal marshal;
 };
 
+/* For use of GjsCachedProperty in GC hash maps */
+namespace JS {
+template <>
+struct GCPolicy<GjsCachedProperty> : public IgnoreGCPolicy<GjsCachedProperty> {
+};
+}  // namespace JS
+
+// Result of parsing a detailed signal name for emit()
+struct GjsCachedSignal {
+    GSignalQuery query;
+    GQuark detail;
+};
+
+namespace JS {
+template <>
+struct GCPolicy<GjsCachedSignal> : public IgnoreGCPolicy<GjsCachedSignal> {};
+}  // namespace JS
+
 class ObjectPrototype
     : public GIWrapperPrototype<ObjectBase, ObjectPrototype, ObjectInstance> {
     friend class GIWrapperPrototype<ObjectBase, ObjectPrototype,
@@ -219,19 +247,32 @@ class ObjectPrototype
     friend class GIWrapperBase<ObjectBase, ObjectPrototype, ObjectInstance>;
 
     using PropertyCache =
-        JS::GCHashMap<JS::Heap<JSString*>, GjsAutoParam,
+        JS::GCHashMap<JS::Heap<JSString*>, GjsCachedProperty,
                       js::DefaultHasher<JSString*>, js::SystemAllocPolicy>;
     using FieldCache =
         JS::GCHashMap<JS::Heap<JSString*>, GjsAutoInfo<GI_INFO_TYPE_FIELD>,
                       js::DefaultHasher<JSString*>, js::SystemAllocPolicy>;
     using NegativeLookupCache =
         JS::GCHashSet<JS::Heap<jsid>, IdHasher, js::SystemAllocPolicy>;
+    using SignalCache = JS::GCHashMap<JS::Heap<jsid>, GjsCachedSignal, IdHasher,
+                                      js::SystemAllocPolicy>;
 
     PropertyCache m_property_cache;
     FieldCache m_field_cache;
+    SignalCache m_signal_cache;
     NegativeLookupCache m_unresolvable_cache;
+    GjsEnumeratedIds m_enumerated_ids;
+    // The caches above are rebuilt as they are used, so they are emptied
+    // together if they go over the cache budget
+    GjsCacheEntry m_cache_entry;
     // a list of vfunc GClosures installed on this prototype, used when tracing
-    std::forward_list<GClosure*> m_vfuncs;
+    std::vector<GClosure*> m_vfuncs;
+    // The introspectable interfaces of the GType and their methods by name,
+    // for resolving on types without GI info; see ensure_interface_index()
+    std::vector<GjsAutoInterfaceInfo> m_interface_infos;
+    std::unordered_map<std::string_view, GjsAutoFunctionInfo>
+        m_interface_methods;
+    bool m_interface_index_built = false;
 
     ObjectPrototype(GIObjectInfo* info, GType gtype);
     ~ObjectPrototype();
@@ -254,6 +295,16 @@ class ObjectPrototype
                                       JS::HandleId id, bool* resolved,
                                       const char* name);
 
+    void ensure_interface_index(void);
+
+    GJS_JSAPI_RETURN_CONVENTION
+    bool enumerate_uncached(JSContext* cx,
+                            JS::MutableHandleIdVector properties);
+
+    [[nodiscard]] size_t cache_size() const;
+    void caches_grew() { m_cache_entry.used(cache_size()); }
+    static void evict_caches(void* data);
+
     enum ResolveWhat { ConsiderOnlyMethods, ConsiderMethodsAndProperties };
     GJS_JSAPI_RETURN_CONVENTION
     bool resolve_no_info(JSContext* cx, JS::HandleObject obj, JS::HandleId id,
@@ -266,12 +317,21 @@ class ObjectPrototype
  public:
     void set_type_qdata(void);
     GJS_JSAPI_RETURN_CONVENTION
-    GParamSpec* find_param_spec_from_id(JSContext* cx, JS::HandleString key);
+    const GjsCachedProperty* find_property_from_id(JSContext* cx,
+                                                   JS::HandleString key);
+    GJS_JSAPI_RETURN_CONVENTION
+    GParamSpec* find_param_spec_from_id(JSContext* cx, JS::HandleString key) {
+        const GjsCachedProperty* prop = find_property_from_id(cx, key);
+        return prop ? prop->param.get() : nullptr;
+    }
     GJS_JSAPI_RETURN_CONVENTION
     GIFieldInfo* lookup_cached_field_info(JSContext* cx, JS::HandleString key);
     GJS_JSAPI_RETURN_CONVENTION
+    const GjsCachedSignal* lookup_cached_signal(JSContext* cx,
+                                                JS::HandleString name);
+    GJS_JSAPI_RETURN_CONVENTION
     bool props_to_g_parameters(JSContext* cx, JS::HandleObject props,
-                               std::vector<const char*>* names,
+                               GParamNameVector* names,
                                AutoGValueVector* values);
 
     GJS_JSAPI_RETURN_CONVENTION
@@ -280,6 +340,12 @@ class ObjectPrototype
                              JS::MutableHandleObject constructor,
                              JS::MutableHandleObject prototype);
 
+    // Whether resolve_impl() already found that @id is not defined lazily on
+    // this prototype
+    [[nodiscard]] bool is_unresolvable(jsid id) const {
+        return m_unresolvable_cache.has(id);
+    }
+
     void ref_vfuncs(void) {
         for (GClosure* closure : m_vfuncs)
             g_closure_ref(closure);
@@ -305,6 +371,9 @@ class ObjectPrototype
  public:
     GJS_JSAPI_RETURN_CONVENTION
     bool hook_up_vfunc_impl(JSContext* cx, const JS::CallArgs& args);
+    GJS_JSAPI_RETURN_CONVENTION
+    bool hook_up_vfunc_by_name(JSContext* cx, const char* name,
+                               JS::HandleObject function);
 };
 
 class ObjectInstance : public GIWrapperInstance<ObjectBase, ObjectPrototype,
@@ -314,13 +383,17 @@ class ObjectInstance : public GIWrapperInstance<ObjectBase, ObjectPrototype,
     friend class GIWrapperBase<ObjectBase, ObjectPrototype, ObjectInstance>;
     friend class ObjectBase;  // for add_property, prop_getter, etc.
 
+    static constexpr bool use_slab_allocator = true;
+
     // GIWrapperInstance::m_ptr may be null in ObjectInstance.
 
     GjsMaybeOwned<JSObject*> m_wrapper;
     // a list of all GClosures installed on this object (from signal connections
-    // and scope-notify callbacks passed to methods), used when tracing
-    std::forward_list<GClosure*> m_closures;
-    GjsListLink m_instance_link;
+    // and scope-notify callbacks passed to methods), used when tracing. Kept
+    // contiguous, since it is walked on every GC.
+    std::vector<GClosure*> m_closures;
+    // 1 + this instance's position in s_wrapped_gobjects, or 0 if not linked
+    uint32_t m_instance_slot;
 
     bool m_wrapper_finalized : 1;
     bool m_gobj_disposed : 1;
@@ -329,8 +402,13 @@ class ObjectInstance : public GIWrapperInstance<ObjectBase, ObjectPrototype,
      * managed using toggle references. False if this object just keeps a
      * hard ref on the underlying GObject, and may be finalized at will. */
     bool m_uses_toggle_ref : 1;
+    /* True if this object has gained visible JS state, but the switch to
+     * toggle references has been put off until the next GC, in case the
+     * object goes away before then. */
+    bool m_toggle_ref_pending : 1;
 
     static bool s_weak_pointer_callback;
+    static std::unordered_set<ObjectInstance*> s_pending_toggle_refs;
 
     /* Constructors */
 
@@ -388,6 +466,8 @@ class ObjectInstance : public GIWrapperInstance<ObjectBase, ObjectPrototype,
  public:
     void associate_closure(JSContext* cx, GClosure* closure);
 
+    static void activate_pending_toggle_refs(JSContext* cx);
+
     /* Helper methods */
 
  private:
@@ -395,6 +475,8 @@ class ObjectInstance : public GIWrapperInstance<ObjectBase, ObjectPrototype,
     void unset_object_qdata(void);
     void check_js_object_finalized(void);
     void ensure_uses_toggle_ref(JSContext* cx);
+    void ensure_uses_toggle_ref_before_gc(JSContext* cx);
+    void cancel_pending_toggle_ref(void);
     [[nodiscard]] bool check_gobject_disposed(const char* for_what) const;
     GJS_JSAPI_RETURN_CONVENTION
     bool signal_match_arguments_from_object(JSContext* cx,
@@ -402,6 +484,7 @@ class ObjectInstance : public GIWrapperInstance<ObjectBase, ObjectPrototype,
                                             GSignalMatchType* mask_out,
                                             unsigned* signal_id_out,
                                             GQuark* detail_out,
+                                            uint32_t* group_out,
                                             JS::MutableHandleFunction func_out);
 
  public:
@@ -413,19 +496,16 @@ class ObjectInstance : public GIWrapperInstance<ObjectBase, ObjectPrototype,
     bool init_custom_class_from_gobject(JSContext* cx, JS::HandleObject wrapper,
                                         GObject* gobj);
 
-    /* Methods to manipulate the linked list of instances */
+    /* Methods to manipulate the table of instances */
 
  private:
-    static ObjectInstance* wrapped_gobject_list;
-    [[nodiscard]] ObjectInstance* next() const {
-        return m_instance_link.next();
-    }
+    // Every instance that wraps a GObject. Kept dense, so that removing an
+    // instance moves the last one into its place.
+    static std::vector<ObjectInstance*> s_wrapped_gobjects;
     void link(void);
     void unlink(void);
     [[nodiscard]] static size_t num_wrapped_gobjects() {
-        return wrapped_gobject_list
-                   ? wrapped_gobject_list->m_instance_link.size()
-                   : 0;
+        return s_wrapped_gobjects.size();
     }
     using Action = std::function<void(ObjectInstance*)>;
     using Predicate = std::function<bool(ObjectInstance*)>;
@@ -434,9 +514,12 @@ class ObjectInstance : public GIWrapperInstance<ObjectBase, ObjectPrototype,
                                            const Action& action);
 
  public:
-    [[nodiscard]] GjsListLink* get_link() { return &m_instance_link; }
     static void prepare_shutdown(void);
 
+    GJS_JSAPI_RETURN_CONVENTION
+    static bool retention_report(JSContext* cx, const char* type_name,
+                                 JS::MutableHandleValue rval);
+
     /* JSClass operations */
 
  private:
@@ -475,6 +558,8 @@ class ObjectInstance : public GIWrapperInstance<ObjectBase, ObjectPrototype,
     GJS_JSAPI_RETURN_CONVENTION
     bool emit_impl(JSContext* cx, const JS::CallArgs& args);
     GJS_JSAPI_RETURN_CONVENTION
+    bool set_properties_impl(JSContext* cx, const JS::CallArgs& args);
+    GJS_JSAPI_RETURN_CONVENTION
     bool signal_find_impl(JSContext* cx, const JS::CallArgs& args);
     template <SignalMatchFunc(*MATCH_FUNC)>
     GJS_JSAPI_RETURN_CONVENTION bool signals_action_impl(
@@ -27,12 +27,13 @@
 #include <glib.h>
 
 #include <js/Class.h>
+#include <js/GCHashTable.h>  // for WeakCache
 #include <js/PropertySpec.h>
 #include <js/RootingAPI.h>
 #include <js/TypeDecls.h>
 #include <js/Utility.h>  // for UniqueChars
-#include <jsapi.h>       // for JS_GetClass, JS_GetPropertyById
-#include <jspubtd.h>     // for JSProto_TypeError
+#include <jsapi.h>  // for JS_GetClass, JS_GetPropertyById, JS_ReportOutOfMemory
+#include <jspubtd.h>  // for JSProto_TypeError
 
 #include "gi/function.h"
 #include "gi/param.h"
@@ -66,8 +67,8 @@ param_resolve(JSContext       *context,
         return true;
     }
 
-    JS::UniqueChars name;
-    if (!gjs_get_string_id(context, id, &name))
+    const char* name;
+    if (!gjs_get_interned_string_id(context, id, &name))
         return false;
     if (!name) {
         *resolved = false;
@@ -76,7 +77,7 @@ param_resolve(JSContext       *context,
 
     GjsAutoObjectInfo info = g_irepository_find_by_gtype(nullptr, G_TYPE_PARAM);
     GjsAutoFunctionInfo method_info =
-        g_object_info_find_method(info, name.get());
+        g_object_info_find_method(info, name);
 
     if (!method_info) {
         *resolved = false;
@@ -220,6 +221,12 @@ gjs_param_from_g_param(JSContext    *context,
     if (!gparam)
         return nullptr;
 
+    // The same GParamSpec is marshalled again on each emission of a notify
+    // signal, so reuse its wrapper if it is still alive
+    GjsContextPrivate* gjs = GjsContextPrivate::from_cx(context);
+    if (auto p = gjs->param_table().lookup(gparam))
+        return p->value();
+
     gjs_debug(GJS_DEBUG_GPARAM,
               "Wrapping %s '%s' on %s with JSObject",
               g_type_name(G_TYPE_FROM_INSTANCE((GTypeInstance*) gparam)),
@@ -229,11 +236,18 @@ gjs_param_from_g_param(JSContext    *context,
     JS::RootedObject proto(context, gjs_lookup_param_prototype(context));
 
     obj = JS_NewObjectWithGivenProto(context, JS_GetClass(proto), proto);
+    if (!obj)
+        return nullptr;
 
     GJS_INC_COUNTER(param);
     JS_SetPrivate(obj, gparam);
     g_param_spec_ref (gparam);
 
+    if (!gjs->param_table().putNew(gparam, obj)) {
+        JS_ReportOutOfMemory(context);
+        return nullptr;
+    }
+
     gjs_debug(GJS_DEBUG_GPARAM,
               "JSObject created with param instance %p type %s", gparam,
               g_type_name(G_TYPE_FROM_INSTANCE(gparam)));
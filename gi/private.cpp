@@ -26,18 +26,24 @@
 
 #include <stdint.h>
 
+#include <girepository.h>
 #include <glib-object.h>
 #include <glib.h>
 
 #include <js/Array.h>  // for JS::GetArrayLength,
 #include <js/CallArgs.h>
+#include <js/Conversions.h>  // for ToInt32, ToString
+#include <js/GCVector.h>     // for RootedVector
 #include <js/Id.h>  // for JSID_TO_SYMBOL
 #include <js/PropertySpec.h>
 #include <js/RootingAPI.h>
 #include <js/TypeDecls.h>
 #include <js/Utility.h>  // for UniqueChars
-#include <jsapi.h>       // for JS_GetElement
+#include <jsapi.h>       // for JS_GetElement, JS_Enumerate
+#include <jspubtd.h>      // for JSProto_TypeError
 
+#include "gi/boxed.h"
+#include "gi/function.h"
 #include "gi/gobject.h"
 #include "gi/gtype.h"
 #include "gi/interface.h"
@@ -45,10 +51,12 @@
 #include "gi/param.h"
 #include "gi/private.h"
 #include "gi/repo.h"
+#include "gi/variant.h"
 #include "cjs/atoms.h"
 #include "cjs/context-private.h"
 #include "cjs/jsapi-util-args.h"
 #include "cjs/jsapi-util.h"
+#include "cjs/profiler-private.h"
 
 /* gi/private.cpp - private "imports._gi" module with operations that we need
  * to use from JS in order to create GObject classes, but should not be exposed
@@ -259,21 +267,17 @@ static inline void gjs_add_interface(GType instance_type,
 }
 
 GJS_JSAPI_RETURN_CONVENTION
-static bool gjs_register_type(JSContext* cx, unsigned argc, JS::Value* vp) {
-    JS::CallArgs argv = JS::CallArgsFromVp(argc, vp);
-
-    JS::UniqueChars name;
-    GTypeFlags type_flags;
-    JS::RootedObject parent(cx), interfaces(cx), properties(cx);
-    if (!gjs_parse_call_args(cx, "register_type", argv, "osioo", "parent",
-                             &parent, "name", &name, "flags", &type_flags,
-                             "interfaces", &interfaces,
-                             "properties", &properties))
-        return false;
-
+static bool register_type_impl(JSContext* cx, JS::HandleObject parent,
+                               const char* name, GTypeFlags type_flags,
+                               JS::HandleObject interfaces,
+                               JS::HandleObject properties,
+                               JS::MutableHandleObject constructor,
+                               JS::MutableHandleObject prototype) {
     if (!parent)
         return false;
 
+    GjsProfilerScope profiler_scope(cx, "Register type", name);
+
     /* Don't pass the argv to it, as otherwise we will log about the callee
      * while we only care about the parent object type. */
     auto* parent_priv = ObjectBase::for_js_typecheck(cx, parent);
@@ -293,8 +297,8 @@ static bool gjs_register_type(JSContext* cx, unsigned argc, JS::Value* vp) {
     if (!get_interface_gtypes(cx, interfaces, n_interfaces, iface_types))
         return false;
 
-    if (g_type_from_name(name.get()) != G_TYPE_INVALID) {
-        gjs_throw(cx, "Type name %s is already registered", name.get());
+    if (g_type_from_name(name) != G_TYPE_INVALID) {
+        gjs_throw(cx, "Type name %s is already registered", name);
         return false;
     }
 
@@ -314,7 +318,7 @@ static bool gjs_register_type(JSContext* cx, unsigned argc, JS::Value* vp) {
     type_info.instance_size = query.instance_size;
 
     GType instance_type = g_type_register_static(
-        parent_priv->gtype(), name.get(), &type_info, type_flags);
+        parent_priv->gtype(), name, &type_info, type_flags);
 
     g_type_set_qdata(instance_type, ObjectBase::custom_type_quark(),
                      GINT_TO_POINTER(1));
@@ -328,36 +332,43 @@ static bool gjs_register_type(JSContext* cx, unsigned argc, JS::Value* vp) {
 
     /* create a custom JSClass */
     JS::RootedObject module(cx, gjs_lookup_private_namespace(cx));
-    JS::RootedObject constructor(cx), prototype(cx);
     if (!ObjectPrototype::define_class(cx, module, nullptr, instance_type,
-                                       &constructor, &prototype))
+                                       constructor, prototype))
         return false;
 
     auto* priv = ObjectPrototype::for_js(cx, prototype);
     priv->set_type_qdata();
-
-    argv.rval().setObject(*constructor);
-
     return true;
 }
 
 GJS_JSAPI_RETURN_CONVENTION
-static bool gjs_signal_new(JSContext* cx, unsigned argc, JS::Value* vp) {
-    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+static bool gjs_register_type(JSContext* cx, unsigned argc, JS::Value* vp) {
+    JS::CallArgs argv = JS::CallArgsFromVp(argc, vp);
 
-    JS::UniqueChars signal_name;
-    int32_t flags, accumulator_enum;
-    JS::RootedObject gtype_obj(cx), return_gtype_obj(cx), params_obj(cx);
-    if (!gjs_parse_call_args(cx, "signal_new", args, "osiioo", "gtype",
-                             &gtype_obj, "signal name", &signal_name, "flags",
-                             &flags, "accumulator", &accumulator_enum,
-                             "return gtype", &return_gtype_obj, "params",
-                             &params_obj))
+    JS::UniqueChars name;
+    GTypeFlags type_flags;
+    JS::RootedObject parent(cx), interfaces(cx), properties(cx);
+    if (!gjs_parse_call_args(cx, "register_type", argv, "osioo", "parent",
+                             &parent, "name", &name, "flags", &type_flags,
+                             "interfaces", &interfaces,
+                             "properties", &properties))
         return false;
 
-    if (!gjs_typecheck_gtype(cx, gtype_obj, true))
+    JS::RootedObject constructor(cx), prototype(cx);
+    if (!register_type_impl(cx, parent, name.get(), type_flags, interfaces,
+                            properties, &constructor, &prototype))
         return false;
 
+    argv.rval().setObject(*constructor);
+
+    return true;
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool signal_new_impl(JSContext* cx, GType gtype, const char* signal_name,
+                            int32_t flags, int32_t accumulator_enum,
+                            GType return_type, JS::HandleObject params_obj,
+                            unsigned* signal_id) {
     /* we only support standard accumulators for now */
     GSignalAccumulator accumulator;
     switch (accumulator_enum) {
@@ -372,10 +383,6 @@ static bool gjs_signal_new(JSContext* cx, unsigned argc, JS::Value* vp) {
             accumulator = nullptr;
     }
 
-    GType return_type;
-    if (!gjs_gtype_get_actual_gtype(cx, return_gtype_obj, &return_type))
-        return false;
-
     if (accumulator == g_signal_accumulator_true_handled &&
         return_type != G_TYPE_BOOLEAN) {
         gjs_throw(cx,
@@ -384,8 +391,8 @@ static bool gjs_signal_new(JSContext* cx, unsigned argc, JS::Value* vp) {
         return false;
     }
 
-    uint32_t n_parameters;
-    if (!JS::GetArrayLength(cx, params_obj, &n_parameters))
+    uint32_t n_parameters = 0;
+    if (params_obj && !JS::GetArrayLength(cx, params_obj, &n_parameters))
         return false;
 
     GType* params = g_newa(GType, n_parameters);
@@ -402,21 +409,516 @@ static bool gjs_signal_new(JSContext* cx, unsigned argc, JS::Value* vp) {
             return false;
     }
 
+    *signal_id = g_signal_newv(
+        signal_name, gtype, GSignalFlags(flags),
+        /* class closure */ nullptr, accumulator, /* accu_data */ nullptr,
+        /* c_marshaller */ nullptr, return_type, n_parameters, params);
+    return true;
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool gjs_signal_new(JSContext* cx, unsigned argc, JS::Value* vp) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+
+    JS::UniqueChars signal_name;
+    int32_t flags, accumulator_enum;
+    JS::RootedObject gtype_obj(cx), return_gtype_obj(cx), params_obj(cx);
+    if (!gjs_parse_call_args(cx, "signal_new", args, "osiioo", "gtype",
+                             &gtype_obj, "signal name", &signal_name, "flags",
+                             &flags, "accumulator", &accumulator_enum,
+                             "return gtype", &return_gtype_obj, "params",
+                             &params_obj))
+        return false;
+
+    if (!gjs_typecheck_gtype(cx, gtype_obj, true))
+        return false;
+
+    GType return_type;
+    if (!gjs_gtype_get_actual_gtype(cx, return_gtype_obj, &return_type))
+        return false;
+
     GType gtype;
     if (!gjs_gtype_get_actual_gtype(cx, gtype_obj, &gtype))
         return false;
 
-    unsigned signal_id = g_signal_newv(
-        signal_name.get(), gtype, GSignalFlags(flags),
-        /* class closure */ nullptr, accumulator, /* accu_data */ nullptr,
-        /* c_marshaller */ nullptr, return_type, n_parameters, params);
+    unsigned signal_id;
+    if (!signal_new_impl(cx, gtype, signal_name.get(), flags, accumulator_enum,
+                         return_type, params_obj, &signal_id))
+        return false;
 
     // FIXME: what if ID is greater than int32 max?
     args.rval().setInt32(signal_id);
     return true;
 }
 
-template <GjsSymbolAtom GjsAtoms::*member>
+// Rethrows the pending exception as a TypeError naming the signal, the same
+// way GObject.registerClass() reports signals that it fails to create
+GJS_JSAPI_RETURN_CONVENTION
+static bool throw_invalid_signal(JSContext* cx, const char* signal_name) {
+    JS::RootedValue exc(cx);
+    if (!JS_GetPendingException(cx, &exc))
+        return false;
+    JS_ClearPendingException(cx);
+
+    JS::RootedValue message(cx, exc);
+    if (exc.isObject()) {
+        JS::RootedObject exc_obj(cx, &exc.toObject());
+        if (!JS_GetProperty(cx, exc_obj, "message", &message))
+            return false;
+    }
+
+    JS::RootedString message_str(cx, JS::ToString(cx, message));
+    if (!message_str)
+        return false;
+    JS::UniqueChars message_utf8 = JS_EncodeStringToUTF8(cx, message_str);
+    if (!message_utf8)
+        return false;
+
+    gjs_throw_custom(cx, JSProto_TypeError, nullptr, "Invalid signal %s: %s",
+                     signal_name, message_utf8.get());
+    return false;
+}
+
+// Creates the signals described by the Signals object of a class, in the form
+// that GObject.registerClass() takes, and stores each one's ID in its
+// description as signal_id.
+GJS_JSAPI_RETURN_CONVENTION
+static bool create_class_signals(JSContext* cx, GType gtype,
+                                 JS::HandleObject signals) {
+    JS::Rooted<JS::IdVector> ids(cx, cx);
+    if (!JS_Enumerate(cx, signals, &ids))
+        return false;
+
+    JS::RootedValue spec_val(cx), value(cx);
+    JS::RootedObject spec(cx), return_gtype_obj(cx), params_obj(cx);
+    for (size_t ix = 0; ix < ids.length(); ix++) {
+        GjsStringBuffer<> signal_name;
+        if (!gjs_get_string_id(cx, ids[ix], &signal_name))
+            return false;
+        if (!signal_name)
+            continue;
+
+        if (!JS_GetPropertyById(cx, signals, ids[ix], &spec_val))
+            return false;
+        if (!spec_val.isObject()) {
+            gjs_throw_custom(cx, JSProto_TypeError, nullptr,
+                             "Invalid signal %s: expected an object",
+                             signal_name.get());
+            return false;
+        }
+        spec = &spec_val.toObject();
+
+        int32_t flags = G_SIGNAL_RUN_FIRST, accumulator = 0;
+        GType return_type = G_TYPE_NONE;
+        params_obj = nullptr;
+
+        if (!JS_GetProperty(cx, spec, "flags", &value) ||
+            (!value.isUndefined() && !JS::ToInt32(cx, value, &flags)) ||
+            !JS_GetProperty(cx, spec, "accumulator", &value) ||
+            (!value.isUndefined() && !JS::ToInt32(cx, value, &accumulator)) ||
+            !JS_GetProperty(cx, spec, "return_type", &value))
+            return false;
+
+        if (!value.isUndefined()) {
+            if (!value.isObject()) {
+                gjs_throw_custom(
+                    cx, JSProto_TypeError, nullptr,
+                    "Invalid signal %s: return type is not a GType",
+                    signal_name.get());
+                return false;
+            }
+            return_gtype_obj = &value.toObject();
+            if (!gjs_gtype_get_actual_gtype(cx, return_gtype_obj,
+                                            &return_type))
+                return throw_invalid_signal(cx, signal_name.get());
+        }
+
+        if (!JS_GetProperty(cx, spec, "param_types", &value))
+            return false;
+        if (!value.isUndefined()) {
+            if (!value.isObject()) {
+                gjs_throw_custom(
+                    cx, JSProto_TypeError, nullptr,
+                    "Invalid signal %s: param_types is not an Array",
+                    signal_name.get());
+                return false;
+            }
+            params_obj = &value.toObject();
+        }
+
+        unsigned signal_id;
+        if (!signal_new_impl(cx, gtype, signal_name.get(), flags, accumulator,
+                             return_type, params_obj, &signal_id))
+            return throw_invalid_signal(cx, signal_name.get());
+
+        value.setNumber(signal_id);
+        if (!JS_SetProperty(cx, spec, "signal_id", value))
+            return false;
+    }
+    return true;
+}
+
+// Hooks up the vfunc overrides of a class, given as an array of [name,
+// function] pairs, without going through a JS call for each one
+GJS_JSAPI_RETURN_CONVENTION
+static bool hook_up_class_vfuncs(JSContext* cx, JS::HandleObject prototype,
+                                 JS::HandleObject vfuncs) {
+    auto* priv = ObjectPrototype::for_js(cx, prototype);
+
+    uint32_t n_vfuncs;
+    if (!JS::GetArrayLength(cx, vfuncs, &n_vfuncs))
+        return false;
+
+    JS::RootedValue pair_val(cx), value(cx);
+    JS::RootedObject pair(cx), function(cx);
+    for (uint32_t ix = 0; ix < n_vfuncs; ix++) {
+        if (!JS_GetElement(cx, vfuncs, ix, &pair_val))
+            return false;
+        if (!pair_val.isObject()) {
+            gjs_throw(cx, "Invalid vfunc override number %u", ix);
+            return false;
+        }
+        pair = &pair_val.toObject();
+
+        if (!JS_GetElement(cx, pair, 0, &value))
+            return false;
+        if (!value.isString()) {
+            gjs_throw(cx, "Invalid vfunc override number %u", ix);
+            return false;
+        }
+        JS::UniqueChars name = gjs_string_to_utf8(cx, value);
+        if (!name || !JS_GetElement(cx, pair, 1, &value))
+            return false;
+        if (!value.isObject()) {
+            gjs_throw(cx, "Tried to deal with a vfunc that wasn't a function");
+            return false;
+        }
+        function = &value.toObject();
+
+        if (!priv->hook_up_vfunc_by_name(cx, name.get(), function))
+            return false;
+    }
+    return true;
+}
+
+// register_class(parent, name, flags, interfaces, properties, signals,
+// vfuncs): registers a type like register_type(), then creates its signals
+// and hooks up its vfunc overrides, all in one call
+GJS_JSAPI_RETURN_CONVENTION
+static bool gjs_register_class(JSContext* cx, unsigned argc, JS::Value* vp) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+
+    JS::UniqueChars name;
+    GTypeFlags type_flags;
+    JS::RootedObject parent(cx), interfaces(cx), properties(cx), signals(cx),
+        vfuncs(cx);
+    if (!gjs_parse_call_args(cx, "register_class", args, "osioooo", "parent",
+                             &parent, "name", &name, "flags", &type_flags,
+                             "interfaces", &interfaces, "properties",
+                             &properties, "signals", &signals, "vfuncs",
+                             &vfuncs))
+        return false;
+
+    JS::RootedObject constructor(cx), prototype(cx);
+    if (!register_type_impl(cx, parent, name.get(), type_flags, interfaces,
+                            properties, &constructor, &prototype))
+        return false;
+
+    auto* priv = ObjectPrototype::for_js(cx, prototype);
+    if (!create_class_signals(cx, priv->gtype(), signals) ||
+        !hook_up_class_vfuncs(cx, prototype, vfuncs))
+        return false;
+
+    args.rval().setObject(*constructor);
+    return true;
+}
+
+// Opt-in for overrides: numeric C arrays returned from functions in the given
+// namespace are converted to typed arrays (e.g. Int32Array, Float64Array) by
+// copying the buffer, instead of to plain arrays element by element. So are
+// C arrays of structs whose fields all have the same numeric type, such as
+// points, which become one typed array holding all the fields in order.
+GJS_JSAPI_RETURN_CONVENTION
+static bool gjs_set_typed_array_returns(JSContext* cx, unsigned argc,
+                                        JS::Value* vp) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+    JS::UniqueChars ns;
+    bool enabled;
+
+    if (!gjs_parse_call_args(cx, "set_typed_array_returns", args, "sb",
+                             "namespace", &ns, "enabled", &enabled))
+        return false;
+
+    GjsContextPrivate::from_cx(cx)->set_typed_array_namespace(ns.get(),
+                                                              enabled);
+    args.rval().setUndefined();
+    return true;
+}
+
+// Opt-in for overrides: short ASCII strings returned with transfer none from
+// functions in the given namespace are interned, so that a function returning
+// the same static string repeatedly doesn't allocate a new JS string each time.
+GJS_JSAPI_RETURN_CONVENTION
+static bool gjs_set_interned_string_returns(JSContext* cx, unsigned argc,
+                                            JS::Value* vp) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+    JS::UniqueChars ns;
+    bool enabled;
+
+    if (!gjs_parse_call_args(cx, "set_interned_string_returns", args, "sb",
+                             "namespace", &ns, "enabled", &enabled))
+        return false;
+
+    GjsContextPrivate::from_cx(cx)->set_interned_string_namespace(ns.get(),
+                                                                  enabled);
+    args.rval().setUndefined();
+    return true;
+}
+
+// Pre-atomizes the name of @info, and of the members that are looked up on it
+// by name when resolving: methods, fields, and properties as snake_case
+GJS_JSAPI_RETURN_CONVENTION
+static bool preatomize_info_names(JSContext* cx, GIBaseInfo* info) {
+    if (!gjs_preatomize_name(cx, g_base_info_get_name(info)))
+        return false;
+
+    auto preatomize_members = [cx](int n, auto get_member, bool is_property) {
+        for (int ix = 0; ix < n; ix++) {
+            GjsAutoBaseInfo member = get_member(ix);
+            if (!is_property) {
+                if (!gjs_preatomize_name(cx, member.name()))
+                    return false;
+                continue;
+            }
+            GjsAutoChar name = g_strdelimit(g_strdup(member.name()), "-", '_');
+            if (!gjs_preatomize_name(cx, name))
+                return false;
+        }
+        return true;
+    };
+
+    switch (g_base_info_get_type(info)) {
+        case GI_INFO_TYPE_OBJECT:
+            return preatomize_members(
+                       g_object_info_get_n_methods(info),
+                       [info](int ix) {
+                           return g_object_info_get_method(info, ix);
+                       },
+                       false) &&
+                   preatomize_members(
+                       g_object_info_get_n_properties(info),
+                       [info](int ix) {
+                           return g_object_info_get_property(info, ix);
+                       },
+                       true);
+        case GI_INFO_TYPE_INTERFACE:
+            return preatomize_members(
+                       g_interface_info_get_n_methods(info),
+                       [info](int ix) {
+                           return g_interface_info_get_method(info, ix);
+                       },
+                       false) &&
+                   preatomize_members(
+                       g_interface_info_get_n_properties(info),
+                       [info](int ix) {
+                           return g_interface_info_get_property(info, ix);
+                       },
+                       true);
+        case GI_INFO_TYPE_BOXED:
+        case GI_INFO_TYPE_STRUCT:
+            return preatomize_members(
+                       g_struct_info_get_n_methods(info),
+                       [info](int ix) {
+                           return g_struct_info_get_method(info, ix);
+                       },
+                       false) &&
+                   preatomize_members(
+                       g_struct_info_get_n_fields(info),
+                       [info](int ix) {
+                           return g_struct_info_get_field(info, ix);
+                       },
+                       false);
+        case GI_INFO_TYPE_UNION:
+            return preatomize_members(
+                       g_union_info_get_n_methods(info),
+                       [info](int ix) {
+                           return g_union_info_get_method(info, ix);
+                       },
+                       false) &&
+                   preatomize_members(
+                       g_union_info_get_n_fields(info),
+                       [info](int ix) {
+                           return g_union_info_get_field(info, ix);
+                       },
+                       false);
+        default:
+            return true;
+    }
+}
+
+// Opt-in for overrides: atomizes, once and for all, the names of everything
+// in the given namespace that is looked up by name when it is resolved, as
+// listed in its typelib. Resolve hooks then find those names by their jsid,
+// without encoding them, the first time too. The atoms are never collected, so
+// this is meant for namespaces whose names are used all over, like GObject.
+GJS_JSAPI_RETURN_CONVENTION
+static bool gjs_preatomize_names(JSContext* cx, unsigned argc, JS::Value* vp) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+    JS::UniqueChars ns;
+
+    if (!gjs_parse_call_args(cx, "preatomize_names", args, "s", "namespace",
+                             &ns))
+        return false;
+
+    int n = g_irepository_get_n_infos(nullptr, ns.get());
+    for (int ix = 0; ix < n; ix++) {
+        GjsAutoBaseInfo info = g_irepository_get_info(nullptr, ns.get(), ix);
+        if (!preatomize_info_names(cx, info))
+            return false;
+    }
+
+    args.rval().setUndefined();
+    return true;
+}
+
+// Opt-in for overrides: GHashTables returned with transfer none from functions
+// in the given namespace are wrapped in an object with get(), has(), keys(),
+// size, and toObject(), which converts entries only when they are read.
+GJS_JSAPI_RETURN_CONVENTION
+static bool gjs_set_lazy_hash_table_returns(JSContext* cx, unsigned argc,
+                                            JS::Value* vp) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+    JS::UniqueChars ns;
+    bool enabled;
+
+    if (!gjs_parse_call_args(cx, "set_lazy_hash_table_returns", args, "sb",
+                             "namespace", &ns, "enabled", &enabled))
+        return false;
+
+    GjsContextPrivate::from_cx(cx)->set_lazy_hash_table_namespace(ns.get(),
+                                                                  enabled);
+    args.rval().setUndefined();
+    return true;
+}
+
+// Opt-in for overrides: GLists and GSLists returned with transfer container or
+// full from functions in the given namespace are returned as iterators that
+// convert one element at a time, so a search loop can stop early without
+// converting the rest of the list.
+GJS_JSAPI_RETURN_CONVENTION
+static bool gjs_set_list_iterator_returns(JSContext* cx, unsigned argc,
+                                          JS::Value* vp) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+    JS::UniqueChars ns;
+    bool enabled;
+
+    if (!gjs_parse_call_args(cx, "set_list_iterator_returns", args, "sb",
+                             "namespace", &ns, "enabled", &enabled))
+        return false;
+
+    GjsContextPrivate::from_cx(cx)->set_list_iterator_namespace(ns.get(),
+                                                                enabled);
+    args.rval().setUndefined();
+    return true;
+}
+
+// Native implementation of new GLib.Variant(signature, value)
+GJS_JSAPI_RETURN_CONVENTION
+static bool gjs_pack_variant(JSContext* cx, unsigned argc, JS::Value* vp) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+
+    // The value can be of any type, so it isn't converted with
+    // gjs_parse_call_args()
+    if (!args.requireAtLeast(cx, "pack_variant", 2))
+        return false;
+    if (!args[0].isString()) {
+        gjs_throw_custom(cx, JSProto_TypeError, nullptr,
+                         "GVariant signature must be a string");
+        return false;
+    }
+
+    JS::UniqueChars signature = gjs_string_to_utf8(cx, args[0]);
+    if (!signature)
+        return false;
+
+    return gjs_variant_pack(cx, signature.get(), args[1], args.rval());
+}
+
+// Native implementation of GLib.Variant.unpack(), deepUnpack(), and
+// recursiveUnpack()
+GJS_JSAPI_RETURN_CONVENTION
+static bool gjs_unpack_variant(JSContext* cx, unsigned argc, JS::Value* vp) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+    JS::RootedObject variant_obj(cx);
+    bool deep, recursive;
+
+    if (!gjs_parse_call_args(cx, "unpack_variant", args, "obb", "variant",
+                             &variant_obj, "deep", &deep, "recursive",
+                             &recursive))
+        return false;
+
+    if (!BoxedBase::typecheck(cx, variant_obj, nullptr, G_TYPE_VARIANT))
+        return false;
+    GVariant* variant = BoxedBase::to_c_ptr<GVariant>(cx, variant_obj);
+    if (!variant)
+        return false;
+
+    return gjs_variant_unpack(cx, variant, deep, recursive, args.rval());
+}
+
+// Native implementation of GLib.Variant.toTypedArray()
+GJS_JSAPI_RETURN_CONVENTION
+static bool gjs_variant_to_typed_array_func(JSContext* cx, unsigned argc,
+                                            JS::Value* vp) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+    JS::RootedObject variant_obj(cx);
+
+    if (!gjs_parse_call_args(cx, "variant_to_typed_array", args, "o",
+                             "variant", &variant_obj))
+        return false;
+
+    if (!BoxedBase::typecheck(cx, variant_obj, nullptr, G_TYPE_VARIANT))
+        return false;
+    GVariant* variant = BoxedBase::to_c_ptr<GVariant>(cx, variant_obj);
+    if (!variant)
+        return false;
+
+    return gjs_variant_to_typed_array(cx, variant, args.rval());
+}
+
+// Native implementation of GLib.runInThread(fn, ...args)
+GJS_JSAPI_RETURN_CONVENTION
+static bool gjs_run_in_thread(JSContext* cx, unsigned argc, JS::Value* vp) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+    JS::RootedObject function(cx), args_array(cx);
+
+    if (!gjs_parse_call_args(cx, "run_in_thread", args, "oo", "function",
+                             &function, "args", &args_array))
+        return false;
+
+    uint32_t length;
+    if (!JS::GetArrayLength(cx, args_array, &length))
+        return false;
+
+    JS::RootedValueVector call_args(cx);
+    if (!call_args.resize(length)) {
+        JS_ReportOutOfMemory(cx);
+        return false;
+    }
+    for (uint32_t ix = 0; ix < length; ix++) {
+        if (!JS_GetElement(cx, args_array, ix, call_args[ix]))
+            return false;
+    }
+
+    JSObject* promise = gjs_function_call_in_thread(cx, function, call_args);
+    if (!promise)
+        return false;
+
+    args.rval().setObject(*promise);
+    return true;
+}
+
+template <GjsAtomGetter member>
 GJS_JSAPI_RETURN_CONVENTION static bool symbol_getter(JSContext* cx,
                                                       unsigned argc,
                                                       JS::Value* vp) {
@@ -431,7 +933,22 @@ static JSFunctionSpec module_funcs[] = {
     JS_FN("register_interface", gjs_register_interface, 3,
           GJS_MODULE_PROP_FLAGS),
     JS_FN("register_type", gjs_register_type, 4, GJS_MODULE_PROP_FLAGS),
+    JS_FN("register_class", gjs_register_class, 7, GJS_MODULE_PROP_FLAGS),
     JS_FN("signal_new", gjs_signal_new, 6, GJS_MODULE_PROP_FLAGS),
+    JS_FN("set_typed_array_returns", gjs_set_typed_array_returns, 2,
+          GJS_MODULE_PROP_FLAGS),
+    JS_FN("set_interned_string_returns", gjs_set_interned_string_returns, 2,
+          GJS_MODULE_PROP_FLAGS),
+    JS_FN("preatomize_names", gjs_preatomize_names, 1, GJS_MODULE_PROP_FLAGS),
+    JS_FN("set_lazy_hash_table_returns", gjs_set_lazy_hash_table_returns, 2,
+          GJS_MODULE_PROP_FLAGS),
+    JS_FN("set_list_iterator_returns", gjs_set_list_iterator_returns, 2,
+          GJS_MODULE_PROP_FLAGS),
+    JS_FN("pack_variant", gjs_pack_variant, 2, GJS_MODULE_PROP_FLAGS),
+    JS_FN("unpack_variant", gjs_unpack_variant, 3, GJS_MODULE_PROP_FLAGS),
+    JS_FN("variant_to_typed_array", gjs_variant_to_typed_array_func, 1,
+          GJS_MODULE_PROP_FLAGS),
+    JS_FN("run_in_thread", gjs_run_in_thread, 2, GJS_MODULE_PROP_FLAGS),
     JS_FS_END,
 };
 
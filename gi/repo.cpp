@@ -59,6 +59,7 @@
 #include "cjs/jsapi-class.h"
 #include "cjs/jsapi-util.h"
 #include "cjs/mem-private.h"
+#include "cjs/profiler-private.h"
 #include "util/log.h"
 
 typedef struct {
@@ -72,7 +73,8 @@ GJS_DEFINE_PRIV_FROM_JS(Repo, gjs_repo_class)
 
 GJS_JSAPI_RETURN_CONVENTION
 static bool lookup_override_function(JSContext *, JS::HandleId,
-                                     JS::MutableHandleValue);
+                                     JS::MutableHandleValue,
+                                     JS::MutableHandleObject);
 
 GJS_JSAPI_RETURN_CONVENTION
 static bool get_version_for_ns(JSContext* context, JS::HandleObject repo_obj,
@@ -104,30 +106,30 @@ static bool resolve_namespace_object(JSContext* context,
     if (!get_version_for_ns(context, repo_obj, ns_id, &version))
         return false;
 
-    JS::UniqueChars ns_name;
-    if (!gjs_get_string_id(context, ns_id, &ns_name))
+    const char* ns_name;
+    if (!gjs_get_interned_string_id(context, ns_id, &ns_name))
         return false;
     if (!ns_name) {
         gjs_throw(context, "Requiring invalid namespace on imports.gi");
         return false;
     }
 
-    GList* versions = g_irepository_enumerate_versions(nullptr, ns_name.get());
+    GList* versions = g_irepository_enumerate_versions(nullptr, ns_name);
     unsigned nversions = g_list_length(versions);
     if (nversions > 1 && !version &&
-        !g_irepository_is_registered(nullptr, ns_name.get(), nullptr) &&
+        !g_irepository_is_registered(nullptr, ns_name, nullptr) &&
         !JS::WarnUTF8(context,
                       "Requiring %s but it has %u versions available; use "
                       "imports.gi.versions to pick one",
-                      ns_name.get(), nversions))
+                      ns_name, nversions))
         return false;
     g_list_free_full(versions, g_free);
 
     error = NULL;
-    g_irepository_require(nullptr, ns_name.get(), version.get(),
+    g_irepository_require(nullptr, ns_name, version.get(),
                           GIRepositoryLoadFlags(0), &error);
     if (error != NULL) {
-        gjs_throw(context, "Requiring %s, version %s: %s", ns_name.get(),
+        gjs_throw(context, "Requiring %s, version %s: %s", ns_name,
                   version ? version.get() : "none", error->message);
 
         g_error_free(error);
@@ -139,7 +141,7 @@ static bool resolve_namespace_object(JSContext* context,
      * in the repo.
      */
     JS::RootedObject gi_namespace(context,
-                                  gjs_create_ns(context, ns_name.get()));
+                                  gjs_create_ns(context, ns_name));
 
     /* Define the property early, to avoid reentrancy issues if
        the override module looks for namespaces that import this */
@@ -148,18 +150,33 @@ static bool resolve_namespace_object(JSContext* context,
         return false;
 
     JS::RootedValue override(context);
-    if (!lookup_override_function(context, ns_id, &override))
+    JS::RootedObject class_hooks(context);
+    {
+        GjsProfilerScope profiler_scope(context, "Import override",
+                                        ns_name);
+        if (!lookup_override_function(context, ns_id, &override,
+                                      &class_hooks))
+            return false;
+    }
+
+    /* Registered before calling _init, so that every class that _init
+     * touches already has its overrides */
+    if (class_hooks &&
+        !gjs_ns_set_class_hooks(context, gi_namespace, class_hooks))
         return false;
 
     JS::RootedValue result(context);
-    if (!override.isUndefined() &&
-        !JS_CallFunctionValue (context, gi_namespace, /* thisp */
-                               override, /* callee */
-                               JS::HandleValueArray::empty(), &result))
-        return false;
+    if (!override.isUndefined()) {
+        GjsProfilerScope profiler_scope(context, "Run override",
+                                        ns_name);
+        if (!JS_CallFunctionValue(context, gi_namespace, /* thisp */
+                                  override, /* callee */
+                                  JS::HandleValueArray::empty(), &result))
+            return false;
+    }
 
     gjs_debug(GJS_DEBUG_GNAMESPACE,
-              "Defined namespace '%s' %p in GIRepository %p", ns_name.get(),
+              "Defined namespace '%s' %p in GIRepository %p", ns_name,
               gi_namespace.get(), repo_obj.get());
 
     GjsContextPrivate* gjs = GjsContextPrivate::from_cx(context);
@@ -597,7 +614,8 @@ GJS_JSAPI_RETURN_CONVENTION
 static bool
 lookup_override_function(JSContext             *cx,
                          JS::HandleId           ns_name,
-                         JS::MutableHandleValue function)
+                         JS::MutableHandleValue function,
+                         JS::MutableHandleObject class_hooks)
 {
     JS::AutoSaveExceptionState saved_exc(cx);
 
@@ -635,6 +653,22 @@ lookup_override_function(JSContext             *cx,
         gjs_throw(cx, "Unexpected value for _init in overrides module");
         goto fail;
     }
+
+    /* Optional per-class overrides, applied when each class is first
+     * resolved rather than all at once in _init */
+    {
+        JS::RootedValue hooks(cx);
+        if (!JS_GetPropertyById(cx, module, atoms.class_overrides(), &hooks))
+            goto fail;
+        if (hooks.isObject()) {
+            class_hooks.set(&hooks.toObject());
+        } else if (!hooks.isUndefined()) {
+            gjs_throw(cx,
+                      "Unexpected value for _classOverrides in overrides "
+                      "module");
+            goto fail;
+        }
+    }
     return true;
 
  fail:
@@ -718,6 +752,44 @@ gjs_info_type_name(GIInfoType type)
     }
 }
 
+template <class Base>
+[[nodiscard]] static bool wrapper_get_gtype(JSContext* cx,
+                                            JS::HandleObject obj,
+                                            GType* gtype_out) {
+    if (Base::is_constructor(obj)) {
+        *gtype_out = gjs_dynamic_class_get_gtype(obj);
+        return *gtype_out != G_TYPE_INVALID;
+    }
+
+    Base* priv = Base::for_js(cx, obj);
+    if (!priv)
+        return false;
+    *gtype_out = priv->gtype();
+    return true;
+}
+
+/*
+ * gjs_wrapper_get_gtype:
+ * @obj: any JS object
+ * @gtype_out: return location for the GType
+ *
+ * If @obj is the constructor, prototype, or an instance of a class wrapping
+ * an introspected type, gets its GType from the reserved slot of the
+ * constructor or from the private data of the wrapper, without looking up any
+ * properties.
+ *
+ * Returns: true if @obj was recognized; otherwise @gtype_out is not touched.
+ */
+bool gjs_wrapper_get_gtype(JSContext* cx, JS::HandleObject obj,
+                           GType* gtype_out) {
+    return wrapper_get_gtype<ObjectBase>(cx, obj, gtype_out) ||
+           wrapper_get_gtype<BoxedBase>(cx, obj, gtype_out) ||
+           wrapper_get_gtype<UnionBase>(cx, obj, gtype_out) ||
+           wrapper_get_gtype<FundamentalBase>(cx, obj, gtype_out) ||
+           wrapper_get_gtype<InterfaceBase>(cx, obj, gtype_out) ||
+           wrapper_get_gtype<ErrorBase>(cx, obj, gtype_out);
+}
+
 char*
 gjs_hyphen_from_camel(const char *camel_name)
 {
@@ -64,6 +64,9 @@ bool gjs_define_info(JSContext       *context,
                      GIBaseInfo      *info,
                      bool            *defined);
 
+[[nodiscard]] bool gjs_wrapper_get_gtype(JSContext* cx, JS::HandleObject obj,
+                                         GType* gtype_out);
+
 [[nodiscard]] char* gjs_hyphen_from_camel(const char* camel_name);
 
 #if GJS_VERBOSE_ENABLE_GI_USAGE
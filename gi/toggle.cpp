@@ -23,78 +23,148 @@
  * Authored by: Philip Chimento <philip@endlessm.com>, <philip.chimento@gmail.com>
  */
 
-#include <algorithm>  // for find_if
-#include <deque>
-#include <mutex>
+#include <stdint.h>
+#include <stdlib.h>  // for atoi
+
+#include <atomic>
+#include <iterator>  // for prev
+#include <list>
+#include <unordered_map>
 #include <utility>  // for pair
+#include <vector>
 
 #include <glib-object.h>
 #include <glib.h>
 
 #include "gi/toggle.h"
 
-std::deque<ToggleQueue::Item>::iterator
-ToggleQueue::find_operation_locked(const GObject               *gobj,
-                                   ToggleQueue::Direction direction) {
-    return std::find_if(q.begin(), q.end(),
-        [gobj, direction](const Item& item)->bool {
-            return item.gobj == gobj && item.direction == direction;
-        });
+// Default for GJS_TOGGLE_QUEUE_BUDGET_MS
+static constexpr int64_t DEFAULT_TIME_BUDGET_USEC = 5 * G_TIME_SPAN_MILLISECOND;
+
+ToggleQueue::ToggleQueue()
+    : m_time_budget_usec(DEFAULT_TIME_BUDGET_USEC) {
+    const char* budget_ms = g_getenv("GJS_TOGGLE_QUEUE_BUDGET_MS");
+    if (budget_ms && atoi(budget_ms) > 0)
+        m_time_budget_usec = atoi(budget_ms) * G_TIME_SPAN_MILLISECOND;
 }
 
-std::deque<ToggleQueue::Item>::const_iterator
-ToggleQueue::find_operation_locked(const GObject *gobj,
+bool ToggleQueue::is_queued_locked(const GObject* gobj,
                                    ToggleQueue::Direction direction) const {
-    return std::find_if(q.begin(), q.end(),
-        [gobj, direction](const Item& item)->bool {
-            return item.gobj == gobj && item.direction == direction;
-        });
+    auto range = m_index.equal_range(gobj);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (it->second->direction == direction)
+            return true;
+    }
+    return false;
 }
 
 bool
 ToggleQueue::find_and_erase_operation_locked(const GObject               *gobj,
                                              ToggleQueue::Direction direction)
 {
-    auto pos = find_operation_locked(gobj, direction);
-    bool had_toggle = (pos != q.end());
-    if (had_toggle)
-        q.erase(pos);
-    return had_toggle;
+    auto range = m_index.equal_range(gobj);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (it->second->direction == direction) {
+            q.erase(it->second);
+            m_index.erase(it);
+            return true;
+        }
+    }
+    return false;
 }
 
+// Moves everything that other threads have pushed onto the inbox into q, in
+// the order it was pushed. A toggle up arriving for an object that is still
+// queued to toggle down cancels it out, since handling both would only unroot
+// and re-root the wrapper; the reference taken for the toggle up is dropped
+// once q is consistent again, because that may cause another toggle.
+void ToggleQueue::drain_inbox() {
+    if (!m_inbox.load(std::memory_order_relaxed))
+        return;
+
+    Node* node = m_inbox.exchange(nullptr, std::memory_order_acquire);
+
+    // The inbox is a stack, newest first
+    Node* fifo = nullptr;
+    while (node) {
+        Node* next = node->next;
+        node->next = fifo;
+        fifo = node;
+        node = next;
+    }
+
+    std::vector<GObject*> coalesced;
+    while (fifo) {
+        const Item& item = fifo->item;
+        if (item.direction == UP && !is_queued_locked(item.gobj, UP) &&
+            find_and_erase_operation_locked(item.gobj, DOWN)) {
+            debug("coalesce", item.gobj);
+            if (item.needs_unref)
+                coalesced.push_back(item.gobj);
+        } else {
+            q.push_back(item);
+            m_index.emplace(item.gobj, std::prev(q.end()));
+        }
+
+        Node* next = fifo->next;
+        delete fifo;
+        fifo = next;
+    }
+
+    for (GObject* gobj : coalesced)
+        g_object_unref(gobj);
+}
+
+// Handles toggles until the queue is empty, or until the time budget runs out,
+// in which case the rest are left for the next main loop iteration. Toggles
+// caused by handling these are appended to the same queue.
 gboolean
 ToggleQueue::idle_handle_toggle(void *data)
 {
     auto self = static_cast<ToggleQueue *>(data);
-    while (self->handle_toggle(self->m_toggle_handler))
-        ;
+    int64_t deadline = g_get_monotonic_time() + self->m_time_budget_usec;
+    Handler handler = self->m_toggle_handler.load();
 
-    return G_SOURCE_REMOVE;
-}
+    // Checking the clock for every toggle would cost about as much as
+    // handling it
+    static constexpr unsigned BATCH_SIZE = 32;
+    while (true) {
+        for (unsigned i = 0; i < BATCH_SIZE; i++) {
+            if (self->handle_toggle(handler))
+                continue;
 
-void
-ToggleQueue::idle_destroy_notify(void *data)
-{
-    auto self = static_cast<ToggleQueue *>(data);
-    std::lock_guard<std::mutex> hold(self->lock);
-    self->m_idle_id = 0;
-    self->m_toggle_handler = nullptr;
+            // Empty. Let the next producer schedule a new idle, unless one has
+            // pushed in the meantime without doing so because we were still
+            // pending.
+            self->m_idle_pending = false;
+            if (!self->m_inbox.load() || self->m_idle_pending.exchange(true))
+                return G_SOURCE_REMOVE;
+        }
+
+        if (g_get_monotonic_time() >= deadline)
+            return G_SOURCE_CONTINUE;
+    }
 }
 
 std::pair<bool, bool>
-ToggleQueue::is_queued(GObject *gobj) const
+ToggleQueue::is_queued(GObject *gobj)
 {
-    std::lock_guard<std::mutex> hold(lock);
-    bool has_toggle_down = find_operation_locked(gobj, DOWN) != q.end();
-    bool has_toggle_up = find_operation_locked(gobj, UP) != q.end();
+    drain_inbox();
+    bool has_toggle_down = is_queued_locked(gobj, DOWN);
+    bool has_toggle_up = is_queued_locked(gobj, UP);
     return {has_toggle_down, has_toggle_up};
 }
 
+size_t ToggleQueue::size() {
+    drain_inbox();
+    return q.size();
+}
+
 std::pair<bool, bool>
 ToggleQueue::cancel(GObject *gobj)
 {
     debug("cancel", gobj);
-    std::lock_guard<std::mutex> hold(lock);
+    drain_inbox();
     bool had_toggle_down = find_and_erase_operation_locked(gobj, DOWN);
     bool had_toggle_up = find_and_erase_operation_locked(gobj, UP);
     gjs_debug_lifecycle(GJS_DEBUG_GOBJECT, "ToggleQueue: %p (%s) was %s", gobj,
@@ -109,16 +179,22 @@ ToggleQueue::cancel(GObject *gobj)
 bool
 ToggleQueue::handle_toggle(Handler handler)
 {
-    Item item;
-    {
-        std::lock_guard<std::mutex> hold(lock);
-        if (q.empty())
-            return false;
-
-        item = q.front();
-        handler(item.gobj, item.direction);
-        q.pop_front();
+    drain_inbox();
+    if (q.empty())
+        return false;
+
+    Item item = q.front();
+    auto range = m_index.equal_range(item.gobj);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (it->second == q.begin()) {
+            m_index.erase(it);
+            break;
+        }
     }
+    q.pop_front();
+
+    m_latency.add((g_get_monotonic_time() - item.queued_time) * 1000);
+    handler(item.gobj, item.direction);
 
     debug("handle", item.gobj);
     if (item.needs_unref)
@@ -131,6 +207,7 @@ void
 ToggleQueue::shutdown(void)
 {
     debug("shutdown", nullptr);
+    drain_inbox();
     g_assert(((void)"Queue should have been emptied before shutting down",
               q.empty()));
     m_shutdown = true;
@@ -149,7 +226,7 @@ ToggleQueue::enqueue(GObject               *gobj,
         return;
     }
 
-    Item item{gobj, direction};
+    Item item{gobj, direction, false, g_get_monotonic_time()};
     /* If we're toggling up we take a reference to the object now,
      * so it won't toggle down before we process it. This ensures we
      * only ever have at most two toggle notifications queued.
@@ -169,18 +246,20 @@ ToggleQueue::enqueue(GObject               *gobj,
      *
      * Taking a reference now would be bad anyway, since it would force
      * the object to toggle back up again.
-     */   
-
-    std::lock_guard<std::mutex> hold(lock);
-    q.push_back(item);
-    
-    if (m_idle_id) {
-        g_assert(((void) "Should always enqueue with the same handler",
-                  m_toggle_handler == handler));
-        return;
+     */
+
+    Handler old_handler = m_toggle_handler.exchange(handler);
+    g_assert(((void) "Should always enqueue with the same handler",
+              !old_handler || old_handler == handler));
+
+    auto* node = new Node{item, m_inbox.load(std::memory_order_relaxed)};
+    while (!m_inbox.compare_exchange_weak(node->next, node,
+                                          std::memory_order_release,
+                                          std::memory_order_relaxed)) {
     }
 
-    m_toggle_handler = handler;
-    m_idle_id = g_idle_add_full(G_PRIORITY_HIGH, idle_handle_toggle, this,
-                                idle_destroy_notify);
+    if (m_idle_pending.exchange(true))
+        return;
+
+    g_idle_add_full(G_PRIORITY_HIGH, idle_handle_toggle, this, nullptr);
 }
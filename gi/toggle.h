@@ -26,19 +26,28 @@
 #ifndef GI_TOGGLE_H_
 #define GI_TOGGLE_H_
 
+#include <stddef.h>  // for size_t
+#include <stdint.h>
+
 #include <atomic>
-#include <deque>
-#include <mutex>
+#include <list>
+#include <unordered_map>
 #include <utility>  // for pair
 
 #include <glib-object.h>
 #include <glib.h>
 
+#include "gi/call-stats.h"
 #include "util/log.h"
 
 /* Thread-safe queue for enqueueing toggle-up or toggle-down events on GObjects
  * from any thread. For more information, see object.cpp, comments near
- * wrapped_gobj_toggle_notify(). */
+ * wrapped_gobj_toggle_notify().
+ *
+ * Only enqueue() may be called from other threads. It pushes onto a lock-free
+ * inbox, so a worker thread dropping a reference never waits for the main
+ * thread. Everything else must be called on the main thread, which moves the
+ * inbox into the queue proper whenever it looks at it. */
 class ToggleQueue {
 public:
     enum Direction {
@@ -53,14 +62,38 @@ private:
         GObject *gobj;
         ToggleQueue::Direction direction;
         unsigned needs_unref : 1;
+        int64_t queued_time;  // µs, from g_get_monotonic_time()
+    };
+
+    struct Node {
+        Item item;
+        Node* next;
     };
 
-    mutable std::mutex lock;
-    std::deque<Item> q;
+    using ItemList = std::list<Item>;
+
+    // Toggles pushed by enqueue() and not yet seen by the main thread, newest
+    // first
+    std::atomic<Node*> m_inbox = ATOMIC_VAR_INIT(nullptr);
+    std::atomic_bool m_idle_pending = ATOMIC_VAR_INIT(false);
+    std::atomic<Handler> m_toggle_handler = ATOMIC_VAR_INIT(nullptr);
+
+    // The rest is only touched from the main thread
+    ItemList q;
+    // Index into q by GObject, so that pending toggles can be found and
+    // cancelled without scanning the queue. There are at most two entries per
+    // object (either only up, or down-up.)
+    std::unordered_multimap<const GObject*, ItemList::iterator> m_index;
     std::atomic_bool m_shutdown = ATOMIC_VAR_INIT(false);
 
-    unsigned m_idle_id;
-    Handler m_toggle_handler;
+    // How long the idle handler may spend handling toggles before yielding
+    // back to the main loop
+    int64_t m_time_budget_usec;
+
+    // Time from enqueue() to handling, for toggles that were handled
+    GjsCallStats m_latency;
+
+    ToggleQueue();
 
     /* No-op unless GJS_VERBOSE_ENABLE_LIFECYCLE is defined to 1. */
     inline void debug(const char* did GJS_USED_VERBOSE_LIFECYCLE,
@@ -68,22 +101,20 @@ private:
         gjs_debug_lifecycle(GJS_DEBUG_GOBJECT, "ToggleQueue %s %p", did, what);
     }
 
-    [[nodiscard]] std::deque<Item>::iterator find_operation_locked(
-        const GObject* gobj, Direction direction);
-
-    [[nodiscard]] std::deque<Item>::const_iterator find_operation_locked(
-        const GObject* gobj, Direction direction) const;
+    [[nodiscard]] bool is_queued_locked(const GObject* gobj,
+                                        Direction direction) const;
 
     [[nodiscard]] bool find_and_erase_operation_locked(const GObject* gobj,
                                                        Direction direction);
 
+    void drain_inbox();
+
     static gboolean idle_handle_toggle(void *data);
-    static void idle_destroy_notify(void *data);
 
  public:
     /* These two functions return a pair DOWN, UP signifying whether toggles
      * are / were queued. is_queued() just checks and does not modify. */
-    [[nodiscard]] std::pair<bool, bool> is_queued(GObject* gobj) const;
+    [[nodiscard]] std::pair<bool, bool> is_queued(GObject* gobj);
     /* Cancels pending toggles and returns whether any were queued. */
     std::pair<bool, bool> cancel(GObject *gobj);
 
@@ -92,6 +123,11 @@ private:
      * is empty. */
     bool handle_toggle(Handler handler);
 
+    /* Number of toggles waiting to be processed */
+    [[nodiscard]] size_t size();
+
+    [[nodiscard]] const GjsCallStats& latency() const { return m_latency; }
+
     /* After calling this, the toggle queue won't accept any more toggles. Only
      * intended for use when destroying the JSContext and breaking the
      * associations between C and JS objects. */
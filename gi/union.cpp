@@ -23,31 +23,43 @@
 
 #include <config.h>
 
+#include <stdint.h>
+#include <string.h>  // for memcpy
+
+#include <utility>  // for move
+
 #include <girepository.h>
 
 #include <js/CallArgs.h>
 #include <js/Class.h>
 #include <js/RootingAPI.h>
 #include <js/TypeDecls.h>
+#include <js/Value.h>
 #include <js/Warnings.h>
+#include <jsapi.h>  // for JS_SetReservedSlot
 
 #include "gi/arg-inl.h"
+#include "gi/arg.h"
+#include "gi/boxed.h"
 #include "gi/function.h"
 #include "gi/repo.h"
 #include "gi/union.h"
+#include "cjs/jsapi-class.h"
 #include "cjs/jsapi-util.h"
 #include "cjs/mem-private.h"
 #include "util/log.h"
 
 UnionPrototype::UnionPrototype(GIUnionInfo* info, GType gtype)
-    : GIWrapperPrototype(info, gtype) {
+    : GIWrapperPrototype(info, gtype),
+      m_discriminator_tag(GI_TYPE_TAG_VOID),
+      m_discriminator_offset(0) {
     GJS_INC_COUNTER(union_prototype);
 }
 
 UnionPrototype::~UnionPrototype(void) { GJS_DEC_COUNTER(union_prototype); }
 
 UnionInstance::UnionInstance(JSContext* cx, JS::HandleObject obj)
-    : GIWrapperInstance(cx, obj) {
+    : GIWrapperInstance(cx, obj), m_discriminator(0) {
     GJS_INC_COUNTER(union_instance);
 }
 
@@ -62,8 +74,8 @@ UnionInstance::~UnionInstance(void) {
 // See GIWrapperBase::resolve().
 bool UnionPrototype::resolve_impl(JSContext* context, JS::HandleObject obj,
                                   JS::HandleId id, bool* resolved) {
-    JS::UniqueChars prop_name;
-    if (!gjs_get_string_id(context, id, &prop_name))
+    const char* prop_name;
+    if (!gjs_get_interned_string_id(context, id, &prop_name))
         return false;
     if (!prop_name) {
         *resolved = false;
@@ -72,7 +84,7 @@ bool UnionPrototype::resolve_impl(JSContext* context, JS::HandleObject obj,
 
     // Look for methods and other class properties
     GjsAutoFunctionInfo method_info =
-        g_union_info_find_method(info(), prop_name.get());
+        g_union_info_find_method(info(), prop_name);
 
     if (method_info) {
 #if GJS_VERBOSE_ENABLE_GI_USAGE
@@ -149,9 +161,252 @@ bool UnionInstance::constructor_impl(JSContext* context,
         return false;
 
     m_ptr = union_new(context, object, args, info());
+    read_discriminator();
     return !!m_ptr;
 }
 
+// Storage type of a value of @type_info, if it is an integer or enum that can
+// be the tag of a discriminated union, or GI_TYPE_TAG_VOID otherwise
+[[nodiscard]] static GITypeTag integer_storage_tag(GITypeInfo* type_info) {
+    GITypeTag tag = g_type_info_get_tag(type_info);
+    if (tag == GI_TYPE_TAG_INTERFACE) {
+        GjsAutoBaseInfo interface_info = g_type_info_get_interface(type_info);
+        if (interface_info.type() != GI_INFO_TYPE_ENUM &&
+            interface_info.type() != GI_INFO_TYPE_FLAGS)
+            return GI_TYPE_TAG_VOID;
+        return g_enum_info_get_storage_type(interface_info);
+    }
+
+    switch (tag) {
+        case GI_TYPE_TAG_INT8:
+        case GI_TYPE_TAG_UINT8:
+        case GI_TYPE_TAG_INT16:
+        case GI_TYPE_TAG_UINT16:
+        case GI_TYPE_TAG_INT32:
+        case GI_TYPE_TAG_UINT32:
+        case GI_TYPE_TAG_INT64:
+        case GI_TYPE_TAG_UINT64:
+            return tag;
+        default:
+            return GI_TYPE_TAG_VOID;
+    }
+}
+
+template <typename T>
+[[nodiscard]] static int64_t read_integer_as(const void* mem) {
+    T value;
+    memcpy(&value, mem, sizeof(value));
+    return int64_t(value);
+}
+
+[[nodiscard]] static int64_t read_integer(GITypeTag tag, const void* mem) {
+    switch (tag) {
+        case GI_TYPE_TAG_INT8:
+            return read_integer_as<int8_t>(mem);
+        case GI_TYPE_TAG_UINT8:
+            return read_integer_as<uint8_t>(mem);
+        case GI_TYPE_TAG_INT16:
+            return read_integer_as<int16_t>(mem);
+        case GI_TYPE_TAG_UINT16:
+            return read_integer_as<uint16_t>(mem);
+        case GI_TYPE_TAG_INT32:
+            return read_integer_as<int32_t>(mem);
+        case GI_TYPE_TAG_UINT32:
+            return read_integer_as<uint32_t>(mem);
+        case GI_TYPE_TAG_INT64:
+            return read_integer_as<int64_t>(mem);
+        case GI_TYPE_TAG_UINT64:
+            return read_integer_as<uint64_t>(mem);
+        default:
+            g_assert_not_reached();
+            return 0;
+    }
+}
+
+int64_t UnionPrototype::read_discriminator(const void* ptr) const {
+    return read_integer(m_discriminator_tag,
+                        static_cast<const uint8_t*>(ptr) +
+                            m_discriminator_offset);
+}
+
+void UnionInstance::read_discriminator(void) {
+    if (m_ptr && get_prototype()->is_discriminated())
+        m_discriminator = get_prototype()->read_discriminator(m_ptr);
+}
+
+/*
+ * UnionPrototype::define_union_class_fields:
+ *
+ * Defines properties on the JS prototype object, with JSNative getters and
+ * setters, for all the members of the union. As for boxed types, all of them
+ * are defined as read/write so that unsupported accesses give an error message.
+ */
+bool UnionPrototype::define_union_class_fields(JSContext* cx,
+                                               JS::HandleObject proto) {
+    if (g_union_info_is_discriminated(info())) {
+        GjsAutoTypeInfo type_info = g_union_info_get_discriminator_type(info());
+        m_discriminator_tag = integer_storage_tag(type_info);
+        m_discriminator_offset = g_union_info_get_discriminator_offset(info());
+    }
+
+    int n_fields = g_union_info_get_n_fields(info());
+    m_fields.clear();
+    m_fields.reserve(n_fields);
+    for (int i = 0; i < n_fields; i++) {
+        GjsAutoFieldInfo field = g_union_info_get_field(info(), i);
+        GjsAutoTypeInfo type_info = g_field_info_get_type(field);
+
+        GjsAutoStructInfo struct_info;
+        if (!g_type_info_is_pointer(type_info) &&
+            g_type_info_get_tag(type_info) == GI_TYPE_TAG_INTERFACE) {
+            GjsAutoBaseInfo interface_info =
+                g_type_info_get_interface(type_info);
+            if (interface_info.type() == GI_INFO_TYPE_STRUCT)
+                struct_info = interface_info.release();
+        }
+
+        int64_t discriminator = 0;
+        bool has_discriminator = false;
+        if (is_discriminated()) {
+            GjsAutoBaseInfo constant =
+                g_union_info_get_discriminator(info(), i);
+            if (constant) {
+                GjsAutoTypeInfo constant_type =
+                    g_constant_info_get_type(constant);
+                GITypeTag tag = integer_storage_tag(constant_type);
+                if (tag != GI_TYPE_TAG_VOID) {
+                    GIArgument value;
+                    g_constant_info_get_value(constant, &value);
+                    discriminator = read_integer(tag, &value);
+                    has_discriminator = true;
+                    g_constant_info_free_value(constant, &value);
+                }
+            }
+        }
+
+        m_fields.push_back({BoxedDirectField::describe(field),
+                            std::move(struct_info), discriminator,
+                            has_discriminator});
+
+        JS::RootedValue private_id(cx, JS::PrivateUint32Value(i));
+        if (!gjs_define_property_dynamic(cx, proto, field.name(), "union_field",
+                                         &UnionBase::field_getter,
+                                         &UnionBase::field_setter, private_id,
+                                         GJS_MODULE_PROP_FLAGS))
+            return false;
+    }
+
+    return true;
+}
+
+/*
+ * UnionBase::field_getter:
+ *
+ * JSNative property getter that is called when accessing a member of a union.
+ * Delegates to UnionInstance::field_getter_impl().
+ */
+bool UnionBase::field_getter(JSContext* cx, unsigned argc, JS::Value* vp) {
+    GJS_GET_WRAPPER_PRIV(cx, argc, vp, args, obj, UnionBase, priv);
+    if (!priv->check_is_instance(cx, "get a field"))
+        return false;
+
+    uint32_t field_ix = gjs_dynamic_property_private_slot(&args.callee())
+        .toPrivateUint32();
+    return priv->to_instance()->field_getter_impl(cx, obj, field_ix,
+                                                  args.rval());
+}
+
+// See UnionBase::field_getter().
+bool UnionInstance::field_getter_impl(JSContext* cx, JS::HandleObject obj,
+                                      uint32_t ix,
+                                      JS::MutableHandleValue rval) const {
+    const UnionField& field = get_prototype()->field(ix);
+
+    // Another member is in use, so the memory doesn't mean anything as this one
+    if (field.has_discriminator && field.discriminator != m_discriminator) {
+        rval.setNull();
+        return true;
+    }
+
+    uint8_t* mem = raw_ptr() + field.direct.offset;
+    if (field.direct.size > 0 && field.direct.readable) {
+        GIArgument arg;
+        memcpy(&arg, mem, field.direct.size);
+        return gjs_value_from_g_argument(cx, rval, field.direct.type_info, &arg,
+                                         true);
+    }
+
+    if (field.struct_info) {
+        // Refers to the memory of the union without copying it, so that
+        // writing to the member's fields changes the union
+        JS::RootedObject member(
+            cx, BoxedInstance::new_for_c_struct(cx, field.struct_info, mem,
+                                                BoxedInstance::NoCopy()));
+        if (!member)
+            return false;
+
+        // Never read; only keeps the union alive while the member is
+        JS_SetReservedSlot(member, 0, JS::ObjectValue(*obj));
+        rval.setObject(*member);
+        return true;
+    }
+
+    GjsAutoFieldInfo field_info = g_union_info_get_field(info(), ix);
+    GIArgument arg;
+    if (!g_field_info_get_field(field_info, m_ptr, &arg)) {
+        gjs_throw(cx, "Reading field %s.%s is not supported", name(),
+                  field.direct.name);
+        return false;
+    }
+
+    return gjs_value_from_g_argument(cx, rval, field.direct.type_info, &arg,
+                                     true);
+}
+
+/*
+ * UnionBase::field_setter:
+ *
+ * JSNative property setter that is called when writing to a member of a
+ * union. Delegates to UnionInstance::field_setter_impl().
+ */
+bool UnionBase::field_setter(JSContext* cx, unsigned argc, JS::Value* vp) {
+    GJS_GET_WRAPPER_PRIV(cx, argc, vp, args, obj, UnionBase, priv);
+    if (!priv->check_is_instance(cx, "set a field"))
+        return false;
+
+    uint32_t field_ix = gjs_dynamic_property_private_slot(&args.callee())
+        .toPrivateUint32();
+    if (!priv->to_instance()->field_setter_impl(cx, field_ix, args[0]))
+        return false;
+
+    args.rval().setUndefined();  /* No stored value */
+    return true;
+}
+
+// See UnionBase::field_setter(). Only members of number or boolean types can
+// be written.
+bool UnionInstance::field_setter_impl(JSContext* cx, uint32_t ix,
+                                      JS::HandleValue value) {
+    const UnionField& field = get_prototype()->field(ix);
+    if (field.direct.size == 0 || !field.direct.writable) {
+        gjs_throw(cx, "Writing field %s.%s is not supported", name(),
+                  field.direct.name);
+        return false;
+    }
+
+    GIArgument arg;
+    if (!gjs_value_to_g_argument(cx, value, field.direct.type_info,
+                                 field.direct.name, GJS_ARGUMENT_FIELD,
+                                 GI_TRANSFER_NOTHING, true, &arg))
+        return false;
+
+    memcpy(raw_ptr() + field.direct.offset, &arg, field.direct.size);
+
+    // The tag may have been overwritten
+    read_discriminator();
+    return true;
+}
+
 // clang-format off
 const struct JSClassOps UnionBase::class_ops = {
     nullptr,  // addProperty
@@ -187,8 +442,9 @@ gjs_define_union_class(JSContext       *context,
         return false;
     }
 
-    return !!UnionPrototype::create_class(context, in_object, info, gtype,
-                                          &constructor, &prototype);
+    UnionPrototype* priv = UnionPrototype::create_class(
+        context, in_object, info, gtype, &constructor, &prototype);
+    return priv && priv->define_union_class_fields(context, prototype);
 }
 
 JSObject*
@@ -26,12 +26,18 @@
 
 #include <config.h>
 
+#include <stdint.h>
+
+#include <vector>
+
 #include <girepository.h>
 #include <glib-object.h>
 
 #include <js/TypeDecls.h>
 
+#include "gi/boxed.h"
 #include "gi/wrapperutils.h"
+#include "cjs/jsapi-util.h"
 #include "cjs/macros.h"
 #include "util/log.h"
 
@@ -59,6 +65,22 @@ class UnionBase
     static const JSClass klass;
 
     [[nodiscard]] static const char* to_string_kind(void) { return "union"; }
+
+    // JSNative property accessors
+
+    GJS_JSAPI_RETURN_CONVENTION
+    static bool field_getter(JSContext* cx, unsigned argc, JS::Value* vp);
+    GJS_JSAPI_RETURN_CONVENTION
+    static bool field_setter(JSContext* cx, unsigned argc, JS::Value* vp);
+};
+
+// A member of a union, described once when the class is defined so that
+// reading it needs no typelib lookups
+struct UnionField {
+    BoxedDirectField direct;  // size is 0 if not a number or boolean
+    GjsAutoStructInfo struct_info;  // set if the member is a struct
+    int64_t discriminator;  // tag value when this member is the one in use
+    bool has_discriminator : 1;
 };
 
 class UnionPrototype : public GIWrapperPrototype<UnionBase, UnionPrototype,
@@ -69,6 +91,12 @@ class UnionPrototype : public GIWrapperPrototype<UnionBase, UnionPrototype,
 
     static constexpr InfoType::Tag info_type_tag = InfoType::Union;
 
+    std::vector<UnionField> m_fields;
+    // Storage type and location of the tag telling which member is in use,
+    // for discriminated unions; GI_TYPE_TAG_VOID if there is none
+    GITypeTag m_discriminator_tag;
+    unsigned m_discriminator_offset;
+
     explicit UnionPrototype(GIUnionInfo* info, GType gtype);
     ~UnionPrototype(void);
 
@@ -78,12 +106,30 @@ class UnionPrototype : public GIWrapperPrototype<UnionBase, UnionPrototype,
 
     // Overrides GIWrapperPrototype::constructor_nargs().
     [[nodiscard]] unsigned constructor_nargs(void) const { return 0; }
+
+ public:
+    [[nodiscard]] const UnionField& field(uint32_t ix) const {
+        return m_fields[ix];
+    }
+    [[nodiscard]] bool is_discriminated() const {
+        return m_discriminator_tag != GI_TYPE_TAG_VOID;
+    }
+    [[nodiscard]] int64_t read_discriminator(const void* ptr) const;
+
+    GJS_JSAPI_RETURN_CONVENTION
+    bool define_union_class_fields(JSContext* cx, JS::HandleObject proto);
 };
 
 class UnionInstance
     : public GIWrapperInstance<UnionBase, UnionPrototype, UnionInstance> {
     friend class GIWrapperInstance<UnionBase, UnionPrototype, UnionInstance>;
     friend class GIWrapperBase<UnionBase, UnionPrototype, UnionInstance>;
+    friend class UnionBase;  // for field_getter, etc.
+
+    static constexpr bool use_slab_allocator = true;
+
+    // Tag of a discriminated union, read once when the pointer is acquired
+    int64_t m_discriminator;
 
     explicit UnionInstance(JSContext* cx, JS::HandleObject obj);
     ~UnionInstance(void);
@@ -92,6 +138,14 @@ class UnionInstance
     bool constructor_impl(JSContext* cx, JS::HandleObject obj,
                           const JS::CallArgs& args);
 
+    void read_discriminator(void);
+
+    GJS_JSAPI_RETURN_CONVENTION
+    bool field_getter_impl(JSContext* cx, JS::HandleObject obj, uint32_t ix,
+                           JS::MutableHandleValue rval) const;
+    GJS_JSAPI_RETURN_CONVENTION
+    bool field_setter_impl(JSContext* cx, uint32_t ix, JS::HandleValue value);
+
  public:
     /*
      * UnionInstance::copy_union:
@@ -99,7 +153,10 @@ class UnionInstance
      * Allocate a new union pointer using g_boxed_copy(), from a raw union
      * pointer.
      */
-    void copy_union(void* ptr) { m_ptr = g_boxed_copy(gtype(), ptr); }
+    void copy_union(void* ptr) {
+        m_ptr = g_boxed_copy(gtype(), ptr);
+        read_discriminator();
+    }
 
     GJS_JSAPI_RETURN_CONVENTION
     static void* copy_ptr(JSContext* cx, GType gtype, void* ptr);
@@ -25,7 +25,11 @@
 
 #include <limits.h>  // for SCHAR_MAX, SCHAR_MIN, UCHAR_MAX
 #include <stdint.h>
-#include <string.h>  // for memset
+#include <stdlib.h>  // for exit
+
+#include <mutex>
+#include <unordered_map>
+#include <vector>
 
 #include <girepository.h>
 #include <glib-object.h>
@@ -45,10 +49,12 @@
 #include "gi/arg-inl.h"
 #include "gi/arg.h"
 #include "gi/boxed.h"
+#include "gi/call-stats.h"
 #include "gi/closure.h"
 #include "gi/foreign.h"
 #include "gi/fundamental.h"
 #include "gi/gerror.h"
+#include "gi/gjs_gi_trace.h"
 #include "gi/gtype.h"
 #include "gi/object.h"
 #include "gi/param.h"
@@ -131,6 +137,67 @@ gjs_value_from_array_and_length_values(JSContext             *context,
                                          &array_arg, array_length.toInt32());
 }
 
+namespace {
+// Per-signal-handler marshalling work that only depends on the signal, not on
+// the particular emission. Computed once when the handler closure is created,
+// and owned by the closure.
+struct GjsSignalMarshalPlan {
+    struct Arg {
+        GjsAutoTypeInfo type_info;
+        int array_len_index = -1;
+        // Parameters such as array lengths are eliminated before we invoke the
+        // closure
+        bool skip = false;
+    };
+
+    // signal_query.param_types is owned by GSignal
+    GSignalQuery signal_query;
+    // Indexed like the GValue parameters, including the instance at 0
+    std::vector<Arg> args;
+    // Only set if GJS_CALL_STATS is set; see gi/call-stats.h
+    GjsCallStats* call_stats = nullptr;
+
+    explicit GjsSignalMarshalPlan(unsigned signal_id) {
+        g_signal_query(signal_id, &signal_query);
+        if (!signal_query.signal_id)
+            return;
+
+        if (gjs_call_stats_enabled()) {
+            GjsAutoChar name =
+                g_strdup_printf("%s::%s", g_type_name(signal_query.itype),
+                                signal_query.signal_name);
+            call_stats = gjs_call_stats_lookup(name);
+        }
+
+        unsigned n_param_values = signal_query.n_params + 1;
+        args.resize(n_param_values);
+
+        GjsAutoBaseInfo signal_info =
+            get_signal_info_if_available(&signal_query);
+        if (!signal_info)
+            return;
+
+        /* Start at argument 1, skip the instance parameter */
+        for (unsigned i = 1; i < n_param_values; ++i) {
+            GjsAutoBaseInfo arg_info =
+                g_callable_info_get_arg(signal_info, i - 1);
+            args[i].type_info.reset(g_arg_info_get_type(arg_info));
+
+            int array_len_pos = g_type_info_get_array_length(args[i].type_info);
+            if (array_len_pos != -1 &&
+                unsigned(array_len_pos) + 1 < n_param_values) {
+                args[array_len_pos + 1].skip = true;
+                args[i].array_len_index = array_len_pos + 1;
+            }
+        }
+    }
+
+    static void finalize_notify(void* data, GClosure*) {
+        delete static_cast<GjsSignalMarshalPlan*>(data);
+    }
+};
+}  // namespace
+
 static void
 closure_marshal(GClosure        *closure,
                 GValue          *return_value,
@@ -141,11 +208,7 @@ closure_marshal(GClosure        *closure,
 {
     JSContext *context;
     unsigned i;
-    GSignalQuery signal_query = { 0, };
-    GISignalInfo *signal_info;
-    bool *skip;
-    int *array_len_indices_for;
-    GITypeInfo **type_info_for;
+    GSignalQuery no_signal_query = { 0, };
 
     gjs_debug_marshal(GJS_DEBUG_GCLOSURE,
                       "Marshal closure %p",
@@ -169,6 +232,7 @@ closure_marshal(GClosure        *closure,
                    "blocked and the JS callback not invoked.");
         if (hint) {
             gpointer instance;
+            GSignalQuery signal_query;
             g_signal_query(hint->signal_id, &signal_query);
 
             instance = g_value_peek_pointer(&param_values[0]);
@@ -182,60 +246,35 @@ closure_marshal(GClosure        *closure,
     JSFunction* func = gjs_closure_get_callable(closure);
     JSAutoRealm ar(context, JS_GetFunctionObject(func));
 
-    if (marshal_data) {
-        /* we are used for a signal handler */
-        guint signal_id;
-
-        signal_id = GPOINTER_TO_UINT(marshal_data);
-
-        g_signal_query(signal_id, &signal_query);
+    /* marshal_data is only set if we are used for a signal handler */
+    auto* plan = static_cast<GjsSignalMarshalPlan*>(marshal_data);
+    GSignalQuery* signal_query = &no_signal_query;
+    if (plan) {
+        signal_query = &plan->signal_query;
 
-        if (!signal_query.signal_id) {
+        if (!signal_query->signal_id) {
             gjs_debug(GJS_DEBUG_GCLOSURE,
                       "Signal handler being called on invalid signal");
             return;
         }
 
-        if (signal_query.n_params + 1 != n_param_values) {
+        if (signal_query->n_params + 1 != n_param_values) {
             gjs_debug(GJS_DEBUG_GCLOSURE,
                       "Signal handler being called with wrong number of parameters");
             return;
         }
     }
 
-    /* Check if any parameters, such as array lengths, need to be eliminated
-     * before we invoke the closure.
-     */
-    skip = g_newa(bool, n_param_values);
-    memset(skip, 0, sizeof (bool) * n_param_values);
-    array_len_indices_for = g_newa(int, n_param_values);
-    for(i = 0; i < n_param_values; i++)
-        array_len_indices_for[i] = -1;
-    type_info_for = g_newa(GITypeInfo *, n_param_values);
-    memset(type_info_for, 0, sizeof (gpointer) * n_param_values);
-
-    signal_info = get_signal_info_if_available(&signal_query);
-    if (signal_info) {
-        /* Start at argument 1, skip the instance parameter */
-        for (i = 1; i < n_param_values; ++i) {
-            GIArgInfo *arg_info;
-            int array_len_pos;
-
-            arg_info = g_callable_info_get_arg(signal_info, i - 1);
-            type_info_for[i] = g_arg_info_get_type(arg_info);
-
-            array_len_pos = g_type_info_get_array_length(type_info_for[i]);
-            if (array_len_pos != -1) {
-                skip[array_len_pos + 1] = true;
-                array_len_indices_for[i] = array_len_pos + 1;
-            }
-
-            g_base_info_unref((GIBaseInfo *)arg_info);
-        }
-
-        g_base_info_unref((GIBaseInfo *)signal_info);
+    if (plan && TRACE_ENABLED(GJS_SIGNAL_EMIT)) {
+        void* instance [[maybe_unused]] =
+            g_value_peek_pointer(&param_values[0]);
+        TRACE(GJS_SIGNAL_EMIT(instance,
+                              g_type_name(G_TYPE_FROM_INSTANCE(instance)),
+                              signal_query->signal_name));
     }
 
+    GjsAutoCallTimer timer(plan ? plan->call_stats : nullptr);
+
     JS::RootedValueVector argv(context);
     /* May end up being less */
     if (!argv.reserve(n_param_values))
@@ -243,32 +282,33 @@ closure_marshal(GClosure        *closure,
     JS::RootedValue argv_to_append(context);
     for (i = 0; i < n_param_values; ++i) {
         const GValue *gval = &param_values[i];
+        const GjsSignalMarshalPlan::Arg* arg_plan =
+            plan ? &plan->args[i] : nullptr;
         bool no_copy;
-        int array_len_index;
         bool res;
 
-        if (skip[i])
+        if (arg_plan && arg_plan->skip)
             continue;
 
         no_copy = false;
 
-        if (i >= 1 && signal_query.signal_id) {
-            no_copy = (signal_query.param_types[i - 1] & G_SIGNAL_TYPE_STATIC_SCOPE) != 0;
+        if (i >= 1 && plan) {
+            no_copy = (signal_query->param_types[i - 1] & G_SIGNAL_TYPE_STATIC_SCOPE) != 0;
         }
 
-        array_len_index = array_len_indices_for[i];
-        if (array_len_index != -1) {
+        if (arg_plan && arg_plan->array_len_index != -1) {
+            int array_len_index = arg_plan->array_len_index;
             const GValue *array_len_gval = &param_values[array_len_index];
             res = gjs_value_from_array_and_length_values(context,
                                                          &argv_to_append,
-                                                         type_info_for[i],
+                                                         arg_plan->type_info,
                                                          gval, array_len_gval,
-                                                         no_copy, &signal_query,
+                                                         no_copy, signal_query,
                                                          array_len_index);
         } else {
             res = gjs_value_from_g_value_internal(context,
                                                   &argv_to_append,
-                                                  gval, no_copy, &signal_query,
+                                                  gval, no_copy, signal_query,
                                                   i);
         }
 
@@ -283,10 +323,6 @@ closure_marshal(GClosure        *closure,
         argv.infallibleAppend(argv_to_append);
     }
 
-    for (i = 1; i < n_param_values; i++)
-        if (type_info_for[i])
-            g_base_info_unref((GIBaseInfo *)type_info_for[i]);
-
     JS::RootedValue rval(context);
     mozilla::Unused << gjs_closure_invoke(closure, nullptr, argv, &rval, false);
     // Any exception now pending, is handled when returning control to JS
@@ -306,13 +342,209 @@ closure_marshal(GClosure        *closure,
     }
 }
 
+namespace {
+// State of a signal handler connected with the throttle or debounce option.
+// Emissions that are not passed on right away are copied here, replacing any
+// earlier one, and marshalled into JS later from a GSource in the JS thread's
+// main context. Emissions from other threads are always passed on that way.
+// Owned by the handler's closure.
+struct GjsRateLimitedSignal {
+    GjsSignalMarshalPlan plan;
+    GClosure* closure;
+    GjsSignalRateLimit mode;
+    int64_t interval_usec;
+    // Protects the members below, which emissions on other threads change
+    std::mutex lock;
+    GSource* source = nullptr;
+    // Parameters of the emission waiting to be passed on, if any
+    std::vector<GValue> pending;
+    // For DEBOUNCE, emissions only record their time and leave the source
+    // alone while it is scheduled, which is cheaper
+    int64_t last_emission_time = 0;
+    // For THROTTLE, whether the handler was called less than an interval ago
+    bool in_interval = false;
+
+    GjsRateLimitedSignal(unsigned signal_id, GClosure* closure_,
+                         GjsSignalRateLimit mode_, unsigned interval_ms)
+        : plan(signal_id),
+          closure(closure_),
+          mode(mode_),
+          interval_usec(int64_t{interval_ms} * 1000) {
+        static GSourceFuncs source_funcs = {
+            nullptr,  // prepare; dispatched at the ready time from schedule()
+            nullptr,  // check
+            &GjsRateLimitedSignal::dispatch,
+            nullptr,  // finalize; this owns the source
+        };
+        source = g_source_new(&source_funcs, sizeof(GSource));
+        g_source_set_name(source, "GJS rate-limited signal handler");
+        g_source_set_callback(source, &GjsRateLimitedSignal::on_ready, this,
+                              nullptr);
+        g_source_attach(source, g_main_context_get_thread_default());
+    }
+
+    ~GjsRateLimitedSignal() { stop(); }
+
+    void save(unsigned n_param_values, const GValue* param_values) {
+        clear_pending();
+        pending.resize(n_param_values);
+        for (unsigned i = 0; i < n_param_values; i++) {
+            g_value_init(&pending[i], G_VALUE_TYPE(&param_values[i]));
+            g_value_copy(&param_values[i], &pending[i]);
+        }
+    }
+
+    void clear_pending() {
+        for (GValue& value : pending)
+            g_value_unset(&value);
+        pending.clear();
+    }
+
+    // Does nothing once the handler is disconnected; called with @lock held
+    void schedule(int64_t ready_time) {
+        if (source)
+            g_source_set_ready_time(source, ready_time);
+    }
+
+    void stop() {
+        std::lock_guard<std::mutex> hold(lock);
+        if (source) {
+            g_source_destroy(source);
+            g_clear_pointer(&source, g_source_unref);
+        }
+        clear_pending();
+        in_interval = false;
+    }
+
+    static gboolean dispatch(GSource*, GSourceFunc callback, void* data) {
+        return callback(data);
+    }
+
+    static gboolean on_ready(void* data) {
+        auto* self = static_cast<GjsRateLimitedSignal*>(data);
+        int64_t now = g_get_monotonic_time();
+
+        {
+            std::lock_guard<std::mutex> hold(self->lock);
+            self->schedule(-1);
+
+            if (self->mode == GjsSignalRateLimit::DEBOUNCE) {
+                // Wait until the last emission is an interval old
+                int64_t ready_time =
+                    self->last_emission_time + self->interval_usec;
+                if (now < ready_time) {
+                    self->schedule(ready_time);
+                    return G_SOURCE_CONTINUE;
+                }
+            } else if (self->pending.empty()) {
+                self->in_interval = false;
+                return G_SOURCE_CONTINUE;
+            } else {
+                self->schedule(now + self->interval_usec);
+            }
+        }
+
+        self->invoke_pending();
+        return G_SOURCE_CONTINUE;
+    }
+
+    // May free this, if the handler disconnects itself
+    void invoke_pending() {
+        std::vector<GValue> values;
+        {
+            std::lock_guard<std::mutex> hold(lock);
+            values.swap(pending);
+        }
+
+        GClosure* invoking = g_closure_ref(closure);
+        closure_marshal(invoking, nullptr, values.size(), values.data(),
+                        nullptr, &plan);
+
+        for (GValue& value : values)
+            g_value_unset(&value);
+
+        // Nothing returns to JS after this, so quit here like a source
+        // callback would if the handler called System.exit()
+        if (gjs_closure_is_valid(invoking)) {
+            GjsContextPrivate* gjs =
+                GjsContextPrivate::from_cx(gjs_closure_get_context(invoking));
+            uint8_t code;
+            if (gjs->should_exit(&code))
+                exit(code);
+        }
+        g_closure_unref(invoking);
+    }
+
+    static void marshal(GClosure* closure, GValue* return_value,
+                        unsigned n_param_values, const GValue* param_values,
+                        void* invocation_hint, void* marshal_data) {
+        auto* self = static_cast<GjsRateLimitedSignal*>(marshal_data);
+        if (!gjs_closure_is_valid(closure))
+            return;
+
+        GjsContextPrivate* gjs =
+            GjsContextPrivate::from_cx(gjs_closure_get_context(closure));
+        std::unique_lock<std::mutex> hold(self->lock);
+
+        if (self->mode == GjsSignalRateLimit::THROTTLE && !self->in_interval) {
+            self->in_interval = true;
+            if (gjs->is_owner_thread()) {
+                self->schedule(g_get_monotonic_time() + self->interval_usec);
+                hold.unlock();
+                closure_marshal(closure, return_value, n_param_values,
+                                param_values, invocation_hint, &self->plan);
+                return;
+            }
+
+            // Passed on from the JS thread as soon as possible, where the
+            // interval starts
+            self->save(n_param_values, param_values);
+            self->schedule(0);
+            return;
+        }
+
+        self->save(n_param_values, param_values);
+        if (self->mode == GjsSignalRateLimit::DEBOUNCE) {
+            self->last_emission_time = g_get_monotonic_time();
+            if (self->source && g_source_get_ready_time(self->source) == -1)
+                self->schedule(self->last_emission_time + self->interval_usec);
+        }
+    }
+
+    static void invalidate_notify(void* data, GClosure*) {
+        static_cast<GjsRateLimitedSignal*>(data)->stop();
+    }
+
+    static void finalize_notify(void* data, GClosure*) {
+        delete static_cast<GjsRateLimitedSignal*>(data);
+    }
+};
+}  // namespace
+
 GClosure* gjs_closure_new_for_signal(JSContext* context, JSFunction* callable,
-                                     const char* description, guint signal_id) {
+                                     const char* description, guint signal_id,
+                                     GjsSignalRateLimit rate_limit,
+                                     unsigned interval_ms) {
     GClosure *closure;
 
     closure = gjs_closure_new(context, callable, description, false);
 
-    g_closure_set_meta_marshal(closure, GUINT_TO_POINTER(signal_id), closure_marshal);
+    if (rate_limit != GjsSignalRateLimit::NONE) {
+        auto* limited = new GjsRateLimitedSignal(signal_id, closure,
+                                                 rate_limit, interval_ms);
+        g_closure_add_invalidate_notifier(
+            closure, limited, &GjsRateLimitedSignal::invalidate_notify);
+        g_closure_add_finalize_notifier(closure, limited,
+                                        &GjsRateLimitedSignal::finalize_notify);
+        g_closure_set_meta_marshal(closure, limited,
+                                   &GjsRateLimitedSignal::marshal);
+        return closure;
+    }
+
+    auto* plan = new GjsSignalMarshalPlan(signal_id);
+    g_closure_add_finalize_notifier(closure, plan,
+                                    &GjsSignalMarshalPlan::finalize_notify);
+    g_closure_set_meta_marshal(closure, plan, closure_marshal);
 
     return closure;
 }
@@ -375,6 +607,99 @@ throw_expect_type(JSContext      *cx,
     return false;  /* for convenience */
 }
 
+// How GValues of a GType are converted to and from JS. Classifying a GType takes
+// a chain of g_type_is_a() checks, so the result is remembered per GType.
+enum class ValueKind : uint8_t {
+    STRING,
+    CHAR,
+    UCHAR,
+    INT,
+    UINT,
+    DOUBLE,
+    FLOAT,
+    BOOLEAN,
+    OBJECT,  // GObject or interface
+    STRV,
+    CONTAINER,  // GHashTable, GArray, GByteArray, or GPtrArray
+    VALUE,
+    ERROR,
+    BOXED,  // any other boxed type
+    VARIANT,
+    ENUM,
+    FLAGS,
+    PARAM,
+    GTYPE,
+    POINTER,
+    OTHER,  // converted through GValue transforms or as a fundamental
+};
+
+[[nodiscard]] static ValueKind classify_gtype(GType gtype) {
+    switch (gtype) {
+        case G_TYPE_STRING:
+            return ValueKind::STRING;
+        case G_TYPE_CHAR:
+            return ValueKind::CHAR;
+        case G_TYPE_UCHAR:
+            return ValueKind::UCHAR;
+        case G_TYPE_INT:
+            return ValueKind::INT;
+        case G_TYPE_UINT:
+            return ValueKind::UINT;
+        case G_TYPE_DOUBLE:
+            return ValueKind::DOUBLE;
+        case G_TYPE_FLOAT:
+            return ValueKind::FLOAT;
+        case G_TYPE_BOOLEAN:
+            return ValueKind::BOOLEAN;
+        default:
+            break;
+    }
+
+    if (g_type_is_a(gtype, G_TYPE_OBJECT) ||
+        g_type_is_a(gtype, G_TYPE_INTERFACE))
+        return ValueKind::OBJECT;
+    if (gtype == G_TYPE_STRV)
+        return ValueKind::STRV;
+    if (g_type_is_a(gtype, G_TYPE_HASH_TABLE) ||
+        g_type_is_a(gtype, G_TYPE_ARRAY) ||
+        g_type_is_a(gtype, G_TYPE_BYTE_ARRAY) ||
+        g_type_is_a(gtype, G_TYPE_PTR_ARRAY))
+        return ValueKind::CONTAINER;
+    if (g_type_is_a(gtype, G_TYPE_BOXED)) {
+        if (g_type_is_a(gtype, G_TYPE_VALUE))
+            return ValueKind::VALUE;
+        if (g_type_is_a(gtype, G_TYPE_ERROR))
+            return ValueKind::ERROR;
+        return ValueKind::BOXED;
+    }
+    if (g_type_is_a(gtype, G_TYPE_VARIANT))
+        return ValueKind::VARIANT;
+    if (g_type_is_a(gtype, G_TYPE_ENUM))
+        return ValueKind::ENUM;
+    if (g_type_is_a(gtype, G_TYPE_FLAGS))
+        return ValueKind::FLAGS;
+    if (g_type_is_a(gtype, G_TYPE_PARAM))
+        return ValueKind::PARAM;
+    if (g_type_is_a(gtype, G_TYPE_GTYPE))
+        return ValueKind::GTYPE;
+    if (g_type_is_a(gtype, G_TYPE_POINTER))
+        return ValueKind::POINTER;
+    return ValueKind::OTHER;
+}
+
+// GTypes are never unregistered, so entries never need to be removed
+static thread_local std::unordered_map<GType, ValueKind> s_value_kinds;
+
+[[nodiscard]] static ValueKind value_kind(GType gtype) {
+    auto it = s_value_kinds.find(gtype);
+    if (it != s_value_kinds.end())
+        return it->second;
+
+    ValueKind kind = classify_gtype(gtype);
+    s_value_kinds.emplace(gtype, kind);
+    return kind;
+}
+
 GJS_JSAPI_RETURN_CONVENTION
 static bool
 gjs_value_to_g_value_internal(JSContext      *context,
@@ -406,339 +731,372 @@ gjs_value_to_g_value_internal(JSContext      *context,
                       "Converting JS::Value to gtype %s",
                       g_type_name(gtype));
 
+    ValueKind kind = value_kind(gtype);
+    switch (kind) {
+        case ValueKind::STRING: {
+            /* Don't use ValueToString since we don't want to just toString()
+             * everything automatically
+             */
+            if (value.isNull()) {
+                g_value_set_string(gvalue, NULL);
+            } else if (value.isString()) {
+                JS::RootedString str(context, value.toString());
+                JS::UniqueChars utf8_string(JS_EncodeStringToUTF8(context, str));
+                if (!utf8_string)
+                    return false;
 
-    if (gtype == G_TYPE_STRING) {
-        /* Don't use ValueToString since we don't want to just toString()
-         * everything automatically
-         */
-        if (value.isNull()) {
-            g_value_set_string(gvalue, NULL);
-        } else if (value.isString()) {
-            JS::RootedString str(context, value.toString());
-            JS::UniqueChars utf8_string(JS_EncodeStringToUTF8(context, str));
-            if (!utf8_string)
-                return false;
-
-            g_value_set_string(gvalue, utf8_string.get());
-        } else {
-            return throw_expect_type(context, value, "string");
+                g_value_set_string(gvalue, utf8_string.get());
+            } else {
+                return throw_expect_type(context, value, "string");
+            }
+            break;
         }
-    } else if (gtype == G_TYPE_CHAR) {
-        gint32 i;
-        if (JS::ToInt32(context, value, &i) && i >= SCHAR_MIN && i <= SCHAR_MAX) {
-            g_value_set_schar(gvalue, (signed char)i);
-        } else {
-            return throw_expect_type(context, value, "char");
+        case ValueKind::CHAR: {
+            gint32 i;
+            if (JS::ToInt32(context, value, &i) && i >= SCHAR_MIN && i <= SCHAR_MAX) {
+                g_value_set_schar(gvalue, (signed char)i);
+            } else {
+                return throw_expect_type(context, value, "char");
+            }
+            break;
         }
-    } else if (gtype == G_TYPE_UCHAR) {
-        guint16 i;
-        if (JS::ToUint16(context, value, &i) && i <= UCHAR_MAX) {
-            g_value_set_uchar(gvalue, (unsigned char)i);
-        } else {
-            return throw_expect_type(context, value, "unsigned char");
+        case ValueKind::UCHAR: {
+            guint16 i;
+            if (JS::ToUint16(context, value, &i) && i <= UCHAR_MAX) {
+                g_value_set_uchar(gvalue, (unsigned char)i);
+            } else {
+                return throw_expect_type(context, value, "unsigned char");
+            }
+            break;
         }
-    } else if (gtype == G_TYPE_INT) {
-        gint32 i;
-        if (JS::ToInt32(context, value, &i)) {
-            g_value_set_int(gvalue, i);
-        } else {
-            return throw_expect_type(context, value, "integer");
+        case ValueKind::INT: {
+            gint32 i;
+            if (JS::ToInt32(context, value, &i)) {
+                g_value_set_int(gvalue, i);
+            } else {
+                return throw_expect_type(context, value, "integer");
+            }
+            break;
         }
-    } else if (gtype == G_TYPE_DOUBLE) {
-        gdouble d;
-        if (JS::ToNumber(context, value, &d)) {
-            g_value_set_double(gvalue, d);
-        } else {
-            return throw_expect_type(context, value, "double");
+        case ValueKind::DOUBLE: {
+            gdouble d;
+            if (JS::ToNumber(context, value, &d)) {
+                g_value_set_double(gvalue, d);
+            } else {
+                return throw_expect_type(context, value, "double");
+            }
+            break;
         }
-    } else if (gtype == G_TYPE_FLOAT) {
-        gdouble d;
-        if (JS::ToNumber(context, value, &d)) {
-            g_value_set_float(gvalue, d);
-        } else {
-            return throw_expect_type(context, value, "float");
+        case ValueKind::FLOAT: {
+            gdouble d;
+            if (JS::ToNumber(context, value, &d)) {
+                g_value_set_float(gvalue, d);
+            } else {
+                return throw_expect_type(context, value, "float");
+            }
+            break;
         }
-    } else if (gtype == G_TYPE_UINT) {
-        guint32 i;
-        if (JS::ToUint32(context, value, &i)) {
-            g_value_set_uint(gvalue, i);
-        } else {
-            return throw_expect_type(context, value, "unsigned integer");
-        }
-    } else if (gtype == G_TYPE_BOOLEAN) {
-        /* JS::ToBoolean() can't fail */
-        g_value_set_boolean(gvalue, JS::ToBoolean(value));
-    } else if (g_type_is_a(gtype, G_TYPE_OBJECT) || g_type_is_a(gtype, G_TYPE_INTERFACE)) {
-        GObject *gobj;
-
-        gobj = NULL;
-        if (value.isNull()) {
-            /* nothing to do */
-        } else if (value.isObject()) {
-            JS::RootedObject obj(context, &value.toObject());
-            if (!ObjectBase::typecheck(context, obj, nullptr, gtype) ||
-                !ObjectBase::to_c_ptr(context, obj, &gobj))
-                return false;
-            if (!gobj)
-                return true;  // treat disposed object as if value.isNull()
-        } else {
-            return throw_expect_type(context, value, "object", gtype);
-        }
-
-        g_value_set_object(gvalue, gobj);
-    } else if (gtype == G_TYPE_STRV) {
-        if (value.isNull()) {
-            /* do nothing */
-        } else if (value.isObject()) {
-            bool found_length;
-
-            const GjsAtoms& atoms = GjsContextPrivate::atoms(context);
-            JS::RootedObject array_obj(context, &value.toObject());
-            if (JS_HasPropertyById(context, array_obj, atoms.length(),
-                                   &found_length) &&
-                found_length) {
-                guint32 length;
-
-                if (!gjs_object_require_converted_property(
-                        context, array_obj, nullptr, atoms.length(), &length)) {
-                    JS_ClearPendingException(context);
-                    return throw_expect_type(context, value, "strv");
-                } else {
-                    void *result;
-                    char **strv;
-
-                    if (!gjs_array_to_strv (context,
-                                            value,
-                                            length, &result))
-                        return false;
-                    /* cast to strv in a separate step to avoid type-punning */
-                    strv = (char**) result;
-                    g_value_take_boxed (gvalue, strv);
-                }
+        case ValueKind::UINT: {
+            guint32 i;
+            if (JS::ToUint32(context, value, &i)) {
+                g_value_set_uint(gvalue, i);
             } else {
-                return throw_expect_type(context, value, "strv");
+                return throw_expect_type(context, value, "unsigned integer");
             }
-        } else {
-            return throw_expect_type(context, value, "strv");
+            break;
         }
-    } else if (g_type_is_a(gtype, G_TYPE_BOXED)) {
-        void *gboxed;
-
-        gboxed = NULL;
-        if (value.isNull())
-            return true;
-
-        /* special case GValue */
-        if (g_type_is_a(gtype, G_TYPE_VALUE)) {
-            GValue nested_gvalue = G_VALUE_INIT;
+        case ValueKind::BOOLEAN: {
+            /* JS::ToBoolean() can't fail */
+            g_value_set_boolean(gvalue, JS::ToBoolean(value));
+            break;
+        }
+        case ValueKind::OBJECT: {
+            GObject *gobj;
 
-            /* explicitly handle values that are already GValues
-               to avoid infinite recursion */
-            if (value.isObject()) {
+            gobj = NULL;
+            if (value.isNull()) {
+                /* nothing to do */
+            } else if (value.isObject()) {
                 JS::RootedObject obj(context, &value.toObject());
-                GType guessed_gtype;
-
-                if (!gjs_value_guess_g_type(context, value, &guessed_gtype))
+                if (!ObjectBase::typecheck(context, obj, nullptr, gtype) ||
+                    !ObjectBase::to_c_ptr(context, obj, &gobj))
                     return false;
-
-                if (guessed_gtype == G_TYPE_VALUE) {
-                    gboxed = BoxedBase::to_c_ptr<GValue>(context, obj);
-                    g_value_set_boxed(gvalue, gboxed);
-                    return true;
-                }
+                if (!gobj)
+                    return true;  // treat disposed object as if value.isNull()
+            } else {
+                return throw_expect_type(context, value, "object", gtype);
             }
 
-            if (!gjs_value_to_g_value(context, value, &nested_gvalue))
-                return false;
-
-            g_value_set_boxed(gvalue, &nested_gvalue);
-            g_value_unset(&nested_gvalue);
-            return true;
+            g_value_set_object(gvalue, gobj);
+            break;
         }
+        case ValueKind::STRV: {
+            if (value.isNull()) {
+                /* do nothing */
+            } else if (value.isObject()) {
+                bool found_length;
+
+                const GjsAtoms& atoms = GjsContextPrivate::atoms(context);
+                JS::RootedObject array_obj(context, &value.toObject());
+                if (JS_HasPropertyById(context, array_obj, atoms.length(),
+                                       &found_length) &&
+                    found_length) {
+                    guint32 length;
+
+                    if (!gjs_object_require_converted_property(
+                            context, array_obj, nullptr, atoms.length(), &length)) {
+                        JS_ClearPendingException(context);
+                        return throw_expect_type(context, value, "strv");
+                    } else {
+                        void *result;
+                        char **strv;
 
-        if (value.isObject()) {
-            JS::RootedObject obj(context, &value.toObject());
-
-            if (g_type_is_a(gtype, G_TYPE_ERROR)) {
-                /* special case GError */
-                gboxed = ErrorBase::to_c_ptr(context, obj);
-                if (!gboxed)
-                    return false;
-            } else {
-                GIBaseInfo *registered = g_irepository_find_by_gtype (NULL, gtype);
-
-                /* We don't necessarily have the typelib loaded when
-                   we first see the structure... */
-                if (registered) {
-                    GIInfoType info_type = g_base_info_get_type (registered);
-
-                    if (info_type == GI_INFO_TYPE_STRUCT &&
-                        g_struct_info_is_foreign ((GIStructInfo*)registered)) {
-                        GArgument arg;
-
-                        if (!gjs_struct_foreign_convert_to_g_argument (context, value,
-                                                                       registered,
-                                                                       NULL,
-                                                                       GJS_ARGUMENT_ARGUMENT,
-                                                                       GI_TRANSFER_NOTHING,
-                                                                       true, &arg))
+                        if (!gjs_array_to_strv (context,
+                                                value,
+                                                length, &result))
                             return false;
+                        /* cast to strv in a separate step to avoid type-punning */
+                        strv = (char**) result;
+                        g_value_take_boxed (gvalue, strv);
+                    }
+                } else {
+                    return throw_expect_type(context, value, "strv");
+                }
+            } else {
+                return throw_expect_type(context, value, "strv");
+            }
+            break;
+        }
+        case ValueKind::CONTAINER:
+        case ValueKind::VALUE:
+        case ValueKind::ERROR:
+        case ValueKind::BOXED: {
+            void *gboxed;
+
+            gboxed = NULL;
+            if (value.isNull())
+                return true;
+
+            /* special case GValue */
+            if (kind == ValueKind::VALUE) {
+                GValue nested_gvalue = G_VALUE_INIT;
+
+                /* explicitly handle values that are already GValues
+                   to avoid infinite recursion */
+                if (value.isObject()) {
+                    JS::RootedObject obj(context, &value.toObject());
+                    GType guessed_gtype;
+
+                    if (!gjs_value_guess_g_type(context, value, &guessed_gtype))
+                        return false;
 
-                        gboxed = gjs_arg_get<void*>(&arg);
+                    if (guessed_gtype == G_TYPE_VALUE) {
+                        gboxed = BoxedBase::to_c_ptr<GValue>(context, obj);
+                        g_value_set_boxed(gvalue, gboxed);
+                        return true;
                     }
                 }
 
-                /* First try a union, if that fails,
-                   assume a boxed struct. Distinguishing
-                   which one is expected would require checking
-                   the associated GIBaseInfo, which is not necessary
-                   possible, if e.g. we see the GType without
-                   loading the typelib.
-                */
-                if (!gboxed) {
-                    if (UnionBase::typecheck(context, obj, nullptr, gtype,
-                                             GjsTypecheckNoThrow())) {
-                        gboxed = UnionBase::to_c_ptr(context, obj);
-                    } else {
-                        if (!BoxedBase::typecheck(context, obj, nullptr, gtype))
-                            return false;
+                if (!gjs_value_to_g_value(context, value, &nested_gvalue))
+                    return false;
 
-                        gboxed = BoxedBase::to_c_ptr(context, obj);
-                    }
+                g_value_set_boxed(gvalue, &nested_gvalue);
+                g_value_unset(&nested_gvalue);
+                return true;
+            }
+
+            if (value.isObject()) {
+                JS::RootedObject obj(context, &value.toObject());
+
+                if (kind == ValueKind::ERROR) {
+                    /* special case GError */
+                    gboxed = ErrorBase::to_c_ptr(context, obj);
                     if (!gboxed)
                         return false;
+                } else {
+                    GIBaseInfo *registered = g_irepository_find_by_gtype (NULL, gtype);
+
+                    /* We don't necessarily have the typelib loaded when
+                       we first see the structure... */
+                    if (registered) {
+                        GIInfoType info_type = g_base_info_get_type (registered);
+
+                        if (info_type == GI_INFO_TYPE_STRUCT &&
+                            g_struct_info_is_foreign ((GIStructInfo*)registered)) {
+                            GArgument arg;
+
+                            if (!gjs_struct_foreign_convert_to_g_argument (context, value,
+                                                                           registered,
+                                                                           NULL,
+                                                                           GJS_ARGUMENT_ARGUMENT,
+                                                                           GI_TRANSFER_NOTHING,
+                                                                           true, &arg))
+                                return false;
+
+                            gboxed = gjs_arg_get<void*>(&arg);
+                        }
+                    }
+
+                    /* First try a union, if that fails,
+                       assume a boxed struct. Distinguishing
+                       which one is expected would require checking
+                       the associated GIBaseInfo, which is not necessary
+                       possible, if e.g. we see the GType without
+                       loading the typelib.
+                    */
+                    if (!gboxed) {
+                        if (UnionBase::typecheck(context, obj, nullptr, gtype,
+                                                 GjsTypecheckNoThrow())) {
+                            gboxed = UnionBase::to_c_ptr(context, obj);
+                        } else {
+                            if (!BoxedBase::typecheck(context, obj, nullptr, gtype))
+                                return false;
+
+                            gboxed = BoxedBase::to_c_ptr(context, obj);
+                        }
+                        if (!gboxed)
+                            return false;
+                    }
                 }
+            } else {
+                return throw_expect_type(context, value, "boxed type", gtype);
             }
-        } else {
-            return throw_expect_type(context, value, "boxed type", gtype);
+
+            if (no_copy)
+                g_value_set_static_boxed(gvalue, gboxed);
+            else
+                g_value_set_boxed(gvalue, gboxed);
+            break;
         }
+        case ValueKind::VARIANT: {
+            GVariant *variant = NULL;
 
-        if (no_copy)
-            g_value_set_static_boxed(gvalue, gboxed);
-        else
-            g_value_set_boxed(gvalue, gboxed);
-    } else if (g_type_is_a(gtype, G_TYPE_VARIANT)) {
-        GVariant *variant = NULL;
+            if (value.isNull()) {
+                /* nothing to do */
+            } else if (value.isObject()) {
+                JS::RootedObject obj(context, &value.toObject());
 
-        if (value.isNull()) {
-            /* nothing to do */
-        } else if (value.isObject()) {
-            JS::RootedObject obj(context, &value.toObject());
+                if (!BoxedBase::typecheck(context, obj, nullptr, G_TYPE_VARIANT))
+                    return false;
 
-            if (!BoxedBase::typecheck(context, obj, nullptr, G_TYPE_VARIANT))
-                return false;
+                variant = BoxedBase::to_c_ptr<GVariant>(context, obj);
+                if (!variant)
+                    return false;
+            } else {
+                return throw_expect_type(context, value, "boxed type", gtype);
+            }
 
-            variant = BoxedBase::to_c_ptr<GVariant>(context, obj);
-            if (!variant)
-                return false;
-        } else {
-            return throw_expect_type(context, value, "boxed type", gtype);
+            g_value_set_variant (gvalue, variant);
+            break;
         }
+        case ValueKind::ENUM: {
+            int64_t value_int64;
 
-        g_value_set_variant (gvalue, variant);
-    } else if (g_type_is_a(gtype, G_TYPE_ENUM)) {
-        int64_t value_int64;
-
-        if (JS::ToInt64(context, value, &value_int64)) {
-            GEnumValue *v;
-            GjsAutoTypeClass<GEnumClass> enum_class(gtype);
+            if (JS::ToInt64(context, value, &value_int64)) {
+                if (!_gjs_enum_gtype_value_is_valid(context, gtype, value_int64))
+                    return false;
 
-            /* See arg.c:_gjs_enum_to_int() */
-            v = g_enum_get_value(enum_class, (int)value_int64);
-            if (v == NULL) {
-                gjs_throw(context,
-                          "%d is not a valid value for enumeration %s",
-                          value.toInt32(), g_type_name(gtype));
-                return false;
+                /* See arg.c:_gjs_enum_to_int() */
+                g_value_set_enum(gvalue, (int)value_int64);
+            } else {
+                return throw_expect_type(context, value, "enum", gtype);
             }
-
-            g_value_set_enum(gvalue, v->value);
-        } else {
-            return throw_expect_type(context, value, "enum", gtype);
+            break;
         }
-    } else if (g_type_is_a(gtype, G_TYPE_FLAGS)) {
-        int64_t value_int64;
+        case ValueKind::FLAGS: {
+            int64_t value_int64;
 
-        if (JS::ToInt64(context, value, &value_int64)) {
-            if (!_gjs_flags_value_is_valid(context, gtype, value_int64))
-                return false;
+            if (JS::ToInt64(context, value, &value_int64)) {
+                if (!_gjs_flags_value_is_valid(context, gtype, value_int64))
+                    return false;
 
-            /* See arg.c:_gjs_enum_to_int() */
-            g_value_set_flags(gvalue, (int)value_int64);
-        } else {
-            return throw_expect_type(context, value, "flags", gtype);
+                /* See arg.c:_gjs_enum_to_int() */
+                g_value_set_flags(gvalue, (int)value_int64);
+            } else {
+                return throw_expect_type(context, value, "flags", gtype);
+            }
+            break;
         }
-    } else if (g_type_is_a(gtype, G_TYPE_PARAM)) {
-        void *gparam;
+        case ValueKind::PARAM: {
+            void *gparam;
 
-        gparam = NULL;
-        if (value.isNull()) {
-            /* nothing to do */
-        } else if (value.isObject()) {
-            JS::RootedObject obj(context, &value.toObject());
+            gparam = NULL;
+            if (value.isNull()) {
+                /* nothing to do */
+            } else if (value.isObject()) {
+                JS::RootedObject obj(context, &value.toObject());
 
-            if (!gjs_typecheck_param(context, obj, gtype, true))
-                return false;
+                if (!gjs_typecheck_param(context, obj, gtype, true))
+                    return false;
 
-            gparam = gjs_g_param_from_param(context, obj);
-        } else {
-            return throw_expect_type(context, value, "param type", gtype);
-        }
+                gparam = gjs_g_param_from_param(context, obj);
+            } else {
+                return throw_expect_type(context, value, "param type", gtype);
+            }
 
-        g_value_set_param(gvalue, (GParamSpec*) gparam);
-    } else if (g_type_is_a(gtype, G_TYPE_GTYPE)) {
-        GType type;
+            g_value_set_param(gvalue, (GParamSpec*) gparam);
+            break;
+        }
+        case ValueKind::GTYPE: {
+            GType type;
 
-        if (!value.isObject())
-            return throw_expect_type(context, value, "GType object");
+            if (!value.isObject())
+                return throw_expect_type(context, value, "GType object");
 
-        JS::RootedObject obj(context, &value.toObject());
-        if (!gjs_gtype_get_actual_gtype(context, obj, &type))
-            return false;
-        g_value_set_gtype(gvalue, type);
-    } else if (g_type_is_a(gtype, G_TYPE_POINTER)) {
-        if (value.isNull()) {
-            /* Nothing to do */
-        } else {
-            gjs_throw(context,
-                      "Cannot convert non-null JS value to G_POINTER");
-            return false;
+            JS::RootedObject obj(context, &value.toObject());
+            if (!gjs_gtype_get_actual_gtype(context, obj, &type))
+                return false;
+            g_value_set_gtype(gvalue, type);
+            break;
         }
-    } else if (value.isNumber() &&
-               g_value_type_transformable(G_TYPE_INT, gtype)) {
-        /* Only do this crazy gvalue transform stuff after we've
-         * exhausted everything else. Adding this for
-         * e.g. ClutterUnit.
-         */
-        gint32 i;
-        if (JS::ToInt32(context, value, &i)) {
-            GValue int_value = { 0, };
-            g_value_init(&int_value, G_TYPE_INT);
-            g_value_set_int(&int_value, i);
-            g_value_transform(&int_value, gvalue);
-        } else {
-            return throw_expect_type(context, value, "integer");
+        case ValueKind::POINTER: {
+            if (value.isNull()) {
+                /* Nothing to do */
+            } else {
+                gjs_throw(context,
+                          "Cannot convert non-null JS value to G_POINTER");
+                return false;
+            }
+            break;
         }
-    } else if (G_TYPE_IS_INSTANTIATABLE(gtype)) {
-        // The gtype is none of the above, it should be derived from a custom
-        // fundamental type.
-        if (!value.isObject())
-            return throw_expect_type(context, value, "object", gtype);
+        default:
+            if (value.isNumber() &&
+                g_value_type_transformable(G_TYPE_INT, gtype)) {
+                /* Only do this crazy gvalue transform stuff after we've
+                 * exhausted everything else. Adding this for
+                 * e.g. ClutterUnit.
+                 */
+                gint32 i;
+                if (JS::ToInt32(context, value, &i)) {
+                    GValue int_value = { 0, };
+                    g_value_init(&int_value, G_TYPE_INT);
+                    g_value_set_int(&int_value, i);
+                    g_value_transform(&int_value, gvalue);
+                } else {
+                    return throw_expect_type(context, value, "integer");
+                }
+            } else if (G_TYPE_IS_INSTANTIATABLE(gtype)) {
+                // The gtype is none of the above, it should be derived from a custom
+                // fundamental type.
+                if (!value.isObject())
+                    return throw_expect_type(context, value, "object", gtype);
+
+                JS::RootedObject fundamental_object(context, &value.toObject());
+                if (!FundamentalBase::to_gvalue(context, fundamental_object, gvalue))
+                    return false;
+            } else {
+                gjs_debug(GJS_DEBUG_GCLOSURE, "JS::Value is number %d gtype fundamental %d transformable to int %d from int %d",
+                          value.isNumber(),
+                          G_TYPE_IS_FUNDAMENTAL(gtype),
+                          g_value_type_transformable(gtype, G_TYPE_INT),
+                          g_value_type_transformable(G_TYPE_INT, gtype));
 
-        JS::RootedObject fundamental_object(context, &value.toObject());
-        if (!FundamentalBase::to_gvalue(context, fundamental_object, gvalue))
-            return false;
-    } else {
-        gjs_debug(GJS_DEBUG_GCLOSURE, "JS::Value is number %d gtype fundamental %d transformable to int %d from int %d",
-                  value.isNumber(),
-                  G_TYPE_IS_FUNDAMENTAL(gtype),
-                  g_value_type_transformable(gtype, G_TYPE_INT),
-                  g_value_type_transformable(G_TYPE_INT, gtype));
-
-        gjs_throw(context,
-                  "Don't know how to convert JavaScript object to GType %s",
-                  g_type_name(gtype));
-        return false;
+                gjs_throw(context,
+                          "Don't know how to convert JavaScript object to GType %s",
+                          g_type_name(gtype));
+                return false;
+            }
+            break;
     }
 
     return true;
@@ -794,216 +1152,252 @@ gjs_value_from_g_value_internal(JSContext             *context,
                       "Converting gtype %s to JS::Value",
                       g_type_name(gtype));
 
-    if (gtype == G_TYPE_STRING) {
-        const char *v;
-        v = g_value_get_string(gvalue);
-        if (v == NULL) {
-            gjs_debug_marshal(GJS_DEBUG_GCLOSURE,
-                              "Converting NULL string to JS::NullValue()");
-            value_p.setNull();
-        } else {
-            if (!gjs_string_from_utf8(context, v, value_p))
-                return false;
+    ValueKind kind = value_kind(gtype);
+    switch (kind) {
+        case ValueKind::STRING: {
+            const char *v;
+            v = g_value_get_string(gvalue);
+            if (v == NULL) {
+                gjs_debug_marshal(GJS_DEBUG_GCLOSURE,
+                                  "Converting NULL string to JS::NullValue()");
+                value_p.setNull();
+            } else {
+                if (!gjs_string_from_utf8(context, v, value_p))
+                    return false;
+            }
+            break;
         }
-    } else if (gtype == G_TYPE_CHAR) {
-        char v;
-        v = g_value_get_schar(gvalue);
-        value_p.setInt32(v);
-    } else if (gtype == G_TYPE_UCHAR) {
-        unsigned char v;
-        v = g_value_get_uchar(gvalue);
-        value_p.setInt32(v);
-    } else if (gtype == G_TYPE_INT) {
-        int v;
-        v = g_value_get_int(gvalue);
-        value_p.set(JS::NumberValue(v));
-    } else if (gtype == G_TYPE_UINT) {
-        guint v;
-        v = g_value_get_uint(gvalue);
-        value_p.setNumber(v);
-    } else if (gtype == G_TYPE_DOUBLE) {
-        double d;
-        d = g_value_get_double(gvalue);
-        value_p.setNumber(d);
-    } else if (gtype == G_TYPE_FLOAT) {
-        double d;
-        d = g_value_get_float(gvalue);
-        value_p.setNumber(d);
-    } else if (gtype == G_TYPE_BOOLEAN) {
-        bool v;
-        v = g_value_get_boolean(gvalue);
-        value_p.setBoolean(!!v);
-    } else if (g_type_is_a(gtype, G_TYPE_OBJECT) || g_type_is_a(gtype, G_TYPE_INTERFACE)) {
-        GObject *gobj;
-
-        gobj = (GObject*) g_value_get_object(gvalue);
-
-        if (gobj) {
-            JSObject* obj = ObjectInstance::wrapper_from_gobject(context, gobj);
-            if (!obj)
-                return false;
-            value_p.setObject(*obj);
-        } else {
-            value_p.setNull();
+        case ValueKind::CHAR: {
+            char v;
+            v = g_value_get_schar(gvalue);
+            value_p.setInt32(v);
+            break;
         }
-    } else if (gtype == G_TYPE_STRV) {
-        if (!gjs_array_from_strv (context,
-                                  value_p,
-                                  (const char**) g_value_get_boxed (gvalue))) {
-            gjs_throw(context, "Failed to convert strv to array");
-            return false;
+        case ValueKind::UCHAR: {
+            unsigned char v;
+            v = g_value_get_uchar(gvalue);
+            value_p.setInt32(v);
+            break;
         }
-    } else if (g_type_is_a(gtype, G_TYPE_HASH_TABLE) ||
-               g_type_is_a(gtype, G_TYPE_ARRAY) ||
-               g_type_is_a(gtype, G_TYPE_BYTE_ARRAY) ||
-               g_type_is_a(gtype, G_TYPE_PTR_ARRAY)) {
-        gjs_throw(context,
-                  "Unable to introspect element-type of container in GValue");
-        return false;
-    } else if (g_type_is_a(gtype, G_TYPE_BOXED) ||
-               g_type_is_a(gtype, G_TYPE_VARIANT)) {
-        void *gboxed;
-        JSObject *obj;
-
-        if (g_type_is_a(gtype, G_TYPE_BOXED))
-            gboxed = g_value_get_boxed(gvalue);
-        else
-            gboxed = g_value_get_variant(gvalue);
-
-        if (!gboxed) {
-            gjs_debug_marshal(GJS_DEBUG_GCLOSURE,
-                              "Converting null boxed pointer to JS::Value");
-            value_p.setNull();
-            return true;
-        }
-
-        /* special case GError */
-        if (g_type_is_a(gtype, G_TYPE_ERROR)) {
-            obj = ErrorInstance::object_for_c_ptr(context,
-                                                  static_cast<GError*>(gboxed));
-            if (!obj)
-                return false;
-            value_p.setObject(*obj);
-            return true;
+        case ValueKind::INT: {
+            int v;
+            v = g_value_get_int(gvalue);
+            value_p.set(JS::NumberValue(v));
+            break;
         }
-
-        /* special case GValue */
-        if (g_type_is_a(gtype, G_TYPE_VALUE)) {
-            return gjs_value_from_g_value(context, value_p,
-                                          static_cast<GValue *>(gboxed));
+        case ValueKind::UINT: {
+            guint v;
+            v = g_value_get_uint(gvalue);
+            value_p.setNumber(v);
+            break;
+        }
+        case ValueKind::DOUBLE: {
+            double d;
+            d = g_value_get_double(gvalue);
+            value_p.setNumber(d);
+            break;
+        }
+        case ValueKind::FLOAT: {
+            double d;
+            d = g_value_get_float(gvalue);
+            value_p.setNumber(d);
+            break;
+        }
+        case ValueKind::BOOLEAN: {
+            bool v;
+            v = g_value_get_boolean(gvalue);
+            value_p.setBoolean(!!v);
+            break;
         }
+        case ValueKind::OBJECT: {
+            GObject *gobj;
 
-        /* The only way to differentiate unions and structs is from
-         * their g-i info as both GBoxed */
-        GjsAutoBaseInfo info = g_irepository_find_by_gtype(nullptr, gtype);
-        if (!info) {
+            gobj = (GObject*) g_value_get_object(gvalue);
+
+            if (gobj) {
+                JSObject* obj = ObjectInstance::wrapper_from_gobject(context, gobj);
+                if (!obj)
+                    return false;
+                value_p.setObject(*obj);
+            } else {
+                value_p.setNull();
+            }
+            break;
+        }
+        case ValueKind::STRV: {
+            if (!gjs_array_from_strv (context,
+                                      value_p,
+                                      (const char**) g_value_get_boxed (gvalue))) {
+                gjs_throw(context, "Failed to convert strv to array");
+                return false;
+            }
+            break;
+        }
+        case ValueKind::CONTAINER: {
             gjs_throw(context,
-                      "No introspection information found for %s",
-                      g_type_name(gtype));
+                      "Unable to introspect element-type of container in GValue");
             return false;
         }
+        case ValueKind::VALUE:
+        case ValueKind::ERROR:
+        case ValueKind::VARIANT:
+        case ValueKind::BOXED: {
+            void *gboxed;
+            JSObject *obj;
+
+            if (kind != ValueKind::VARIANT)
+                gboxed = g_value_get_boxed(gvalue);
+            else
+                gboxed = g_value_get_variant(gvalue);
 
-        if (info.type() == GI_INFO_TYPE_STRUCT &&
-            g_struct_info_is_foreign(info)) {
-            GIArgument arg;
-            gjs_arg_set(&arg, gboxed);
-            return gjs_struct_foreign_convert_from_g_argument(context, value_p,
-                                                              info, &arg);
-        }
+            if (!gboxed) {
+                gjs_debug_marshal(GJS_DEBUG_GCLOSURE,
+                                  "Converting null boxed pointer to JS::Value");
+                value_p.setNull();
+                return true;
+            }
 
-        GIInfoType type = info.type();
-        if (type == GI_INFO_TYPE_BOXED || type == GI_INFO_TYPE_STRUCT) {
-            if (no_copy)
-                obj = BoxedInstance::new_for_c_struct(context, info, gboxed,
-                                                      BoxedInstance::NoCopy());
-            else
-                obj = BoxedInstance::new_for_c_struct(context, info, gboxed);
-        } else if (type == GI_INFO_TYPE_UNION) {
-            obj = gjs_union_from_c_union(context, info, gboxed);
-        } else {
-            gjs_throw(context, "Unexpected introspection type %d for %s",
-                      info.type(), g_type_name(gtype));
-            return false;
-        }
+            /* special case GError */
+            if (kind == ValueKind::ERROR) {
+                obj = ErrorInstance::object_for_c_ptr(context,
+                                                      static_cast<GError*>(gboxed));
+                if (!obj)
+                    return false;
+                value_p.setObject(*obj);
+                return true;
+            }
+
+            /* special case GValue */
+            if (kind == ValueKind::VALUE) {
+                return gjs_value_from_g_value(context, value_p,
+                                              static_cast<GValue *>(gboxed));
+            }
 
-        value_p.setObjectOrNull(obj);
-    } else if (g_type_is_a(gtype, G_TYPE_ENUM)) {
-        value_p.set(convert_int_to_enum(gtype, g_value_get_enum(gvalue)));
-    } else if (g_type_is_a(gtype, G_TYPE_PARAM)) {
-        GParamSpec *gparam;
-        JSObject *obj;
+            /* The only way to differentiate unions and structs is from
+             * their g-i info as both GBoxed */
+            GjsAutoBaseInfo info = g_irepository_find_by_gtype(nullptr, gtype);
+            if (!info) {
+                gjs_throw(context,
+                          "No introspection information found for %s",
+                          g_type_name(gtype));
+                return false;
+            }
 
-        gparam = g_value_get_param(gvalue);
+            if (info.type() == GI_INFO_TYPE_STRUCT &&
+                g_struct_info_is_foreign(info)) {
+                GIArgument arg;
+                gjs_arg_set(&arg, gboxed);
+                return gjs_struct_foreign_convert_from_g_argument(context, value_p,
+                                                                  info, &arg);
+            }
 
-        obj = gjs_param_from_g_param(context, gparam);
-        value_p.setObjectOrNull(obj);
-    } else if (signal_query && g_type_is_a(gtype, G_TYPE_POINTER)) {
-        bool res;
-        GArgument arg;
-        GIArgInfo *arg_info;
-        GISignalInfo *signal_info;
-        GITypeInfo type_info;
-
-        signal_info = get_signal_info_if_available(signal_query);
-        if (!signal_info) {
-            gjs_throw(context, "Unknown signal.");
-            return false;
+            GIInfoType type = info.type();
+            if (type == GI_INFO_TYPE_BOXED || type == GI_INFO_TYPE_STRUCT) {
+                if (no_copy)
+                    obj = BoxedInstance::new_for_c_struct(context, info, gboxed,
+                                                          BoxedInstance::NoCopy());
+                else
+                    obj = BoxedInstance::new_for_c_struct(context, info, gboxed);
+            } else if (type == GI_INFO_TYPE_UNION) {
+                obj = gjs_union_from_c_union(context, info, gboxed);
+            } else {
+                gjs_throw(context, "Unexpected introspection type %d for %s",
+                          info.type(), g_type_name(gtype));
+                return false;
+            }
+
+            value_p.setObjectOrNull(obj);
+            break;
+        }
+        case ValueKind::ENUM: {
+            value_p.set(convert_int_to_enum(gtype, g_value_get_enum(gvalue)));
+            break;
         }
+        case ValueKind::PARAM: {
+            GParamSpec *gparam;
+            JSObject *obj;
 
-        arg_info = g_callable_info_get_arg(signal_info, arg_n - 1);
-        g_arg_info_load_type(arg_info, &type_info);
+            gparam = g_value_get_param(gvalue);
 
-        g_assert(((void) "Check gjs_value_from_array_and_length_values() before"
-                  " calling gjs_value_from_g_value_internal()",
-                  g_type_info_get_array_length(&type_info) == -1));
+            obj = gjs_param_from_g_param(context, gparam);
+            value_p.setObjectOrNull(obj);
+            break;
+        }
+        case ValueKind::GTYPE:
+        case ValueKind::POINTER: {
+            if (signal_query) {
+                bool res;
+                GArgument arg;
+                GIArgInfo *arg_info;
+                GISignalInfo *signal_info;
+                GITypeInfo type_info;
+
+                signal_info = get_signal_info_if_available(signal_query);
+                if (!signal_info) {
+                    gjs_throw(context, "Unknown signal.");
+                    return false;
+                }
 
-        gjs_arg_set(&arg, g_value_get_pointer(gvalue));
+                arg_info = g_callable_info_get_arg(signal_info, arg_n - 1);
+                g_arg_info_load_type(arg_info, &type_info);
 
-        res = gjs_value_from_g_argument(context, value_p, &type_info, &arg, true);
+                g_assert(((void) "Check gjs_value_from_array_and_length_values() before"
+                          " calling gjs_value_from_g_value_internal()",
+                          g_type_info_get_array_length(&type_info) == -1));
 
-        g_base_info_unref((GIBaseInfo*)arg_info);
-        g_base_info_unref((GIBaseInfo*)signal_info);
-        return res;
-    } else if (g_type_is_a(gtype, G_TYPE_POINTER)) {
-        gpointer pointer;
+                gjs_arg_set(&arg, g_value_get_pointer(gvalue));
 
-        pointer = g_value_get_pointer(gvalue);
+                res = gjs_value_from_g_argument(context, value_p, &type_info, &arg, true);
 
-        if (pointer == NULL) {
-            value_p.setNull();
-        } else {
-            gjs_throw(context,
-                      "Can't convert non-null pointer to JS value");
-            return false;
+                g_base_info_unref((GIBaseInfo*)arg_info);
+                g_base_info_unref((GIBaseInfo*)signal_info);
+                return res;
+            }
+
+            gpointer pointer;
+
+            pointer = g_value_get_pointer(gvalue);
+
+            if (pointer == NULL) {
+                value_p.setNull();
+            } else {
+                gjs_throw(context,
+                          "Can't convert non-null pointer to JS value");
+                return false;
+            }
+            break;
         }
-    } else if (g_value_type_transformable(gtype, G_TYPE_DOUBLE)) {
-        GValue double_value = { 0, };
-        double v;
-        g_value_init(&double_value, G_TYPE_DOUBLE);
-        g_value_transform(gvalue, &double_value);
-        v = g_value_get_double(&double_value);
-        value_p.setNumber(v);
-    } else if (g_value_type_transformable(gtype, G_TYPE_INT)) {
-        GValue int_value = { 0, };
-        int v;
-        g_value_init(&int_value, G_TYPE_INT);
-        g_value_transform(gvalue, &int_value);
-        v = g_value_get_int(&int_value);
-        value_p.set(JS::NumberValue(v));
-    } else if (G_TYPE_IS_INSTANTIATABLE(gtype)) {
-        /* The gtype is none of the above, it should be a custom
-           fundamental type. */
-        JSObject* obj =
-            FundamentalInstance::object_for_gvalue(context, gvalue, gtype);
-        if (obj == NULL)
-            return false;
-        else
-            value_p.setObject(*obj);
-    } else {
-        gjs_throw(context,
-                  "Don't know how to convert GType %s to JavaScript object",
-                  g_type_name(gtype));
-        return false;
+        default:
+            if (g_value_type_transformable(gtype, G_TYPE_DOUBLE)) {
+                GValue double_value = { 0, };
+                double v;
+                g_value_init(&double_value, G_TYPE_DOUBLE);
+                g_value_transform(gvalue, &double_value);
+                v = g_value_get_double(&double_value);
+                value_p.setNumber(v);
+            } else if (g_value_type_transformable(gtype, G_TYPE_INT)) {
+                GValue int_value = { 0, };
+                int v;
+                g_value_init(&int_value, G_TYPE_INT);
+                g_value_transform(gvalue, &int_value);
+                v = g_value_get_int(&int_value);
+                value_p.set(JS::NumberValue(v));
+            } else if (G_TYPE_IS_INSTANTIATABLE(gtype)) {
+                /* The gtype is none of the above, it should be a custom
+                   fundamental type. */
+                JSObject* obj =
+                    FundamentalInstance::object_for_gvalue(context, gvalue, gtype);
+                if (obj == NULL)
+                    return false;
+                else
+                    value_p.setObject(*obj);
+            } else {
+                gjs_throw(context,
+                          "Don't know how to convert GType %s to JavaScript object",
+                          g_type_name(gtype));
+                return false;
+            }
+            break;
     }
 
     return true;
@@ -26,6 +26,8 @@
 
 #include <config.h>
 
+#include <stdint.h>
+
 #include <glib-object.h>
 
 #include <js/TypeDecls.h>
@@ -49,9 +51,17 @@ bool gjs_value_from_g_value(JSContext             *context,
 [[nodiscard]] GClosure* gjs_closure_new_marshaled(JSContext* cx,
                                                   JSFunction* callable,
                                                   const char* description);
-[[nodiscard]] GClosure* gjs_closure_new_for_signal(JSContext* cx,
-                                                   JSFunction* callable,
-                                                   const char* description,
-                                                   unsigned signal_id);
+
+// How emissions of a signal are passed on to a handler connected with the
+// throttle or debounce option of connect(). THROTTLE calls the handler at most
+// once per interval, with the last emission that came in during the interval.
+// DEBOUNCE calls it once emissions have stopped for a whole interval.
+enum class GjsSignalRateLimit : uint8_t { NONE, THROTTLE, DEBOUNCE };
+
+[[nodiscard]] GClosure* gjs_closure_new_for_signal(
+    JSContext* cx, JSFunction* callable, const char* description,
+    unsigned signal_id,
+    GjsSignalRateLimit rate_limit = GjsSignalRateLimit::NONE,
+    unsigned interval_ms = 0);
 
 #endif  // GI_VALUE_H_
@@ -0,0 +1,696 @@
+/* -*- mode: C++; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * SPDX-License-Identifier: MIT OR LGPL-2.0-or-later
+ */
+
+#include <config.h>
+
+#include <stddef.h>  // for size_t
+#include <stdint.h>
+
+#include <girepository.h>
+#include <glib-object.h>
+#include <glib.h>
+
+#include <js/Array.h>  // for GetArrayLength, NewArrayObject
+#include <js/ArrayBuffer.h>  // for NewArrayBuffer, NewArrayBufferWithContents
+#include <js/Conversions.h>
+#include <js/GCVector.h>  // for RootedVector
+#include <js/PropertyDescriptor.h>  // for JSPROP_ENUMERATE
+#include <js/RootingAPI.h>
+#include <js/TypeDecls.h>
+#include <js/Value.h>
+#include <jsapi.h>  // for JS_GetElement, JS_Enumerate, JS_NewPlainObject
+#include <jsfriendapi.h>  // for JS_IsUint8Array, JS_NewUint8ArrayWithBuffer
+
+#include "gi/arg-inl.h"
+#include "gi/boxed.h"
+#include "gi/variant.h"
+#include "cjs/byteArray.h"
+#include "cjs/jsapi-util.h"
+#include "cjs/macros.h"
+
+using GjsAutoVariant = GjsAutoPointer<GVariant, GVariant, g_variant_unref>;
+using GjsAutoVariantBuilder =
+    GjsAutoPointer<GVariantBuilder, GVariantBuilder, g_variant_builder_unref>;
+
+[[nodiscard]] static char type_char(const GVariantType* type) {
+    return g_variant_type_peek_string(type)[0];
+}
+
+// Sinks a new floating variant, so that it is released if packing one of its
+// siblings fails before it is added to its container
+[[nodiscard]] static GVariant* sink(GVariant* variant) {
+    return variant ? g_variant_ref_sink(variant) : nullptr;
+}
+
+[[nodiscard]] static GVariant* throw_out_of_range(JSContext* cx,
+                                                  const GVariantType* type) {
+    gjs_throw(cx, "Value is out of range for GVariant type '%c'",
+              type_char(type));
+    return nullptr;
+}
+
+[[nodiscard]] static GVariant* throw_expected(JSContext* cx,
+                                              const GVariantType* type,
+                                              const char* expected,
+                                              JS::HandleValue value) {
+    GjsAutoChar type_string = g_variant_type_dup_string(type);
+    gjs_throw_custom(cx, JSProto_TypeError, nullptr,
+                     "Expected %s for GVariant type '%s', got %s", expected,
+                     type_string.get(), JS::InformalValueTypeName(value));
+    return nullptr;
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static GVariant* pack_variant(JSContext* cx, const GVariantType* type,
+                              JS::HandleValue value);
+
+GJS_JSAPI_RETURN_CONVENTION
+static GVariant* pack_string(JSContext* cx, const GVariantType* type,
+                             JS::HandleValue value) {
+    if (!value.isString())
+        return throw_expected(cx, type, "a string", value);
+
+    JS::UniqueChars str = gjs_string_to_utf8(cx, value);
+    if (!str)
+        return nullptr;
+
+    switch (type_char(type)) {
+        case 'o':
+            if (!g_variant_is_object_path(str.get())) {
+                gjs_throw_custom(cx, JSProto_TypeError, nullptr,
+                                 "Invalid object path '%s'", str.get());
+                return nullptr;
+            }
+            return g_variant_new_object_path(str.get());
+        case 'g':
+            if (!g_variant_is_signature(str.get())) {
+                gjs_throw_custom(cx, JSProto_TypeError, nullptr,
+                                 "Invalid signature '%s'", str.get());
+                return nullptr;
+            }
+            return g_variant_new_signature(str.get());
+        default:
+            return g_variant_new_string(str.get());
+    }
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static GVariant* pack_boxed_variant(JSContext* cx, const GVariantType* type,
+                                    JS::HandleValue value) {
+    if (!value.isObject())
+        return throw_expected(cx, type, "a GLib.Variant", value);
+
+    JS::RootedObject obj(cx, &value.toObject());
+    if (!BoxedBase::typecheck(cx, obj, nullptr, G_TYPE_VARIANT))
+        return nullptr;
+
+    GVariant* child = BoxedBase::to_c_ptr<GVariant>(cx, obj);
+    if (!child)
+        return nullptr;
+    return g_variant_new_variant(child);
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static GVariant* pack_dict_entry(JSContext* cx, const GVariantType* type,
+                                 JS::HandleValue key, JS::HandleValue value) {
+    GjsAutoVariant key_variant =
+        sink(pack_variant(cx, g_variant_type_key(type), key));
+    if (!key_variant)
+        return nullptr;
+    GjsAutoVariant value_variant =
+        sink(pack_variant(cx, g_variant_type_value(type), value));
+    if (!value_variant)
+        return nullptr;
+    return g_variant_new_dict_entry(key_variant, value_variant);
+}
+
+// Byte arrays can be given as strings, which are stored with a trailing nul
+// byte, or as Uint8Arrays, whose memory is shared with the variant if it came
+// from a GBytes in the first place. Anything else is packed element by element.
+GJS_JSAPI_RETURN_CONVENTION
+static bool pack_byte_array(JSContext* cx, JS::HandleValue value,
+                            GVariant** variant_out) {
+    if (value.isString()) {
+        JS::UniqueChars str = gjs_string_to_utf8(cx, value);
+        if (!str)
+            return false;
+        *variant_out = g_variant_new_bytestring(str.get());
+        return true;
+    }
+
+    if (value.isObject() && JS_IsUint8Array(&value.toObject())) {
+        GjsAutoBytes bytes = gjs_byte_array_get_bytes(&value.toObject());
+        *variant_out =
+            g_variant_new_from_bytes(G_VARIANT_TYPE_BYTESTRING, bytes, true);
+        return true;
+    }
+
+    *variant_out = nullptr;
+    return true;
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static GVariant* pack_array(JSContext* cx, const GVariantType* type,
+                            JS::HandleValue value) {
+    const GVariantType* element_type = g_variant_type_element(type);
+
+    if (g_variant_type_equal(element_type, G_VARIANT_TYPE_BYTE)) {
+        GVariant* bytes;
+        if (!pack_byte_array(cx, value, &bytes))
+            return nullptr;
+        if (bytes)
+            return bytes;
+    }
+
+    if (!value.isObject())
+        return throw_expected(cx, type, "an object", value);
+
+    JS::RootedObject obj(cx, &value.toObject());
+    GjsAutoVariantBuilder builder = g_variant_builder_new(type);
+
+    if (g_variant_type_is_dict_entry(element_type)) {
+        // Dictionaries are packed from the object's own enumerable properties
+        JS::Rooted<JS::IdVector> ids(cx, cx);
+        if (!JS_Enumerate(cx, obj, &ids))
+            return nullptr;
+
+        JS::RootedValue key(cx), child(cx);
+        JS::RootedId id(cx);
+        for (size_t ix = 0; ix < ids.length(); ix++) {
+            id = ids[ix];
+            if (!JS_IdToValue(cx, id, &key))
+                return nullptr;
+            // Integer property names are packed as strings too
+            JSString* key_str = JS::ToString(cx, key);
+            if (!key_str)
+                return nullptr;
+            key.setString(key_str);
+
+            if (!JS_GetPropertyById(cx, obj, id, &child))
+                return nullptr;
+            GVariant* entry = pack_dict_entry(cx, element_type, key, child);
+            if (!entry)
+                return nullptr;
+            g_variant_builder_add_value(builder, entry);
+        }
+
+        return g_variant_builder_end(builder);
+    }
+
+    uint32_t length;
+    if (!JS::GetArrayLength(cx, obj, &length))
+        return nullptr;
+
+    JS::RootedValue elem(cx);
+    for (uint32_t ix = 0; ix < length; ix++) {
+        if (!JS_GetElement(cx, obj, ix, &elem))
+            return nullptr;
+        GVariant* child = pack_variant(cx, element_type, elem);
+        if (!child)
+            return nullptr;
+        g_variant_builder_add_value(builder, child);
+    }
+
+    return g_variant_builder_end(builder);
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static GVariant* pack_tuple(JSContext* cx, const GVariantType* type,
+                            JS::HandleValue value) {
+    if (!value.isObject())
+        return throw_expected(cx, type, "an array", value);
+
+    JS::RootedObject obj(cx, &value.toObject());
+    uint32_t length;
+    if (!JS::GetArrayLength(cx, obj, &length))
+        return nullptr;
+
+    // Extra elements are ignored, as they always have been
+    size_t n_items = g_variant_type_n_items(type);
+    if (length < n_items) {
+        GjsAutoChar type_string = g_variant_type_dup_string(type);
+        gjs_throw_custom(cx, JSProto_TypeError, nullptr,
+                         "Expected %zu elements for GVariant type '%s', got %u",
+                         n_items, type_string.get(), length);
+        return nullptr;
+    }
+
+    if (g_variant_type_is_dict_entry(type)) {
+        JS::RootedValue key(cx), child(cx);
+        if (!JS_GetElement(cx, obj, 0, &key) ||
+            !JS_GetElement(cx, obj, 1, &child))
+            return nullptr;
+        return pack_dict_entry(cx, type, key, child);
+    }
+
+    GjsAutoVariantBuilder builder = g_variant_builder_new(type);
+    JS::RootedValue elem(cx);
+    uint32_t ix = 0;
+    for (const GVariantType* member_type = g_variant_type_first(type);
+         member_type; member_type = g_variant_type_next(member_type), ix++) {
+        if (!JS_GetElement(cx, obj, ix, &elem))
+            return nullptr;
+        GVariant* child = pack_variant(cx, member_type, elem);
+        if (!child)
+            return nullptr;
+        g_variant_builder_add_value(builder, child);
+    }
+
+    return g_variant_builder_end(builder);
+}
+
+// Returns a new floating reference. Numbers are converted with the same rules
+// and range checks as integer arguments to introspected functions.
+GJS_JSAPI_RETURN_CONVENTION
+static GVariant* pack_variant(JSContext* cx, const GVariantType* type,
+                              JS::HandleValue value) {
+    switch (type_char(type)) {
+        case 'b':
+            return g_variant_new_boolean(JS::ToBoolean(value));
+        case 'y': {
+            uint32_t i;
+            if (!JS::ToUint32(cx, value, &i))
+                return nullptr;
+            if (i > G_MAXUINT8)
+                return throw_out_of_range(cx, type);
+            return g_variant_new_byte(i);
+        }
+        case 'n': {
+            int32_t i;
+            if (!JS::ToInt32(cx, value, &i))
+                return nullptr;
+            if (i > G_MAXINT16 || i < G_MININT16)
+                return throw_out_of_range(cx, type);
+            return g_variant_new_int16(i);
+        }
+        case 'q': {
+            uint32_t i;
+            if (!JS::ToUint32(cx, value, &i))
+                return nullptr;
+            if (i > G_MAXUINT16)
+                return throw_out_of_range(cx, type);
+            return g_variant_new_uint16(i);
+        }
+        case 'i': {
+            int32_t i;
+            if (!JS::ToInt32(cx, value, &i))
+                return nullptr;
+            return g_variant_new_int32(i);
+        }
+        case 'u': {
+            double d;
+            if (!JS::ToNumber(cx, value, &d))
+                return nullptr;
+            // Also false for NaN, which can't be converted
+            if (!(d >= 0 && d < 0x1p32))
+                return throw_out_of_range(cx, type);
+            return g_variant_new_uint32(static_cast<uint32_t>(d));
+        }
+        case 'x': {
+            double d;
+            if (!JS::ToNumber(cx, value, &d))
+                return nullptr;
+            // G_MAXINT64 rounds up to 2^63 as a double, which is out of range
+            if (!(d >= -0x1p63 && d < 0x1p63))
+                return throw_out_of_range(cx, type);
+            return g_variant_new_int64(static_cast<int64_t>(d));
+        }
+        case 't': {
+            double d;
+            if (!JS::ToNumber(cx, value, &d))
+                return nullptr;
+            if (!(d >= 0 && d < 0x1p64))
+                return throw_out_of_range(cx, type);
+            return g_variant_new_uint64(static_cast<uint64_t>(d));
+        }
+        case 'h': {
+            int32_t i;
+            if (!JS::ToInt32(cx, value, &i))
+                return nullptr;
+            return g_variant_new_handle(i);
+        }
+        case 'd': {
+            double d;
+            if (!JS::ToNumber(cx, value, &d))
+                return nullptr;
+            return g_variant_new_double(d);
+        }
+        case 's':
+        case 'o':
+        case 'g':
+            return pack_string(cx, type, value);
+        case 'v':
+            return pack_boxed_variant(cx, type, value);
+        case 'm': {
+            const GVariantType* element_type = g_variant_type_element(type);
+            if (value.isNull())
+                return g_variant_new_maybe(element_type, nullptr);
+            GVariant* child = pack_variant(cx, element_type, value);
+            if (!child)
+                return nullptr;
+            return g_variant_new_maybe(nullptr, child);
+        }
+        case 'a':
+            return pack_array(cx, type, value);
+        case '(':
+        case '{':
+            return pack_tuple(cx, type, value);
+        default:
+            break;
+    }
+
+    g_assert_not_reached();
+    return nullptr;
+}
+
+bool gjs_variant_pack(JSContext* cx, const char* signature,
+                      JS::HandleValue value, JS::MutableHandleValue variant_p) {
+    const char* end;
+    if (!*signature) {
+        gjs_throw_custom(cx, JSProto_TypeError, nullptr,
+                         "GVariant signature cannot be empty");
+        return false;
+    }
+    if (!g_variant_type_string_scan(signature, nullptr, &end)) {
+        gjs_throw_custom(cx, JSProto_TypeError, nullptr,
+                         "Invalid GVariant signature '%s'", signature);
+        return false;
+    }
+    if (*end) {
+        gjs_throw_custom(
+            cx, JSProto_TypeError, nullptr,
+            "Invalid GVariant signature (more than one single complete type)");
+        return false;
+    }
+
+    const GVariantType* type = G_VARIANT_TYPE(signature);
+    if (!g_variant_type_is_definite(type)) {
+        gjs_throw_custom(cx, JSProto_TypeError, nullptr,
+                         "Invalid GVariant signature '%s' (a definite type was "
+                         "expected)",
+                         signature);
+        return false;
+    }
+
+    GjsAutoVariant variant = sink(pack_variant(cx, type, value));
+    if (!variant)
+        return false;
+
+    GjsAutoStructInfo info =
+        g_irepository_find_by_gtype(nullptr, G_TYPE_VARIANT);
+    JSObject* obj = BoxedInstance::new_for_c_struct(cx, info, variant);
+    if (!obj)
+        return false;
+
+    variant_p.setObject(*obj);
+    return true;
+}
+
+class VariantUnpacker {
+    JSContext* m_cx;
+    bool m_recursive;
+    // GLib.Variant, looked up the first time a child is left packed
+    GjsAutoStructInfo m_info;
+
+    GJS_JSAPI_RETURN_CONVENTION
+    bool wrap(GVariant* variant, JS::MutableHandleValue value_p) {
+        if (!m_info)
+            m_info.reset(g_irepository_find_by_gtype(nullptr, G_TYPE_VARIANT));
+
+        JSObject* obj = BoxedInstance::new_for_c_struct(m_cx, m_info, variant);
+        if (!obj)
+            return false;
+
+        value_p.setObject(*obj);
+        return true;
+    }
+
+    GJS_JSAPI_RETURN_CONVENTION
+    bool child(GVariant* variant, bool deep, JS::MutableHandleValue value_p) {
+        return deep ? unpack(variant, deep, value_p) : wrap(variant, value_p);
+    }
+
+    // Deeply unpacks arrays of fixed-size numbers straight from the serialized
+    // data, without creating a GVariant for each element
+    template <typename T>
+    GJS_JSAPI_RETURN_CONVENTION bool fixed_array(
+        GVariant* variant, JS::MutableHandleValue value_p) {
+        size_t n_elements;
+        auto* data = static_cast<const T*>(
+            g_variant_get_fixed_array(variant, &n_elements, sizeof(T)));
+
+        JS::RootedValueVector elems(m_cx);
+        if (!elems.reserve(n_elements)) {
+            JS_ReportOutOfMemory(m_cx);
+            return false;
+        }
+        for (size_t ix = 0; ix < n_elements; ix++)
+            elems.infallibleAppend(JS::NumberValue(static_cast<double>(data[ix])));
+
+        JSObject* array = JS::NewArrayObject(m_cx, elems);
+        if (!array)
+            return false;
+
+        value_p.setObject(*array);
+        return true;
+    }
+
+    GJS_JSAPI_RETURN_CONVENTION
+    bool dict(GVariant* variant, bool deep, JS::MutableHandleValue value_p) {
+        JS::RootedObject obj(m_cx, JS_NewPlainObject(m_cx));
+        if (!obj)
+            return false;
+
+        JS::RootedValue key(m_cx), value(m_cx);
+        JS::RootedId id(m_cx);
+        size_t n_children = g_variant_n_children(variant);
+        for (size_t ix = 0; ix < n_children; ix++) {
+            GjsAutoVariant entry = g_variant_get_child_value(variant, ix);
+            GjsAutoVariant key_variant = g_variant_get_child_value(entry, 0);
+            GjsAutoVariant value_variant = g_variant_get_child_value(entry, 1);
+
+            // Always unpack the key, or it cannot be used as a property name
+            if (!unpack(key_variant, true, &key) ||
+                !child(value_variant, deep, &value) ||
+                !JS_ValueToId(m_cx, key, &id) ||
+                !JS_DefinePropertyById(m_cx, obj, id, value, JSPROP_ENUMERATE))
+                return false;
+        }
+
+        value_p.setObject(*obj);
+        return true;
+    }
+
+    GJS_JSAPI_RETURN_CONVENTION
+    bool children(GVariant* variant, bool deep,
+                  JS::MutableHandleValue value_p) {
+        size_t n_children = g_variant_n_children(variant);
+        JS::RootedValueVector elems(m_cx);
+        if (!elems.resize(n_children)) {
+            JS_ReportOutOfMemory(m_cx);
+            return false;
+        }
+
+        for (size_t ix = 0; ix < n_children; ix++) {
+            GjsAutoVariant child_variant =
+                g_variant_get_child_value(variant, ix);
+            if (!child(child_variant, deep, elems[ix]))
+                return false;
+        }
+
+        JSObject* array = JS::NewArrayObject(m_cx, elems);
+        if (!array)
+            return false;
+
+        value_p.setObject(*array);
+        return true;
+    }
+
+    GJS_JSAPI_RETURN_CONVENTION
+    bool array(GVariant* variant, bool deep, JS::MutableHandleValue value_p) {
+        const GVariantType* element_type =
+            g_variant_type_element(g_variant_get_type(variant));
+
+        if (g_variant_type_is_dict_entry(element_type))
+            return dict(variant, deep, value_p);
+
+        if (g_variant_type_equal(element_type, G_VARIANT_TYPE_BYTE)) {
+            GjsAutoBytes bytes = g_variant_get_data_as_bytes(variant);
+            JSObject* array = gjs_byte_array_from_gbytes(m_cx, bytes);
+            if (!array)
+                return false;
+            value_p.setObject(*array);
+            return true;
+        }
+
+        if (deep) {
+            switch (type_char(element_type)) {
+                case 'n':
+                    return fixed_array<int16_t>(variant, value_p);
+                case 'q':
+                    return fixed_array<uint16_t>(variant, value_p);
+                case 'i':
+                case 'h':
+                    return fixed_array<int32_t>(variant, value_p);
+                case 'u':
+                    return fixed_array<uint32_t>(variant, value_p);
+                case 'd':
+                    return fixed_array<double>(variant, value_p);
+                default:
+                    break;
+            }
+        }
+
+        return children(variant, deep, value_p);
+    }
+
+ public:
+    VariantUnpacker(JSContext* cx, bool recursive)
+        : m_cx(cx), m_recursive(recursive) {}
+
+    GJS_JSAPI_RETURN_CONVENTION
+    bool unpack(GVariant* variant, bool deep, JS::MutableHandleValue value_p) {
+        GIArgument arg;
+
+        switch (g_variant_classify(variant)) {
+            case G_VARIANT_CLASS_BOOLEAN:
+                value_p.setBoolean(g_variant_get_boolean(variant));
+                return true;
+            case G_VARIANT_CLASS_BYTE:
+                value_p.setInt32(g_variant_get_byte(variant));
+                return true;
+            case G_VARIANT_CLASS_INT16:
+                value_p.setInt32(g_variant_get_int16(variant));
+                return true;
+            case G_VARIANT_CLASS_UINT16:
+                value_p.setInt32(g_variant_get_uint16(variant));
+                return true;
+            case G_VARIANT_CLASS_INT32:
+                value_p.setInt32(g_variant_get_int32(variant));
+                return true;
+            case G_VARIANT_CLASS_UINT32:
+                value_p.setNumber(g_variant_get_uint32(variant));
+                return true;
+            case G_VARIANT_CLASS_INT64:
+                gjs_arg_set<int64_t>(&arg, g_variant_get_int64(variant));
+                value_p.setNumber(gjs_arg_get_maybe_rounded<int64_t>(&arg));
+                return true;
+            case G_VARIANT_CLASS_UINT64:
+                gjs_arg_set<uint64_t>(&arg, g_variant_get_uint64(variant));
+                value_p.setNumber(gjs_arg_get_maybe_rounded<uint64_t>(&arg));
+                return true;
+            case G_VARIANT_CLASS_HANDLE:
+                value_p.setInt32(g_variant_get_handle(variant));
+                return true;
+            case G_VARIANT_CLASS_DOUBLE:
+                value_p.setNumber(g_variant_get_double(variant));
+                return true;
+            case G_VARIANT_CLASS_STRING:
+            case G_VARIANT_CLASS_OBJECT_PATH:
+            case G_VARIANT_CLASS_SIGNATURE:
+                return gjs_string_from_utf8(
+                    m_cx, g_variant_get_string(variant, nullptr), value_p);
+            case G_VARIANT_CLASS_VARIANT: {
+                GjsAutoVariant inner = g_variant_get_variant(variant);
+                return child(inner, deep && m_recursive, value_p);
+            }
+            case G_VARIANT_CLASS_MAYBE: {
+                GjsAutoVariant inner = g_variant_get_maybe(variant);
+                if (!inner) {
+                    value_p.setNull();
+                    return true;
+                }
+                return child(inner, deep, value_p);
+            }
+            case G_VARIANT_CLASS_ARRAY:
+                return array(variant, deep, value_p);
+            case G_VARIANT_CLASS_TUPLE:
+            case G_VARIANT_CLASS_DICT_ENTRY:
+                return children(variant, deep, value_p);
+        }
+
+        g_assert_not_reached();
+        return false;
+    }
+};
+
+bool gjs_variant_unpack(JSContext* cx, GVariant* variant, bool deep,
+                        bool recursive, JS::MutableHandleValue value_p) {
+    VariantUnpacker unpacker(cx, recursive);
+    return unpacker.unpack(variant, deep, value_p);
+}
+
+bool gjs_variant_to_typed_array(JSContext* cx, GVariant* variant,
+                                JS::MutableHandleValue value_p) {
+    using NewTypedArray = JSObject* (*)(JSContext*, JS::HandleObject array,
+                                        uint32_t byte_offset, int32_t length);
+    NewTypedArray new_typed_array = nullptr;
+    size_t element_size = 0;
+
+    const GVariantType* type = g_variant_get_type(variant);
+    if (g_variant_type_is_array(type)) {
+        switch (type_char(g_variant_type_element(type))) {
+            case 'y':
+                new_typed_array = JS_NewUint8ArrayWithBuffer;
+                element_size = 1;
+                break;
+            case 'n':
+                new_typed_array = JS_NewInt16ArrayWithBuffer;
+                element_size = 2;
+                break;
+            case 'q':
+                new_typed_array = JS_NewUint16ArrayWithBuffer;
+                element_size = 2;
+                break;
+            case 'i':
+            case 'h':
+                new_typed_array = JS_NewInt32ArrayWithBuffer;
+                element_size = 4;
+                break;
+            case 'u':
+                new_typed_array = JS_NewUint32ArrayWithBuffer;
+                element_size = 4;
+                break;
+            case 'd':
+                new_typed_array = JS_NewFloat64ArrayWithBuffer;
+                element_size = 8;
+                break;
+            default:
+                break;
+        }
+    }
+
+    if (!new_typed_array) {
+        gjs_throw_custom(cx, JSProto_TypeError, nullptr,
+                         "Variant of type '%s' is not an array of fixed-size "
+                         "numbers",
+                         g_variant_get_type_string(variant));
+        return false;
+    }
+
+    // A GVariant is immutable and may be shared with other code, even on
+    // other threads, so the typed array gets a copy of the elements: in one
+    // block, rather than element by element
+    size_t n_elements;
+    const void* elements =
+        g_variant_get_fixed_array(variant, &n_elements, element_size);
+    size_t size = n_elements * element_size;
+
+    JS::RootedObject array_buffer(cx);
+    if (size > 0)
+        array_buffer = JS::NewArrayBufferWithContents(
+            cx, size, g_memdup(elements, size));
+    else
+        array_buffer = JS::NewArrayBuffer(cx, 0);
+    if (!array_buffer)
+        return false;
+
+    JSObject* array = new_typed_array(cx, array_buffer, 0, -1);
+    if (!array)
+        return false;
+
+    value_p.setObject(*array);
+    return true;
+}
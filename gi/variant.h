@@ -0,0 +1,37 @@
+/* -*- mode: C++; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * SPDX-License-Identifier: MIT OR LGPL-2.0-or-later
+ */
+
+#ifndef GI_VARIANT_H_
+#define GI_VARIANT_H_
+
+#include <config.h>
+
+#include <glib.h>
+
+#include <js/TypeDecls.h>
+
+#include "cjs/macros.h"
+
+// Converts @value to a new GLib.Variant of type @signature, which must be a
+// single complete definite type, the same way as new GLib.Variant() does.
+GJS_JSAPI_RETURN_CONVENTION
+bool gjs_variant_pack(JSContext* cx, const char* signature,
+                      JS::HandleValue value, JS::MutableHandleValue variant_p);
+
+// Converts @variant to a JS value the same way as GLib.Variant.unpack(), or as
+// deepUnpack() if @deep is set, or as recursiveUnpack() if @recursive is also
+// set. Children that are not unpacked are returned as GLib.Variant wrappers.
+GJS_JSAPI_RETURN_CONVENTION
+bool gjs_variant_unpack(JSContext* cx, GVariant* variant, bool deep,
+                        bool recursive, JS::MutableHandleValue value_p);
+
+// Converts @variant, which must be an array of fixed-size numbers, to a typed
+// array of the matching type, sharing the variant's data where possible. See
+// GLib.Variant.toTypedArray().
+GJS_JSAPI_RETURN_CONVENTION
+bool gjs_variant_to_typed_array(JSContext* cx, GVariant* variant,
+                                JS::MutableHandleValue value_p);
+
+#endif  // GI_VARIANT_H_
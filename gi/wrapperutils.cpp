@@ -26,6 +26,7 @@
 #include <girepository.h>
 #include <glib-object.h>
 
+#include <js/GCVector.h>
 #include <js/PropertyDescriptor.h>  // for JSPROP_PERMANENT
 #include <js/TypeDecls.h>
 #include <jsapi.h>  // for JS_DefinePropertyById
@@ -104,6 +105,30 @@ bool gjs_wrapper_define_gtype_prop(JSContext* cx, JS::HandleObject constructor,
                                  JSPROP_PERMANENT);
 }
 
+bool GjsEnumeratedIds::append_to(JSContext* cx,
+                                 JS::MutableHandleIdVector properties) const {
+    if (!properties.reserve(properties.length() + m_ids.length())) {
+        JS_ReportOutOfMemory(cx);
+        return false;
+    }
+    for (const JS::Heap<jsid>& id : m_ids)
+        properties.infallibleAppend(id.get());
+    return true;
+}
+
+bool GjsEnumeratedIds::store(JSContext* cx, JS::HandleIdVector properties,
+                             size_t start) {
+    g_assert(start <= properties.length());
+    if (!m_ids.reserve(properties.length() - start)) {
+        JS_ReportOutOfMemory(cx);
+        return false;
+    }
+    for (size_t ix = start; ix < properties.length(); ix++)
+        m_ids.infallibleAppend(properties[ix]);
+    m_valid = true;
+    return true;
+}
+
 // These policies work around having separate g_foo_info_get_n_methods() and
 // g_foo_info_get_method() functions for different GIInfoTypes. It's not
 // possible to use GIFooInfo* as the template parameter, because the GIFooInfo
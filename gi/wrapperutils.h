@@ -38,6 +38,7 @@
 
 #include <js/CallArgs.h>
 #include <js/ComparisonOperators.h>
+#include <js/GCVector.h>
 #include <js/Id.h>
 #include <js/MemoryFunctions.h>
 #include <js/RootingAPI.h>
@@ -52,6 +53,7 @@
 #include "cjs/jsapi-class.h"  // IWYU pragma: keep
 #include "cjs/jsapi-util.h"
 #include "cjs/macros.h"
+#include "cjs/slab-allocator.h"
 #include "util/log.h"
 
 struct JSFunctionSpec;
@@ -80,10 +82,42 @@ enum Tag { Enum, Interface, Object, Struct, Union };
 
 namespace MemoryUse {
 constexpr JS::MemoryUse GObjectInstanceStruct = JS::MemoryUse::Embedding1;
+constexpr JS::MemoryUse BoxedStruct = JS::MemoryUse::Embedding2;
 }
 
 struct GjsTypecheckNoThrow {};
 
+/*
+ * GjsEnumeratedIds:
+ *
+ * The ids that a prototype's new_enumerate_impl() listed the first time it was
+ * called, kept so that enumerating the prototype again copies them instead of
+ * walking the introspection info. The ids are pinned atoms.
+ */
+class GjsEnumeratedIds {
+    JS::GCVector<JS::Heap<jsid>, 0, js::SystemAllocPolicy> m_ids;
+    bool m_valid = false;
+
+ public:
+    [[nodiscard]] bool valid() const { return m_valid; }
+
+    GJS_JSAPI_RETURN_CONVENTION
+    bool append_to(JSContext* cx, JS::MutableHandleIdVector properties) const;
+
+    // Stores the ids from index @start of @properties
+    GJS_JSAPI_RETURN_CONVENTION
+    bool store(JSContext* cx, JS::HandleIdVector properties, size_t start);
+
+    void clear() {
+        m_ids.clearAndFree();
+        m_valid = false;
+    }
+    void trace(JSTracer* trc) { m_ids.trace(trc); }
+    [[nodiscard]] size_t size() const {
+        return m_ids.capacity() * sizeof(JS::Heap<jsid>);
+    }
+};
+
 /*
  * gjs_define_static_methods:
  *
@@ -180,6 +214,17 @@ class GIWrapperBase {
             JS_GetInstancePrivate(cx, wrapper, &Base::klass, nullptr));
     }
 
+    /*
+     * GIWrapperBase::is_constructor:
+     *
+     * Checks if the given object is the constructor of a class of this kind.
+     * Such constructors keep their GType in a reserved slot, see
+     * gjs_dynamic_class_get_gtype().
+     */
+    [[nodiscard]] static bool is_constructor(JSObject* obj) {
+        return JS_IsNativeFunction(obj, &Base::constructor);
+    }
+
     /*
      * GIWrapperBase::check_jsclass:
      *
@@ -942,6 +987,9 @@ class GIWrapperPrototype : public Base {
         // might be traced and we would end up dereferencing a null pointer.
         JS_SetPrivate(prototype, priv);
 
+        // The constructor also keeps the GType in a reserved slot, which is
+        // quicker to read; see is_constructor()
+        gjs_dynamic_class_set_gtype(constructor, gtype);
         if (!gjs_wrapper_define_gtype_prop(cx, constructor, gtype))
             return nullptr;
 
@@ -1041,18 +1089,28 @@ class GIWrapperInstance : public Base {
     }
     ~GIWrapperInstance(void) { Base::m_proto->release(); }
 
+    // Override to true in Instance if its JSClass has
+    // JSCLASS_FOREGROUND_FINALIZE, to allocate instances from a per-type slab
+    // rather than the slice allocator; see slab-allocator.h.
+    static constexpr bool use_slab_allocator = false;
+
  public:
     /*
      * GIWrapperInstance::new_for_js_object:
      *
      * Creates a GIWrapperInstance and associates it with @obj as its private
-     * data. This is called by the JS constructor. Uses the slice allocator.
+     * data. This is called by the JS constructor. Uses the slab allocator if
+     * the Instance type opts in, and the slice allocator otherwise.
      */
     [[nodiscard]] static Instance* new_for_js_object(JSContext* cx,
                                                      JS::HandleObject obj) {
         g_assert(!JS_GetPrivate(obj));
-        auto* priv = g_slice_new0(Instance);
-        new (priv) Instance(cx, obj);
+        void* mem;
+        if constexpr (Instance::use_slab_allocator)
+            mem = GjsSlabAllocator<Instance>::get().alloc();
+        else
+            mem = g_slice_new0(Instance);
+        auto* priv = new (mem) Instance(cx, obj);
 
         // Init the private variable before we do anything else. If a garbage
         // collection happens when calling the constructor, then this object
@@ -1091,8 +1149,12 @@ class GIWrapperInstance : public Base {
 
  protected:
     void finalize_impl(JSFreeOp*, JSObject*) {
-        static_cast<Instance*>(this)->~Instance();
-        g_slice_free(Instance, this);
+        auto* self = static_cast<Instance*>(this);
+        self->~Instance();
+        if constexpr (Instance::use_slab_allocator)
+            GjsSlabAllocator<Instance>::get().free(self);
+        else
+            g_slice_free(Instance, self);
     }
 
     // Override if necessary
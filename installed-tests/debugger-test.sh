@@ -11,7 +11,12 @@ echo 1..1
 DEBUGGER_SCRIPT="$1"
 JS_SCRIPT="$1.js"
 EXPECTED_OUTPUT="$1.output"
-THE_DIFF=$("$gjs" -d "$JS_SCRIPT" < "$DEBUGGER_SCRIPT" | sed \
+# Tests can give other options than -d to start the debugger with
+DEBUGGER_ARGS=-d
+if test -f "$1.args"; then
+    DEBUGGER_ARGS=$(cat "$1.args")
+fi
+THE_DIFF=$("$gjs" $DEBUGGER_ARGS "$JS_SCRIPT" < "$DEBUGGER_SCRIPT" | sed \
     -e "s#$1#$(basename $1)#g" \
     -e "s/0x[0-9a-f]\{4,16\}/0xADDR/g" \
     | diff -u "$EXPECTED_OUTPUT" -)
@@ -0,0 +1,9 @@
+print('1');
+print('2');
+function foo() {
+    print('Function foo');
+}
+print('3');
+foo();
+debugger;
+print('4');
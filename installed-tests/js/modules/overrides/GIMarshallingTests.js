@@ -1,6 +1,23 @@
+// Resolved before the class overrides below are registered
+const {OverridesStruct} = imports.gi.GIMarshallingTests;
+
+var _classOverrides = {
+    OverridesStruct(klass) {
+        klass.prototype.classOverridden = true;
+    },
+
+    OverridesObject(klass) {
+        klass.prototype.classOverridden = true;
+    },
+};
+
 function _init() {
     const GIMarshallingTests = this;
 
+    GIMarshallingTests.CLASS_OVERRIDES_BEFORE_INIT = [
+        OverridesStruct.prototype.classOverridden,
+        GIMarshallingTests.OverridesObject.prototype.classOverridden,
+    ];
     GIMarshallingTests.OVERRIDES_CONSTANT = 7;
 
     GIMarshallingTests.OverridesStruct.prototype._real_method =
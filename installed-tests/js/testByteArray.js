@@ -70,6 +70,31 @@ describe('Byte array', function () {
         expect(() => ByteArray.toGBytes(a)).toThrow();
     });
 
+    it('can allocate a pinned array that shares its memory with GBytes', function () {
+        const a = ByteArray.allocatePinned(4);
+        expect(a.length).toEqual(4);
+        expect(a).toEqual(Uint8Array.of(0, 0, 0, 0));
+        a.set([97, 98, 99, 100]);
+        const bytes = ByteArray.toGBytes(a);
+        expect(bytes.get_size()).toEqual(4);
+        expect(ByteArray.toString(bytes.toArray())).toEqual('abcd');
+        a[0] = 65;
+        expect(bytes.toArray()[0]).toEqual(65);
+    });
+
+    it('shares memory through arrays over parts of a GBytes', function () {
+        const pinned = ByteArray.allocatePinned(8);
+        const first = ByteArray.fromGBytes(ByteArray.toGBytes(pinned.subarray(0, 4)));
+        const last = ByteArray.fromGBytes(ByteArray.toGBytes(pinned.subarray(2, 8)));
+        const inner = ByteArray.toGBytes(first.subarray(1, 3));
+        const across = ByteArray.toGBytes(last.subarray(0, 6));
+        const outer = ByteArray.toGBytes(pinned.subarray(1, 7));
+        pinned.set([1, 2, 3, 4, 5, 6, 7, 8]);
+        expect(Array.from(inner.toArray())).toEqual([2, 3]);
+        expect(Array.from(across.toArray())).toEqual([3, 4, 5, 6, 7, 8]);
+        expect(Array.from(outer.toArray())).toEqual([2, 3, 4, 5, 6, 7]);
+    });
+
     describe('legacy toString() behavior', function () {
         beforeEach(function () {
             GLib.test_expect_message('Cjs', GLib.LogLevelFlags.LEVEL_WARNING,
@@ -92,3 +117,41 @@ describe('Byte array', function () {
         });
     });
 });
+
+describe('JSON bytes', function () {
+    const value = {name: '⅜ cup', list: [1, 2.5, null, true], nested: {empty: ''}};
+
+    it('parses UTF-8 JSON from a Uint8Array', function () {
+        const bytes = ByteArray.fromString(JSON.stringify(value));
+        expect(JSON.parseBytes(bytes)).toEqual(value);
+    });
+
+    it('parses UTF-8 JSON from a GLib.Bytes', function () {
+        const bytes = ByteArray.toGBytes(ByteArray.fromString(JSON.stringify(value)));
+        expect(JSON.parseBytes(bytes)).toEqual(value);
+    });
+
+    it('throws on invalid JSON or UTF-8', function () {
+        expect(() => JSON.parseBytes(ByteArray.fromString('{'))).toThrowError(SyntaxError);
+        expect(() => JSON.parseBytes(Uint8Array.from([0x22, 0xff, 0x22]))).toThrow();
+        expect(() => JSON.parseBytes(Uint8Array.from([0x31, 0]))).toThrow();
+        expect(() => JSON.parseBytes({})).toThrowError(TypeError);
+    });
+
+    it('throws a SyntaxError on empty text', function () {
+        expect(() => JSON.parseBytes(new Uint8Array(0))).toThrowError(SyntaxError);
+        expect(() => JSON.parseBytes(new GLib.Bytes([]))).toThrowError(SyntaxError);
+    });
+
+    it('stringifies to UTF-8', function () {
+        const bytes = JSON.stringifyToBytes(value, null, 2);
+        expect(bytes).toEqual(jasmine.any(Uint8Array));
+        expect(ByteArray.toString(bytes)).toEqual(JSON.stringify(value, null, 2));
+        expect(JSON.parseBytes(bytes)).toEqual(value);
+    });
+
+    it('stringifies with a replacer', function () {
+        const bytes = JSON.stringifyToBytes({a: 1, b: 2}, ['a']);
+        expect(ByteArray.toString(bytes)).toEqual('{"a":1}');
+    });
+});
@@ -2,7 +2,7 @@ imports.gi.versions.Gdk = '3.0';
 imports.gi.versions.Gtk = '3.0';
 
 const Cairo = imports.cairo;
-const {Gdk, GIMarshallingTests, GLib, Gtk, Regress} = imports.gi;
+const {Gdk, GIMarshallingTests, Gio, GLib, Gtk, Regress} = imports.gi;
 
 function _ts(obj) {
     return obj.toString().slice(8, -1);
@@ -161,6 +161,24 @@ describe('Cairo', function () {
             }).not.toThrow();
         });
 
+        it('can build a path from a buffer of commands', function () {
+            const {MOVE_TO, LINE_TO, CLOSE_PATH, RECTANGLE} = Cairo.PathOp;
+            cr.executePath(new Float64Array([
+                MOVE_TO, 1, 1,
+                LINE_TO, 5, 1,
+                LINE_TO, 5, 5,
+                CLOSE_PATH,
+                RECTANGLE, 10, 10, 2, 3,
+            ]));
+            expect(cr.pathExtents()).toEqual([1, 1, 12, 13]);
+        });
+
+        it('rejects a truncated buffer of path commands', function () {
+            expect(() => cr.executePath(new Float64Array([Cairo.PathOp.LINE_TO, 1])))
+                .toThrowError(/truncated/);
+            expect(cr.hasCurrentPoint()).toBeFalsy();
+        });
+
         it('has methods when created from a C function', function () {
             if (GLib.getenv('ENABLE_GTK') !== 'yes') {
                 pending('GTK disabled');
@@ -199,6 +217,25 @@ describe('Cairo', function () {
             cr.setSource(p2);
             expect(_ts(cr.getSource())).toEqual('SolidPattern');
         });
+
+        it('is shared between requests for the same color', function () {
+            const p1 = Cairo.SolidPattern.getCachedRGBA(0.5, 0.5, 0.5, 1);
+            expect(_ts(p1)).toEqual('SolidPattern');
+            expect(Cairo.SolidPattern.getCachedRGBA(0.5, 0.5, 0.5)).toBe(p1);
+            expect(Cairo.SolidPattern.getCachedRGBA(0.5, 0.5, 0.5, 0.5))
+                .not.toBe(p1);
+        });
+
+        it('forgets the least recently requested colors', function () {
+            const oldest = Cairo.SolidPattern.getCachedRGBA(0, 0, 0.25);
+            const recent = Cairo.SolidPattern.getCachedRGBA(0, 0, 0.75);
+            for (let i = 0; i < 63; i++) {
+                Cairo.SolidPattern.getCachedRGBA(i / 63, 1, 1);
+                Cairo.SolidPattern.getCachedRGBA(0, 0, 0.75);
+            }
+            expect(Cairo.SolidPattern.getCachedRGBA(0, 0, 0.75)).toBe(recent);
+            expect(Cairo.SolidPattern.getCachedRGBA(0, 0, 0.25)).not.toBe(oldest);
+        });
     });
 
     describe('surface pattern', function () {
@@ -219,6 +256,24 @@ describe('Cairo', function () {
         });
     });
 
+    describe('gradient color stops', function () {
+        it('can be added all at once', function () {
+            const gradient = new Cairo.LinearGradient(0, 0, 10, 0);
+            gradient.addColorStops(new Float64Array([
+                0, 1, 0, 0, 1,
+                1, 0, 0, 1, 1,
+            ]));
+            cr.setSource(gradient);
+            expect(() => cr.paint()).not.toThrow();
+        });
+
+        it('must come in groups of five numbers', function () {
+            const gradient = new Cairo.LinearGradient(0, 0, 10, 0);
+            expect(() => gradient.addColorStops(new Float64Array([0, 1, 0])))
+                .toThrowError(/five/);
+        });
+    });
+
     describe('radial gradient', function () {
         it('can be created and added as a source', function () {
             let p1 = new Cairo.RadialGradient(1, 2, 3, 4, 5, 6);
@@ -229,6 +284,36 @@ describe('Cairo', function () {
     });
 
     describe('path', function () {
+        it('exposes its data as path commands', function () {
+            const {MOVE_TO, LINE_TO, CURVE_TO} = Cairo.PathOp;
+            cr.moveTo(1, 2);
+            cr.lineTo(3, 4);
+            cr.curveTo(5, 6, 7, 8, 9, 10);
+            expect(Array.from(cr.copyPath().toCommands())).toEqual([
+                MOVE_TO, 1, 2,
+                LINE_TO, 3, 4,
+                CURVE_TO, 5, 6, 7, 8, 9, 10,
+            ]);
+        });
+
+        it('can be created from path commands', function () {
+            const {MOVE_TO, LINE_TO, CLOSE_PATH} = Cairo.PathOp;
+            const path = Cairo.Path.fromCommands(new Float64Array([
+                MOVE_TO, 1, 1,
+                LINE_TO, 4, 1,
+                LINE_TO, 4, 6,
+                CLOSE_PATH,
+            ]));
+            cr.appendPath(path);
+            expect(cr.pathExtents()).toEqual([1, 1, 4, 6]);
+        });
+
+        it('rejects commands that cannot occur in a path', function () {
+            expect(() => Cairo.Path.fromCommands(new Float64Array([
+                Cairo.PathOp.RECTANGLE, 0, 0, 1, 1,
+            ]))).toThrowError(/index 0/);
+        });
+
         it('has typechecks', function () {
             expect(() => cr.appendPath({})).toThrow();
             expect(() => cr.appendPath(surface)).toThrow();
@@ -243,6 +328,95 @@ describe('Cairo', function () {
         });
     });
 
+    describe('image surface', function () {
+        it('exposes its pixels without copying them', function () {
+            cr.setSourceRGBA(0, 0, 1, 1);
+            cr.paint();
+            const data = surface.getData();
+            expect(data.length).toEqual(surface.getStride() * 10);
+            expect(data[0]).toEqual(0xff);
+
+            data[0] = 0;
+            expect(surface.getData()[0]).toEqual(0);
+            surface.markDirty();
+        });
+
+        it('can be created over the memory of an ArrayBuffer', function () {
+            const stride = 4 * 2;
+            const buffer = new Uint8Array(stride * 3).fill(0xff).buffer;
+            const imageSurface = Cairo.ImageSurface.createForData(buffer,
+                Cairo.Format.ARGB32, 2, 3, stride);
+            expect(buffer.byteLength).toEqual(0);
+            expect(imageSurface.getWidth()).toEqual(2);
+            expect(imageSurface.getHeight()).toEqual(3);
+            expect(imageSurface.getData().every(byte => byte === 0xff))
+                .toBeTruthy();
+        });
+
+        it('can be encoded to and decoded from PNG in memory', function () {
+            const bytes = surface.toPNGBytes();
+            expect(bytes instanceof GLib.Bytes).toBeTruthy();
+            const decoded = Cairo.ImageSurface.createFromPNGBytes(bytes);
+            expect(decoded.getWidth()).toEqual(10);
+            expect(decoded.getHeight()).toEqual(10);
+        });
+
+        it('can be written as PNG to an output stream', function () {
+            const stream = Gio.MemoryOutputStream.new_resizable();
+            surface.writeToPNGStream(stream);
+            stream.close(null);
+            expect(stream.steal_as_bytes().compare(surface.toPNGBytes()))
+                .toEqual(0);
+        });
+
+        it('can be rendered from a command buffer in a thread', function (done) {
+            const commands = new Cairo.CommandBuffer();
+            commands.setSourceRGB(1, 0, 0);
+            commands.rectangle(0, 0, 2, 1);
+            commands.fill();
+            Cairo.ImageSurface.renderAsync(Cairo.Format.RGB24, 4, 2,
+                commands.toArray()).then(rendered => {
+                expect(rendered.getWidth()).toEqual(4);
+                expect(rendered.getHeight()).toEqual(2);
+                const data = new Uint32Array(rendered.getData().buffer);
+                expect(data[0] & 0xffffff).toEqual(0xff0000);
+                expect(data[2] & 0xffffff).toEqual(0);
+                done();
+            }).catch(fail);
+        });
+
+        it('checks the command buffer before rendering it', function () {
+            const {SET_LINE_CAP, FILL} = Cairo.DrawOp;
+            expect(() => Cairo.ImageSurface.renderAsync(Cairo.Format.ARGB32,
+                1, 1, new Float64Array([FILL, SET_LINE_CAP, 7])))
+                .toThrowError(/index 1/);
+            expect(() => new Cairo.CommandBuffer().moveTo(1))
+                .toThrowError(TypeError);
+        });
+
+        it('checks the size of the ArrayBuffer it is created over', function () {
+            expect(() => Cairo.ImageSurface.createForData(new ArrayBuffer(4),
+                Cairo.Format.ARGB32, 2, 3, 8)).toThrowError(/too small/);
+        });
+    });
+
+    describe('region', function () {
+        it('can be created from and converted to rectangles in bulk', function () {
+            const region = Cairo.Region.fromRectangles(new Int32Array([
+                0, 0, 2, 2,
+                5, 5, 1, 3,
+            ]));
+            expect(region.numRectangles()).toEqual(2);
+            expect(Array.from(region.getRectangles()))
+                .toEqual([0, 0, 2, 2, 5, 5, 1, 3]);
+        });
+
+        it('rejects a partial rectangle', function () {
+            expect(() => Cairo.Region.fromRectangles(new Int32Array([0, 0, 1])))
+                .toThrowError(/four/);
+        });
+    });
+
     describe('GI test suite', function () {
         describe('for context', function () {
             it('can be marshalled as a return value', function () {
@@ -0,0 +1,125 @@
+describe('TextEncoder', function () {
+    let encoder;
+
+    beforeEach(function () {
+        encoder = new TextEncoder();
+    });
+
+    it('encodes to UTF-8', function () {
+        expect(encoder.encoding).toEqual('utf-8');
+        expect(Array.from(encoder.encode('abc'))).toEqual([97, 98, 99]);
+        expect(Array.from(encoder.encode('⅜'))).toEqual([0xe2, 0x85, 0x9c]);
+        expect(Array.from(encoder.encode('ä'))).toEqual([0xc3, 0xa4]);
+    });
+
+    it('encodes an empty string', function () {
+        expect(encoder.encode().length).toEqual(0);
+        expect(encoder.encode('').length).toEqual(0);
+    });
+
+    it('keeps embedded null characters', function () {
+        expect(Array.from(encoder.encode('a\0b'))).toEqual([97, 0, 98]);
+    });
+
+    it('encodes lone surrogates as replacement characters', function () {
+        expect(Array.from(encoder.encode('\ud800'))).toEqual([0xef, 0xbf, 0xbd]);
+    });
+
+    it('encodes into an existing buffer', function () {
+        const buffer = new Uint8Array(4).fill(0xff);
+        const result = encoder.encodeInto('a⅜b', buffer);
+        expect(result).toEqual({read: 2, written: 4});
+        expect(Array.from(buffer)).toEqual([97, 0xe2, 0x85, 0x9c]);
+    });
+
+    it('does not write partial characters with encodeInto', function () {
+        const buffer = new Uint8Array(2).fill(0xff);
+        const result = encoder.encodeInto('a⅜', buffer);
+        expect(result).toEqual({read: 1, written: 1});
+        expect(Array.from(buffer)).toEqual([97, 0xff]);
+    });
+});
+
+describe('TextDecoder', function () {
+    it('decodes ASCII', function () {
+        const bytes = new Uint8Array(300).fill(97);
+        expect(new TextDecoder().decode(bytes)).toEqual('a'.repeat(300));
+    });
+
+    it('decodes UTF-8', function () {
+        const bytes = Uint8Array.from([0xe2, 0x85, 0x9c, 97, 0xc3, 0xa4]);
+        expect(new TextDecoder().decode(bytes)).toEqual('⅜aä');
+        expect(new TextDecoder().decode(bytes.buffer)).toEqual('⅜aä');
+    });
+
+    it('decodes nothing to an empty string', function () {
+        expect(new TextDecoder().decode()).toEqual('');
+    });
+
+    it('strips the BOM unless asked not to', function () {
+        const bytes = Uint8Array.from([0xef, 0xbb, 0xbf, 97]);
+        expect(new TextDecoder().decode(bytes)).toEqual('a');
+        expect(new TextDecoder('utf-8', {ignoreBOM: true}).decode(bytes))
+            .toEqual('\ufeffa');
+    });
+
+    it('replaces malformed input unless fatal', function () {
+        const bytes = Uint8Array.from([97, 0xff, 98]);
+        expect(new TextDecoder().decode(bytes)).toEqual('a\ufffdb');
+        expect(() => new TextDecoder('utf-8', {fatal: true}).decode(bytes))
+            .toThrowError(TypeError);
+    });
+
+    it('resolves encoding labels', function () {
+        expect(new TextDecoder(' UTF8 ').encoding).toEqual('utf-8');
+        expect(new TextDecoder('utf-16').encoding).toEqual('utf-16le');
+        expect(() => new TextDecoder('bogus')).toThrowError(RangeError);
+    });
+
+    it('decodes UTF-16', function () {
+        const bytes = Uint8Array.from([0xff, 0xfe, 97, 0, 0x1c, 0x21]);
+        expect(new TextDecoder('utf-16le').decode(bytes)).toEqual('a⅜');
+    });
+
+    it('decodes other encodings', function () {
+        const bytes = Uint8Array.from([228, 98]);
+        expect(new TextDecoder('iso-8859-1').decode(bytes)).toEqual('äb');
+    });
+});
+
+describe('TextDecoder in streaming mode', function () {
+    function decodeInChunks(decoder, bytes, chunkSize) {
+        let result = '';
+        for (let ix = 0; ix < bytes.length; ix += chunkSize)
+            result += decoder.decode(bytes.subarray(ix, ix + chunkSize), {stream: true});
+        return result + decoder.decode();
+    }
+
+    it('decodes UTF-8 characters split across chunks', function () {
+        const text = '\ufeffa⅜ä😀b';
+        const bytes = new TextEncoder().encode(text);
+        for (let chunkSize = 1; chunkSize <= 4; chunkSize++) {
+            expect(decodeInChunks(new TextDecoder(), bytes, chunkSize))
+                .toEqual(text.slice(1));
+        }
+    });
+
+    it('decodes UTF-16 characters split across chunks', function () {
+        const bytes = Uint8Array.from([0xff, 0xfe, 97, 0, 0x3d, 0xd8, 0x00, 0xde]);
+        for (let chunkSize = 1; chunkSize <= 3; chunkSize++) {
+            expect(decodeInChunks(new TextDecoder('utf-16le'), bytes, chunkSize))
+                .toEqual('a😀');
+        }
+    });
+
+    it('reports an incomplete character at the end of the stream', function () {
+        const decoder = new TextDecoder();
+        expect(decoder.decode(Uint8Array.from([97, 0xe2]), {stream: true}))
+            .toEqual('a');
+        expect(decoder.decode()).toEqual('\ufffd');
+
+        const fatalDecoder = new TextDecoder('utf-8', {fatal: true});
+        fatalDecoder.decode(Uint8Array.from([0xe2]), {stream: true});
+        expect(() => fatalDecoder.decode()).toThrowError(TypeError);
+    });
+});
@@ -200,4 +200,16 @@ describe('thrown GError', function () {
         expect(err.domain).toEqual(Gio.io_error_quark());
         expect(err.code).toEqual(Gio.IOErrorEnum.NOT_FOUND);
     });
+
+    it('has the stack from where it was thrown', function () {
+        expect(err.stack).toMatch(/testExceptions\.js/);
+        expect(err.fileName).toMatch(/testExceptions\.js$/);
+        expect(err.lineNumber).toBeGreaterThan(0);
+    });
+
+    it('can have its stack overwritten', function () {
+        err.stack = 'replaced';
+        expect(err.stack).toEqual('replaced');
+        expect(err.lineNumber).toBeGreaterThan(0);
+    });
 });
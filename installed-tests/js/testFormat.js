@@ -54,6 +54,27 @@ describe('imports.format', function () {
         expect(() => '%Ix'.format(42)).toThrow();
     });
 
+    it('rounds ties away from zero like toFixed()', function () {
+        expect('%.0f %.1f %.2f'.format(2.5, -0.25, 1.005)).toEqual('3 -0.3 1.00');
+    });
+
+    it('pads to the length of the string in UTF-16 code units', function () {
+        expect('%3s|%3s'.format('é', '\u{1f600}')).toEqual('  é| \u{1f600}');
+    });
+
+    it('formats values that are not numbers or strings', function () {
+        expect('%s %d %x'.format(Symbol('foo'), '12px', 'ff')).toEqual('Symbol(foo) 12 NaN');
+    });
+
+    it('gives the same result when a format string is used again', function () {
+        for (let i = 0; i < 3; i++)
+            expect('%2$s-%1$03d'.format(i, 'x')).toEqual(`x-00${i}`);
+    });
+
+    it('leaves a % that does not start a conversion as it is', function () {
+        expect('100%'.format()).toEqual('100%');
+    });
+
     it('throws an error when incorrectly instructed to swap arguments', function () {
         expect(() => '%2$d %d %1$d'.format(1, 2, 3)).toThrow();
     });
@@ -323,6 +323,26 @@ describe('Exported DBus object', function () {
         loop.run();
     });
 
+    it('can send several remote method calls at once', function () {
+        let results;
+        Promise.all(proxy.callMany([
+            ['nonJsonFrobateStuff', 42],
+            ['noInParameter'],
+            ['multipleInArgs', 1, 2, 3, 4, 5],
+        ])).then(values => {
+            results = values;
+            loop.quit();
+        });
+        loop.run();
+
+        expect(results).toEqual([['42 it is!'], ['Yes!'], ['1 2 3 4 5']]);
+    });
+
+    it('rejects a batch with a wrong call before sending any of it', function () {
+        expect(() => proxy.callMany([['noInParameter'], ['nonJsonFrobateStuff']]))
+            .toThrowError(/Wrong number of arguments/);
+    });
+
     it('can call a remote method when not using makeProxyWrapper', function () {
         let info = Gio.DBusNodeInfo.new_for_xml(TestIface);
         let iface = info.interfaces[0];
@@ -658,4 +678,28 @@ describe('Exported DBus object', function () {
 
         expect(proxy.PropReadOnly).toBe(PROP_READ_ONLY_INITIAL_VALUE);
     });
+
+    it('sends queued property changes once with the latest value', function () {
+        let changes = [];
+        const id = proxy.connect('g-properties-changed', (proxy_, changed) => {
+            changes.push(changed.recursiveUnpack());
+            if (changes.length > 1)
+                return;
+            // Give any further emission a main loop turn to arrive
+            GLib.idle_add(GLib.PRIORITY_LOW, () => {
+                loop.quit();
+                return GLib.SOURCE_REMOVE;
+            });
+        });
+
+        for (const value of [1, 2, 3]) {
+            test._propReadWrite = value;
+            test._impl.queue_property_changed('PropReadWrite');
+        }
+        loop.run();
+        proxy.disconnect(id);
+
+        expect(changes.length).toEqual(1);
+        expect(changes).toEqual([{PropReadWrite: '3'}]);
+    });
 });
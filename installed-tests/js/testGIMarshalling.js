@@ -375,6 +375,48 @@ describe('C array with length', function () {
             .not.toThrow();
     });
 
+    it('marshals a typed array as an in parameter', function () {
+        expect(() => GIMarshallingTests.array_in(Int32Array.of(-1, 0, 1, 2)))
+            .not.toThrow();
+        expect(() => GIMarshallingTests.array_fixed_short_in(Int16Array.of(-1, 0, 1, 2)))
+            .not.toThrow();
+    });
+
+    it('marshals a mismatched typed array element by element', function () {
+        expect(() => GIMarshallingTests.array_in(Float64Array.of(-1, 0, 1, 2)))
+            .not.toThrow();
+    });
+
+    describe('with typed array returns enabled', function () {
+        const Gi = imports._gi;
+
+        beforeEach(function () {
+            Gi.set_typed_array_returns('GIMarshallingTests', true);
+        });
+
+        afterEach(function () {
+            Gi.set_typed_array_returns('GIMarshallingTests', false);
+        });
+
+        it('returns an Int32Array', function () {
+            const array = GIMarshallingTests.array_return();
+            expect(array).toEqual(jasmine.any(Int32Array));
+            expect(Array.from(array)).toEqual([-1, 0, 1, 2]);
+        });
+
+        it('still returns structs with padding one by one', function () {
+            expect(GIMarshallingTests.array_fixed_out_struct()).toEqual([
+                jasmine.objectContaining({long_: 7, int8: 6}),
+                jasmine.objectContaining({long_: 6, int8: 7}),
+            ]);
+        });
+    });
+
+    it('does not copy a typed array into structs with padding', function () {
+        expect(() => GIMarshallingTests.array_simple_struct_in(
+            Float64Array.of(1, 2, 3, 4))).toThrow();
+    });
+
     describe('of signed 64-bit ints', function () {
         testInParameter('array_int64', [-1, 0, 1, 2]);
     });
@@ -630,6 +672,22 @@ describe('GBytes', function () {
 
 describe('GStrv', function () {
     testSimpleMarshalling('gstrv', ['0', '1', '2'], ['-1', '0', '1', '2']);
+
+    it('converts non-ASCII strings in', function () {
+        const strv = ['a', 'ü', '日本', '😀'];
+        expect(GLib.strv_contains(strv, 'ü')).toBe(true);
+        expect(GLib.strv_contains(strv, '😀')).toBe(true);
+        expect(GLib.strv_contains(strv, 'u')).toBe(false);
+    });
+
+    it('converts large arrays in', function () {
+        const strv = Array.from({length: 5000}, (v, ix) => `class-${ix}`);
+        expect(GLib.strv_contains(strv, 'class-4999')).toBe(true);
+    });
+
+    it('throws on elements that are not strings', function () {
+        expect(() => GIMarshallingTests.gstrv_in(['0', 1, '2'])).toThrow();
+    });
 });
 
 ['GList', 'GSList'].forEach(listKind => {
@@ -652,6 +710,39 @@ describe('GStrv', function () {
             testContainerMarshalling(`${list}_utf8`, ['0', '1', '2'],
                 ['-2', '-1', '0', '1']);
         });
+
+        describe('with list iterator returns enabled', function () {
+            const Gi = imports._gi;
+
+            beforeEach(function () {
+                Gi.set_list_iterator_returns('GIMarshallingTests', true);
+            });
+
+            afterEach(function () {
+                Gi.set_list_iterator_returns('GIMarshallingTests', false);
+            });
+
+            it('returns an owned list as an iterator', function () {
+                const iter = GIMarshallingTests[`${list}_utf8_full_return`]();
+                expect(Array.from(iter)).toEqual(['0', '1', '2']);
+                expect(iter.next()).toEqual({value: undefined, done: true});
+            });
+
+            it('can stop iterating early', function () {
+                const seen = [];
+                for (const elem of GIMarshallingTests[`${list}_utf8_container_return`]()) {
+                    seen.push(elem);
+                    if (elem === '1')
+                        break;
+                }
+                expect(seen).toEqual(['0', '1']);
+            });
+
+            it('still returns an unowned list as an array', function () {
+                expect(GIMarshallingTests[`${list}_utf8_none_return`]())
+                    .toEqual(['0', '1', '2']);
+            });
+        });
     });
 });
 
@@ -689,6 +780,59 @@ describe('GHashTable', function () {
         testContainerMarshalling('ghashtable_utf8', stringDict, stringDictOut);
     });
 
+    describe('from Map objects', function () {
+        it('converts integer keys without stringifying them', function () {
+            const map = new Map([[-1, 1], [0, 0], [1, -1], [2, -2]]);
+            expect(() => GIMarshallingTests.ghashtable_int_none_in(map))
+                .not.toThrow();
+        });
+
+        it('converts number keys to string keys', function () {
+            const map = new Map([[-1, '1'], [0, '0'], [1, '-1'], [2, '-2']]);
+            expect(() => GIMarshallingTests.ghashtable_utf8_none_in(map))
+                .not.toThrow();
+        });
+
+        it('throws on object keys', function () {
+            const map = new Map([[{}, 1]]);
+            expect(() => GIMarshallingTests.ghashtable_int_none_in(map))
+                .toThrowError(/Map keys/);
+        });
+    });
+
+    describe('with lazy hash table returns enabled', function () {
+        const Gi = imports._gi;
+
+        beforeEach(function () {
+            Gi.set_lazy_hash_table_returns('GIMarshallingTests', true);
+        });
+
+        afterEach(function () {
+            Gi.set_lazy_hash_table_returns('GIMarshallingTests', false);
+        });
+
+        it('converts entries on access', function () {
+            const table = GIMarshallingTests.ghashtable_int_none_return();
+            expect(table.size).toBe(4);
+            expect(table.get(1)).toBe(-1);
+            expect(table.get('2')).toBe(-2);
+            expect(table.get(5)).toBeUndefined();
+            expect(table.has(-1)).toBe(true);
+            expect(table.has(5)).toBe(false);
+            expect(table.keys().sort()).toEqual([-1, 0, 1, 2].sort());
+        });
+
+        it('can be converted to an object', function () {
+            const table = GIMarshallingTests.ghashtable_utf8_none_return();
+            expect(table.toObject()).toEqual({
+                '-1': '1',
+                0: '0',
+                1: '-1',
+                2: '-2',
+            });
+        });
+    });
+
     describe('with double values', function () {
         testInParameter('ghashtable_double', numberDict);
     });
@@ -997,9 +1141,14 @@ describe('Union', function () {
         union = GIMarshallingTests.union_returnv();
     });
 
-    xit('marshals as a return value', function () {
+    it('marshals as a return value', function () {
         expect(union.long_).toEqual(42);
-    }).pend('https://gitlab.gnome.org/GNOME/gjs/issues/273');
+    });
+
+    it('can have its fields written', function () {
+        union.long_ = 7;
+        expect(union.long_).toEqual(7);
+    });
 
     // it('marshals as the this-argument of a method', function () {
     //     expect(() => union.inv()).not.toThrow();  // was this supposed to be static?
@@ -1606,6 +1755,10 @@ describe('Overrides', function () {
         const obj = new GIMarshallingTests.OverridesObject();
         expect(obj.method()).toEqual(6);
     });
+
+    it('applies class overrides before running _init', function () {
+        expect(GIMarshallingTests.CLASS_OVERRIDES_BEFORE_INIT).toEqual([true, true]);
+    });
 });
 
 describe('Filename', function () {
@@ -1,5 +1,6 @@
 const ByteArray = imports.byteArray;
 const GLib = imports.gi.GLib;
+const GObject = imports.gi.GObject;
 
 describe('GVariant constructor', function () {
     it('constructs a string variant', function () {
@@ -69,6 +70,35 @@ describe('GVariant constructor', function () {
         [112, 105, 122, 122, 97].forEach((val, ix) =>
             expect(a[ix]).toEqual(val));
     });
+
+    it('constructs a dictionary variant with integer keys', function () {
+        const dictVariant = new GLib.Variant('a{is}', {1: 'one', 2: 'two'});
+        expect(dictVariant.n_children()).toEqual(2);
+        expect(dictVariant.deepUnpack()).toEqual({1: 'one', 2: 'two'});
+    });
+
+    it('throws on values out of range for the type', function () {
+        expect(() => new GLib.Variant('y', 256)).toThrow();
+        expect(() => new GLib.Variant('n', -32769)).toThrow();
+        expect(() => new GLib.Variant('u', -1)).toThrow();
+        expect(() => new GLib.Variant('u', NaN)).toThrow();
+        expect(() => new GLib.Variant('x', 2 ** 63)).toThrow();
+        expect(() => new GLib.Variant('x', NaN)).toThrow();
+        expect(() => new GLib.Variant('t', 2 ** 64)).toThrow();
+        expect(() => new GLib.Variant('t', Infinity)).toThrow();
+    });
+
+    it('throws on an invalid object path', function () {
+        expect(() => new GLib.Variant('o', 'not a path')).toThrowError(TypeError);
+    });
+
+    it('throws on a tuple with too few elements', function () {
+        expect(() => new GLib.Variant('(si)', ['a string'])).toThrowError(TypeError);
+    });
+
+    it('throws on more than one complete type', function () {
+        expect(() => new GLib.Variant('ss', 'a string')).toThrowError(TypeError);
+    });
 });
 
 describe('GVariant unpack', function () {
@@ -86,6 +116,67 @@ describe('GVariant unpack', function () {
         expect(v.recursiveUnpack().foo instanceof GLib.Variant).toBeFalsy();
         expect(v.recursiveUnpack().foo).toEqual('bar');
     });
+
+    it('leaves children packed with a shallow unpack', function () {
+        const unpacked = new GLib.Variant('(sai)', ['a string', [1, 2]]).unpack();
+        expect(unpacked[0] instanceof GLib.Variant).toBeTruthy();
+        expect(unpacked[1].deepUnpack()).toEqual([1, 2]);
+    });
+
+    it('deeply unpacks arrays of numbers', function () {
+        expect(new GLib.Variant('ai', [-1, 0, 1]).deepUnpack()).toEqual([-1, 0, 1]);
+        expect(new GLib.Variant('ad', [0.5, 1.5]).deepUnpack()).toEqual([0.5, 1.5]);
+        expect(new GLib.Variant('aq', []).deepUnpack()).toEqual([]);
+    });
+
+    it('unpacks maybe and nested variants', function () {
+        const variant = new GLib.Variant('(msv)', [null, new GLib.Variant('u', 5)]);
+        expect(variant.recursiveUnpack()).toEqual([null, 5]);
+    });
+});
+
+describe('GVariant toTypedArray', function () {
+    it('converts arrays of numbers to the matching typed arrays', function () {
+        const ints = new GLib.Variant('ai', [-1, 0, 1]).toTypedArray();
+        expect(ints).toEqual(jasmine.any(Int32Array));
+        expect(Array.from(ints)).toEqual([-1, 0, 1]);
+
+        const doubles = new GLib.Variant('ad', [0.5, 1.5]).toTypedArray();
+        expect(doubles).toEqual(jasmine.any(Float64Array));
+        expect(Array.from(doubles)).toEqual([0.5, 1.5]);
+
+        const uints = new GLib.Variant('au', [0xffffffff]).toTypedArray();
+        expect(uints).toEqual(jasmine.any(Uint32Array));
+        expect(uints[0]).toEqual(0xffffffff);
+    });
+
+    it('converts byte arrays to Uint8Arrays', function () {
+        const bytes = new GLib.Variant('ay', Uint8Array.from([1, 2, 3])).toTypedArray();
+        expect(bytes).toEqual(jasmine.any(Uint8Array));
+        expect(Array.from(bytes)).toEqual([1, 2, 3]);
+    });
+
+    it('converts empty arrays', function () {
+        expect(new GLib.Variant('aq', []).toTypedArray().length).toEqual(0);
+    });
+
+    it('keeps the data after the variant is collected', function () {
+        let array = (() => new GLib.Variant('an', [1, -2, 3]).toTypedArray())();
+        imports.system.gc();
+        expect(Array.from(array)).toEqual([1, -2, 3]);
+    });
+
+    it('does not write to the variant', function () {
+        const variant = new GLib.Variant('ai', [1, 2]);
+        variant.toTypedArray()[0] = 5;
+        expect(variant.deepUnpack()).toEqual([1, 2]);
+    });
+
+    it('throws on other types', function () {
+        expect(() => new GLib.Variant('as', ['a']).toTypedArray()).toThrowError(TypeError);
+        expect(() => new GLib.Variant('ax', [1]).toTypedArray()).toThrowError(TypeError);
+        expect(() => new GLib.Variant('i', 1).toTypedArray()).toThrowError(TypeError);
+    });
 });
 
 describe('GVariantDict lookup', function () {
@@ -238,3 +329,59 @@ describe('GLib string function overrides', function () {
         assertWarnings('strcanon');
     });
 });
+
+describe('Reference-counted boxed wrappers', function () {
+    it('are reused when the same pointer is returned again', function () {
+        expect(GLib.MainContext.default()).toBe(GLib.MainContext.default());
+    });
+});
+
+describe('GLib.runInThread()', function () {
+    it('resolves with the return value', function (done) {
+        GLib.runInThread(GLib.compute_checksum_for_string,
+            GLib.ChecksumType.MD5, 'abc', -1).then(checksum => {
+            expect(checksum).toEqual('900150983cd24fb0d6963f7d28e17f72');
+            done();
+        }).catch(fail);
+    });
+
+    it('resolves with out arguments, as a normal call returns them', function (done) {
+        const [, path] = GLib.file_open_tmp('cjs-run-in-thread-XXXXXX');
+        GLib.file_set_contents(path, 'contents');
+        GLib.runInThread(GLib.file_get_contents, path).then(([ok, contents]) => {
+            expect(ok).toBeTruthy();
+            expect(ByteArray.toString(contents)).toEqual('contents');
+            GLib.unlink(path);
+            done();
+        }).catch(fail);
+    });
+
+    it('calls methods on the first argument', function (done) {
+        const bytes = new GLib.Bytes([1, 2, 3]);
+        GLib.runInThread(GLib.Bytes.prototype.get_size, bytes).then(size => {
+            expect(size).toEqual(3);
+            done();
+        }).catch(fail);
+    });
+
+    it('rejects with the GError thrown by the function', function (done) {
+        GLib.runInThread(GLib.file_get_contents, '/nonexistent/file').then(fail, err => {
+            expect(err).toEqual(jasmine.any(GLib.Error));
+            expect(err.matches(GLib.FileError, GLib.FileError.NOENT)).toBeTruthy();
+            done();
+        });
+    });
+
+    it('refuses functions that take callbacks', function () {
+        expect(() => GLib.runInThread(GLib.idle_add, GLib.PRIORITY_DEFAULT, () => false))
+            .toThrowError(/callback/);
+    });
+
+    it('refuses objects whose class is implemented in JS', function () {
+        const JSImplemented = GObject.registerClass({
+            GTypeName: 'CjsTestRunInThreadObject',
+        }, class JSImplemented extends GObject.Object {});
+        expect(() => GLib.runInThread(GObject.Object.prototype.freeze_notify, new JSImplemented()))
+            .toThrowError(/implemented in JS/);
+    });
+});
@@ -24,6 +24,22 @@ describe('GObject overrides', function () {
         expect(o.int).toBe(42);
     });
 
+    it('GObject.Object.set_properties()', function () {
+        const o = new TestObj();
+        const notify = jasmine.createSpy('notify');
+        o.connect('notify', notify);
+        o.set_properties({string: 'Answer', int: 42});
+        expect(o.string).toBe('Answer');
+        expect(o.int).toBe(42);
+        expect(notify).toHaveBeenCalledTimes(2);
+    });
+
+    it('GObject.Object.set_properties() rejects unknown properties', function () {
+        const o = new TestObj();
+        expect(() => o.set_properties({int: 1, bogus: 2})).toThrow();
+        expect(o.int).toBe(0);
+    });
+
     describe('Signal alternative syntax', function () {
         let o, handler;
         beforeEach(function () {
@@ -49,6 +65,33 @@ describe('GObject overrides', function () {
     });
 });
 
+describe('Interned string returns', function () {
+    const Gi = imports._gi;
+
+    beforeEach(function () {
+        Gi.set_interned_string_returns('GObject', true);
+    });
+
+    afterEach(function () {
+        Gi.set_interned_string_returns('GObject', false);
+    });
+
+    it('return the right strings', function () {
+        expect(GObject.type_name(GObject.TYPE_INT)).toEqual('gint');
+        expect(GObject.type_name(GObject.TYPE_INT)).toEqual('gint');
+        expect(GObject.type_name(GObject.TYPE_DOUBLE)).toEqual('gdouble');
+    });
+});
+
+describe('Preatomized names', function () {
+    it('still resolve', function () {
+        imports._gi.preatomize_names('GObject');
+        expect(GObject.type_name(GObject.TYPE_INT)).toEqual('gint');
+        expect(new GObject.Object().notify).toBeInstanceOf(Function);
+        expect(GObject.SignalFlags.RUN_FIRST).toBeDefined();
+    });
+});
+
 describe('GObject should', function () {
     const types = ['gpointer', 'GBoxed', 'GParam', 'GInterface', 'GObject', 'GVariant'];
 
@@ -59,3 +102,52 @@ describe('GObject should', function () {
         });
     });
 });
+
+describe('instanceof on GObject classes', function () {
+    const Gio = imports.gi.Gio;
+    const Derived = GObject.registerClass(class InstanceofDerived extends Gio.Cancellable {});
+
+    it('is true for instances of the class and its subclasses', function () {
+        const cancellable = new Gio.Cancellable();
+        expect(cancellable instanceof Gio.Cancellable).toBeTruthy();
+        expect(cancellable instanceof GObject.Object).toBeTruthy();
+        expect(new Derived() instanceof Gio.Cancellable).toBeTruthy();
+    });
+
+    it('is false for unrelated objects', function () {
+        expect(new GObject.Object() instanceof Gio.Cancellable).toBeFalsy();
+        expect({} instanceof Gio.Cancellable).toBeFalsy();
+        expect(42 instanceof Gio.Cancellable).toBeFalsy();
+    });
+
+    it('still follows the prototype chain for JS subclasses and prototypes', function () {
+        expect(new Derived() instanceof Derived).toBeTruthy();
+        expect(new Gio.Cancellable() instanceof Derived).toBeFalsy();
+        expect(Derived.prototype instanceof Gio.Cancellable).toBeTruthy();
+        expect(Object.create(Gio.Cancellable.prototype) instanceof Gio.Cancellable)
+            .toBeTruthy();
+    });
+});
+
+describe('Missing properties on GObject wrappers', function () {
+    const Gio = imports.gi.Gio;
+
+    it('stay missing when looked up repeatedly', function () {
+        const cancellable = new Gio.Cancellable();
+        for (let i = 0; i < 100; i++) {
+            expect(cancellable.notAMethod).toBeUndefined();
+            expect(cancellable[Symbol.iterator]).toBeUndefined();
+            expect(cancellable[i]).toBeUndefined();
+        }
+    });
+
+    it('do not hide properties that are resolved later', function () {
+        const cancellable = new Gio.Cancellable();
+        expect(cancellable.notAMethod).toBeUndefined();
+        expect(typeof cancellable.is_cancelled).toEqual('function');
+        Gio.Cancellable.prototype.notAMethod = () => 42;
+        expect(cancellable.notAMethod()).toEqual(42);
+        delete Gio.Cancellable.prototype.notAMethod;
+        expect(cancellable.notAMethod).toBeUndefined();
+    });
+});
@@ -447,6 +447,30 @@ describe('GObject class with decorator', function () {
         expect(new Derived().toString()).toMatch(
             /\[object instance wrapper GType:Gjs_Derived jsobj@0x[a-f0-9]+ native@0x[a-f0-9]+\]/);
     });
+
+    it('stores the IDs of the signals it creates', function () {
+        const signalSpecs = {'my-signal': {}};
+        const Klass = GObject.registerClass({
+            GTypeName: 'Gjs_SignalIDs',
+            Signals: signalSpecs,
+        }, class extends GObject.Object {});
+        expect(signalSpecs['my-signal'].signal_id)
+            .toEqual(GObject.signal_lookup('my-signal', Klass.$gtype));
+    });
+
+    it('reports invalid signals with the signal name', function () {
+        expect(() => GObject.registerClass({
+            GTypeName: 'Gjs_InvalidSignal',
+            Signals: {'bad-signal': {param_types: ['not a GType']}},
+        }, class extends GObject.Object {})).toThrowError(TypeError, /bad-signal/);
+    });
+
+    it('reports a signal return type that is not a GType as a TypeError', function () {
+        expect(() => GObject.registerClass({
+            GTypeName: 'Gjs_InvalidSignalReturnType',
+            Signals: {'bad-return': {return_type: 42}},
+        }, class extends GObject.Object {})).toThrowError(TypeError, /bad-return/);
+    });
 });
 
 describe('GObject virtual function', function () {
@@ -740,6 +764,97 @@ describe('Signal handler matching', function () {
     it('does not support disconnecting a handler by callback data', function () {
         expect(() => GObject.signal_handlers_disconnect_by_data(o, null)).toThrow();
     });
+
+    it('blocks and disconnects handlers by group', function () {
+        const group = GObject.signal_handler_group_new();
+        const handleGrouped = jasmine.createSpy('handleGrouped');
+        o.connect('empty', handleGrouped, group);
+        o.connect('minimal', handleGrouped, group);
+
+        expect(GObject.signal_handlers_block_matched(o, {group})).toEqual(2);
+        o.emitEmpty();
+        o.emitMinimal();
+        expect(handleGrouped).not.toHaveBeenCalled();
+        expect(handleEmpty).toHaveBeenCalled();
+
+        expect(GObject.signal_handlers_unblock_matched(o, {group})).toEqual(2);
+        expect(GObject.signal_handlers_disconnect_matched(o, {group})).toEqual(2);
+        o.emitEmpty();
+        expect(handleGrouped).not.toHaveBeenCalled();
+    });
+
+    it('does not match by the group of ungrouped handlers', function () {
+        expect(() => GObject.signal_handler_find(o, {group: 0})).toThrow();
+    });
+});
+
+describe('Throttled and debounced signal handlers', function () {
+    let o, handler;
+    beforeEach(function () {
+        o = new MyObject();
+        handler = jasmine.createSpy('handler');
+    });
+
+    function runMainLoopFor(ms) {
+        const loop = GLib.MainLoop.new(null, false);
+        GLib.timeout_add(GLib.PRIORITY_LOW, ms, () => {
+            loop.quit();
+            return GLib.SOURCE_REMOVE;
+        });
+        loop.run();
+    }
+
+    it('calls a throttled handler right away, then with the last emission', function () {
+        o.connect('minimal', handler, {throttle: 50});
+        for (let i = 1; i <= 5; i++)
+            o.emitMinimal(i, 0);
+        expect(handler).toHaveBeenCalledTimes(1);
+        expect(handler).toHaveBeenCalledWith(o, 1, 0);
+
+        runMainLoopFor(100);
+        expect(handler).toHaveBeenCalledTimes(2);
+        expect(handler).toHaveBeenCalledWith(o, 5, 0);
+    });
+
+    it('calls a debounced handler once emissions stop', function () {
+        o.connect('minimal', handler, {debounce: 50});
+        for (let i = 1; i <= 5; i++)
+            o.emitMinimal(i, 0);
+        expect(handler).not.toHaveBeenCalled();
+
+        runMainLoopFor(100);
+        expect(handler).toHaveBeenCalledTimes(1);
+        expect(handler).toHaveBeenCalledWith(o, 5, 0);
+    });
+
+    it('drops pending emissions when disconnected', function () {
+        const id = o.connect('minimal', handler, {debounce: 10});
+        o.emitMinimal(1, 2);
+        o.disconnect(id);
+        runMainLoopFor(50);
+        expect(handler).not.toHaveBeenCalled();
+    });
+
+    it('puts a rate-limited handler in a group', function () {
+        const group = GObject.signal_handler_group_new();
+        o.connect('minimal', handler, {group, debounce: 10});
+        expect(GObject.signal_handlers_disconnect_matched(o, {group})).toEqual(1);
+    });
+
+    it('matches a rate-limited handler by callback', function () {
+        o.connect('minimal', handler, {throttle: 10});
+        expect(GObject.signal_handlers_disconnect_by_func(o, handler)).toEqual(1);
+    });
+
+    it('cannot rate-limit handlers of signals with a return value', function () {
+        expect(() => o.connect('full', handler, {debounce: 10}))
+            .toThrowError(/return value/);
+    });
+
+    it('cannot both throttle and debounce', function () {
+        expect(() => o.connect('empty', handler, {throttle: 10, debounce: 10}))
+            .toThrowError(/both/);
+    });
 });
 
 describe('Auto accessor generation', function () {
@@ -23,6 +23,11 @@ describe('Looking up param specs', function () {
     it('gives the default value if present', function () {
         expect(p2.default_value).toBeTruthy();
     });
+
+    it('gives the same wrapper each time', function () {
+        let findProperty = GObject.Object.find_property;
+        expect(findProperty.call(Gio.ThemedIcon, 'name')).toBe(p1);
+    });
 });
 
 describe('GType object', function () {
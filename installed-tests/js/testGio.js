@@ -28,6 +28,77 @@ describe('ListStore iterator', function () {
     });
 });
 
+describe('ListModel bulk access', function () {
+    const JSModel = GObject.registerClass({
+        Implements: [Gio.ListModel],
+    }, class JSModel extends GObject.Object {
+        _init(items) {
+            super._init();
+            this._items = items;
+        }
+
+        vfunc_get_item_type() {
+            return Foo.$gtype;
+        }
+
+        vfunc_get_n_items() {
+            return this._items.length;
+        }
+
+        vfunc_get_item(position) {
+            return this._items[position] || null;
+        }
+    });
+
+    let items;
+    beforeEach(function () {
+        items = [];
+        for (let i = 0; i < 10; i++)
+            items.push(new Foo(i));
+    });
+
+    it('gets a range of items from a ListStore', function () {
+        const list = new Gio.ListStore({item_type: Foo});
+        list.splice(0, 0, items);
+        expect(list.getItems(2, 3).map(f => f.value)).toEqual([2, 3, 4]);
+        expect(list.getItems(8).map(f => f.value)).toEqual([8, 9]);
+        expect(list.getItems(20)).toEqual([]);
+    });
+
+    it('gets items from a JS model without going through C', function () {
+        const model = new JSModel(items);
+        spyOn(model, 'vfunc_get_item').and.callThrough();
+        expect(model.getItems().length).toBe(10);
+        expect(model.vfunc_get_item).toHaveBeenCalledTimes(10);
+        expect([...model].map(f => f.value)).toEqual(items.map(f => f.value));
+    });
+
+    describe('Gio.ArrayStore', function () {
+        let store, changed;
+        beforeEach(function () {
+            store = new Gio.ArrayStore({item_type: Foo});
+            changed = jasmine.createSpy('items-changed');
+            store.connect('items-changed', changed);
+        });
+
+        it('splices in a whole array with one items-changed', function () {
+            store.splice(0, 0, items);
+            expect(store.get_n_items()).toBe(10);
+            expect(store.get_item(3).value).toBe(3);
+            expect(changed).toHaveBeenCalledTimes(1);
+            expect(changed).toHaveBeenCalledWith(store, 0, 0, 10);
+        });
+
+        it('replaces a range of items', function () {
+            store.splice(0, 0, items);
+            store.splice(2, 5, [new Foo(42)]);
+            expect([...store].map(f => f.value)).toEqual([0, 1, 42, 7, 8, 9]);
+            expect(changed).toHaveBeenCalledWith(store, 2, 5, 1);
+            expect(store.getItems(1, 2).map(f => f.value)).toEqual([1, 42]);
+        });
+    });
+});
+
 describe('Gio.Settings overrides', function () {
     it("doesn't crash when forgetting to specify a schema ID", function () {
         expect(() => new Gio.Settings()).toThrowError(/schema/);
@@ -145,5 +216,147 @@ describe('Gio.Settings overrides', function () {
             const sub = settings.get_child('sub');
             expect(sub.get_uint('marine')).toEqual(10);
         });
+
+        it('keeps a cache of unpacked values up to date', function () {
+            const cache = settings.getCache();
+            expect(settings.getCache()).toBe(cache);
+            expect(Object.keys(cache).sort())
+                .toEqual(['fullscreen', 'maximized', 'window-size']);
+            expect(cache['window-size']).toEqual([-1, -1]);
+            expect(cache.maximized).toEqual(false);
+
+            settings.set_boolean('maximized', true);
+            settings.set_value('window-size', new GLib.Variant('(ii)', [100, 50]));
+            expect(cache.maximized).toEqual(true);
+            expect(cache['window-size']).toEqual([100, 50]);
+
+            settings.reset('maximized');
+            settings.reset('window-size');
+            expect(cache.maximized).toEqual(false);
+            expect(cache['window-size']).toEqual([-1, -1]);
+        });
+    });
+});
+
+describe('Lazily applied overrides', function () {
+    it('are applied to classes looked up after importing Gio', function () {
+        expect(Gio.DBusProxy.makeProxyWrapper).toEqual(jasmine.any(Function));
+        expect(Gio.DBusConnection.prototype.watch_name).toEqual(jasmine.any(Function));
+    });
+
+    it('define DBusExportedObject on first access', function () {
+        expect(Gio.DBusExportedObject.wrapJSObject).toEqual(jasmine.any(Function));
+        expect(Gio.DBusExportedObject).toBe(Gio.DBusExportedObject);
+    });
+});
+
+describe('Async methods called without a callback', function () {
+    let file;
+
+    beforeAll(function () {
+        file = Gio.File.new_for_path(GLib.build_filenamev([GLib.get_tmp_dir(),
+            `gjs-test-async-${GLib.get_monotonic_time()}`]));
+        file.replace_contents('hello', null, false,
+            Gio.FileCreateFlags.REPLACE_DESTINATION, null);
+    });
+
+    afterAll(function () {
+        file.delete(null);
+    });
+
+    it('return a Promise for the result of the finish method', function (done) {
+        const promise = file.load_contents_async(null);
+        expect(promise).toEqual(jasmine.any(Promise));
+        promise.then(([contents]) => {
+            expect(imports.byteArray.toString(contents)).toEqual('hello');
+            done();
+        }).catch(done.fail);
+    });
+
+    it('reject the Promise if the finish method throws', function (done) {
+        const missing = file.get_child('missing');
+        missing.load_contents_async(null).then(() => {
+            done.fail('Promise was resolved');
+        }).catch(error => {
+            expect(error).toEqual(jasmine.any(GLib.Error));
+            done();
+        });
+    });
+
+    it('still take a callback', function (done) {
+        file.load_contents_async(null, (source, result) => {
+            const [, contents] = source.load_contents_finish(result);
+            expect(imports.byteArray.toString(contents)).toEqual('hello');
+            done();
+        });
+    });
+});
+
+describe('GBytes passed between streams', function () {
+    it('are passed back to C as they were returned', function () {
+        const input = Gio.MemoryInputStream.new_from_bytes(
+            new GLib.Bytes([1, 2, 3, 4, 5]));
+        const output = Gio.MemoryOutputStream.new_resizable();
+
+        let bytes;
+        while ((bytes = input.read_bytes(2, null)).get_size() > 0) {
+            expect(bytes).toEqual(jasmine.any(GLib.Bytes));
+            output.write_bytes(bytes, null);
+        }
+        output.close(null);
+
+        const result = output.steal_as_bytes();
+        expect(result).toEqual(jasmine.any(GLib.Bytes));
+        expect(Array.from(result.toArray())).toEqual([1, 2, 3, 4, 5]);
+    });
+});
+
+describe('OutputStream.spliceWithProgress()', function () {
+    const data = new Uint8Array(100000).map((_, ix) => ix % 256);
+
+    it('copies the whole stream and reports progress', function (done) {
+        const input = Gio.MemoryInputStream.new_from_bytes(new GLib.Bytes(data));
+        const output = Gio.MemoryOutputStream.new_resizable();
+        const progress = [];
+
+        output.spliceWithProgress(input,
+            Gio.OutputStreamSpliceFlags.CLOSE_SOURCE |
+            Gio.OutputStreamSpliceFlags.CLOSE_TARGET,
+            GLib.PRIORITY_DEFAULT, null, 0, nBytes => progress.push(nBytes))
+        .then(nBytes => {
+            expect(nBytes).toEqual(data.length);
+            expect(progress.length).toBeGreaterThan(1);
+            expect(progress[progress.length - 1]).toEqual(data.length);
+            expect(output.is_closed()).toBeTruthy();
+            expect(output.steal_as_bytes().toArray()).toEqual(data);
+            done();
+        }).catch(done.fail);
+    });
+
+    it('works like splice_async() without a progress callback', function (done) {
+        const input = Gio.MemoryInputStream.new_from_bytes(new GLib.Bytes(data));
+        const output = Gio.MemoryOutputStream.new_resizable();
+
+        output.spliceWithProgress(input, Gio.OutputStreamSpliceFlags.CLOSE_TARGET)
+        .then(nBytes => {
+            expect(nBytes).toEqual(data.length);
+            done();
+        }).catch(done.fail);
+    });
+
+    it('rejects when cancelled', function (done) {
+        const input = Gio.MemoryInputStream.new_from_bytes(new GLib.Bytes(data));
+        const output = Gio.MemoryOutputStream.new_resizable();
+        const cancellable = new Gio.Cancellable();
+        cancellable.cancel();
+
+        output.spliceWithProgress(input, Gio.OutputStreamSpliceFlags.NONE,
+            GLib.PRIORITY_DEFAULT, cancellable, 0, () => {})
+        .then(() => done.fail('Promise was resolved'))
+        .catch(error => {
+            expect(error.matches(Gio.IOErrorEnum, Gio.IOErrorEnum.CANCELLED))
+                .toBeTruthy();
+            done();
+        });
     });
 });
@@ -1,7 +1,7 @@
 imports.gi.versions.Gtk = '4.0';
 
 const ByteArray = imports.byteArray;
-const {Gio, GObject, Gtk} = imports.gi;
+const {Gio, GObject, Graphene, Gtk} = imports.gi;
 
 // This is ugly here, but usually it would be in a resource
 function createTemplate(className) {
@@ -172,3 +172,12 @@ describe('Gtk overrides', function () {
         expect(iter.stamp).toEqual(42);
     });
 });
+
+describe('Graphene', function () {
+    it('takes an array of points as a typed array', function () {
+        const box = new Graphene.Box().init_from_points(
+            Float32Array.of(1, 2, 3, -1, 5, 0));
+        expect(box.get_min()).toEqual(jasmine.objectContaining({x: -1, y: 2, z: 0}));
+        expect(box.get_max()).toEqual(jasmine.objectContaining({x: 1, y: 5, z: 3}));
+    });
+});
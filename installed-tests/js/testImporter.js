@@ -222,6 +222,41 @@ describe('Importer', function () {
         });
     });
 
+    describe('with files added to a search path directory', function () {
+        const GLib = imports.gi.GLib;
+        let dir, searchPath;
+
+        beforeEach(function () {
+            dir = GLib.dir_make_tmp('gjs-importer-XXXXXX');
+            searchPath = imports.searchPath;
+            imports.searchPath = [dir];
+        });
+
+        afterEach(function () {
+            imports.searchPath = searchPath;
+            for (const name of ['addedLater.js', 'addedAfterClear.js'])
+                GLib.unlink(GLib.build_filenamev([dir, name]));
+            GLib.rmdir(dir);
+        });
+
+        it('finds them right away', function () {
+            expect(() => imports.addedLater).toThrowError(/No JS module/);
+
+            const path = GLib.build_filenamev([dir, 'addedLater.js']);
+            GLib.file_set_contents(path, 'var value = 42;');
+            expect(imports.addedLater.value).toEqual(42);
+        });
+
+        it('finds them after clearImportCache()', function () {
+            expect(() => imports.addedAfterClear).toThrowError(/No JS module/);
+
+            const path = GLib.build_filenamev([dir, 'addedAfterClear.js']);
+            GLib.file_set_contents(path, 'var value = 43;');
+            imports.system.clearImportCache();
+            expect(imports.addedAfterClear.value).toEqual(43);
+        });
+    });
+
     it("doesn't crash when resolving a non-string property", function () {
         expect(imports[0]).not.toBeDefined();
         expect(imports.foobar[0]).not.toBeDefined();
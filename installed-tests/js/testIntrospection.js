@@ -69,6 +69,25 @@ describe('Enum classes', function () {
     it('enum $gtype property is enumerable', function () {
         expect('$gtype' in Gio.BusType).toBeTruthy();
     });
+
+    [
+        ['enum', Gio.BusType, 'SESSION'],
+        ['flags', Gio.FileQueryInfoFlags, 'NOFOLLOW_SYMLINKS'],
+        ['error domain', Gio.IOErrorEnum, 'NOT_FOUND'],
+    ].forEach(([kind, type, name]) => {
+        it(`${kind} values are read-only`, function () {
+            const value = type[name];
+            const desc = Object.getOwnPropertyDescriptor(type, name);
+            expect(desc.writable).toBeFalsy();
+            expect(desc.configurable).toBeFalsy();
+            expect(desc.enumerable).toBeTruthy();
+            expect(() => {
+                'use strict';
+                type[name] = 42;
+            }).toThrowError(TypeError);
+            expect(type[name]).toEqual(value);
+        });
+    });
 });
 
 describe('GError domains', function () {
@@ -125,6 +144,18 @@ describe('Garbage collection of introspected objects', function () {
         System.gc();
         GLib.idle_add(GLib.PRIORITY_LOW, () => done());
     });
+
+    it('keeps expando properties of objects still referenced from C', function () {
+        const store = new Gio.ListStore({itemType: GObject.Object});
+        (function () {
+            const obj = new GObject.Object();
+            obj.expando = 42;
+            store.append(obj);
+        })();
+
+        System.gc();
+        expect(store.get_item(0).expando).toBe(42);
+    });
 });
 
 describe('Gdk.Atom', function () {
@@ -142,6 +173,24 @@ describe('Complete enumeration (boxed types)', function () {
         const expectAtLeast = ['equal', 'intersect', 'union', 'x', 'y', 'width', 'height'];
         expect(names).toEqual(jasmine.arrayContaining(expectAtLeast));
     });
+
+    it('enumerates the same properties again', function () {
+        const proto = Object.getPrototypeOf(new Gdk.Rectangle());
+        const names = Object.getOwnPropertyNames(proto);
+        expect(Object.getOwnPropertyNames(proto)).toEqual(names);
+    });
+});
+
+describe('Complete enumeration (object types)', function () {
+    it('enumerates methods and properties of the class and its interfaces', function () {
+        const proto = Gio.SimpleAction.prototype;
+        const expectAtLeast = ['set_enabled', 'set_state', 'activate',
+            'get_parameter_type', 'enabled', 'state_type'];
+        for (let i = 0; i < 2; i++) {
+            const names = Object.getOwnPropertyNames(proto);
+            expect(names).toEqual(jasmine.arrayContaining(expectAtLeast));
+        }
+    });
 });
 
 describe('Complete enumeration of GIRepositoryNamespace (new_enumerate)', function () {
@@ -39,6 +39,62 @@ describe('Mainloop.timeout_add()', function () {
     });
 });
 
+describe('Mainloop.timeout_add_coalesced()', function () {
+    it('runs timeouts until they return false', function (done) {
+        let count = 0;
+        Mainloop.timeout_add_coalesced(5, () => {
+            count++;
+            if (count < 3)
+                return true;
+            done();
+            return false;
+        });
+    });
+
+    it('runs timers due within the slack in one wakeup', function (done) {
+        const order = [];
+        Mainloop.timeout_add_coalesced(10, () => {
+            order.push('first');
+            return false;
+        }, 50);
+        Mainloop.timeout_add_coalesced(30, () => {
+            order.push('second');
+            expect(order).toEqual(['first', 'second']);
+            done();
+            return false;
+        }, 0);
+    });
+
+    it('does not run removed timers', function (done) {
+        const neverRuns = jasmine.createSpy('neverRuns');
+        const id = Mainloop.timeout_add_coalesced(5, neverRuns);
+        expect(id).toBeLessThan(0);
+        expect(Mainloop.source_remove(id)).toBe(true);
+        expect(Mainloop.source_remove(id)).toBe(false);
+
+        Mainloop.timeout_add_coalesced(20, () => {
+            expect(neverRuns).not.toHaveBeenCalled();
+            done();
+            return false;
+        });
+    });
+
+    it('can remove a timer from its own callback', function (done) {
+        let calls = 0;
+        const id = Mainloop.timeout_add_coalesced(5, () => {
+            calls++;
+            Mainloop.source_remove(id);
+            Mainloop.timeout_add_coalesced(40, () => {
+                expect(calls).toEqual(1);
+                done();
+                return false;
+            });
+            // Asks to be called again, which the removal must override
+            return true;
+        });
+    });
+});
+
 describe('Mainloop.idle_add()', function () {
     let runOnce, runTwice, neverRuns, quitAfterManyRuns;
     beforeAll(function (done) {
@@ -84,6 +140,17 @@ describe('Mainloop.idle_add()', function () {
         });
     });
 
+    it('treats truthy return values as continuing the source', function (done) {
+        let count = 0;
+        Mainloop.idle_add(() => {
+            count += 1;
+            if (count < 3)
+                return 1;
+            done();
+            return null;
+        });
+    });
+
     // Add an idle before exit, then never run main loop again.
     // This is to test that we remove idle callbacks when the associated
     // JSContext is blown away. The leak check in minijasmine will
@@ -20,6 +20,12 @@ describe('log', function () {
         log('foo');
         expect(log).toHaveBeenCalledWith('foo');
     });
+
+    it('tells whether a level would be logged', function () {
+        const {LogLevelFlags} = imports.gi.GLib;
+        expect(log.enabled(LogLevelFlags.LEVEL_MESSAGE)).toBeTruthy();
+        expect(log.enabled(LogLevelFlags.LEVEL_WARNING, 'Foo')).toBeTruthy();
+    });
 });
 
 describe('logError', function () {
@@ -439,6 +439,15 @@ describe('Life, the Universe and Everything', function () {
             expect(struct.some_enum).toEqual(Regress.TestEnum.VALUE3);
         });
 
+        it('writes number fields into the struct memory', function () {
+            struct.some_int = -7;
+            struct.some_double = -0.25;
+            const b = struct.clone();
+            expect(b.some_int).toEqual(-7);
+            expect(b.some_double).toEqual(-0.25);
+            expect(b.some_int8).toEqual(43);
+        });
+
         it('can clone', function () {
             const b = struct.clone();
             expect(b.some_int).toEqual(42);
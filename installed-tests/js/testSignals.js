@@ -65,6 +65,33 @@ function testSignals(klass) {
         expect(foo._signalConnections.length).toEqual(0);
     });
 
+    it('does not call a signal handler connected during signal emission', function () {
+        foo.connect('bar', () => foo.connect('bar', bar));
+        foo.emit('bar');
+        expect(bar).not.toHaveBeenCalled();
+        foo.emit('bar');
+        expect(bar).toHaveBeenCalledTimes(1);
+    });
+
+    it('stops signal emission when a handler returns true', function () {
+        foo.connect('bar', () => true);
+        foo.connect('bar', bar);
+        foo.emit('bar');
+        expect(bar).not.toHaveBeenCalled();
+    });
+
+    it('keeps handlers in order after many disconnections', function () {
+        const calls = [];
+        const ids = [];
+        for (let i = 0; i < 10; i++)
+            ids.push(foo.connect('bar', () => calls.push(i)));
+        ids.filter((id, i) => i % 3 !== 0).forEach(id => foo.disconnect(id));
+        foo.emit('bar');
+        expect(calls).toEqual([0, 3, 6, 9]);
+        expect(foo._signalConnections.length).toEqual(4);
+        expect(() => foo.disconnect(ids[1])).toThrowError(/No signal connection/);
+    });
+
     it('distinguishes multiple signals', function () {
         let bonk = jasmine.createSpy('bonk');
         foo.connect('bar', bar);
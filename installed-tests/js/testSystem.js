@@ -1,4 +1,5 @@
 const System = imports.system;
+const GLib = imports.gi.GLib;
 const GObject = imports.gi.GObject;
 
 describe('System.addressOf()', function () {
@@ -41,6 +42,35 @@ describe('System.gc()', function () {
     it('does not crash the application', function () {
         expect(System.gc).not.toThrow();
     });
+
+    it('can collect only the nursery', function () {
+        const before = System.gcStats().majorCollections;
+        System.gc({minor: true});
+        expect(System.gcStats().majorCollections).toEqual(before);
+    });
+
+    it('can collect incrementally', function (done) {
+        const before = System.gcStats().majorCollections;
+        System.gc({incremental: true, shrink: true, budgetMs: 1});
+        GLib.timeout_add(GLib.PRIORITY_DEFAULT, 10, () => {
+            if (System.gcStats().majorCollections === before)
+                return GLib.SOURCE_CONTINUE;
+            done();
+            return GLib.SOURCE_REMOVE;
+        });
+    });
+
+    it('can compact the heap', function () {
+        const before = System.gcStats().majorCollections;
+        System.gc({shrink: true});
+        expect(System.gcStats().majorCollections).toBeGreaterThan(before);
+    });
+
+    it('checks its options', function () {
+        expect(() => System.gc({minor: true, shrink: true})).toThrow();
+        expect(() => System.gc({incremental: true, budgetMs: -1}))
+            .toThrowError(RangeError);
+    });
 });
 
 describe('System.dumpHeap()', function () {
@@ -48,3 +78,170 @@ describe('System.dumpHeap()', function () {
         expect(() => System.dumpHeap('/does/not/exist')).toThrow();
     });
 });
+
+describe('System.dumpHeapSnapshot()', function () {
+    const GLib = imports.gi.GLib;
+    let path;
+
+    beforeEach(function () {
+        const [fd, tmpPath] = GLib.file_open_tmp('gjs-heap-XXXXXX');
+        GLib.close(fd);
+        path = tmpPath;
+    });
+
+    afterEach(function () {
+        GLib.unlink(path);
+    });
+
+    function readMagic() {
+        const [, contents] = GLib.file_get_contents(path);
+        return String.fromCharCode(...contents.slice(0, 8));
+    }
+
+    it('writes a snapshot of the whole heap', function () {
+        System.dumpHeapSnapshot(path);
+        expect(readMagic()).toEqual('CJSHEAP1');
+    });
+
+    it('writes a smaller snapshot with only wrappers', function () {
+        const wrapper = new GLib.MainLoop(null, false);
+        System.dumpHeapSnapshot(path);
+        const [, full] = GLib.file_get_contents(path);
+        System.dumpHeapSnapshot(path, true);
+        const [, wrappers] = GLib.file_get_contents(path);
+        expect(readMagic()).toEqual('CJSHEAP1');
+        expect(wrappers.length).toBeLessThan(full.length);
+        expect(wrapper).toBeDefined();
+    });
+
+    it('throws when given a nonexistent path', function () {
+        expect(() => System.dumpHeapSnapshot('/does/not/exist')).toThrow();
+    });
+});
+
+describe('System.wrapperReport()', function () {
+    const GObject = imports.gi.GObject;
+
+    it('counts wrapped objects of each type', function () {
+        const objects = [new GObject.Object(), new GObject.Object()];
+        const report = System.wrapperReport();
+        const entry = report.find(e => e.type === 'GObject');
+        expect(entry.count).toBeGreaterThanOrEqual(objects.length);
+    });
+
+    it('reports the signal handler that keeps an object alive', function () {
+        // The captured object is only reachable through the signal handler
+        function makeEmitter() {
+            const captured = new GObject.Object();
+            captured.marker = true;
+            const emitter = new GObject.Object();
+            emitter.connect('notify', () => captured);
+            return emitter;
+        }
+        const emitter = makeEmitter();
+
+        const report = System.wrapperReport('GObject');
+        const entry = report.find(e =>
+            e.closures.some(c => c.signal === 'notify'));
+        expect(entry).toBeDefined();
+        expect(entry.path.length).toBeGreaterThan(0);
+        expect(emitter).toBeDefined();
+    });
+
+    it('throws for an unknown type', function () {
+        expect(() => System.wrapperReport('NoSuchType')).toThrow();
+    });
+});
+
+describe('System.prefetchModules()', function () {
+    const GLib = imports.gi.GLib;
+    let dir, path, oldSearchPath;
+
+    beforeEach(function () {
+        dir = GLib.dir_make_tmp('gjs-prefetch-XXXXXX');
+        path = GLib.build_filenamev([dir, 'prefetched.js']);
+        // Large enough to be compiled off the main thread
+        const padding = '// padding\n'.repeat(1000);
+        GLib.file_set_contents(path, `var value = 42;\n${padding}`);
+        oldSearchPath = imports.searchPath.slice();
+        imports.searchPath = [dir];
+    });
+
+    afterEach(function () {
+        imports.searchPath = oldSearchPath;
+        GLib.unlink(path);
+        GLib.rmdir(dir);
+    });
+
+    it('compiles modules that are imported later', function () {
+        System.prefetchModules([path]);
+        expect(imports.prefetched.value).toEqual(42);
+    });
+
+    it('skips files that do not exist', function () {
+        expect(() => System.prefetchModules(['/does/not/exist.js'])).not.toThrow();
+    });
+});
+
+describe('System.callStats()', function () {
+    it('returns an array of call counts', function () {
+        const stats = System.callStats();
+        expect(Array.isArray(stats)).toBeTruthy();
+        stats.forEach(({name, calls, time}) => {
+            expect(name).toEqual(jasmine.any(String));
+            expect(calls).toBeGreaterThan(0);
+            expect(time).not.toBeLessThan(0);
+        });
+    });
+
+    it('can be reset', function () {
+        System.resetCallStats();
+        expect(System.callStats()).toEqual([]);
+    });
+});
+
+describe('System.marshalStats()', function () {
+    it('returns an array of marshalling times', function () {
+        GObject.type_name(GObject.TYPE_OBJECT);
+        const stats = System.marshalStats();
+        expect(Array.isArray(stats)).toBeTruthy();
+        stats.forEach(({kind, phase, calls, histogram}) => {
+            expect(kind).toEqual(jasmine.any(String));
+            expect(['in', 'out', 'release', 'call']).toContain(phase);
+            expect(histogram.reduce((a, b) => a + b)).toEqual(calls);
+        });
+    });
+});
+
+describe('System.gcStats()', function () {
+    it('counts garbage collections', function () {
+        const before = System.gcStats().majorCollections;
+        System.gc();
+        const stats = System.gcStats();
+        expect(stats.majorCollections).toBeGreaterThan(before);
+        ['majorSlices', 'minorCollections', 'toggles'].forEach(key => {
+            const {calls, time, histogram} = stats[key];
+            expect(time).not.toBeLessThan(0);
+            expect(histogram.length).toEqual(16);
+            expect(histogram.reduce((a, b) => a + b)).toEqual(calls);
+        });
+        expect(stats.majorSlices.calls).toBeGreaterThan(0);
+    });
+});
+
+describe('System.memoryCounters()', function () {
+    it('counts live objects', function () {
+        const counters = System.memoryCounters();
+        expect(counters.everything.count).toBeGreaterThan(0);
+        expect(counters.object_instance.count).not.toBeLessThan(0);
+        expect(counters.function.bytes).not.toBeLessThan(0);
+    });
+
+    it('counts the memory of boxed structs', function () {
+        const {Regress} = imports.gi;
+        const before = System.memoryCounters().boxed_instance.bytes;
+        const struct = new Regress.TestStructA({some_int: 42});
+        expect(System.memoryCounters().boxed_instance.bytes).toBeGreaterThan(before);
+        expect(struct.some_int).toEqual(42);
+    });
+});
@@ -445,3 +445,40 @@ describe('Tweener', function () {
         expect(objectB.y).toEqual(0);
     });
 });
+
+describe('Tweener native interpolation', function () {
+    const Equations = imports.tweener.equations;
+    const Native = imports._tweenerNative;
+
+    const starts = new Float64Array([0, -50, 10, 255]);
+    const completes = new Float64Array([100, 50, 10, 0]);
+
+    Native.curves.forEach((name, curve) => {
+        it(`matches equations.js for ${name}`, function () {
+            const values = new Float64Array(starts.length);
+            const params = {amplitude: 2, period: 0.4};
+            for (let t = 0; t <= 1000; t += 125) {
+                Native.interpolate(curve, t, 1000, params, starts, completes,
+                    values);
+                starts.forEach((b, ix) => {
+                    expect(values[ix]).toBeCloseTo(
+                        Equations[name](t, b, completes[ix] - b, 1000, params),
+                        10);
+                });
+            }
+        });
+    });
+
+    it('uses the default parameters without transitionParams', function () {
+        const values = new Float64Array(1);
+        const curve = Native.curves.indexOf('easeOutBack');
+        Native.interpolate(curve, 500, 1000, null, starts.subarray(0, 1),
+            completes.subarray(0, 1), values);
+        expect(values[0]).toBeCloseTo(Equations.easeOutBack(500, 0, 100, 1000), 10);
+    });
+
+    it('throws on arrays of different lengths', function () {
+        expect(() => Native.interpolate(0, 0, 1000, null, starts, completes,
+            new Float64Array(1))).toThrow();
+    });
+});
@@ -0,0 +1,176 @@
+const ByteArray = imports.byteArray;
+const GLib = imports.gi.GLib;
+const {Worker} = imports.worker;
+
+// Scripts written by the current test, removed after it
+let workerScripts = [];
+
+function writeWorkerScript(source) {
+    const dir = GLib.dir_make_tmp('cjs-worker-XXXXXX');
+    const path = GLib.build_filenamev([dir, 'worker.js']);
+    GLib.file_set_contents(path, source);
+    workerScripts.push(path);
+    return path;
+}
+
+describe('Worker', function () {
+    afterEach(function () {
+        for (const path of workerScripts) {
+            GLib.unlink(path);
+            GLib.rmdir(GLib.path_get_dirname(path));
+        }
+        workerScripts = [];
+    });
+
+    it('echoes messages back from the worker thread', function (done) {
+        const worker = new Worker(writeWorkerScript(`
+            onmessage = ({data}) => postMessage({doubled: data.value * 2});
+        `));
+        worker.onmessage = ({data}) => {
+            expect(data).toEqual({doubled: 42});
+            worker.terminate();
+            done();
+        };
+        worker.postMessage({value: 21});
+    });
+
+    it('keeps the order of messages', function (done) {
+        const worker = new Worker(writeWorkerScript(`
+            for (let i = 0; i < 5; i++)
+                postMessage(i);
+            close();
+        `));
+        const received = [];
+        worker.onmessage = ({data}) => {
+            received.push(data);
+            if (received.length === 5) {
+                expect(received).toEqual([0, 1, 2, 3, 4]);
+                done();
+            }
+        };
+    });
+
+    it('moves transferred ArrayBuffers', function (done) {
+        const worker = new Worker(writeWorkerScript(`
+            onmessage = ({data}) => {
+                postMessage(new Uint8Array(data)[1], []);
+                close();
+            };
+        `));
+        worker.onmessage = ({data}) => {
+            expect(data).toEqual(2);
+            done();
+        };
+        const buffer = new Uint8Array([1, 2, 3]).buffer;
+        worker.postMessage(buffer, [buffer]);
+        expect(buffer.byteLength).toEqual(0);
+    });
+
+    it('passes GLib.Bytes to the worker as Uint8Arrays', function (done) {
+        const worker = new Worker(writeWorkerScript(`
+            onmessage = ({data}) => {
+                postMessage([data.copied instanceof Uint8Array,
+                    Array.from(data.copied), Array.from(data.shared)]);
+                close();
+            };
+        `));
+        worker.onmessage = ({data}) => {
+            expect(data).toEqual([true, [1, 2], [3, 4]]);
+            done();
+        };
+        const shared = new GLib.Bytes([3, 4]);
+        worker.postMessage({copied: new GLib.Bytes([1, 2]), shared}, [shared]);
+        expect(shared.get_size()).toEqual(2);
+    });
+
+    it('receives transferred Uint8Arrays from the worker', function (done) {
+        const worker = new Worker(writeWorkerScript(`
+            const array = new Uint8Array([5, 6, 7]);
+            postMessage(array, [array]);
+            close();
+        `));
+        worker.onmessage = ({data}) => {
+            expect(data instanceof Uint8Array).toBeTruthy();
+            expect(Array.from(data)).toEqual([5, 6, 7]);
+            done();
+        };
+    });
+
+    it('detaches the buffer of transferred Uint8Arrays', function (done) {
+        const worker = new Worker(writeWorkerScript(`
+            onmessage = ({data}) => {
+                postMessage(data.map(array => Array.from(array)));
+                close();
+            };
+        `));
+        worker.onmessage = ({data}) => {
+            expect(data).toEqual([[1, 2, 3], [4, 5]]);
+            done();
+        };
+        const owned = new Uint8Array([1, 2, 3]);
+        const shared = ByteArray.fromGBytes(new GLib.Bytes([4, 5]));
+        worker.postMessage([owned, shared], [owned, shared]);
+        expect(owned.length).toEqual(0);
+        expect(owned.buffer.byteLength).toEqual(0);
+        expect(shared.length).toEqual(0);
+    });
+
+    it('does not share transferred memory that the sender can still reach', function (done) {
+        const worker = new Worker(writeWorkerScript(`
+            onmessage = ({data}) => {
+                data.forEach(array => array.fill(0));
+                postMessage(null);
+                close();
+            };
+        `));
+        const bytes = new GLib.Bytes([1, 2]);
+        const viewed = new GLib.Bytes([3, 4]);
+        worker.onmessage = () => {
+            expect(Array.from(bytes.toArray())).toEqual([1, 2]);
+            expect(Array.from(viewed.toArray())).toEqual([3, 4]);
+            done();
+        };
+        const view = ByteArray.fromGBytes(viewed);
+        worker.postMessage([bytes, view], [bytes, view]);
+    });
+
+    it('reports uncaught exceptions to onerror', function (done) {
+        const worker = new Worker(writeWorkerScript(`
+            throw new Error('oops');
+        `));
+        worker.onerror = ({message}) => {
+            expect(message).toMatch(/worker\.js:2: Error: oops/);
+            worker.terminate();
+            done();
+        };
+    });
+
+    it('can interrupt a busy worker', function (done) {
+        const worker = new Worker(writeWorkerScript(`
+            postMessage('started');
+            for (;;) {}
+        `));
+        worker.onmessage = () => {
+            worker.terminate();
+            GLib.timeout_add(GLib.PRIORITY_DEFAULT, 10, () => {
+                done();
+                return GLib.SOURCE_REMOVE;
+            });
+        };
+    });
+
+    it('throws if the script cannot be read', function () {
+        expect(() => new Worker('/nonexistent/worker.js')).toThrow();
+    });
+
+    it('does not expose introspected libraries', function (done) {
+        const worker = new Worker(writeWorkerScript(`
+            postMessage(typeof imports);
+            close();
+        `));
+        worker.onmessage = ({data}) => {
+            expect(data).toEqual('undefined');
+            done();
+        };
+    });
+});
@@ -30,7 +30,13 @@ struct _GjsDBusImplementationPrivate {
 
     // from gchar* to GVariant*
     GHashTable           *outstanding_properties;
+    // names of properties whose values are only fetched when flushing
+    GHashTable* dirty_properties;
     guint                 idle_id;
+
+    GjsDBusImplementationMethodHandler method_handler;
+    void* method_handler_data;
+    GDestroyNotify method_handler_destroy;
 };
 
 G_DEFINE_TYPE_WITH_PRIVATE(GjsDBusImplementation, gjs_dbus_implementation,
@@ -97,7 +103,12 @@ static void gjs_dbus_implementation_method_call(
         return;
     }
 
-    g_signal_emit(self, signals[SIGNAL_HANDLE_METHOD], 0, method_name, parameters, invocation);
+    if (self->priv->method_handler)
+        self->priv->method_handler(self, method_name, parameters, invocation,
+                                   self->priv->method_handler_data);
+    else
+        g_signal_emit(self, signals[SIGNAL_HANDLE_METHOD], 0, method_name,
+                      parameters, invocation);
     g_object_unref (invocation);
 }
 
@@ -154,12 +165,28 @@ gjs_dbus_implementation_init(GjsDBusImplementation *self) {
     priv->vtable.set_property = gjs_dbus_implementation_property_set;
 
     priv->outstanding_properties = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify)g_variant_unref);
+    priv->dirty_properties =
+        g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+}
+
+static void gjs_dbus_implementation_clear_method_handler(
+    GjsDBusImplementation* self) {
+    GjsDBusImplementationPrivate* priv = self->priv;
+    GDestroyNotify destroy = priv->method_handler_destroy;
+    void* data = priv->method_handler_data;
+
+    priv->method_handler = NULL;
+    priv->method_handler_data = NULL;
+    priv->method_handler_destroy = NULL;
+    if (destroy)
+        destroy(data);
 }
 
 static void gjs_dbus_implementation_dispose(GObject* object) {
     GjsDBusImplementation* self = GJS_DBUS_IMPLEMENTATION(object);
 
     g_clear_handle_id(&self->priv->idle_id, g_source_remove);
+    gjs_dbus_implementation_clear_method_handler(self);
 
     G_OBJECT_CLASS(gjs_dbus_implementation_parent_class)->dispose(object);
 }
@@ -170,6 +197,7 @@ gjs_dbus_implementation_finalize(GObject *object) {
 
     g_dbus_interface_info_unref (self->priv->ifaceinfo);
     g_hash_table_destroy(self->priv->outstanding_properties);
+    g_hash_table_destroy(self->priv->dirty_properties);
 
     G_OBJECT_CLASS(gjs_dbus_implementation_parent_class)->finalize(object);
 }
@@ -250,6 +278,22 @@ gjs_dbus_implementation_flush (GDBusInterfaceSkeleton *skeleton) {
             g_variant_builder_add(&invalidated_props, "s", prop_name);
     }
 
+    // Each queued property is fetched and packed once, however many times it
+    // changed since the last flush
+    g_hash_table_iter_init(&iter, self->priv->dirty_properties);
+    while (g_hash_table_iter_next(&iter, (void**)&prop_name, NULL)) {
+        GVariant* value = NULL;
+
+        g_signal_emit(self, signals[SIGNAL_HANDLE_PROPERTY_GET], 0, prop_name,
+                      &value);
+        if (value) {
+            g_variant_builder_add(&changed_props, "{sv}", prop_name, value);
+            g_variant_unref(value);
+        } else {
+            g_variant_builder_add(&invalidated_props, "s", prop_name);
+        }
+    }
+
     GList *connections = g_dbus_interface_skeleton_get_connections(skeleton);
     const char *object_path = g_dbus_interface_skeleton_get_object_path(skeleton);
     GVariant *properties = g_variant_new("(s@a{sv}@as)",
@@ -273,6 +317,7 @@ gjs_dbus_implementation_flush (GDBusInterfaceSkeleton *skeleton) {
     g_list_free(connections);
 
     g_hash_table_remove_all(self->priv->outstanding_properties);
+    g_hash_table_remove_all(self->priv->dirty_properties);
     g_clear_handle_id(&self->priv->idle_id, g_source_remove);
 }
 
@@ -343,6 +388,31 @@ idle_cb (gpointer data) {
     return G_SOURCE_REMOVE;
 }
 
+/**
+ * gjs_dbus_implementation_set_method_handler:
+ * @self: a #GjsDBusImplementation
+ * @handler: (scope notified) (closure user_data) (allow-none): function to
+ *   call for each incoming method call, or %NULL to go back to the signal
+ * @user_data: data to pass to @handler
+ * @destroy: function to free @user_data when @handler is replaced or @self is
+ *   disposed
+ *
+ * Sets a function that is called directly for incoming method calls instead
+ * of emitting the handle-method-call signal, which saves going through signal
+ * emission and boxing each argument in a #GValue.
+ */
+void gjs_dbus_implementation_set_method_handler(
+    GjsDBusImplementation* self, GjsDBusImplementationMethodHandler handler,
+    void* user_data, GDestroyNotify destroy) {
+    g_return_if_fail(GJS_IS_DBUS_IMPLEMENTATION(self));
+
+    gjs_dbus_implementation_clear_method_handler(self);
+
+    self->priv->method_handler = handler;
+    self->priv->method_handler_data = user_data;
+    self->priv->method_handler_destroy = destroy;
+}
+
 /**
  * gjs_dbus_implementation_emit_property_changed:
  * @self: a #GjsDBusImplementation
@@ -357,12 +427,32 @@ gjs_dbus_implementation_emit_property_changed (GjsDBusImplementation *self,
                                                gchar                 *property,
                                                GVariant              *newvalue)
 {
+    g_hash_table_remove(self->priv->dirty_properties, property);
     g_hash_table_replace (self->priv->outstanding_properties, g_strdup (property), g_variant_ref (newvalue));
 
     if (!self->priv->idle_id)
         self->priv->idle_id = g_idle_add(idle_cb, self);
 }
 
+/**
+ * gjs_dbus_implementation_queue_property_changed:
+ * @self: a #GjsDBusImplementation
+ * @property: the name of the property that changed
+ *
+ * Like gjs_dbus_implementation_emit_property_changed(), but the new value is
+ * only retrieved, with the handle-property-get signal, when the queued
+ * PropertiesChanged signal is emitted. A property that changes many times in
+ * between is therefore only packed and sent once, with its latest value.
+ */
+void gjs_dbus_implementation_queue_property_changed(GjsDBusImplementation* self,
+                                                   const char* property) {
+    g_hash_table_remove(self->priv->outstanding_properties, property);
+    g_hash_table_add(self->priv->dirty_properties, g_strdup(property));
+
+    if (!self->priv->idle_id)
+        self->priv->idle_id = g_idle_add(idle_cb, self);
+}
+
 /**
  * gjs_dbus_implementation_emit_signal:
  * @self: a #GjsDBusImplementation
@@ -415,6 +505,7 @@ gjs_dbus_implementation_unexport(GjsDBusImplementation *self) {
     GDBusInterfaceSkeleton *skeleton = G_DBUS_INTERFACE_SKELETON(self);
 
     g_hash_table_remove_all(self->priv->outstanding_properties);
+    g_hash_table_remove_all(self->priv->dirty_properties);
     g_clear_handle_id(&self->priv->idle_id, g_source_remove);
 
     g_dbus_interface_skeleton_unexport(skeleton);
@@ -438,6 +529,7 @@ gjs_dbus_implementation_unexport_from_connection(GjsDBusImplementation *self,
 
     if (g_list_length(connections) <= 1) {
         g_hash_table_remove_all(self->priv->outstanding_properties);
+        g_hash_table_remove_all(self->priv->dirty_properties);
         g_clear_handle_id(&self->priv->idle_id, g_source_remove);
     }
 
@@ -52,12 +52,34 @@ struct _GjsDBusImplementationClass {
 };
 typedef struct _GjsDBusImplementationClass GjsDBusImplementationClass;
 
+/**
+ * GjsDBusImplementationMethodHandler:
+ * @self: the #GjsDBusImplementation
+ * @method_name: the name of the method that was called
+ * @parameters: the method's parameters
+ * @invocation: the #GDBusMethodInvocation to return a value or error on
+ * @user_data: the data passed to gjs_dbus_implementation_set_method_handler()
+ *
+ * Handles an incoming method call, like the handle-method-call signal.
+ */
+typedef void (*GjsDBusImplementationMethodHandler)(
+    GjsDBusImplementation* self, const char* method_name, GVariant* parameters,
+    GDBusMethodInvocation* invocation, void* user_data);
+
 GJS_EXPORT
 GType                  gjs_dbus_implementation_get_type (void);
 
+GJS_EXPORT
+void gjs_dbus_implementation_set_method_handler(
+    GjsDBusImplementation* self, GjsDBusImplementationMethodHandler handler,
+    void* user_data, GDestroyNotify destroy);
+
 GJS_EXPORT
 void                   gjs_dbus_implementation_emit_property_changed (GjsDBusImplementation *self, gchar *property, GVariant *newvalue);
 GJS_EXPORT
+void gjs_dbus_implementation_queue_property_changed(GjsDBusImplementation* self,
+                                                   const char* property);
+GJS_EXPORT
 void                   gjs_dbus_implementation_emit_signal           (GjsDBusImplementation *self, gchar *signal_name, GVariant *parameters);
 
 G_END_DECLS
@@ -0,0 +1,215 @@
+/* -*- mode: C; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * SPDX-License-Identifier: MIT OR LGPL-2.0-or-later
+ */
+
+#include <config.h>
+
+#include <string.h>  // for memmove
+
+#include <gio/gio.h>
+#include <glib-object.h>
+#include <glib.h>
+
+#include "libgjs-private/gjs-list-store.h"
+
+/**
+ * GjsArrayStore:
+ *
+ * A #GListModel backed by a plain array, for models that are rebuilt from JS
+ * in bulk. Unlike #GListStore, getting an item takes constant time, and
+ * gjs_array_store_splice() takes its additions as one array, which JS can
+ * pass in a single call.
+ */
+struct _GjsArrayStore {
+    GObject parent;
+
+    GType item_type;
+    GPtrArray* items;
+};
+
+enum {
+    PROP_0,
+    PROP_ITEM_TYPE,
+    PROP_LAST
+};
+
+static void gjs_array_store_list_model_init(GListModelInterface* iface);
+
+G_DEFINE_TYPE_WITH_CODE(GjsArrayStore, gjs_array_store, G_TYPE_OBJECT,
+                        G_IMPLEMENT_INTERFACE(G_TYPE_LIST_MODEL,
+                                              gjs_array_store_list_model_init));
+
+static GType gjs_array_store_get_item_type(GListModel* model) {
+    return GJS_ARRAY_STORE(model)->item_type;
+}
+
+static unsigned gjs_array_store_get_n_items(GListModel* model) {
+    return GJS_ARRAY_STORE(model)->items->len;
+}
+
+static void* gjs_array_store_get_item(GListModel* model, unsigned position) {
+    GjsArrayStore* self = GJS_ARRAY_STORE(model);
+
+    if (position >= self->items->len)
+        return NULL;
+    return g_object_ref(g_ptr_array_index(self->items, position));
+}
+
+static void gjs_array_store_list_model_init(GListModelInterface* iface) {
+    iface->get_item_type = gjs_array_store_get_item_type;
+    iface->get_n_items = gjs_array_store_get_n_items;
+    iface->get_item = gjs_array_store_get_item;
+}
+
+static void gjs_array_store_init(GjsArrayStore* self) {
+    self->items = g_ptr_array_new_with_free_func(g_object_unref);
+}
+
+static void gjs_array_store_finalize(GObject* object) {
+    GjsArrayStore* self = GJS_ARRAY_STORE(object);
+
+    g_ptr_array_unref(self->items);
+
+    G_OBJECT_CLASS(gjs_array_store_parent_class)->finalize(object);
+}
+
+static void gjs_array_store_get_property(GObject* object, unsigned prop_id,
+                                         GValue* value, GParamSpec* pspec) {
+    GjsArrayStore* self = GJS_ARRAY_STORE(object);
+
+    switch (prop_id) {
+        case PROP_ITEM_TYPE:
+            g_value_set_gtype(value, self->item_type);
+            break;
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+    }
+}
+
+static void gjs_array_store_set_property(GObject* object, unsigned prop_id,
+                                         const GValue* value,
+                                         GParamSpec* pspec) {
+    GjsArrayStore* self = GJS_ARRAY_STORE(object);
+
+    switch (prop_id) {
+        case PROP_ITEM_TYPE:
+            self->item_type = g_value_get_gtype(value);
+            if (!g_type_is_a(self->item_type, G_TYPE_OBJECT))
+                g_critical("GjsArrayStore item type must be a GObject type, "
+                           "not %s", g_type_name(self->item_type));
+            break;
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+    }
+}
+
+static void gjs_array_store_class_init(GjsArrayStoreClass* klass) {
+    GObjectClass* gobject_class = G_OBJECT_CLASS(klass);
+
+    gobject_class->finalize = gjs_array_store_finalize;
+    gobject_class->get_property = gjs_array_store_get_property;
+    gobject_class->set_property = gjs_array_store_set_property;
+
+    g_object_class_install_property(
+        gobject_class, PROP_ITEM_TYPE,
+        g_param_spec_gtype("item-type", "Item type",
+                           "The type of the items in the store",
+                           G_TYPE_OBJECT,
+                           G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY |
+                               G_PARAM_STATIC_STRINGS));
+}
+
+/**
+ * gjs_array_store_new:
+ * @item_type: the #GType of the items, which must be a #GObject type
+ *
+ * Returns: (transfer full): a new empty #GjsArrayStore
+ */
+GjsArrayStore* gjs_array_store_new(GType item_type) {
+    return g_object_new(GJS_TYPE_ARRAY_STORE, "item-type", item_type, NULL);
+}
+
+/**
+ * gjs_array_store_splice:
+ * @self: a #GjsArrayStore
+ * @position: the position at which to make the change
+ * @n_removals: the number of items to remove
+ * @additions: (array length=n_additions) (element-type GObject): the items to
+ *   add
+ * @n_additions: the number of items to add
+ *
+ * Removes @n_removals items and inserts @additions at @position, emitting
+ * #GListModel::items-changed once for the whole change.
+ */
+void gjs_array_store_splice(GjsArrayStore* self, unsigned position,
+                            unsigned n_removals, GObject** additions,
+                            unsigned n_additions) {
+    unsigned ix, old_len;
+
+    g_return_if_fail(GJS_IS_ARRAY_STORE(self));
+    g_return_if_fail(position <= self->items->len);
+    g_return_if_fail(n_removals <= self->items->len - position);
+    for (ix = 0; ix < n_additions; ix++)
+        g_return_if_fail(G_IS_OBJECT(additions[ix]) &&
+                         g_type_is_a(G_OBJECT_TYPE(additions[ix]),
+                                     self->item_type));
+
+    if (n_removals == 0 && n_additions == 0)
+        return;
+
+    if (n_removals > 0)
+        g_ptr_array_remove_range(self->items, position, n_removals);
+
+    if (n_additions > 0) {
+        old_len = self->items->len;
+        // Grow first, without unreffing anything, to make room in the middle
+        g_ptr_array_set_size(self->items, old_len + n_additions);
+        memmove(self->items->pdata + position + n_additions,
+                self->items->pdata + position,
+                (old_len - position) * sizeof(void*));
+        for (ix = 0; ix < n_additions; ix++)
+            self->items->pdata[position + ix] = g_object_ref(additions[ix]);
+    }
+
+    g_list_model_items_changed(G_LIST_MODEL(self), position, n_removals,
+                               n_additions);
+}
+
+/**
+ * gjs_list_model_get_items:
+ * @model: a #GListModel
+ * @position: the position of the first item to get
+ * @count: the maximum number of items to get
+ * @n_items: (out): the number of items returned
+ *
+ * Gets up to @count items of @model starting at @position, in one call.
+ *
+ * Returns: (array length=n_items) (transfer full) (element-type GObject):
+ *   the items
+ */
+GObject** gjs_list_model_get_items(GListModel* model, unsigned position,
+                                   unsigned count, unsigned* n_items) {
+    GObject** items;
+    unsigned ix, len;
+
+    g_return_val_if_fail(G_IS_LIST_MODEL(model), NULL);
+    g_return_val_if_fail(n_items, NULL);
+
+    len = g_list_model_get_n_items(model);
+    *n_items = position < len ? MIN(count, len - position) : 0;
+    if (*n_items == 0)
+        return NULL;
+
+    items = g_new(GObject*, *n_items);
+    if (GJS_IS_ARRAY_STORE(model)) {
+        GjsArrayStore* self = GJS_ARRAY_STORE(model);
+        for (ix = 0; ix < *n_items; ix++)
+            items[ix] = g_object_ref(g_ptr_array_index(self->items,
+                                                       position + ix));
+    } else {
+        for (ix = 0; ix < *n_items; ix++)
+            items[ix] = g_list_model_get_item(model, position + ix);
+    }
+    return items;
+}
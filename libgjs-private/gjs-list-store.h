@@ -0,0 +1,45 @@
+/* -*- mode: C; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * SPDX-License-Identifier: MIT OR LGPL-2.0-or-later
+ */
+
+#ifndef LIBGJS_PRIVATE_GJS_LIST_STORE_H_
+#define LIBGJS_PRIVATE_GJS_LIST_STORE_H_
+
+#include <gio/gio.h>
+#include <glib-object.h>
+#include <glib.h>
+
+#include "cjs/macros.h"
+
+G_BEGIN_DECLS
+
+#define GJS_TYPE_ARRAY_STORE              (gjs_array_store_get_type ())
+#define GJS_ARRAY_STORE(object)           (G_TYPE_CHECK_INSTANCE_CAST ((object), GJS_TYPE_ARRAY_STORE, GjsArrayStore))
+#define GJS_IS_ARRAY_STORE(object)        (G_TYPE_CHECK_INSTANCE_TYPE ((object), GJS_TYPE_ARRAY_STORE))
+
+typedef struct _GjsArrayStore GjsArrayStore;
+typedef struct _GjsArrayStoreClass GjsArrayStoreClass;
+
+struct _GjsArrayStoreClass {
+    GObjectClass parent_class;
+};
+
+GJS_EXPORT
+GType gjs_array_store_get_type(void);
+
+GJS_EXPORT
+GjsArrayStore* gjs_array_store_new(GType item_type);
+
+GJS_EXPORT
+void gjs_array_store_splice(GjsArrayStore* self, unsigned position,
+                            unsigned n_removals, GObject** additions,
+                            unsigned n_additions);
+
+GJS_EXPORT
+GObject** gjs_list_model_get_items(GListModel* model, unsigned position,
+                                   unsigned count, unsigned* n_items);
+
+G_END_DECLS
+
+#endif /* LIBGJS_PRIVATE_GJS_LIST_STORE_H_ */
@@ -0,0 +1,256 @@
+/* -*- mode: C; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * SPDX-License-Identifier: MIT OR LGPL-2.0-or-later
+ */
+
+#include <config.h>
+
+#include <stdint.h>
+
+#include <gio/gio.h>
+#include <glib-object.h>
+#include <glib.h>
+
+#include "libgjs-private/gjs-stream-pump.h"
+
+/* Same as the buffer size used by g_output_stream_splice() */
+#define GJS_STREAM_PUMP_CHUNK_SIZE 8192
+
+typedef struct {
+    GInputStream* source;
+    GOutputStream* target;
+    GOutputStreamSpliceFlags flags;
+    int io_priority;
+
+    gint64 progress_interval_usec;
+    gint64 last_progress_time;
+    gint64 n_bytes;
+    gint64 n_bytes_reported;
+    GjsStreamProgressFunc progress;
+    void* progress_data;
+    GDestroyNotify progress_destroy;
+
+    /* Error from the copy, returned after the streams have been closed */
+    GError* error;
+    uint8_t buffer[GJS_STREAM_PUMP_CHUNK_SIZE];
+} GjsStreamPump;
+
+static void gjs_stream_pump_free(void* data) {
+    GjsStreamPump* pump = data;
+
+    if (pump->progress_destroy)
+        pump->progress_destroy(pump->progress_data);
+    g_clear_error(&pump->error);
+    g_object_unref(pump->source);
+    g_object_unref(pump->target);
+    g_free(pump);
+}
+
+static void gjs_stream_pump_report_progress(GjsStreamPump* pump,
+                                            gboolean force) {
+    if (!pump->progress || pump->n_bytes == pump->n_bytes_reported)
+        return;
+
+    gint64 now = g_get_monotonic_time();
+    if (!force &&
+        now - pump->last_progress_time < pump->progress_interval_usec)
+        return;
+
+    pump->last_progress_time = now;
+    pump->n_bytes_reported = pump->n_bytes;
+    pump->progress(pump->n_bytes, pump->progress_data);
+}
+
+static void gjs_stream_pump_complete(GTask* task) {
+    GjsStreamPump* pump = g_task_get_task_data(task);
+
+    if (pump->error) {
+        g_task_return_error(task, g_steal_pointer(&pump->error));
+    } else {
+        gjs_stream_pump_report_progress(pump, TRUE);
+        g_task_return_int(task, pump->n_bytes);
+    }
+    g_object_unref(task);
+}
+
+static void on_target_closed(GObject* object, GAsyncResult* result,
+                             void* user_data) {
+    GTask* task = user_data;
+    GjsStreamPump* pump = g_task_get_task_data(task);
+
+    /* As in g_output_stream_splice(), an error from closing is only reported
+     * if the copy itself succeeded */
+    g_output_stream_close_finish(G_OUTPUT_STREAM(object), result,
+                                 pump->error ? NULL : &pump->error);
+    gjs_stream_pump_complete(task);
+}
+
+static void gjs_stream_pump_close_target(GTask* task) {
+    GjsStreamPump* pump = g_task_get_task_data(task);
+
+    if (!(pump->flags & G_OUTPUT_STREAM_SPLICE_CLOSE_TARGET)) {
+        gjs_stream_pump_complete(task);
+        return;
+    }
+
+    g_output_stream_close_async(pump->target, pump->io_priority, NULL,
+                                on_target_closed, task);
+}
+
+static void on_source_closed(GObject* object, GAsyncResult* result,
+                             void* user_data) {
+    GTask* task = user_data;
+    GjsStreamPump* pump = g_task_get_task_data(task);
+
+    g_input_stream_close_finish(G_INPUT_STREAM(object), result,
+                                pump->error ? NULL : &pump->error);
+    gjs_stream_pump_close_target(task);
+}
+
+static void gjs_stream_pump_close(GTask* task) {
+    GjsStreamPump* pump = g_task_get_task_data(task);
+
+    if (!(pump->flags & G_OUTPUT_STREAM_SPLICE_CLOSE_SOURCE)) {
+        gjs_stream_pump_close_target(task);
+        return;
+    }
+
+    g_input_stream_close_async(pump->source, pump->io_priority, NULL,
+                               on_source_closed, task);
+}
+
+static void gjs_stream_pump_read(GTask* task);
+
+static void on_chunk_written(GObject* object, GAsyncResult* result,
+                             void* user_data) {
+    GTask* task = user_data;
+    GjsStreamPump* pump = g_task_get_task_data(task);
+    gsize n_written;
+
+    gboolean ok = g_output_stream_write_all_finish(
+        G_OUTPUT_STREAM(object), result, &n_written, &pump->error);
+    pump->n_bytes += n_written;
+    if (!ok) {
+        gjs_stream_pump_close(task);
+        return;
+    }
+
+    gjs_stream_pump_report_progress(pump, FALSE);
+    gjs_stream_pump_read(task);
+}
+
+static void on_chunk_read(GObject* object, GAsyncResult* result,
+                          void* user_data) {
+    GTask* task = user_data;
+    GjsStreamPump* pump = g_task_get_task_data(task);
+
+    gssize n_read = g_input_stream_read_finish(G_INPUT_STREAM(object), result,
+                                               &pump->error);
+    if (n_read <= 0) {
+        /* End of stream, or error */
+        gjs_stream_pump_close(task);
+        return;
+    }
+
+    g_output_stream_write_all_async(pump->target, pump->buffer, n_read,
+                                    pump->io_priority,
+                                    g_task_get_cancellable(task),
+                                    on_chunk_written, task);
+}
+
+static void gjs_stream_pump_read(GTask* task) {
+    GjsStreamPump* pump = g_task_get_task_data(task);
+
+    g_input_stream_read_async(pump->source, pump->buffer,
+                              GJS_STREAM_PUMP_CHUNK_SIZE, pump->io_priority,
+                              g_task_get_cancellable(task), on_chunk_read,
+                              task);
+}
+
+static void on_spliced(GObject* object, GAsyncResult* result,
+                       void* user_data) {
+    GTask* task = user_data;
+    GError* error = NULL;
+
+    gssize n_bytes =
+        g_output_stream_splice_finish(G_OUTPUT_STREAM(object), result, &error);
+    if (n_bytes < 0)
+        g_task_return_error(task, error);
+    else
+        g_task_return_int(task, n_bytes);
+    g_object_unref(task);
+}
+
+/**
+ * gjs_output_stream_splice_with_progress_async:
+ * @target: the #GOutputStream to copy into
+ * @source: the #GInputStream to copy from
+ * @flags: #GOutputStreamSpliceFlags, as for g_output_stream_splice_async()
+ * @io_priority: the I/O priority of the request
+ * @progress_interval_ms: minimum time between calls to @progress
+ * @progress: (scope notified) (closure progress_data) (nullable): function to
+ *   call with the number of bytes copied so far
+ * @progress_data: the data to pass to @progress
+ * @progress_destroy: (destroy progress_data): called when @progress is no
+ *   longer needed
+ * @cancellable: (nullable): optional #GCancellable object
+ * @callback: (scope async) (closure user_data): called when the copy is done
+ * @user_data: the data to pass to @callback
+ *
+ * Copies @source into @target like g_output_stream_splice_async(), entirely
+ * in C, calling @progress at most once every @progress_interval_ms
+ * milliseconds, and once more with the final count when the copy succeeds.
+ * This lets JS follow a long transfer without a read and write round trip
+ * through JS for every chunk.
+ *
+ * If @progress is %NULL, this is the same as g_output_stream_splice_async().
+ */
+void gjs_output_stream_splice_with_progress_async(
+    GOutputStream* target, GInputStream* source, GOutputStreamSpliceFlags flags,
+    int io_priority, unsigned progress_interval_ms,
+    GjsStreamProgressFunc progress, void* progress_data,
+    GDestroyNotify progress_destroy, GCancellable* cancellable,
+    GAsyncReadyCallback callback, void* user_data) {
+    g_return_if_fail(G_IS_OUTPUT_STREAM(target));
+    g_return_if_fail(G_IS_INPUT_STREAM(source));
+
+    GTask* task = g_task_new(NULL, cancellable, callback, user_data);
+    g_task_set_source_tag(task, gjs_output_stream_splice_with_progress_async);
+
+    if (!progress) {
+        if (progress_destroy)
+            progress_destroy(progress_data);
+        g_output_stream_splice_async(target, source, flags, io_priority,
+                                     cancellable, on_spliced, task);
+        return;
+    }
+
+    GjsStreamPump* pump = g_new0(GjsStreamPump, 1);
+    pump->source = g_object_ref(source);
+    pump->target = g_object_ref(target);
+    pump->flags = flags;
+    pump->io_priority = io_priority;
+    pump->progress_interval_usec =
+        (gint64)progress_interval_ms * G_TIME_SPAN_MILLISECOND;
+    pump->last_progress_time = g_get_monotonic_time();
+    pump->progress = progress;
+    pump->progress_data = progress_data;
+    pump->progress_destroy = progress_destroy;
+    g_task_set_task_data(task, pump, gjs_stream_pump_free);
+
+    gjs_stream_pump_read(task);
+}
+
+/**
+ * gjs_output_stream_splice_with_progress_finish:
+ * @result: the #GAsyncResult passed to the callback
+ * @error: return location for an error
+ *
+ * Returns: the number of bytes copied, or -1 on error
+ */
+gint64 gjs_output_stream_splice_with_progress_finish(GAsyncResult* result,
+                                                     GError** error) {
+    g_return_val_if_fail(g_task_is_valid(result, NULL), -1);
+
+    return g_task_propagate_int(G_TASK(result), error);
+}
@@ -0,0 +1,40 @@
+/* -*- mode: C; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * SPDX-License-Identifier: MIT OR LGPL-2.0-or-later
+ */
+
+#ifndef LIBGJS_PRIVATE_GJS_STREAM_PUMP_H_
+#define LIBGJS_PRIVATE_GJS_STREAM_PUMP_H_
+
+#include <gio/gio.h>
+#include <glib-object.h>
+#include <glib.h>
+
+#include "cjs/macros.h"
+
+G_BEGIN_DECLS
+
+/**
+ * GjsStreamProgressFunc:
+ * @n_bytes: total number of bytes copied so far
+ * @user_data: the data passed along with the callback
+ *
+ * Reports the progress of gjs_output_stream_splice_with_progress_async().
+ */
+typedef void (*GjsStreamProgressFunc)(gint64 n_bytes, void* user_data);
+
+GJS_EXPORT
+void gjs_output_stream_splice_with_progress_async(
+    GOutputStream* target, GInputStream* source, GOutputStreamSpliceFlags flags,
+    int io_priority, unsigned progress_interval_ms,
+    GjsStreamProgressFunc progress, void* progress_data,
+    GDestroyNotify progress_destroy, GCancellable* cancellable,
+    GAsyncReadyCallback callback, void* user_data);
+
+GJS_EXPORT
+gint64 gjs_output_stream_splice_with_progress_finish(GAsyncResult* result,
+                                                     GError** error);
+
+G_END_DECLS
+
+#endif /* LIBGJS_PRIVATE_GJS_STREAM_PUMP_H_ */
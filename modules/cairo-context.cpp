@@ -22,6 +22,9 @@
 
 #include <config.h>
 
+#include <inttypes.h>  // for PRIu32
+#include <stdint.h>
+
 #include <vector>
 
 #include <cairo-gobject.h>
@@ -33,6 +36,8 @@
 #include <js/CallArgs.h>
 #include <js/Class.h>
 #include <js/Conversions.h>
+#include <js/GCAPI.h>  // for AutoCheckCannotGC
+#include <js/GCHashTable.h>  // for WeakCache
 #include <js/PropertyDescriptor.h>  // for JSPROP_READONLY
 #include <js/PropertySpec.h>
 #include <js/RootingAPI.h>
@@ -40,10 +45,13 @@
 #include <js/Utility.h>  // for UniqueChars
 #include <js/Value.h>
 #include <jsapi.h>  // for JS_SetElement
+#include <jsfriendapi.h>  // for JS_IsFloat64Array, GetFloat64ArrayLengthAndData
+#include <jspubtd.h>  // for JSProto_TypeError
 
 #include "gi/arg-inl.h"
 #include "gi/arg.h"
 #include "gi/foreign.h"
+#include "cjs/context-private.h"
 #include "cjs/jsapi-class.h"
 #include "cjs/jsapi-util-args.h"
 #include "cjs/jsapi-util.h"
@@ -402,6 +410,8 @@ dispose_func(JSContext *context,
     if (!cr)
         return true;
 
+    // Once the reference is dropped, the cairo_t's address may be reused
+    GjsContextPrivate::from_cx(context)->cairo_context_table().remove(cr);
     cairo_destroy(cr);
     JS_SetPrivate(obj, nullptr);
 
@@ -474,6 +484,271 @@ copyPathFlat_func(JSContext *context,
     return true;
 }
 
+// Opcodes for Context.executePath() and ImageSurface.renderAsync(), exposed to
+// JS as Cairo.DrawOp. The ones that only build paths come first and are also
+// exposed as Cairo.PathOp; the first four of those have the same values as
+// cairo_path_data_type_t.
+enum class DrawOp : uint8_t {
+    MOVE_TO,
+    LINE_TO,
+    CURVE_TO,
+    CLOSE_PATH,
+    REL_MOVE_TO,
+    REL_LINE_TO,
+    REL_CURVE_TO,
+    NEW_SUB_PATH,
+    RECTANGLE,
+    ARC,
+    ARC_NEGATIVE,
+    N_PATH_OPS,
+    NEW_PATH = N_PATH_OPS,
+    SAVE,
+    RESTORE,
+    TRANSLATE,
+    SCALE,
+    ROTATE,
+    SET_SOURCE_RGB,
+    SET_SOURCE_RGBA,
+    SET_LINE_WIDTH,
+    SET_LINE_CAP,
+    SET_LINE_JOIN,
+    SET_OPERATOR,
+    SET_FILL_RULE,
+    FILL,
+    FILL_PRESERVE,
+    STROKE,
+    STROKE_PRESERVE,
+    CLIP,
+    RESET_CLIP,
+    PAINT,
+    PAINT_WITH_ALPHA,
+    SET_TOLERANCE,
+    IDENTITY_MATRIX,
+    SET_MITER_LIMIT,
+    N_OPS
+};
+
+// Number of operands following each opcode, indexed by DrawOp
+static constexpr const unsigned draw_op_n_args[] = {
+    2, 2, 6, 0, 2, 2, 6, 0, 4, 5, 5,        // path
+    0, 0, 0, 2, 2, 1, 3, 4, 1, 1, 1, 1, 1,  // state
+    0, 0, 0, 0, 0, 0, 0, 1, 1, 0, 1};       // drawing
+static_assert(G_N_ELEMENTS(draw_op_n_args) == size_t(DrawOp::N_OPS));
+
+// Largest value of the enum operand of the opcodes that take one, so that
+// values that Cairo doesn't know never reach it from a helper thread
+[[nodiscard]] static bool draw_op_enum_max(DrawOp op, unsigned* max) {
+    switch (op) {
+        case DrawOp::SET_LINE_CAP:
+            *max = CAIRO_LINE_CAP_SQUARE;
+            return true;
+        case DrawOp::SET_LINE_JOIN:
+            *max = CAIRO_LINE_JOIN_BEVEL;
+            return true;
+        case DrawOp::SET_OPERATOR:
+            *max = CAIRO_OPERATOR_HSL_LUMINOSITY;
+            return true;
+        case DrawOp::SET_FILL_RULE:
+            *max = CAIRO_FILL_RULE_EVEN_ODD;
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool gjs_cairo_validate_commands(const double* ops, uint32_t length,
+                                 bool path_only, uint32_t* bad_ix) {
+    double n_ops = double(path_only ? DrawOp::N_PATH_OPS : DrawOp::N_OPS);
+    for (uint32_t ix = 0; ix < length;) {
+        double op = ops[ix];
+        if (!(op >= 0 && op < n_ops) || op != unsigned(op) ||
+            length - ix - 1 < draw_op_n_args[unsigned(op)]) {
+            *bad_ix = ix;
+            return false;
+        }
+
+        unsigned max;
+        if (draw_op_enum_max(static_cast<DrawOp>(op), &max)) {
+            double value = ops[ix + 1];
+            if (!(value >= 0 && value <= max) || value != unsigned(value)) {
+                *bad_ix = ix;
+                return false;
+            }
+        }
+
+        ix += draw_op_n_args[unsigned(op)] + 1;
+    }
+    return true;
+}
+
+void gjs_cairo_execute_commands(cairo_t* cr, const double* ops,
+                                uint32_t length) {
+    for (uint32_t ix = 0; ix < length;) {
+        auto op = static_cast<DrawOp>(ops[ix]);
+        const double* a = ops + ix + 1;
+        switch (op) {
+            case DrawOp::MOVE_TO:
+                cairo_move_to(cr, a[0], a[1]);
+                break;
+            case DrawOp::LINE_TO:
+                cairo_line_to(cr, a[0], a[1]);
+                break;
+            case DrawOp::CURVE_TO:
+                cairo_curve_to(cr, a[0], a[1], a[2], a[3], a[4], a[5]);
+                break;
+            case DrawOp::CLOSE_PATH:
+                cairo_close_path(cr);
+                break;
+            case DrawOp::REL_MOVE_TO:
+                cairo_rel_move_to(cr, a[0], a[1]);
+                break;
+            case DrawOp::REL_LINE_TO:
+                cairo_rel_line_to(cr, a[0], a[1]);
+                break;
+            case DrawOp::REL_CURVE_TO:
+                cairo_rel_curve_to(cr, a[0], a[1], a[2], a[3], a[4], a[5]);
+                break;
+            case DrawOp::NEW_SUB_PATH:
+                cairo_new_sub_path(cr);
+                break;
+            case DrawOp::RECTANGLE:
+                cairo_rectangle(cr, a[0], a[1], a[2], a[3]);
+                break;
+            case DrawOp::ARC:
+                cairo_arc(cr, a[0], a[1], a[2], a[3], a[4]);
+                break;
+            case DrawOp::ARC_NEGATIVE:
+                cairo_arc_negative(cr, a[0], a[1], a[2], a[3], a[4]);
+                break;
+            case DrawOp::NEW_PATH:
+                cairo_new_path(cr);
+                break;
+            case DrawOp::SAVE:
+                cairo_save(cr);
+                break;
+            case DrawOp::RESTORE:
+                cairo_restore(cr);
+                break;
+            case DrawOp::TRANSLATE:
+                cairo_translate(cr, a[0], a[1]);
+                break;
+            case DrawOp::SCALE:
+                cairo_scale(cr, a[0], a[1]);
+                break;
+            case DrawOp::ROTATE:
+                cairo_rotate(cr, a[0]);
+                break;
+            case DrawOp::SET_SOURCE_RGB:
+                cairo_set_source_rgb(cr, a[0], a[1], a[2]);
+                break;
+            case DrawOp::SET_SOURCE_RGBA:
+                cairo_set_source_rgba(cr, a[0], a[1], a[2], a[3]);
+                break;
+            case DrawOp::SET_LINE_WIDTH:
+                cairo_set_line_width(cr, a[0]);
+                break;
+            case DrawOp::SET_LINE_CAP:
+                cairo_set_line_cap(cr, cairo_line_cap_t(a[0]));
+                break;
+            case DrawOp::SET_LINE_JOIN:
+                cairo_set_line_join(cr, cairo_line_join_t(a[0]));
+                break;
+            case DrawOp::SET_OPERATOR:
+                cairo_set_operator(cr, cairo_operator_t(a[0]));
+                break;
+            case DrawOp::SET_FILL_RULE:
+                cairo_set_fill_rule(cr, cairo_fill_rule_t(a[0]));
+                break;
+            case DrawOp::FILL:
+                cairo_fill(cr);
+                break;
+            case DrawOp::FILL_PRESERVE:
+                cairo_fill_preserve(cr);
+                break;
+            case DrawOp::STROKE:
+                cairo_stroke(cr);
+                break;
+            case DrawOp::STROKE_PRESERVE:
+                cairo_stroke_preserve(cr);
+                break;
+            case DrawOp::CLIP:
+                cairo_clip(cr);
+                break;
+            case DrawOp::RESET_CLIP:
+                cairo_reset_clip(cr);
+                break;
+            case DrawOp::PAINT:
+                cairo_paint(cr);
+                break;
+            case DrawOp::PAINT_WITH_ALPHA:
+                cairo_paint_with_alpha(cr, a[0]);
+                break;
+            case DrawOp::SET_TOLERANCE:
+                cairo_set_tolerance(cr, a[0]);
+                break;
+            case DrawOp::IDENTITY_MATRIX:
+                cairo_identity_matrix(cr);
+                break;
+            case DrawOp::SET_MITER_LIMIT:
+                cairo_set_miter_limit(cr, a[0]);
+                break;
+            default:
+                g_assert_not_reached();
+        }
+        ix += draw_op_n_args[unsigned(op)] + 1;
+    }
+}
+
+// Builds a path from a Float64Array holding a sequence of opcodes, each
+// followed by its operands, so drawing many segments costs one call from JS.
+// The whole array is checked before the path is changed.
+GJS_JSAPI_RETURN_CONVENTION
+static bool
+executePath_func(JSContext *context,
+                 unsigned   argc,
+                 JS::Value *vp)
+{
+    GJS_GET_PRIV(context, argc, vp, argv, obj, cairo_t, cr);
+    if (!cr)
+        return true;
+
+    JS::RootedObject ops_obj(context);
+    if (!gjs_parse_call_args(context, "executePath", argv, "o",
+                             "ops", &ops_obj))
+        return false;
+
+    if (!JS_IsFloat64Array(ops_obj)) {
+        gjs_throw_custom(context, JSProto_TypeError, nullptr,
+                         "Context.executePath() expects a Float64Array");
+        return false;
+    }
+
+    uint32_t bad_ix;
+    bool valid;
+    {
+        JS::AutoCheckCannotGC nogc;
+        uint32_t length;
+        bool is_shared;
+        double* ops;
+        js::GetFloat64ArrayLengthAndData(ops_obj, &length, &is_shared, &ops);
+
+        valid = gjs_cairo_validate_commands(ops, length, /* path_only = */ true,
+                                            &bad_ix);
+        if (valid)
+            gjs_cairo_execute_commands(cr, ops, length);
+    }
+
+    if (!valid) {
+        gjs_throw(context,
+                  "Invalid or truncated path command at index %" PRIu32,
+                  bad_ix);
+        return false;
+    }
+
+    argv.rval().setUndefined();
+    return gjs_cairo_check_status(context, cairo_status(cr), "context");
+}
+
 GJS_JSAPI_RETURN_CONVENTION
 static bool
 mask_func(JSContext *context,
@@ -868,6 +1143,7 @@ JSFunctionSpec gjs_cairo_context_proto_funcs[] = {
     JS_FN("curveTo", curveTo_func, 0, 0),
     JS_FN("deviceToUser", deviceToUser_func, 0, 0),
     JS_FN("deviceToUserDistance", deviceToUserDistance_func, 0, 0),
+    JS_FN("executePath", executePath_func, 0, 0),
     JS_FN("fill", fill_func, 0, 0),
     JS_FN("fillPreserve", fillPreserve_func, 0, 0),
     JS_FN("fillExtents", fillExtents_func, 0, 0),
@@ -960,6 +1236,13 @@ JSObject *
 gjs_cairo_context_from_context(JSContext *context,
                                cairo_t *cr)
 {
+    // Draw signal handlers get the same cairo_t on each emission for as long as
+    // it lives, so reuse its wrapper. The wrapper holds a reference on the
+    // cairo_t, so the address can't be reused while the wrapper is alive.
+    GjsContextPrivate* gjs = GjsContextPrivate::from_cx(context);
+    if (auto p = gjs->cairo_context_table().lookup(cr))
+        return p->value();
+
     JS::RootedObject proto(context, gjs_cairo_context_get_proto(context));
     JS::RootedObject object(context,
         JS_NewObjectWithGivenProto(context, &gjs_cairo_context_class, proto));
@@ -968,6 +1251,11 @@ gjs_cairo_context_from_context(JSContext *context,
 
     _gjs_cairo_context_construct_internal(object, cr);
 
+    if (!gjs->cairo_context_table().putNew(cr, object)) {
+        JS_ReportOutOfMemory(context);
+        return nullptr;
+    }
+
     return object;
 }
 
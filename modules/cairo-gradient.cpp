@@ -22,14 +22,19 @@
 
 #include <config.h>
 
+#include <stdint.h>
+
 #include <cairo.h>
 
 #include <js/CallArgs.h>
 #include <js/Class.h>
+#include <js/GCAPI.h>  // for AutoCheckCannotGC
 #include <js/PropertyDescriptor.h>  // for JSPROP_READONLY
 #include <js/PropertySpec.h>
 #include <js/RootingAPI.h>
 #include <js/TypeDecls.h>
+#include <jsfriendapi.h>  // for JS_IsFloat64Array, GetFloat64ArrayLengthAndData
+#include <jspubtd.h>  // for JSProto_TypeError
 
 #include "cjs/jsapi-class.h"
 #include "cjs/jsapi-util-args.h"
@@ -116,9 +121,67 @@ addColorStopRGBA_func(JSContext *context,
     return true;
 }
 
+/*
+ * addColorStops(stops):
+ *
+ * Adds all the color stops in a Float64Array, which holds five numbers for
+ * each stop: offset, red, green, blue, and alpha.
+ */
+GJS_JSAPI_RETURN_CONVENTION
+static bool
+addColorStops_func(JSContext *context,
+                   unsigned   argc,
+                   JS::Value *vp)
+{
+    GJS_GET_THIS(context, argc, vp, argv, obj);
+    JS::RootedObject stops(context);
+
+    if (!gjs_parse_call_args(context, "addColorStops", argv, "o",
+                             "stops", &stops))
+        return false;
+
+    cairo_pattern_t* pattern = gjs_cairo_pattern_get_pattern(context, obj);
+    if (!pattern)
+        return false;
+
+    if (!JS_IsFloat64Array(stops)) {
+        gjs_throw_custom(context, JSProto_TypeError, nullptr,
+                         "Gradient.addColorStops() expects a Float64Array");
+        return false;
+    }
+
+    uint32_t length;
+    {
+        JS::AutoCheckCannotGC nogc;
+        bool is_shared;
+        double* data;
+        js::GetFloat64ArrayLengthAndData(stops, &length, &is_shared, &data);
+
+        if (length % 5 == 0) {
+            for (uint32_t ix = 0; ix < length; ix += 5)
+                cairo_pattern_add_color_stop_rgba(pattern, data[ix],
+                                                  data[ix + 1], data[ix + 2],
+                                                  data[ix + 3], data[ix + 4]);
+        }
+    }
+
+    if (length % 5 != 0) {
+        gjs_throw(context,
+                  "Gradient.addColorStops() expects five numbers per stop");
+        return false;
+    }
+
+    if (!gjs_cairo_check_status(context, cairo_pattern_status(pattern), "pattern"))
+        return false;
+
+    argv.rval().setUndefined();
+    return true;
+}
+
 JSFunctionSpec gjs_cairo_gradient_proto_funcs[] = {
     JS_FN("addColorStopRGB", addColorStopRGB_func, 0, 0),
     JS_FN("addColorStopRGBA", addColorStopRGBA_func, 0, 0),
+    JS_FN("addColorStops", addColorStops_func, 0, 0),
     // getColorStopRGB
     // getColorStopRGBA
     JS_FS_END};
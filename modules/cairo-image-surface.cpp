@@ -22,19 +22,37 @@
 
 #include <config.h>
 
+#include <inttypes.h>  // for PRIu32
+#include <stddef.h>  // for size_t
+#include <stdint.h>
+
+#include <string.h>  // for memcpy
+
+#include <vector>
+
 #include <cairo.h>
+#include <glib-object.h>
 #include <glib.h>
 
+#include <js/ArrayBuffer.h>
 #include <js/CallArgs.h>
 #include <js/Class.h>
+#include <js/GCAPI.h>  // for AutoCheckCannotGC
 #include <js/PropertyDescriptor.h>  // for JSPROP_READONLY
 #include <js/PropertySpec.h>
+#include <js/Promise.h>
 #include <js/RootingAPI.h>
 #include <js/TypeDecls.h>
-#include <jsapi.h>  // for JS_NewObjectWithGivenProto
+#include <js/Utility.h>  // for js_free
+#include <jsapi.h>  // for JS_NewObjectWithGivenProto, JSAutoRealm
+#include <jsfriendapi.h>  // for JS_NewUint8ArrayWithBuffer, JS_IsFloat64Array
+#include <jspubtd.h>  // for JSProto_TypeError
 
+#include "gi/boxed.h"
+#include "cjs/context-private.h"
 #include "cjs/jsapi-class.h"
 #include "cjs/jsapi-util-args.h"
+#include "cjs/jsapi-util-root.h"
 #include "cjs/jsapi-util.h"
 #include "cjs/macros.h"
 #include "modules/cairo-private.h"
@@ -119,6 +137,363 @@ createFromPNG_func(JSContext *context,
     return true;
 }
 
+struct PNGReadCursor {
+    const uint8_t* data;
+    size_t remaining;
+};
+
+static cairo_status_t read_png_from_bytes(void* closure, unsigned char* data,
+                                          unsigned length) {
+    auto* cursor = static_cast<PNGReadCursor*>(closure);
+    if (length > cursor->remaining)
+        return CAIRO_STATUS_READ_ERROR;
+    memcpy(data, cursor->data, length);
+    cursor->data += length;
+    cursor->remaining -= length;
+    return CAIRO_STATUS_SUCCESS;
+}
+
+/*
+ * createFromPNGBytes(bytes):
+ *
+ * Creates a surface from PNG data in a GLib.Bytes, without going through a
+ * file.
+ */
+GJS_JSAPI_RETURN_CONVENTION
+static bool
+createFromPNGBytes_func(JSContext *context,
+                        unsigned   argc,
+                        JS::Value *vp)
+{
+    JS::CallArgs argv = JS::CallArgsFromVp (argc, vp);
+    JS::RootedObject bytes_obj(context);
+
+    if (!gjs_parse_call_args(context, "createFromPNGBytes", argv, "o",
+                             "bytes", &bytes_obj))
+        return false;
+
+    if (!BoxedBase::typecheck(context, bytes_obj, nullptr, G_TYPE_BYTES))
+        return false;
+
+    auto* bytes = BoxedBase::to_c_ptr<GBytes>(context, bytes_obj);
+    if (!bytes)
+        return false;
+
+    PNGReadCursor cursor;
+    cursor.data = static_cast<const uint8_t*>(
+        g_bytes_get_data(bytes, &cursor.remaining));
+    cairo_surface_t* surface =
+        cairo_image_surface_create_from_png_stream(read_png_from_bytes, &cursor);
+
+    if (!gjs_cairo_check_status(context, cairo_surface_status(surface), "surface"))
+        return false;
+
+    JS::RootedObject surface_wrapper(
+        context, gjs_cairo_image_surface_from_surface(context, surface));
+    cairo_surface_destroy(surface);
+    if (!surface_wrapper)
+        return false;
+
+    argv.rval().setObject(*surface_wrapper);
+    return true;
+}
+
+static const cairo_user_data_key_t stolen_data_key = {};
+
+/*
+ * createForData(data, format, width, height, stride):
+ *
+ * Creates a surface that draws directly into the memory of @data, without
+ * copying it. @data is an ArrayBuffer whose contents are transferred to the
+ * surface, leaving it detached; use getData() to get at the pixels afterwards.
+ */
+GJS_JSAPI_RETURN_CONVENTION
+static bool
+createForData_func(JSContext *context,
+                   unsigned   argc,
+                   JS::Value *vp)
+{
+    JS::CallArgs argv = JS::CallArgsFromVp (argc, vp);
+    JS::RootedObject buffer(context);
+    cairo_format_t format;
+    int32_t width, height, stride;
+
+    if (!gjs_parse_call_args(context, "createForData", argv, "oiiii",
+                             "data", &buffer,
+                             "format", &format,
+                             "width", &width,
+                             "height", &height,
+                             "stride", &stride))
+        return false;
+
+    if (!JS::IsArrayBufferObject(buffer)) {
+        gjs_throw_custom(context, JSProto_TypeError, nullptr,
+                         "ImageSurface.createForData() expects an ArrayBuffer");
+        return false;
+    }
+
+    if (width < 0 || height < 0 ||
+        stride < cairo_format_stride_for_width(format, width)) {
+        gjs_throw(context, "Invalid stride %d for format %d and width %d",
+                  stride, format, width);
+        return false;
+    }
+
+    size_t size = size_t(stride) * height;
+    if (JS::GetArrayBufferByteLength(buffer) < size) {
+        gjs_throw(context,
+                  "ArrayBuffer of %u bytes is too small for %d rows of %d "
+                  "bytes",
+                  JS::GetArrayBufferByteLength(buffer), height, stride);
+        return false;
+    }
+
+    void* data = JS::StealArrayBufferContents(context, buffer);
+    if (!data)
+        return false;
+
+    cairo_surface_t* surface = cairo_image_surface_create_for_data(
+        static_cast<unsigned char*>(data), format, width, height, stride);
+    if (cairo_surface_status(surface) == CAIRO_STATUS_SUCCESS)
+        cairo_surface_set_user_data(surface, &stolen_data_key, data, js_free);
+    else
+        js_free(data);
+
+    if (!gjs_cairo_check_status(context, cairo_surface_status(surface), "surface"))
+        return false;
+
+    JS::RootedObject surface_wrapper(
+        context, gjs_cairo_image_surface_from_surface(context, surface));
+    cairo_surface_destroy(surface);
+    if (!surface_wrapper)
+        return false;
+
+    argv.rval().setObject(*surface_wrapper);
+    return true;
+}
+
+// State of a renderAsync() call, handed to a thread of the pool and back
+struct GjsCairoRender {
+    JSContext* cx;
+    GMainContext* main_context;
+    GjsMaybeOwned<JSObject*> promise;
+
+    std::vector<double> ops;
+    cairo_format_t format;
+    int width, height;
+    cairo_surface_t* surface = nullptr;
+    cairo_status_t status = CAIRO_STATUS_SUCCESS;
+
+    GjsCairoRender(JSContext* context, cairo_format_t fmt, int w, int h)
+        : cx(context),
+          main_context(g_main_context_ref_thread_default()),
+          format(fmt),
+          width(w),
+          height(h) {}
+
+    ~GjsCairoRender() {
+        promise.reset();
+        if (surface)
+            cairo_surface_destroy(surface);
+        g_main_context_unref(main_context);
+    }
+};
+
+static void render_context_destroyed(JS::HandleObject, void* data) {
+    static_cast<GjsCairoRender*>(data)->promise.reset();
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool render_finish(GjsCairoRender* render, JS::HandleObject promise) {
+    JSContext* cx = render->cx;
+    if (!gjs_cairo_check_status(cx, render->status, "surface"))
+        return false;
+
+    JS::RootedObject surface_wrapper(
+        cx, gjs_cairo_image_surface_from_surface(cx, render->surface));
+    if (!surface_wrapper)
+        return false;
+
+    JS::RootedValue result(cx, JS::ObjectValue(*surface_wrapper));
+    return JS::ResolvePromise(cx, promise, result);
+}
+
+static gboolean render_complete(void* data) {
+    auto* render = static_cast<GjsCairoRender*>(data);
+
+    // The context is gone
+    if (G_UNLIKELY(!render->promise)) {
+        delete render;
+        return G_SOURCE_REMOVE;
+    }
+
+    JSContext* cx = render->cx;
+    JS::RootedObject promise(cx, render->promise);
+    JSAutoRealm ar(cx, promise);
+
+    if (!render_finish(render, promise)) {
+        JS::RootedValue error(cx);
+        if (JS_GetPendingException(cx, &error)) {
+            JS_ClearPendingException(cx);
+            if (!JS::RejectPromise(cx, promise, error))
+                gjs_log_exception(cx);
+        }
+    }
+
+    delete render;
+    GjsContextPrivate::from_cx(cx)->schedule_gc_if_needed();
+    return G_SOURCE_REMOVE;
+}
+
+// Runs in a thread of the pool, and touches nothing but Cairo
+static void render_run(void* data, void*) {
+    auto* render = static_cast<GjsCairoRender*>(data);
+
+    render->surface = cairo_image_surface_create(render->format, render->width,
+                                                 render->height);
+    render->status = cairo_surface_status(render->surface);
+    if (render->status == CAIRO_STATUS_SUCCESS) {
+        cairo_t* cr = cairo_create(render->surface);
+        gjs_cairo_execute_commands(cr, render->ops.data(), render->ops.size());
+        // Errors while drawing put the context, not the surface, into an error
+        // state
+        render->status = cairo_status(cr);
+        cairo_destroy(cr);
+        cairo_surface_flush(render->surface);
+    }
+
+    GSource* source = g_idle_source_new();
+    g_source_set_callback(source, render_complete, render, nullptr);
+    g_source_attach(source, render->main_context);
+    g_source_unref(source);
+}
+
+/*
+ * renderAsync(format, width, height, commands):
+ *
+ * Creates an image surface and replays @commands on it in a thread, so that
+ * long drawings don't block the main loop. @commands is a Float64Array in the
+ * format of Context.executePath(), with any of the opcodes in Cairo.DrawOp,
+ * as built by Cairo.CommandBuffer; it is checked and copied before this
+ * returns. Returns a Promise that resolves to the ImageSurface.
+ */
+GJS_JSAPI_RETURN_CONVENTION
+static bool
+renderAsync_func(JSContext *context,
+                 unsigned   argc,
+                 JS::Value *vp)
+{
+    JS::CallArgs argv = JS::CallArgsFromVp(argc, vp);
+    cairo_format_t format;
+    int32_t width, height;
+    JS::RootedObject ops_obj(context);
+
+    if (!gjs_parse_call_args(context, "renderAsync", argv, "iiio",
+                             "format", &format,
+                             "width", &width,
+                             "height", &height,
+                             "commands", &ops_obj))
+        return false;
+
+    if (!JS_IsFloat64Array(ops_obj)) {
+        gjs_throw_custom(context, JSProto_TypeError, nullptr,
+                         "ImageSurface.renderAsync() expects a Float64Array");
+        return false;
+    }
+
+    auto* render = new GjsCairoRender(context, format, width, height);
+    uint32_t bad_ix;
+    bool valid;
+    {
+        JS::AutoCheckCannotGC nogc;
+        uint32_t length;
+        bool is_shared;
+        double* ops;
+        js::GetFloat64ArrayLengthAndData(ops_obj, &length, &is_shared, &ops);
+
+        valid = gjs_cairo_validate_commands(ops, length, /* path_only = */ false,
+                                            &bad_ix);
+        if (valid)
+            render->ops.assign(ops, ops + length);
+    }
+
+    if (!valid) {
+        delete render;
+        gjs_throw(context, "Invalid or truncated command at index %" PRIu32,
+                  bad_ix);
+        return false;
+    }
+
+    JS::RootedObject promise(context, JS::NewPromiseObject(context, nullptr));
+    if (!promise) {
+        delete render;
+        return false;
+    }
+    render->promise.root(context, promise, render_context_destroyed, render);
+
+    static GThreadPool* pool = g_thread_pool_new(
+        render_run, nullptr, g_get_num_processors(), false, nullptr);
+    g_thread_pool_push(pool, render, nullptr);
+
+    argv.rval().setObject(*promise);
+    return true;
+}
+
+static void release_surface_data(void*, void* surface) {
+    cairo_surface_destroy(static_cast<cairo_surface_t*>(surface));
+}
+
+/*
+ * getData():
+ *
+ * Returns a Uint8Array over the surface's pixels, without copying them. The
+ * surface is flushed first; after changing the pixels, call markDirty() before
+ * drawing on the surface with cairo again. The array keeps the surface's
+ * memory alive.
+ */
+GJS_JSAPI_RETURN_CONVENTION
+static bool
+getData_func(JSContext *context,
+             unsigned   argc,
+             JS::Value *vp)
+{
+    GJS_GET_THIS(context, argc, vp, rec, obj);
+
+    if (!gjs_parse_call_args(context, "getData", rec, ""))
+        return false;
+
+    cairo_surface_t* surface = gjs_cairo_surface_get_surface(context, obj);
+    if (!surface)
+        return false;
+
+    cairo_surface_flush(surface);
+    unsigned char* data = cairo_image_surface_get_data(surface);
+    if (!gjs_cairo_check_status(context, cairo_surface_status(surface), "surface"))
+        return false;
+    if (!data) {
+        gjs_throw(context, "ImageSurface has no pixel data");
+        return false;
+    }
+
+    size_t size = size_t(cairo_image_surface_get_stride(surface)) *
+                  cairo_image_surface_get_height(surface);
+    cairo_surface_reference(surface);
+    JS::RootedObject buffer(
+        context, JS::NewExternalArrayBuffer(context, size, data,
+                                            release_surface_data, surface));
+    if (!buffer) {
+        cairo_surface_destroy(surface);
+        return false;
+    }
+
+    JSObject* array = JS_NewUint8ArrayWithBuffer(context, buffer, 0, -1);
+    if (!array)
+        return false;
+
+    rec.rval().setObject(*array);
+    return true;
+}
+
 GJS_JSAPI_RETURN_CONVENTION
 static bool
 getFormat_func(JSContext *context,
@@ -229,7 +604,7 @@ getStride_func(JSContext *context,
 
 JSFunctionSpec gjs_cairo_image_surface_proto_funcs[] = {
     JS_FN("createFromPNG", createFromPNG_func, 0, 0),
-    // getData
+    JS_FN("getData", getData_func, 0, 0),
     JS_FN("getFormat", getFormat_func, 0, 0),
     JS_FN("getWidth", getWidth_func, 0, 0),
     JS_FN("getHeight", getHeight_func, 0, 0),
@@ -237,7 +612,11 @@ JSFunctionSpec gjs_cairo_image_surface_proto_funcs[] = {
     JS_FS_END};
 
 JSFunctionSpec gjs_cairo_image_surface_static_funcs[] = {
+    JS_FN("createForData", createForData_func, 5, GJS_MODULE_PROP_FLAGS),
     JS_FN("createFromPNG", createFromPNG_func, 1, GJS_MODULE_PROP_FLAGS),
+    JS_FN("createFromPNGBytes", createFromPNGBytes_func, 1,
+          GJS_MODULE_PROP_FLAGS),
+    JS_FN("renderAsync", renderAsync_func, 4, GJS_MODULE_PROP_FLAGS),
     JS_FS_END};
 
 JSObject *
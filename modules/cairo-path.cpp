@@ -22,18 +22,29 @@
 
 #include <config.h>
 
+#include <inttypes.h>  // for PRIu32
+#include <stdint.h>
+#include <stdlib.h>  // for free, malloc
+
 #include <cairo.h>
 #include <glib.h>
 
+#include <js/CallArgs.h>
 #include <js/Class.h>
+#include <js/GCAPI.h>  // for AutoCheckCannotGC
 #include <js/PropertyDescriptor.h>  // for JSPROP_READONLY
 #include <js/PropertySpec.h>
 #include <js/RootingAPI.h>
 #include <js/TypeDecls.h>
-#include <jsapi.h>  // for JS_GetClass, JS_GetInstancePrivate
+#include <jsapi.h>  // for JS_GetClass, JS_ReportOutOfMemory, ...
+#include <jsfriendapi.h>  // for JS_NewFloat64Array, JS_IsFloat64Array, ...
+#include <jspubtd.h>  // for JSProto_TypeError
 
 #include "cjs/jsapi-class.h"
+#include "cjs/jsapi-util-args.h"
 #include "cjs/jsapi-util.h"
+#include "cjs/macros.h"
+#include "modules/cairo-private.h"
 
 [[nodiscard]] static JSObject* gjs_cairo_path_get_proto(JSContext*);
 
@@ -53,11 +64,183 @@ JSPropertySpec gjs_cairo_path_proto_props[] = {
     JS_PS_END};
 // clang-format on
 
+/* Methods */
+
+// Paths are exchanged with JS in the same format that Context.executePath()
+// takes: each opcode (Cairo.PathOp, whose first four values are those of
+// cairo_path_data_type_t) followed by its coordinates
+static unsigned path_data_n_points(cairo_path_data_type_t type) {
+    switch (type) {
+        case CAIRO_PATH_MOVE_TO:
+        case CAIRO_PATH_LINE_TO:
+            return 1;
+        case CAIRO_PATH_CURVE_TO:
+            return 3;
+        case CAIRO_PATH_CLOSE_PATH:
+        default:
+            return 0;
+    }
+}
+
+/*
+ * toCommands():
+ *
+ * Returns the path as a Float64Array of opcodes and coordinates, which can be
+ * transformed and passed to Context.executePath() or Path.fromCommands().
+ */
+GJS_JSAPI_RETURN_CONVENTION
+static bool
+toCommands_func(JSContext *context,
+                unsigned   argc,
+                JS::Value *vp)
+{
+    GJS_GET_THIS(context, argc, vp, rec, obj);
+
+    if (!gjs_parse_call_args(context, "toCommands", rec, ""))
+        return false;
+
+    cairo_path_t* path = gjs_cairo_path_get_path(context, obj);
+    if (!path)
+        return false;
+
+    uint32_t length = 0;
+    for (int ix = 0; ix < path->num_data; ix += path->data[ix].header.length)
+        length += path->data[ix].header.length * 2 - 1;
+
+    JS::RootedObject array(context, JS_NewFloat64Array(context, length));
+    if (!array)
+        return false;
+
+    JS::AutoCheckCannotGC nogc;
+    bool is_shared;
+    double* out = JS_GetFloat64ArrayData(array, &is_shared, nogc);
+    for (int ix = 0; ix < path->num_data; ix += path->data[ix].header.length) {
+        const cairo_path_data_t* data = &path->data[ix];
+        *out++ = data->header.type;
+        for (int point = 1; point < data->header.length; point++) {
+            *out++ = data[point].point.x;
+            *out++ = data[point].point.y;
+        }
+    }
+
+    rec.rval().setObject(*array);
+    return true;
+}
+
+/*
+ * Path.fromCommands(commands):
+ *
+ * Creates a path from a Float64Array in the format returned by toCommands().
+ * Only the MOVE_TO, LINE_TO, CURVE_TO, and CLOSE_PATH opcodes can occur in a
+ * cairo path.
+ */
+GJS_JSAPI_RETURN_CONVENTION
+static bool
+fromCommands_func(JSContext *context,
+                  unsigned   argc,
+                  JS::Value *vp)
+{
+    JS::CallArgs argv = JS::CallArgsFromVp(argc, vp);
+    JS::RootedObject commands(context);
+
+    if (!gjs_parse_call_args(context, "fromCommands", argv, "o",
+                             "commands", &commands))
+        return false;
+
+    if (!JS_IsFloat64Array(commands)) {
+        gjs_throw_custom(context, JSProto_TypeError, nullptr,
+                         "Path.fromCommands() expects a Float64Array");
+        return false;
+    }
+
+    cairo_path_t* path = nullptr;
+    uint32_t bad_ix = 0;
+    bool out_of_memory = false;
+    {
+        JS::AutoCheckCannotGC nogc;
+        uint32_t length;
+        bool is_shared;
+        double* ops;
+        js::GetFloat64ArrayLengthAndData(commands, &length, &is_shared, &ops);
+
+        // Check the commands and count the cairo_path_data_t elements needed
+        int num_data = 0;
+        uint32_t ix;
+        for (ix = 0; ix < length;) {
+            double op = ops[ix];
+            if (!(op >= CAIRO_PATH_MOVE_TO && op <= CAIRO_PATH_CLOSE_PATH) ||
+                op != unsigned(op))
+                break;
+            unsigned n_points =
+                path_data_n_points(static_cast<cairo_path_data_type_t>(op));
+            if (length - ix - 1 < n_points * 2)
+                break;
+            num_data += n_points + 1;
+            ix += n_points * 2 + 1;
+        }
+
+        if (ix < length) {
+            bad_ix = ix;
+        } else {
+            // cairo_path_destroy() frees both with free()
+            auto* data = static_cast<cairo_path_data_t*>(
+                malloc(sizeof(cairo_path_data_t) * (num_data ? num_data : 1)));
+            if (data)
+                path = static_cast<cairo_path_t*>(malloc(sizeof(cairo_path_t)));
+            if (!path) {
+                free(data);
+                out_of_memory = true;
+            } else {
+                path->status = CAIRO_STATUS_SUCCESS;
+                path->num_data = num_data;
+                path->data = data;
+
+                for (ix = 0; ix < length;) {
+                    auto type = static_cast<cairo_path_data_type_t>(ops[ix++]);
+                    unsigned n_points = path_data_n_points(type);
+                    data->header.type = type;
+                    data->header.length = n_points + 1;
+                    data++;
+                    for (unsigned point = 0; point < n_points;
+                         point++, data++) {
+                        data->point.x = ops[ix++];
+                        data->point.y = ops[ix++];
+                    }
+                }
+            }
+        }
+    }
+
+    if (out_of_memory) {
+        JS_ReportOutOfMemory(context);
+        return false;
+    }
+
+    if (!path) {
+        gjs_throw(context,
+                  "Invalid or truncated path command at index %" PRIu32,
+                  bad_ix);
+        return false;
+    }
+
+    JSObject* path_wrapper = gjs_cairo_path_from_path(context, path);
+    if (!path_wrapper) {
+        cairo_path_destroy(path);
+        return false;
+    }
+
+    argv.rval().setObject(*path_wrapper);
+    return true;
+}
+
 JSFunctionSpec gjs_cairo_path_proto_funcs[] = {
+    JS_FN("toCommands", toCommands_func, 0, 0),
     JS_FS_END
 };
 
-JSFunctionSpec gjs_cairo_path_static_funcs[] = { JS_FS_END };
+JSFunctionSpec gjs_cairo_path_static_funcs[] = {
+    JS_FN("fromCommands", fromCommands_func, 1, GJS_MODULE_PROP_FLAGS),
+    JS_FS_END};
 
 /**
  * gjs_cairo_path_from_path:
@@ -25,6 +25,8 @@
 
 #include <config.h>
 
+#include <stdint.h>
+
 #include <cairo-features.h>  // for CAIRO_HAS_PDF_SURFACE, CAIRO_HAS_PS_SURFACE
 #include <cairo.h>
 
@@ -55,6 +57,17 @@ GJS_JSAPI_RETURN_CONVENTION
 JSObject *       gjs_cairo_context_from_context         (JSContext       *context,
                                                          cairo_t         *cr);
 void gjs_cairo_context_init(void);
+
+// Command buffers, as taken by Context.executePath() and
+// ImageSurface.renderAsync(): each opcode (Cairo.DrawOp) followed by its
+// operands. Validation must come first; replaying needs no JSContext, so it can
+// happen on any thread.
+[[nodiscard]] bool gjs_cairo_validate_commands(const double* ops,
+                                               uint32_t length, bool path_only,
+                                               uint32_t* bad_ix);
+void gjs_cairo_execute_commands(cairo_t* cr, const double* ops,
+                                uint32_t length);
+
 void gjs_cairo_surface_init(void);
 
 /* path */
@@ -22,6 +22,8 @@
 
 #include <config.h>
 
+#include <stdint.h>
+
 #include <cairo-gobject.h>
 #include <cairo.h>
 #include <girepository.h>
@@ -30,12 +32,15 @@
 #include <js/CallArgs.h>
 #include <js/Class.h>
 #include <js/Conversions.h>
+#include <js/GCAPI.h>  // for AutoCheckCannotGC
 #include <js/PropertyDescriptor.h>  // for JSPROP_READONLY
 #include <js/PropertySpec.h>
 #include <js/RootingAPI.h>
 #include <js/TypeDecls.h>
 #include <js/Value.h>
 #include <jsapi.h>  // for JS_GetPropertyById, JS_SetPropert...
+#include <jsfriendapi.h>  // for JS_NewInt32Array, JS_IsInt32Array, ...
+#include <jspubtd.h>  // for JSProto_TypeError
 
 #include "gi/arg-inl.h"
 #include "gi/arg.h"
@@ -68,6 +73,15 @@ fill_rectangle(JSContext             *context,
                JS::HandleObject       obj,
                cairo_rectangle_int_t *rect);
 
+GJS_JSAPI_RETURN_CONVENTION
+static JSObject *
+gjs_cairo_region_from_region(JSContext *context,
+                             cairo_region_t *region);
+
+// Rectangles are exchanged in bulk as Int32Arrays of x, y, width, and height,
+// which is the layout of an array of cairo_rectangle_int_t
+static_assert(sizeof(cairo_rectangle_int_t) == 4 * sizeof(int32_t));
+
 #define PRELUDE                                                             \
     GJS_GET_THIS(context, argc, vp, argv, obj);                             \
     auto* this_region = static_cast<cairo_region_t*>(JS_GetInstancePrivate( \
@@ -223,6 +237,100 @@ get_rectangle_func(JSContext *context,
     RETURN_STATUS;
 }
 
+/*
+ * getRectangles():
+ *
+ * Returns all the rectangles of the region in an Int32Array, four numbers for
+ * each: x, y, width, and height.
+ */
+GJS_JSAPI_RETURN_CONVENTION
+static bool
+get_rectangles_func(JSContext *context,
+                    unsigned argc,
+                    JS::Value *vp)
+{
+    PRELUDE;
+
+    if (!gjs_parse_call_args(context, "getRectangles", argv, ""))
+        return false;
+
+    int n_rects = cairo_region_num_rectangles(this_region);
+    JS::RootedObject array(context, JS_NewInt32Array(context, n_rects * 4));
+    if (!array)
+        return false;
+
+    {
+        JS::AutoCheckCannotGC nogc;
+        bool is_shared;
+        auto* rects = reinterpret_cast<cairo_rectangle_int_t*>(
+            JS_GetInt32ArrayData(array, &is_shared, nogc));
+        for (int ix = 0; ix < n_rects; ix++)
+            cairo_region_get_rectangle(this_region, ix, &rects[ix]);
+    }
+
+    argv.rval().setObject(*array);
+    RETURN_STATUS;
+}
+
+/*
+ * Region.fromRectangles(rectangles):
+ *
+ * Creates a region that is the union of the rectangles in an Int32Array in the
+ * format returned by getRectangles().
+ */
+GJS_JSAPI_RETURN_CONVENTION
+static bool
+from_rectangles_func(JSContext *context,
+                     unsigned argc,
+                     JS::Value *vp)
+{
+    JS::CallArgs argv = JS::CallArgsFromVp(argc, vp);
+    JS::RootedObject rects_obj(context);
+
+    if (!gjs_parse_call_args(context, "fromRectangles", argv, "o",
+                             "rectangles", &rects_obj))
+        return false;
+
+    if (!JS_IsInt32Array(rects_obj)) {
+        gjs_throw_custom(context, JSProto_TypeError, nullptr,
+                         "Region.fromRectangles() expects an Int32Array");
+        return false;
+    }
+
+    cairo_region_t* region = nullptr;
+    {
+        JS::AutoCheckCannotGC nogc;
+        uint32_t length;
+        bool is_shared;
+        int32_t* data;
+        js::GetInt32ArrayLengthAndData(rects_obj, &length, &is_shared, &data);
+
+        if (length % 4 == 0)
+            region = cairo_region_create_rectangles(
+                reinterpret_cast<cairo_rectangle_int_t*>(data), length / 4);
+    }
+
+    if (!region) {
+        gjs_throw(context,
+                  "Region.fromRectangles() expects four numbers per rectangle");
+        return false;
+    }
+
+    if (!gjs_cairo_check_status(context, cairo_region_status(region),
+                                "region")) {
+        cairo_region_destroy(region);
+        return false;
+    }
+
+    JSObject* region_obj = gjs_cairo_region_from_region(context, region);
+    cairo_region_destroy(region);
+    if (!region_obj)
+        return false;
+
+    argv.rval().setObject(*region_obj);
+    return true;
+}
+
 // clang-format off
 JSPropertySpec gjs_cairo_region_proto_props[] = {
     JS_STRING_SYM_PS(toStringTag, "Region", JSPROP_READONLY),
@@ -242,9 +350,12 @@ JSFunctionSpec gjs_cairo_region_proto_funcs[] = {
 
     JS_FN("numRectangles", num_rectangles_func, 0, 0),
     JS_FN("getRectangle", get_rectangle_func, 0, 0),
+    JS_FN("getRectangles", get_rectangles_func, 0, 0),
     JS_FS_END};
 
-JSFunctionSpec gjs_cairo_region_static_funcs[] = { JS_FS_END };
+JSFunctionSpec gjs_cairo_region_static_funcs[] = {
+    JS_FN("fromRectangles", from_rectangles_func, 1, GJS_MODULE_PROP_FLAGS),
+    JS_FS_END};
 
 static void _gjs_cairo_region_construct_internal(JSObject* obj,
                                                  cairo_region_t* region) {
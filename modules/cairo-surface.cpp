@@ -24,7 +24,9 @@
 
 #include <cairo-gobject.h>
 #include <cairo.h>
+#include <gio/gio.h>
 #include <girepository.h>
+#include <glib-object.h>
 #include <glib.h>
 
 #include <js/CallArgs.h>
@@ -38,7 +40,9 @@
 
 #include "gi/arg-inl.h"
 #include "gi/arg.h"
+#include "gi/boxed.h"
 #include "gi/foreign.h"
+#include "gi/object.h"
 #include "cjs/jsapi-class.h"
 #include "cjs/jsapi-util-args.h"
 #include "cjs/jsapi-util.h"
@@ -89,6 +93,108 @@ writeToPNG_func(JSContext *context,
     return true;
 }
 
+struct PNGStreamClosure {
+    GOutputStream* stream;
+    GError* error;
+};
+
+static cairo_status_t write_png_to_stream(void* closure,
+                                          const unsigned char* data,
+                                          unsigned length) {
+    auto* png_stream = static_cast<PNGStreamClosure*>(closure);
+    if (!g_output_stream_write_all(png_stream->stream, data, length, nullptr,
+                                   nullptr, &png_stream->error))
+        return CAIRO_STATUS_WRITE_ERROR;
+    return CAIRO_STATUS_SUCCESS;
+}
+
+/*
+ * writeToPNGStream(stream):
+ *
+ * Writes the surface as PNG to a Gio.OutputStream, blocking until done.
+ */
+GJS_JSAPI_RETURN_CONVENTION
+static bool
+writeToPNGStream_func(JSContext *context,
+                      unsigned   argc,
+                      JS::Value *vp)
+{
+    GJS_GET_THIS(context, argc, vp, argv, obj);
+    JS::RootedObject stream_wrapper(context);
+
+    if (!gjs_parse_call_args(context, "writeToPNGStream", argv, "o",
+                             "stream", &stream_wrapper))
+        return false;
+
+    cairo_surface_t* surface = gjs_cairo_surface_get_surface(context, obj);
+    if (!surface)
+        return false;
+
+    GObject* stream;
+    if (!ObjectBase::typecheck(context, stream_wrapper, nullptr,
+                               G_TYPE_OUTPUT_STREAM) ||
+        !ObjectBase::to_c_ptr(context, stream_wrapper, &stream))
+        return false;
+
+    PNGStreamClosure closure{G_OUTPUT_STREAM(stream), nullptr};
+    cairo_status_t status =
+        cairo_surface_write_to_png_stream(surface, write_png_to_stream, &closure);
+    if (closure.error)
+        return gjs_throw_gerror_message(context, closure.error);  // frees GError
+    if (!gjs_cairo_check_status(context, status, "surface"))
+        return false;
+    argv.rval().setUndefined();
+    return true;
+}
+
+static cairo_status_t write_png_to_byte_array(void* closure,
+                                              const unsigned char* data,
+                                              unsigned length) {
+    g_byte_array_append(static_cast<GByteArray*>(closure), data, length);
+    return CAIRO_STATUS_SUCCESS;
+}
+
+/*
+ * toPNGBytes():
+ *
+ * Returns the surface encoded as PNG in a GLib.Bytes, without going through a
+ * file.
+ */
+GJS_JSAPI_RETURN_CONVENTION
+static bool
+toPNGBytes_func(JSContext *context,
+                unsigned   argc,
+                JS::Value *vp)
+{
+    GJS_GET_THIS(context, argc, vp, argv, obj);
+
+    if (!gjs_parse_call_args(context, "toPNGBytes", argv, ""))
+        return false;
+
+    cairo_surface_t* surface = gjs_cairo_surface_get_surface(context, obj);
+    if (!surface)
+        return false;
+
+    GByteArray* array = g_byte_array_new();
+    cairo_status_t status =
+        cairo_surface_write_to_png_stream(surface, write_png_to_byte_array, array);
+    GjsAutoBytes bytes = g_byte_array_free_to_bytes(array);
+    if (!gjs_cairo_check_status(context, status, "surface"))
+        return false;
+
+    g_irepository_require(nullptr, "GLib", "2.0", GIRepositoryLoadFlags(0),
+                          nullptr);
+    GjsAutoStructInfo bytes_info =
+        g_irepository_find_by_gtype(nullptr, G_TYPE_BYTES);
+    JSObject* bytes_obj =
+        BoxedInstance::new_for_c_struct(context, bytes_info, bytes);
+    if (!bytes_obj)
+        return false;
+
+    argv.rval().setObject(*bytes_obj);
+    return true;
+}
+
 GJS_JSAPI_RETURN_CONVENTION
 static bool
 getType_func(JSContext *context,
@@ -116,13 +222,87 @@ getType_func(JSContext *context,
     return true;
 }
 
+GJS_JSAPI_RETURN_CONVENTION
+static bool
+flush_func(JSContext *context,
+           unsigned   argc,
+           JS::Value *vp)
+{
+    GJS_GET_THIS(context, argc, vp, argv, obj);
+
+    if (!gjs_parse_call_args(context, "flush", argv, ""))
+        return false;
+
+    cairo_surface_t* surface = gjs_cairo_surface_get_surface(context, obj);
+    if (!surface)
+        return false;
+
+    cairo_surface_flush(surface);
+    if (!gjs_cairo_check_status(context, cairo_surface_status(surface),
+                                "surface"))
+        return false;
+    argv.rval().setUndefined();
+    return true;
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool
+markDirty_func(JSContext *context,
+               unsigned   argc,
+               JS::Value *vp)
+{
+    GJS_GET_THIS(context, argc, vp, argv, obj);
+
+    if (!gjs_parse_call_args(context, "markDirty", argv, ""))
+        return false;
+
+    cairo_surface_t* surface = gjs_cairo_surface_get_surface(context, obj);
+    if (!surface)
+        return false;
+
+    cairo_surface_mark_dirty(surface);
+    if (!gjs_cairo_check_status(context, cairo_surface_status(surface),
+                                "surface"))
+        return false;
+    argv.rval().setUndefined();
+    return true;
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool
+markDirtyRectangle_func(JSContext *context,
+                        unsigned   argc,
+                        JS::Value *vp)
+{
+    GJS_GET_THIS(context, argc, vp, argv, obj);
+    int32_t x, y, width, height;
+
+    if (!gjs_parse_call_args(context, "markDirtyRectangle", argv, "iiii",
+                             "x", &x,
+                             "y", &y,
+                             "width", &width,
+                             "height", &height))
+        return false;
+
+    cairo_surface_t* surface = gjs_cairo_surface_get_surface(context, obj);
+    if (!surface)
+        return false;
+
+    cairo_surface_mark_dirty_rectangle(surface, x, y, width, height);
+    if (!gjs_cairo_check_status(context, cairo_surface_status(surface),
+                                "surface"))
+        return false;
+    argv.rval().setUndefined();
+    return true;
+}
+
 JSFunctionSpec gjs_cairo_surface_proto_funcs[] = {
-    // flush
+    JS_FN("flush", flush_func, 0, 0),
     // getContent
     // getFontOptions
     JS_FN("getType", getType_func, 0, 0),
-    // markDirty
-    // markDirtyRectangle
+    JS_FN("markDirty", markDirty_func, 0, 0),
+    JS_FN("markDirtyRectangle", markDirtyRectangle_func, 0, 0),
     // setDeviceOffset
     // getDeviceOffset
     // setFallbackResolution
@@ -130,7 +310,9 @@ JSFunctionSpec gjs_cairo_surface_proto_funcs[] = {
     // copyPage
     // showPage
     // hasShowTextGlyphs
+    JS_FN("toPNGBytes", toPNGBytes_func, 0, 0),
     JS_FN("writeToPNG", writeToPNG_func, 0, 0),
+    JS_FN("writeToPNGStream", writeToPNGStream_func, 0, 0),
     JS_FS_END};
 
 JSFunctionSpec gjs_cairo_surface_static_funcs[] = { JS_FS_END };
@@ -50,6 +50,12 @@
 #include <glib.h>
 #include <glib/gprintf.h>  // for g_fprintf
 
+#ifdef G_OS_UNIX
+#    include <unistd.h>  // for STDIN_FILENO
+
+#    include <glib-unix.h>  // for g_unix_fd_source_new
+#endif
+
 #include <js/CallArgs.h>
 #include <js/CompilationAndEvaluation.h>
 #include <js/CompileOptions.h>
@@ -124,12 +130,22 @@ public:
         add_history(line);
     *bufp = line;
 #else   // !HAVE_READLINE_READLINE_H
-    char line[256];
     fprintf(stdout, "%s", prompt);
     fflush(stdout);
-    if (!fgets(line, sizeof line, stdin))
+
+    // Read the whole line, so that a long one is not handled in pieces
+    GString* line = g_string_new("");
+    char chunk[256];
+    while (fgets(chunk, sizeof chunk, stdin)) {
+        g_string_append(line, chunk);
+        if (line->str[line->len - 1] == '\n')
+            break;
+    }
+    if (line->len == 0) {
+        g_string_free(line, true);
         return false;
-    *bufp = g_strdup(line);
+    }
+    *bufp = g_string_free(line, false);
 #endif  // !HAVE_READLINE_READLINE_H
     return true;
 }
@@ -170,6 +186,151 @@ public:
     return true;
 }
 
+// State of the read-eval-print loop. Lines are accumulated in buffer until
+// they make up a compilable unit, which is then evaluated.
+struct GjsConsoleRepl {
+    JSContext* cx;
+    GString* buffer;
+    int lineno;
+    int startline;
+    bool eof : 1;
+    // Set after an uncatchable exception, see gjs_console_interact()
+    bool failed : 1;
+#ifdef G_OS_UNIX
+    GMainLoop* loop;
+#endif
+};
+
+[[nodiscard]] static const char* gjs_console_prompt(GjsConsoleRepl* repl) {
+    return repl->startline == repl->lineno ? "gjs> " : ".... ";
+}
+
+// Takes ownership of @line, which is null at the end of input
+static void gjs_console_handle_line(GjsConsoleRepl* repl, char* line) {
+    if (!line) {
+        repl->eof = true;
+        if (repl->buffer->len == 0)
+            return;
+    } else {
+        g_string_append(repl->buffer, line);
+        g_free(line);
+        repl->lineno++;
+
+        JS::RootedObject global(repl->cx, gjs_get_import_global(repl->cx));
+        if (!JS_Utf8BufferIsCompilableUnit(repl->cx, global, repl->buffer->str,
+                                           repl->buffer->len))
+            return;
+    }
+
+    bool ok;
+    {
+        AutoReportException are(repl->cx);
+        ok = gjs_console_eval_and_print(repl->cx, repl->buffer->str,
+                                        repl->buffer->len, repl->startline);
+    }
+    g_string_truncate(repl->buffer, 0);
+    repl->startline = repl->lineno;
+
+    GjsContextPrivate* gjs = GjsContextPrivate::from_cx(repl->cx);
+    ok = gjs->run_jobs_fallible() && ok;
+
+    if (!ok)
+        repl->failed = true;
+}
+
+[[nodiscard]] static bool gjs_console_repl_done(GjsConsoleRepl* repl) {
+    return repl->eof || repl->failed;
+}
+
+#ifdef G_OS_UNIX
+/* The REPL runs inside a GLib main loop, reading from stdin only when input is
+ * available, so that timeouts, I/O callbacks, DBus replies and promise jobs of
+ * the program being inspected keep running while waiting at the prompt. */
+
+#    ifdef HAVE_READLINE_READLINE_H
+// The readline callback interface doesn't pass any user data to the handler
+static GjsConsoleRepl* current_repl = nullptr;
+
+static void gjs_console_on_readline(char* line) {
+    GjsConsoleRepl* repl = current_repl;
+
+    if (line && line[0] != '\0')
+        add_history(line);
+    gjs_console_handle_line(repl, line);
+
+    // The main loop is quit from gjs_console_on_stdin()
+    if (gjs_console_repl_done(repl))
+        rl_callback_handler_remove();
+    else
+        rl_set_prompt(gjs_console_prompt(repl));
+}
+#    endif  // HAVE_READLINE_READLINE_H
+
+static gboolean gjs_console_on_stdin(int, GIOCondition, void* data) {
+    auto* repl = static_cast<GjsConsoleRepl*>(data);
+
+#    ifdef HAVE_READLINE_READLINE_H
+    rl_callback_read_char();
+#    else   // !HAVE_READLINE_READLINE_H
+    char* line = nullptr;
+    if (!gjs_console_readline(&line, ""))
+        line = nullptr;
+    gjs_console_handle_line(repl, line);
+    if (!gjs_console_repl_done(repl)) {
+        fprintf(stdout, "%s", gjs_console_prompt(repl));
+        fflush(stdout);
+    }
+#    endif  // !HAVE_READLINE_READLINE_H
+
+    if (gjs_console_repl_done(repl)) {
+        g_main_loop_quit(repl->loop);
+        return G_SOURCE_REMOVE;
+    }
+    return G_SOURCE_CONTINUE;
+}
+
+static void gjs_console_run_repl(GjsConsoleRepl* repl) {
+    repl->loop = g_main_loop_new(nullptr, false);
+
+#    ifdef HAVE_READLINE_READLINE_H
+    current_repl = repl;
+    rl_callback_handler_install(gjs_console_prompt(repl),
+                                gjs_console_on_readline);
+#    else   // !HAVE_READLINE_READLINE_H
+    // Otherwise lines read ahead into the stdio buffer would not wake up the
+    // main loop
+    setvbuf(stdin, nullptr, _IONBF, 0);
+
+    fprintf(stdout, "%s", gjs_console_prompt(repl));
+    fflush(stdout);
+#    endif  // !HAVE_READLINE_READLINE_H
+
+    GSource* source = g_unix_fd_source_new(
+        STDIN_FILENO, GIOCondition(G_IO_IN | G_IO_HUP | G_IO_ERR));
+    g_source_set_callback(source, G_SOURCE_FUNC(gjs_console_on_stdin), repl,
+                          nullptr);
+    g_source_attach(source, nullptr);
+
+    g_main_loop_run(repl->loop);
+
+    g_source_destroy(source);
+    g_source_unref(source);
+    g_main_loop_unref(repl->loop);
+#    ifdef HAVE_READLINE_READLINE_H
+    current_repl = nullptr;
+#    endif
+}
+#else   // !G_OS_UNIX
+static void gjs_console_run_repl(GjsConsoleRepl* repl) {
+    do {
+        char* line = nullptr;
+        if (!gjs_console_readline(&line, gjs_console_prompt(repl)))
+            line = nullptr;
+        gjs_console_handle_line(repl, line);
+    } while (!gjs_console_repl_done(repl));
+}
+#endif  // !G_OS_UNIX
+
 GJS_JSAPI_RETURN_CONVENTION
 static bool
 gjs_console_interact(JSContext *context,
@@ -177,58 +338,29 @@ gjs_console_interact(JSContext *context,
                      JS::Value *vp)
 {
     JS::CallArgs argv = JS::CallArgsFromVp(argc, vp);
-    bool eof = false;
-    JS::RootedObject global(context, gjs_get_import_global(context));
-    GString *buffer = NULL;
-    char *temp_buf = NULL;
-    int lineno;
-    int startline;
 
     JS::SetWarningReporter(context, gjs_console_warning_reporter);
 
-        /* It's an interactive filehandle; drop into read-eval-print loop. */
-    lineno = 1;
-    do {
-        /*
-         * Accumulate lines until we get a 'compilable unit' - one that either
-         * generates an error (before running out of source) or that compiles
-         * cleanly.  This should be whenever we get a complete statement that
-         * coincides with the end of a line.
-         */
-        startline = lineno;
-        buffer = g_string_new("");
-        do {
-            if (!gjs_console_readline(
-                    &temp_buf, startline == lineno ? "gjs> " : ".... ")) {
-                eof = true;
-                break;
-            }
-            g_string_append(buffer, temp_buf);
-            g_free(temp_buf);
-            lineno++;
-        } while (!JS_Utf8BufferIsCompilableUnit(context, global, buffer->str,
-                                                buffer->len));
-
-        bool ok;
-        {
-            AutoReportException are(context);
-            ok = gjs_console_eval_and_print(context, buffer->str, buffer->len,
-                                            startline);
-        }
-        g_string_free(buffer, true);
+    /* It's an interactive filehandle; drop into read-eval-print loop. */
+    GjsConsoleRepl repl;
+    repl.cx = context;
+    repl.buffer = g_string_new("");
+    repl.lineno = repl.startline = 1;
+    repl.eof = false;
+    repl.failed = false;
 
-        GjsContextPrivate* gjs = GjsContextPrivate::from_cx(context);
-        ok = gjs->run_jobs_fallible() && ok;
+    gjs_console_run_repl(&repl);
 
-        if (!ok) {
-            /* If this was an uncatchable exception, throw another uncatchable
-             * exception on up to the surrounding JS::Evaluate() in main(). This
-             * happens when you run gjs-console and type imports.system.exit(0);
-             * at the prompt. If we don't throw another uncatchable exception
-             * here, then it's swallowed and main() won't exit. */
-            return false;
-        }
-    } while (!eof);
+    g_string_free(repl.buffer, true);
+
+    if (repl.failed) {
+        /* If this was an uncatchable exception, throw another uncatchable
+         * exception on up to the surrounding JS::Evaluate() in main(). This
+         * happens when you run gjs-console and type imports.system.exit(0);
+         * at the prompt. If we don't throw another uncatchable exception
+         * here, then it's swallowed and main() won't exit. */
+        return false;
+    }
 
     g_fprintf(stdout, "\n");
 
@@ -18,8 +18,9 @@
 // FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
 // IN THE SOFTWARE.
 
-/* exported Antialias, Content, Extend, FillRule, Filter, FontSlant, FontWeight,
-Format, LineCap, LineJoin, Operator, PatternType, SurfaceType */
+/* exported Antialias, CommandBuffer, Content, DrawOp, Extend, FillRule, Filter,
+FontSlant, FontWeight, Format, LineCap, LineJoin, Operator, PathOp, PatternType,
+SurfaceType */
 
 var Antialias = {
     DEFAULT: 0,
@@ -119,6 +120,126 @@ var Operator = {
     HSL_LUMINOSITY: 28,
 };
 
+// Opcodes for Context.executePath() and Path.toCommands(); each is followed by
+// the same arguments as the Context method of the same name
+var PathOp = {
+    MOVE_TO: 0,
+    LINE_TO: 1,
+    CURVE_TO: 2,
+    CLOSE_PATH: 3,
+    REL_MOVE_TO: 4,
+    REL_LINE_TO: 5,
+    REL_CURVE_TO: 6,
+    NEW_SUB_PATH: 7,
+    RECTANGLE: 8,
+    ARC: 9,
+    ARC_NEGATIVE: 10,
+};
+
+// Opcodes for ImageSurface.renderAsync(): those of PathOp, and the ones that
+// change the state of the context or draw
+var DrawOp = Object.assign({}, PathOp, {
+    NEW_PATH: 11,
+    SAVE: 12,
+    RESTORE: 13,
+    TRANSLATE: 14,
+    SCALE: 15,
+    ROTATE: 16,
+    SET_SOURCE_RGB: 17,
+    SET_SOURCE_RGBA: 18,
+    SET_LINE_WIDTH: 19,
+    SET_LINE_CAP: 20,
+    SET_LINE_JOIN: 21,
+    SET_OPERATOR: 22,
+    SET_FILL_RULE: 23,
+    FILL: 24,
+    FILL_PRESERVE: 25,
+    STROKE: 26,
+    STROKE_PRESERVE: 27,
+    CLIP: 28,
+    RESET_CLIP: 29,
+    PAINT: 30,
+    PAINT_WITH_ALPHA: 31,
+    SET_TOLERANCE: 32,
+    IDENTITY_MATRIX: 33,
+    SET_MITER_LIMIT: 34,
+});
+
+// Records calls with the same names and arguments as the Context methods, for
+// replaying with Context.executePath() (path commands only) or
+// ImageSurface.renderAsync():
+//
+//   const commands = new Cairo.CommandBuffer();
+//   commands.setSourceRGB(1, 0, 0);
+//   commands.rectangle(0, 0, 10, 10);
+//   commands.fill();
+//   const surface = await Cairo.ImageSurface.renderAsync(Cairo.Format.ARGB32,
+//       10, 10, commands.toArray());
+var CommandBuffer = class CommandBuffer {
+    constructor() {
+        this._ops = [];
+    }
+
+    // Returns the commands recorded so far, as a Float64Array
+    toArray() {
+        return new Float64Array(this._ops);
+    }
+
+    clear() {
+        this._ops.length = 0;
+    }
+
+    get length() {
+        return this._ops.length;
+    }
+};
+
+[
+    ['moveTo', DrawOp.MOVE_TO, 2],
+    ['lineTo', DrawOp.LINE_TO, 2],
+    ['curveTo', DrawOp.CURVE_TO, 6],
+    ['closePath', DrawOp.CLOSE_PATH, 0],
+    ['relMoveTo', DrawOp.REL_MOVE_TO, 2],
+    ['relLineTo', DrawOp.REL_LINE_TO, 2],
+    ['relCurveTo', DrawOp.REL_CURVE_TO, 6],
+    ['newSubPath', DrawOp.NEW_SUB_PATH, 0],
+    ['rectangle', DrawOp.RECTANGLE, 4],
+    ['arc', DrawOp.ARC, 5],
+    ['arcNegative', DrawOp.ARC_NEGATIVE, 5],
+    ['newPath', DrawOp.NEW_PATH, 0],
+    ['save', DrawOp.SAVE, 0],
+    ['restore', DrawOp.RESTORE, 0],
+    ['translate', DrawOp.TRANSLATE, 2],
+    ['scale', DrawOp.SCALE, 2],
+    ['rotate', DrawOp.ROTATE, 1],
+    ['setSourceRGB', DrawOp.SET_SOURCE_RGB, 3],
+    ['setSourceRGBA', DrawOp.SET_SOURCE_RGBA, 4],
+    ['setLineWidth', DrawOp.SET_LINE_WIDTH, 1],
+    ['setLineCap', DrawOp.SET_LINE_CAP, 1],
+    ['setLineJoin', DrawOp.SET_LINE_JOIN, 1],
+    ['setOperator', DrawOp.SET_OPERATOR, 1],
+    ['setFillRule', DrawOp.SET_FILL_RULE, 1],
+    ['fill', DrawOp.FILL, 0],
+    ['fillPreserve', DrawOp.FILL_PRESERVE, 0],
+    ['stroke', DrawOp.STROKE, 0],
+    ['strokePreserve', DrawOp.STROKE_PRESERVE, 0],
+    ['clip', DrawOp.CLIP, 0],
+    ['resetClip', DrawOp.RESET_CLIP, 0],
+    ['paint', DrawOp.PAINT, 0],
+    ['paintWithAlpha', DrawOp.PAINT_WITH_ALPHA, 1],
+    ['setTolerance', DrawOp.SET_TOLERANCE, 1],
+    ['identityMatrix', DrawOp.IDENTITY_MATRIX, 0],
+    ['setMiterLimit', DrawOp.SET_MITER_LIMIT, 1],
+].forEach(([name, op, nArgs]) => {
+    CommandBuffer.prototype[name] = function (...args) {
+        if (args.length !== nArgs) {
+            throw new TypeError(`CommandBuffer.${name}() takes ${nArgs} ` +
+                `arguments, not ${args.length}`);
+        }
+        this._ops.push(op, ...args);
+    };
+});
+
 var PatternType = {
     SOLID: 0,
     SURFACE: 1,
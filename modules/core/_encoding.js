@@ -0,0 +1,171 @@
+// -*- mode: js; js-indent-level: 4; indent-tabs-mode: nil -*-
+// SPDX-License-Identifier: MIT OR LGPL-2.0-or-later
+
+/* exported TextDecoder, TextEncoder */
+
+// Implementation of the WHATWG Encoding API's TextEncoder and TextDecoder. The
+// conversions themselves are done natively in _encodingNative.
+
+const Native = imports._encodingNative;
+
+const _utf8Labels = ['unicode-1-1-utf-8', 'unicode11utf8', 'unicode20utf8',
+    'utf-8', 'utf8', 'x-unicode20utf8'];
+const _utf16leLabels = ['csunicode', 'iso-10646-ucs-2', 'ucs-2', 'unicode',
+    'unicodefeff', 'utf-16', 'utf-16le'];
+const _utf16beLabels = ['unicodefffe', 'utf-16be'];
+
+function _getEncodingFromLabel(label) {
+    const name = `${label}`.trim().toLowerCase();
+    if (_utf8Labels.includes(name))
+        return 'utf-8';
+    if (_utf16leLabels.includes(name))
+        return 'utf-16le';
+    if (_utf16beLabels.includes(name))
+        return 'utf-16be';
+    // Anything else is left to iconv
+    if (name !== '' && Native.isEncodingSupported(name))
+        return name;
+    throw new RangeError(`Unsupported encoding: ${label}`);
+}
+
+function _toUint8Array(input) {
+    if (input instanceof Uint8Array)
+        return input;
+    if (ArrayBuffer.isView(input))
+        return new Uint8Array(input.buffer, input.byteOffset, input.byteLength);
+    if (input instanceof ArrayBuffer)
+        return new Uint8Array(input);
+    throw new TypeError('Argument must be an ArrayBuffer or ArrayBufferView');
+}
+
+function _isUtf8Continuation(byte) {
+    return byte >= 0x80 && byte <= 0xbf;
+}
+
+// Length of the UTF-8 sequence started by @byte, or 0 if @byte can't start a
+// multi-byte sequence
+function _utf8SequenceLength(byte) {
+    if (byte >= 0xc2 && byte <= 0xdf)
+        return 2;
+    if (byte >= 0xe0 && byte <= 0xef)
+        return 3;
+    if (byte >= 0xf0 && byte <= 0xf4)
+        return 4;
+    return 0;
+}
+
+// Number of bytes at the end of @bytes that start a UTF-8 sequence which is
+// not complete yet, and so must wait for the next chunk
+function _incompleteUtf8Tail(bytes) {
+    const start = Math.max(bytes.length - 3, 0);
+    for (let ix = bytes.length - 1; ix >= start; ix--) {
+        if (_isUtf8Continuation(bytes[ix]))
+            continue;
+        const tail = bytes.length - ix;
+        return tail < _utf8SequenceLength(bytes[ix]) ? tail : 0;
+    }
+    return 0;
+}
+
+// Number of bytes at the end of @bytes that don't form a complete UTF-16 code
+// unit, or are the high half of a surrogate pair
+function _incompleteUtf16Tail(bytes, bigEndian) {
+    let tail = bytes.length % 2;
+    const end = bytes.length - tail;
+    if (end >= 2) {
+        const high = bigEndian ? bytes[end - 2] : bytes[end - 1];
+        if (high >= 0xd8 && high <= 0xdb)
+            tail += 2;
+    }
+    return tail;
+}
+
+var TextDecoder = class TextDecoder {
+    constructor(label = 'utf-8', options = {}) {
+        this._encoding = _getEncodingFromLabel(label);
+        this._fatal = Boolean(options.fatal);
+        this._ignoreBOM = Boolean(options.ignoreBOM);
+
+        // State of a streaming decode: bytes of an incomplete character held
+        // back from the previous chunk, and whether a BOM may still follow
+        this._pending = null;
+        this._atStreamStart = true;
+    }
+
+    get encoding() {
+        return this._encoding;
+    }
+
+    get fatal() {
+        return this._fatal;
+    }
+
+    get ignoreBOM() {
+        return this._ignoreBOM;
+    }
+
+    // With {stream: true}, an incomplete character at the end of @input is
+    // held back and completed by the next call, so data read in chunks can be
+    // decoded one chunk at a time. Multi-byte encodings other than UTF-8 and
+    // UTF-16 are decoded chunk by chunk without this.
+    decode(input = new Uint8Array(), options = {}) {
+        const stream = Boolean(options.stream);
+        let bytes = _toUint8Array(input);
+
+        if (this._pending) {
+            // Only copies the chunk if a character straddles its start
+            const combined = new Uint8Array(this._pending.length + bytes.length);
+            combined.set(this._pending);
+            combined.set(bytes, this._pending.length);
+            bytes = combined;
+            this._pending = null;
+        }
+
+        if (stream) {
+            let tail = 0;
+            if (this._encoding === 'utf-8')
+                tail = _incompleteUtf8Tail(bytes);
+            else if (this._encoding === 'utf-16le' || this._encoding === 'utf-16be')
+                tail = _incompleteUtf16Tail(bytes, this._encoding === 'utf-16be');
+            if (tail > 0) {
+                this._pending = bytes.slice(bytes.length - tail);
+                bytes = bytes.subarray(0, bytes.length - tail);
+            }
+        }
+
+        const result = this._decodeChunk(bytes);
+        if (!stream)
+            this._atStreamStart = true;
+        return result;
+    }
+
+    _decodeChunk(bytes) {
+        if (bytes.length === 0)
+            return '';
+        const ignoreBOM = this._ignoreBOM || !this._atStreamStart;
+        this._atStreamStart = false;
+        return Native.decode(bytes, this._encoding, this._fatal, ignoreBOM);
+    }
+
+    get [Symbol.toStringTag]() {
+        return 'TextDecoder';
+    }
+};
+
+var TextEncoder = class TextEncoder {
+    get encoding() {
+        return 'utf-8';
+    }
+
+    encode(input = '') {
+        return Native.encode(`${input}`);
+    }
+
+    encodeInto(source, destination) {
+        return Native.encodeInto(`${source}`, destination);
+    }
+
+    get [Symbol.toStringTag]() {
+        return 'TextEncoder';
+    }
+};
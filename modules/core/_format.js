@@ -1,67 +1,16 @@
 // -*- mode: js; js-indent-level: 4; indent-tabs-mode: nil -*-
 
-/* exported vprintf */
+/* exported printf, vprintf */
 
-const CjsPrivate = imports.gi.CjsPrivate;
+// The format string is parsed, and the result built, natively in _formatNative.
+// Parsed format strings are cached, and the arguments are converted straight
+// into the UTF-8 result, so formatting creates no intermediate JS strings.
+const Native = imports._formatNative;
 
 function vprintf(string, args) {
-    let i = 0;
-    let usePos = false;
-    return string.replace(/%(?:([1-9][0-9]*)\$)?(I+)?([0-9]+)?(?:\.([0-9]+))?(.)/g, function (str, posGroup, flagsGroup, widthGroup, precisionGroup, genericGroup) {
-        if (precisionGroup !== '' && precisionGroup !== undefined &&
-            genericGroup !== 'f')
-            throw new Error("Precision can only be specified for 'f'");
-
-        let hasAlternativeIntFlag = flagsGroup &&
-            flagsGroup.indexOf('I') !== -1;
-        if (hasAlternativeIntFlag && genericGroup !== 'd')
-            throw new Error("Alternative output digits can only be specfied for 'd'");
-
-        let pos = parseInt(posGroup, 10) || 0;
-        if (!usePos && i === 0)
-            usePos = pos > 0;
-        if (usePos && pos === 0 || !usePos && pos > 0)
-            throw new Error('Numbered and unnumbered conversion specifications cannot be mixed');
-
-        let fillChar = widthGroup && widthGroup[0] === '0' ? '0' : ' ';
-        let width = parseInt(widthGroup, 10) || 0;
-
-        function fillWidth(s, c, w) {
-            let fill = c.repeat(w);
-            return fill.substr(s.length) + s;
-        }
-
-        function getArg() {
-            return usePos ? args[pos - 1] : args[i++];
-        }
+    return Native.vprintf(string, args);
+}
 
-        let s = '';
-        switch (genericGroup) {
-        case '%':
-            return '%';
-        case 's':
-            s = String(getArg());
-            break;
-        case 'd': {
-            let intV = parseInt(getArg());
-            if (hasAlternativeIntFlag)
-                s = CjsPrivate.format_int_alternative_output(intV);
-            else
-                s = intV.toString();
-            break;
-        }
-        case 'x':
-            s = parseInt(getArg()).toString(16);
-            break;
-        case 'f':
-            if (precisionGroup === '' || precisionGroup === undefined)
-                s = parseFloat(getArg()).toString();
-            else
-                s = parseFloat(getArg()).toFixed(parseInt(precisionGroup));
-            break;
-        default:
-            throw new Error(`Unsupported conversion character %${genericGroup}`);
-        }
-        return fillWidth(s, fillChar, width);
-    });
+function printf(string, args) {
+    Native.printf(string, args);
 }
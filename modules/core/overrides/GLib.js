@@ -19,9 +19,15 @@
 // IN THE SOFTWARE.
 
 const ByteArray = imports.byteArray;
+const Gi = imports._gi;
 
 let GLib;
 
+// Variants are packed and unpacked natively; the JS implementation below is
+// kept as a fallback, and can be selected with GJS_DISABLE_NATIVE_VARIANT set
+let _packVariantNative = Gi.pack_variant;
+let _unpackVariantNative = Gi.unpack_variant;
+
 const SIMPLE_TYPES = ['b', 'y', 'n', 'q', 'i', 'u', 'x', 't', 'h', 'd', 's', 'o', 'g'];
 
 function _readSingleType(signature, forceSimple) {
@@ -184,6 +190,9 @@ function _packVariant(signature, value) {
 }
 
 function _unpackVariant(variant, deep, recursive = false) {
+    if (_unpackVariantNative)
+        return _unpackVariantNative(variant, deep, recursive);
+
     switch (String.fromCharCode(variant.classify())) {
     case 'b':
         return variant.get_boolean();
@@ -285,6 +294,11 @@ function _init() {
 
     GLib = this;
 
+    if (GLib.getenv('GJS_DISABLE_NATIVE_VARIANT')) {
+        _packVariantNative = null;
+        _unpackVariantNative = null;
+    }
+
     // small HACK: we add a matches() method to standard Errors so that
     // you can do "if (e.matches(Ns.FooError, Ns.FooError.SOME_CODE))"
     // without checking instanceof
@@ -293,6 +307,9 @@ function _init() {
     };
 
     this.Variant._new_internal = function (sig, value) {
+        if (_packVariantNative && typeof sig === 'string')
+            return _packVariantNative(sig, value);
+
         let signature = Array.prototype.slice.call(sig);
 
         let variant = _packVariant(signature, value);
@@ -320,6 +337,12 @@ function _init() {
         return _unpackVariant(this, true, true);
     };
 
+    // Arrays of fixed-size numbers as the matching typed array, which gets a
+    // copy of the variant's data in one block rather than element by element
+    this.Variant.prototype.toTypedArray = function () {
+        return Gi.variant_to_typed_array(this);
+    };
+
     this.Variant.prototype.toString = function () {
         return `[object variant of type "${this.get_type_string()}"]`;
     };
@@ -328,6 +351,10 @@ function _init() {
         return imports.byteArray.fromGBytes(this);
     };
 
+    this.runInThread = function (fn, ...args) {
+        return Gi.run_in_thread(fn, args);
+    };
+
     this.log_structured = function (logDomain, logLevel, stringFields) {
         let fields = {};
         for (let key in stringFields)
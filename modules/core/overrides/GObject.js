@@ -113,6 +113,26 @@ function _createSignals(gtype, sigs) {
     }
 }
 
+// The vfunc_ methods that a class being registered ends up with on its
+// prototype, once the interfaces' and its own methods are copied there, as
+// [name, function] pairs
+function _vfuncOverrides(klass, ifaces) {
+    const vfuncs = new Map();
+    ifaces.map(iface => iface.prototype).concat(klass.prototype)
+    .forEach(proto => {
+        Object.getOwnPropertyNames(proto)
+        .filter(name => name.startsWith('vfunc_'))
+        .forEach(name => {
+            const descr = Object.getOwnPropertyDescriptor(proto, name);
+            if (typeof descr.value === 'function')
+                vfuncs.set(name.slice(6), descr.value);
+            else
+                vfuncs.delete(name.slice(6));
+        });
+    });
+    return [...vfuncs];
+}
+
 function _getCallerBasename() {
     const stackLines = new Error().stack.trim().split('\n');
     const lineRegex = new RegExp(/@(.+:\/\/)?(.*\/)?(.+)\.js:\d+(:[\d]+)?$/);
@@ -240,6 +260,9 @@ function _init() {
 
     GObject = this;
 
+    // GObject's names are looked up everywhere, so atomize them up front
+    Gi.preatomize_names('GObject');
+
     function _makeDummyClass(obj, name, upperName, gtypeName, actual) {
         let gtype = GObject.type_from_name(gtypeName);
         obj[`TYPE_${upperName}`] = gtype;
@@ -448,12 +471,13 @@ function _init() {
 
         propertiesArray.forEach(pspec => _checkAccessors(klass.prototype, pspec, GObject));
 
-        let newClass = Gi.register_type(parent.prototype, gtypename, gflags,
-            gobjectInterfaces, propertiesArray);
+        // Registers the type, creates its signals, and hooks up its vfunc
+        // overrides in one call
+        let newClass = Gi.register_class(parent.prototype, gtypename, gflags,
+            gobjectInterfaces, propertiesArray, gobjectSignals,
+            _vfuncOverrides(klass, gobjectInterfaces));
         Object.setPrototypeOf(newClass, parent);
 
-        _createSignals(newClass.$gtype, gobjectSignals);
-
         _copyAllDescriptors(newClass, klass);
         gobjectInterfaces.forEach(iface =>
             _copyAllDescriptors(newClass.prototype, iface.prototype,
@@ -461,7 +485,7 @@ function _init() {
         _copyAllDescriptors(newClass.prototype, klass.prototype);
 
         Object.getOwnPropertyNames(newClass.prototype)
-        .filter(name => name.startsWith('vfunc_') || name.startsWith('on_'))
+        .filter(name => name.startsWith('on_'))
         .forEach(name => {
             let descr = Object.getOwnPropertyDescriptor(newClass.prototype, name);
             if (typeof descr.value !== 'function')
@@ -469,18 +493,14 @@ function _init() {
 
             let func = newClass.prototype[name];
 
-            if (name.startsWith('vfunc_')) {
-                newClass.prototype[Gi.hook_up_vfunc_symbol](name.slice(6), func);
-            } else if (name.startsWith('on_')) {
-                let id = GObject.signal_lookup(name.slice(3).replace('_', '-'),
-                    newClass.$gtype);
-                if (id !== 0) {
-                    GObject.signal_override_class_closure(id, newClass.$gtype, function (...argArray) {
-                        let emitter = argArray.shift();
-
-                        return func.apply(emitter, argArray);
-                    });
-                }
+            let id = GObject.signal_lookup(name.slice(3).replace('_', '-'),
+                newClass.$gtype);
+            if (id !== 0) {
+                GObject.signal_override_class_closure(id, newClass.$gtype, function (...argArray) {
+                    let emitter = argArray.shift();
+
+                    return func.apply(emitter, argArray);
+                });
             }
         });
 
@@ -620,6 +640,8 @@ function _init() {
      *   connected to.
      * @param {Function} [match.func] - the callback function the handler will
      *   invoke.
+     * @param {number} [match.group] - group the handler was connected in, see
+     *   GObject.signal_handler_group_new().
      * @returns {number|BigInt|Object|null} A valid non-0 signal handler ID for
      *   a successful match.
      */
@@ -647,6 +669,8 @@ function _init() {
      *   connected to.
      * @param {Function} match.func - the callback function the handler will
      *   invoke.
+     * @param {number} [match.group] - group the handler was connected in, see
+     *   GObject.signal_handler_group_new().
      * @returns {number} The number of handlers that matched.
      */
     GObject.signal_handlers_block_matched = function (instance, match) {
@@ -676,6 +700,8 @@ function _init() {
      *   connected to.
      * @param {Function} match.func - the callback function the handler will
      *   invoke.
+     * @param {number} [match.group] - group the handler was connected in, see
+     *   GObject.signal_handler_group_new().
      * @returns {number} The number of handlers that matched.
      */
     GObject.signal_handlers_unblock_matched = function (instance, match) {
@@ -703,6 +729,8 @@ function _init() {
      *   connected to.
      * @param {Function} match.func - the callback function the handler will
      *   invoke.
+     * @param {number} [match.group] - group the handler was connected in, see
+     *   GObject.signal_handler_group_new().
      * @returns {number} The number of handlers that matched.
      */
     GObject.signal_handlers_disconnect_matched = function (instance, match) {
@@ -745,6 +773,20 @@ function _init() {
     GObject.signal_handlers_disconnect_by_func = function (instance, func) {
         return instance[Gi.signals_disconnect_symbol]({func});
     };
+    let _nextSignalHandlerGroup = 1;
+    /**
+     * Returns a new signal handler group. Passing it as the last argument of
+     * connect() or connect_after() puts the handler in that group, and a
+     * `group` match criterion to GObject.signal_handlers_block_matched() and
+     * similar functions then blocks, unblocks, or disconnects all the
+     * handlers connected in that group in one call.
+     * @function
+     * @returns {number} A nonzero signal handler group.
+     */
+    GObject.signal_handler_group_new = function () {
+        return _nextSignalHandlerGroup++;
+    };
+
     GObject.signal_handlers_disconnect_by_data = function () {
         throw new Error('GObject.signal_handlers_disconnect_by_data() is not \
 introspectable. Use GObject.signal_handlers_disconnect_by_func() instead.');
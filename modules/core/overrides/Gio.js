@@ -72,7 +72,47 @@ function _validateFDVariant(variant, fdList) {
     throw new Error('Assertion failure: this code should not be reached');
 }
 
-function _proxyInvoker(methodName, sync, inSignature, argArray) {
+// Signatures of an interface's methods and properties, worked out once for
+// each Gio.DBusInterfaceInfo rather than on every call
+const _interfacePlans = new WeakMap();
+
+function _makeTupleSignature(args) {
+    return `(${args.map(arg => arg.signature).join('')})`;
+}
+
+function _makeMethodPlan(method) {
+    const inSignature = _makeTupleSignature(method.in_args);
+    const outSignature = _makeTupleSignature(method.out_args);
+    return {
+        nInArgs: method.in_args.length,
+        inSignature,
+        inHasHandles: inSignature.includes('h'),
+        nOutArgs: method.out_args.length,
+        outSignature,
+        outHasHandles: outSignature.includes('h'),
+    };
+}
+
+function _getInterfacePlan(info) {
+    let plan = _interfacePlans.get(info);
+    if (plan)
+        return plan;
+
+    plan = {
+        methods: new Map(),
+        properties: new Map(),
+        hasSignals: info.signals.length > 0,
+    };
+    for (const method of info.methods)
+        plan.methods.set(method.name, _makeMethodPlan(method));
+    for (const {name, signature, flags} of info.properties)
+        plan.properties.set(name, {signature, flags});
+
+    _interfacePlans.set(info, plan);
+    return plan;
+}
+
+function _proxyInvoker(methodName, sync, methodPlan, argArray) {
     var replyFunc;
     var flags = 0;
     var cancellable = null;
@@ -84,7 +124,7 @@ function _proxyInvoker(methodName, sync, inSignature, argArray) {
     /* The default replyFunc only logs the responses */
     replyFunc = _logReply;
 
-    var signatureLength = inSignature.length;
+    var signatureLength = methodPlan.nInArgs;
     var minNumberArgs = signatureLength;
     var maxNumberArgs = signatureLength + 4;
 
@@ -115,9 +155,8 @@ function _proxyInvoker(methodName, sync, inSignature, argArray) {
         }
     }
 
-    const inTypeString = `(${inSignature.join('')})`;
-    const inVariant = new GLib.Variant(inTypeString, argArray);
-    if (inTypeString.includes('h')) {
+    const inVariant = new GLib.Variant(methodPlan.inSignature, argArray);
+    if (methodPlan.inHasHandles) {
         if (!fdList) {
             throw new Error(`Method ${methodName} with input type containing ` +
                 '\'h\' must have a Gio.UnixFDList as an argument');
@@ -147,21 +186,56 @@ function _proxyInvoker(methodName, sync, inSignature, argArray) {
         cancellable, asyncCallback);
 }
 
+// Sends several method calls back to back without waiting for each reply, so
+// that they cost one round trip together. Each call is given as an array of
+// the method name followed by its arguments. Returns a promise for each call's
+// unpacked reply, in the same order.
+function _proxyCallMany(calls, cancellable = null) {
+    const info = this.g_interface_info;
+    if (!info)
+        throw new Error('callMany() needs a proxy with interface info');
+    const plan = _getInterfacePlan(info);
+
+    // Everything is packed before sending anything, so that a mistake in one
+    // call doesn't leave the batch half sent
+    const inVariants = calls.map(([methodName, ...args]) => {
+        const methodPlan = plan.methods.get(methodName);
+        if (!methodPlan) {
+            throw new Error(`No method ${methodName} on interface ${
+                info.name}`);
+        }
+        if (args.length !== methodPlan.nInArgs) {
+            throw new Error(`Wrong number of arguments passed for method ${
+                methodName}. Expected ${methodPlan.nInArgs}, got ${
+                args.length}`);
+        }
+        if (methodPlan.inHasHandles) {
+            throw new Error(`Method ${methodName} takes file descriptors, ` +
+                'which callMany() does not support');
+        }
+        return new GLib.Variant(methodPlan.inSignature, args);
+    });
+
+    return inVariants.map((inVariant, ix) => new Promise((resolve, reject) => {
+        this.call(calls[ix][0], inVariant, Gio.DBusCallFlags.NONE, -1,
+            cancellable, (proxy, result) => {
+                try {
+                    resolve(proxy.call_finish(result).deepUnpack());
+                } catch (e) {
+                    reject(e);
+                }
+            });
+    }));
+}
+
 function _logReply(result, exc) {
     if (exc !== null)
         log(`Ignored exception from dbus method: ${exc}`);
 }
 
-function _makeProxyMethod(method, sync) {
-    var i;
-    var name = method.name;
-    var inArgs = method.in_args;
-    var inSignature = [];
-    for (i = 0; i < inArgs.length; i++)
-        inSignature.push(inArgs[i].signature);
-
+function _makeProxyMethod(name, methodPlan, sync) {
     return function (...args) {
-        return _proxyInvoker.call(this, name, sync, inSignature, args);
+        return _proxyInvoker.call(this, name, sync, methodPlan, args);
     };
 }
 
@@ -196,21 +270,16 @@ function _addDBusConvenience() {
     if (!info)
         return;
 
-    if (info.signals.length > 0)
+    const plan = _getInterfacePlan(info);
+    if (plan.hasSignals)
         this.connect('g-signal', _convertToNativeSignal);
 
-    let i, methods = info.methods;
-    for (i = 0; i < methods.length; i++) {
-        var method = methods[i];
-        this[`${method.name}Remote`] = _makeProxyMethod(methods[i], false);
-        this[`${method.name}Sync`] = _makeProxyMethod(methods[i], true);
+    for (const [name, methodPlan] of plan.methods) {
+        this[`${name}Remote`] = _makeProxyMethod(name, methodPlan, false);
+        this[`${name}Sync`] = _makeProxyMethod(name, methodPlan, true);
     }
 
-    let properties = info.properties;
-    for (i = 0; i < properties.length; i++) {
-        let name = properties[i].name;
-        let signature = properties[i].signature;
-        let flags = properties[i].flags;
+    for (const [name, {signature, flags}] of plan.properties) {
         let getter = () => {
             throw new Error(`Property ${name} is not readable`);
         };
@@ -236,6 +305,7 @@ function _addDBusConvenience() {
 function _makeProxyWrapper(interfaceXml) {
     var info = _newInterfaceInfo(interfaceXml);
     var iname = info.name;
+    _getInterfacePlan(info);
     return function (bus, name, object, asyncCallback, cancellable,
         flags = Gio.DBusProxyFlags.NONE) {
         var obj = new Gio.DBusProxy({
@@ -310,15 +380,7 @@ function _wrapFunction(klass, method, addition) {
     };
 }
 
-function _makeOutSignature(args) {
-    var ret = '(';
-    for (var i = 0; i < args.length; i++)
-        ret += args[i].signature;
-
-    return `${ret})`;
-}
-
-function _handleMethodCall(info, impl, methodName, parameters, invocation) {
+function _handleMethodCall(plan, impl, methodName, parameters, invocation) {
     // prefer a sync version if available
     if (this[methodName]) {
         let retval;
@@ -347,18 +409,16 @@ function _handleMethodCall(info, impl, methodName, parameters, invocation) {
             let outFdList = null;
             if (!(retval instanceof GLib.Variant)) {
                 // attempt packing according to out signature
-                let methodInfo = info.lookup_method(methodName);
-                let outArgs = methodInfo.out_args;
-                let outSignature = _makeOutSignature(outArgs);
-                if (outSignature.includes('h') &&
+                const methodPlan = plan.methods.get(methodName);
+                if (methodPlan.outHasHandles &&
                     retval[retval.length - 1] instanceof Gio.UnixFDList) {
                     outFdList = retval.pop();
-                } else if (outArgs.length === 1) {
+                } else if (methodPlan.nOutArgs === 1) {
                     // if one arg, we don't require the handler wrapping it
                     // into an Array
                     retval = [retval];
                 }
-                retval = new GLib.Variant(outSignature, retval);
+                retval = new GLib.Variant(methodPlan.outSignature, retval);
             }
             invocation.return_value_with_unix_fd_list(retval, outFdList);
         } catch (e) {
@@ -378,16 +438,16 @@ function _handleMethodCall(info, impl, methodName, parameters, invocation) {
     }
 }
 
-function _handlePropertyGet(info, impl, propertyName) {
-    let propInfo = info.lookup_property(propertyName);
+function _handlePropertyGet(plan, impl, propertyName) {
+    let {signature} = plan.properties.get(propertyName);
     let jsval = this[propertyName];
     if (jsval !== undefined)
-        return new GLib.Variant(propInfo.signature, jsval);
+        return new GLib.Variant(signature, jsval);
     else
         return null;
 }
 
-function _handlePropertySet(info, impl, propertyName, newValue) {
+function _handlePropertySet(plan, impl, propertyName, newValue) {
     this[propertyName] = newValue.deepUnpack();
 }
 
@@ -398,26 +458,62 @@ function _wrapJSObject(interfaceInfo, jsObj) {
     else
         info = Gio.DBusInterfaceInfo.new_for_xml(interfaceInfo);
     info.cache_build();
+    const plan = _getInterfacePlan(info);
 
     var impl = new CjsPrivate.DBusImplementation({g_interface_info: info});
-    impl.connect('handle-method-call', function (self, methodName, parameters, invocation) {
-        return _handleMethodCall.call(jsObj, info, self, methodName, parameters, invocation);
+    // Method calls are dispatched directly rather than through the
+    // handle-method-call signal
+    impl.set_method_handler(function (self, methodName, parameters, invocation) {
+        return _handleMethodCall.call(jsObj, plan, self, methodName, parameters, invocation);
     });
     impl.connect('handle-property-get', function (self, propertyName) {
-        return _handlePropertyGet.call(jsObj, info, self, propertyName);
+        return _handlePropertyGet.call(jsObj, plan, self, propertyName);
     });
     impl.connect('handle-property-set', function (self, propertyName, value) {
-        return _handlePropertySet.call(jsObj, info, self, propertyName, value);
+        return _handlePropertySet.call(jsObj, plan, self, propertyName, value);
     });
 
     return impl;
 }
 
+// Gets the items of a list model in one call, rather than one get_item() per
+// item. For models implemented in JS, this calls their vfuncs directly instead
+// of going through C and back for every item.
+function _listModelGetItems(position = 0, count = GLib.MAXUINT32) {
+    if (typeof this.vfunc_get_item === 'function') {
+        const end = Math.min(position + count, this.vfunc_get_n_items());
+        const items = [];
+        for (let index = position; index < end; index++)
+            items.push(this.vfunc_get_item(index));
+        return items;
+    }
+    return CjsPrivate.list_model_get_items(this, position, count);
+}
+
 function* _listModelIterator() {
-    let _index = 0;
-    const _len = this.get_n_items();
-    while (_index < _len)
-        yield this.get_item(_index++);
+    const len = this.get_n_items();
+    for (let index = 0; index < len; index += 64)
+        yield* _listModelGetItems.call(this, index, Math.min(64, len - index));
+}
+
+// Copies a whole input stream into this output stream without going through
+// JS for each chunk, like splice_async(), calling onProgress with the number
+// of bytes copied so far at most once every progressInterval milliseconds.
+// Returns a Promise for the total number of bytes copied.
+function _outputStreamSpliceWithProgress(source, flags = Gio.OutputStreamSpliceFlags.NONE,
+    ioPriority = GLib.PRIORITY_DEFAULT, cancellable = null,
+    progressInterval = 100, onProgress = null) {
+    return new Promise((resolve, reject) => {
+        CjsPrivate.output_stream_splice_with_progress_async(this, source,
+            flags, ioPriority, progressInterval, onProgress, cancellable,
+            (obj, res) => {
+                try {
+                    resolve(CjsPrivate.output_stream_splice_with_progress_finish(res));
+                } catch (error) {
+                    reject(error);
+                }
+            });
+    });
 }
 
 function _promisify(proto, asyncFunc, finishFunc) {
@@ -449,6 +545,24 @@ function _promisify(proto, asyncFunc, finishFunc) {
     };
 }
 
+function _defineLazyProperty(obj, name, getter) {
+    Object.defineProperty(obj, name, {
+        get() {
+            const value = getter();
+            Object.defineProperty(obj, name, {value, writable: true});
+            return value;
+        },
+        configurable: true,
+    });
+}
+
+function _createCheckedMethod(method, checkMethod = '_checkKey') {
+    return function (id, ...args) {
+        this[checkMethod](id);
+        return this._realMethods[method].call(this, id, ...args);
+    };
+}
+
 function _init() {
     Gio = this;
 
@@ -474,151 +588,212 @@ function _init() {
         unwatch_name: Gio.bus_unwatch_name,
     };
 
-    Gio.DBusConnection.prototype.watch_name = function (name, flags, appeared, vanished) {
-        return Gio.bus_watch_name_on_connection(this, name, flags, appeared, vanished);
-    };
-    Gio.DBusConnection.prototype.unwatch_name = function (id) {
-        return Gio.bus_unwatch_name(id);
-    };
-    Gio.DBusConnection.prototype.own_name = function (name, flags, acquired, lost) {
-        return Gio.bus_own_name_on_connection(this, name, flags, acquired, lost);
-    };
-    Gio.DBusConnection.prototype.unown_name = function (id) {
-        return Gio.bus_unown_name(id);
-    };
+    _defineLazyProperty(Gio, 'DBusExportedObject', () => {
+        const klass = CjsPrivate.DBusImplementation;
+        klass.wrapJSObject = _wrapJSObject;
+        return klass;
+    });
 
-    _injectToMethod(Gio.DBusProxy.prototype, 'init', _addDBusConvenience);
-    _injectToMethod(Gio.DBusProxy.prototype, 'init_async', _addDBusConvenience);
-    _injectToStaticMethod(Gio.DBusProxy, 'new_sync', _addDBusConvenience);
-    _injectToStaticMethod(Gio.DBusProxy, 'new_finish', _addDBusConvenience);
-    _injectToStaticMethod(Gio.DBusProxy, 'new_for_bus_sync', _addDBusConvenience);
-    _injectToStaticMethod(Gio.DBusProxy, 'new_for_bus_finish', _addDBusConvenience);
-    Gio.DBusProxy.prototype.connectSignal = Signals._connect;
-    Gio.DBusProxy.prototype.disconnectSignal = Signals._disconnect;
+    // Promisify
+    Gio._promisify = _promisify;
 
-    Gio.DBusProxy.makeProxyWrapper = _makeProxyWrapper;
+    // Array-backed list model, to splice with whole JS arrays
+    Gio.ArrayStore = CjsPrivate.ArrayStore;
+    Gio.ArrayStore.prototype.getItems = _listModelGetItems;
+    Gio.ArrayStore.prototype[Symbol.iterator] = _listModelIterator;
+
+    // Temporary Gio.File.prototype fix
+    _defineLazyProperty(Gio, '_LocalFilePrototype',
+        () => Gio.File.new_for_path('').constructor.prototype);
+}
+
+// Overrides for individual classes, each applied when the class is first
+// looked up in the namespace, instead of all at once when Gio is imported
+var _classOverrides = {
+    DBusConnection(klass) {
+        klass.prototype.watch_name = function (name, flags, appeared, vanished) {
+            return Gio.bus_watch_name_on_connection(this, name, flags, appeared, vanished);
+        };
+        klass.prototype.unwatch_name = function (id) {
+            return Gio.bus_unwatch_name(id);
+        };
+        klass.prototype.own_name = function (name, flags, acquired, lost) {
+            return Gio.bus_own_name_on_connection(this, name, flags, acquired, lost);
+        };
+        klass.prototype.unown_name = function (id) {
+            return Gio.bus_unown_name(id);
+        };
+    },
+
+    DBusProxy(klass) {
+        _injectToMethod(klass.prototype, 'init', _addDBusConvenience);
+        _injectToMethod(klass.prototype, 'init_async', _addDBusConvenience);
+        _injectToStaticMethod(klass, 'new_sync', _addDBusConvenience);
+        _injectToStaticMethod(klass, 'new_finish', _addDBusConvenience);
+        _injectToStaticMethod(klass, 'new_for_bus_sync', _addDBusConvenience);
+        _injectToStaticMethod(klass, 'new_for_bus_finish', _addDBusConvenience);
+        klass.prototype.callMany = _proxyCallMany;
+        klass.prototype.connectSignal = Signals._connect;
+        klass.prototype.disconnectSignal = Signals._disconnect;
+
+        klass.makeProxyWrapper = _makeProxyWrapper;
+    },
 
     // Some helpers
-    _wrapFunction(Gio.DBusNodeInfo, 'new_for_xml', _newNodeInfo);
-    Gio.DBusInterfaceInfo.new_for_xml = _newInterfaceInfo;
+    DBusNodeInfo(klass) {
+        _wrapFunction(klass, 'new_for_xml', _newNodeInfo);
+    },
 
-    Gio.DBusExportedObject = CjsPrivate.DBusImplementation;
-    Gio.DBusExportedObject.wrapJSObject = _wrapJSObject;
+    DBusInterfaceInfo(klass) {
+        klass.new_for_xml = _newInterfaceInfo;
+    },
 
-    // ListStore
-    Gio.ListStore.prototype[Symbol.iterator] = _listModelIterator;
+    // Copied onto JS classes that implement the interface
+    ListModel(klass) {
+        klass.prototype.getItems = _listModelGetItems;
+        klass.prototype[Symbol.iterator] = _listModelIterator;
+    },
 
-    // Promisify
-    Gio._promisify = _promisify;
+    ListStore(klass) {
+        klass.prototype.getItems = _listModelGetItems;
+        klass.prototype[Symbol.iterator] = _listModelIterator;
+    },
 
-    // Temporary Gio.File.prototype fix
-    Gio._LocalFilePrototype = Gio.File.new_for_path('').constructor.prototype;
+    OutputStream(klass) {
+        klass.prototype.spliceWithProgress = _outputStreamSpliceWithProgress;
+    },
 
     // Override Gio.Settings and Gio.SettingsSchema - the C API asserts if
     // trying to access a nonexistent schema or key, which is not handy for
     // shell-extension writers
 
-    Gio.SettingsSchema.prototype._realGetKey = Gio.SettingsSchema.prototype.get_key;
-    Gio.SettingsSchema.prototype.get_key = function (key) {
-        if (!this.has_key(key))
-            throw new Error(`GSettings key ${key} not found in schema ${this.get_id()}`);
-        return this._realGetKey(key);
-    };
-
-    Gio.Settings.prototype._realMethods = Object.assign({}, Gio.Settings.prototype);
-
-    function createCheckedMethod(method, checkMethod = '_checkKey') {
-        return function (id, ...args) {
-            this[checkMethod](id);
-            return this._realMethods[method].call(this, id, ...args);
+    SettingsSchema(klass) {
+        klass.prototype._realGetKey = klass.prototype.get_key;
+        klass.prototype.get_key = function (key) {
+            if (!this.has_key(key))
+                throw new Error(`GSettings key ${key} not found in schema ${this.get_id()}`);
+            return this._realGetKey(key);
         };
-    }
-
-    Object.assign(Gio.Settings.prototype, {
-        _realInit: Gio.Settings.prototype._init,  // add manually, not enumerable
-        _init(props = {}) {
-            // 'schema' is a deprecated alias for schema_id
-            const schemaIdProp = ['schema', 'schema-id', 'schema_id',
-                'schemaId'].find(prop => prop in props);
-            const settingsSchemaProp = ['settings-schema', 'settings_schema',
-                'settingsSchema'].find(prop => prop in props);
-            if (!schemaIdProp && !settingsSchemaProp) {
-                throw new Error('One of property \'schema-id\' or ' +
-                    '\'settings-schema\' are required for Gio.Settings');
-            }
-
-            const source = Gio.SettingsSchemaSource.get_default();
-            const settingsSchema = settingsSchemaProp
-                ? props[settingsSchemaProp]
-                : source.lookup(props[schemaIdProp], true);
-
-            if (!settingsSchema)
-                throw new Error(`GSettings schema ${props[schemaIdProp]} not found`);
-
-            const settingsSchemaPath = settingsSchema.get_path();
-            if (props['path'] === undefined && !settingsSchemaPath) {
-                throw new Error('Attempting to create schema ' +
-                    `'${settingsSchema.get_id()}' without a path`);
-            }
-
-            if (props['path'] !== undefined && settingsSchemaPath &&
-                props['path'] !== settingsSchemaPath) {
-                throw new Error(`GSettings created for path '${props['path']}'` +
-                    `, but schema specifies '${settingsSchemaPath}'`);
-            }
+    },
+
+    Settings(klass) {
+        klass.prototype._realMethods = Object.assign({}, klass.prototype);
+
+        Object.assign(klass.prototype, {
+            _realInit: klass.prototype._init,  // add manually, not enumerable
+            _init(props = {}) {
+                // 'schema' is a deprecated alias for schema_id
+                const schemaIdProp = ['schema', 'schema-id', 'schema_id',
+                    'schemaId'].find(prop => prop in props);
+                const settingsSchemaProp = ['settings-schema', 'settings_schema',
+                    'settingsSchema'].find(prop => prop in props);
+                if (!schemaIdProp && !settingsSchemaProp) {
+                    throw new Error('One of property \'schema-id\' or ' +
+                        '\'settings-schema\' are required for Gio.Settings');
+                }
 
-            return this._realInit(props);
-        },
+                const source = Gio.SettingsSchemaSource.get_default();
+                const settingsSchema = settingsSchemaProp
+                    ? props[settingsSchemaProp]
+                    : source.lookup(props[schemaIdProp], true);
 
-        _checkKey(key) {
-            // Avoid using has_key(); checking a JS array is faster than calling
-            // through G-I.
-            if (!this._keys)
-                this._keys = this.settings_schema.list_keys();
+                if (!settingsSchema)
+                    throw new Error(`GSettings schema ${props[schemaIdProp]} not found`);
 
-            if (!this._keys.includes(key))
-                throw new Error(`GSettings key ${key} not found in schema ${this.schema_id}`);
-        },
-
-        _checkChild(name) {
-            if (!this._children)
-                this._children = this.list_children();
+                const settingsSchemaPath = settingsSchema.get_path();
+                if (props['path'] === undefined && !settingsSchemaPath) {
+                    throw new Error('Attempting to create schema ' +
+                        `'${settingsSchema.get_id()}' without a path`);
+                }
 
-            if (!this._children.includes(name))
-                throw new Error(`Child ${name} not found in GSettings schema ${this.schema_id}`);
-        },
+                if (props['path'] !== undefined && settingsSchemaPath &&
+                    props['path'] !== settingsSchemaPath) {
+                    throw new Error(`GSettings created for path '${props['path']}'` +
+                        `, but schema specifies '${settingsSchemaPath}'`);
+                }
 
-        get_boolean: createCheckedMethod('get_boolean'),
-        set_boolean: createCheckedMethod('set_boolean'),
-        get_double: createCheckedMethod('get_double'),
-        set_double: createCheckedMethod('set_double'),
-        get_enum: createCheckedMethod('get_enum'),
-        set_enum: createCheckedMethod('set_enum'),
-        get_flags: createCheckedMethod('get_flags'),
-        set_flags: createCheckedMethod('set_flags'),
-        get_int: createCheckedMethod('get_int'),
-        set_int: createCheckedMethod('set_int'),
-        get_int64: createCheckedMethod('get_int64'),
-        set_int64: createCheckedMethod('set_int64'),
-        get_string: createCheckedMethod('get_string'),
-        set_string: createCheckedMethod('set_string'),
-        get_strv: createCheckedMethod('get_strv'),
-        set_strv: createCheckedMethod('set_strv'),
-        get_uint: createCheckedMethod('get_uint'),
-        set_uint: createCheckedMethod('set_uint'),
-        get_uint64: createCheckedMethod('get_uint64'),
-        set_uint64: createCheckedMethod('set_uint64'),
-        get_value: createCheckedMethod('get_value'),
-        set_value: createCheckedMethod('set_value'),
-
-        bind: createCheckedMethod('bind'),
-        bind_writable: createCheckedMethod('bind_writable'),
-        create_action: createCheckedMethod('create_action'),
-        get_default_value: createCheckedMethod('get_default_value'),
-        get_user_value: createCheckedMethod('get_user_value'),
-        is_writable: createCheckedMethod('is_writable'),
-        reset: createCheckedMethod('reset'),
-
-        get_child: createCheckedMethod('get_child', '_checkChild'),
-    });
-}
+                return this._realInit(props);
+            },
+
+            _checkKey(key) {
+                // Avoid using has_key(); checking a JS set is faster than calling
+                // through G-I.
+                if (!this._keys)
+                    this._keys = new Set(this.settings_schema.list_keys());
+
+                if (!this._keys.has(key))
+                    throw new Error(`GSettings key ${key} not found in schema ${this.schema_id}`);
+            },
+
+            // Returns an object with a read-only property for each key, holding
+            // its deep-unpacked value. It is kept up to date from one 'changed'
+            // handler, so reading a key is a property access instead of a call
+            // through G-I and an unpacking of a GVariant each time.
+            getCache() {
+                if (this._cache)
+                    return this._cache;
+
+                const cache = Object.create(null);
+                const getValue = this._realMethods.get_value;
+                const update = (settings, key) => {
+                    Object.defineProperty(cache, key, {
+                        value: getValue.call(settings, key).deepUnpack(),
+                        configurable: true,
+                        enumerable: true,
+                        writable: false,
+                    });
+                };
+
+                // GSettings only emits 'changed' for keys that have been read
+                // after a handler was connected
+                this.connect('changed', update);
+                for (const key of this.settings_schema.list_keys())
+                    update(this, key);
+
+                this._cache = Object.preventExtensions(cache);
+                return cache;
+            },
+
+            _checkChild(name) {
+                if (!this._children)
+                    this._children = this.list_children();
+
+                if (!this._children.includes(name))
+                    throw new Error(`Child ${name} not found in GSettings schema ${this.schema_id}`);
+            },
+
+            get_boolean: _createCheckedMethod('get_boolean'),
+            set_boolean: _createCheckedMethod('set_boolean'),
+            get_double: _createCheckedMethod('get_double'),
+            set_double: _createCheckedMethod('set_double'),
+            get_enum: _createCheckedMethod('get_enum'),
+            set_enum: _createCheckedMethod('set_enum'),
+            get_flags: _createCheckedMethod('get_flags'),
+            set_flags: _createCheckedMethod('set_flags'),
+            get_int: _createCheckedMethod('get_int'),
+            set_int: _createCheckedMethod('set_int'),
+            get_int64: _createCheckedMethod('get_int64'),
+            set_int64: _createCheckedMethod('set_int64'),
+            get_string: _createCheckedMethod('get_string'),
+            set_string: _createCheckedMethod('set_string'),
+            get_strv: _createCheckedMethod('get_strv'),
+            set_strv: _createCheckedMethod('set_strv'),
+            get_uint: _createCheckedMethod('get_uint'),
+            set_uint: _createCheckedMethod('set_uint'),
+            get_uint64: _createCheckedMethod('get_uint64'),
+            set_uint64: _createCheckedMethod('set_uint64'),
+            get_value: _createCheckedMethod('get_value'),
+            set_value: _createCheckedMethod('set_value'),
+
+            bind: _createCheckedMethod('bind'),
+            bind_writable: _createCheckedMethod('bind_writable'),
+            create_action: _createCheckedMethod('create_action'),
+            get_default_value: _createCheckedMethod('get_default_value'),
+            get_user_value: _createCheckedMethod('get_user_value'),
+            is_writable: _createCheckedMethod('is_writable'),
+            reset: _createCheckedMethod('reset'),
+
+            get_child: _createCheckedMethod('get_child', '_checkChild'),
+        });
+    },
+};
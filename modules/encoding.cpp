@@ -0,0 +1,317 @@
+/* -*- mode: C++; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * SPDX-License-Identifier: MIT OR LGPL-2.0-or-later
+ */
+
+#include <config.h>
+
+#include <stddef.h>  // for size_t
+#include <stdint.h>
+#include <string.h>  // for memcpy, strcmp
+
+#include <utility>  // for move
+
+#include <glib.h>
+
+#include <js/ArrayBuffer.h>
+#include <js/CallArgs.h>
+#include <js/CharacterEncoding.h>
+#include <js/GCAPI.h>  // for AutoCheckCannotGC
+#include <js/PropertySpec.h>
+#include <js/RootingAPI.h>
+#include <js/TypeDecls.h>
+#include <js/Utility.h>  // for UniqueChars, UniqueTwoByteChars
+#include <jsapi.h>
+#include <jsfriendapi.h>  // for GetArrayBufferViewLengthAndData, ...
+#include <jspubtd.h>      // for JSProto_TypeError
+#include <mozilla/Maybe.h>
+#include <mozilla/Span.h>
+#include <mozilla/Tuple.h>
+
+#include "cjs/jsapi-util-args.h"
+#include "cjs/jsapi-util.h"
+#include "cjs/macros.h"
+#include "modules/encoding.h"
+
+// Typed arrays and ArrayBuffers this small may keep their bytes inline in the
+// GC thing, which can move if creating the result triggers a GC. Larger ones
+// are malloc'ed and stay put.
+static constexpr size_t MAX_INLINE_BYTES = 128;
+
+#if G_BYTE_ORDER == G_LITTLE_ENDIAN
+static constexpr const char* HOST_UTF16 = "UTF-16LE";
+#else
+static constexpr const char* HOST_UTF16 = "UTF-16BE";
+#endif
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool get_buffer_data(JSContext* cx, JS::HandleObject obj,
+                            uint8_t** data, size_t* len) {
+    uint32_t length;
+    bool is_shared_memory;
+
+    if (JS_IsArrayBufferViewObject(obj)) {
+        js::GetArrayBufferViewLengthAndData(obj, &length, &is_shared_memory,
+                                            data);
+    } else if (JS::IsArrayBufferObject(obj)) {
+        JS::GetArrayBufferLengthAndData(obj, &length, &is_shared_memory, data);
+    } else {
+        gjs_throw_custom(cx, JSProto_TypeError, nullptr,
+                         "Argument must be an ArrayBuffer or ArrayBufferView");
+        return false;
+    }
+
+    *len = length;
+    return true;
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool decode_utf8(JSContext* cx, const uint8_t* data, size_t len,
+                        bool fatal, JS::MutableHandleValue rval) {
+    JSString* str;
+    const char* chars = reinterpret_cast<const char*>(data);
+
+    if (gjs_ascii_prefix_length(data, len) == len) {
+        // ASCII is valid Latin-1, so the bytes can be copied as they are
+        str = JS_NewStringCopyN(cx, chars, len);
+    } else if (fatal) {
+        // Throws a TypeError on malformed input
+        str = JS_NewStringCopyUTF8N(cx, JS::UTF8Chars(chars, len));
+    } else {
+        size_t u16_len;
+        JS::UniqueTwoByteChars u16(
+            JS::LossyUTF8CharsToNewTwoByteCharsZ(
+                cx, JS::UTF8Chars(chars, len), &u16_len, js::MallocArena)
+                .get());
+        if (!u16)
+            return false;
+        str = JS_NewUCString(cx, std::move(u16), u16_len);
+    }
+    if (!str)
+        return false;
+
+    rval.setString(str);
+    return true;
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool decode_with_iconv(JSContext* cx, const uint8_t* data, size_t len,
+                              const char* encoding, bool strip_bom,
+                              JS::MutableHandleValue rval) {
+    size_t bytes_written;
+    GError* error = nullptr;
+    GjsAutoChar u16_str =
+        g_convert(reinterpret_cast<const char*>(data), len, HOST_UTF16,
+                  encoding, /* bytes read = */ nullptr, &bytes_written, &error);
+    if (!u16_str) {
+        gjs_throw_custom(cx, JSProto_TypeError, nullptr,
+                         "Failed to decode %s data: %s", encoding,
+                         error->message);
+        g_error_free(error);
+        return false;
+    }
+
+    const auto* u16_chars = reinterpret_cast<const char16_t*>(u16_str.get());
+    size_t u16_len = bytes_written / 2;
+    if (strip_bom && u16_len > 0 && u16_chars[0] == 0xFEFF) {
+        u16_chars++;
+        u16_len--;
+    }
+
+    JSString* str = JS_NewUCStringCopyN(cx, u16_chars, u16_len);
+    if (!str)
+        return false;
+
+    rval.setString(str);
+    return true;
+}
+
+// decode(bytes, encoding, fatal, ignoreBOM): @encoding is a name already
+// resolved from a label by the TextDecoder constructor
+GJS_JSAPI_RETURN_CONVENTION
+static bool decode_func(JSContext* cx, unsigned argc, JS::Value* vp) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+    JS::RootedObject bytes(cx);
+    JS::UniqueChars encoding;
+    bool fatal, ignore_bom;
+    if (!gjs_parse_call_args(cx, "decode", args, "osbb", "bytes", &bytes,
+                             "encoding", &encoding, "fatal", &fatal,
+                             "ignoreBOM", &ignore_bom))
+        return false;
+
+    uint8_t* data;
+    size_t len;
+    if (!get_buffer_data(cx, bytes, &data, &len))
+        return false;
+
+    uint8_t inline_copy[MAX_INLINE_BYTES];
+    if (len <= MAX_INLINE_BYTES) {
+        memcpy(inline_copy, data, len);
+        data = inline_copy;
+    }
+
+    if (strcmp(encoding.get(), "utf-8") == 0) {
+        if (!ignore_bom && len >= 3 && data[0] == 0xEF && data[1] == 0xBB &&
+            data[2] == 0xBF) {
+            data += 3;
+            len -= 3;
+        }
+        return decode_utf8(cx, data, len, fatal, args.rval());
+    }
+
+    // iconv rejects malformed input even when not in fatal mode
+    bool strip_bom = !ignore_bom && (strcmp(encoding.get(), "utf-16le") == 0 ||
+                                     strcmp(encoding.get(), "utf-16be") == 0);
+    return decode_with_iconv(cx, data, len, encoding.get(), strip_bom,
+                             args.rval());
+}
+
+// Returns the string in @value, flattened so that its chars can be read
+// directly, or throws if @value is not a string
+GJS_JSAPI_RETURN_CONVENTION
+static JSString* linear_string_arg(JSContext* cx, const char* func_name,
+                                   JS::HandleValue value) {
+    if (!value.isString()) {
+        gjs_throw_custom(cx, JSProto_TypeError, nullptr,
+                         "%s() requires a string argument", func_name);
+        return nullptr;
+    }
+
+    JSString* str = value.toString();
+    if (!JS_EnsureLinearString(cx, str))
+        return nullptr;
+    return str;
+}
+
+// encode(string): returns the UTF-8 encoding of @string in a new Uint8Array
+GJS_JSAPI_RETURN_CONVENTION
+static bool encode_func(JSContext* cx, unsigned argc, JS::Value* vp) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+    JS::RootedString str(cx, linear_string_arg(cx, "encode", args.get(0)));
+    if (!str)
+        return false;
+    JSLinearString* linear = JS_ASSERT_STRING_IS_LINEAR(str);
+
+    size_t len;
+    char* bytes;
+    {
+        JS::AutoCheckCannotGC nogc;
+        size_t length = js::GetLinearStringLength(linear);
+        const JS::Latin1Char* latin1 =
+            js::LinearStringHasLatin1Chars(linear)
+                ? js::GetLatin1LinearStringChars(nogc, linear)
+                : nullptr;
+
+        if (latin1 && gjs_ascii_prefix_length(latin1, length) == length) {
+            // ASCII has the same bytes in Latin-1 and UTF-8
+            len = length;
+            bytes = static_cast<char*>(g_malloc(len));
+            memcpy(bytes, latin1, len);
+        } else {
+            len = JS::GetDeflatedUTF8StringLength(linear);
+            bytes = static_cast<char*>(g_malloc(len));
+            JS::DeflateStringToUTF8Buffer(linear,
+                                          mozilla::Span<char>(bytes, len));
+        }
+    }
+
+    JS::RootedObject array_buffer(cx);
+    if (len == 0) {
+        g_free(bytes);
+        array_buffer = JS::NewArrayBuffer(cx, 0);
+    } else {
+        array_buffer = JS::NewArrayBufferWithContents(cx, len, bytes);
+        if (!array_buffer)
+            g_free(bytes);
+    }
+    if (!array_buffer)
+        return false;
+
+    JSObject* array = JS_NewUint8ArrayWithBuffer(cx, array_buffer, 0, -1);
+    if (!array)
+        return false;
+
+    args.rval().setObject(*array);
+    return true;
+}
+
+// encodeInto(string, uint8array): writes as much of the UTF-8 encoding of
+// @string as fits into @uint8array, without allocating a new buffer
+GJS_JSAPI_RETURN_CONVENTION
+static bool encode_into_func(JSContext* cx, unsigned argc, JS::Value* vp) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+    JS::RootedString str(cx,
+                         linear_string_arg(cx, "encodeInto", args.get(0)));
+    if (!str)
+        return false;
+
+    if (!args.get(1).isObject() || !JS_IsUint8Array(&args[1].toObject())) {
+        gjs_throw_custom(cx, JSProto_TypeError, nullptr,
+                         "encodeInto() requires a Uint8Array destination");
+        return false;
+    }
+    JS::RootedObject dest(cx, &args[1].toObject());
+
+    // The string is already linear, so encoding it can't trigger a GC that
+    // would move the destination's data
+    uint8_t* data;
+    uint32_t len;
+    bool is_shared_memory;
+    js::GetUint8ArrayLengthAndData(dest, &len, &is_shared_memory, &data);
+
+    mozilla::Maybe<mozilla::Tuple<size_t, size_t>> result =
+        JS_EncodeStringToUTF8BufferPartial(
+            cx, str, mozilla::Span<char>(reinterpret_cast<char*>(data), len));
+    if (!result)
+        return false;
+
+    size_t read, written;
+    mozilla::Tie(read, written) = *result;
+
+    JS::RootedObject retval(cx, JS_NewPlainObject(cx));
+    if (!retval ||
+        !JS_DefineProperty(cx, retval, "read", uint32_t(read),
+                           JSPROP_ENUMERATE) ||
+        !JS_DefineProperty(cx, retval, "written", uint32_t(written),
+                           JSPROP_ENUMERATE))
+        return false;
+
+    args.rval().setObject(*retval);
+    return true;
+}
+
+// isEncodingSupported(name): whether iconv can decode the encoding @name
+GJS_JSAPI_RETURN_CONVENTION
+static bool is_encoding_supported_func(JSContext* cx, unsigned argc,
+                                       JS::Value* vp) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+    JS::UniqueChars name;
+    if (!gjs_parse_call_args(cx, "isEncodingSupported", args, "s", "name",
+                             &name))
+        return false;
+
+    GIConv conv = g_iconv_open(HOST_UTF16, name.get());
+    bool supported = conv != reinterpret_cast<GIConv>(-1);
+    if (supported)
+        g_iconv_close(conv);
+
+    args.rval().setBoolean(supported);
+    return true;
+}
+
+// clang-format off
+static constexpr JSFunctionSpec funcs[] = {
+    JS_FN("decode", decode_func, 4, GJS_MODULE_PROP_FLAGS),
+    JS_FN("encode", encode_func, 1, GJS_MODULE_PROP_FLAGS),
+    JS_FN("encodeInto", encode_into_func, 2, GJS_MODULE_PROP_FLAGS),
+    JS_FN("isEncodingSupported", is_encoding_supported_func, 1,
+          GJS_MODULE_PROP_FLAGS),
+    JS_FS_END};
+// clang-format on
+
+bool gjs_define_encoding_stuff(JSContext* cx, JS::MutableHandleObject module) {
+    module.set(JS_NewPlainObject(cx));
+    if (!module)
+        return false;
+    return JS_DefineFunctions(cx, module, funcs);
+}
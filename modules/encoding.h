@@ -0,0 +1,18 @@
+/* -*- mode: C++; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * SPDX-License-Identifier: MIT OR LGPL-2.0-or-later
+ */
+
+#ifndef MODULES_ENCODING_H_
+#define MODULES_ENCODING_H_
+
+#include <config.h>
+
+#include <js/TypeDecls.h>
+
+#include "cjs/macros.h"
+
+GJS_JSAPI_RETURN_CONVENTION
+bool gjs_define_encoding_stuff(JSContext* cx, JS::MutableHandleObject module);
+
+#endif  // MODULES_ENCODING_H_
@@ -0,0 +1,574 @@
+/* -*- mode: C++; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * SPDX-License-Identifier: MIT OR LGPL-2.0-or-later
+ */
+
+#include <config.h>
+
+#include <stddef.h>  // for size_t
+#include <stdint.h>
+#include <string.h>     // for memcmp
+#include <sys/types.h>  // for ssize_t
+
+#include <cmath>   // for fabs, fmod, frexp, isinf, isnan, ldexp, trunc
+#include <memory>  // for shared_ptr, make_shared
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>  // for move
+#include <vector>
+
+#include <glib.h>
+
+#include <js/CallArgs.h>
+#include <js/Conversions.h>
+#include <js/PropertySpec.h>
+#include <js/RootingAPI.h>
+#include <js/Symbol.h>
+#include <js/TypeDecls.h>
+#include <js/Value.h>
+#include <js/ValueArray.h>
+#include <jsapi.h>
+#include <jspubtd.h>  // for JSProto_RangeError
+
+#include "libgjs-private/gjs-util.h"
+#include "cjs/jsapi-util.h"
+#include "cjs/macros.h"
+#include "modules/format.h"
+
+// Longest string that SpiderMonkey can create; String.prototype.repeat()
+// refuses to pad to a wider field than this
+static constexpr size_t MAX_FIELD_WIDTH = (1 << 30) - 2;
+
+// Parsed formats are kept for this many distinct format strings
+static constexpr size_t MAX_CACHED_FORMATS = 256;
+
+namespace {
+
+// One conversion specification, %[pos$][I][width][.precision]conversion
+struct FormatSpec {
+    uint32_t pos = 0;  // 1-based argument number, or 0 for the next argument
+    bool alternative_digits = false;
+    bool zero_fill = false;
+    size_t width = 0;
+    int precision = -1;      // -1 if not given
+    std::string conversion;  // a single character, in UTF-8
+};
+
+// A format string split into its literal text and its conversion specs. There
+// is one more literal than there are specs: literals[i] precedes specs[i].
+struct ParsedFormat {
+    std::string source;
+    std::vector<std::string> literals;
+    std::vector<FormatSpec> specs;
+};
+
+}  // namespace
+
+// Keyed on views of ParsedFormat::source, so that looking a format up doesn't
+// need to copy it. Programs pass a handful of format strings over and over, so
+// the cache is simply emptied when it fills up.
+static thread_local std::unordered_map<std::string_view,
+                                       std::shared_ptr<const ParsedFormat>>
+    s_format_cache;
+
+[[nodiscard]] static const char* skip_digits(const char* p, const char* end) {
+    while (p < end && g_ascii_isdigit(*p))
+        p++;
+    return p;
+}
+
+// Length of the UTF-8 character at @p if "." matches it in a JS regular
+// expression, which is anything but a line terminator, or 0
+[[nodiscard]] static size_t conversion_length(const char* p, const char* end) {
+    if (p == end || *p == '\n' || *p == '\r')
+        return 0;
+    if (end - p >= 3 && (memcmp(p, "\xe2\x80\xa8", 3) == 0 ||
+                         memcmp(p, "\xe2\x80\xa9", 3) == 0))
+        return 0;
+    return g_utf8_next_char(p) - p;
+}
+
+template <typename T>
+[[nodiscard]] static T parse_decimal(const char* start, const char* end,
+                                     T max) {
+    T value = 0;
+    for (const char* p = start; p < end; p++) {
+        unsigned digit = *p - '0';
+        if (value > (max - digit) / 10)
+            return max;
+        value = value * 10 + digit;
+    }
+    return value;
+}
+
+// Parses the conversion spec after a '%' at @start. This matches the same
+// text as the regular expression
+//   %(?:([1-9][0-9]*)\$)?(I+)?([0-9]+)?(?:\.([0-9]+))?(.)
+// that the JS implementation used, including its backtracking, so that the
+// same format strings are rejected. Returns the end of the spec, or nullptr if
+// it isn't one, in which case the '%' is literal text.
+[[nodiscard]] static const char* parse_spec(const char* start, const char* end,
+                                            FormatSpec* spec) {
+    const char* p = start;
+
+    const char* pos_start = nullptr;
+    const char* pos_end = nullptr;
+    if (p < end && *p >= '1' && *p <= '9') {
+        const char* digits_end = skip_digits(p, end);
+        if (digits_end < end && *digits_end == '$') {
+            pos_start = p;
+            pos_end = digits_end;
+            p = digits_end + 1;
+        }
+    }
+
+    const char* flags_start = p;
+    while (p < end && *p == 'I')
+        p++;
+    const char* flags_end = p;
+
+    const char* width_start = p;
+    p = skip_digits(p, end);
+    const char* width_end = p;
+
+    const char* precision_start = nullptr;
+    const char* precision_end = nullptr;
+    if (end - p >= 2 && *p == '.' && g_ascii_isdigit(p[1])) {
+        precision_start = p + 1;
+        precision_end = skip_digits(precision_start, end);
+        p = precision_end;
+    }
+
+    const char* conversion = p;
+    size_t conversion_len = conversion_length(p, end);
+    if (conversion_len == 0) {
+        // The regular expression gives the last character matched so far to
+        // the conversion instead, which is then never a valid one
+        if (precision_start && precision_end - precision_start > 1) {
+            conversion = --precision_end;
+        } else if (precision_start) {
+            conversion = precision_start - 1;  // the '.'
+            precision_start = precision_end = nullptr;
+        } else if (width_end > width_start) {
+            conversion = --width_end;
+        } else if (flags_end > flags_start) {
+            conversion = --flags_end;
+        } else if (pos_start) {
+            // The digits become the width, and the '$' the conversion
+            width_start = pos_start;
+            width_end = pos_end;
+            conversion = pos_end;
+            pos_start = pos_end = nullptr;
+        } else {
+            return nullptr;
+        }
+        conversion_len = 1;
+    }
+
+    if (pos_start)
+        spec->pos = parse_decimal<uint32_t>(pos_start, pos_end, UINT32_MAX);
+    spec->alternative_digits = flags_end > flags_start;
+    spec->zero_fill = width_end > width_start && *width_start == '0';
+    spec->width = parse_decimal<size_t>(width_start, width_end, SIZE_MAX);
+    if (precision_start)
+        spec->precision =
+            parse_decimal<int>(precision_start, precision_end, G_MAXINT);
+    spec->conversion.assign(conversion, conversion_len);
+    return conversion + conversion_len;
+}
+
+[[nodiscard]] static std::shared_ptr<const ParsedFormat> parse_format(
+    const char* fmt, size_t len) {
+    auto parsed = std::make_shared<ParsedFormat>();
+    parsed->source.assign(fmt, len);
+
+    const char* end = fmt + len;
+    const char* literal_start = fmt;
+    const char* p = fmt;
+    while (p < end) {
+        if (*p != '%') {
+            p++;
+            continue;
+        }
+
+        FormatSpec spec;
+        const char* spec_end = parse_spec(p + 1, end, &spec);
+        if (!spec_end) {
+            p++;
+            continue;
+        }
+
+        parsed->literals.emplace_back(literal_start, p - literal_start);
+        parsed->specs.push_back(std::move(spec));
+        p = literal_start = spec_end;
+    }
+    parsed->literals.emplace_back(literal_start, end - literal_start);
+
+    return parsed;
+}
+
+void gjs_format_clear_cache(void) { s_format_cache.clear(); }
+
+[[nodiscard]] static std::shared_ptr<const ParsedFormat> lookup_format(
+    const char* fmt, size_t len) {
+    auto found = s_format_cache.find(std::string_view(fmt, len));
+    if (found != s_format_cache.end())
+        return found->second;
+
+    if (s_format_cache.size() >= MAX_CACHED_FORMATS)
+        s_format_cache.clear();
+
+    std::shared_ptr<const ParsedFormat> parsed = parse_format(fmt, len);
+    s_format_cache.emplace(parsed->source, parsed);
+    return parsed;
+}
+
+// Number of UTF-16 code units in @len bytes of UTF-8, which is the length that
+// JS sees and pads to
+[[nodiscard]] static size_t utf16_length(const char* utf8, size_t len) {
+    size_t n_units = 0;
+    for (size_t ix = 0; ix < len; ix++) {
+        uint8_t byte = utf8[ix];
+        if ((byte & 0xc0) != 0x80)
+            n_units++;
+        if (byte >= 0xf0)
+            n_units++;  // encoded as a surrogate pair
+    }
+    return n_units;
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool append_js_string(JSContext* cx, JSString* str, std::string* out) {
+    GjsStringBuffer<> utf8;
+    if (!utf8.init(cx, str))
+        return false;
+    out->append(utf8.get(), utf8.length());
+    return true;
+}
+
+// Same as String(@value)
+GJS_JSAPI_RETURN_CONVENTION
+static bool append_string(JSContext* cx, JS::HandleValue value,
+                          std::string* out) {
+    if (value.isSymbol()) {
+        // String() describes symbols, where ToString() would throw
+        JS::RootedSymbol symbol(cx, value.toSymbol());
+        JS::RootedString description(cx, JS::GetSymbolDescription(symbol));
+        out->append("Symbol(");
+        if (description && !append_js_string(cx, description, out))
+            return false;
+        out->push_back(')');
+        return true;
+    }
+
+    JS::RootedString str(cx, JS::ToString(cx, value));
+    return str && append_js_string(cx, str, out);
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool call_global_number_function(JSContext* cx, const char* name,
+                                        JS::HandleValue value, double* result) {
+    JS::RootedObject global(cx, JS::CurrentGlobalOrNull(cx));
+    JS::RootedValue rval(cx);
+    return JS_CallFunctionName(cx, global, name, JS::HandleValueArray(value),
+                               &rval) &&
+           JS::ToNumber(cx, rval, result);
+}
+
+// Same as parseInt(@value)
+GJS_JSAPI_RETURN_CONVENTION
+static bool parse_int(JSContext* cx, JS::HandleValue value, double* result) {
+    if (value.isInt32()) {
+        *result = value.toInt32();
+        return true;
+    }
+    if (value.isDouble()) {
+        // Numbers in this range are converted to strings in plain decimal
+        // notation, so parseInt() only truncates them
+        double number = value.toDouble();
+        double magnitude = fabs(number);
+        if (number == 0 || (magnitude >= 1e-6 && magnitude < 1e21)) {
+            *result = trunc(number);
+            return true;
+        }
+    }
+    return call_global_number_function(cx, "parseInt", value, result);
+}
+
+// Same as parseFloat(@value)
+GJS_JSAPI_RETURN_CONVENTION
+static bool parse_float(JSContext* cx, JS::HandleValue value, double* result) {
+    if (value.isNumber()) {
+        // Converting to a string and back gives the same number, except -0
+        double number = value.toNumber();
+        *result = number == 0 ? 0 : number;
+        return true;
+    }
+    return call_global_number_function(cx, "parseFloat", value, result);
+}
+
+// Same as @number.toString(@radix), for a radix of 10 or 16
+GJS_JSAPI_RETURN_CONVENTION
+static bool append_number(JSContext* cx, double number, unsigned radix,
+                          std::string* out) {
+    constexpr double MAX_SAFE_INTEGER = 9007199254740991.0;
+    double magnitude = fabs(number);
+    char buf[32];
+
+    if (std::isnan(number)) {
+        out->append("NaN");
+    } else if (std::isinf(number)) {
+        out->append(number < 0 ? "-Infinity" : "Infinity");
+    } else if (number == trunc(number) && magnitude <= MAX_SAFE_INTEGER) {
+        auto value = static_cast<int64_t>(number);
+        if (radix == 16)
+            g_snprintf(buf, sizeof(buf), "%s%" G_GINT64_MODIFIER "x",
+                       value < 0 ? "-" : "", value < 0 ? -value : value);
+        else
+            g_snprintf(buf, sizeof(buf), "%" G_GINT64_FORMAT, value);
+        out->append(buf);
+    } else if (radix == 16) {
+        // Only integers come here, from parseInt(). Their hexadecimal digits
+        // are exact: the 53-bit significand followed by zero digits.
+        int exponent;
+        double fraction = frexp(magnitude, &exponent);
+        auto significand = static_cast<uint64_t>(ldexp(fraction, 53));
+        exponent -= 53;
+        g_snprintf(buf, sizeof(buf), "%s%" G_GINT64_MODIFIER "x",
+                   number < 0 ? "-" : "", significand << (exponent % 4));
+        out->append(buf);
+        out->append(exponent / 4, '0');
+    } else {
+        JS::RootedValue value(cx, JS::NumberValue(number));
+        JS::RootedString str(cx, JS::ToString(cx, value));
+        return str && append_js_string(cx, str, out);
+    }
+
+    return true;
+}
+
+// Same as @number.toFixed(@precision)
+GJS_JSAPI_RETURN_CONVENTION
+static bool append_fixed(JSContext* cx, double number, int precision,
+                         std::string* out) {
+    if (precision > 100) {
+        gjs_throw_custom(cx, JSProto_RangeError, nullptr,
+                         "precision %d out of range", precision);
+        return false;
+    }
+
+    if (std::isnan(number) || fabs(number) >= 1e21)
+        return append_number(cx, number, 10, out);
+
+    bool negative = number < 0;
+    double magnitude = negative ? -number : number + 0.0;  // no -0
+
+    // toFixed() breaks ties away from zero where printf() breaks them to even.
+    // A tie has an exact decimal expansion ending in a 5 just past the digits
+    // asked for, so print that 5 too and round up by hand.
+    double scaled = ldexp(magnitude, precision + 1);
+    bool tie = scaled == trunc(scaled) && fmod(scaled, 2.0) == 1.0;
+
+    char fmt[16];
+    char buf[128];
+    g_snprintf(fmt, sizeof(fmt), "%%.%df", tie ? precision + 1 : precision);
+    g_ascii_formatd(buf, sizeof(buf), fmt, magnitude);
+    std::string digits(buf);
+
+    if (tie) {
+        digits.pop_back();
+        if (digits.back() == '.')
+            digits.pop_back();
+        ssize_t ix = digits.size() - 1;
+        for (; ix >= 0; ix--) {
+            if (digits[ix] == '.')
+                continue;
+            if (digits[ix] != '9') {
+                digits[ix]++;
+                break;
+            }
+            digits[ix] = '0';
+        }
+        if (ix < 0)
+            digits.insert(0, 1, '1');
+    }
+
+    if (negative)
+        out->push_back('-');
+    out->append(digits);
+    return true;
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool get_format_arg(JSContext* cx, JS::HandleValue args,
+                           JS::MutableHandleObject args_obj, uint32_t index,
+                           JS::MutableHandleValue arg) {
+    if (!args_obj) {
+        args_obj.set(JS::ToObject(cx, args));
+        if (!args_obj)
+            return false;
+    }
+    return JS_GetElement(cx, args_obj, index, arg);
+}
+
+// Formats @args, an array, according to @format into @out. This follows the
+// JS implementation that it replaces step by step, including the order in
+// which errors are checked and arguments converted.
+GJS_JSAPI_RETURN_CONVENTION
+static bool format_args(JSContext* cx, const ParsedFormat& format,
+                        JS::HandleValue args, std::string* out) {
+    JS::RootedObject args_obj(cx);
+    JS::RootedValue arg(cx);
+    uint32_t next_arg = 0;
+    bool use_pos = false;
+
+    for (size_t ix = 0; ix < format.specs.size(); ix++) {
+        out->append(format.literals[ix]);
+
+        const FormatSpec& spec = format.specs[ix];
+        char conversion =
+            spec.conversion.size() == 1 ? spec.conversion[0] : '\0';
+
+        if (spec.precision >= 0 && conversion != 'f') {
+            gjs_throw(cx, "Precision can only be specified for 'f'");
+            return false;
+        }
+        if (spec.alternative_digits && conversion != 'd') {
+            gjs_throw(cx,
+                      "Alternative output digits can only be specfied for 'd'");
+            return false;
+        }
+
+        if (!use_pos && next_arg == 0)
+            use_pos = spec.pos > 0;
+        if (use_pos != (spec.pos > 0)) {
+            gjs_throw(cx,
+                      "Numbered and unnumbered conversion specifications "
+                      "cannot be mixed");
+            return false;
+        }
+
+        if (conversion == '%') {
+            out->push_back('%');
+            continue;
+        }
+        if (conversion != 's' && conversion != 'd' && conversion != 'x' &&
+            conversion != 'f') {
+            gjs_throw(cx, "Unsupported conversion character %%%s",
+                      spec.conversion.c_str());
+            return false;
+        }
+
+        uint32_t arg_index = use_pos ? spec.pos - 1 : next_arg++;
+        if (!get_format_arg(cx, args, &args_obj, arg_index, &arg))
+            return false;
+
+        size_t start = out->size();
+        double number;
+        switch (conversion) {
+            case 's':
+                if (!append_string(cx, arg, out))
+                    return false;
+                break;
+            case 'd':
+                if (!parse_int(cx, arg, &number))
+                    return false;
+                if (spec.alternative_digits) {
+                    GjsAutoChar digits =
+                        gjs_format_int_alternative_output(JS::ToInt32(number));
+                    out->append(digits.get());
+                } else if (!append_number(cx, number, 10, out)) {
+                    return false;
+                }
+                break;
+            case 'x':
+                if (!parse_int(cx, arg, &number) ||
+                    !append_number(cx, number, 16, out))
+                    return false;
+                break;
+            case 'f':
+                if (!parse_float(cx, arg, &number))
+                    return false;
+                if (spec.precision >= 0) {
+                    if (!append_fixed(cx, number, spec.precision, out))
+                        return false;
+                } else if (!append_number(cx, number, 10, out)) {
+                    return false;
+                }
+                break;
+        }
+
+        if (spec.width > MAX_FIELD_WIDTH) {
+            gjs_throw_custom(cx, JSProto_RangeError, nullptr,
+                             "repeat count must be less than infinity and not "
+                             "overflow maximum string size");
+            return false;
+        }
+        size_t length = utf16_length(out->data() + start, out->size() - start);
+        if (length < spec.width)
+            out->insert(start, spec.width - length,
+                        spec.zero_fill ? '0' : ' ');
+    }
+
+    out->append(format.literals.back());
+    return true;
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool format_to_utf8(JSContext* cx, JS::HandleValue fmt_value,
+                           JS::HandleValue args, std::string* out) {
+    JS::RootedString fmt(cx, JS::ToString(cx, fmt_value));
+    if (!fmt)
+        return false;
+
+    GjsStringBuffer<> fmt_utf8;
+    if (!fmt_utf8.init(cx, fmt))
+        return false;
+
+    // Held on to, in case formatting an argument empties the cache
+    std::shared_ptr<const ParsedFormat> format =
+        lookup_format(fmt_utf8.get(), fmt_utf8.length());
+    return format_args(cx, *format, args, out);
+}
+
+// vprintf(format, args): returns @format with its conversion specs replaced by
+// the elements of the array @args
+GJS_JSAPI_RETURN_CONVENTION
+static bool vprintf_func(JSContext* cx, unsigned argc, JS::Value* vp) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+
+    std::string out;
+    if (!format_to_utf8(cx, args.get(0), args.get(1), &out))
+        return false;
+    return gjs_string_from_utf8_n(cx, out.data(), out.size(), args.rval());
+}
+
+// printf(format, args): like print(vprintf(format, args)), but without
+// creating the formatted string in JS
+GJS_JSAPI_RETURN_CONVENTION
+static bool printf_func(JSContext* cx, unsigned argc, JS::Value* vp) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+
+    std::string out;
+    if (!format_to_utf8(cx, args.get(0), args.get(1), &out))
+        return false;
+    g_print("%s\n", out.c_str());
+
+    args.rval().setUndefined();
+    return true;
+}
+
+// clang-format off
+static constexpr JSFunctionSpec funcs[] = {
+    JS_FN("printf", printf_func, 2, GJS_MODULE_PROP_FLAGS),
+    JS_FN("vprintf", vprintf_func, 2, GJS_MODULE_PROP_FLAGS),
+    JS_FS_END};
+// clang-format on
+
+bool gjs_define_format_stuff(JSContext* cx, JS::MutableHandleObject module) {
+    module.set(JS_NewPlainObject(cx));
+    if (!module)
+        return false;
+    return JS_DefineFunctions(cx, module, funcs);
+}
@@ -0,0 +1,21 @@
+/* -*- mode: C++; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * SPDX-License-Identifier: MIT OR LGPL-2.0-or-later
+ */
+
+#ifndef MODULES_FORMAT_H_
+#define MODULES_FORMAT_H_
+
+#include <config.h>
+
+#include <js/TypeDecls.h>
+
+#include "cjs/macros.h"
+
+GJS_JSAPI_RETURN_CONVENTION
+bool gjs_define_format_stuff(JSContext* cx, JS::MutableHandleObject module);
+
+// Forgets the parsed format strings, for example when memory is low
+void gjs_format_clear_cache(void);
+
+#endif  // MODULES_FORMAT_H_
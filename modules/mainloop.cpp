@@ -0,0 +1,322 @@
+/* -*- mode: C++; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * SPDX-License-Identifier: MIT OR LGPL-2.0-or-later
+ */
+
+#include <config.h>
+
+#include <stddef.h>  // for size_t
+#include <stdint.h>
+
+#include <set>
+#include <unordered_map>
+#include <utility>  // for pair
+#include <vector>
+
+#include <glib-object.h>
+#include <glib.h>
+
+#include <js/CallArgs.h>
+#include <js/Class.h>
+#include <js/PropertyDescriptor.h>  // for JSPROP_PERMANENT
+#include <js/PropertySpec.h>
+#include <js/RootingAPI.h>
+#include <js/TypeDecls.h>
+#include <js/Value.h>
+#include <jsapi.h>  // for JS_InitClass, JS_GetInstancePrivate
+#include <jsfriendapi.h>  // for JS_GetObjectFunction
+
+#include "gi/closure.h"
+#include "cjs/jsapi-util-args.h"
+#include "cjs/jsapi-util.h"
+#include "cjs/macros.h"
+#include "modules/mainloop.h"
+
+// Backing store of Mainloop.timeout_add_coalesced(), one per priority.
+//
+// All the timers share one GSource, which wakes up once for every timer that
+// is due, at the latest time allowed by the slack of the earliest one. Every
+// other timer whose timeout has expired by then is dispatched in the same
+// wakeup. Timers are kept ordered both by timeout and by latest dispatch time,
+// so adding, removing, and rescheduling take logarithmic time.
+class TimerWheel {
+    struct Source {
+        GSource base;
+        TimerWheel* wheel;
+    };
+
+    struct Timer {
+        GClosure* closure;
+        int64_t deadline;  // all times in µs, from g_get_monotonic_time()
+        int64_t interval;
+        int64_t slack;
+    };
+
+    using Entry = std::pair<int64_t, uint32_t>;  // time, timer ID
+
+    Source* m_source;
+    std::unordered_map<uint32_t, Timer> m_timers;
+    std::set<Entry> m_by_deadline;
+    std::set<Entry> m_by_latest;
+
+    // IDs are unique among all wheels, so Mainloop.source_remove() doesn't
+    // need to know which wheel a timer is in
+    static uint32_t s_next_id;
+
+    static GSourceFuncs source_funcs;
+
+    void schedule() {
+        if (m_by_latest.empty())
+            g_source_set_ready_time(&m_source->base, -1);
+        else
+            g_source_set_ready_time(&m_source->base,
+                                    m_by_latest.begin()->first);
+    }
+
+    void insert(uint32_t id, const Timer& timer) {
+        m_by_deadline.emplace(timer.deadline, id);
+        m_by_latest.emplace(timer.deadline + timer.slack, id);
+    }
+
+    void unlink(uint32_t id, const Timer& timer) {
+        m_by_deadline.erase({timer.deadline, id});
+        m_by_latest.erase({timer.deadline + timer.slack, id});
+    }
+
+    void dispatch() {
+        int64_t now = g_source_get_time(&m_source->base);
+
+        // Take the due timers out first, since their callbacks may add and
+        // remove timers
+        std::vector<uint32_t> due;
+        while (!m_by_deadline.empty() && m_by_deadline.begin()->first <= now) {
+            uint32_t id = m_by_deadline.begin()->second;
+            due.push_back(id);
+            unlink(id, m_timers[id]);
+        }
+
+        for (uint32_t id : due) {
+            auto it = m_timers.find(id);
+            if (it == m_timers.end())
+                continue;  // removed by an earlier callback
+
+            GClosure* closure = g_closure_ref(it->second.closure);
+            bool again = gjs_closure_source_func(closure);
+            g_closure_unref(closure);
+
+            // Index again, the callback may have added timers or removed
+            // this one
+            it = m_timers.find(id);
+            if (it == m_timers.end())
+                continue;
+
+            if (again) {
+                it->second.deadline = now + it->second.interval;
+                insert(id, it->second);
+            } else {
+                g_closure_unref(it->second.closure);
+                m_timers.erase(it);
+            }
+        }
+
+        schedule();
+    }
+
+    static gboolean source_dispatch(GSource* source, GSourceFunc, void*) {
+        reinterpret_cast<Source*>(source)->wheel->dispatch();
+        return G_SOURCE_CONTINUE;
+    }
+
+ public:
+    explicit TimerWheel(int priority)
+        : m_source(reinterpret_cast<Source*>(
+              g_source_new(&source_funcs, sizeof(Source)))) {
+        m_source->wheel = this;
+        g_source_set_priority(&m_source->base, priority);
+        g_source_set_name(&m_source->base, "[cjs] coalesced timers");
+        g_source_attach(&m_source->base, nullptr);
+    }
+
+    ~TimerWheel() {
+        g_source_destroy(&m_source->base);
+        g_source_unref(&m_source->base);
+        for (auto& entry : m_timers)
+            g_closure_unref(entry.second.closure);
+    }
+
+    [[nodiscard]] uint32_t add(GClosure* closure, unsigned timeout_ms,
+                               unsigned slack_ms) {
+        uint32_t id = s_next_id++;
+        if (G_UNLIKELY(s_next_id == 0))
+            s_next_id = 1;
+
+        Timer timer{closure,
+                    g_get_monotonic_time() + timeout_ms * int64_t(1000),
+                    timeout_ms * int64_t(1000), slack_ms * int64_t(1000)};
+        m_timers.emplace(id, timer);
+        insert(id, timer);
+        schedule();
+        return id;
+    }
+
+    [[nodiscard]] bool remove(uint32_t id) {
+        auto it = m_timers.find(id);
+        if (it == m_timers.end())
+            return false;
+
+        // Not in the ordered sets while it is being dispatched; unlinking
+        // then does nothing
+        unlink(id, it->second);
+        g_closure_unref(it->second.closure);
+        m_timers.erase(it);
+        schedule();
+        return true;
+    }
+
+    [[nodiscard]] size_t length() const { return m_timers.size(); }
+
+    // JS API
+
+    static const JSClass klass;
+
+    [[nodiscard]] static TimerWheel* for_js(JSContext* cx,
+                                            const JS::CallArgs& args) {
+        JS::RootedObject obj(cx);
+        if (!args.computeThis(cx, &obj))
+            return nullptr;
+
+        JS::CallArgs args_copy = args;
+        auto* priv = static_cast<TimerWheel*>(
+            JS_GetInstancePrivate(cx, obj, &klass, &args_copy));
+        if (!priv && !JS_IsExceptionPending(cx))
+            gjs_throw(cx, "TimerWheel.prototype is not a TimerWheel");
+        return priv;
+    }
+
+    // new TimerWheel(priority)
+    GJS_JSAPI_RETURN_CONVENTION
+    static bool constructor(JSContext* cx, unsigned argc, JS::Value* vp) {
+        JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+        if (!args.isConstructing()) {
+            gjs_throw_constructor_error(cx);
+            return false;
+        }
+
+        int32_t priority;
+        if (!gjs_parse_call_args(cx, "TimerWheel", args, "i", "priority",
+                                 &priority))
+            return false;
+
+        JS::RootedObject obj(cx, JS_NewObjectForConstructor(cx, &klass, args));
+        if (!obj)
+            return false;
+
+        JS_SetPrivate(obj, new TimerWheel(priority));
+        args.rval().setObject(*obj);
+        return true;
+    }
+
+    static void finalize(JSFreeOp*, JSObject* obj) {
+        delete static_cast<TimerWheel*>(JS_GetPrivate(obj));
+    }
+
+    // add(timeout, slack, callback): calls @callback after @timeout
+    // milliseconds, or up to @slack milliseconds later so that it can share a
+    // wakeup with other timers, and again after @timeout each time it returns
+    // a truthy value. Returns the timer ID.
+    GJS_JSAPI_RETURN_CONVENTION
+    static bool add_func(JSContext* cx, unsigned argc, JS::Value* vp) {
+        JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+        TimerWheel* priv = for_js(cx, args);
+        if (!priv)
+            return false;
+
+        uint32_t timeout, slack;
+        JS::RootedObject callback(cx);
+        if (!gjs_parse_call_args(cx, "add", args, "uuo", "timeout", &timeout,
+                                 "slack", &slack, "callback", &callback))
+            return false;
+
+        if (!JS_ObjectIsFunction(callback)) {
+            gjs_throw(cx, "Expected function for timer callback");
+            return false;
+        }
+
+        GClosure* closure = gjs_closure_new(
+            cx, JS_GetObjectFunction(callback), "coalesced timer", true);
+        args.rval().setNumber(priv->add(closure, timeout, slack));
+        return true;
+    }
+
+    // remove(id): returns false if there is no timer @id in this wheel
+    GJS_JSAPI_RETURN_CONVENTION
+    static bool remove_func(JSContext* cx, unsigned argc, JS::Value* vp) {
+        JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+        TimerWheel* priv = for_js(cx, args);
+        if (!priv)
+            return false;
+
+        uint32_t id;
+        if (!gjs_parse_call_args(cx, "remove", args, "u", "id", &id))
+            return false;
+
+        args.rval().setBoolean(priv->remove(id));
+        return true;
+    }
+
+    GJS_JSAPI_RETURN_CONVENTION
+    static bool get_length(JSContext* cx, unsigned argc, JS::Value* vp) {
+        JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+        TimerWheel* priv = for_js(cx, args);
+        if (!priv)
+            return false;
+
+        args.rval().setNumber(static_cast<double>(priv->length()));
+        return true;
+    }
+};
+
+uint32_t TimerWheel::s_next_id = 1;
+
+GSourceFuncs TimerWheel::source_funcs = {
+    nullptr,  // prepare; the ready time is always set
+    nullptr,  // check
+    &TimerWheel::source_dispatch,
+    nullptr,  // finalize; the wheel owns the source
+};
+
+static const JSClassOps timer_wheel_class_ops = {
+    nullptr,  // addProperty
+    nullptr,  // deleteProperty
+    nullptr,  // enumerate
+    nullptr,  // newEnumerate
+    nullptr,  // resolve
+    nullptr,  // mayResolve
+    &TimerWheel::finalize,
+};
+
+const JSClass TimerWheel::klass = {
+    "TimerWheel",
+    JSCLASS_HAS_PRIVATE | JSCLASS_FOREGROUND_FINALIZE,
+    &timer_wheel_class_ops,
+};
+
+static const JSPropertySpec timer_wheel_proto_props[] = {
+    JS_PSG("length", &TimerWheel::get_length, JSPROP_PERMANENT), JS_PS_END};
+
+// clang-format off
+static const JSFunctionSpec timer_wheel_proto_funcs[] = {
+    JS_FN("add", &TimerWheel::add_func, 3, 0),
+    JS_FN("remove", &TimerWheel::remove_func, 1, 0),
+    JS_FS_END};
+// clang-format on
+
+bool gjs_define_mainloop_stuff(JSContext* cx, JS::MutableHandleObject module) {
+    module.set(JS_NewPlainObject(cx));
+    if (!module)
+        return false;
+
+    return !!JS_InitClass(cx, module, nullptr, &TimerWheel::klass,
+                          &TimerWheel::constructor, 1, timer_wheel_proto_props,
+                          timer_wheel_proto_funcs, nullptr, nullptr);
+}
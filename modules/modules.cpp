@@ -25,9 +25,15 @@
 
 #include "cjs/native.h"
 #include "modules/console.h"
+#include "modules/encoding.h"
+#include "modules/format.h"
+#include "modules/mainloop.h"
 #include "modules/modules.h"
 #include "modules/print.h"
+#include "modules/signals.h"
 #include "modules/system.h"
+#include "modules/tweener.h"
+#include "modules/worker.h"
 
 #ifdef ENABLE_CAIRO
 #    include "modules/cairo-module.h"
@@ -42,4 +48,10 @@ gjs_register_static_modules (void)
     gjs_register_native_module("system", gjs_js_define_system_stuff);
     gjs_register_native_module("console", gjs_define_console_stuff);
     gjs_register_native_module("_print", gjs_define_print_stuff);
+    gjs_register_native_module("_encodingNative", gjs_define_encoding_stuff);
+    gjs_register_native_module("_formatNative", gjs_define_format_stuff);
+    gjs_register_native_module("_mainloopNative", gjs_define_mainloop_stuff);
+    gjs_register_native_module("_signalsNative", gjs_define_signals_stuff);
+    gjs_register_native_module("_tweenerNative", gjs_define_tweener_stuff);
+    gjs_register_native_module("worker", gjs_define_worker_stuff);
 }
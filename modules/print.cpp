@@ -8,6 +8,9 @@
 
 #include <config.h>
 
+#include <stdint.h>
+#include <string.h>  // for strcspn, strlen, strncmp, strspn
+
 #include <glib.h>
 
 #include <js/CallArgs.h>
@@ -30,6 +33,34 @@ template <>
 struct GCPolicy<void*> : public IgnoreGCPolicy<void*> {};
 }
 
+// Whether GLib's default log writer would discard a message at @level from
+// @domain. Only debug and info messages are filtered, by G_MESSAGES_DEBUG.
+[[nodiscard]] static bool log_would_drop(GLogLevelFlags level,
+                                         const char* domain) {
+#if GLIB_CHECK_VERSION(2, 68, 0)
+    return g_log_writer_default_would_drop(level, domain);
+#else
+    if (!(level & (G_LOG_LEVEL_DEBUG | G_LOG_LEVEL_INFO)))
+        return false;
+
+    const char* debug_domains = g_getenv("G_MESSAGES_DEBUG");
+    if (!debug_domains)
+        return true;
+
+    // G_MESSAGES_DEBUG is a space-separated list of domains, or "all"
+    const char* p = debug_domains;
+    while (*p) {
+        p += strspn(p, " ");
+        size_t len = strcspn(p, " ");
+        if ((len == 3 && strncmp(p, "all", 3) == 0) ||
+            (domain && strlen(domain) == len && strncmp(p, domain, len) == 0))
+            return false;
+        p += len;
+    }
+    return true;
+#endif
+}
+
 GJS_JSAPI_RETURN_CONVENTION
 static bool gjs_log(JSContext* cx, unsigned argc, JS::Value* vp) {
     JS::CallArgs argv = JS::CallArgsFromVp(argc, vp);
@@ -148,6 +179,29 @@ static bool gjs_printerr(JSContext* context, unsigned argc, JS::Value* vp) {
     return true;
 }
 
+// log.enabled(level, domain): whether a message logged at @level, one of the
+// GLib.LogLevelFlags, from @domain (by default the one for log()) would be
+// written out, so that expensive debug messages need not be built at all
+GJS_JSAPI_RETURN_CONVENTION
+static bool gjs_log_enabled(JSContext* cx, unsigned argc, JS::Value* vp) {
+    JS::CallArgs argv = JS::CallArgsFromVp(argc, vp);
+
+    int32_t level;
+    if (!JS::ToInt32(cx, argv.get(0), &level))
+        return false;
+
+    JS::UniqueChars domain;
+    if (!argv.get(1).isUndefined() && !argv.get(1).isNull()) {
+        domain = gjs_string_to_utf8(cx, argv[1]);
+        if (!domain)
+            return false;
+    }
+
+    argv.rval().setBoolean(!log_would_drop(
+        GLogLevelFlags(level), domain ? domain.get() : G_LOG_DOMAIN));
+    return true;
+}
+
 // clang-format off
 static constexpr JSFunctionSpec funcs[] = {
     JS_FN("log", gjs_log, 1, GJS_MODULE_PROP_FLAGS),
@@ -162,5 +216,13 @@ bool gjs_define_print_stuff(JSContext* context,
     module.set(JS_NewPlainObject(context));
     if (!module)
         return false;
-    return JS_DefineFunctions(context, module, funcs);
+    if (!JS_DefineFunctions(context, module, funcs))
+        return false;
+
+    JS::RootedValue log(context);
+    if (!JS_GetProperty(context, module, "log", &log))
+        return false;
+    JS::RootedObject log_obj(context, &log.toObject());
+    return JS_DefineFunction(context, log_obj, "enabled", gjs_log_enabled, 2,
+                             GJS_MODULE_PROP_FLAGS);
 }
@@ -1,4 +1,4 @@
-/* global debuggee, quit, loadNative, readline, uneval */
+/* global debuggee, breakpointLocations, quit, loadNative, readline, uneval */
 /* -*- indent-tabs-mode: nil; js-indent-level: 4 -*-
  *
  * This Source Code Form is subject to the terms of the Mozilla Public
@@ -14,6 +14,11 @@
  * To run it: gjs -d path/to/file.js
  * Execution will stop at debugger statements, and you'll get a prompt before
  * the first frame is executed.
+ *
+ * Or: gjs --break file.js:LINE path/to/file.js
+ * Execution will only stop at the given breakpoints and at debugger
+ * statements. The debugger doesn't observe the rest of the program, which
+ * keeps running at full JIT speed.
  */
 
 const {print, logError} = loadNative('_print');
@@ -812,29 +817,110 @@ function onInitialEnterFrame(frame) {
     return repl();
 }
 
+// Breakpoints given at startup, as {file, line}, which are set in each script
+// for that file as it is loaded
+var pendingBreakpoints = [];
+// Offsets where a pending breakpoint was already set, for each script, since
+// the same scripts are found again when their file is loaded again
+var pendingBreakpointOffsets = new WeakMap();
+
+function urlMatchesFile(url, file) {
+    return url === file || url.endsWith(`/${file}`);
+}
+
+// findScripts() also finds the functions that haven't been compiled yet, so
+// this sets breakpoints in the whole file, not only its top-level script
+function setPendingBreakpoints(url) {
+    pendingBreakpoints.forEach(({file, line}) => {
+        if (!urlMatchesFile(url, file))
+            return;
+
+        const scripts = dbg.findScripts({url, line});
+        scripts.forEach(script => {
+            let done = pendingBreakpointOffsets.get(script);
+            if (!done) {
+                done = new Set();
+                pendingBreakpointOffsets.set(script, done);
+            }
+            script.getLineOffsets(line).forEach(offset => {
+                if (done.has(offset))
+                    return;
+                done.add(offset);
+                const bp = new BreakpointHandler(breakpoints.length, script, offset);
+                script.setBreakpoint(offset, bp);
+                breakpoints.push(bp);
+                print(bp);
+            });
+        });
+    });
+}
+
+function setupBreakpointsOnly(locations) {
+    locations.forEach(location => {
+        const match = /^(.+):(\d+)$/.exec(location);
+        if (!match) {
+            print(`Ignoring breakpoint ${location}, expected FILE:LINE`);
+            return;
+        }
+        pendingBreakpoints.push({file: match[1], line: Number(match[2])});
+    });
+
+    const seen = new Set();
+    dbg.findScripts().forEach(({url}) => {
+        if (url && !seen.has(url)) {
+            seen.add(url);
+            setPendingBreakpoints(url);
+        }
+    });
+
+    // Unlike onEnterFrame, this doesn't make the debuggee's code run slower
+    dbg.onNewScript = function ({url}) {
+        if (url)
+            setPendingBreakpoints(url);
+    };
+
+    print(`GJS debugger, stopping at ${pendingBreakpoints.length} ` +
+        'breakpoint location(s) and at debugger statements.');
+}
+
+function setupFullDebugger() {
+    dbg.onNewPromise = function ({promiseID, promiseAllocationSite}) {
+        const site = promiseAllocationSite.toString().split('\n')[0];
+        print(`Promise ${promiseID} started from ${site}`);
+        return undefined;
+    };
+    dbg.onPromiseSettled = function (promise) {
+        let message = `Promise ${promise.promiseID} ${promise.promiseState} `;
+        message += `after ${promise.promiseTimeToResolution.toFixed(3)} ms`;
+        let brief, full;
+        if (promise.promiseState === 'fulfilled' && typeof promise.promiseValue !== 'undefined') {
+            [brief, full] = debuggeeValueToString(promise.promiseValue);
+            message += ` with ${brief}`;
+        } else if (promise.promiseState === 'rejected' &&
+                   typeof promise.promiseReason !== 'undefined') {
+            [brief, full] = debuggeeValueToString(promise.promiseReason);
+            message += ` with ${brief}`;
+        }
+        print(message);
+        if (full !== undefined)
+            print(full);
+        return undefined;
+    };
+    dbg.onExceptionUnwind = function (frame, value) {
+        return saveExcursion(() => {
+            topFrame = focusedFrame = frame;
+            print("Unwinding due to exception. (Type 'c' to continue unwinding.)");
+            showFrame();
+            print('Exception value is:');
+            showDebuggeeValue(value);
+            return repl();
+        });
+    };
+
+    setUntilRepl(dbg, 'onEnterFrame', onInitialEnterFrame);
+}
+
 var dbg = new Debugger();
-dbg.onNewPromise = function ({promiseID, promiseAllocationSite}) {
-    const site = promiseAllocationSite.toString().split('\n')[0];
-    print(`Promise ${promiseID} started from ${site}`);
-    return undefined;
-};
-dbg.onPromiseSettled = function (promise) {
-    let message = `Promise ${promise.promiseID} ${promise.promiseState} `;
-    message += `after ${promise.promiseTimeToResolution.toFixed(3)} ms`;
-    let brief, full;
-    if (promise.promiseState === 'fulfilled' && typeof promise.promiseValue !== 'undefined') {
-        [brief, full] = debuggeeValueToString(promise.promiseValue);
-        message += ` with ${brief}`;
-    } else if (promise.promiseState === 'rejected' &&
-               typeof promise.promiseReason !== 'undefined') {
-        [brief, full] = debuggeeValueToString(promise.promiseReason);
-        message += ` with ${brief}`;
-    }
-    print(message);
-    if (full !== undefined)
-        print(full);
-    return undefined;
-};
 dbg.onDebuggerStatement = function (frame) {
     return saveExcursion(() => {
         topFrame = focusedFrame = frame;
@@ -842,17 +928,13 @@ dbg.onDebuggerStatement = function (frame) {
         return repl();
     });
 };
-dbg.onExceptionUnwind = function (frame, value) {
-    return saveExcursion(() => {
-        topFrame = focusedFrame = frame;
-        print("Unwinding due to exception. (Type 'c' to continue unwinding.)");
-        showFrame();
-        print('Exception value is:');
-        showDebuggeeValue(value);
-        return repl();
-    });
-};
 
 var debuggeeGlobalWrapper = dbg.addDebuggee(debuggee);
 
-setUntilRepl(dbg, 'onEnterFrame', onInitialEnterFrame);
+// Promise and exception hooks would make every promise record where it was
+// allocated, and stop at every exception, so they are only set when observing
+// the whole program
+if (typeof breakpointLocations !== 'undefined')
+    setupBreakpointsOnly(breakpointLocations);
+else
+    setupFullDebugger();
@@ -29,4 +29,34 @@
             value: logError,
         },
     });
+
+    // The encoding module is only imported when one of these is first used,
+    // after which they become ordinary global properties
+    function defineLazyGlobal(name, getValue) {
+        Object.defineProperty(exports, name, {
+            configurable: true,
+            enumerable: false,
+            get() {
+                const value = getValue();
+                Object.defineProperty(exports, name, {
+                    configurable: true,
+                    enumerable: false,
+                    writable: true,
+                    value,
+                });
+                return value;
+            },
+            set(value) {
+                Object.defineProperty(exports, name, {
+                    configurable: true,
+                    enumerable: false,
+                    writable: true,
+                    value,
+                });
+            },
+        });
+    }
+
+    defineLazyGlobal('TextDecoder', () => imports._encoding.TextDecoder);
+    defineLazyGlobal('TextEncoder', () => imports._encoding.TextEncoder);
 })(globalThis);
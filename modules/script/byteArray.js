@@ -1,7 +1,9 @@
-/* exported ByteArray, fromArray, fromGBytes, fromString, toGBytes, toString */
+/* exported ByteArray, allocatePinned, fromArray, fromGBytes, fromString,
+toGBytes, toString */
 
 /* eslint no-redeclare: ["error", { "builtinGlobals": false }] */  // for toString
-var {fromGBytes, fromString, toGBytes, toString} = imports._byteArrayNative;
+var {allocatePinned, fromGBytes, fromString, toGBytes, toString} =
+    imports._byteArrayNative;
 
 // For backwards compatibility
 
@@ -21,3 +21,62 @@
 // Merge stuff defined in the shared imports._cairo and then in native code
 Object.assign(this, imports._cairo, imports.cairoNative);
 
+// Solid patterns for the most recently requested colors, in nested Maps from
+// red, green, blue and alpha, so that looking up a color builds no key
+const _solidPatterns = new Map();
+// The same patterns with their colors, oldest first
+const _solidPatternColors = new Map();
+const _MAX_CACHED_SOLID_PATTERNS = 64;
+
+function _getOrCreateMap(map, key) {
+    let inner = map.get(key);
+    if (!inner) {
+        inner = new Map();
+        map.set(key, inner);
+    }
+    return inner;
+}
+
+function _evictOldestSolidPattern() {
+    const [pattern, [red, green, blue, alpha]] =
+        _solidPatternColors.entries().next().value;
+    _solidPatternColors.delete(pattern);
+
+    const greens = _solidPatterns.get(red);
+    const blues = greens.get(green);
+    const alphas = blues.get(blue);
+    alphas.delete(alpha);
+    if (alphas.size === 0)
+        blues.delete(blue);
+    if (blues.size === 0)
+        greens.delete(green);
+    if (greens.size === 0)
+        _solidPatterns.delete(red);
+}
+
+// Returns a solid pattern for the color, shared with every other caller asking
+// for the same color, so that painting with the same colors on every frame
+// doesn't create new patterns. The pattern must not be modified.
+const {SolidPattern: _SolidPattern} = this;
+_SolidPattern.getCachedRGBA = function (red, green, blue, alpha = 1) {
+    const greens = _solidPatterns.get(red);
+    const blues = greens && greens.get(green);
+    const alphas = blues && blues.get(blue);
+    let pattern = alphas && alphas.get(alpha);
+    if (pattern) {
+        const color = _solidPatternColors.get(pattern);
+        _solidPatternColors.delete(pattern);
+        _solidPatternColors.set(pattern, color);
+        return pattern;
+    }
+
+    if (_solidPatternColors.size >= _MAX_CACHED_SOLID_PATTERNS)
+        _evictOldestSolidPattern();
+    pattern = _SolidPattern.createRGBA(red, green, blue, alpha);
+    _getOrCreateMap(
+        _getOrCreateMap(_getOrCreateMap(_solidPatterns, red), green),
+        blue).set(alpha, pattern);
+    _solidPatternColors.set(pattern, [red, green, blue, alpha]);
+    return pattern;
+};
+
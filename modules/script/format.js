@@ -3,9 +3,10 @@
 /* exported format, printf, vprintf */
 
 var {vprintf} = imports._format;
+const {printf: _printf} = imports._format;
 
 function printf(fmt, ...args) {
-    print(vprintf(fmt, args));
+    _printf(fmt, args);
 }
 
 /*
@@ -20,14 +20,17 @@
 // IN THE SOFTWARE.
 
 /* exported idle_add, idle_source, quit, run, source_remove, timeout_add,
-timeout_add_seconds, timeout_seconds_source, timeout_source */
+timeout_add_coalesced, timeout_add_seconds, timeout_seconds_source,
+timeout_source */
 
 // A layer of convenience and backwards-compatibility over GLib MainLoop facilities
 
 const GLib = imports.gi.GLib;
 const GObject = imports.gi.GObject;
+const Native = imports._mainloopNative;
 
 var _mainLoops = {};
+var _timerWheels = new Map();
 
 function run(name) {
     if (!_mainLoops[name])
@@ -91,7 +94,31 @@ function timeout_add_seconds(timeout, handler, priority) {
     return timeout_seconds_source(timeout, handler, priority).attach(null);
 }
 
+// Like timeout_add(), but all such timers of the same priority share one
+// GSource, and may run up to @slack milliseconds late (by default a tenth of
+// @timeout) so that timers due around the same time run in the same wakeup.
+// The returned ID is only valid for source_remove() in this module, not for
+// GLib.source_remove().
+// eslint-disable-next-line camelcase
+function timeout_add_coalesced(timeout, handler, slack, priority) {
+    if (slack === undefined)
+        slack = Math.floor(timeout / 10);
+    if (priority === undefined)
+        priority = GLib.PRIORITY_DEFAULT;
+
+    let wheel = _timerWheels.get(priority);
+    if (!wheel) {
+        wheel = new Native.TimerWheel(priority);
+        _timerWheels.set(priority, wheel);
+    }
+
+    // Negative, so it can't be mistaken for a GSource ID
+    return -wheel.add(timeout, slack, handler);
+}
+
 // eslint-disable-next-line camelcase
 function source_remove(id) {
+    if (id < 0)
+        return [..._timerWheels.values()].some(wheel => wheel.remove(-id));
     return GLib.source_remove(id);
 }
@@ -42,6 +42,8 @@ setFrameTicker, setTimeScale */
 
 const GLib = imports.gi.GLib;
 
+const Equations = imports.tweener.equations;
+const Native = imports._tweenerNative;
 const TweenList = imports.tweener.tweenList;
 const Signals = imports.signals;
 
@@ -69,6 +71,13 @@ var _ticker = null;
 
 var _prepareFrameId = 0;
 
+/* built-in equations that can be interpolated natively, by curve number */
+var _nativeCurves = new Map();
+Native.curves.forEach((name, curve) => {
+    if (Equations[name])
+        _nativeCurves.set(Equations[name], curve);
+});
+
 /* default frame ticker */
 function FrameTicker() {
     this._init();
@@ -83,14 +92,13 @@ FrameTicker.prototype = {
     start() {
         this._currentTime = 0;
 
-        let me = this;
-
-        this._timeoutID = GLib.timeout_add(
-            GLib.PRIORITY_DEFAULT,
-            Math.floor(1000 / me.FRAME_RATE),
-            function () {
-                me._currentTime += 1000 / me.FRAME_RATE;
-                me.emit('prepare-frame');
+        // Frames are paced off the monotonic clock, so a slow frame doesn't
+        // push back all the ones after it; the elapsed time passed in already
+        // accounts for any frames that had to be dropped
+        this._timeoutID = Native.addFrameSource(GLib.PRIORITY_DEFAULT,
+            this.FRAME_RATE, elapsed => {
+                this._currentTime = elapsed;
+                this.emit('prepare-frame');
                 return true;
             });
     },
@@ -212,6 +220,56 @@ function _callOnFunction(fn, fnname, scope, fallbackScope, params) {
     }
 }
 
+/*
+ * Interpolates, in one native call, all of the tween's properties that are
+ * neither special nor modified, if it uses one of the built-in equations.
+ * Returns the names of those properties, in iteration order; the values are
+ * left in tweening.nativeValues.
+ */
+function _getNativeInterpolation(tweening, isOver) {
+    var curve = _nativeCurves.get(tweening.transition);
+    if (isOver || curve === undefined)
+        return [];
+
+    var names = [];
+    for (let name in tweening.properties) {
+        let property = tweening.properties[name];
+        if (!property.isSpecialProperty && !property.hasModifier)
+            names.push(name);
+    }
+    if (names.length == 0)
+        return names;
+
+    if (!tweening.nativeValues || tweening.nativeValues.length != names.length) {
+        tweening.nativeStarts = new Float64Array(names.length);
+        tweening.nativeCompletes = new Float64Array(names.length);
+        tweening.nativeValues = new Float64Array(names.length);
+    }
+    names.forEach((name, ix) => {
+        tweening.nativeStarts[ix] = tweening.properties[name].valueStart;
+        tweening.nativeCompletes[ix] = tweening.properties[name].valueComplete;
+    });
+
+    Native.interpolate(curve, _getCurrentTweeningTime() - tweening.timeStart,
+        tweening.timeComplete - tweening.timeStart, tweening.transitionParams,
+        tweening.nativeStarts, tweening.nativeCompletes, tweening.nativeValues);
+    return names;
+}
+
+function _setPropertiesBatch(tweening, scope, batch) {
+    try {
+        scope.set_properties(batch);
+        return;
+    } catch (e) {
+        // Not all GObject properties, e.g. JS fields on a subclass; nothing
+        // has been set, so go back to setting them one by one
+        tweening.canBatch = false;
+    }
+
+    for (let name in batch)
+        scope[name] = batch[name];
+}
+
 function _updateTweenByIndex(i) {
     var tweening = _tweenList[i];
 
@@ -287,12 +345,25 @@ function _updateTweenByIndex(i) {
         }
 
         if (mustUpdate) {
+            var plainNames = _getNativeInterpolation(tweening, isOver);
+            var plainValues = tweening.nativeValues;
+            var nextPlain = 0;
+
+            // GObjects get all their plain properties set at once, so that
+            // they are notified and relaid out once per frame
+            var batch = null;
+            if (tweening.canBatch !== false && scope.set_properties)
+                batch = {};
+
             for (name in tweening.properties) {
                 var property = tweening.properties[name];
 
                 if (isOver) {
                     // Tweening time has finished, just set it to the final value
                     nv = property.valueComplete;
+                } else if (plainNames[nextPlain] === name) {
+                    // Interpolated natively, above
+                    nv = plainValues[nextPlain++];
                 } else if (property.hasModifier) {
                     // Modified
                     t = currentTime - tweening.timeStart;
@@ -319,12 +390,17 @@ function _updateTweenByIndex(i) {
                 if (property.isSpecialProperty) {
                     // It's a special property, tunnel via the special property method
                     _specialPropertyList[name].setValue(scope, nv, _specialPropertyList[name].parameters, tweening.properties[name].extra);
+                } else if (batch) {
+                    batch[name] = nv;
                 } else {
                     // Directly set property
                     scope[name] = nv;
                 }
             }
 
+            if (batch)
+                _setPropertiesBatch(tweening, scope, batch);
+
             tweening.updatesSkipped = 0;
 
             _callOnFunction(tweening.onUpdate, 'onUpdate', tweening.onUpdateScope,
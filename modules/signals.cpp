@@ -0,0 +1,375 @@
+/* -*- mode: C++; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * SPDX-License-Identifier: MIT OR LGPL-2.0-or-later
+ */
+
+#include <config.h>
+
+#include <stddef.h>  // for size_t
+#include <stdint.h>
+
+#include <algorithm>  // for remove_if
+#include <unordered_map>
+#include <vector>
+
+#include <glib.h>
+
+#include <js/CallArgs.h>
+#include <js/Class.h>
+#include <js/Conversions.h>
+#include <js/Id.h>
+#include <js/PropertyDescriptor.h>  // for JSPROP_PERMANENT
+#include <js/PropertySpec.h>
+#include <js/RootingAPI.h>
+#include <js/TracingAPI.h>
+#include <js/TypeDecls.h>
+#include <js/Value.h>
+#include <jsapi.h>  // for JS_InitClass, JS::Call, JS_GetInstancePrivate
+
+#include "cjs/jsapi-util.h"
+#include "cjs/macros.h"
+#include "modules/signals.h"
+
+// Backing store of the Signals mixin in modules/core/_signals.js, one per
+// object that has had a handler connected.
+//
+// Handlers are kept in connection order in one vector, and are looked up by ID
+// in a hash table. Disconnecting only clears the handler's slot, so it takes
+// constant time, and an emission in progress can keep walking the vector by
+// index without copying it first. Cleared slots are compacted away once no
+// emission is running and they make up half of the vector.
+class SignalHandlers {
+    struct Handler {
+        uint32_t id;  // 0 once disconnected
+        JS::Heap<jsid> name;
+        JS::Heap<JSObject*> callback;
+
+        Handler(uint32_t handler_id, jsid signal_name, JSObject* func)
+            : id(handler_id), name(signal_name), callback(func) {}
+    };
+
+    std::vector<Handler> m_handlers;
+    std::unordered_map<uint32_t, size_t> m_slots;
+    uint32_t m_next_id = 1;
+    unsigned m_emission_depth = 0;
+
+    static void clear(Handler* handler) {
+        handler->id = 0;
+        handler->name = JSID_VOID;
+        handler->callback = nullptr;
+    }
+
+    void maybe_compact() {
+        if (m_emission_depth > 0)
+            return;
+
+        size_t n_cleared = m_handlers.size() - m_slots.size();
+        if (n_cleared == 0 || n_cleared < m_slots.size())
+            return;
+
+        m_handlers.erase(
+            std::remove_if(m_handlers.begin(), m_handlers.end(),
+                           [](const Handler& handler) { return !handler.id; }),
+            m_handlers.end());
+        for (size_t ix = 0; ix < m_handlers.size(); ix++)
+            m_slots[m_handlers[ix].id] = ix;
+    }
+
+    [[nodiscard]] static bool id_from_value(JS::HandleValue value,
+                                            uint32_t* id) {
+        if (!value.isNumber())
+            return false;
+        double number = value.toNumber();
+        if (number < 1 || number > UINT32_MAX ||
+            number != static_cast<uint32_t>(number))
+            return false;
+        *id = static_cast<uint32_t>(number);
+        return true;
+    }
+
+    // Logs the exception thrown by a handler, the same way as logError().
+    // Returns false if the exception was uncatchable.
+    [[nodiscard]] static bool log_handler_exception(JSContext* cx,
+                                                    JS::HandleValue name) {
+        JS::RootedValue exc(cx);
+        if (!JS_GetPendingException(cx, &exc))
+            return false;
+        JS_ClearPendingException(cx);
+
+        JS::RootedString message(
+            cx, JS_NewStringCopyZ(cx, "Exception in callback for signal: "));
+        if (message) {
+            JS::RootedString name_str(cx, JS::ToString(cx, name));
+            message = name_str ? JS_ConcatStrings(cx, message, name_str)
+                               : nullptr;
+        }
+        // Converting the name can fail, e.g. for a symbol; log without it
+        JS_ClearPendingException(cx);
+
+        gjs_log_exception_full(cx, exc, message, G_LOG_LEVEL_WARNING);
+        return true;
+    }
+
+ public:
+    [[nodiscard]] uint32_t connect(jsid name, JSObject* callback) {
+        uint32_t id = m_next_id++;
+        m_slots.emplace(id, m_handlers.size());
+        m_handlers.emplace_back(id, name, callback);
+        return id;
+    }
+
+    [[nodiscard]] bool disconnect(JS::HandleValue id_value) {
+        uint32_t id;
+        if (!id_from_value(id_value, &id))
+            return false;
+
+        auto it = m_slots.find(id);
+        if (it == m_slots.end())
+            return false;
+
+        clear(&m_handlers[it->second]);
+        m_slots.erase(it);
+        maybe_compact();
+        return true;
+    }
+
+    [[nodiscard]] bool is_connected(JS::HandleValue id_value) const {
+        uint32_t id;
+        return id_from_value(id_value, &id) && m_slots.count(id) > 0;
+    }
+
+    void disconnect_all() {
+        for (Handler& handler : m_handlers)
+            clear(&handler);
+        m_slots.clear();
+        maybe_compact();
+    }
+
+    [[nodiscard]] size_t length() const { return m_slots.size(); }
+
+    // Calls each handler connected to @name with @args, until one returns
+    // true. Exceptions are logged and don't stop the emission.
+    GJS_JSAPI_RETURN_CONVENTION
+    bool emit(JSContext* cx, JS::HandleValue name,
+              const JS::HandleValueArray& args) {
+        JS::RootedId name_id(cx);
+        if (!JS_ValueToId(cx, name, &name_id))
+            return false;
+
+        // Handlers connected during the emission are not called
+        size_t n_handlers = m_handlers.size();
+        JS::RootedObject callback(cx);
+        JS::RootedValue rval(cx);
+        bool ok = true;
+
+        m_emission_depth++;
+        for (size_t ix = 0; ix < n_handlers; ix++) {
+            // Index again every time, since a handler may connect more
+            // handlers and reallocate the vector
+            if (!m_handlers[ix].id || m_handlers[ix].name.get() != name_id)
+                continue;
+
+            callback = m_handlers[ix].callback;
+            if (JS::Call(cx, JS::NullHandleValue, callback, args, &rval)) {
+                if (rval.isTrue())
+                    break;
+            } else if (!log_handler_exception(cx, name)) {
+                ok = false;
+                break;
+            }
+        }
+        m_emission_depth--;
+
+        maybe_compact();
+        return ok;
+    }
+
+    void trace_edges(JSTracer* trc) {
+        for (Handler& handler : m_handlers) {
+            if (!handler.id)
+                continue;
+            JS::TraceEdge(trc, &handler.name, "SignalHandlers::name");
+            JS::TraceEdge(trc, &handler.callback, "SignalHandlers::callback");
+        }
+    }
+
+    // JS API
+
+    static const JSClass klass;
+
+    [[nodiscard]] static SignalHandlers* for_js(JSContext* cx,
+                                                const JS::CallArgs& args) {
+        JS::RootedObject obj(cx);
+        if (!args.computeThis(cx, &obj))
+            return nullptr;
+
+        JS::CallArgs args_copy = args;
+        auto* priv = static_cast<SignalHandlers*>(
+            JS_GetInstancePrivate(cx, obj, &klass, &args_copy));
+        if (!priv && !JS_IsExceptionPending(cx))
+            gjs_throw(cx, "SignalHandlers.prototype is not a SignalHandlers");
+        return priv;
+    }
+
+    GJS_JSAPI_RETURN_CONVENTION
+    static bool constructor(JSContext* cx, unsigned argc, JS::Value* vp) {
+        JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+        if (!args.isConstructing()) {
+            gjs_throw_constructor_error(cx);
+            return false;
+        }
+
+        JS::RootedObject obj(cx, JS_NewObjectForConstructor(cx, &klass, args));
+        if (!obj)
+            return false;
+
+        JS_SetPrivate(obj, new SignalHandlers());
+        args.rval().setObject(*obj);
+        return true;
+    }
+
+    static void finalize(JSFreeOp*, JSObject* obj) {
+        delete static_cast<SignalHandlers*>(JS_GetPrivate(obj));
+    }
+
+    static void trace(JSTracer* trc, JSObject* obj) {
+        auto* priv = static_cast<SignalHandlers*>(JS_GetPrivate(obj));
+        if (priv)
+            priv->trace_edges(trc);
+    }
+
+    // connect(name, callback): returns the new handler ID
+    GJS_JSAPI_RETURN_CONVENTION
+    static bool connect_func(JSContext* cx, unsigned argc, JS::Value* vp) {
+        JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+        SignalHandlers* priv = for_js(cx, args);
+        if (!priv)
+            return false;
+
+        if (!args.get(1).isObject() || !JS::IsCallable(&args[1].toObject())) {
+            gjs_throw(cx,
+                      "When connecting signal must give a callback that is a "
+                      "function");
+            return false;
+        }
+
+        JS::RootedId name(cx);
+        if (!JS_ValueToId(cx, args.get(0), &name))
+            return false;
+
+        args.rval().setNumber(priv->connect(name, &args[1].toObject()));
+        return true;
+    }
+
+    // disconnect(id): returns false if @id is not connected
+    GJS_JSAPI_RETURN_CONVENTION
+    static bool disconnect_func(JSContext* cx, unsigned argc, JS::Value* vp) {
+        JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+        SignalHandlers* priv = for_js(cx, args);
+        if (!priv)
+            return false;
+
+        args.rval().setBoolean(priv->disconnect(args.get(0)));
+        return true;
+    }
+
+    GJS_JSAPI_RETURN_CONVENTION
+    static bool is_connected_func(JSContext* cx, unsigned argc,
+                                  JS::Value* vp) {
+        JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+        SignalHandlers* priv = for_js(cx, args);
+        if (!priv)
+            return false;
+
+        args.rval().setBoolean(priv->is_connected(args.get(0)));
+        return true;
+    }
+
+    GJS_JSAPI_RETURN_CONVENTION
+    static bool disconnect_all_func(JSContext* cx, unsigned argc,
+                                    JS::Value* vp) {
+        JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+        SignalHandlers* priv = for_js(cx, args);
+        if (!priv)
+            return false;
+
+        priv->disconnect_all();
+        args.rval().setUndefined();
+        return true;
+    }
+
+    // emit(name, emitter, ...args): the handlers are called with the
+    // arguments after @name, straight from the argument vector of this call
+    GJS_JSAPI_RETURN_CONVENTION
+    static bool emit_func(JSContext* cx, unsigned argc, JS::Value* vp) {
+        JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+        SignalHandlers* priv = for_js(cx, args);
+        if (!priv)
+            return false;
+
+        if (!args.requireAtLeast(cx, "emit", 1))
+            return false;
+
+        JS::RootedValue name(cx, args[0]);
+        auto handler_args =
+            JS::HandleValueArray::fromMarkedLocation(argc - 1, args.array() + 1);
+        args.rval().setUndefined();
+        return priv->emit(cx, name, handler_args);
+    }
+
+    GJS_JSAPI_RETURN_CONVENTION
+    static bool get_length(JSContext* cx, unsigned argc, JS::Value* vp) {
+        JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+        SignalHandlers* priv = for_js(cx, args);
+        if (!priv)
+            return false;
+
+        args.rval().setNumber(static_cast<double>(priv->length()));
+        return true;
+    }
+};
+
+static const JSClassOps signal_handlers_class_ops = {
+    nullptr,  // addProperty
+    nullptr,  // deleteProperty
+    nullptr,  // enumerate
+    nullptr,  // newEnumerate
+    nullptr,  // resolve
+    nullptr,  // mayResolve
+    &SignalHandlers::finalize,
+    nullptr,  // call
+    nullptr,  // hasInstance
+    nullptr,  // construct
+    &SignalHandlers::trace,
+};
+
+const JSClass SignalHandlers::klass = {
+    "SignalHandlers",
+    JSCLASS_HAS_PRIVATE | JSCLASS_FOREGROUND_FINALIZE,
+    &signal_handlers_class_ops,
+};
+
+static const JSPropertySpec signal_handlers_proto_props[] = {
+    JS_PSG("length", &SignalHandlers::get_length, JSPROP_PERMANENT),
+    JS_PS_END};
+
+// clang-format off
+static const JSFunctionSpec signal_handlers_proto_funcs[] = {
+    JS_FN("connect", &SignalHandlers::connect_func, 2, 0),
+    JS_FN("disconnect", &SignalHandlers::disconnect_func, 1, 0),
+    JS_FN("isConnected", &SignalHandlers::is_connected_func, 1, 0),
+    JS_FN("disconnectAll", &SignalHandlers::disconnect_all_func, 0, 0),
+    JS_FN("emit", &SignalHandlers::emit_func, 2, 0),
+    JS_FS_END};
+// clang-format on
+
+bool gjs_define_signals_stuff(JSContext* cx, JS::MutableHandleObject module) {
+    module.set(JS_NewPlainObject(cx));
+    if (!module)
+        return false;
+
+    return !!JS_InitClass(cx, module, nullptr, &SignalHandlers::klass,
+                        &SignalHandlers::constructor, 0,
+                        signal_handlers_proto_props,
+                        signal_handlers_proto_funcs, nullptr, nullptr);
+}
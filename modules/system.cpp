@@ -25,28 +25,41 @@
 #include <config.h>  // for GJS_VERSION
 
 #include <errno.h>
+#include <stdint.h>
 #include <stdio.h>   // for FILE, fclose, stdout
 #include <string.h>  // for strerror
 #include <time.h>    // for tzset
 
+#include <utility>  // for move, pair
+#include <vector>
+
 #include <glib-object.h>
 #include <glib.h>
 
+#include <js/Array.h>  // for IsArrayObject, GetArrayLength
 #include <js/CallArgs.h>
+#include <js/Conversions.h>  // for ToBoolean, ToNumber
 #include <js/Date.h>                // for ResetTimeZone
 #include <js/GCAPI.h>               // for JS_GC
-#include <js/PropertyDescriptor.h>  // for JSPROP_READONLY
+#include <js/PropertyDescriptor.h>  // for JSPROP_READONLY, JSPROP_ENUMERATE
 #include <js/PropertySpec.h>
 #include <js/RootingAPI.h>
 #include <js/TypeDecls.h>
 #include <jsapi.h>        // for JS_DefinePropertyById, JS_DefineF...
 #include <jsfriendapi.h>  // for DumpHeap, IgnoreNurseryObjects
+#include <jspubtd.h>      // for JSProto_RangeError
 
+#include "gi/call-stats.h"
 #include "gi/object.h"
+#include "gi/toggle.h"
 #include "cjs/atoms.h"
 #include "cjs/context-private.h"
+#include "cjs/heap-snapshot.h"
+#include "cjs/importer.h"
 #include "cjs/jsapi-util-args.h"
 #include "cjs/jsapi-util.h"
+#include "cjs/mem.h"
+#include "cjs/script-cache.h"
 #include "modules/system.h"
 #include "util/log.h"
 
@@ -158,15 +171,98 @@ gjs_dump_heap(JSContext *cx,
     return true;
 }
 
+GJS_JSAPI_RETURN_CONVENTION
+static bool gjs_dump_heap_snapshot(JSContext* cx, unsigned argc,
+                                   JS::Value* vp) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+    GjsAutoChar filename;
+    bool only_wrappers = false;
+
+    if (!gjs_parse_call_args(cx, "dumpHeapSnapshot", args, "F|b", "filename",
+                             &filename, "onlyWrappers", &only_wrappers))
+        return false;
+
+    FILE* fp = fopen(filename, "w");
+    if (!fp) {
+        gjs_throw(cx, "Cannot write heap snapshot to %s: %s", filename.get(),
+                  strerror(errno));
+        return false;
+    }
+
+    bool ok = gjs_write_heap_snapshot(cx, fp,
+                                      only_wrappers
+                                          ? GjsHeapSnapshotFilter::GI_WRAPPERS
+                                          : GjsHeapSnapshotFilter::ALL);
+    fclose(fp);
+    if (!ok) {
+        gjs_throw(cx, "Failed to write heap snapshot to %s", filename.get());
+        return false;
+    }
+
+    args.rval().setUndefined();
+    return true;
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool gc_flag_from_options(JSContext* cx, JS::HandleObject options,
+                                 const char* name, GjsGCFlags flag,
+                                 GjsGCFlags* flags) {
+    JS::RootedValue value(cx);
+    if (!JS_GetProperty(cx, options, name, &value))
+        return false;
+    if (JS::ToBoolean(value))
+        *flags = GjsGCFlags(*flags | flag);
+    return true;
+}
+
+// gc(options): without options, a full collection that blocks until it is
+// done. {minor: true} only collects the nursery; {incremental: true, budgetMs}
+// spends at most budgetMs now and finishes from the main loop; {shrink: true}
+// also releases unused memory to the system.
+GJS_JSAPI_RETURN_CONVENTION
 static bool
 gjs_gc(JSContext *context,
        unsigned   argc,
        JS::Value *vp)
 {
     JS::CallArgs argv = JS::CallArgsFromVp (argc, vp);
-    if (!gjs_parse_call_args(context, "gc", argv, ""))
+    JS::RootedObject options(context);
+    if (!gjs_parse_call_args(context, "gc", argv, "|o", "options", &options))
+        return false;
+
+    if (!options) {
+        JS_GC(context);
+        argv.rval().setUndefined();
+        return true;
+    }
+
+    GjsGCFlags flags = GJS_GC_FLAGS_NONE;
+    JS::RootedValue budget_value(context);
+    double budget_ms = 0;
+    if (!gc_flag_from_options(context, options, "minor", GJS_GC_FLAGS_MINOR,
+                              &flags) ||
+        !gc_flag_from_options(context, options, "incremental",
+                              GJS_GC_FLAGS_INCREMENTAL, &flags) ||
+        !gc_flag_from_options(context, options, "shrink", GJS_GC_FLAGS_SHRINK,
+                              &flags) ||
+        !JS_GetProperty(context, options, "budgetMs", &budget_value))
+        return false;
+    if (!budget_value.isUndefined() &&
+        !JS::ToNumber(context, budget_value, &budget_ms))
+        return false;
+
+    if ((flags & GJS_GC_FLAGS_MINOR) && flags != GJS_GC_FLAGS_MINOR) {
+        gjs_throw(context,
+                  "A minor collection can't be incremental or shrinking");
         return false;
-    JS_GC(context);
+    }
+    if (!(budget_ms >= 0 && budget_ms <= G_MAXINT32)) {
+        gjs_throw_custom(context, JSProto_RangeError, nullptr,
+                         "Invalid GC budget %f ms", budget_ms);
+        return false;
+    }
+
+    GjsContextPrivate::from_cx(context)->gc(flags, int64_t(budget_ms));
     argv.rval().setUndefined();
     return true;
 }
@@ -200,15 +296,176 @@ static bool gjs_clear_date_caches(JSContext*, unsigned argc, JS::Value* vp) {
     return true;
 }
 
+static bool gjs_clear_import_cache(JSContext*, unsigned argc, JS::Value* vp) {
+    JS::CallArgs rec = JS::CallArgsFromVp(argc, vp);
+
+    gjs_importer_clear_directory_cache();
+
+    rec.rval().setUndefined();
+    return true;
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool gjs_prefetch_modules(JSContext* cx, unsigned argc, JS::Value* vp) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+    JS::RootedObject paths_obj(cx);
+    if (!gjs_parse_call_args(cx, "prefetchModules", args, "o", "paths",
+                             &paths_obj))
+        return false;
+
+    bool is_array;
+    uint32_t len;
+    if (!JS::IsArrayObject(cx, paths_obj, &is_array))
+        return false;
+    if (!is_array) {
+        gjs_throw(cx, "prefetchModules() expects an array of paths");
+        return false;
+    }
+    if (!JS::GetArrayLength(cx, paths_obj, &len))
+        return false;
+
+    std::vector<JS::UniqueChars> paths;
+    std::vector<const char*> path_ptrs;
+    JS::RootedValue elem(cx);
+    for (uint32_t ix = 0; ix < len; ix++) {
+        if (!JS_GetElement(cx, paths_obj, ix, &elem))
+            return false;
+        JS::UniqueChars path = gjs_string_to_utf8(cx, elem);
+        if (!path)
+            return false;
+        path_ptrs.push_back(path.get());
+        paths.push_back(std::move(path));
+    }
+    path_ptrs.push_back(nullptr);
+
+    gjs_prefetch_scripts(cx, path_ptrs.data());
+
+    args.rval().setUndefined();
+    return true;
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool gjs_memory_counters(JSContext* cx, unsigned argc, JS::Value* vp) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+
+    size_t n_counters;
+    GjsAutoFree<GjsMemoryCounter> counters =
+        gjs_memory_get_counters(&n_counters);
+
+    JS::RootedObject retval(cx, JS_NewPlainObject(cx));
+    if (!retval)
+        return false;
+
+    JS::RootedObject item(cx);
+    JS::RootedValue value(cx);
+    for (size_t ix = 0; ix < n_counters; ix++) {
+        const GjsMemoryCounter& counter = counters.get()[ix];
+        item = JS_NewPlainObject(cx);
+        if (!item)
+            return false;
+
+        value.setInt32(counter.count);
+        if (!JS_DefineProperty(cx, item, "count", value, JSPROP_ENUMERATE))
+            return false;
+
+        value.setNumber(static_cast<double>(counter.bytes));
+        if (!JS_DefineProperty(cx, item, "bytes", value, JSPROP_ENUMERATE) ||
+            !JS_DefineProperty(cx, retval, counter.name, item,
+                               JSPROP_ENUMERATE))
+            return false;
+    }
+
+    args.rval().setObject(*retval);
+    return true;
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool gjs_gc_stats(JSContext* cx, unsigned argc, JS::Value* vp) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+
+    const GjsContextPrivate::GCStats& gc_stats =
+        GjsContextPrivate::from_cx(cx)->gc_stats();
+
+    JS::RootedObject retval(cx, JS_NewPlainObject(cx));
+    if (!retval)
+        return false;
+
+    JS::RootedValue value(cx);
+    value.setNumber(static_cast<double>(gc_stats.major_count));
+    if (!JS_DefineProperty(cx, retval, "majorCollections", value,
+                           JSPROP_ENUMERATE))
+        return false;
+
+    const std::pair<const char*, const GjsCallStats*> entries[] = {
+        {"majorSlices", &gc_stats.major_slices},
+        {"minorCollections", &gc_stats.minor_collections},
+        {"toggles", &ToggleQueue::get_default().latency()},
+    };
+    JS::RootedObject item(cx);
+    for (const auto& entry : entries) {
+        item = JS_NewPlainObject(cx);
+        if (!item ||
+            !gjs_call_stats_define_properties(cx, *entry.second, item) ||
+            !JS_DefineProperty(cx, retval, entry.first, item,
+                               JSPROP_ENUMERATE))
+            return false;
+    }
+
+    args.rval().setObject(*retval);
+    return true;
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool gjs_call_stats(JSContext* cx, unsigned argc, JS::Value* vp) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+    return gjs_call_stats_to_js(cx, args.rval());
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool gjs_marshal_stats(JSContext* cx, unsigned argc, JS::Value* vp) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+    return gjs_marshal_stats_to_js(cx, args.rval());
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool gjs_wrapper_report(JSContext* cx, unsigned argc, JS::Value* vp) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+    JS::UniqueChars type_name;
+    if (!gjs_parse_call_args(cx, "wrapperReport", args, "|s", "typeName",
+                             &type_name))
+        return false;
+
+    return ObjectInstance::retention_report(cx, type_name.get(), args.rval());
+}
+
+static bool gjs_reset_call_stats(JSContext*, unsigned argc, JS::Value* vp) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+
+    gjs_call_stats_reset();
+
+    args.rval().setUndefined();
+    return true;
+}
+
 static JSFunctionSpec module_funcs[] = {
     JS_FN("addressOf", gjs_address_of, 1, GJS_MODULE_PROP_FLAGS),
     JS_FN("addressOfGObject", gjs_address_of_gobject, 1, GJS_MODULE_PROP_FLAGS),
     JS_FN("refcount", gjs_refcount, 1, GJS_MODULE_PROP_FLAGS),
     JS_FN("breakpoint", gjs_breakpoint, 0, GJS_MODULE_PROP_FLAGS),
     JS_FN("dumpHeap", gjs_dump_heap, 1, GJS_MODULE_PROP_FLAGS),
+    JS_FN("dumpHeapSnapshot", gjs_dump_heap_snapshot, 1,
+          GJS_MODULE_PROP_FLAGS),
     JS_FN("gc", gjs_gc, 0, GJS_MODULE_PROP_FLAGS),
     JS_FN("exit", gjs_exit, 0, GJS_MODULE_PROP_FLAGS),
     JS_FN("clearDateCaches", gjs_clear_date_caches, 0, GJS_MODULE_PROP_FLAGS),
+    JS_FN("clearImportCache", gjs_clear_import_cache, 0, GJS_MODULE_PROP_FLAGS),
+    JS_FN("prefetchModules", gjs_prefetch_modules, 1, GJS_MODULE_PROP_FLAGS),
+    JS_FN("memoryCounters", gjs_memory_counters, 0, GJS_MODULE_PROP_FLAGS),
+    JS_FN("gcStats", gjs_gc_stats, 0, GJS_MODULE_PROP_FLAGS),
+    JS_FN("callStats", gjs_call_stats, 0, GJS_MODULE_PROP_FLAGS),
+    JS_FN("marshalStats", gjs_marshal_stats, 0, GJS_MODULE_PROP_FLAGS),
+    JS_FN("resetCallStats", gjs_reset_call_stats, 0, GJS_MODULE_PROP_FLAGS),
+    JS_FN("wrapperReport", gjs_wrapper_report, 0, GJS_MODULE_PROP_FLAGS),
     JS_FS_END};
 
 bool
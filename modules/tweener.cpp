@@ -0,0 +1,596 @@
+/* -*- mode: C++; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * SPDX-License-Identifier: MIT OR LGPL-2.0-or-later
+ */
+
+#include <config.h>
+
+#include <stdint.h>
+#include <stdlib.h>  // for exit
+
+#include <cmath>
+
+#include <glib-object.h>
+#include <glib.h>
+
+#include <js/Array.h>  // for NewArrayObject
+#include <js/CallArgs.h>
+#include <js/Conversions.h>
+#include <js/GCAPI.h>  // for AutoCheckCannotGC
+#include <js/PropertySpec.h>
+#include <js/RootingAPI.h>
+#include <js/TypeDecls.h>
+#include <js/Value.h>
+#include <jsapi.h>        // for JS_GetProperty, JS_NewArrayObject
+#include <jsfriendapi.h>  // for JS_IsFloat64Array, JS_GetObjectFunction
+#include <jspubtd.h>      // for JSProto_TypeError
+
+#include "gi/closure.h"
+#include "cjs/context-private.h"
+#include "cjs/context.h"  // for gjs_dumpstack
+#include "cjs/jsapi-util-args.h"
+#include "cjs/jsapi-util.h"
+#include "cjs/macros.h"
+#include "modules/tweener.h"
+
+// Easing equations, ported from modules/script/tweener/equations.js, where
+// they are documented. They take the same arguments: the current time, the
+// starting value, the change in value, the duration, and the optional
+// parameters, which are NaN if not given.
+
+struct EaseParams {
+    double period;
+    double amplitude;
+    double overshoot;
+};
+
+using EaseFunc = double (*)(double t, double b, double c, double d,
+                            const EaseParams& p);
+
+static double ease_none(double t, double b, double c, double d,
+                        const EaseParams&) {
+    return c * t / d + b;
+}
+
+static double ease_in_quad(double t, double b, double c, double d,
+                           const EaseParams&) {
+    t /= d;
+    return c * t * t + b;
+}
+
+static double ease_out_quad(double t, double b, double c, double d,
+                            const EaseParams&) {
+    t /= d;
+    return -c * t * (t - 2) + b;
+}
+
+static double ease_in_out_quad(double t, double b, double c, double d,
+                               const EaseParams&) {
+    t /= d / 2;
+    if (t < 1)
+        return c / 2 * t * t + b;
+    t--;
+    return -c / 2 * (t * (t - 2) - 1) + b;
+}
+
+static double ease_in_cubic(double t, double b, double c, double d,
+                            const EaseParams&) {
+    t /= d;
+    return c * t * t * t + b;
+}
+
+static double ease_out_cubic(double t, double b, double c, double d,
+                             const EaseParams&) {
+    t = t / d - 1;
+    return c * (t * t * t + 1) + b;
+}
+
+static double ease_in_out_cubic(double t, double b, double c, double d,
+                                const EaseParams&) {
+    t /= d / 2;
+    if (t < 1)
+        return c / 2 * t * t * t + b;
+    t -= 2;
+    return c / 2 * (t * t * t + 2) + b;
+}
+
+static double ease_in_quart(double t, double b, double c, double d,
+                            const EaseParams&) {
+    t /= d;
+    return c * t * t * t * t + b;
+}
+
+static double ease_out_quart(double t, double b, double c, double d,
+                             const EaseParams&) {
+    t = t / d - 1;
+    return -c * (t * t * t * t - 1) + b;
+}
+
+static double ease_in_out_quart(double t, double b, double c, double d,
+                                const EaseParams&) {
+    t /= d / 2;
+    if (t < 1)
+        return c / 2 * t * t * t * t + b;
+    t -= 2;
+    return -c / 2 * (t * t * t * t - 2) + b;
+}
+
+static double ease_in_quint(double t, double b, double c, double d,
+                            const EaseParams&) {
+    t /= d;
+    return c * t * t * t * t * t + b;
+}
+
+static double ease_out_quint(double t, double b, double c, double d,
+                             const EaseParams&) {
+    t = t / d - 1;
+    return c * (t * t * t * t * t + 1) + b;
+}
+
+static double ease_in_out_quint(double t, double b, double c, double d,
+                                const EaseParams&) {
+    t /= d / 2;
+    if (t < 1)
+        return c / 2 * t * t * t * t * t + b;
+    t -= 2;
+    return c / 2 * (t * t * t * t * t + 2) + b;
+}
+
+static double ease_in_sine(double t, double b, double c, double d,
+                           const EaseParams&) {
+    return -c * std::cos(t / d * (M_PI / 2)) + c + b;
+}
+
+static double ease_out_sine(double t, double b, double c, double d,
+                            const EaseParams&) {
+    return c * std::sin(t / d * (M_PI / 2)) + b;
+}
+
+static double ease_in_out_sine(double t, double b, double c, double d,
+                               const EaseParams&) {
+    return -c / 2 * (std::cos(M_PI * t / d) - 1) + b;
+}
+
+static double ease_in_expo(double t, double b, double c, double d,
+                           const EaseParams&) {
+    return t <= 0 ? b : c * std::pow(2, 10 * (t / d - 1)) + b;
+}
+
+static double ease_out_expo(double t, double b, double c, double d,
+                            const EaseParams&) {
+    return t >= d ? b + c : c * (-std::pow(2, -10 * t / d) + 1) + b;
+}
+
+static double ease_in_out_expo(double t, double b, double c, double d,
+                               const EaseParams&) {
+    if (t <= 0)
+        return b;
+    if (t >= d)
+        return b + c;
+    t /= d / 2;
+    if (t < 1)
+        return c / 2 * std::pow(2, 10 * (t - 1)) + b;
+    t--;
+    return c / 2 * (-std::pow(2, -10 * t) + 2) + b;
+}
+
+static double ease_in_circ(double t, double b, double c, double d,
+                           const EaseParams&) {
+    t /= d;
+    return -c * (std::sqrt(1 - t * t) - 1) + b;
+}
+
+static double ease_out_circ(double t, double b, double c, double d,
+                            const EaseParams&) {
+    t = t / d - 1;
+    return c * std::sqrt(1 - t * t) + b;
+}
+
+static double ease_in_out_circ(double t, double b, double c, double d,
+                               const EaseParams&) {
+    t /= d / 2;
+    if (t < 1)
+        return -c / 2 * (std::sqrt(1 - t * t) - 1) + b;
+    t -= 2;
+    return c / 2 * (std::sqrt(1 - t * t) + 1) + b;
+}
+
+// Works out the amplitude and phase shift of the elastic equations
+static void elastic_shape(double c, double p, const EaseParams& params,
+                          double* a, double* s) {
+    *a = std::isnan(params.amplitude) ? 0 : params.amplitude;
+    if (!*a || *a < std::fabs(c)) {
+        *a = c;
+        *s = p / 4;
+    } else {
+        *s = p / (2 * M_PI) * std::asin(c / *a);
+    }
+}
+
+static double ease_in_elastic(double t, double b, double c, double d,
+                              const EaseParams& params) {
+    if (t <= 0)
+        return b;
+    t /= d;
+    if (t >= 1)
+        return b + c;
+    double p = std::isnan(params.period) ? d * .3 : params.period;
+    double a, s;
+    elastic_shape(c, p, params, &a, &s);
+    t -= 1;
+    return -(a * std::pow(2, 10 * t) * std::sin((t * d - s) * (2 * M_PI) / p)) +
+           b;
+}
+
+static double ease_out_elastic(double t, double b, double c, double d,
+                               const EaseParams& params) {
+    if (t <= 0)
+        return b;
+    t /= d;
+    if (t >= 1)
+        return b + c;
+    double p = std::isnan(params.period) ? d * .3 : params.period;
+    double a, s;
+    elastic_shape(c, p, params, &a, &s);
+    return a * std::pow(2, -10 * t) * std::sin((t * d - s) * (2 * M_PI) / p) +
+           c + b;
+}
+
+static double ease_in_out_elastic(double t, double b, double c, double d,
+                                  const EaseParams& params) {
+    if (t <= 0)
+        return b;
+    t /= d / 2;
+    if (t >= 2)
+        return b + c;
+    double p = std::isnan(params.period) ? d * (.3 * 1.5) : params.period;
+    double a, s;
+    elastic_shape(c, p, params, &a, &s);
+    if (t < 1) {
+        t -= 1;
+        return -.5 * (a * std::pow(2, 10 * t) *
+                      std::sin((t * d - s) * (2 * M_PI) / p)) +
+               b;
+    }
+    t -= 1;
+    return a * std::pow(2, -10 * t) * std::sin((t * d - s) * (2 * M_PI) / p) *
+               .5 +
+           c + b;
+}
+
+static double overshoot(const EaseParams& params) {
+    return std::isnan(params.overshoot) ? 1.70158 : params.overshoot;
+}
+
+static double ease_in_back(double t, double b, double c, double d,
+                           const EaseParams& params) {
+    double s = overshoot(params);
+    t /= d;
+    return c * t * t * ((s + 1) * t - s) + b;
+}
+
+static double ease_out_back(double t, double b, double c, double d,
+                            const EaseParams& params) {
+    double s = overshoot(params);
+    t = t / d - 1;
+    return c * (t * t * ((s + 1) * t + s) + 1) + b;
+}
+
+static double ease_in_out_back(double t, double b, double c, double d,
+                               const EaseParams& params) {
+    double s = overshoot(params) * 1.525;
+    t /= d / 2;
+    if (t < 1)
+        return c / 2 * (t * t * ((s + 1) * t - s)) + b;
+    t -= 2;
+    return c / 2 * (t * t * ((s + 1) * t + s) + 2) + b;
+}
+
+static double ease_out_bounce(double t, double b, double c, double d,
+                              const EaseParams&) {
+    t /= d;
+    if (t < 1 / 2.75)
+        return c * (7.5625 * t * t) + b;
+    if (t < 2 / 2.75) {
+        t -= 1.5 / 2.75;
+        return c * (7.5625 * t * t + .75) + b;
+    }
+    if (t < 2.5 / 2.75) {
+        t -= 2.25 / 2.75;
+        return c * (7.5625 * t * t + .9375) + b;
+    }
+    t -= 2.625 / 2.75;
+    return c * (7.5625 * t * t + .984375) + b;
+}
+
+static double ease_in_bounce(double t, double b, double c, double d,
+                             const EaseParams& params) {
+    return c - ease_out_bounce(d - t, 0, c, d, params) + b;
+}
+
+static double ease_in_out_bounce(double t, double b, double c, double d,
+                                 const EaseParams& params) {
+    if (t < d / 2)
+        return ease_in_bounce(t * 2, 0, c, d, params) * .5 + b;
+    return ease_out_bounce(t * 2 - d, 0, c, d, params) * .5 + c * .5 + b;
+}
+
+// The easeOutIn variants: the out equation for the first half, and the in
+// equation for the second
+template <EaseFunc ease_out, EaseFunc ease_in>
+static double ease_out_in(double t, double b, double c, double d,
+                          const EaseParams& params) {
+    if (t < d / 2)
+        return ease_out(t * 2, b, c / 2, d, params);
+    return ease_in(t * 2 - d, b + c / 2, c / 2, d, params);
+}
+
+// Indexed by the curve numbers that are handed out to JS in
+// _tweenerNative.curves; named as the functions in equations.js
+static const struct {
+    const char* name;
+    EaseFunc func;
+} curves[] = {
+    {"easeNone", ease_none},
+    {"linear", ease_none},
+    {"easeInQuad", ease_in_quad},
+    {"easeOutQuad", ease_out_quad},
+    {"easeInOutQuad", ease_in_out_quad},
+    {"easeOutInQuad", ease_out_in<ease_out_quad, ease_in_quad>},
+    {"easeInCubic", ease_in_cubic},
+    {"easeOutCubic", ease_out_cubic},
+    {"easeInOutCubic", ease_in_out_cubic},
+    {"easeOutInCubic", ease_out_in<ease_out_cubic, ease_in_cubic>},
+    {"easeInQuart", ease_in_quart},
+    {"easeOutQuart", ease_out_quart},
+    {"easeInOutQuart", ease_in_out_quart},
+    {"easeOutInQuart", ease_out_in<ease_out_quart, ease_in_quart>},
+    {"easeInQuint", ease_in_quint},
+    {"easeOutQuint", ease_out_quint},
+    {"easeInOutQuint", ease_in_out_quint},
+    {"easeOutInQuint", ease_out_in<ease_out_quint, ease_in_quint>},
+    {"easeInSine", ease_in_sine},
+    {"easeOutSine", ease_out_sine},
+    {"easeInOutSine", ease_in_out_sine},
+    {"easeOutInSine", ease_out_in<ease_out_sine, ease_in_sine>},
+    {"easeInExpo", ease_in_expo},
+    {"easeOutExpo", ease_out_expo},
+    {"easeInOutExpo", ease_in_out_expo},
+    {"easeOutInExpo", ease_out_in<ease_out_expo, ease_in_expo>},
+    {"easeInCirc", ease_in_circ},
+    {"easeOutCirc", ease_out_circ},
+    {"easeInOutCirc", ease_in_out_circ},
+    {"easeOutInCirc", ease_out_in<ease_out_circ, ease_in_circ>},
+    {"easeInElastic", ease_in_elastic},
+    {"easeOutElastic", ease_out_elastic},
+    {"easeInOutElastic", ease_in_out_elastic},
+    {"easeOutInElastic", ease_out_in<ease_out_elastic, ease_in_elastic>},
+    {"easeInBack", ease_in_back},
+    {"easeOutBack", ease_out_back},
+    {"easeInOutBack", ease_in_out_back},
+    {"easeOutInBack", ease_out_in<ease_out_back, ease_in_back>},
+    {"easeInBounce", ease_in_bounce},
+    {"easeOutBounce", ease_out_bounce},
+    {"easeInOutBounce", ease_in_out_bounce},
+    {"easeOutInBounce", ease_out_in<ease_out_bounce, ease_in_bounce>},
+};
+
+// Reads a transitionParams member the same way as isNaN() in equations.js
+GJS_JSAPI_RETURN_CONVENTION
+static bool get_ease_param(JSContext* cx, JS::HandleObject params,
+                           const char* name, double* value) {
+    JS::RootedValue v_value(cx);
+    return JS_GetProperty(cx, params, name, &v_value) &&
+           JS::ToNumber(cx, v_value, value);
+}
+
+// interpolate(curve, t, d, transitionParams, starts, completes, values):
+// evaluates easing curve number @curve at time @t of @d for each pair of
+// starting and final values in the Float64Arrays @starts and @completes, and
+// stores the results in the Float64Array @values.
+GJS_JSAPI_RETURN_CONVENTION
+static bool interpolate_func(JSContext* cx, unsigned argc, JS::Value* vp) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+    uint32_t curve;
+    double t, d;
+    JS::RootedObject params(cx), starts(cx), completes(cx), values(cx);
+    if (!gjs_parse_call_args(cx, "interpolate", args, "uff?oooo", "curve",
+                             &curve, "t", &t, "d", &d, "transitionParams",
+                             &params, "starts", &starts, "completes",
+                             &completes, "values", &values))
+        return false;
+
+    if (curve >= G_N_ELEMENTS(curves)) {
+        gjs_throw(cx, "Unknown easing curve %u", curve);
+        return false;
+    }
+
+    if (!JS_IsFloat64Array(starts) || !JS_IsFloat64Array(completes) ||
+        !JS_IsFloat64Array(values)) {
+        gjs_throw_custom(cx, JSProto_TypeError, nullptr,
+                         "interpolate() expects Float64Arrays of values");
+        return false;
+    }
+
+    EaseParams ease_params{NAN, NAN, NAN};
+    if (params && (!get_ease_param(cx, params, "period", &ease_params.period) ||
+                   !get_ease_param(cx, params, "amplitude",
+                                   &ease_params.amplitude) ||
+                   !get_ease_param(cx, params, "overshoot",
+                                   &ease_params.overshoot)))
+        return false;
+
+    bool lengths_match;
+    {
+        JS::AutoCheckCannotGC nogc;
+        uint32_t n_values, n_starts, n_completes;
+        bool is_shared;
+        double *out, *b, *complete;
+        js::GetFloat64ArrayLengthAndData(values, &n_values, &is_shared, &out);
+        js::GetFloat64ArrayLengthAndData(starts, &n_starts, &is_shared, &b);
+        js::GetFloat64ArrayLengthAndData(completes, &n_completes, &is_shared,
+                                         &complete);
+
+        lengths_match = n_starts == n_values && n_completes == n_values;
+        if (lengths_match) {
+            EaseFunc func = curves[curve].func;
+            for (uint32_t ix = 0; ix < n_values; ix++)
+                out[ix] = func(t, b[ix], complete[ix] - b[ix], d, ease_params);
+        }
+    }
+
+    if (!lengths_match) {
+        gjs_throw(cx, "interpolate() expects arrays of the same length");
+        return false;
+    }
+
+    args.rval().setUndefined();
+    return true;
+}
+
+// A GSource that dispatches at a fixed frame rate, for a frame ticker that
+// has no compositor frame clock to follow. Frames are timed from when the
+// source was added, so they don't drift the way a repeated timeout does, and
+// if the main loop falls behind the missed frames are dropped instead of being
+// dispatched late, one right after another.
+struct GjsFrameSource {
+    GSource base;
+    GClosure* closure;
+    int64_t start_time;  // in µs, from g_get_monotonic_time()
+    double interval;     // in µs
+    uint64_t frame;      // number of the next frame to dispatch
+};
+
+static void frame_source_schedule(GjsFrameSource* self) {
+    g_source_set_ready_time(
+        &self->base,
+        self->start_time + static_cast<int64_t>(self->frame * self->interval));
+}
+
+static gboolean frame_source_dispatch(GSource* source, GSourceFunc, void*) {
+    auto* self = reinterpret_cast<GjsFrameSource*>(source);
+    GClosure* closure = self->closure;
+
+    if (G_UNLIKELY(!gjs_closure_is_valid(closure))) {
+        g_critical(
+            "Attempting to run a JS frame callback during shutdown. Because "
+            "it would crash the application, it has been blocked.");
+        return G_SOURCE_REMOVE;
+    }
+
+    JSContext* cx = gjs_closure_get_context(closure);
+    GjsContextPrivate* gjs = GjsContextPrivate::from_cx(cx);
+    if (G_UNLIKELY(gjs->sweeping() || !gjs->is_owner_thread())) {
+        g_critical(
+            "Attempting to run a JS frame callback during garbage collection "
+            "or on a different thread. Because it would crash the "
+            "application, it has been blocked.");
+        gjs_dumpstack();
+        return G_SOURCE_REMOVE;
+    }
+
+    int64_t elapsed = g_source_get_time(source) - self->start_time;
+    uint64_t frame = MAX(self->frame, uint64_t(elapsed / self->interval));
+    self->frame = frame + 1;
+    frame_source_schedule(self);
+
+    // The frame time passed to JS is in milliseconds since the start
+    JS::RootedValue frame_time(cx,
+                               JS::NumberValue(frame * self->interval / 1000));
+    JS::RootedValue rval(cx);
+    if (!gjs_closure_invoke(closure, nullptr, JS::HandleValueArray(frame_time),
+                            &rval, false)) {
+        // Same as a GLib.SourceFunc: an uncatchable exception means we have
+        // to exit here, otherwise remove the source
+        uint8_t code;
+        if (!JS_IsExceptionPending(cx) && gjs->should_exit(&code))
+            exit(code);
+        return G_SOURCE_REMOVE;
+    }
+
+    return JS::ToBoolean(rval);
+}
+
+static void frame_source_finalize(GSource* source) {
+    g_closure_unref(reinterpret_cast<GjsFrameSource*>(source)->closure);
+}
+
+static GSourceFuncs frame_source_funcs = {
+    nullptr,  // prepare; the ready time is always set
+    nullptr,  // check
+    frame_source_dispatch,
+    frame_source_finalize,
+};
+
+// addFrameSource(priority, frameRate, callback): calls @callback at
+// @frameRate frames per second, with the time of the frame in milliseconds
+// since the source was added, until it returns false. Returns the source ID,
+// which can be passed to GLib.source_remove().
+GJS_JSAPI_RETURN_CONVENTION
+static bool add_frame_source_func(JSContext* cx, unsigned argc, JS::Value* vp) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+    int32_t priority;
+    double frame_rate;
+    JS::RootedObject callback(cx);
+    if (!gjs_parse_call_args(cx, "addFrameSource", args, "ifo", "priority",
+                             &priority, "frameRate", &frame_rate, "callback",
+                             &callback))
+        return false;
+
+    if (!(frame_rate > 0 && frame_rate <= 1000)) {
+        gjs_throw(cx, "Frame rate must be between 0 and 1000, got %f",
+                  frame_rate);
+        return false;
+    }
+
+    if (!JS_ObjectIsFunction(callback)) {
+        gjs_throw(cx, "Expected function for frame callback");
+        return false;
+    }
+
+    GSource* source =
+        g_source_new(&frame_source_funcs, sizeof(GjsFrameSource));
+    auto* self = reinterpret_cast<GjsFrameSource*>(source);
+    self->closure = gjs_closure_new(cx, JS_GetObjectFunction(callback),
+                                    "frame source", true);
+    self->start_time = g_get_monotonic_time();
+    self->interval = G_USEC_PER_SEC / frame_rate;
+    self->frame = 1;
+    frame_source_schedule(self);
+
+    g_source_set_priority(source, priority);
+    g_source_set_name(source, "[cjs] tweener frame source");
+    unsigned id = g_source_attach(source, nullptr);
+    g_source_unref(source);
+
+    args.rval().setNumber(id);
+    return true;
+}
+
+// clang-format off
+static constexpr JSFunctionSpec funcs[] = {
+    JS_FN("addFrameSource", add_frame_source_func, 3, GJS_MODULE_PROP_FLAGS),
+    JS_FN("interpolate", interpolate_func, 7, GJS_MODULE_PROP_FLAGS),
+    JS_FS_END};
+// clang-format on
+
+bool gjs_define_tweener_stuff(JSContext* cx, JS::MutableHandleObject module) {
+    module.set(JS_NewPlainObject(cx));
+    if (!module || !JS_DefineFunctions(cx, module, funcs))
+        return false;
+
+    JS::RootedValueVector names(cx);
+    for (const auto& curve : curves) {
+        JS::RootedValue name(cx);
+        if (!gjs_string_from_utf8(cx, curve.name, &name) ||
+            !names.append(name)) {
+            JS_ReportOutOfMemory(cx);
+            return false;
+        }
+    }
+
+    JS::RootedObject names_array(cx, JS::NewArrayObject(cx, names));
+    return names_array &&
+           JS_DefineProperty(cx, module, "curves", names_array,
+                             GJS_MODULE_PROP_FLAGS);
+}
@@ -0,0 +1,18 @@
+/* -*- mode: C++; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * SPDX-License-Identifier: MIT OR LGPL-2.0-or-later
+ */
+
+#ifndef MODULES_TWEENER_H_
+#define MODULES_TWEENER_H_
+
+#include <config.h>
+
+#include <js/TypeDecls.h>
+
+#include "cjs/macros.h"
+
+GJS_JSAPI_RETURN_CONVENTION
+bool gjs_define_tweener_stuff(JSContext* cx, JS::MutableHandleObject module);
+
+#endif  // MODULES_TWEENER_H_
@@ -0,0 +1,658 @@
+/* -*- mode: C++; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * SPDX-License-Identifier: MIT OR LGPL-2.0-or-later
+ */
+
+#include <config.h>
+
+#include <stddef.h>  // for size_t
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <utility>  // for move
+
+#include <gio/gio.h>
+#include <glib-object.h>
+#include <glib.h>
+
+#include <js/CallArgs.h>
+#include <js/Class.h>
+#include <js/CompilationAndEvaluation.h>
+#include <js/CompileOptions.h>
+#include <js/Conversions.h>  // for ToString
+#include <js/ErrorReport.h>
+#include <js/Exception.h>
+#include <js/PropertySpec.h>
+#include <js/Realm.h>  // for InitRealmStandardClasses
+#include <js/RealmOptions.h>
+#include <js/RootingAPI.h>
+#include <js/SourceText.h>
+#include <js/StructuredClone.h>
+#include <js/TypeDecls.h>
+#include <js/Utility.h>  // for UniqueChars
+#include <js/Value.h>
+#include <js/ValueArray.h>
+#include <jsapi.h>        // for JS_NewGlobalObject, JS_CallFunctionValue
+#include <jsfriendapi.h>  // for UseInternalJobQueues, RunJobs
+
+#include "cjs/byteArray.h"
+#include "cjs/context-private.h"
+#include "cjs/jsapi-util-args.h"
+#include "cjs/jsapi-util-root.h"
+#include "cjs/jsapi-util.h"
+#include "cjs/macros.h"
+#include "modules/worker.h"
+
+namespace mozilla {
+union Utf8Unit;
+}
+
+// Workers run a script on a thread of their own, in a JSContext of their own,
+// and exchange structured clones of values with the Worker object that started
+// them. Their global object only has the standard classes and the functions
+// below; introspected libraries are not available, since the GI wrappers
+// depend on state that belongs to the main GjsContext.
+
+class Worker;
+
+// A structured clone posted from one thread to the other, or the description
+// of an exception that the worker didn't catch
+struct WorkerMessage {
+    std::unique_ptr<JSAutoStructuredCloneBuffer> data;
+    std::string error;
+};
+
+// Shared by the Worker object on the main thread and the worker thread. Each
+// direction has a queue, which is emptied by an idle on the main context of
+// the thread that receives the messages.
+class WorkerChannel {
+    gatomicrefcount m_refcount;
+
+    GMutex m_lock;
+    std::deque<WorkerMessage> m_to_worker;  // guarded by m_lock
+    std::deque<WorkerMessage> m_to_main;    // guarded by m_lock
+    bool m_closing = false;                 // guarded by m_lock
+    JSContext* m_worker_cx = nullptr;       // guarded by m_lock
+
+    void post(std::deque<WorkerMessage>* queue, GMainContext* context,
+              GSourceFunc deliver, WorkerMessage&& message) {
+        g_mutex_lock(&m_lock);
+        // A closed worker no longer iterates its main context, so the idle
+        // would never run
+        if (m_closing && queue == &m_to_worker) {
+            g_mutex_unlock(&m_lock);
+            return;
+        }
+        bool was_empty = queue->empty();
+        queue->push_back(std::move(message));
+        g_mutex_unlock(&m_lock);
+
+        // One idle handles all the messages queued before it runs
+        if (was_empty) {
+            GSource* source = g_idle_source_new();
+            g_source_set_callback(source, deliver, ref(), unref_func);
+            g_source_attach(source, context);
+            g_source_unref(source);
+        }
+    }
+
+    [[nodiscard]] std::deque<WorkerMessage> take(
+        std::deque<WorkerMessage>* queue) {
+        g_mutex_lock(&m_lock);
+        std::deque<WorkerMessage> messages = std::move(*queue);
+        queue->clear();
+        g_mutex_unlock(&m_lock);
+        return messages;
+    }
+
+    static void unref_func(void* data) {
+        static_cast<WorkerChannel*>(data)->unref();
+    }
+
+    ~WorkerChannel() {
+        g_mutex_clear(&m_lock);
+        g_main_context_unref(main_context);
+        g_main_context_unref(worker_context);
+    }
+
+ public:
+    GMainContext* const main_context;
+    GMainContext* const worker_context;
+    const GjsAutoChar filename;
+    const GjsAutoChar source;
+    const size_t source_len;
+
+    Worker* owner = nullptr;  // only used on the main thread
+
+    WorkerChannel(char* filename_, char* source_, size_t source_len_)
+        : main_context(g_main_context_ref_thread_default()),
+          worker_context(g_main_context_new()),
+          filename(filename_),
+          source(source_),
+          source_len(source_len_) {
+        g_atomic_ref_count_init(&m_refcount);
+        g_mutex_init(&m_lock);
+    }
+
+    WorkerChannel* ref() {
+        g_atomic_ref_count_inc(&m_refcount);
+        return this;
+    }
+
+    void unref() {
+        if (g_atomic_ref_count_dec(&m_refcount))
+            delete this;
+    }
+
+    void post_to_worker(WorkerMessage&& message, GSourceFunc deliver) {
+        post(&m_to_worker, worker_context, deliver, std::move(message));
+    }
+
+    void post_to_main(WorkerMessage&& message, GSourceFunc deliver) {
+        post(&m_to_main, main_context, deliver, std::move(message));
+    }
+
+    [[nodiscard]] std::deque<WorkerMessage> take_for_worker() {
+        return take(&m_to_worker);
+    }
+
+    [[nodiscard]] std::deque<WorkerMessage> take_for_main() {
+        return take(&m_to_main);
+    }
+
+    [[nodiscard]] bool closing() {
+        g_mutex_lock(&m_lock);
+        bool retval = m_closing;
+        g_mutex_unlock(&m_lock);
+        return retval;
+    }
+
+    // Stops the worker after the task it is running; with interrupt, stops
+    // the task as well
+    void close(bool interrupt = true) {
+        g_mutex_lock(&m_lock);
+        m_closing = true;
+        if (interrupt && m_worker_cx)
+            JS_RequestInterruptCallback(m_worker_cx);
+        g_mutex_unlock(&m_lock);
+        g_main_context_wakeup(worker_context);
+    }
+
+    void set_worker_cx(JSContext* cx) {
+        g_mutex_lock(&m_lock);
+        m_worker_cx = cx;
+        g_mutex_unlock(&m_lock);
+    }
+};
+
+[[nodiscard]] static WorkerChannel* channel_from_worker_cx(JSContext* cx) {
+    return static_cast<WorkerChannel*>(JS_GetContextPrivate(cx));
+}
+
+// Argument 0 is the value to clone, argument 1 an optional array of
+// ArrayBuffers whose contents are moved instead of copied, or GLib.Bytes and
+// Uint8Arrays whose memory is shared through a GBytes, see
+// gjs_byte_array_get_clone_callbacks()
+GJS_JSAPI_RETURN_CONVENTION
+static bool write_message(JSContext* cx, const JS::CallArgs& args,
+                          WorkerMessage* message) {
+    auto buffer = std::make_unique<JSAutoStructuredCloneBuffer>(
+        JS::StructuredCloneScope::SameProcess,
+        gjs_byte_array_get_clone_callbacks(), nullptr);
+    if (!buffer->write(cx, args.get(0), args.get(1), JS::CloneDataPolicy()))
+        return false;
+
+    message->data = std::move(buffer);
+    return true;
+}
+
+// Calls target.onmessage({data}) or target.onerror({message}), if it is a
+// function. @gjs is null in the worker's context.
+GJS_JSAPI_RETURN_CONVENTION
+static bool dispatch_message(JSContext* cx, GjsContextPrivate* gjs,
+                             JS::HandleObject target, WorkerMessage* message) {
+    JS::RootedObject event(cx, JS_NewPlainObject(cx));
+    if (!event)
+        return false;
+
+    const char* handler_name;
+    JS::RootedValue value(cx);
+    if (message->data) {
+        handler_name = "onmessage";
+        if (!message->data->read(cx, &value, JS::CloneDataPolicy(),
+                                 gjs_byte_array_get_clone_callbacks(), gjs) ||
+            !JS_DefineProperty(cx, event, "data", value, JSPROP_ENUMERATE))
+            return false;
+    } else {
+        handler_name = "onerror";
+        if (!gjs_string_from_utf8(cx, message->error.c_str(), &value) ||
+            !JS_DefineProperty(cx, event, "message", value, JSPROP_ENUMERATE))
+            return false;
+    }
+
+    JS::RootedValue handler(cx);
+    if (!JS_GetProperty(cx, target, handler_name, &handler))
+        return false;
+    if (!handler.isObject() || !JS::IsCallable(&handler.toObject())) {
+        if (!message->data)
+            g_warning("Uncaught exception in worker: %s",
+                      message->error.c_str());
+        return true;
+    }
+
+    JS::RootedValueArray<1> argv(cx);
+    argv[0].setObject(*event);
+    JS::RootedValue ignored(cx);
+    return JS_CallFunctionValue(cx, target, handler, argv, &ignored);
+}
+
+// Worker thread ///////////////////////////////////////////////////////////////
+
+static thread_local JSContext* s_worker_cx = nullptr;
+
+static gboolean deliver_to_main(void* data);
+
+// Sends the pending exception to the main thread, if there is one; there is
+// none if the worker was terminated
+static void report_worker_exception(JSContext* cx) {
+    if (!JS_IsExceptionPending(cx))
+        return;
+
+    WorkerMessage message;
+    JS::ExceptionStack exn_stack(cx);
+    JS::ErrorReportBuilder report(cx);
+    if (!JS::StealPendingExceptionStack(cx, &exn_stack) ||
+        !report.init(cx, exn_stack, JS::ErrorReportBuilder::NoSideEffects)) {
+        message.error = "(Unable to get exception)";
+    } else {
+        const JSErrorReport* error_report = report.report();
+        GjsAutoChar description = g_strdup_printf(
+            "%s:%u: %s",
+            error_report->filename ? error_report->filename : "(unknown)",
+            error_report->lineno, report.toStringResult().c_str());
+        message.error = description.get();
+    }
+    JS_ClearPendingException(cx);
+
+    channel_from_worker_cx(cx)->post_to_main(std::move(message),
+                                             deliver_to_main);
+}
+
+static gboolean deliver_to_worker(void* data) {
+    auto* channel = static_cast<WorkerChannel*>(data);
+    std::deque<WorkerMessage> messages = channel->take_for_worker();
+    if (channel->closing())
+        return G_SOURCE_REMOVE;
+
+    // Runs inside the realm of the worker's global, see run_worker_script()
+    JSContext* cx = s_worker_cx;
+    JS::RootedObject global(cx, JS::CurrentGlobalOrNull(cx));
+    for (WorkerMessage& message : messages) {
+        if (channel->closing())
+            break;
+
+        if (!dispatch_message(cx, nullptr, global, &message))
+            report_worker_exception(cx);
+        js::RunJobs(cx);
+    }
+    return G_SOURCE_REMOVE;
+}
+
+// postMessage(value, [transfer]) in the worker
+GJS_JSAPI_RETURN_CONVENTION
+static bool worker_post_message(JSContext* cx, unsigned argc, JS::Value* vp) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+    WorkerMessage message;
+    if (!write_message(cx, args, &message))
+        return false;
+
+    channel_from_worker_cx(cx)->post_to_main(std::move(message),
+                                             deliver_to_main);
+    args.rval().setUndefined();
+    return true;
+}
+
+// close() in the worker: stops after the current task
+static bool worker_close(JSContext* cx, unsigned argc, JS::Value* vp) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+    channel_from_worker_cx(cx)->close(/* interrupt = */ false);
+    args.rval().setUndefined();
+    return true;
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool worker_print_impl(JSContext* cx, const JS::CallArgs& args,
+                              FILE* stream) {
+    std::string line;
+    for (unsigned ix = 0; ix < args.length(); ix++) {
+        JS::RootedString str(cx, JS::ToString(cx, args[ix]));
+        if (!str)
+            return false;
+        JS::UniqueChars chars = JS_EncodeStringToUTF8(cx, str);
+        if (!chars)
+            return false;
+        if (ix > 0)
+            line += ' ';
+        line += chars.get();
+    }
+    line += '\n';
+    fputs(line.c_str(), stream);
+    fflush(stream);
+
+    args.rval().setUndefined();
+    return true;
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool worker_print(JSContext* cx, unsigned argc, JS::Value* vp) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+    return worker_print_impl(cx, args, stdout);
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool worker_printerr(JSContext* cx, unsigned argc, JS::Value* vp) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+    return worker_print_impl(cx, args, stderr);
+}
+
+static bool worker_interrupt_callback(JSContext* cx) {
+    // Returning false stops the script without an exception
+    return !channel_from_worker_cx(cx)->closing();
+}
+
+static const JSClass worker_global_class = {
+    "WorkerGlobalScope",
+    JSCLASS_GLOBAL_FLAGS,
+    &JS::DefaultGlobalClassOps,
+};
+
+// clang-format off
+static const JSFunctionSpec worker_global_funcs[] = {
+    JS_FN("postMessage", worker_post_message, 1, 0),
+    JS_FN("close", worker_close, 0, 0),
+    JS_FN("print", worker_print, 0, 0),
+    JS_FN("printerr", worker_printerr, 0, 0),
+    JS_FS_END};
+// clang-format on
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool run_worker_script(JSContext* cx, WorkerChannel* channel) {
+    JS::RealmOptions options;
+    JS::RootedObject global(
+        cx, JS_NewGlobalObject(cx, &worker_global_class, nullptr,
+                               JS::FireOnNewGlobalHook, options));
+    if (!global)
+        return false;
+
+    JSAutoRealm ar(cx, global);
+    if (!JS::InitRealmStandardClasses(cx) ||
+        !JS_DefineFunctions(cx, global, worker_global_funcs))
+        return false;
+
+    JS::SourceText<mozilla::Utf8Unit> source;
+    if (!source.init(cx, channel->source.get(), channel->source_len,
+                     JS::SourceOwnership::Borrowed))
+        return false;
+
+    JS::CompileOptions compile_options(cx);
+    compile_options.setFileAndLine(channel->filename, 1);
+
+    JS::RootedValue ignored(cx);
+    if (!JS::Evaluate(cx, compile_options, source, &ignored))
+        report_worker_exception(cx);
+    js::RunJobs(cx);
+
+    // Messages are delivered while iterating, inside this realm
+    while (!channel->closing())
+        g_main_context_iteration(channel->worker_context, true);
+
+    return true;
+}
+
+static gboolean deliver_exit_to_main(void* data);
+
+static void* worker_thread_main(void* data) {
+    auto* channel = static_cast<WorkerChannel*>(data);
+    g_main_context_push_thread_default(channel->worker_context);
+
+    JSContext* cx = JS_NewContext(32 * 1024 * 1024 /* max bytes */, nullptr);
+    if (cx && JS::InitSelfHostedCode(cx)) {
+        JS_SetNativeStackQuota(cx, 1024 * 1024);
+        js::UseInternalJobQueues(cx);
+        JS_SetContextPrivate(cx, channel);
+        JS_AddInterruptCallback(cx, worker_interrupt_callback);
+        s_worker_cx = cx;
+        channel->set_worker_cx(cx);
+
+        if (!run_worker_script(cx, channel))
+            report_worker_exception(cx);
+
+        // So that close() no longer interrupts it
+        channel->set_worker_cx(nullptr);
+        s_worker_cx = nullptr;
+    } else {
+        WorkerMessage message;
+        message.error = "Could not create a JS context for the worker";
+        channel->post_to_main(std::move(message), deliver_to_main);
+    }
+
+    if (cx)
+        JS_DestroyContext(cx);
+
+    // Drop the messages that arrived after closing, and with them the
+    // references that their idles hold on the channel
+    channel->close();
+    while (g_main_context_iteration(channel->worker_context, false)) {
+    }
+    g_main_context_pop_thread_default(channel->worker_context);
+
+    g_main_context_invoke_full(channel->main_context, G_PRIORITY_DEFAULT_IDLE,
+                               deliver_exit_to_main, channel,
+                               [](void* data) {
+                                   static_cast<WorkerChannel*>(data)->unref();
+                               });
+    return nullptr;
+}
+
+// Main thread /////////////////////////////////////////////////////////////////
+
+class Worker {
+    WorkerChannel* m_channel;
+    GThread* m_thread;
+    // Rooted while the thread runs, so that its messages can be delivered
+    // even if nothing else refers to the Worker object
+    GjsMaybeOwned<JSObject*> m_wrapper;
+
+    static void on_context_destroy(JS::HandleObject, void* data) {
+        auto* self = static_cast<Worker*>(data);
+        self->m_channel->close();
+        self->m_wrapper.reset();
+    }
+
+ public:
+    // Takes ownership of the reference to channel
+    Worker(JSContext* cx, JS::HandleObject wrapper, WorkerChannel* channel)
+        : m_channel(channel) {
+        m_channel->owner = this;
+        m_wrapper.root(cx, wrapper, &Worker::on_context_destroy, this);
+        m_thread = g_thread_new("cjs worker", worker_thread_main,
+                                m_channel->ref());
+    }
+
+    ~Worker() {
+        m_channel->owner = nullptr;
+        m_channel->close();
+        g_thread_join(m_thread);
+        m_channel->unref();
+    }
+
+    [[nodiscard]] bool running() const { return m_wrapper.rooted(); }
+
+    void terminate() { m_channel->close(); }
+
+    void post_message(WorkerMessage&& message) {
+        m_channel->post_to_worker(std::move(message), deliver_to_worker);
+    }
+
+    void deliver(std::deque<WorkerMessage>* messages) {
+        if (!running())
+            return;
+
+        GjsContextPrivate* gjs = GjsContextPrivate::from_current_context();
+        JSContext* cx = gjs->context();
+        JS::RootedObject wrapper(cx, m_wrapper);
+        JSAutoRealm ar(cx, wrapper);
+        for (WorkerMessage& message : *messages) {
+            if (!dispatch_message(cx, gjs, wrapper, &message))
+                gjs_log_exception(cx);
+        }
+    }
+
+    // The thread is done. Nothing else will arrive, so the Worker object need
+    // not be kept alive any longer.
+    void exited() {
+        std::deque<WorkerMessage> messages = m_channel->take_for_main();
+        deliver(&messages);
+        m_wrapper.reset();
+    }
+
+    // JS API
+
+    static const JSClass klass;
+
+    [[nodiscard]] static Worker* for_js(JSContext* cx,
+                                        const JS::CallArgs& args) {
+        JS::RootedObject obj(cx);
+        if (!args.computeThis(cx, &obj))
+            return nullptr;
+
+        JS::CallArgs args_copy = args;
+        auto* priv = static_cast<Worker*>(
+            JS_GetInstancePrivate(cx, obj, &klass, &args_copy));
+        if (!priv && !JS_IsExceptionPending(cx))
+            gjs_throw(cx, "Worker.prototype is not a Worker");
+        return priv;
+    }
+
+    // new Worker(uri_or_path)
+    GJS_JSAPI_RETURN_CONVENTION
+    static bool constructor(JSContext* cx, unsigned argc, JS::Value* vp) {
+        JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+        if (!args.isConstructing()) {
+            gjs_throw_constructor_error(cx);
+            return false;
+        }
+
+        JS::UniqueChars location;
+        if (!gjs_parse_call_args(cx, "Worker", args, "s", "location",
+                                 &location))
+            return false;
+
+        GjsAutoUnref<GFile> file =
+            g_file_new_for_commandline_arg(location.get());
+        char* source;
+        size_t source_len;
+        GError* error = nullptr;
+        if (!g_file_load_contents(file, nullptr, &source, &source_len, nullptr,
+                                  &error))
+            return gjs_throw_gerror_message(cx, error);
+
+        JS::RootedObject obj(cx, JS_NewObjectForConstructor(cx, &klass, args));
+        if (!obj) {
+            g_free(source);
+            return false;
+        }
+
+        auto* channel =
+            new WorkerChannel(g_file_get_uri(file), source, source_len);
+        JS_SetPrivate(obj, new Worker(cx, obj, channel));
+
+        args.rval().setObject(*obj);
+        return true;
+    }
+
+    static void finalize(JSFreeOp*, JSObject* obj) {
+        delete static_cast<Worker*>(JS_GetPrivate(obj));
+    }
+
+    // postMessage(value, [transfer])
+    GJS_JSAPI_RETURN_CONVENTION
+    static bool post_message_func(JSContext* cx, unsigned argc,
+                                  JS::Value* vp) {
+        JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+        Worker* priv = for_js(cx, args);
+        if (!priv)
+            return false;
+
+        WorkerMessage message;
+        if (!write_message(cx, args, &message))
+            return false;
+
+        // Messages to a worker that already stopped are dropped, as on the web
+        if (priv->running())
+            priv->post_message(std::move(message));
+        args.rval().setUndefined();
+        return true;
+    }
+
+    GJS_JSAPI_RETURN_CONVENTION
+    static bool terminate_func(JSContext* cx, unsigned argc, JS::Value* vp) {
+        JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+        Worker* priv = for_js(cx, args);
+        if (!priv)
+            return false;
+
+        priv->terminate();
+        args.rval().setUndefined();
+        return true;
+    }
+};
+
+static gboolean deliver_to_main(void* data) {
+    auto* channel = static_cast<WorkerChannel*>(data);
+    std::deque<WorkerMessage> messages = channel->take_for_main();
+    if (channel->owner)
+        channel->owner->deliver(&messages);
+    return G_SOURCE_REMOVE;
+}
+
+static gboolean deliver_exit_to_main(void* data) {
+    auto* channel = static_cast<WorkerChannel*>(data);
+    if (channel->owner)
+        channel->owner->exited();
+    return G_SOURCE_REMOVE;
+}
+
+static const JSClassOps worker_class_ops = {
+    nullptr,  // addProperty
+    nullptr,  // deleteProperty
+    nullptr,  // enumerate
+    nullptr,  // newEnumerate
+    nullptr,  // resolve
+    nullptr,  // mayResolve
+    &Worker::finalize,
+};
+
+const JSClass Worker::klass = {
+    "Worker",
+    JSCLASS_HAS_PRIVATE | JSCLASS_FOREGROUND_FINALIZE,
+    &worker_class_ops,
+};
+
+// clang-format off
+static const JSFunctionSpec worker_proto_funcs[] = {
+    JS_FN("postMessage", &Worker::post_message_func, 1, 0),
+    JS_FN("terminate", &Worker::terminate_func, 0, 0),
+    JS_FS_END};
+// clang-format on
+
+bool gjs_define_worker_stuff(JSContext* cx, JS::MutableHandleObject module) {
+    module.set(JS_NewPlainObject(cx));
+    if (!module)
+        return false;
+
+    return !!JS_InitClass(cx, module, nullptr, &Worker::klass,
+                          &Worker::constructor, 1, nullptr, worker_proto_funcs,
+                          nullptr, nullptr);
+}
@@ -0,0 +1,528 @@
+/* -*- mode: C++; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * SPDX-License-Identifier: MIT OR LGPL-2.0-or-later
+ */
+
+// Microbenchmarks for the cost of crossing between JS and C: calls into C
+// functions ("call/"), and signal connections and emissions ("signal/"). Each
+// benchmark is a snippet of JS that is run in a loop, as many times as fits in
+// the minimum time; the calls it makes go through the same paths as in any
+// other script. The "signal/c-" benchmarks emit from a loop in C instead, so
+// that only the cost of calling the JS handler is measured. The "gc/"
+// benchmarks create and drop wrappers, to measure GC pauses and the toggle
+// queue; every benchmark reports the GC activity during its timed run. The
+// "startup/" benchmarks are different, see StartupPhase.
+//
+// Run with `meson test --benchmark`, or directly with the same environment as
+// the tests, so that the Regress and GIMarshallingTests typelibs are found.
+
+#include <config.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>  // for strstr
+
+#include <algorithm>  // for sort
+#include <vector>
+
+#include <glib-object.h>
+#include <glib.h>
+
+#include <js/RootingAPI.h>
+#include <js/TypeDecls.h>
+#include <js/Utility.h>  // for UniqueChars
+#include <js/Value.h>
+#include <jsapi.h>  // for JS_GetProperty, JSAutoRealm
+
+#include "cjs/context.h"
+#include "cjs/jsapi-util.h"
+#include "test/gjs-bench-signal-object.h"
+
+struct Benchmark {
+    const char* name;
+    const char* setup;  // run once, before timing
+    const char* body;   // the loop body that is timed
+    // ...or timed in C instead of JS, for emissions from C
+    void (*native)(unsigned iterations);
+};
+
+#define BENCH_IMPORTS                                                   \
+    "var {GIMarshallingTests, Gio, GLib, GObject, Regress} = imports.gi;" \
+    "var System = imports.system;"                                     \
+    "var emitter = GObject.Object.newv("                               \
+    "    GObject.type_from_name('GjsBenchSignalObject'), []);"         \
+    "var handlerId = 0;"                                               \
+    "function connectOnly(signal, handler) {"                          \
+    "    if (handlerId)"                                               \
+    "        emitter.disconnect(handlerId);"                           \
+    "    handlerId = emitter.connect(signal, handler);"                \
+    "}"                                                                \
+    "function gcDelta(before) {"                                       \
+    "    const after = System.gcStats();"                              \
+    "    const delta = {"                                              \
+    "        majorCollections:"                                        \
+    "            after.majorCollections - before.majorCollections,"    \
+    "    };"                                                           \
+    "    for (const key of ['majorSlices', 'minorCollections',"        \
+    "        'toggles']) {"                                            \
+    "        delta[key] = {"                                           \
+    "            calls: after[key].calls - before[key].calls,"         \
+    "            time: after[key].time - before[key].time,"            \
+    "            histogram: after[key].histogram.map("                 \
+    "                (n, ix) => n - before[key].histogram[ix]),"       \
+    "        };"                                                       \
+    "    }"                                                            \
+    "    benchSummary = `${delta.majorSlices.calls} GC slices, "        \
+    "${delta.minorCollections.calls} nursery GCs, "                    \
+    "${delta.toggles.calls} queued toggles`;"                          \
+    "    benchReport = JSON.stringify(delta);"                         \
+    "}"                                                                \
+    "var gcBefore, benchReport, benchSummary;"
+
+// Benchmarks whose bodies allocate are also reported with the garbage
+// collections and toggles that happened during the timed run, including the
+// histograms of their pause times from System.gcStats().
+#define GC_SNAPSHOT "gcBefore = System.gcStats();"
+#define GC_REPORT "gcDelta(gcBefore);"
+
+template <unsigned N>
+static void emit_from_c(unsigned iterations) {
+    gjsbench_signal_object_emit(gjsbench_signal_object_peek(), N, iterations);
+}
+
+static void notify_from_c(unsigned iterations) {
+    GjsBenchSignalObject* emitter = gjsbench_signal_object_peek();
+    for (unsigned ix = 0; ix < iterations; ix++)
+        gjsbench_signal_object_set_value(emitter, ix + 1);
+}
+
+// Stand-in for a library referencing a JS-owned object from a worker thread,
+// which makes it toggle up through the toggle queue. Waits for each toggle to
+// be handled before the next one, so that every iteration queues one.
+static void* toggle_thread_func(void* data) {
+    auto* queues = static_cast<GAsyncQueue**>(data);
+    while (true) {
+        void* object = g_async_queue_pop(queues[0]);
+        if (object == queues)  // done
+            return nullptr;
+        g_object_unref(g_object_ref(object));
+        g_async_queue_push(queues[1], object);
+    }
+}
+
+static void toggle_from_thread(unsigned iterations) {
+    GAsyncQueue* queues[2] = {g_async_queue_new(), g_async_queue_new()};
+    GThread* thread = g_thread_new("toggle", toggle_thread_func, queues);
+    GObject* emitter = G_OBJECT(gjsbench_signal_object_peek());
+
+    for (unsigned ix = 0; ix < iterations; ix++) {
+        g_async_queue_push(queues[0], emitter);
+        g_async_queue_pop(queues[1]);
+        while (g_main_context_iteration(nullptr, /* may_block = */ false)) {
+        }
+    }
+
+    g_async_queue_push(queues[0], queues);
+    g_thread_join(thread);
+    g_async_queue_unref(queues[0]);
+    g_async_queue_unref(queues[1]);
+}
+
+// clang-format off
+static const Benchmark call_benchmarks[] = {
+    {"call/void", nullptr,
+     "Regress.test_versioning();", nullptr},
+    {"call/int-in-return", nullptr,
+     "Regress.test_int(42);", nullptr},
+    {"call/int-out", nullptr,
+     "GIMarshallingTests.int32_out();", nullptr},
+    {"call/double-in-return", nullptr,
+     "Regress.test_double(42.5);", nullptr},
+    {"call/utf8-in", nullptr,
+     "Regress.test_utf8_const_in('const ♥ utf8');", nullptr},
+    {"call/utf8-return", nullptr,
+     "Regress.test_utf8_const_return();", nullptr},
+    {"call/utf8-out", nullptr,
+     "Regress.test_utf8_out();", nullptr},
+    {"call/gobject-in", "var obj = new Regress.TestObj();",
+     "Regress.func_obj_null_in(obj);", nullptr},
+    {"call/gobject-method", "var obj = new Regress.TestObj();",
+     "obj.instance_method();", nullptr},
+    {"call/gobject-return", nullptr,
+     "GIMarshallingTests.Object.none_return();", nullptr},
+    {"call/boxed-return", nullptr,
+     "GIMarshallingTests.boxed_struct_returnv();", nullptr},
+    {"call/c-array-in", "var array = [-1, 0, 1, 2];",
+     "GIMarshallingTests.array_in(array);", nullptr},
+    {"call/c-array-return", nullptr,
+     "GIMarshallingTests.array_return();", nullptr},
+    {"call/callback", "var callback = () => 42;",
+     "Regress.test_callback(callback);", nullptr},
+    {"call/gerror-throw", nullptr,
+     "try { GIMarshallingTests.gerror(); } catch (e) {}", nullptr},
+};
+
+// Handlers take no parameters; closure_marshal() converts the signal's
+// parameters to JS either way
+#define CONNECT_NOOP(signal) "connectOnly('" signal "', () => {});"
+
+static const Benchmark signal_benchmarks[] = {
+    {"signal/connect-disconnect", "var handler = () => {};",
+     "emitter.disconnect(emitter.connect('signal-0', handler));", nullptr},
+    {"signal/connect-detailed-disconnect", "var handler = () => {};",
+     "emitter.disconnect(emitter.connect('signal-0::detail', handler));",
+     nullptr},
+    {"signal/emit-0", CONNECT_NOOP("signal-0"),
+     "emitter.emit('signal-0');", nullptr},
+    {"signal/emit-1", CONNECT_NOOP("signal-1"),
+     "emitter.emit('signal-1', 1);", nullptr},
+    {"signal/emit-2", CONNECT_NOOP("signal-2"),
+     "emitter.emit('signal-2', 1, 2);", nullptr},
+    {"signal/emit-3", CONNECT_NOOP("signal-3"),
+     "emitter.emit('signal-3', 1, 2, 3);", nullptr},
+    {"signal/emit-4", CONNECT_NOOP("signal-4"),
+     "emitter.emit('signal-4', 1, 2, 3, 4);", nullptr},
+    {"signal/emit-5", CONNECT_NOOP("signal-5"),
+     "emitter.emit('signal-5', 1, 2, 3, 4, 5);", nullptr},
+    {"signal/emit-6", CONNECT_NOOP("signal-6"),
+     "emitter.emit('signal-6', 1, 2, 3, 4, 5, 6);", nullptr},
+    {"signal/emit-detailed", CONNECT_NOOP("signal-0::detail"),
+     "emitter.emit('signal-0::detail');", nullptr},
+    {"signal/notify-from-js", CONNECT_NOOP("notify::value"),
+     "emitter.value = i + 1;", nullptr},
+    {"signal/c-emit-0", CONNECT_NOOP("signal-0"), nullptr, emit_from_c<0>},
+    {"signal/c-emit-1", CONNECT_NOOP("signal-1"), nullptr, emit_from_c<1>},
+    {"signal/c-emit-2", CONNECT_NOOP("signal-2"), nullptr, emit_from_c<2>},
+    {"signal/c-emit-3", CONNECT_NOOP("signal-3"), nullptr, emit_from_c<3>},
+    {"signal/c-emit-4", CONNECT_NOOP("signal-4"), nullptr, emit_from_c<4>},
+    {"signal/c-emit-5", CONNECT_NOOP("signal-5"), nullptr, emit_from_c<5>},
+    {"signal/c-emit-6", CONNECT_NOOP("signal-6"), nullptr, emit_from_c<6>},
+    {"signal/c-emit-detailed", CONNECT_NOOP("signal-0::detail"), nullptr,
+     emit_from_c<0>},
+    {"signal/c-notify", CONNECT_NOOP("notify::value"), nullptr, notify_from_c},
+};
+
+// The emitter is given a toggle ref once a GC has run
+static const Benchmark gc_benchmarks[] = {
+    {"gc/gobject-wrappers", nullptr,
+     "new GObject.Object();", nullptr},
+    {"gc/boxed-wrappers", nullptr,
+     "new GIMarshallingTests.BoxedStruct();", nullptr},
+    {"gc/fundamental-wrappers", nullptr,
+     "new Regress.TestFundamentalSubObject('data');", nullptr},
+    {"gc/closures", nullptr,
+     "emitter.disconnect(emitter.connect('signal-0', () => {}));", nullptr},
+    {"gc/toggle-from-js",
+     "var store = new Gio.ListStore(); var obj = new GObject.Object();"
+     "System.gc();",
+     "store.append(obj); store.remove(0);", nullptr},
+    {"gc/toggle-from-thread", "System.gc();", nullptr, toggle_from_thread},
+};
+// clang-format on
+
+static int min_time_ms = 200;
+static int startup_runs = 20;
+static bool json_output = false;
+static bool startup_child = false;
+
+static GOptionEntry entries[] = {
+    {"min-time", 't', 0, G_OPTION_ARG_INT, &min_time_ms,
+     "Run each benchmark for at least MS milliseconds (default 200)", "MS"},
+    {"startup-runs", 0, 0, G_OPTION_ARG_INT, &startup_runs,
+     "Start N processes for the startup benchmarks (default 20)", "N"},
+    {"json", 0, 0, G_OPTION_ARG_NONE, &json_output,
+     "Print the results as JSON"},
+    {"startup-child", 0, G_OPTION_FLAG_HIDDEN, G_OPTION_ARG_NONE,
+     &startup_child, nullptr},
+    {nullptr}};
+
+// The startup benchmarks time each phase of starting up in a fresh process,
+// since most of what they measure is only done once per process. Creating the
+// context includes evaluating _bootstrap/default.js. Gtk is imported without
+// initializing it, so no display is needed, but only if the GTK tests are
+// enabled.
+struct StartupPhase {
+    const char* name;
+    const char* script;  // nullptr for the phases timed in C
+    bool needs_gtk;
+};
+
+// clang-format off
+static const StartupPhase startup_phases[] = {
+    {"startup/process", nullptr, false},  // timed by the parent
+    {"startup/context", nullptr, false},
+    {"startup/first-eval", "void 0;", false},
+    {"startup/import-GLib", "imports.gi.GLib;", false},
+    {"startup/import-GObject", "imports.gi.GObject;", false},
+    {"startup/import-Gio", "imports.gi.Gio;", false},
+    {"startup/import-Gtk",
+     "imports.gi.versions.Gtk = '3.0'; imports.gi.Gtk;", true},
+};
+// clang-format on
+
+[[nodiscard]] static bool gtk_enabled() {
+    return g_strcmp0(g_getenv("ENABLE_GTK"), "yes") == 0;
+}
+
+[[nodiscard]] static bool eval_or_warn(GjsContext* context, const char* name,
+                                       const char* script) {
+    GError* error = nullptr;
+    int status;
+    if (!gjs_context_eval(context, script, -1, name, &status, &error)) {
+        g_printerr("%s: %s\n", name, error ? error->message : "failed");
+        g_clear_error(&error);
+        return false;
+    }
+    return true;
+}
+
+// Returns the time in µs that @iterations of @bench took
+[[nodiscard]] static bool time_iterations(GjsContext* context,
+                                          const Benchmark& bench,
+                                          unsigned iterations,
+                                          int64_t* elapsed) {
+    if (bench.native) {
+        int64_t start = g_get_monotonic_time();
+        bench.native(iterations);
+        *elapsed = g_get_monotonic_time() - start;
+        return true;
+    }
+
+    GjsAutoChar loop =
+        g_strdup_printf("for (let i = 0; i < %u; i++) {\n%s\n}", iterations,
+                        bench.body);
+
+    int64_t start = g_get_monotonic_time();
+    if (!eval_or_warn(context, bench.name, loop))
+        return false;
+    *elapsed = g_get_monotonic_time() - start;
+    return true;
+}
+
+[[nodiscard]] static bool run_benchmark(GjsContext* context,
+                                        const Benchmark& bench,
+                                        unsigned* iterations_out,
+                                        double* ns_per_call) {
+    if (bench.setup && !eval_or_warn(context, bench.name, bench.setup))
+        return false;
+
+    // Warm up the JIT and any caches first, so the first sample isn't an
+    // outlier
+    int64_t elapsed;
+    if (!time_iterations(context, bench, 100, &elapsed))
+        return false;
+
+    unsigned iterations = 1000;
+    int64_t min_time_us = min_time_ms * int64_t(1000);
+    while (true) {
+        if (!eval_or_warn(context, bench.name, GC_SNAPSHOT) ||
+            !time_iterations(context, bench, iterations, &elapsed) ||
+            !eval_or_warn(context, bench.name, GC_REPORT))
+            return false;
+        if (elapsed >= min_time_us || iterations >= G_MAXUINT / 2)
+            break;
+        iterations *= 2;
+    }
+
+    *iterations_out = iterations;
+    *ns_per_call = elapsed * 1000.0 / iterations;
+    return true;
+}
+
+[[nodiscard]] static bool matches_filters(const char* name, char** filters) {
+    if (!filters || !filters[0])
+        return true;
+    for (char** filter = filters; *filter; filter++) {
+        if (strstr(name, *filter))
+            return true;
+    }
+    return false;
+}
+
+// Prints "phase µs" lines for the parent to read
+static int run_startup_child() {
+    int64_t start = g_get_monotonic_time();
+    GjsAutoUnref<GjsContext> context = gjs_context_new();
+    printf("startup/context %" G_GINT64_FORMAT "\n",
+           g_get_monotonic_time() - start);
+
+    for (const StartupPhase& phase : startup_phases) {
+        if (!phase.script || (phase.needs_gtk && !gtk_enabled()))
+            continue;
+
+        start = g_get_monotonic_time();
+        if (!eval_or_warn(context, phase.name, phase.script))
+            return 1;
+        printf("%s %" G_GINT64_FORMAT "\n", phase.name,
+               g_get_monotonic_time() - start);
+    }
+    return 0;
+}
+
+// Nearest-rank percentile of sorted @samples
+[[nodiscard]] static int64_t percentile(const std::vector<int64_t>& samples,
+                                        unsigned pct) {
+    size_t rank = (samples.size() * pct + 99) / 100;
+    return samples[rank > 0 ? rank - 1 : 0];
+}
+
+[[nodiscard]] static bool run_startup_benchmarks(const char* program,
+                                                 char** filters, bool* first) {
+    constexpr size_t n_phases = G_N_ELEMENTS(startup_phases);
+    std::vector<int64_t> samples[n_phases];
+    bool any = false;
+    for (const StartupPhase& phase : startup_phases)
+        any = any || matches_filters(phase.name, filters);
+    if (!any)
+        return true;
+
+    const char* child_argv[] = {program, "--startup-child", nullptr};
+    for (int run = 0; run < startup_runs; run++) {
+        GError* error = nullptr;
+        char* child_stdout;
+        int wait_status;
+        int64_t start = g_get_monotonic_time();
+        if (!g_spawn_sync(nullptr, const_cast<char**>(child_argv), nullptr,
+                          G_SPAWN_DEFAULT, nullptr, nullptr, &child_stdout,
+                          nullptr, &wait_status, &error) ||
+            !g_spawn_check_exit_status(wait_status, &error)) {
+            g_printerr("startup: %s\n", error->message);
+            g_clear_error(&error);
+            return false;
+        }
+        samples[0].push_back(g_get_monotonic_time() - start);
+
+        GjsAutoChar output = child_stdout;
+        GjsAutoStrv lines = g_strsplit(output, "\n", -1);
+        for (char** line = lines; *line; line++) {
+            GjsAutoStrv fields = g_strsplit(*line, " ", 2);
+            if (!fields[0] || !fields[1])
+                continue;
+            for (size_t ix = 0; ix < n_phases; ix++) {
+                if (strcmp(fields[0], startup_phases[ix].name) == 0)
+                    samples[ix].push_back(g_ascii_strtoll(fields[1], nullptr,
+                                                          10));
+            }
+        }
+    }
+
+    for (size_t ix = 0; ix < n_phases; ix++) {
+        const char* name = startup_phases[ix].name;
+        if (samples[ix].empty() || !matches_filters(name, filters))
+            continue;
+
+        std::sort(samples[ix].begin(), samples[ix].end());
+        int64_t p50 = percentile(samples[ix], 50);
+        int64_t p95 = percentile(samples[ix], 95);
+        if (json_output) {
+            printf("%s\n  {\"name\": \"%s\", \"runs\": %zu, "
+                   "\"p50_us\": %" G_GINT64_FORMAT
+                   ", \"p95_us\": %" G_GINT64_FORMAT "}",
+                   *first ? "" : ",", name, samples[ix].size(), p50, p95);
+        } else {
+            printf("%-34s p50 %10" G_GINT64_FORMAT " µs  p95 %10" G_GINT64_FORMAT
+                   " µs\n",
+                   name, p50, p95);
+        }
+        fflush(stdout);
+        *first = false;
+    }
+    return true;
+}
+
+// Returns the string value of the global variable @name, as set by GC_REPORT
+[[nodiscard]] static GjsAutoChar get_global_string(GjsContext* context,
+                                                   const char* name) {
+    auto* cx = static_cast<JSContext*>(gjs_context_get_native_context(context));
+    JS::RootedObject global(cx, gjs_get_import_global(cx));
+    JSAutoRealm ar(cx, global);
+
+    JS::RootedValue value(cx);
+    if (!JS_GetProperty(cx, global, name, &value) || !value.isString()) {
+        JS_ClearPendingException(cx);
+        return nullptr;
+    }
+
+    JS::UniqueChars chars = gjs_string_to_utf8(cx, value);
+    if (!chars) {
+        JS_ClearPendingException(cx);
+        return nullptr;
+    }
+    return g_strdup(chars.get());
+}
+
+int main(int argc, char** argv) {
+    GError* error = nullptr;
+    GOptionContext* option_context = g_option_context_new(
+        "[FILTER...] - benchmark calls, signals, GC, and startup");
+    g_option_context_add_main_entries(option_context, entries, nullptr);
+    if (!g_option_context_parse(option_context, &argc, &argv, &error)) {
+        g_printerr("%s\n", error->message);
+        g_clear_error(&error);
+        g_option_context_free(option_context);
+        return 2;
+    }
+    g_option_context_free(option_context);
+    char** filters = argv + 1;  // remaining arguments
+
+    if (startup_child)
+        return run_startup_child();
+
+    g_type_class_ref(GJSBENCH_TYPE_SIGNAL_OBJECT);
+
+    GjsAutoUnref<GjsContext> context = gjs_context_new();
+    if (!eval_or_warn(context, "<imports>", BENCH_IMPORTS))
+        return 1;
+
+    bool failed = false;
+    bool first = true;
+    if (json_output)
+        printf("{\"benchmarks\": [");
+
+    std::vector<const Benchmark*> benchmarks;
+    for (const Benchmark& bench : call_benchmarks)
+        benchmarks.push_back(&bench);
+    for (const Benchmark& bench : signal_benchmarks)
+        benchmarks.push_back(&bench);
+    for (const Benchmark& bench : gc_benchmarks)
+        benchmarks.push_back(&bench);
+
+    for (const Benchmark* bench_p : benchmarks) {
+        const Benchmark& bench = *bench_p;
+        if (!matches_filters(bench.name, filters))
+            continue;
+
+        unsigned iterations;
+        double ns_per_call;
+        if (!run_benchmark(context, bench, &iterations, &ns_per_call)) {
+            failed = true;
+            continue;
+        }
+
+        if (json_output) {
+            GjsAutoChar gc_report = get_global_string(context, "benchReport");
+            printf(
+                "%s\n  {\"name\": \"%s\", \"iterations\": %u, "
+                "\"ns_per_call\": %.1f, \"calls_per_second\": %.0f, "
+                "\"gc\": %s}",
+                first ? "" : ",", bench.name, iterations, ns_per_call,
+                1e9 / ns_per_call, gc_report ? gc_report.get() : "null");
+        } else {
+            GjsAutoChar gc_summary =
+                get_global_string(context, "benchSummary");
+            printf("%-34s %14.0f calls/s %10.1f ns/call   %s\n", bench.name,
+                   1e9 / ns_per_call, ns_per_call,
+                   gc_summary ? gc_summary.get() : "");
+        }
+        fflush(stdout);
+        first = false;
+    }
+
+    if (!run_startup_benchmarks(argv[0], filters, &first))
+        failed = true;
+
+    if (json_output)
+        printf("\n]}\n");
+
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,109 @@
+/* -*- mode: C++; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * SPDX-License-Identifier: MIT OR LGPL-2.0-or-later
+ */
+
+#include <config.h>
+
+#include <glib-object.h>
+#include <glib.h>
+
+#include "test/gjs-bench-signal-object.h"
+
+struct _GjsBenchSignalObject {
+    GObject parent_instance;
+
+    int value;
+};
+
+G_DEFINE_TYPE(GjsBenchSignalObject, gjsbench_signal_object, G_TYPE_OBJECT)
+
+enum { PROP_0, PROP_VALUE, N_PROPS };
+
+static GParamSpec* props[N_PROPS];
+static unsigned signals[GJSBENCH_SIGNAL_OBJECT_MAX_PARAMS + 1];
+
+static GjsBenchSignalObject* last_object = NULL;
+
+static void gjsbench_signal_object_init(GjsBenchSignalObject* self) {
+    self->value = 0;
+    last_object = self;
+}
+
+static void gjsbench_signal_object_set_property(GObject* object,
+                                                unsigned prop_id,
+                                                const GValue* value,
+                                                GParamSpec* pspec) {
+    GjsBenchSignalObject* self = GJSBENCH_SIGNAL_OBJECT(object);
+
+    switch (prop_id) {
+        case PROP_VALUE:
+            self->value = g_value_get_int(value);
+            break;
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+            break;
+    }
+}
+
+static void gjsbench_signal_object_get_property(GObject* object,
+                                                unsigned prop_id,
+                                                GValue* value,
+                                                GParamSpec* pspec) {
+    GjsBenchSignalObject* self = GJSBENCH_SIGNAL_OBJECT(object);
+
+    switch (prop_id) {
+        case PROP_VALUE:
+            g_value_set_int(value, self->value);
+            break;
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+            break;
+    }
+}
+
+static void gjsbench_signal_object_class_init(
+    GjsBenchSignalObjectClass* klass) {
+    GObjectClass* object_class = G_OBJECT_CLASS(klass);
+
+    object_class->set_property = gjsbench_signal_object_set_property;
+    object_class->get_property = gjsbench_signal_object_get_property;
+
+    props[PROP_VALUE] =
+        g_param_spec_int("value", "Value", "An integer property", G_MININT,
+                         G_MAXINT, 0, G_PARAM_READWRITE);
+    g_object_class_install_properties(object_class, N_PROPS, props);
+
+    GType param_types[GJSBENCH_SIGNAL_OBJECT_MAX_PARAMS];
+    for (unsigned ix = 0; ix < G_N_ELEMENTS(param_types); ix++)
+        param_types[ix] = G_TYPE_INT;
+
+    for (unsigned n_params = 0; n_params <= GJSBENCH_SIGNAL_OBJECT_MAX_PARAMS;
+         n_params++) {
+        char* name = g_strdup_printf("signal-%u", n_params);
+        signals[n_params] = g_signal_newv(
+            name, G_TYPE_FROM_CLASS(klass),
+            GSignalFlags(G_SIGNAL_RUN_LAST | G_SIGNAL_DETAILED), nullptr,
+            nullptr, nullptr, nullptr, G_TYPE_NONE, n_params, param_types);
+        g_free(name);
+    }
+}
+
+GjsBenchSignalObject* gjsbench_signal_object_peek() { return last_object; }
+
+// Emits "signal-@n_params" @times times from C, with the parameters 1, 2, ...
+void gjsbench_signal_object_emit(GjsBenchSignalObject* self, unsigned n_params,
+                                 unsigned times) {
+    g_return_if_fail(n_params <= GJSBENCH_SIGNAL_OBJECT_MAX_PARAMS);
+
+    // g_signal_emit() only collects as many arguments as the signal has
+    for (unsigned ix = 0; ix < times; ix++)
+        g_signal_emit(self, signals[n_params], 0, 1, 2, 3, 4, 5, 6);
+}
+
+void gjsbench_signal_object_set_value(GjsBenchSignalObject* self, int value) {
+    if (self->value == value)
+        return;
+    self->value = value;
+    g_object_notify_by_pspec(G_OBJECT(self), props[PROP_VALUE]);
+}
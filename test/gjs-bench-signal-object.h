@@ -0,0 +1,26 @@
+/* -*- mode: C++; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * SPDX-License-Identifier: MIT OR LGPL-2.0-or-later
+ */
+
+#ifndef TEST_GJS_BENCH_SIGNAL_OBJECT_H_
+#define TEST_GJS_BENCH_SIGNAL_OBJECT_H_
+
+#include <glib-object.h>
+
+// An object without introspection data, with one signal for each number of
+// int parameters from 0 to GJSBENCH_SIGNAL_OBJECT_MAX_PARAMS ("signal-0" to
+// "signal-6", all detailed) and one int property "value"
+#define GJSBENCH_SIGNAL_OBJECT_MAX_PARAMS 6
+
+#define GJSBENCH_TYPE_SIGNAL_OBJECT gjsbench_signal_object_get_type()
+G_DECLARE_FINAL_TYPE(GjsBenchSignalObject, gjsbench_signal_object, GJSBENCH,
+                     SIGNAL_OBJECT, GObject)
+
+GjsBenchSignalObject* gjsbench_signal_object_peek();
+
+void gjsbench_signal_object_emit(GjsBenchSignalObject* self, unsigned n_params,
+                                 unsigned times);
+void gjsbench_signal_object_set_value(GjsBenchSignalObject* self, int value);
+
+#endif  // TEST_GJS_BENCH_SIGNAL_OBJECT_H_
@@ -54,6 +54,13 @@ typedef enum _test_signed_enum {
     MINUS_ONE
 } test_signed_enum_t;
 
+// Format strings are summarized at compile time
+static_assert(parse_call_args_format("!i|?s").ignore_trailing_args);
+static_assert(parse_call_args_format("!i|?s").n_required == 1);
+static_assert(parse_call_args_format("!i|?s").n_total == 2);
+static_assert(parse_call_args_format("ff").n_required == 2);
+static_assert(!parse_call_args_format("ff").optional);
+
 #define JSNATIVE_TEST_FUNC_BEGIN(name)                      \
     static bool                                             \
     name(JSContext *cx,                                     \
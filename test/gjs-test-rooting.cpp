@@ -1,5 +1,9 @@
 #include <config.h>
 
+#include <stddef.h>  // for size_t
+
+#include <vector>
+
 #include <glib.h>
 
 #include <js/Class.h>
@@ -220,6 +224,98 @@ static void test_maybe_owned_switch_to_unrooted_allows_collection(
     delete obj;
 }
 
+static void test_maybe_owned_rooted_slots_are_reused(GjsRootingFixture* fx,
+                                                     const void*) {
+    // Root enough objects to need more than one chunk of root slots, then
+    // release some of them and check that the remaining ones and the reused
+    // slots still keep their things alive
+    std::vector<GjsMaybeOwned<JSObject*>*> objs;
+    for (size_t ix = 0; ix < 300; ix++) {
+        auto* obj = new GjsMaybeOwned<JSObject*>();
+        obj->root(PARENT(fx)->cx, JS_NewPlainObject(PARENT(fx)->cx));
+        objs.push_back(obj);
+    }
+    for (size_t ix = 0; ix < objs.size(); ix += 2)
+        objs[ix]->reset();
+
+    auto* test_obj = new GjsMaybeOwned<JSObject*>();
+    test_obj->root(PARENT(fx)->cx, test_obj_new(fx));
+
+    wait_for_gc(fx);
+    g_assert_false(fx->finalized);
+    for (GjsMaybeOwned<JSObject*>* obj : objs) {
+        g_assert_true(obj->rooted() == (*obj != nullptr));
+        delete obj;
+    }
+
+    delete test_obj;
+    wait_for_gc(fx);
+    g_assert_true(fx->finalized);
+}
+
+static void test_maybe_owned_rooted_during_incremental_gc(
+    GjsRootingFixture* fx, const void*) {
+    // Root and release things while an incremental GC is in progress, so that
+    // chunks of root slots are traced both before and after they change
+    JSContext* cx = PARENT(fx)->cx;
+    std::vector<GjsMaybeOwned<JSObject*>*> objs;
+    JS::RootedObject test_obj(cx, test_obj_new(fx));
+
+    JS::PrepareForFullGC(cx);
+    JS::StartIncrementalGC(cx, GC_NORMAL, JS::GCReason::API, 1);
+    for (size_t ix = 0; ix < 300; ix++) {
+        auto* obj = new GjsMaybeOwned<JSObject*>();
+        obj->root(cx, JS_NewPlainObject(cx));
+        objs.push_back(obj);
+        if (ix % 50 == 0 && JS::IsIncrementalGCInProgress(cx))
+            JS::IncrementalGCSlice(cx, JS::GCReason::API, 1);
+    }
+
+    auto* rooted_obj = new GjsMaybeOwned<JSObject*>();
+    rooted_obj->root(cx, test_obj);
+    test_obj = nullptr;
+    for (GjsMaybeOwned<JSObject*>* obj : objs)
+        delete obj;
+
+    if (JS::IsIncrementalGCInProgress(cx))
+        JS::FinishIncrementalGC(cx, JS::GCReason::API);
+    wait_for_gc(fx);
+    g_assert_false(fx->finalized);
+
+    delete rooted_obj;
+    wait_for_gc(fx);
+    g_assert_true(fx->finalized);
+}
+
+static void test_maybe_owned_rooted_survives_compacting_gc(
+    GjsRootingFixture* fx, const void*) {
+    // Free every other object, so that a shrinking GC has fragmented arenas to
+    // compact, and check that the rooted objects that were moved are still
+    // found through their slots
+    JSContext* cx = PARENT(fx)->cx;
+    std::vector<GjsMaybeOwned<JSObject*>*> objs;
+    for (size_t ix = 0; ix < 1000; ix++) {
+        JS::RootedObject plain(cx, JS_NewPlainObject(cx));
+        g_assert_true(JS_DefineProperty(cx, plain, "ix", int32_t(ix), 0));
+        auto* obj = new GjsMaybeOwned<JSObject*>();
+        obj->root(cx, plain);
+        objs.push_back(obj);
+    }
+    for (size_t ix = 0; ix < objs.size(); ix += 2)
+        objs[ix]->reset();
+
+    JS::PrepareForFullGC(cx);
+    JS::NonIncrementalGC(cx, GC_SHRINK, JS::GCReason::API);
+
+    for (size_t ix = 1; ix < objs.size(); ix += 2) {
+        JS::RootedValue value(cx);
+        g_assert_true(JS_GetProperty(cx, objs[ix]->handle(), "ix", &value));
+        g_assert_cmpint(value.toInt32(), ==, ix);
+    }
+    for (GjsMaybeOwned<JSObject*>* obj : objs)
+        delete obj;
+}
+
 static void context_destroyed(JS::HandleObject, void* data) {
     auto fx = static_cast<GjsRootingFixture *>(data);
     g_assert_false(fx->notify_called);
@@ -273,6 +369,12 @@ gjs_test_add_tests_for_rooting(void)
                      test_maybe_owned_switch_to_rooted_prevents_collection);
     ADD_ROOTING_TEST("maybe-owned/switch-to-unrooted-allows-collection",
                      test_maybe_owned_switch_to_unrooted_allows_collection);
+    ADD_ROOTING_TEST("maybe-owned/rooted-slots-are-reused",
+                     test_maybe_owned_rooted_slots_are_reused);
+    ADD_ROOTING_TEST("maybe-owned/rooted-during-incremental-gc",
+                     test_maybe_owned_rooted_during_incremental_gc);
+    ADD_ROOTING_TEST("maybe-owned/rooted-survives-compacting-gc",
+                     test_maybe_owned_rooted_survives_compacting_gc);
 
 #undef ADD_ROOTING_TEST
 
@@ -27,10 +27,17 @@
 #include <string.h>  // for size_t, strlen
 
 #include <string>  // for u16string, u32string
+#include <vector>
 
+#include <gio/gio.h>
 #include <glib-object.h>
 #include <glib.h>
-#include <glib/gstdio.h>  // for g_unlink
+#include <glib/gstdio.h>  // for g_mkdir, g_rmdir, g_unlink
+
+#ifdef G_OS_UNIX
+#    include <sys/socket.h>  // for AF_UNIX
+#    include <sys/un.h>      // for sockaddr_un
+#endif
 
 #include <js/Array.h>
 #include <js/CharacterEncoding.h>
@@ -43,10 +50,13 @@
 #include <jspubtd.h>  // for JSProto_Number
 
 #include "gi/arg-inl.h"
+#include "cjs/cache-budget.h"
+#include "cjs/context-private.h"
 #include "cjs/context.h"
 #include "cjs/error-types.h"
 #include "cjs/jsapi-util.h"
 #include "cjs/profiler.h"
+#include "cjs/slab-allocator.h"
 #include "test/gjs-test-no-introspection-object.h"
 #include "test/gjs-test-utils.h"
 #include "util/misc.h"
@@ -125,6 +135,218 @@ gjstest_test_func_gjs_context_exit(void)
     g_object_unref(context);
 }
 
+static void gjstest_test_func_gjs_context_compile_run(void) {
+    GjsAutoUnref<GjsContext> gjs = gjs_context_new();
+    GError* error = NULL;
+    int status;
+
+    // Each run gets a new scope, but the global object is shared
+    GjsScript* script = gjs_context_compile(
+        gjs, "var runs = (globalThis.runs || 0) + 1; globalThis.runs = runs;",
+        -1, "<input>", &error);
+    g_assert_no_error(error);
+    g_assert_nonnull(script);
+
+    for (int expected = 1; expected <= 3; expected++) {
+        bool ok = gjs_script_run(script, &status, &error);
+        g_assert_true(ok);
+        g_assert_no_error(error);
+        g_assert_cmpint(status, ==, expected);
+    }
+    gjs_script_unref(script);
+
+    g_test_expect_message("Cjs", G_LOG_LEVEL_CRITICAL, "*SyntaxError*");
+    script = gjs_context_compile(gjs, "1 +", -1, "<input>", &error);
+    g_test_assert_expected_messages();
+    g_assert_null(script);
+    g_assert_error(error, GJS_ERROR, GJS_ERROR_FAILED);
+    g_clear_error(&error);
+}
+
+static void gjstest_test_func_gjs_context_eval_module_file(void) {
+    GjsAutoChar dir = g_dir_make_tmp("gjs-test-module-XXXXXX", nullptr);
+    GjsAutoChar lib_dir = g_build_filename(dir, "lib", nullptr);
+    GjsAutoChar main_path = g_build_filename(dir, "main.js", nullptr);
+    GjsAutoChar lib_path = g_build_filename(lib_dir, "lib.js", nullptr);
+    GjsAutoChar broken_path = g_build_filename(dir, "broken.js", nullptr);
+    g_assert_cmpint(g_mkdir(lib_dir, 0755), ==, 0);
+    g_assert_true(g_file_set_contents(
+        main_path,
+        "import {value} from './lib/lib.js';\n"
+        "import GLib from 'gi://GLib?version=2.0';\n"
+        "import system from 'system';\n"
+        "globalThis.moduleResult = value +\n"
+        "    (typeof GLib.get_user_name === 'function') +\n"
+        "    (typeof system.exit === 'function') +\n"
+        "    import.meta.url.endsWith('/main.js');\n",
+        -1, nullptr));
+    g_assert_true(g_file_set_contents(lib_path, "export const value = 38;\n",
+                                      -1, nullptr));
+    g_assert_true(g_file_set_contents(
+        broken_path, "import {value} from './missing.js';\n", -1, nullptr));
+
+    GjsAutoUnref<GjsContext> gjs = gjs_context_new();
+    GError* error = nullptr;
+    int status;
+
+    bool ok = gjs_context_eval_module_file(gjs, main_path, &status, &error);
+    g_assert_no_error(error);
+    g_assert_true(ok);
+    g_assert_cmpint(status, ==, 0);
+
+    ok = gjs_context_eval(gjs, "moduleResult", -1, "<input>", &status, &error);
+    g_assert_no_error(error);
+    g_assert_true(ok);
+    g_assert_cmpint(status, ==, 41);
+
+    g_test_expect_message("Cjs", G_LOG_LEVEL_CRITICAL, "*ImportError*");
+    ok = gjs_context_eval_module_file(gjs, broken_path, &status, &error);
+    g_test_assert_expected_messages();
+    g_assert_false(ok);
+    g_assert_error(error, GJS_ERROR, GJS_ERROR_FAILED);
+    g_clear_error(&error);
+
+    g_unlink(broken_path);
+    g_unlink(lib_path);
+    g_unlink(main_path);
+    g_rmdir(lib_dir);
+    g_rmdir(dir);
+}
+
+// Writes a module graph for the dynamic import tests: main.js, which imports
+// lib/lib.js and exports 42 as its default, and broken.js, which imports a
+// module that doesn't exist
+static void write_dynamic_import_modules(const char* dir) {
+    GjsAutoChar lib_dir = g_build_filename(dir, "lib", nullptr);
+    GjsAutoChar main_path = g_build_filename(dir, "main.js", nullptr);
+    GjsAutoChar lib_path = g_build_filename(lib_dir, "lib.js", nullptr);
+    GjsAutoChar broken_path = g_build_filename(dir, "broken.js", nullptr);
+    g_assert_cmpint(g_mkdir(lib_dir, 0755), ==, 0);
+    g_assert_true(g_file_set_contents(
+        main_path,
+        "import {value} from './lib/lib.js';\n"
+        "export default value + 1;\n",
+        -1, nullptr));
+    g_assert_true(g_file_set_contents(lib_path, "export const value = 41;\n",
+                                      -1, nullptr));
+    g_assert_true(g_file_set_contents(
+        broken_path, "import {value} from './missing.js';\n", -1, nullptr));
+}
+
+static void remove_dynamic_import_modules(const char* dir) {
+    GjsAutoChar lib_dir = g_build_filename(dir, "lib", nullptr);
+    GjsAutoChar lib_path = g_build_filename(lib_dir, "lib.js", nullptr);
+    for (const char* name : {"main.js", "broken.js"}) {
+        GjsAutoChar path = g_build_filename(dir, name, nullptr);
+        g_unlink(path);
+    }
+    g_unlink(lib_path);
+    g_rmdir(lib_dir);
+    g_rmdir(dir);
+}
+
+static void gjstest_test_func_gjs_context_dynamic_import(void) {
+    GjsAutoChar dir = g_dir_make_tmp("gjs-test-import-XXXXXX", nullptr);
+    write_dynamic_import_modules(dir);
+    GjsAutoChar main_path = g_build_filename(dir, "main.js", nullptr);
+    GjsAutoChar broken_path = g_build_filename(dir, "broken.js", nullptr);
+    GjsAutoChar main_uri = g_filename_to_uri(main_path, nullptr, nullptr);
+    GjsAutoChar broken_uri = g_filename_to_uri(broken_path, nullptr, nullptr);
+
+    GjsAutoUnref<GjsContext> gjs = gjs_context_new();
+    GError* error = nullptr;
+    int status;
+
+    GjsAutoChar script = g_strdup_printf(
+        "globalThis.importResult = 0;\n"
+        "(async function () {\n"
+        "    importResult += (await import('%s')).default === 42 ? 1 : 0;\n"
+        "    try {\n"
+        "        await import('%s');\n"
+        "    } catch (e) {\n"
+        "        importResult += 2;\n"
+        "    }\n"
+        "})();\n",
+        main_uri.get(), broken_uri.get());
+    bool ok = gjs_context_eval(gjs, script, -1, "<input>", &status, &error);
+    g_assert_no_error(error);
+    g_assert_true(ok);
+
+    // The modules are loaded from the main loop
+    int64_t deadline = g_get_monotonic_time() + 10 * G_USEC_PER_SEC;
+    do {
+        g_main_context_iteration(nullptr, false);
+        ok = gjs_context_eval(gjs, "importResult", -1, "<input>", &status,
+                              &error);
+        g_assert_no_error(error);
+        g_assert_true(ok);
+    } while (status != 3 && g_get_monotonic_time() < deadline);
+    g_assert_cmpint(status, ==, 3);
+
+    gjs.reset();
+    remove_dynamic_import_modules(dir);
+}
+
+static void gjstest_test_func_gjs_context_dispose_during_import(void) {
+    GjsAutoChar dir = g_dir_make_tmp("gjs-test-import-XXXXXX", nullptr);
+    write_dynamic_import_modules(dir);
+    GjsAutoChar main_path = g_build_filename(dir, "main.js", nullptr);
+    GjsAutoChar main_uri = g_filename_to_uri(main_path, nullptr, nullptr);
+
+    GjsAutoUnref<GjsContext> gjs = gjs_context_new();
+    GError* error = nullptr;
+    int status;
+
+    GjsAutoChar script =
+        g_strdup_printf("import('%s').then(() => {});", main_uri.get());
+    bool ok = gjs_context_eval(gjs, script, -1, "<input>", &status, &error);
+    g_assert_no_error(error);
+    g_assert_true(ok);
+
+    // The pending load is abandoned, and its callbacks must not touch the
+    // context afterwards
+    gjs.reset();
+    int64_t deadline = g_get_monotonic_time() + G_USEC_PER_SEC / 10;
+    while (g_get_monotonic_time() < deadline)
+        g_main_context_iteration(nullptr, false);
+
+    remove_dynamic_import_modules(dir);
+}
+
+static void* eval_in_child_context(void* parent) {
+    GMainContext* main_context = g_main_context_new();
+    g_main_context_push_thread_default(main_context);
+    {
+        GjsAutoUnref<GjsContext> child = GJS_CONTEXT(g_object_new(
+            GJS_TYPE_CONTEXT, "parent-context", parent, nullptr));
+        GError* error = nullptr;
+        int status;
+        bool ok = gjs_context_eval(child, "1 + 1", -1, "<input>", &status,
+                                   &error);
+        g_assert_no_error(error);
+        g_assert_true(ok);
+        g_assert_cmpint(status, ==, 2);
+    }
+    g_main_context_pop_thread_default(main_context);
+    g_main_context_unref(main_context);
+    return nullptr;
+}
+
+static void gjstest_test_func_gjs_context_parent_context(void) {
+    GjsAutoUnref<GjsContext> parent = gjs_context_new();
+
+    GThread* thread =
+        g_thread_new("child context", eval_in_child_context, parent.get());
+    g_thread_join(thread);
+
+    // The child's reference is only dropped once the parent's thread gets
+    // around to it
+    g_assert_cmpuint(G_OBJECT(parent.get())->ref_count, ==, 2);
+    while (g_main_context_iteration(nullptr, false)) {
+    }
+    g_assert_cmpuint(G_OBJECT(parent.get())->ref_count, ==, 1);
+}
+
 #define JS_CLASS "\
 const GObject = imports.gi.GObject; \
 const FooBar = GObject.registerClass(class FooBar extends GObject.Object {}); \
@@ -401,6 +623,84 @@ gjstest_test_profiler_start_stop(void)
         g_message("Temp profiler file not deleted");
 }
 
+#ifdef G_OS_UNIX
+static char* inspector_command(GSocketConnection* connection,
+                               const char* command) {
+    GOutputStream* output =
+        g_io_stream_get_output_stream(G_IO_STREAM(connection));
+    GError* error = nullptr;
+    g_output_stream_write_all(output, command, strlen(command), nullptr,
+                              nullptr, &error);
+    g_assert_no_error(error);
+
+    // The reply is only sent from the main loop
+    GjsAutoUnref<GDataInputStream> input = g_data_input_stream_new(
+        g_io_stream_get_input_stream(G_IO_STREAM(connection)));
+    g_filter_input_stream_set_close_base_stream(
+        G_FILTER_INPUT_STREAM(input.get()), false);
+    GAsyncResult* result = nullptr;
+    g_data_input_stream_read_line_async(
+        input, G_PRIORITY_DEFAULT, nullptr,
+        [](GObject*, GAsyncResult* res, void* data) {
+            *static_cast<GAsyncResult**>(data) =
+                G_ASYNC_RESULT(g_object_ref(res));
+        },
+        &result);
+    while (!result)
+        g_main_context_iteration(nullptr, true);
+
+    char* reply = g_data_input_stream_read_line_finish_utf8(input, result,
+                                                            nullptr, &error);
+    g_object_unref(result);
+    g_assert_no_error(error);
+    return reply;
+}
+
+static void gjstest_test_inspector(void) {
+    GjsAutoChar dir = g_dir_make_tmp("gjs-test-inspector-XXXXXX", nullptr);
+    GjsAutoChar path = g_build_filename(dir, "socket", nullptr);
+
+    g_setenv("GJS_INSPECT_SOCKET", path, true);
+    GjsAutoUnref<GjsContext> context = gjs_context_new();
+    g_unsetenv("GJS_INSPECT_SOCKET");
+    g_assert_true(g_file_test(path, G_FILE_TEST_EXISTS));
+
+    struct sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    g_strlcpy(addr.sun_path, path, sizeof addr.sun_path);
+    GjsAutoUnref<GSocketAddress> address =
+        g_socket_address_new_from_native(&addr, sizeof addr);
+    GjsAutoUnref<GSocketClient> client = g_socket_client_new();
+    GError* error = nullptr;
+    GjsAutoUnref<GSocketConnection> connection = g_socket_client_connect(
+        client, G_SOCKET_CONNECTABLE(address.get()), nullptr, &error);
+    g_assert_no_error(error);
+
+    GjsAutoChar reply = inspector_command(connection, "eval 6 * 7\n");
+    g_assert_cmpstr(reply, ==, "{\"ok\":true,\"result\":42}");
+
+    reply = inspector_command(connection, "eval ({a: [1, 'b']})\n");
+    g_assert_cmpstr(reply, ==, "{\"ok\":true,\"result\":{\"a\":[1,\"b\"]}}");
+
+    reply = inspector_command(connection, "eval undefined\n");
+    g_assert_cmpstr(reply, ==, "{\"ok\":true,\"result\":\"undefined\"}");
+
+    reply = inspector_command(connection, "eval throw new Error('oops')\n");
+    g_assert_cmpstr(reply, ==, "{\"ok\":false,\"error\":\"Error: oops\"}");
+
+    reply = inspector_command(connection, "memory\n");
+    g_assert_true(g_str_has_prefix(reply, "{\"ok\":true,\"result\":{"));
+
+    reply = inspector_command(connection, "bogus\n");
+    g_assert_true(g_str_has_prefix(reply, "{\"ok\":false,"));
+
+    g_io_stream_close(G_IO_STREAM(connection.get()), nullptr, nullptr);
+    context.reset();
+    g_assert_false(g_file_test(path, G_FILE_TEST_EXISTS));
+    g_rmdir(dir);
+}
+#endif  // G_OS_UNIX
+
 static void gjstest_test_safe_integer_max(GjsUnitTestFixture* fx, const void*) {
     JS::RootedObject number_class_object(fx->cx);
     JS::RootedValue safe_value(fx->cx);
@@ -425,6 +725,135 @@ static void gjstest_test_safe_integer_min(GjsUnitTestFixture* fx, const void*) {
     g_assert_cmpint(safe_value.toNumber(), ==, min_safe_big_number<int64_t>());
 }
 
+static void relieve_memory_pressure(GjsContext* context) {
+    GjsContextPrivate* gjs = GjsContextPrivate::from_object(context);
+    GjsContextPrivate::on_memory_pressure(GjsMemoryPressure::MODERATE, gjs);
+    GjsContextPrivate::on_memory_pressure(GjsMemoryPressure::CRITICAL, gjs);
+
+    // The context is still usable
+    GError* error = nullptr;
+    int status;
+    bool ok = gjs_context_eval(context, "[1, 2].length + 5", -1, "<input>",
+                               &status, &error);
+    g_assert_no_error(error);
+    g_assert_true(ok);
+    g_assert_cmpint(status, ==, 7);
+}
+
+static void* relieve_memory_pressure_in_thread(void*) {
+    GMainContext* main_context = g_main_context_new();
+    g_main_context_push_thread_default(main_context);
+    {
+        GjsAutoUnref<GjsContext> context = gjs_context_new();
+        relieve_memory_pressure(context);
+    }
+    g_main_context_pop_thread_default(main_context);
+    g_main_context_unref(main_context);
+    return nullptr;
+}
+
+static void gjstest_test_memory_pressure(void) {
+    GjsAutoUnref<GjsContext> context = gjs_context_new();
+    relieve_memory_pressure(context);
+
+    // Another context's thread only frees its own caches, which leaves this
+    // thread's in place while it fills them again
+    GThread* thread = g_thread_new("memory pressure",
+                                   relieve_memory_pressure_in_thread, nullptr);
+    GError* error = nullptr;
+    int status;
+    bool ok = gjs_context_eval(context,
+                               "for (let i = 0; i < 100; i++)"
+                               "    imports.gi.GLib.get_user_name();"
+                               "8",
+                               -1, "<input>", &status, &error);
+    g_thread_join(thread);
+    g_assert_no_error(error);
+    g_assert_true(ok);
+    g_assert_cmpint(status, ==, 8);
+}
+
+static void count_eviction(void* data) { (*static_cast<int*>(data))++; }
+
+static void gjstest_test_cache_budget_lru(void) {
+    // Start from empty, in case earlier tests left caches behind
+    gjs_cache_budget_evict_all();
+    size_t old_limit = gjs_cache_budget_get_limit();
+    gjs_cache_budget_set_limit(300);
+
+    int evicted[3] = {0, 0, 0};
+    {
+        GjsCacheEntry first(count_eviction, &evicted[0]);
+        GjsCacheEntry second(count_eviction, &evicted[1]);
+        GjsCacheEntry third(count_eviction, &evicted[2]);
+
+        first.used(100);
+        second.used(100);
+        third.used(100);
+        g_assert_cmpuint(gjs_cache_budget_get_total(), ==, 300);
+
+        // Nothing is over budget yet
+        while (g_main_context_iteration(nullptr, false)) {
+        }
+        g_assert_cmpint(evicted[0] + evicted[1] + evicted[2], ==, 0);
+
+        // Growing the third cache evicts the least recently used one, which is
+        // the second since the first was touched
+        first.touch();
+        third.used(150);
+        g_assert_cmpint(evicted[1], ==, 0);  // not synchronously
+        while (g_main_context_iteration(nullptr, false)) {
+        }
+        g_assert_cmpint(evicted[0], ==, 0);
+        g_assert_cmpint(evicted[1], ==, 1);
+        g_assert_cmpint(evicted[2], ==, 0);
+        g_assert_cmpuint(second.size(), ==, 0);
+        g_assert_cmpuint(gjs_cache_budget_get_total(), ==, 250);
+
+        gjs_cache_budget_evict_all();
+        g_assert_cmpint(evicted[0], ==, 1);
+        g_assert_cmpint(evicted[1], ==, 1);
+        g_assert_cmpint(evicted[2], ==, 1);
+        g_assert_cmpuint(gjs_cache_budget_get_total(), ==, 0);
+
+        first.used(50);
+    }
+    g_assert_cmpuint(gjs_cache_budget_get_total(), ==, 0);
+
+    gjs_cache_budget_set_limit(old_limit);
+}
+
+struct SlabTestStruct {
+    void* pointers[10];
+};
+
+static void gjstest_test_slab_allocator(void) {
+    GjsSlabAllocator<SlabTestStruct> allocator;
+    std::vector<SlabTestStruct*> structs;
+
+    for (size_t ix = 0; ix < 1000; ix++) {
+        auto* item = static_cast<SlabTestStruct*>(allocator.alloc());
+        for (void* pointer : item->pointers)
+            g_assert_null(pointer);
+        item->pointers[0] = item;
+        structs.push_back(item);
+    }
+    size_t n_slabs = allocator.n_slabs();
+    g_assert_cmpuint(n_slabs, >, 1);
+
+    // Freed cells are reused before allocating another slab
+    allocator.free(structs[10]);
+    auto* reused = static_cast<SlabTestStruct*>(allocator.alloc());
+    g_assert_true(reused == structs[10]);
+    g_assert_null(reused->pointers[0]);
+    g_assert_cmpuint(allocator.n_slabs(), ==, n_slabs);
+
+    // Empty slabs are returned, except for one to allocate from
+    for (SlabTestStruct* item : structs)
+        allocator.free(item);
+    g_assert_cmpuint(allocator.n_slabs(), ==, 1);
+}
+
 int
 main(int    argc,
      char **argv)
@@ -432,6 +861,7 @@ main(int    argc,
     /* Avoid interference in the tests from stray environment variable */
     g_unsetenv("GJS_ENABLE_PROFILER");
     g_unsetenv("GJS_TRACE_FD");
+    g_unsetenv("GJS_INSPECT_SOCKET");
 
     g_test_init(&argc, &argv, NULL);
 
@@ -440,10 +870,26 @@ main(int    argc,
     g_test_add_func("/gjs/context/eval/non-zero-terminated",
                     gjstest_test_func_gjs_context_eval_non_zero_terminated);
     g_test_add_func("/gjs/context/exit", gjstest_test_func_gjs_context_exit);
+    g_test_add_func("/gjs/context/compile/run",
+                    gjstest_test_func_gjs_context_compile_run);
+    g_test_add_func("/gjs/context/eval-module-file",
+                    gjstest_test_func_gjs_context_eval_module_file);
+    g_test_add_func("/gjs/context/dynamic-import",
+                    gjstest_test_func_gjs_context_dynamic_import);
+    g_test_add_func("/gjs/context/dispose-during-import",
+                    gjstest_test_func_gjs_context_dispose_during_import);
+    g_test_add_func("/gjs/context/parent-context",
+                    gjstest_test_func_gjs_context_parent_context);
     g_test_add_func("/gjs/gobject/js_defined_type", gjstest_test_func_gjs_gobject_js_defined_type);
     g_test_add_func("/gjs/gobject/without_introspection",
                     gjstest_test_func_gjs_gobject_without_introspection);
     g_test_add_func("/gjs/profiler/start_stop", gjstest_test_profiler_start_stop);
+#ifdef G_OS_UNIX
+    g_test_add_func("/gjs/inspector", gjstest_test_inspector);
+#endif
+    g_test_add_func("/gjs/cache-budget/lru", gjstest_test_cache_budget_lru);
+    g_test_add_func("/gjs/memory-pressure", gjstest_test_memory_pressure);
+    g_test_add_func("/gjs/slab-allocator", gjstest_test_slab_allocator);
     g_test_add_func("/util/misc/strv/concat/null",
                     gjstest_test_func_util_misc_strv_concat_null);
     g_test_add_func("/util/misc/strv/concat/pointers",